@@ -3,6 +3,10 @@
 #ifndef HEADER_COMM_LORAWAN
 #define HEADER_COMM_LORAWAN
 
+#include "../agendador_uplinks/agendador_uplinks.h"
+#include "../despachante_at/despachante_at.h"
+#include "../payloads/payloads.h"
+
 /* Definições - GPIOs utilizados na comunicação
                 serial com módulo LoRaWAN
 */
@@ -15,10 +19,75 @@
 #define TAM_BUFFER_UART_MOD_LORAWAN        256  //bytes
 #define PORTA_UART_MOD_LORAWAN             UART_NUM_1
 #define UART_BAUD_RATE                     9600
-#define TEMPO_ESPERA_RECEBE_BYTES          20 / portTICK_PERIOD_MS
+
+/* Definição - tempo máximo de espera pelo resultado (OK/ERROR) de um comando AT */
+#define TEMPO_MAX_RESPOSTA_MOD_LORAWAN_MS  2000 //ms
+
+/* Definição - classe LoRaWAN do dispositivo ('A' ou 'C'). Em classe C, os
+ *             downlinks chegam a qualquer momento e são entregues ao tratador
+ *             registrado com registra_tratador_downlink_lorawan().
+ */
+#define CLASSE_LORAWAN                     'A'
+
+/* Definições - modo de ativação no servidor de rede:
+ *              - MODO_JOIN_LORAWAN_OTAA: join (com backoff e degraus de DR) e
+ *                sessão persistida em memória RTC e na NVS, retomada em reboots
+ *                sem novo join (ver sessao_lorawan);
+ *              - MODO_JOIN_LORAWAN_ABP (padrão): chaves de sessão fixas (DEVADDR,
+ *                APPSKEY e NWKSKEY).
+ *              OTAA é opcional: exige DEVEUI e APPKEY cadastrados no servidor de
+ *              rede. Sem sessão (join em andamento), os envios são adiados.
+ */
+#define MODO_JOIN_LORAWAN_ABP              0
+#define MODO_JOIN_LORAWAN_OTAA             1
+#define MODO_JOIN_LORAWAN                  MODO_JOIN_LORAWAN_ABP
+
+/* Definições - DRs das tentativas de join: a primeira no DR inicial (join-request
+ *              mais curto), descendo até o DR mínimo (LA915: DR0 e DR1 não são
+ *              permitidos com o dwell time de 400 ms)
+ */
+#define DR_JOIN_INICIAL_LORAWAN            5
+#define DR_JOIN_MINIMO_LORAWAN             2
+
+/* Definição - tempo máximo de espera pelo resultado de uma tentativa de join
+ *             (join-accept nas janelas de 5 s e 6 s depois do join-request)
+ */
+#define TEMPO_MAX_RESULTADO_JOIN_LORAWAN_MS 10000 //ms
+
+/* Definições - plano de frequências e DR usados nos uplinks */
+#define PLANO_FREQUENCIAS_LORAWAN          PLANO_LA915
+#define DR_LORAWAN                         2
+
+/* Definição - orçamento diário de tempo no ar dos uplinks. Padrão: sem
+ *             orçamento (o LA915 não tem limite legal de duty cycle). Em
+ *             redes com fair-use, use ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS
+ *             (os envios passam a ser espaçados/adiados pelo agendador).
+ */
+#define ORCAMENTO_DIARIO_TEMPO_NO_AR_LORAWAN_MS  AGENDADOR_UPLINKS_SEM_ORCAMENTO
+
+/* Definição - tamanho máximo do payload LoRaWAN (DR2 em LA915, com dwell time de 400ms) */
+#define TAM_MAX_PAYLOAD_LORAWAN            11   //bytes
+
+/* Definição - porta LoRaWAN usada por envia_mensagem_binaria_lorawan_ABP() (a do payload dos contadores, definida no esquema) */
+#define PORTA_PADRAO_LORAWAN               PAYLOAD_CONTADORES_PORTA
+
+/* Definição - maior espera pelo agendador de uplinks feita dentro de um envio.
+ *             Esperas maiores fazem o envio ser adiado.
+ */
+#define TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS  5000 //ms
+
+/* Tratador de downlinks recebidos (executado no contexto da tarefa leitora da UART) */
+typedef void (*TTratador_downlink_lorawan)(const TDownlink_at * pt_downlink);
 
 #endif
 
 /* Protótipos */
 void init_lorawan(void);
-void envia_mensagem_binaria_lorawan_ABP(char * pt_bytes, int qtde_bytes);
\ No newline at end of file
+esp_err_t envia_mensagem_binaria_lorawan_ABP(char * pt_bytes, int qtde_bytes);
+esp_err_t envia_mensagem_binaria_lorawan_ABP_na_porta(int porta, char * pt_bytes, int qtde_bytes);
+int64_t tempo_ate_liberar_envio_lorawan_ms(int qtde_bytes);
+const char * obtem_dev_addr_lorawan(void);
+void obtem_contadores_tempo_no_ar_lorawan(TAgendador_uplinks * pt_contadores);
+void registra_tratador_downlink_lorawan(TTratador_downlink_lorawan tratador);
+void obtem_metricas_lorawan(TMetricas_lorawan * pt_metricas);
+void loga_metricas_lorawan(void);
\ No newline at end of file
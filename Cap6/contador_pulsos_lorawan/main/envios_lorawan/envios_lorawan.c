@@ -5,17 +5,30 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <time.h>
 #include <esp_task_wdt.h>
+#include "esp_attr.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_system.h"
 #include "freertos/queue.h"
 
 /* Includes dos módulos do software */
 #include "../LoRaWAN/LoRaWAN.h"
 #include "../contadores_de_pulsos/contadores_de_pulsos.h"
 #include "../nvs_rw/nvs_rw.h"
+#include "../fila_uplinks/fila_uplinks.h"
+#include "../payloads/payloads.h"
+#include "../fase_uplinks/fase_uplinks.h"
+#include "../historico_pulsos/historico_pulsos.h"
+
+/* Log diferido: nível de log deste módulo. Os bytes do payload são logados
+ * em nível debug e, portanto, não são compilados.
+ */
+#define LOG_DIFERIDO_NIVEL_MODULO  LOG_DIFERIDO_NIVEL_INFO
+#include "../log_diferido/log_diferido.h"
 
 /* Includes de parametrização das tarefas */
 #include "../prio_tasks.h"
@@ -27,6 +40,22 @@
 /* Definição - tempo minimo entre envios */
 #define TEMPO_MIN_ENTRE_ENVIOS_LORAWAN_MS   15000 //ms
 
+/* Definição - jitter máximo sorteado a cada envio, somado à fase do dispositivo
+ *             (evita que dois dispositivos de fases próximas colidam em todos os ciclos)
+ */
+#define JITTER_MAX_ENVIOS_LORAWAN_MS        10000 //ms
+
+/* Definição - intervalo de registro do histórico dos contadores */
+#define TEMPO_INTERVALO_HISTORICO_PULSOS_MS 60000 //ms
+
+/* Definição - porta LoRaWAN do quadro de histórico dos contadores
+ *             (codec próprio, ver historico_pulsos.h)
+ */
+#define PORTA_HISTORICO_PULSOS              13
+
+/* Definição - envio dos uplinks pendentes na fila */
+#define QTDE_MAX_QUADROS_POR_CICLO          3
+
 /* Definições - inserção e leitura de dados */
 #define TEMPO_MAX_PARA_INSERIR_DADO_FILA    ( TickType_t ) 1
 #define TEMPO_MAX_PARA_LER_DADO_FILA        ( TickType_t ) 100
@@ -36,12 +65,30 @@
 #define HANDLER_TASK_ENVIOS_LORAWAN NULL
 #define CPU_TASK_ENVIOS_LORAWAN 0
 
+/* A leitura dos contadores (payload contadores) é guardada na fila de uplinks pendentes */
+_Static_assert(PAYLOAD_CONTADORES_TAM <= FILA_UPLINKS_TAM_MAX_DADOS, "payload dos contadores nao cabe na fila de uplinks");
+
 /* Variáveis locais */
 static uint32_t total_de_envios = 0;
+static bool primeiro_uplink_enviado = false;
+
+/* Histórico minuto a minuto dos contadores (desde o último quadro de histórico aceito) */
+static THistorico_pulsos historico_pulsos;
+
+/* Fila de uplinks pendentes. Fica em memória RTC não inicializada, de forma
+ * a sobreviver a resets por software e por watchdog.
+ */
+static RTC_NOINIT_ATTR TFila_uplinks fila_uplinks;
 
 /* Tarefas deste módulo */
 static void envios_lorawan_task(void *arg);
 
+/* Funções locais */
+static void envia_uplinks_pendentes(void);
+static esp_err_t envia_historico_pulsos(void);
+static void le_contadores_de_pulsos(uint32_t * pt_contador_1, uint32_t * pt_contador_2);
+static uint32_t calcula_periodo_envios_ms(void);
+
 /* Função: inicializa envios LoRaWAN
  * Parâmetros: nenhum
  * Retorno: nenhum
@@ -53,6 +100,10 @@ void init_envios_lorawan(void)
     /* Inicializa totalizador de envios LoRaWAN */
     total_de_envios = 0;
 
+    /* Inicializa fila de uplinks pendentes (mantendo o conteúdo anterior, se válido) */
+    fila_uplinks_inicializa(&fila_uplinks);
+    ESP_LOGI(ENVIOS_LORAWAN_TAG, "Uplinks pendentes na fila: %d", fila_uplinks_quantidade(&fila_uplinks));
+
     /* Inicializa a tarefa que gerencia os comandos */
     xTaskCreatePinnedToCore(envios_lorawan_task, "envios_lorawan",
                             ENVIOS_LORAWAN_TAM_TASK_STACK,
@@ -70,86 +121,300 @@ void init_envios_lorawan(void)
  */
 static void envios_lorawan_task(void *arg)
 {
-    char bytes_para_enviar[8] = {0};
+    uint8_t bytes_para_enviar[PAYLOAD_CONTADORES_TAM] = {0};
+    TPayload_contadores payload_contadores;
     uint32_t contador_1 = 0;
     uint32_t contador_2 = 0;
     int qtde_bytes = 0;
     int i;
-    char * pt_byte_contador;
     int64_t tempo_atual = 0;
-    int64_t tempo_ref = 0;
+    int64_t instante_proximo_minuto = 0;
+    int64_t instante_proxima_gravacao_nvs = 0;
+    uint32_t dev_addr = 0;
+    bool envia_contadores_absolutos = true;
+    esp_err_t status_historico;
+    TFase_uplinks fase_uplinks;
 
     esp_task_wdt_add(NULL);
 
-    tempo_ref = esp_timer_get_time() / 1000;
+    /* Os envios seguem a grade de fase dos uplinks: o primeiro é feito na fase
+     * do dispositivo (derivada do DevAddr) a partir do início da tarefa. Assim,
+     * depois de uma queda de energia que reinicia a frota inteira, os
+     * dispositivos não transmitem todos ao mesmo tempo.
+     */
+    if (fase_uplinks_le_dev_addr(obtem_dev_addr_lorawan(), &dev_addr) == false)
+    {
+        ESP_LOGE(ENVIOS_LORAWAN_TAG, "DevAddr invalido. Fase dos uplinks sorteada.");
+        dev_addr = esp_random();
+    }
+
+    fase_uplinks_inicializa(&fase_uplinks, dev_addr, calcula_periodo_envios_ms(), JITTER_MAX_ENVIOS_LORAWAN_MS, esp_random(),
+                            esp_timer_get_time() / 1000);
+    ESP_LOGI(ENVIOS_LORAWAN_TAG, "Envios a cada %u ms, fase de %u ms", fase_uplinks.periodo_ms, fase_uplinks.deslocamento_ms);
+
+    /* Os pulsos de cada minuto são registrados no histórico, e cada envio leva
+     * o histórico desde o envio anterior num único quadro. O primeiro envio (e
+     * o envio depois de um histórico cheio) leva os contadores absolutos, que
+     * ancoram no servidor os contadores de 16 bits dos quadros de histórico.
+     */
+    le_contadores_de_pulsos(&contador_1, &contador_2);
+    historico_pulsos_inicializa(&historico_pulsos, contador_1, contador_2);
+    instante_proximo_minuto = (esp_timer_get_time() / 1000) + TEMPO_INTERVALO_HISTORICO_PULSOS_MS;
+    instante_proxima_gravacao_nvs = (esp_timer_get_time() / 1000) + TEMPO_INTERVALO_GRAVACAO_CONTADORES_NVS_MS;
 
     while (1)
     {        
-        /* Aguarda momento do envio */
         tempo_atual = esp_timer_get_time() / 1000;
 
-        if ( (tempo_atual - tempo_ref) < TEMPO_MIN_ENTRE_ENVIOS_LORAWAN_MS )
+        /* Salva na NVS os valores dos contadores periodicamente, haja envio ou
+         * não: envios adiados pelo agendador, recusados pelo módulo ou
+         * espaçados pela grade não atrasam a gravação
+         */
+        if (tempo_atual >= instante_proxima_gravacao_nvs)
         {
-            esp_task_wdt_reset();
-            continue;
+            instante_proxima_gravacao_nvs = tempo_atual + TEMPO_INTERVALO_GRAVACAO_CONTADORES_NVS_MS;
+            le_contadores_de_pulsos(&contador_1, &contador_2);
+            grava_valor_contador_nvs(CHAVE_NVS_CONTADOR_1, contador_1);
+            grava_valor_contador_nvs(CHAVE_NVS_CONTADOR_2, contador_2);
+
+            /* Aproveita o momento para registrar as métricas da comunicação LoRaWAN */
+            loga_metricas_lorawan();
         }
-        else
+
+        /* Registra no histórico os pulsos do último minuto */
+        if (tempo_atual >= instante_proximo_minuto)
         {
-            tempo_ref = esp_timer_get_time() / 1000;
+            instante_proximo_minuto += TEMPO_INTERVALO_HISTORICO_PULSOS_MS;
+            le_contadores_de_pulsos(&contador_1, &contador_2);
+
+            if ((envia_contadores_absolutos == false) &&
+                (historico_pulsos_registra_minuto(&historico_pulsos, contador_1, contador_2) == false))
+            {
+                ESP_LOGE(ENVIOS_LORAWAN_TAG, "Historico dos contadores cheio. Proximo envio leva os contadores absolutos.");
+                envia_contadores_absolutos = true;
+            }
         }
-        
-        /* Le contadores de pulsos */
-        qtde_bytes = 8;
-        while (xQueuePeek(fila_contador_pulsos_1, &contador_1, TEMPO_MAX_PARA_LER_DADO_FILA) != pdPASS)
+
+        /* Aguarda momento do envio */
+        if (fase_uplinks_envio_liberado(&fase_uplinks, tempo_atual) == false)
         {
             esp_task_wdt_reset();
             vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+        else
+        {
+            fase_uplinks_avanca(&fase_uplinks, tempo_atual);
         }
 
-        while (xQueuePeek(fila_contador_pulsos_2, &contador_2, TEMPO_MAX_PARA_LER_DADO_FILA) != pdPASS)
+        /* Envia o histórico dos contadores. Se o envio for adiado ou falhar, o
+         * histórico continua acumulando e vai no próximo envio (com passo
+         * maior, se minuto a minuto não couber mais).
+         */
+        if (envia_contadores_absolutos == false)
         {
-            esp_task_wdt_reset();
-            vTaskDelay(10 / portTICK_PERIOD_MS);
+            status_historico = envia_historico_pulsos();
+
+            if (status_historico == ESP_ERR_INVALID_SIZE)
+            {
+                ESP_LOGE(ENVIOS_LORAWAN_TAG, "Historico de %d minutos nao cabe num quadro. Enviando contadores absolutos.", historico_pulsos.qtde_minutos);
+                envia_contadores_absolutos = true;
+            }
+            else if ((status_historico != ESP_OK) && (status_historico != ESP_ERR_NOT_FOUND))
+            {
+                vTaskDelay(10 / portTICK_PERIOD_MS);
+                continue;
+            }
         }
         
-        pt_byte_contador = (char *)&contador_1;
-        bytes_para_enviar[0] = *pt_byte_contador;
-        pt_byte_contador++;
-        bytes_para_enviar[1] = *pt_byte_contador;
-        pt_byte_contador++;
-        bytes_para_enviar[2] = *pt_byte_contador;
-        pt_byte_contador++;
-        bytes_para_enviar[3] = *pt_byte_contador;
-
-        pt_byte_contador = (char *)&contador_2;
-        bytes_para_enviar[4] = *pt_byte_contador;
-        pt_byte_contador++;
-        bytes_para_enviar[5] = *pt_byte_contador;
-        pt_byte_contador++;
-        bytes_para_enviar[6] = *pt_byte_contador;
-        pt_byte_contador++;
-        bytes_para_enviar[7] = *pt_byte_contador;
-
-        ESP_LOGI(ENVIOS_LORAWAN_TAG, "Payload a ser enviado:");
-        for(i=0; i<8; i++)
+        /* Le contadores de pulsos */
+        qtde_bytes = PAYLOAD_CONTADORES_TAM;
+        le_contadores_de_pulsos(&contador_1, &contador_2);
+
+        if (envia_contadores_absolutos == true)
         {
-            ESP_LOGI(ENVIOS_LORAWAN_TAG, "Byte %d: %02X", i, bytes_para_enviar[i]);
+            /* Empacota os contadores no formato do esquema (big-endian, independente do processador) */
+            payload_contadores.contador_1 = contador_1;
+            payload_contadores.contador_2 = contador_2;
+            payload_contadores_empacota(&payload_contadores, bytes_para_enviar);
+
+            LOGD_I(ENVIOS_LORAWAN_TAG, "Payload a ser enviado: contador 1 = %u, contador 2 = %u", contador_1, contador_2);
+            for(i=0; i<PAYLOAD_CONTADORES_TAM; i++)
+            {
+                LOGD_D(ENVIOS_LORAWAN_TAG, "Byte %d: %02X", i, bytes_para_enviar[i]);
+            }
+
+            /* Se o agendador de uplinks não libera um envio agora (orçamento de tempo
+             * no ar), a leitura não é enfileirada: como os contadores são cumulativos,
+             * a próxima leitura já contém os pulsos desta.
+             */
+            if (tempo_ate_liberar_envio_lorawan_ms(qtde_bytes) > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+            {
+                LOGD_I(ENVIOS_LORAWAN_TAG, "Envio adiado pelo agendador de uplinks. Leitura agrupada com a proxima.");
+                vTaskDelay(10 / portTICK_PERIOD_MS);
+                continue;
+            }
+
+            /* Insere leitura na fila de uplinks pendentes. O histórico recomeça nesta leitura. */
+            if (fila_uplinks_insere(&fila_uplinks, bytes_para_enviar, qtde_bytes, (uint32_t)time(NULL)) == true)
+            {
+                ESP_LOGE(ENVIOS_LORAWAN_TAG, "Fila de uplinks cheia. Leitura mais antiga descartada.");
+            }
+
+            historico_pulsos_inicializa(&historico_pulsos, contador_1, contador_2);
+            instante_proximo_minuto = tempo_atual + TEMPO_INTERVALO_HISTORICO_PULSOS_MS;
+            envia_contadores_absolutos = false;
         }
 
-        envia_mensagem_binaria_lorawan_ABP(bytes_para_enviar, qtde_bytes);
+        /* Envia o que for possível das leituras absolutas pendentes na fila */
+        envia_uplinks_pendentes();
         total_de_envios++;
-        ESP_LOGI(ENVIOS_LORAWAN_TAG, "Envio #%d LoRaWAN feito. Envios faltantes para o salvamento na NVS: %d", total_de_envios,
-                                                                                                               NUM_ENVIOS_PARA_GRAVAR_CONTADORES_NVS - total_de_envios);
+        LOGD_I(ENVIOS_LORAWAN_TAG, "Envio #%d LoRaWAN feito", total_de_envios);
+
+        /* Aguarda 10ms para reiniciar o ciclo */
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+}
+
+/* Função: lê os contadores de pulsos (valores cumulativos publicados pela ISR)
+ * Parâmetros: - ponteiro para o contador 1
+ *             - ponteiro para o contador 2
+ * Retorno: nenhum
+ */
+static void le_contadores_de_pulsos(uint32_t * pt_contador_1, uint32_t * pt_contador_2)
+{
+    while (xQueuePeek(fila_contador_pulsos_1, pt_contador_1, TEMPO_MAX_PARA_LER_DADO_FILA) != pdPASS)
+    {
+        esp_task_wdt_reset();
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+
+    while (xQueuePeek(fila_contador_pulsos_2, pt_contador_2, TEMPO_MAX_PARA_LER_DADO_FILA) != pdPASS)
+    {
+        esp_task_wdt_reset();
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+}
+
+/* Função: envia o histórico dos contadores num quadro, com o menor passo que
+ *         cabe no payload máximo. O histórico só recomeça se o módulo LoRaWAN
+ *         aceitar o envio.
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: quadro enviado
+ *          ESP_ERR_NOT_FOUND: histórico vazio
+ *          ESP_ERR_INVALID_SIZE: histórico não cabe num quadro (enviar os
+ *                                contadores absolutos)
+ *          ESP_ERR_TIMEOUT: envio adiado pelo agendador de uplinks
+ *          demais: envio recusado pelo módulo LoRaWAN
+ */
+static esp_err_t envia_historico_pulsos(void)
+{
+    uint8_t quadro[TAM_MAX_PAYLOAD_LORAWAN] = {0};
+    int tam_quadro = 0;
+    int passo = 0;
+    esp_err_t status_envio;
+
+    if (historico_pulsos.qtde_minutos == 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
 
-        /* Verifica se é momento de salvar na NVS os valores dos contadores */
-        if (total_de_envios == NUM_ENVIOS_PARA_GRAVAR_CONTADORES_NVS)
+    tam_quadro = historico_pulsos_codifica(&historico_pulsos, quadro, sizeof(quadro), &passo);
+
+    if (tam_quadro == 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (tempo_ate_liberar_envio_lorawan_ms(tam_quadro) > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+    {
+        LOGD_I(ENVIOS_LORAWAN_TAG, "Envio adiado pelo agendador de uplinks. Historico agrupado com o proximo.");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_task_wdt_reset();
+    status_envio = envia_mensagem_binaria_lorawan_ABP_na_porta(PORTA_HISTORICO_PULSOS, (char *)quadro, tam_quadro);
+
+    if (status_envio != ESP_OK)
+    {
+        ESP_LOGE(ENVIOS_LORAWAN_TAG, "Envio do historico falhou. %d minuto(s) permanecem no historico", historico_pulsos.qtde_minutos);
+        return status_envio;
+    }
+
+    LOGD_I(ENVIOS_LORAWAN_TAG, "Historico de %d minutos enviado (passo de %d min, %d bytes)", historico_pulsos.qtde_minutos, passo, tam_quadro);
+    historico_pulsos_reinicia(&historico_pulsos);
+    return ESP_OK;
+}
+
+/* Função: calcula o período dos envios. É o tempo mínimo entre envios, a não
+ *         ser que haja um orçamento diário de tempo no ar (opcional, ver
+ *         LoRaWAN.h) que só permita envios mais espaçados: nesse caso, a
+ *         grade usa o período que o orçamento permite (senão, a frota inteira
+ *         seria liberada pelo agendador de uplinks nos mesmos instantes, e a
+ *         fase se perderia).
+ * Parâmetros: nenhum
+ * Retorno: período (ms)
+ */
+static uint32_t calcula_periodo_envios_ms(void)
+{
+    uint64_t orcamento_diario_ms = ORCAMENTO_DIARIO_TEMPO_NO_AR_LORAWAN_MS;
+    uint64_t tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS_LORAWAN, DR_LORAWAN, TAM_MAX_PAYLOAD_LORAWAN);
+    uint64_t periodo_orcamento_ms;
+
+    if (orcamento_diario_ms == AGENDADOR_UPLINKS_SEM_ORCAMENTO)
+    {
+        return TEMPO_MIN_ENTRE_ENVIOS_LORAWAN_MS;
+    }
+
+    periodo_orcamento_ms = ((tempo_no_ar_us * 86400ULL) / orcamento_diario_ms) + JITTER_MAX_ENVIOS_LORAWAN_MS;
+
+    if (periodo_orcamento_ms < TEMPO_MIN_ENTRE_ENVIOS_LORAWAN_MS)
+    {
+        return TEMPO_MIN_ENTRE_ENVIOS_LORAWAN_MS;
+    }
+
+    return (uint32_t)periodo_orcamento_ms;
+}
+
+/* Função: envia os uplinks pendentes na fila, do mais antigo para o mais novo.
+ *         Registros só saem da fila se o módulo LoRaWAN aceitar o envio.
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void envia_uplinks_pendentes(void)
+{
+    uint8_t quadro[TAM_MAX_PAYLOAD_LORAWAN] = {0};
+    int tam_quadro = 0;
+    int qtde_registros = 0;
+    int qtde_quadros = 0;
+
+    while (qtde_quadros < QTDE_MAX_QUADROS_POR_CICLO)
+    {
+        tam_quadro = fila_uplinks_monta_quadro(&fila_uplinks, (uint32_t)time(NULL), quadro, sizeof(quadro), &qtde_registros);
+
+        if (tam_quadro == 0)
         {
-            grava_valor_contador_nvs(CHAVE_NVS_CONTADOR_1, contador_1);
-            grava_valor_contador_nvs(CHAVE_NVS_CONTADOR_2, contador_2);
-            total_de_envios = 0;
+            break;
         }
 
-        /* Aguarda 10ms para reiniciar o ciclo */
-        vTaskDelay(10 / portTICK_PERIOD_MS);
+        /* Entre dois quadros, o próprio envio aguarda o módulo terminar a transmissão
+         * e as janelas de recepção anteriores (agendador de uplinks)
+         */
+        esp_task_wdt_reset();
+
+        if (envia_mensagem_binaria_lorawan_ABP((char *)quadro, tam_quadro) != ESP_OK)
+        {
+            ESP_LOGE(ENVIOS_LORAWAN_TAG, "Envio falhou. %d uplink(s) permanecem na fila", fila_uplinks_quantidade(&fila_uplinks));
+            break;
+        }
+
+        fila_uplinks_confirma_envio(&fila_uplinks, qtde_registros);
+        qtde_quadros++;
+
+        if (primeiro_uplink_enviado == false)
+        {
+            ESP_LOGI(ENVIOS_LORAWAN_TAG, "Primeiro uplink enviado %lld ms apos o boot", esp_timer_get_time() / 1000);
+            primeiro_uplink_enviado = true;
+        }
     }
 }
@@ -0,0 +1,46 @@
+/* Header file: fase dos uplinks (espalhamento dos envios periódicos da frota)
+ *
+ * Os envios periódicos de um dispositivo acontecem numa grade de período
+ * fixo, deslocada por uma fase estável derivada do DevAddr (cada
+ * dispositivo da frota tem a sua, espalhada uniformemente pelo período),
+ * mais um jitter aleatório limitado sorteado a cada ciclo:
+ *   envio do ciclo k = referência + fase + k * período + jitter (0 a jitter máximo)
+ * O jitter não se acumula (a grade é mantida), e a fase não depende do
+ * instante do boot: depois de uma queda de energia que reinicia a frota
+ * inteira, os dispositivos continuam transmitindo em instantes diferentes,
+ * e dois dispositivos com fases próximas não colidem em todos os ciclos.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+#ifndef HEADER_FASE_UPLINKS
+#define HEADER_FASE_UPLINKS
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Estrutura da fase dos uplinks (configuração e estado) */
+typedef struct
+{
+    /* Configuração */
+    uint32_t periodo_ms;
+    uint32_t jitter_max_ms;
+    uint32_t deslocamento_ms;           // fase estável, derivada do DevAddr
+
+    /* Estado */
+    uint32_t estado_aleatorio;
+    int64_t instante_ciclo_ms;          // instante nominal do ciclo atual (sem jitter)
+    int64_t instante_envio_ms;          // instante do envio do ciclo atual (com jitter)
+}TFase_uplinks;
+
+#endif
+
+/* Protótipos */
+bool fase_uplinks_le_dev_addr(const char * pt_texto, uint32_t * pt_dev_addr);
+uint32_t fase_uplinks_deslocamento_ms(uint32_t dev_addr, uint32_t periodo_ms);
+void fase_uplinks_inicializa(TFase_uplinks * pt_fase, uint32_t dev_addr, uint32_t periodo_ms, uint32_t jitter_max_ms, uint32_t semente,
+                             int64_t instante_referencia_ms);
+bool fase_uplinks_envio_liberado(const TFase_uplinks * pt_fase, int64_t instante_atual_ms);
+int64_t fase_uplinks_tempo_ate_envio_ms(const TFase_uplinks * pt_fase, int64_t instante_atual_ms);
+void fase_uplinks_avanca(TFase_uplinks * pt_fase, int64_t instante_atual_ms);
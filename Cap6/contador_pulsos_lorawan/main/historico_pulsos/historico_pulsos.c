@@ -0,0 +1,382 @@
+/* Módulo: histórico minuto a minuto dos contadores de pulsos
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e testado no computador.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "historico_pulsos.h"
+
+/* Fluxo de bits (escrita ou leitura) sobre um buffer de bytes */
+typedef struct
+{
+    uint8_t * pt_bytes;
+    int tam_max_bits;
+    int qtde_bits;
+}TFluxo_bits;
+
+/* Passos (minutos por bloco) que o quadro pode usar */
+static const int passos[HISTORICO_PULSOS_QTDE_PASSOS] = { 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 30, 40, 60, 120, 240 };
+
+/* Funções locais */
+static bool escreve_bits(TFluxo_bits * pt_fluxo, uint32_t valor, int qtde_bits);
+static bool le_bits(TFluxo_bits * pt_fluxo, uint32_t * pt_valor, int qtde_bits);
+static uint32_t soma_bloco(const THistorico_pulsos * pt_historico, int canal, int passo, int indice_bloco);
+static uint64_t bits_rice(const THistorico_pulsos * pt_historico, int canal, int passo, int k);
+static int codifica_com_passo(const THistorico_pulsos * pt_historico, int indice_passo, uint8_t * pt_quadro, int tam_max_quadro);
+
+/* Função: escreve bits no fluxo (mais significativo primeiro)
+ * Parâmetros: - ponteiro para o fluxo
+ *             - valor (nos qtde_bits menos significativos)
+ *             - quantidade de bits
+ * Retorno: true: escrito; false: não cabe no buffer
+ */
+static bool escreve_bits(TFluxo_bits * pt_fluxo, uint32_t valor, int qtde_bits)
+{
+    int i;
+
+    if ((pt_fluxo->qtde_bits + qtde_bits) > pt_fluxo->tam_max_bits)
+    {
+        return false;
+    }
+
+    for (i = qtde_bits - 1; i >= 0; i--)
+    {
+        if (((valor >> i) & 1) != 0)
+        {
+            pt_fluxo->pt_bytes[pt_fluxo->qtde_bits / 8] |= (uint8_t)(0x80 >> (pt_fluxo->qtde_bits % 8));
+        }
+        pt_fluxo->qtde_bits++;
+    }
+
+    return true;
+}
+
+/* Função: lê bits do fluxo (mais significativo primeiro)
+ * Parâmetros: - ponteiro para o fluxo
+ *             - ponteiro para o valor lido
+ *             - quantidade de bits
+ * Retorno: true: lido; false: fim do buffer
+ */
+static bool le_bits(TFluxo_bits * pt_fluxo, uint32_t * pt_valor, int qtde_bits)
+{
+    int i;
+
+    if ((pt_fluxo->qtde_bits + qtde_bits) > pt_fluxo->tam_max_bits)
+    {
+        return false;
+    }
+
+    *pt_valor = 0;
+    for (i = 0; i < qtde_bits; i++)
+    {
+        *pt_valor = (*pt_valor << 1) | ((pt_fluxo->pt_bytes[pt_fluxo->qtde_bits / 8] >> (7 - (pt_fluxo->qtde_bits % 8))) & 1);
+        pt_fluxo->qtde_bits++;
+    }
+
+    return true;
+}
+
+/* Função: soma os pulsos de um canal num bloco de "passo" minutos
+ * Parâmetros: - ponteiro para o histórico
+ *             - canal
+ *             - passo
+ *             - índice do bloco
+ * Retorno: soma dos pulsos do bloco
+ */
+static uint32_t soma_bloco(const THistorico_pulsos * pt_historico, int canal, int passo, int indice_bloco)
+{
+    uint32_t soma = 0;
+    int i;
+
+    for (i = indice_bloco * passo; (i < ((indice_bloco + 1) * passo)) && (i < pt_historico->qtde_minutos); i++)
+    {
+        soma += pt_historico->pulsos[canal][i];
+    }
+
+    return soma;
+}
+
+/* Função: calcula quantos bits as somas dos blocos de um canal ocupam em código de Rice
+ * Parâmetros: - ponteiro para o histórico
+ *             - canal
+ *             - passo
+ *             - parâmetro k
+ * Retorno: quantidade de bits
+ */
+static uint64_t bits_rice(const THistorico_pulsos * pt_historico, int canal, int passo, int k)
+{
+    uint64_t qtde_bits = 0;
+    int qtde_blocos = (pt_historico->qtde_minutos + passo - 1) / passo;
+    int i;
+
+    for (i = 0; i < qtde_blocos; i++)
+    {
+        qtde_bits += (uint64_t)(soma_bloco(pt_historico, canal, passo, i) >> k) + 1 + k;
+    }
+
+    return qtde_bits;
+}
+
+/* Função: codifica o histórico com um passo
+ * Parâmetros: - ponteiro para o histórico
+ *             - índice do passo na tabela de passos
+ *             - ponteiro para o quadro
+ *             - tamanho máximo do quadro
+ * Retorno: tamanho do quadro (bytes). 0 se não couber.
+ */
+static int codifica_com_passo(const THistorico_pulsos * pt_historico, int indice_passo, uint8_t * pt_quadro, int tam_max_quadro)
+{
+    TFluxo_bits fluxo;
+    uint64_t qtde_bits_total = HISTORICO_PULSOS_BITS_CABECALHO;
+    uint64_t qtde_bits_canal;
+    uint64_t menor_qtde_bits;
+    uint32_t soma;
+    uint32_t q;
+    int ks[HISTORICO_PULSOS_QTDE_CANAIS];
+    int passo = passos[indice_passo];
+    int qtde_blocos = (pt_historico->qtde_minutos + passo - 1) / passo;
+    int canal;
+    int k;
+    int i;
+    bool cabe = true;
+
+    for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+    {
+        /* k que deixa o canal com menos bits */
+        ks[canal] = 0;
+        menor_qtde_bits = bits_rice(pt_historico, canal, passo, 0);
+        for (k = 1; k < (1 << HISTORICO_PULSOS_BITS_K); k++)
+        {
+            qtde_bits_canal = bits_rice(pt_historico, canal, passo, k);
+            if (qtde_bits_canal < menor_qtde_bits)
+            {
+                menor_qtde_bits = qtde_bits_canal;
+                ks[canal] = k;
+            }
+        }
+
+        qtde_bits_total += menor_qtde_bits;
+    }
+
+    if (qtde_bits_total > ((uint64_t)tam_max_quadro * 8))
+    {
+        return 0;
+    }
+
+    memset(pt_quadro, 0x00, tam_max_quadro);
+    fluxo.pt_bytes = pt_quadro;
+    fluxo.tam_max_bits = tam_max_quadro * 8;
+    fluxo.qtde_bits = 0;
+
+    cabe &= escreve_bits(&fluxo, (uint32_t)pt_historico->qtde_minutos, HISTORICO_PULSOS_BITS_MINUTOS);
+    cabe &= escreve_bits(&fluxo, (uint32_t)indice_passo, HISTORICO_PULSOS_BITS_INDICE_PASSO);
+    for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+    {
+        cabe &= escreve_bits(&fluxo, (uint32_t)ks[canal], HISTORICO_PULSOS_BITS_K);
+    }
+    for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+    {
+        cabe &= escreve_bits(&fluxo, pt_historico->bases[canal] & 0xFFFF, HISTORICO_PULSOS_BITS_BASE);
+    }
+
+    /* Blocos: canal 1 e canal 2 intercalados */
+    for (i = 0; (i < qtde_blocos) && (cabe == true); i++)
+    {
+        for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+        {
+            soma = soma_bloco(pt_historico, canal, passo, i);
+            for (q = soma >> ks[canal]; q > 0; q--)
+            {
+                cabe &= escreve_bits(&fluxo, 0x1, 1);
+            }
+
+            cabe &= escreve_bits(&fluxo, 0x0, 1);
+            cabe &= escreve_bits(&fluxo, soma & ((1UL << ks[canal]) - 1), ks[canal]);
+        }
+    }
+
+    if (cabe == false)
+    {
+        return 0;
+    }
+
+    return (fluxo.qtde_bits + 7) / 8;
+}
+
+/* Função: inicializa o histórico (vazio, a partir dos contadores informados)
+ * Parâmetros: - ponteiro para o histórico
+ *             - contador 1
+ *             - contador 2
+ * Retorno: nenhum
+ */
+void historico_pulsos_inicializa(THistorico_pulsos * pt_historico, uint32_t contador_1, uint32_t contador_2)
+{
+    pt_historico->contadores[0] = contador_1;
+    pt_historico->contadores[1] = contador_2;
+    historico_pulsos_reinicia(pt_historico);
+}
+
+/* Função: registra os pulsos do último minuto
+ * Parâmetros: - ponteiro para o histórico
+ *             - contador 1 no fim do minuto
+ *             - contador 2 no fim do minuto
+ * Retorno: true: registrado
+ *          false: histórico cheio, ou pulsos demais no minuto (a aplicação
+ *                 deve enviar os contadores absolutos e reinicializar o histórico)
+ */
+bool historico_pulsos_registra_minuto(THistorico_pulsos * pt_historico, uint32_t contador_1, uint32_t contador_2)
+{
+    uint32_t pulsos_1 = contador_1 - pt_historico->contadores[0];
+    uint32_t pulsos_2 = contador_2 - pt_historico->contadores[1];
+
+    if ( (pt_historico->qtde_minutos >= HISTORICO_PULSOS_QTDE_MAX_MINUTOS) ||
+         (pulsos_1 > UINT16_MAX) || (pulsos_2 > UINT16_MAX) )
+    {
+        return false;
+    }
+
+    pt_historico->pulsos[0][pt_historico->qtde_minutos] = (uint16_t)pulsos_1;
+    pt_historico->pulsos[1][pt_historico->qtde_minutos] = (uint16_t)pulsos_2;
+    pt_historico->contadores[0] = contador_1;
+    pt_historico->contadores[1] = contador_2;
+    pt_historico->qtde_minutos++;
+
+    return true;
+}
+
+/* Função: reinicia o histórico depois de um envio aceito. O novo histórico
+ *         começa no fim do último minuto registrado.
+ * Parâmetros: ponteiro para o histórico
+ * Retorno: nenhum
+ */
+void historico_pulsos_reinicia(THistorico_pulsos * pt_historico)
+{
+    pt_historico->bases[0] = pt_historico->contadores[0];
+    pt_historico->bases[1] = pt_historico->contadores[1];
+    pt_historico->qtde_minutos = 0;
+}
+
+/* Função: codifica o histórico com o menor passo que cabe no tamanho máximo do quadro
+ * Parâmetros: - ponteiro para o histórico
+ *             - ponteiro para o quadro
+ *             - tamanho máximo do quadro (payload máximo do DR)
+ *             - ponteiro para o passo usado (minutos por bloco)
+ * Retorno: tamanho do quadro (bytes). 0 se o histórico estiver vazio ou não
+ *          couber nem em um único bloco (enviar os contadores absolutos).
+ */
+int historico_pulsos_codifica(const THistorico_pulsos * pt_historico, uint8_t * pt_quadro, int tam_max_quadro, int * pt_passo)
+{
+    int tam_quadro;
+    int indice_passo;
+
+    if (pt_historico->qtde_minutos == 0)
+    {
+        return 0;
+    }
+
+    for (indice_passo = 0; indice_passo < HISTORICO_PULSOS_QTDE_PASSOS; indice_passo++)
+    {
+        tam_quadro = codifica_com_passo(pt_historico, indice_passo, pt_quadro, tam_max_quadro);
+
+        if (tam_quadro > 0)
+        {
+            *pt_passo = passos[indice_passo];
+            return tam_quadro;
+        }
+
+        /* Passos maiores que o histórico dão o mesmo bloco único */
+        if (passos[indice_passo] >= pt_historico->qtde_minutos)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/* Função: decodifica um quadro de histórico
+ * Parâmetros: - ponteiro para o quadro
+ *             - tamanho do quadro
+ *             - ponteiro para o histórico decodificado
+ * Retorno: quantidade de blocos decodificados. -1 se o quadro for inválido.
+ */
+int historico_pulsos_decodifica(const uint8_t * pt_quadro, int tam_quadro, THistorico_pulsos_quadro * pt_decodificado)
+{
+    TFluxo_bits fluxo;
+    uint32_t valor;
+    uint32_t bit;
+    uint32_t q;
+    int ks[HISTORICO_PULSOS_QTDE_CANAIS];
+    int canal;
+    int i;
+
+    fluxo.pt_bytes = (uint8_t *)pt_quadro;
+    fluxo.tam_max_bits = tam_quadro * 8;
+    fluxo.qtde_bits = 0;
+
+    if (le_bits(&fluxo, &valor, HISTORICO_PULSOS_BITS_MINUTOS) == false)
+    {
+        return -1;
+    }
+    pt_decodificado->qtde_minutos = (int)valor;
+
+    if (le_bits(&fluxo, &valor, HISTORICO_PULSOS_BITS_INDICE_PASSO) == false)
+    {
+        return -1;
+    }
+    pt_decodificado->passo = passos[valor];
+
+    for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+    {
+        if (le_bits(&fluxo, &valor, HISTORICO_PULSOS_BITS_K) == false)
+        {
+            return -1;
+        }
+        ks[canal] = (int)valor;
+    }
+
+    for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+    {
+        if (le_bits(&fluxo, &valor, HISTORICO_PULSOS_BITS_BASE) == false)
+        {
+            return -1;
+        }
+        pt_decodificado->bases[canal] = (uint16_t)valor;
+    }
+
+    if ((pt_decodificado->qtde_minutos == 0) || (pt_decodificado->qtde_minutos > HISTORICO_PULSOS_QTDE_MAX_MINUTOS))
+    {
+        return -1;
+    }
+
+    pt_decodificado->qtde_blocos = (pt_decodificado->qtde_minutos + pt_decodificado->passo - 1) / pt_decodificado->passo;
+
+    for (i = 0; i < pt_decodificado->qtde_blocos; i++)
+    {
+        for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+        {
+            q = 0;
+            do
+            {
+                if (le_bits(&fluxo, &bit, 1) == false)
+                {
+                    return -1;
+                }
+                q += bit;
+            } while (bit == 1);
+
+            if (le_bits(&fluxo, &valor, ks[canal]) == false)
+            {
+                return -1;
+            }
+
+            pt_decodificado->somas[canal][i] = (q << ks[canal]) | valor;
+        }
+    }
+
+    return pt_decodificado->qtde_blocos;
+}
@@ -0,0 +1,79 @@
+/* Header file: histórico minuto a minuto dos contadores de pulsos
+ *
+ * A cada minuto, os pulsos contados em cada canal (diferença entre as
+ * leituras dos contadores no início e no fim do minuto) são guardados no
+ * histórico. No envio, o histórico inteiro (desde o último envio aceito) vai
+ * num único quadro: os contadores do início do histórico (16 bits menos
+ * significativos, que o servidor completa com a última leitura absoluta
+ * recebida) e, para cada bloco de "passo" minutos consecutivos, a soma dos
+ * pulsos de cada canal, em código de Rice:
+ *   q = soma >> k bits '1', um bit '0' e os k bits menos significativos da soma
+ * O parâmetro k de cada canal é o que deixa o quadro menor (canal parado
+ * custa 1 bit por bloco, com k = 0).
+ *
+ * Formato do quadro (fluxo de bits, do bit mais significativo de cada byte
+ * para o menos significativo):
+ *   - quantidade de minutos do histórico (8 bits)
+ *   - índice do passo na tabela de passos (4 bits)
+ *   - k do canal 1 e k do canal 2 (4 bits cada)
+ *   - contador 1 e contador 2 no início do histórico (16 bits cada)
+ *   - para cada bloco, a soma do canal 1 e a soma do canal 2 (código de Rice)
+ * O último bloco pode ter menos que "passo" minutos. É usado o menor passo
+ * da tabela que cabe no payload máximo. Se nem com um único bloco o quadro
+ * cabe (pulsos demais), a codificação falha e a aplicação envia os
+ * contadores absolutos (payload contadores).
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e testado no computador.
+ */
+
+#ifndef HEADER_HISTORICO_PULSOS
+#define HEADER_HISTORICO_PULSOS
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definição - quantidade de canais (contadores de pulsos) */
+#define HISTORICO_PULSOS_QTDE_CANAIS        2
+
+/* Definição - duração máxima do histórico (minutos). Com o histórico cheio,
+ *             a aplicação envia os contadores absolutos e recomeça.
+ */
+#define HISTORICO_PULSOS_QTDE_MAX_MINUTOS   240
+
+/* Definições - formato do quadro */
+#define HISTORICO_PULSOS_BITS_MINUTOS       8
+#define HISTORICO_PULSOS_BITS_INDICE_PASSO  4
+#define HISTORICO_PULSOS_BITS_K             4
+#define HISTORICO_PULSOS_BITS_BASE          16
+#define HISTORICO_PULSOS_BITS_CABECALHO     (HISTORICO_PULSOS_BITS_MINUTOS + HISTORICO_PULSOS_BITS_INDICE_PASSO + \
+                                             (HISTORICO_PULSOS_QTDE_CANAIS * (HISTORICO_PULSOS_BITS_K + HISTORICO_PULSOS_BITS_BASE)))
+#define HISTORICO_PULSOS_QTDE_PASSOS        16
+
+/* Estrutura - histórico dos contadores */
+typedef struct
+{
+    uint32_t bases[HISTORICO_PULSOS_QTDE_CANAIS];       // contadores no início do histórico
+    uint32_t contadores[HISTORICO_PULSOS_QTDE_CANAIS];  // contadores no fim do último minuto registrado
+    uint16_t pulsos[HISTORICO_PULSOS_QTDE_CANAIS][HISTORICO_PULSOS_QTDE_MAX_MINUTOS];
+    int qtde_minutos;
+}THistorico_pulsos;
+
+/* Estrutura - quadro de histórico decodificado */
+typedef struct
+{
+    int qtde_minutos;
+    int passo;                                          // minutos por bloco
+    int qtde_blocos;
+    uint16_t bases[HISTORICO_PULSOS_QTDE_CANAIS];       // 16 bits menos significativos dos contadores no início
+    uint32_t somas[HISTORICO_PULSOS_QTDE_CANAIS][HISTORICO_PULSOS_QTDE_MAX_MINUTOS];
+}THistorico_pulsos_quadro;
+
+#endif
+
+/* Protótipos */
+void historico_pulsos_inicializa(THistorico_pulsos * pt_historico, uint32_t contador_1, uint32_t contador_2);
+bool historico_pulsos_registra_minuto(THistorico_pulsos * pt_historico, uint32_t contador_1, uint32_t contador_2);
+void historico_pulsos_reinicia(THistorico_pulsos * pt_historico);
+int historico_pulsos_codifica(const THistorico_pulsos * pt_historico, uint8_t * pt_quadro, int tam_max_quadro, int * pt_passo);
+int historico_pulsos_decodifica(const uint8_t * pt_quadro, int tam_quadro, THistorico_pulsos_quadro * pt_decodificado);
@@ -0,0 +1,274 @@
+/* Módulo: log diferido (binário) */
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "log_diferido.h"
+
+/* Definição - debug */
+#define LOG_DIFERIDO_TAG   "LOG_DIFERIDO"
+
+/* Definição - tamanho máximo de uma linha de log formatada */
+#define TAM_MAX_TEXTO_LOG  160
+
+/* Registro de log no anel. O campo seq vale (índice de escrita + 1) quando
+ * o registro está completo e 0 enquanto está sendo escrito.
+ */
+typedef struct
+{
+    uint32_t seq;
+    uint32_t instante_us;
+    const char * pt_tag;
+    const char * pt_formato;
+    uint8_t nivel;
+    uint8_t qtde_args;
+    uint32_t args[LOG_DIFERIDO_QTDE_MAX_ARGS];
+}TRegistro_log_diferido;
+
+/* Anel de registros: vários produtores (pontos de log, sem travas) e um
+ * consumidor (tarefa de log ou log_diferido_descarrega())
+ */
+static TRegistro_log_diferido anel_registros[LOG_DIFERIDO_QTDE_REGISTROS];
+static uint32_t idx_escrita = 0;
+static uint32_t idx_leitura = 0;
+static uint32_t total_descartados = 0;
+static uint32_t total_descartados_informados = 0;
+static uint32_t consumidor_ativo = 0;
+
+/* Tarefa deste módulo */
+static void log_diferido_task(void *arg);
+
+/* Funções locais */
+static void escreve_registro(TRegistro_log_diferido * pt_registro);
+static const char * resolve_string(uint32_t endereco);
+
+/* Função: inicializa log diferido (cria a tarefa que escreve os registros no console).
+ *         Registros feitos antes da inicialização ficam no anel e são escritos depois.
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+void log_diferido_inicializa(void)
+{
+    if (xTaskCreate(log_diferido_task, "log_diferido",
+                    LOG_DIFERIDO_TAM_TASK_STACK,
+                    NULL,
+                    LOG_DIFERIDO_PRIO_TASK,
+                    NULL) != pdPASS)
+    {
+        ESP_LOGE(LOG_DIFERIDO_TAG, "Falha ao criar tarefa de log diferido");
+    }
+}
+
+/* Função: grava registro de log no anel (usada pelas macros LOGD_x)
+ * Parâmetros: - nível do log
+ *             - tag e string de formato (constantes)
+ *             - quantidade de argumentos e argumentos (uint32_t cada)
+ * Retorno: nenhum
+ */
+void log_diferido_registra(int nivel, const char * pt_tag, const char * pt_formato, int qtde_args, ...)
+{
+    TRegistro_log_diferido * pt_registro;
+    uint32_t idx;
+    va_list args;
+    int i;
+
+    /* Reserva a posição no anel. Com o anel cheio, o registro mais antigo
+     * ainda não escrito é sobrescrito (e contado como descartado pelo consumidor)
+     */
+    idx = __atomic_fetch_add(&idx_escrita, 1, __ATOMIC_RELAXED);
+    pt_registro = &anel_registros[idx % LOG_DIFERIDO_QTDE_REGISTROS];
+    __atomic_store_n(&pt_registro->seq, 0, __ATOMIC_RELAXED);
+
+    if (qtde_args > LOG_DIFERIDO_QTDE_MAX_ARGS)
+    {
+        qtde_args = LOG_DIFERIDO_QTDE_MAX_ARGS;
+    }
+
+    pt_registro->instante_us = (uint32_t)esp_timer_get_time();
+    pt_registro->pt_tag = pt_tag;
+    pt_registro->pt_formato = pt_formato;
+    pt_registro->nivel = (uint8_t)nivel;
+    pt_registro->qtde_args = (uint8_t)qtde_args;
+
+    va_start(args, qtde_args);
+    for (i = 0; i < qtde_args; i++)
+    {
+        pt_registro->args[i] = va_arg(args, uint32_t);
+    }
+    va_end(args);
+
+    /* Publica o registro */
+    __atomic_store_n(&pt_registro->seq, idx + 1, __ATOMIC_RELEASE);
+}
+
+/* Função: escreve no console todos os registros pendentes no anel (ex: antes
+ *         de entrar em deep sleep, quando a tarefa de log pode não ter rodado)
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+void log_diferido_descarrega(void)
+{
+    TRegistro_log_diferido registro;
+    uint32_t escrita;
+    uint32_t seq;
+    uint32_t pendentes_descartados;
+
+    /* Um consumidor por vez (tarefa de log ou chamada direta) */
+    while (__atomic_exchange_n(&consumidor_ativo, 1, __ATOMIC_ACQUIRE) != 0)
+    {
+        vTaskDelay(1);
+    }
+
+    escrita = __atomic_load_n(&idx_escrita, __ATOMIC_ACQUIRE);
+
+    while (idx_leitura != escrita)
+    {
+        /* Produtores deram a volta no anel: pula os registros sobrescritos */
+        if ((escrita - idx_leitura) > LOG_DIFERIDO_QTDE_REGISTROS)
+        {
+            total_descartados += (escrita - idx_leitura) - LOG_DIFERIDO_QTDE_REGISTROS;
+            idx_leitura = escrita - LOG_DIFERIDO_QTDE_REGISTROS;
+        }
+
+        seq = __atomic_load_n(&anel_registros[idx_leitura % LOG_DIFERIDO_QTDE_REGISTROS].seq, __ATOMIC_ACQUIRE);
+
+        if (seq != (idx_leitura + 1))
+        {
+            if ( (seq == 0) || ((int32_t)(seq - (idx_leitura + 1)) < 0) )
+            {
+                /* Registro ainda sendo escrito: tenta de novo na próxima descarga */
+                break;
+            }
+
+            /* Registro já sobrescrito por um mais novo */
+            total_descartados++;
+            idx_leitura++;
+            continue;
+        }
+
+        memcpy(&registro, &anel_registros[idx_leitura % LOG_DIFERIDO_QTDE_REGISTROS], sizeof(registro));
+
+        /* Confirma que o registro não foi sobrescrito durante a cópia */
+        if (__atomic_load_n(&anel_registros[idx_leitura % LOG_DIFERIDO_QTDE_REGISTROS].seq, __ATOMIC_ACQUIRE) != seq)
+        {
+            total_descartados++;
+            idx_leitura++;
+            continue;
+        }
+
+        idx_leitura++;
+        escreve_registro(&registro);
+    }
+
+    if (total_descartados != total_descartados_informados)
+    {
+        pendentes_descartados = total_descartados - total_descartados_informados;
+        total_descartados_informados = total_descartados;
+        ESP_LOGW(LOG_DIFERIDO_TAG, "%u registro(s) de log descartado(s) (anel cheio)", pendentes_descartados);
+    }
+
+    __atomic_store_n(&consumidor_ativo, 0, __ATOMIC_RELEASE);
+}
+
+/* Função: retorna o total de registros descartados por falta de espaço no anel
+ * Parâmetros: nenhum
+ * Retorno: total de registros descartados
+ */
+uint32_t log_diferido_total_descartados(void)
+{
+    return total_descartados;
+}
+
+/* Função: escreve um registro no console (texto ou hexadecimal, conforme
+ *         LOG_DIFERIDO_SAIDA_BINARIA)
+ * Parâmetros: ponteiro para o registro
+ * Retorno: nenhum
+ */
+static void escreve_registro(TRegistro_log_diferido * pt_registro)
+{
+    static const esp_log_level_t niveis_esp[] = {ESP_LOG_NONE, ESP_LOG_ERROR, ESP_LOG_WARN, ESP_LOG_INFO, ESP_LOG_DEBUG};
+    char texto[TAM_MAX_TEXTO_LOG];
+    int nivel = pt_registro->nivel;
+
+    if (nivel > LOG_DIFERIDO_NIVEL_DEBUG)
+    {
+        nivel = LOG_DIFERIDO_NIVEL_DEBUG;
+    }
+
+#if LOG_DIFERIDO_SAIDA_BINARIA
+    /* instante, tag, formato (uint32 LE), nível, quantidade de argumentos e argumentos (uint32 LE) */
+    uint8_t bytes[14 + (LOG_DIFERIDO_QTDE_MAX_ARGS * 4)];
+    uint32_t campos[3 + LOG_DIFERIDO_QTDE_MAX_ARGS];
+    int qtde_bytes = 0;
+    int qtde_campos = 0;
+    int i;
+
+    campos[qtde_campos++] = pt_registro->instante_us;
+    campos[qtde_campos++] = (uint32_t)(uintptr_t)pt_registro->pt_tag;
+    campos[qtde_campos++] = (uint32_t)(uintptr_t)pt_registro->pt_formato;
+
+    for (i = 0; i < qtde_campos; i++)
+    {
+        bytes[qtde_bytes++] = (uint8_t)(campos[i] & 0xFF);
+        bytes[qtde_bytes++] = (uint8_t)((campos[i] >> 8) & 0xFF);
+        bytes[qtde_bytes++] = (uint8_t)((campos[i] >> 16) & 0xFF);
+        bytes[qtde_bytes++] = (uint8_t)(campos[i] >> 24);
+    }
+
+    bytes[qtde_bytes++] = (uint8_t)nivel;
+    bytes[qtde_bytes++] = pt_registro->qtde_args;
+
+    for (i = 0; i < pt_registro->qtde_args; i++)
+    {
+        bytes[qtde_bytes++] = (uint8_t)(pt_registro->args[i] & 0xFF);
+        bytes[qtde_bytes++] = (uint8_t)((pt_registro->args[i] >> 8) & 0xFF);
+        bytes[qtde_bytes++] = (uint8_t)((pt_registro->args[i] >> 16) & 0xFF);
+        bytes[qtde_bytes++] = (uint8_t)(pt_registro->args[i] >> 24);
+    }
+
+    for (i = 0; i < qtde_bytes; i++)
+    {
+        snprintf(&texto[i * 2], 3, "%02X", bytes[i]);
+    }
+
+    esp_log_write(niveis_esp[nivel], pt_registro->pt_tag, LOG_DIFERIDO_PREFIXO_BINARIO "%s\n", texto);
+#else
+    static const char letras_niveis[] = {'N', 'E', 'W', 'I', 'D'};
+
+    log_diferido_formata(texto, sizeof(texto), pt_registro->pt_formato, pt_registro->args, pt_registro->qtde_args, resolve_string);
+    esp_log_write(niveis_esp[nivel], pt_registro->pt_tag, "%c (%u) %s: %s\n",
+                  letras_niveis[nivel],
+                  pt_registro->instante_us / 1000,
+                  pt_registro->pt_tag,
+                  texto);
+#endif
+}
+
+/* Função: obtém a string apontada por um argumento %s (no ESP32, o próprio ponteiro)
+ * Parâmetros: endereço da string
+ * Retorno: ponteiro para a string
+ */
+static const char * resolve_string(uint32_t endereco)
+{
+    return (const char *)(uintptr_t)endereco;
+}
+
+/* Função: tarefa de log diferido (baixa prioridade): escreve periodicamente
+ *         os registros pendentes no console
+ * Parâmetros: argumentos da task
+ * Retorno: nenhum
+ */
+static void log_diferido_task(void *arg)
+{
+    while (1)
+    {
+        log_diferido_descarrega();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DIFERIDO_PERIODO_TASK_MS));
+    }
+}
@@ -0,0 +1,185 @@
+/* Módulo: log diferido - formatação dos registros em texto
+ *
+ * OBS: este arquivo não depende do ESP-IDF, de forma que também é compilado
+ *      no computador (ver Ferramentas/decodifica_log_diferido).
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "log_diferido.h"
+
+/* Definição - tamanho máximo de uma especificação de conversão (ex: "%-08.3f") */
+#define TAM_MAX_ESPECIFICACAO    16
+
+/* Funções locais */
+static int acrescenta_texto(char * pt_texto, int tam_max, int tam_atual, const char * pt_origem, int tam_origem);
+
+/* Função: acrescenta texto ao fim do texto formatado, truncando se necessário
+ * Parâmetros: - texto formatado, tamanho máximo e tamanho atual
+ *             - texto a acrescentar e seu tamanho
+ * Retorno: novo tamanho do texto formatado
+ */
+static int acrescenta_texto(char * pt_texto, int tam_max, int tam_atual, const char * pt_origem, int tam_origem)
+{
+    if (tam_origem > (tam_max - 1 - tam_atual))
+    {
+        tam_origem = tam_max - 1 - tam_atual;
+    }
+
+    if (tam_origem > 0)
+    {
+        memcpy(&pt_texto[tam_atual], pt_origem, tam_origem);
+        tam_atual += tam_origem;
+    }
+
+    pt_texto[tam_atual] = 0x00;
+    return tam_atual;
+}
+
+/* Função: formata um registro de log diferido em texto (subconjunto do printf:
+ *         flags, largura e precisão numéricas, %d %i %u %x %X %o %c %f %e %g
+ *         %s %p %%; modificadores de tamanho são ignorados, pois todos os
+ *         argumentos têm 32 bits)
+ * Parâmetros: - ponteiro para o texto e seu tamanho máximo
+ *             - string de formato
+ *             - argumentos (32 bits cada) e sua quantidade
+ *             - função que obtém as strings dos argumentos %s
+ * Retorno: tamanho do texto formatado
+ */
+int log_diferido_formata(char * pt_texto, int tam_max, const char * pt_formato, const uint32_t * pt_args, int qtde_args, TResolve_string_log resolve_string)
+{
+    char especificacao[TAM_MAX_ESPECIFICACAO];
+    char conversao[48];
+    const char * pt_string;
+    const char * pt_inicio;
+    int tam_especificacao;
+    int tam_texto = 0;
+    int idx_arg = 0;
+    int tam_conversao;
+    uint32_t arg;
+    float valor_float;
+
+    if (tam_max <= 0)
+    {
+        return 0;
+    }
+
+    pt_texto[0] = 0x00;
+
+    while (*pt_formato != 0x00)
+    {
+        /* Trecho literal até o próximo '%' */
+        pt_inicio = pt_formato;
+        while ( (*pt_formato != 0x00) && (*pt_formato != '%') )
+        {
+            pt_formato++;
+        }
+
+        tam_texto = acrescenta_texto(pt_texto, tam_max, tam_texto, pt_inicio, pt_formato - pt_inicio);
+
+        if (*pt_formato == 0x00)
+        {
+            break;
+        }
+
+        if (pt_formato[1] == '%')
+        {
+            tam_texto = acrescenta_texto(pt_texto, tam_max, tam_texto, "%", 1);
+            pt_formato += 2;
+            continue;
+        }
+
+        /* Especificação: flags, largura e precisão são mantidas; modificadores de tamanho, descartados */
+        especificacao[0] = '%';
+        tam_especificacao = 1;
+        pt_formato++;
+
+        while ( (*pt_formato != 0x00) && (strchr("-+ #0123456789.", *pt_formato) != NULL) )
+        {
+            if (tam_especificacao < (TAM_MAX_ESPECIFICACAO - 2))
+            {
+                especificacao[tam_especificacao++] = *pt_formato;
+            }
+            pt_formato++;
+        }
+
+        while ( (*pt_formato != 0x00) && (strchr("hlLqjzt", *pt_formato) != NULL) )
+        {
+            pt_formato++;
+        }
+
+        if (*pt_formato == 0x00)
+        {
+            break;
+        }
+
+        especificacao[tam_especificacao++] = *pt_formato;
+        especificacao[tam_especificacao] = 0x00;
+
+        if (idx_arg >= qtde_args)
+        {
+            tam_texto = acrescenta_texto(pt_texto, tam_max, tam_texto, "(?)", 3);
+            pt_formato++;
+            continue;
+        }
+
+        arg = pt_args[idx_arg++];
+        tam_conversao = 0;
+
+        switch (*pt_formato)
+        {
+            case 'd':
+            case 'i':
+                tam_conversao = snprintf(conversao, sizeof(conversao), especificacao, (int)(int32_t)arg);
+                break;
+
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c':
+                tam_conversao = snprintf(conversao, sizeof(conversao), especificacao, (unsigned int)arg);
+                break;
+
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+                memcpy(&valor_float, &arg, sizeof(valor_float));
+                tam_conversao = snprintf(conversao, sizeof(conversao), especificacao, (double)valor_float);
+                break;
+
+            case 's':
+                pt_string = (resolve_string != NULL) ? resolve_string(arg) : NULL;
+                pt_string = (pt_string != NULL) ? pt_string : "(?)";
+                tam_texto = acrescenta_texto(pt_texto, tam_max, tam_texto, pt_string, strlen(pt_string));
+                break;
+
+            case 'p':
+                tam_conversao = snprintf(conversao, sizeof(conversao), "0x%08x", (unsigned int)arg);
+                break;
+
+            default:
+                tam_conversao = snprintf(conversao, sizeof(conversao), "%s", especificacao);
+                break;
+        }
+
+        if (tam_conversao > (int)(sizeof(conversao) - 1))
+        {
+            tam_conversao = sizeof(conversao) - 1;
+        }
+
+        if (tam_conversao > 0)
+        {
+            tam_texto = acrescenta_texto(pt_texto, tam_max, tam_texto, conversao, tam_conversao);
+        }
+
+        pt_formato++;
+    }
+
+    return tam_texto;
+}
@@ -13,6 +13,8 @@
 #include "envios_lorawan/envios_lorawan.h"
 #include "contadores_de_pulsos/contadores_de_pulsos.h"
 #include "nvs_rw/nvs_rw.h"
+#include "log_diferido/log_diferido.h"
+#include "inicializacao/inicializacao.h"
 
 /* Definições - debug */
 #define APP_MAIN_TAG       "APP_MAIN"
@@ -20,21 +22,40 @@
 /* Definição - tempo máximo sem feed do watchdog */
 #define TEMPO_MAX_SEM_FEED_WATCHDOG        60 //s
 
+/* Definições - eventos de prontidão dos módulos (inicialização assíncrona) */
+#define EVENTO_NVS_PRONTA                  (1 << 0)
+#define EVENTO_LORAWAN_PRONTO              (1 << 1)
+#define EVENTO_CONTADORES_PRONTOS          (1 << 2)
+#define EVENTO_ENVIOS_LORAWAN_PRONTOS      (1 << 3)
+
 void app_main(void)
 {    
     ESP_LOGI(APP_MAIN_TAG, "Software inicializado");
 
     esp_task_wdt_init(TEMPO_MAX_SEM_FEED_WATCHDOG, true);
 
+    /* Inicializa log diferido (tarefa que escreve os logs no console) */
+    log_diferido_inicializa();
+
+    /* Cada módulo é inicializado em uma tarefa própria, assim que os módulos
+     * dos quais depende estão prontos. Os contadores de pulsos (que leem os
+     * valores salvos na NVS) começam a contar sem esperar a configuração do
+     * módulo LoRaWAN, que leva vários segundos.
+     */
+    ESP_ERROR_CHECK(inicializacao_inicia());
+
     /* Inicializa NVS */
-    init_nvs();
+    ESP_ERROR_CHECK(inicializacao_dispara("init_nvs", init_nvs, 0, EVENTO_NVS_PRONTA));
 
-    /* Inicializa LoRaWAN */
-    init_lorawan();
+    /* Inicializa LoRaWAN (a sessão OTAA é retomada da NVS, ou obtida num join) */
+    ESP_ERROR_CHECK(inicializacao_dispara("init_lorawan", init_lorawan, EVENTO_NVS_PRONTA, EVENTO_LORAWAN_PRONTO));
 
     /* Inicializa modulo de contagem de pulsos */
-    init_contadores_de_pulsos();
+    ESP_ERROR_CHECK(inicializacao_dispara("init_contadores", init_contadores_de_pulsos,
+                                          EVENTO_NVS_PRONTA, EVENTO_CONTADORES_PRONTOS));
 
     /* Inicializa envios LoRaWAN */
-    init_envios_lorawan();
+    ESP_ERROR_CHECK(inicializacao_dispara("init_envios", init_envios_lorawan,
+                                          EVENTO_NVS_PRONTA | EVENTO_LORAWAN_PRONTO | EVENTO_CONTADORES_PRONTOS,
+                                          EVENTO_ENVIOS_LORAWAN_PRONTOS));
 }
@@ -0,0 +1,253 @@
+/* Módulo: métricas da comunicação com o módulo LoRaWAN
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado no computador (ver Ferramentas/decodifica_metricas_lorawan).
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include "metricas_lorawan.h"
+
+/* Definição - assinatura que indica métricas válidas na memória RTC */
+#define ASSINATURA_METRICAS_LORAWAN   0x4D4C5731  // "MLW1"
+
+/* Limites superiores (ms) das faixas de latência (a última faixa não tem limite) */
+static const uint32_t limites_faixas_ms[METRICAS_LORAWAN_QTDE_FAIXAS - 1] = {20, 50, 100, 200, 500, 1000, 2000};
+
+/* Funções locais */
+static void escreve_uint16_saturado(uint8_t * pt_destino, uint32_t valor);
+static void escreve_uint32(uint8_t * pt_destino, uint32_t valor);
+
+/* Função: inicializa métricas. Se as métricas contidas na memória forem
+ *         válidas (ex: preservadas em memória RTC durante deep sleep), seu
+ *         conteúdo é mantido. Caso contrário, são zeradas.
+ * Parâmetros: ponteiro para as métricas
+ * Retorno: nenhum
+ */
+void metricas_lorawan_inicializa(TMetricas_lorawan * pt_metricas)
+{
+    if (pt_metricas->assinatura == ASSINATURA_METRICAS_LORAWAN)
+    {
+        return;
+    }
+
+    metricas_lorawan_zera(pt_metricas);
+}
+
+/* Função: zera métricas
+ * Parâmetros: ponteiro para as métricas
+ * Retorno: nenhum
+ */
+void metricas_lorawan_zera(TMetricas_lorawan * pt_metricas)
+{
+    memset(pt_metricas, 0x00, sizeof(TMetricas_lorawan));
+    pt_metricas->assinatura = ASSINATURA_METRICAS_LORAWAN;
+}
+
+/* Função: obtém o tipo de um comando AT (para escolha do histograma)
+ * Parâmetros: - ponteiro para o comando
+ *             - tamanho do comando
+ * Retorno: tipo do comando (METRICAS_LORAWAN_CMD_...)
+ */
+int metricas_lorawan_tipo_comando(const char * pt_cmd, int tamanho)
+{
+    int i;
+
+    /* Ignora terminadores de linha no fim do comando */
+    while ( (tamanho > 0) && ((pt_cmd[tamanho - 1] == '\r') || (pt_cmd[tamanho - 1] == '\n')) )
+    {
+        tamanho--;
+    }
+
+    if ( (tamanho < 4) || (strncmp(pt_cmd, "AT+", 3) != 0) )
+    {
+        return METRICAS_LORAWAN_CMD_OUTROS;
+    }
+
+    if (pt_cmd[tamanho - 1] == '?')
+    {
+        return METRICAS_LORAWAN_CMD_CONSULTA;
+    }
+
+    if ( (tamanho >= 7) && (strncmp(&pt_cmd[3], "SEND", 4) == 0) )
+    {
+        return METRICAS_LORAWAN_CMD_ENVIO;
+    }
+
+    if ( (tamanho >= 7) && (strncmp(&pt_cmd[3], "JOIN", 4) == 0) )
+    {
+        return METRICAS_LORAWAN_CMD_JOIN;
+    }
+
+    for (i = 3; i < tamanho; i++)
+    {
+        if (pt_cmd[i] == '=')
+        {
+            return METRICAS_LORAWAN_CMD_CONFIGURACAO;
+        }
+    }
+
+    return METRICAS_LORAWAN_CMD_OUTROS;
+}
+
+/* Função: obtém a faixa do histograma correspondente a uma latência
+ * Parâmetros: latência (ms)
+ * Retorno: índice da faixa (0 a METRICAS_LORAWAN_QTDE_FAIXAS - 1)
+ */
+int metricas_lorawan_faixa_latencia(uint32_t latencia_ms)
+{
+    int faixa = 0;
+
+    while ( (faixa < (METRICAS_LORAWAN_QTDE_FAIXAS - 1)) && (latencia_ms > limites_faixas_ms[faixa]) )
+    {
+        faixa++;
+    }
+
+    return faixa;
+}
+
+/* Função: registra o resultado e a latência de um comando AT
+ * Parâmetros: - ponteiro para as métricas
+ *             - tipo do comando (METRICAS_LORAWAN_CMD_...)
+ *             - resultado do comando (METRICAS_LORAWAN_RESULTADO_...)
+ *             - latência, do envio do comando ao resultado final (ms)
+ * Retorno: nenhum
+ */
+void metricas_lorawan_registra_comando(TMetricas_lorawan * pt_metricas, int tipo_cmd, int resultado, uint32_t latencia_ms)
+{
+    uint16_t * pt_contagem;
+
+    if ( (tipo_cmd < 0) || (tipo_cmd >= METRICAS_LORAWAN_QTDE_TIPOS_CMD) )
+    {
+        tipo_cmd = METRICAS_LORAWAN_CMD_OUTROS;
+    }
+
+    pt_metricas->total_comandos++;
+
+    switch (resultado)
+    {
+        case METRICAS_LORAWAN_RESULTADO_OK:
+            pt_metricas->total_ok++;
+            break;
+
+        case METRICAS_LORAWAN_RESULTADO_BUSY:
+            pt_metricas->total_busy++;
+            break;
+
+        case METRICAS_LORAWAN_RESULTADO_TIMEOUT:
+            /* Sem resposta: latência não é conhecida, não entra no histograma */
+            pt_metricas->total_timeouts++;
+            return;
+
+        default:
+            pt_metricas->total_erros++;
+            break;
+    }
+
+    pt_contagem = &pt_metricas->histograma[tipo_cmd][metricas_lorawan_faixa_latencia(latencia_ms)];
+
+    if (*pt_contagem < 0xFFFF)
+    {
+        (*pt_contagem)++;
+    }
+
+    if (latencia_ms > pt_metricas->latencia_max_ms[tipo_cmd])
+    {
+        pt_metricas->latencia_max_ms[tipo_cmd] = latencia_ms;
+    }
+}
+
+/* Função: gera snapshot binário das métricas (formato descrito no header)
+ * Parâmetros: - ponteiro para as métricas
+ *             - ponteiro para o buffer do snapshot
+ *             - tamanho do buffer (METRICAS_LORAWAN_TAM_MAX_SNAPSHOT sempre basta)
+ * Retorno: tamanho do snapshot gerado (0 se o buffer não comporta nem o cabeçalho).
+ *          Histogramas que não cabem no buffer são omitidos (e retirados da máscara).
+ */
+int metricas_lorawan_gera_snapshot(TMetricas_lorawan * pt_metricas, uint8_t * pt_snapshot, int tam_max_snapshot)
+{
+    uint32_t contagem = 0;
+    uint8_t mascara = 0;
+    int tam_snapshot = METRICAS_LORAWAN_TAM_CABECALHO_SNAPSHOT;
+    int tipo;
+    int faixa;
+
+    if (tam_max_snapshot < METRICAS_LORAWAN_TAM_CABECALHO_SNAPSHOT)
+    {
+        return 0;
+    }
+
+    pt_snapshot[0] = METRICAS_LORAWAN_VERSAO_SNAPSHOT;
+    escreve_uint16_saturado(&pt_snapshot[2], pt_metricas->total_comandos);
+    escreve_uint16_saturado(&pt_snapshot[4], pt_metricas->total_ok);
+    escreve_uint16_saturado(&pt_snapshot[6], pt_metricas->total_erros);
+    escreve_uint16_saturado(&pt_snapshot[8], pt_metricas->total_busy);
+    escreve_uint16_saturado(&pt_snapshot[10], pt_metricas->total_timeouts);
+    escreve_uint16_saturado(&pt_snapshot[12], pt_metricas->total_overflows_uart);
+    escreve_uint32(&pt_snapshot[14], pt_metricas->bytes_escritos_uart);
+    escreve_uint32(&pt_snapshot[18], pt_metricas->bytes_lidos_uart);
+
+    for (tipo = 0; tipo < METRICAS_LORAWAN_QTDE_TIPOS_CMD; tipo++)
+    {
+        if (tam_snapshot + METRICAS_LORAWAN_QTDE_FAIXAS > tam_max_snapshot)
+        {
+            break;
+        }
+
+        if (pt_metricas->latencia_max_ms[tipo] == 0)
+        {
+            /* Verifica se há comandos (latência 0 ms ainda conta) */
+            contagem = 0;
+            for (faixa = 0; faixa < METRICAS_LORAWAN_QTDE_FAIXAS; faixa++)
+            {
+                contagem += pt_metricas->histograma[tipo][faixa];
+            }
+
+            if (contagem == 0)
+            {
+                continue;
+            }
+        }
+
+        mascara |= (1 << tipo);
+
+        for (faixa = 0; faixa < METRICAS_LORAWAN_QTDE_FAIXAS; faixa++)
+        {
+            contagem = pt_metricas->histograma[tipo][faixa];
+            pt_snapshot[tam_snapshot++] = (contagem > 0xFF) ? 0xFF : (uint8_t)contagem;
+        }
+    }
+
+    pt_snapshot[1] = mascara;
+    return tam_snapshot;
+}
+
+/* Função: escreve valor como uint16 little-endian, saturado em 0xFFFF
+ * Parâmetros: - ponteiro para o destino
+ *             - valor
+ * Retorno: nenhum
+ */
+static void escreve_uint16_saturado(uint8_t * pt_destino, uint32_t valor)
+{
+    if (valor > 0xFFFF)
+    {
+        valor = 0xFFFF;
+    }
+
+    pt_destino[0] = (uint8_t)(valor & 0xFF);
+    pt_destino[1] = (uint8_t)(valor >> 8);
+}
+
+/* Função: escreve valor como uint32 little-endian
+ * Parâmetros: - ponteiro para o destino
+ *             - valor
+ * Retorno: nenhum
+ */
+static void escreve_uint32(uint8_t * pt_destino, uint32_t valor)
+{
+    pt_destino[0] = (uint8_t)(valor & 0xFF);
+    pt_destino[1] = (uint8_t)((valor >> 8) & 0xFF);
+    pt_destino[2] = (uint8_t)((valor >> 16) & 0xFF);
+    pt_destino[3] = (uint8_t)(valor >> 24);
+}
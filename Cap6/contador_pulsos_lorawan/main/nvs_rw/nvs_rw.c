@@ -26,6 +26,12 @@
 /* Definições - semaforo */
 #define TEMPO_PARA_OBTER_SEMAFORO_NVS (TickType_t)1
 
+/* Definição - espera pelo semáforo na leitura e gravação de blobs: a leitura
+ *             da sessão LoRaWAN decide se um join é necessário, e não deve
+ *             falhar só porque um contador está sendo gravado ao mesmo tempo
+ */
+#define TEMPO_PARA_OBTER_SEMAFORO_NVS_BLOB (100 / portTICK_PERIOD_MS)
+
 /* Variáveis estáticas */
 static SemaphoreHandle_t semaforo_nvs;
 
@@ -165,6 +171,110 @@ FINALIZA_LEITURA:
     return ret;
 }
 
+/* Função: grava um blob (estrutura) na NVS
+ * Parâmetros: - ponteiro para key do dado a ser salvo
+ *             - ponteiro para o dado e seu tamanho (bytes)
+ * Retorno: ESP_OK: blob gravado com sucesso
+ *          !ESP_OK: falha ao gravar blob
+ */
+esp_err_t grava_blob_nvs(char *pt_key, const void * pt_dados, size_t tamanho)
+{
+    esp_err_t ret = ESP_FAIL;
+    nvs_handle handler_particao_nvs;
+
+    if (xSemaphoreTake(semaforo_nvs, TEMPO_PARA_OBTER_SEMAFORO_NVS_BLOB) != pdTRUE)
+    {
+        ESP_LOGE(NVS_TAG, "Erro: semaforo ocupado");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if ((pt_key == NULL) || (pt_dados == NULL))
+    {
+        ESP_LOGE(NVS_TAG, "Erro: ponteiro para key ou para o blob eh nulo");
+        ret = ESP_FAIL;
+        goto FINALIZA_GRAVACAO_BLOB;
+    }
+
+    ret = nvs_open(NAMESPACE_NVS, NVS_READWRITE, &handler_particao_nvs);
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(NVS_TAG, "Falha ao abrir particao NVS");
+        goto FINALIZA_GRAVACAO_BLOB;
+    }
+
+    ret = nvs_set_blob(handler_particao_nvs, pt_key, pt_dados, tamanho);
+
+    if (ret == ESP_OK)
+    {
+        ret = nvs_commit(handler_particao_nvs);
+    }
+
+    nvs_close(handler_particao_nvs);
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(NVS_TAG, "Falha ao salvar blob %s na particao NVS", pt_key);
+    }
+
+FINALIZA_GRAVACAO_BLOB:
+    xSemaphoreGive(semaforo_nvs);
+    return ret;
+}
+
+/* Função: faz a leitura de um blob (estrutura) da NVS
+ * Parâmetros: - ponteiro para key do dado a ser lido
+ *             - ponteiro para o dado e seu tamanho esperado (bytes)
+ * Retorno: ESP_OK: blob lido com sucesso
+ *          ESP_ERR_NVS_NOT_FOUND: blob nunca gravado
+ *          ESP_ERR_INVALID_SIZE: blob gravado com outro tamanho
+ *          demais: falha ao ler blob
+ */
+esp_err_t le_blob_nvs(char *pt_key, void * pt_dados, size_t tamanho)
+{
+    esp_err_t ret = ESP_FAIL;
+    nvs_handle handler_particao_nvs;
+    size_t tamanho_lido = tamanho;
+
+    if (xSemaphoreTake(semaforo_nvs, TEMPO_PARA_OBTER_SEMAFORO_NVS_BLOB) != pdTRUE)
+    {
+        ESP_LOGE(NVS_TAG, "Erro: semaforo ocupado");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if ((pt_key == NULL) || (pt_dados == NULL))
+    {
+        ESP_LOGE(NVS_TAG, "Erro: ponteiro para key ou para o blob eh nulo");
+        ret = ESP_FAIL;
+        goto FINALIZA_LEITURA_BLOB;
+    }
+
+    ret = nvs_open(NAMESPACE_NVS, NVS_READWRITE, &handler_particao_nvs);
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(NVS_TAG, "Falha ao abrir particao NVS");
+        goto FINALIZA_LEITURA_BLOB;
+    }
+
+    ret = nvs_get_blob(handler_particao_nvs, pt_key, pt_dados, &tamanho_lido);
+    nvs_close(handler_particao_nvs);
+
+    if ((ret == ESP_OK) && (tamanho_lido != tamanho))
+    {
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGI(NVS_TAG, "Blob %s nao lido da particao NVS (%s)", pt_key, esp_err_to_name(ret));
+    }
+
+FINALIZA_LEITURA_BLOB:
+    xSemaphoreGive(semaforo_nvs);
+    return ret;
+}
+
 /* Função: limpa a NVS (deleta todos os dados salvos nela)
  * Parâmetros: nenhum
  * Retorno: ESP_OK: dado lido com sucesso
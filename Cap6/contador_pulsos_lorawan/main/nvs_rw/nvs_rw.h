@@ -10,8 +10,11 @@
 #define CHAVE_NVS_CONTADOR_1         "c1"
 #define CHAVE_NVS_CONTADOR_2         "c2"
 
-/* Definição - numero de envios que força a gravação do contador na NVS */
-#define NUM_ENVIOS_PARA_GRAVAR_CONTADORES_NVS          10
+/* Chave da sessão LoRaWAN (OTAA, ver sessao_lorawan) */
+#define CHAVE_NVS_SESSAO_LORAWAN     "sessao_lw"
+
+/* Definição - intervalo de gravação dos contadores na NVS (independente dos envios) */
+#define TEMPO_INTERVALO_GRAVACAO_CONTADORES_NVS_MS     150000 //ms
 
 #endif
 
@@ -19,4 +22,6 @@
 void init_nvs(void);
 esp_err_t grava_valor_contador_nvs(char *pt_key, uint32_t valor);
 esp_err_t le_valor_contador_nvs(char *pt_key, uint32_t * pt_valor);
+esp_err_t grava_blob_nvs(char *pt_key, const void * pt_dados, size_t tamanho);
+esp_err_t le_blob_nvs(char *pt_key, void * pt_dados, size_t tamanho);
 esp_err_t limpa_nvs(void);
\ No newline at end of file
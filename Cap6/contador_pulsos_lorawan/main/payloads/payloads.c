@@ -0,0 +1,96 @@
+/* Módulo: payloads LoRaWAN - contador de pulsos
+ *
+ * ARQUIVO GERADO por Ferramentas/gera_payloads a partir de payloads.esquema.
+ * Não editar: altere o esquema e gere novamente (make -C Ferramentas payloads).
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também é compilado
+ *      no computador (decoder dos payloads).
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "payloads.h"
+
+/* Funções locais */
+static void decodifica_contadores(const uint8_t * pt_quadro, double * pt_valores);
+
+/* Campos do payload contadores */
+static const TEsquema_campo campos_contadores[] =
+{
+    { "contador_1", "pulsos", 1 },
+    { "contador_2", "pulsos", 1 },
+};
+
+/* Tabela dos payloads (decoder genérico) */
+const TEsquema_payload payloads_cap6[QTDE_PAYLOADS_CAP6] =
+{
+    { "contadores", 12, PAYLOAD_CONTADORES_TAM, 2, campos_contadores, decodifica_contadores, -1 },
+};
+
+/* Função: empacota o payload contadores
+ * Parâmetros: - ponteiro para os valores
+ *             - ponteiro para o quadro (PAYLOAD_CONTADORES_TAM bytes)
+ * Retorno: nenhum
+ */
+void payload_contadores_empacota(const TPayload_contadores * pt_payload, uint8_t * pt_quadro)
+{
+    int64_t bruto;
+
+    memset(pt_quadro, 0, PAYLOAD_CONTADORES_TAM);
+
+    /* contador_1 */
+    bruto = (int64_t)pt_payload->contador_1;
+    pt_quadro[0] |= (uint8_t)((bruto >> 24) & 0xFFU);
+    pt_quadro[1] |= (uint8_t)((bruto >> 16) & 0xFFU);
+    pt_quadro[2] |= (uint8_t)((bruto >> 8) & 0xFFU);
+    pt_quadro[3] |= (uint8_t)(bruto & 0xFFU);
+
+    /* contador_2 */
+    bruto = (int64_t)pt_payload->contador_2;
+    pt_quadro[4] |= (uint8_t)((bruto >> 24) & 0xFFU);
+    pt_quadro[5] |= (uint8_t)((bruto >> 16) & 0xFFU);
+    pt_quadro[6] |= (uint8_t)((bruto >> 8) & 0xFFU);
+    pt_quadro[7] |= (uint8_t)(bruto & 0xFFU);
+}
+
+/* Função: desempacota o payload contadores
+ * Parâmetros: - ponteiro para o quadro (PAYLOAD_CONTADORES_TAM bytes)
+ *             - ponteiro para os valores
+ * Retorno: nenhum
+ */
+void payload_contadores_desempacota(const uint8_t * pt_quadro, TPayload_contadores * pt_payload)
+{
+    uint32_t bruto;
+
+    /* contador_1 */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[0] & 0xFFU) << 24;
+    bruto |= (uint32_t)(pt_quadro[1] & 0xFFU) << 16;
+    bruto |= (uint32_t)(pt_quadro[2] & 0xFFU) << 8;
+    bruto |= (uint32_t)(pt_quadro[3] & 0xFFU);
+    pt_payload->contador_1 = (uint32_t)bruto;
+
+    /* contador_2 */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[4] & 0xFFU) << 24;
+    bruto |= (uint32_t)(pt_quadro[5] & 0xFFU) << 16;
+    bruto |= (uint32_t)(pt_quadro[6] & 0xFFU) << 8;
+    bruto |= (uint32_t)(pt_quadro[7] & 0xFFU);
+    pt_payload->contador_2 = (uint32_t)bruto;
+}
+
+/* Função: decodifica o payload contadores para o decoder genérico
+ * Parâmetros: - ponteiro para o quadro (PAYLOAD_CONTADORES_TAM bytes)
+ *             - ponteiro para os valores (um por campo, NAN se sem valor)
+ * Retorno: nenhum
+ */
+static void decodifica_contadores(const uint8_t * pt_quadro, double * pt_valores)
+{
+    TPayload_contadores payload;
+
+    payload_contadores_desempacota(pt_quadro, &payload);
+    pt_valores[0] = (double)payload.contador_1;
+    pt_valores[1] = (double)payload.contador_2;
+}
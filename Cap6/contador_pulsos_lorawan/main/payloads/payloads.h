@@ -0,0 +1,43 @@
+/* Header file: payloads LoRaWAN - contador de pulsos
+ *
+ * ARQUIVO GERADO por Ferramentas/gera_payloads a partir de payloads.esquema.
+ * Não editar: altere o esquema e gere novamente (make -C Ferramentas payloads).
+ *
+ * Campos em bits, do bit mais significativo de cada byte para o menos
+ * significativo (big-endian). Valor físico = bruto x escala + deslocamento.
+ *
+ * Payload contadores (porta 12, 8 bytes):
+ *   bits   0.. 31: contador_1 (u32, bruto 0..4294967295) pulsos
+ *   bits  32.. 63: contador_2 (u32, bruto 0..4294967295) pulsos
+ */
+
+#ifndef HEADER_PAYLOADS_CAP6
+#define HEADER_PAYLOADS_CAP6
+
+#include <stdint.h>
+#include "esquema_payloads.h"
+
+/* Payload contadores */
+#define PAYLOAD_CONTADORES_PORTA                 12
+#define PAYLOAD_CONTADORES_TAM                   8   //bytes
+#define PAYLOAD_CONTADORES_CONTADOR_1_MAX        4294967295UL
+#define PAYLOAD_CONTADORES_CONTADOR_2_MAX        4294967295UL
+
+typedef struct
+{
+    uint32_t contador_1;  // pulsos
+    uint32_t contador_2;  // pulsos
+}TPayload_contadores;
+
+_Static_assert(PAYLOAD_CONTADORES_TAM <= 11, "payload contadores maior que o maximo do esquema");
+
+/* Tabela dos payloads (decoder genérico) */
+#define QTDE_PAYLOADS_CAP6                       1
+
+extern const TEsquema_payload payloads_cap6[QTDE_PAYLOADS_CAP6];
+
+#endif
+
+/* Protótipos */
+void payload_contadores_empacota(const TPayload_contadores * pt_payload, uint8_t * pt_quadro);
+void payload_contadores_desempacota(const uint8_t * pt_quadro, TPayload_contadores * pt_payload);
@@ -0,0 +1,57 @@
+/* Módulo: lógica de debounce do tamper (orientada a eventos)
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e testado no computador com sequências de bordas injetadas.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "debounce_tamper.h"
+
+/* Função: inicializa o debounce
+ * Parâmetros: - ponteiro para o debounce
+ *             - nível estável inicial do GPIO de tamper
+ * Retorno: nenhum
+ */
+void debounce_tamper_inicializa(TDebounce_tamper * pt_debounce, int nivel_estavel)
+{
+    memset(pt_debounce, 0x00, sizeof(TDebounce_tamper));
+    pt_debounce->nivel_estavel = (nivel_estavel != 0) ? 1 : 0;
+}
+
+/* Função: registra uma borda no GPIO de tamper. Quem chama deve (re)armar
+ *         o timer de debounce, de forma que ele só expire após o tempo de
+ *         debounce sem novas bordas.
+ * Parâmetros: ponteiro para o debounce
+ * Retorno: nenhum
+ */
+void debounce_tamper_registra_borda(TDebounce_tamper * pt_debounce)
+{
+    pt_debounce->qtde_bordas++;
+    pt_debounce->timer_armado = true;
+}
+
+/* Função: trata a expiração do timer de debounce
+ * Parâmetros: - ponteiro para o debounce
+ *             - nível atual do GPIO de tamper
+ * Retorno: evento gerado (EVENTO_TAMPER_...), ou EVENTO_TAMPER_NENHUM se o
+ *          nível não mudou (pulso curto ou trepidação que voltou ao nível estável)
+ */
+int debounce_tamper_expiracao_timer(TDebounce_tamper * pt_debounce, int nivel_atual)
+{
+    pt_debounce->qtde_expiracoes_timer++;
+    pt_debounce->timer_armado = false;
+    nivel_atual = (nivel_atual != 0) ? 1 : 0;
+
+    if (nivel_atual == pt_debounce->nivel_estavel)
+    {
+        return EVENTO_TAMPER_NENHUM;
+    }
+
+    pt_debounce->nivel_estavel = nivel_atual;
+    pt_debounce->qtde_eventos++;
+
+    return (nivel_atual == 1) ? EVENTO_TAMPER_ACIONADO : EVENTO_TAMPER_DESFEITO;
+}
@@ -0,0 +1,41 @@
+/* Header file: lógica de debounce do tamper (orientada a eventos)
+ *
+ * Cada borda no GPIO de tamper (interrupção) rearma um timer one-shot de
+ * debounce. Quando o timer expira (nenhuma borda durante o tempo de
+ * debounce), o nível lido do GPIO é comparado com o último nível estável:
+ * se mudou, é gerado um evento (tamper acionado ou desfeito). Pulsos mais
+ * curtos que o tempo de debounce e trepidações (bounce) não geram eventos.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e testado no computador com sequências de bordas injetadas.
+ */
+
+#ifndef HEADER_DEBOUNCE_TAMPER
+#define HEADER_DEBOUNCE_TAMPER
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definições - eventos de tamper */
+#define EVENTO_TAMPER_NENHUM             0
+#define EVENTO_TAMPER_ACIONADO           1   // nível estável alto
+#define EVENTO_TAMPER_DESFEITO           2   // nível estável baixo
+
+/* Estado do debounce e contadores de execuções (cada borda e cada
+ * expiração do timer corresponde a um "acordar" do software de tamper)
+ */
+typedef struct
+{
+    int nivel_estavel;
+    bool timer_armado;
+    uint32_t qtde_bordas;
+    uint32_t qtde_expiracoes_timer;
+    uint32_t qtde_eventos;
+}TDebounce_tamper;
+
+#endif
+
+/* Protótipos */
+void debounce_tamper_inicializa(TDebounce_tamper * pt_debounce, int nivel_estavel);
+void debounce_tamper_registra_borda(TDebounce_tamper * pt_debounce);
+int debounce_tamper_expiracao_timer(TDebounce_tamper * pt_debounce, int nivel_atual);
@@ -2,14 +2,81 @@
 #include <string.h>
 #include <esp_task_wdt.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/timers.h"
 #include "driver/uart.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
 #include "driver/gpio.h"
 #include "deteccao_tamper.h"
 
 /* Tag de debug */
 static const char* TAG_LOGS_DETECCAO_TAMPER = "DETECCAO_TAMPER";
 
+/* Detecção por interrupção: estado do debounce, timer one-shot e fila de eventos */
+static TDebounce_tamper debounce_tamper;
+static TimerHandle_t timer_debounce_tamper = NULL;
+static QueueHandle_t fila_eventos_tamper = NULL;
+static portMUX_TYPE spinlock_debounce_tamper = portMUX_INITIALIZER_UNLOCKED;
+
+/* Funções locais */
+static void tamper_isr_handler(void* arg);
+static void expiracao_timer_debounce_tamper(TimerHandle_t timer);
+
+/*
+ *  Handler da ISR do GPIO de tamper
+ */
+static void IRAM_ATTR tamper_isr_handler(void* arg)
+{
+    BaseType_t tarefa_acordada = pdFALSE;
+    int nivel = gpio_get_level(GPIO_TAMPER);
+
+    /* Interrupção por nível (única que também acorda do light sleep): passa a
+     * aguardar o nível oposto, de forma que cada interrupção corresponde a uma borda
+     */
+    gpio_wakeup_enable(GPIO_TAMPER, (nivel == 1) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+
+    portENTER_CRITICAL_ISR(&spinlock_debounce_tamper);
+    debounce_tamper_registra_borda(&debounce_tamper);
+    portEXIT_CRITICAL_ISR(&spinlock_debounce_tamper);
+
+    /* Rearma o timer de debounce: só expira após TEMPO_DEBOUNCE_TAMPER sem novas bordas */
+    xTimerResetFromISR(timer_debounce_tamper, &tarefa_acordada);
+
+    if (tarefa_acordada == pdTRUE)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/* Função: callback de expiração do timer de debounce (executada na tarefa de
+ *         timers do FreeRTOS). Se o nível do tamper mudou, gera o evento.
+ * Parâmetros: handle do timer
+ * Retorno: nenhum
+ */
+static void expiracao_timer_debounce_tamper(TimerHandle_t timer)
+{
+    TEvento_tamper evento;
+    int nivel = gpio_get_level(GPIO_TAMPER);
+
+    portENTER_CRITICAL(&spinlock_debounce_tamper);
+    evento.evento = debounce_tamper_expiracao_timer(&debounce_tamper, nivel);
+    portEXIT_CRITICAL(&spinlock_debounce_tamper);
+
+    if (evento.evento == EVENTO_TAMPER_NENHUM)
+    {
+        return;
+    }
+
+    evento.instante_us = esp_timer_get_time();
+
+    if (xQueueSend(fila_eventos_tamper, &evento, 0) != pdPASS)
+    {
+        ESP_LOGW(TAG_LOGS_DETECCAO_TAMPER, "Fila de eventos de tamper cheia. Evento descartado.");
+    }
+}
+
 /* Função: configura tamper
  * Parâmetros: nenhum
  * Retorno: nenhum 
@@ -36,4 +103,115 @@ void configura_tamper(void)
 int le_tamper(void)
 {
     return gpio_get_level(GPIO_TAMPER);
-}
\ No newline at end of file
+}
+
+/* Função: configura detecção de tamper por interrupção, com debounce por timer
+ * Parâmetros: nível estável do tamper antes desta configuração (ex: antes do
+ *             deep sleep). Se o nível atual for diferente (ex: wake-up pelo
+ *             tamper), o debounce começa imediatamente e, se o nível se
+ *             mantiver, o evento correspondente é gerado.
+ * Retorno: ESP_OK: detecção configurada
+ *          ESP_ERR_NO_MEM: falha ao criar fila ou timer
+ *          demais: erro ao configurar GPIO / ISR
+ */
+esp_err_t configura_tamper_por_interrupcao(int nivel_anterior)
+{
+    gpio_config_t io_conf_tamper = {};
+    esp_err_t status;
+    int nivel_atual;
+
+    ESP_LOGI(TAG_LOGS_DETECCAO_TAMPER, "Configurando tamper por interrupcao...");
+
+    if (fila_eventos_tamper == NULL)
+    {
+        fila_eventos_tamper = xQueueCreate(TAM_FILA_EVENTOS_TAMPER, sizeof(TEvento_tamper));
+    }
+
+    if (timer_debounce_tamper == NULL)
+    {
+        timer_debounce_tamper = xTimerCreate("debounce_tamper", pdMS_TO_TICKS(TEMPO_DEBOUNCE_TAMPER),
+                                             pdFALSE, NULL, expiracao_timer_debounce_tamper);
+    }
+
+    if ( (fila_eventos_tamper == NULL) || (timer_debounce_tamper == NULL) )
+    {
+        ESP_LOGE(TAG_LOGS_DETECCAO_TAMPER, "Falha ao criar fila / timer do tamper");
+        return ESP_ERR_NO_MEM;
+    }
+
+    debounce_tamper_inicializa(&debounce_tamper, nivel_anterior);
+
+    /* GPIO como entrada. A interrupção é por nível, configurada abaixo */
+    io_conf_tamper.intr_type = GPIO_INTR_DISABLE;
+    io_conf_tamper.mode = GPIO_MODE_INPUT;
+    io_conf_tamper.pin_bit_mask = (1ULL<<GPIO_TAMPER);
+    io_conf_tamper.pull_down_en = 0;
+    io_conf_tamper.pull_up_en = 0;
+    status = gpio_config(&io_conf_tamper);
+
+    if (status != ESP_OK)
+    {
+        return status;
+    }
+
+    nivel_atual = gpio_get_level(GPIO_TAMPER);
+    gpio_wakeup_enable(GPIO_TAMPER, (nivel_atual == 1) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+
+    /* O serviço de ISR de GPIO pode já ter sido instalado por outro módulo */
+    status = gpio_install_isr_service(0);
+
+    if ( (status != ESP_OK) && (status != ESP_ERR_INVALID_STATE) )
+    {
+        return status;
+    }
+
+    status = gpio_isr_handler_add(GPIO_TAMPER, tamper_isr_handler, NULL);
+
+    if (status != ESP_OK)
+    {
+        return status;
+    }
+
+    /* Nível mudou em relação ao anterior (ex: acordou pelo tamper): equivale a uma borda */
+    if (nivel_atual != debounce_tamper.nivel_estavel)
+    {
+        portENTER_CRITICAL(&spinlock_debounce_tamper);
+        debounce_tamper_registra_borda(&debounce_tamper);
+        portEXIT_CRITICAL(&spinlock_debounce_tamper);
+        xTimerReset(timer_debounce_tamper, 0);
+    }
+
+    gpio_intr_enable(GPIO_TAMPER);
+    ESP_LOGI(TAG_LOGS_DETECCAO_TAMPER, "Tamper por interrupcao configurado");
+
+    return ESP_OK;
+}
+
+/* Função: aguarda um evento de tamper (após debounce)
+ * Parâmetros: - ponteiro para o evento recebido
+ *             - tempo máximo de espera (ticks)
+ * Retorno: true: evento recebido
+ *          false: nenhum evento dentro do tempo máximo
+ */
+bool aguarda_evento_tamper(TEvento_tamper * pt_evento, TickType_t tempo_max)
+{
+    if (fila_eventos_tamper == NULL)
+    {
+        return false;
+    }
+
+    return (xQueueReceive(fila_eventos_tamper, pt_evento, tempo_max) == pdTRUE);
+}
+
+/* Função: obtém os contadores da detecção por interrupção (bordas,
+ *         expirações do timer de debounce e eventos gerados)
+ * Parâmetros: ponteiro para a cópia dos contadores
+ * Retorno: nenhum
+ */
+void obtem_contadores_tamper(TDebounce_tamper * pt_contadores)
+{
+    portENTER_CRITICAL(&spinlock_debounce_tamper);
+    *pt_contadores = debounce_tamper;
+    portEXIT_CRITICAL(&spinlock_debounce_tamper);
+}
@@ -1,16 +1,43 @@
-/* Header file do módulo de detecção de tamper */
+/* Header file do módulo de detecção de tamper
+ *
+ * Além da leitura direta do GPIO de tamper (le_tamper()), o módulo oferece
+ * detecção por interrupção: cada mudança de nível do GPIO rearma um timer
+ * one-shot de debounce (ver debounce_tamper) e, se o novo nível se mantiver,
+ * um evento (tamper acionado / desfeito) é colocado numa fila, consumida
+ * com aguarda_evento_tamper(). Nenhuma tarefa precisa fazer polling do GPIO
+ * e a interrupção também acorda o ESP32 do light sleep.
+ */
 
 #ifndef DETECCAO_TAMPER_DEFS_H
 #define DETECCAO_TAMPER_DEFS_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "debounce_tamper.h"
+
 /* Definição -  GPIO que gera tamper */
 #define GPIO_TAMPER                      GPIO_NUM_34
 
 /* Definição - tempo para fazer debounce do GPIO de tamper */
 #define TEMPO_DEBOUNCE_TAMPER            200 //ms
 
+/* Definição - tamanho da fila de eventos de tamper */
+#define TAM_FILA_EVENTOS_TAMPER          4
+
+/* Evento de tamper (após debounce) */
+typedef struct
+{
+    int evento;          // EVENTO_TAMPER_ACIONADO ou EVENTO_TAMPER_DESFEITO
+    int64_t instante_us; // instante do evento (esp_timer_get_time())
+}TEvento_tamper;
+
 #endif
 
 /* Prototipos */
 void configura_tamper(void);
-int le_tamper(void);
\ No newline at end of file
+int le_tamper(void);
+esp_err_t configura_tamper_por_interrupcao(int nivel_anterior);
+bool aguarda_evento_tamper(TEvento_tamper * pt_evento, TickType_t tempo_max);
+void obtem_contadores_tamper(TDebounce_tamper * pt_contadores);
@@ -0,0 +1,182 @@
+/* Módulo: fase dos uplinks (espalhamento dos envios periódicos da frota)
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "fase_uplinks.h"
+
+/* Definição - bytes do DevAddr */
+#define TAM_DEV_ADDR       4
+
+/* Funções locais */
+static uint32_t espalha_bits(uint32_t valor);
+static uint32_t sorteia_jitter_ms(TFase_uplinks * pt_fase);
+
+/* Função: espalha os bits de um valor (finalizador do MurmurHash3): DevAddrs
+ *         consecutivos resultam em fases sem relação entre si
+ * Parâmetros: valor
+ * Retorno: valor espalhado
+ */
+static uint32_t espalha_bits(uint32_t valor)
+{
+    valor ^= valor >> 16;
+    valor *= 0x85EBCA6B;
+    valor ^= valor >> 13;
+    valor *= 0xC2B2AE35;
+    valor ^= valor >> 16;
+    return valor;
+}
+
+/* Função: sorteia o jitter de um ciclo (xorshift32)
+ * Parâmetros: ponteiro para a fase
+ * Retorno: jitter (0 a jitter máximo - 1, em ms)
+ */
+static uint32_t sorteia_jitter_ms(TFase_uplinks * pt_fase)
+{
+    if (pt_fase->jitter_max_ms == 0)
+    {
+        return 0;
+    }
+
+    pt_fase->estado_aleatorio ^= pt_fase->estado_aleatorio << 13;
+    pt_fase->estado_aleatorio ^= pt_fase->estado_aleatorio >> 17;
+    pt_fase->estado_aleatorio ^= pt_fase->estado_aleatorio << 5;
+    return pt_fase->estado_aleatorio % pt_fase->jitter_max_ms;
+}
+
+/* Função: converte o DevAddr do formato dos comandos AT ("26:0B:12:34") para número
+ * Parâmetros: - texto do DevAddr
+ *             - ponteiro para o DevAddr
+ * Retorno: true: convertido; false: texto inválido
+ */
+bool fase_uplinks_le_dev_addr(const char * pt_texto, uint32_t * pt_dev_addr)
+{
+    uint32_t dev_addr = 0;
+    int qtde_digitos = 0;
+    char caractere;
+
+    for (; *pt_texto != '\0'; pt_texto++)
+    {
+        caractere = *pt_texto;
+
+        if (caractere == ':')
+        {
+            continue;
+        }
+
+        if ((caractere >= '0') && (caractere <= '9'))
+        {
+            dev_addr = (dev_addr << 4) | (uint32_t)(caractere - '0');
+        }
+        else if ((caractere >= 'A') && (caractere <= 'F'))
+        {
+            dev_addr = (dev_addr << 4) | (uint32_t)(caractere - 'A' + 10);
+        }
+        else if ((caractere >= 'a') && (caractere <= 'f'))
+        {
+            dev_addr = (dev_addr << 4) | (uint32_t)(caractere - 'a' + 10);
+        }
+        else
+        {
+            return false;
+        }
+
+        qtde_digitos++;
+    }
+
+    if (qtde_digitos != (2 * TAM_DEV_ADDR))
+    {
+        return false;
+    }
+
+    *pt_dev_addr = dev_addr;
+    return true;
+}
+
+/* Função: calcula a fase estável de um dispositivo
+ * Parâmetros: - DevAddr
+ *             - período dos envios (ms)
+ * Retorno: fase (0 a período - 1, em ms)
+ */
+uint32_t fase_uplinks_deslocamento_ms(uint32_t dev_addr, uint32_t periodo_ms)
+{
+    if (periodo_ms == 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t)(((uint64_t)espalha_bits(dev_addr) * periodo_ms) >> 32);
+}
+
+/* Função: inicializa a fase dos uplinks. O primeiro envio é feito no primeiro
+ *         ciclo da grade (referência + fase), com jitter.
+ * Parâmetros: - ponteiro para a fase
+ *             - DevAddr
+ *             - período dos envios (ms)
+ *             - jitter máximo de cada ciclo (ms)
+ *             - semente do sorteio do jitter (ex: número aleatório do hardware)
+ *             - instante de referência da grade (ms)
+ * Retorno: nenhum
+ */
+void fase_uplinks_inicializa(TFase_uplinks * pt_fase, uint32_t dev_addr, uint32_t periodo_ms, uint32_t jitter_max_ms, uint32_t semente,
+                             int64_t instante_referencia_ms)
+{
+    memset(pt_fase, 0x00, sizeof(TFase_uplinks));
+    pt_fase->periodo_ms = (periodo_ms > 0) ? periodo_ms : 1;
+    pt_fase->jitter_max_ms = jitter_max_ms;
+    pt_fase->deslocamento_ms = fase_uplinks_deslocamento_ms(dev_addr, pt_fase->periodo_ms);
+
+    /* xorshift32 não pode ter estado nulo */
+    pt_fase->estado_aleatorio = espalha_bits(semente ^ dev_addr);
+    if (pt_fase->estado_aleatorio == 0)
+    {
+        pt_fase->estado_aleatorio = 1;
+    }
+
+    pt_fase->instante_ciclo_ms = instante_referencia_ms + pt_fase->deslocamento_ms;
+    pt_fase->instante_envio_ms = pt_fase->instante_ciclo_ms + sorteia_jitter_ms(pt_fase);
+}
+
+/* Função: verifica se o envio do ciclo atual já pode ser feito
+ * Parâmetros: - ponteiro para a fase
+ *             - instante atual (ms)
+ * Retorno: true: envio liberado; false: aguardar
+ */
+bool fase_uplinks_envio_liberado(const TFase_uplinks * pt_fase, int64_t instante_atual_ms)
+{
+    return (instante_atual_ms >= pt_fase->instante_envio_ms);
+}
+
+/* Função: calcula quanto tempo falta para o envio do ciclo atual
+ * Parâmetros: - ponteiro para a fase
+ *             - instante atual (ms)
+ * Retorno: tempo até o envio (ms). 0 = envio liberado.
+ */
+int64_t fase_uplinks_tempo_ate_envio_ms(const TFase_uplinks * pt_fase, int64_t instante_atual_ms)
+{
+    return (instante_atual_ms >= pt_fase->instante_envio_ms) ? 0 : (pt_fase->instante_envio_ms - instante_atual_ms);
+}
+
+/* Função: passa para o próximo ciclo da grade posterior ao instante atual
+ *         (ciclos perdidos, ex: envio demorado, são pulados) e sorteia o jitter dele
+ * Parâmetros: - ponteiro para a fase
+ *             - instante atual (ms)
+ * Retorno: nenhum
+ */
+void fase_uplinks_avanca(TFase_uplinks * pt_fase, int64_t instante_atual_ms)
+{
+    int64_t qtde_ciclos = 1;
+
+    if (instante_atual_ms >= pt_fase->instante_ciclo_ms)
+    {
+        qtde_ciclos = ((instante_atual_ms - pt_fase->instante_ciclo_ms) / pt_fase->periodo_ms) + 1;
+    }
+
+    pt_fase->instante_ciclo_ms += qtde_ciclos * pt_fase->periodo_ms;
+    pt_fase->instante_envio_ms = pt_fase->instante_ciclo_ms + sorteia_jitter_ms(pt_fase);
+}
@@ -0,0 +1,238 @@
+/* Módulo: fila de uplinks pendentes (store-and-forward)
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador (ver Ferramentas/simula_fila_uplinks).
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include "fila_uplinks.h"
+
+/* Definição - assinatura que indica fila válida na memória RTC */
+#define ASSINATURA_FILA_UPLINKS      0x46554C31  // "FUL1"
+
+/* Definição - idade máxima (em minutos) representável num quadro agrupado */
+#define IDADE_MAX_REGISTRO_MIN       0xFFFF
+
+/* Funções locais */
+static uint32_t calcula_checksum_fila(TFila_uplinks * pt_fila);
+static TRegistro_uplink * obtem_registro(TFila_uplinks * pt_fila, int posicao);
+
+/* Função: calcula checksum da fila (para validar conteúdo mantido em memória RTC)
+ * Parâmetros: ponteiro para a fila
+ * Retorno: checksum calculado
+ */
+static uint32_t calcula_checksum_fila(TFila_uplinks * pt_fila)
+{
+    const uint8_t * pt_byte = (const uint8_t *)pt_fila;
+    uint32_t checksum = 0x811C9DC5;
+    int i;
+
+    /* FNV-1a sobre toda a estrutura, exceto o próprio campo de checksum */
+    for (i = 0; i < (int)offsetof(TFila_uplinks, checksum); i++)
+    {
+        checksum = (checksum ^ pt_byte[i]) * 0x01000193;
+    }
+
+    return checksum;
+}
+
+/* Função: obtém registro de uma posição da fila (0 = mais antigo)
+ * Parâmetros: - ponteiro para a fila
+ *             - posição do registro
+ * Retorno: ponteiro para o registro
+ */
+static TRegistro_uplink * obtem_registro(TFila_uplinks * pt_fila, int posicao)
+{
+    return &pt_fila->registros[(pt_fila->idx_inicio + posicao) % FILA_UPLINKS_QTDE_MAX_REGISTROS];
+}
+
+/* Função: inicializa fila de uplinks. Se a fila contida na memória for
+ *         válida (ex: preservada em memória RTC durante deep sleep ou reset),
+ *         seu conteúdo é mantido. Caso contrário, a fila é zerada.
+ * Parâmetros: ponteiro para a fila
+ * Retorno: nenhum
+ */
+void fila_uplinks_inicializa(TFila_uplinks * pt_fila)
+{
+    if ( (pt_fila->assinatura == ASSINATURA_FILA_UPLINKS) &&
+         (pt_fila->qtde <= FILA_UPLINKS_QTDE_MAX_REGISTROS) &&
+         (pt_fila->idx_inicio < FILA_UPLINKS_QTDE_MAX_REGISTROS) &&
+         (pt_fila->checksum == calcula_checksum_fila(pt_fila)) )
+    {
+        return;
+    }
+
+    memset(pt_fila, 0x00, sizeof(TFila_uplinks));
+    pt_fila->assinatura = ASSINATURA_FILA_UPLINKS;
+    pt_fila->checksum = calcula_checksum_fila(pt_fila);
+}
+
+/* Função: insere registro no fim da fila. Se a fila estiver cheia, o
+ *         registro mais antigo é descartado.
+ * Parâmetros: - ponteiro para a fila
+ *             - ponteiro para os dados do registro
+ *             - tamanho dos dados
+ *             - instante da leitura (em segundos)
+ * Retorno: true: registro mais antigo foi descartado para dar lugar ao novo
+ *          false: não houve descarte
+ */
+bool fila_uplinks_insere(TFila_uplinks * pt_fila, const uint8_t * pt_dados, int tamanho, uint32_t instante_s)
+{
+    TRegistro_uplink * pt_registro;
+    bool houve_descarte = false;
+
+    if (tamanho > FILA_UPLINKS_TAM_MAX_DADOS)
+    {
+        tamanho = FILA_UPLINKS_TAM_MAX_DADOS;
+    }
+
+    /* Política de descarte: com a fila cheia, descarta o registro mais antigo */
+    if (pt_fila->qtde == FILA_UPLINKS_QTDE_MAX_REGISTROS)
+    {
+        pt_fila->idx_inicio = (pt_fila->idx_inicio + 1) % FILA_UPLINKS_QTDE_MAX_REGISTROS;
+        pt_fila->qtde--;
+        pt_fila->total_descartados++;
+        houve_descarte = true;
+    }
+
+    pt_registro = obtem_registro(pt_fila, pt_fila->qtde);
+    memset(pt_registro, 0x00, sizeof(TRegistro_uplink));
+    pt_registro->instante_s = instante_s;
+    pt_registro->seq = pt_fila->proximo_seq;
+    pt_registro->tamanho = (uint8_t)tamanho;
+    memcpy(pt_registro->dados, pt_dados, tamanho);
+
+    pt_fila->proximo_seq++;
+    pt_fila->qtde++;
+    pt_fila->total_inseridos++;
+    pt_fila->checksum = calcula_checksum_fila(pt_fila);
+
+    return houve_descarte;
+}
+
+/* Função: monta o próximo quadro a ser enviado, a partir dos registros mais
+ *         antigos da fila. Os registros só são removidos da fila após a
+ *         chamada de fila_uplinks_confirma_envio().
+ * Parâmetros: - ponteiro para a fila
+ *             - instante atual (em segundos)
+ *             - ponteiro para o buffer do quadro
+ *             - tamanho máximo do quadro (payload máximo do DR em uso)
+ *             - ponteiro para variável que receberá a quantidade de registros
+ *               contidos no quadro
+ * Retorno: tamanho do quadro montado (0 se não há nada a enviar ou se nem
+ *          um registro cabe no tamanho máximo informado)
+ */
+int fila_uplinks_monta_quadro(TFila_uplinks * pt_fila, uint32_t instante_atual_s, uint8_t * pt_quadro, int tam_max_quadro, int * pt_qtde_registros)
+{
+    TRegistro_uplink * pt_registro;
+    uint32_t idade_min = 0;
+    int tam_quadro = 0;
+    int qtde_registros = 0;
+
+    *pt_qtde_registros = 0;
+
+    if (pt_fila->qtde == 0)
+    {
+        return 0;
+    }
+
+    pt_registro = obtem_registro(pt_fila, 0);
+
+    /* Registro único e recente, ou quadro agrupado em que não cabe um segundo
+       registro: vai no formato original, sem cabeçalho (o cabeçalho só
+       custaria bytes, sem agrupar nada) */
+    if ( (pt_registro->tamanho <= tam_max_quadro) &&
+         ( ((pt_fila->qtde == 1) && (instante_atual_s - pt_registro->instante_s < 60)) ||
+           ((FILA_UPLINKS_TAM_CABECALHO_QUADRO + 2 * (FILA_UPLINKS_TAM_IDADE_REGISTRO + pt_registro->tamanho)) > tam_max_quadro) ) )
+    {
+        memcpy(pt_quadro, pt_registro->dados, pt_registro->tamanho);
+        *pt_qtde_registros = 1;
+        return pt_registro->tamanho;
+    }
+
+    /* Quadro agrupado: cabeçalho + (idade + dados) de quantos registros couberem */
+    pt_quadro[0] = (uint8_t)(pt_registro->seq & 0xFF);
+    tam_quadro = FILA_UPLINKS_TAM_CABECALHO_QUADRO;
+
+    while (qtde_registros < pt_fila->qtde)
+    {
+        pt_registro = obtem_registro(pt_fila, qtde_registros);
+
+        if ((tam_quadro + FILA_UPLINKS_TAM_IDADE_REGISTRO + pt_registro->tamanho) > tam_max_quadro)
+        {
+            break;
+        }
+
+        idade_min = 0;
+        if (instante_atual_s > pt_registro->instante_s)
+        {
+            idade_min = (instante_atual_s - pt_registro->instante_s) / 60;
+        }
+
+        if (idade_min > IDADE_MAX_REGISTRO_MIN)
+        {
+            idade_min = IDADE_MAX_REGISTRO_MIN;
+        }
+
+        pt_quadro[tam_quadro++] = (uint8_t)(idade_min & 0xFF);
+        pt_quadro[tam_quadro++] = (uint8_t)(idade_min >> 8);
+        memcpy(&pt_quadro[tam_quadro], pt_registro->dados, pt_registro->tamanho);
+        tam_quadro += pt_registro->tamanho;
+        qtde_registros++;
+    }
+
+    if (qtde_registros == 0)
+    {
+        return 0;
+    }
+
+    *pt_qtde_registros = qtde_registros;
+    return tam_quadro;
+}
+
+/* Função: confirma envio dos registros mais antigos da fila, removendo-os
+ * Parâmetros: - ponteiro para a fila
+ *             - quantidade de registros enviados (retornada por fila_uplinks_monta_quadro())
+ * Retorno: nenhum
+ */
+void fila_uplinks_confirma_envio(TFila_uplinks * pt_fila, int qtde_registros)
+{
+    if (qtde_registros > pt_fila->qtde)
+    {
+        qtde_registros = pt_fila->qtde;
+    }
+
+    pt_fila->idx_inicio = (pt_fila->idx_inicio + qtde_registros) % FILA_UPLINKS_QTDE_MAX_REGISTROS;
+    pt_fila->qtde -= qtde_registros;
+    pt_fila->total_enviados += qtde_registros;
+    pt_fila->checksum = calcula_checksum_fila(pt_fila);
+}
+
+/* Função: retorna a quantidade de registros pendentes na fila
+ * Parâmetros: ponteiro para a fila
+ * Retorno: quantidade de registros pendentes
+ */
+int fila_uplinks_quantidade(TFila_uplinks * pt_fila)
+{
+    return pt_fila->qtde;
+}
+
+/* Função: consulta um registro pendente, sem removê-lo da fila (para
+ *         formatos de quadro próprios de uma aplicação)
+ * Parâmetros: - ponteiro para a fila
+ *             - posição do registro (0 = mais antigo)
+ * Retorno: ponteiro para o registro, ou NULL se a posição não existe
+ */
+const TRegistro_uplink * fila_uplinks_consulta(TFila_uplinks * pt_fila, int posicao)
+{
+    if ((posicao < 0) || (posicao >= pt_fila->qtde))
+    {
+        return NULL;
+    }
+
+    return obtem_registro(pt_fila, posicao);
+}
@@ -0,0 +1,74 @@
+/* Header file: fila de uplinks pendentes (store-and-forward)
+ *
+ * Cada leitura a ser enviada por LoRaWAN é primeiro inserida nesta fila
+ * (buffer circular de tamanho fixo, mantido em memória RTC pela aplicação)
+ * e só é removida dela quando o módulo LoRaWAN aceita o envio. Se a fila
+ * encher, o registro mais antigo é descartado.
+ *
+ * Formatos de quadro gerados por fila_uplinks_monta_quadro():
+ * - Registro único e recente (idade < 1 minuto), ou registro cujo tamanho
+ *   não permite dois registros num quadro agrupado (ex.: contadores do
+ *   capítulo 6 em DR2, 1 + 2*(2 + 8) > 11 bytes): os dados do registro, sem
+ *   cabeçalho (mesmo formato usado antes da fila existir). Nesse caso o
+ *   registro atrasado perde a idade e é tratado pelo decoder como recente.
+ * - Demais casos (registros atrasados e/ou agrupados):
+ *   byte 0: número de sequência (8 bits menos significativos) do registro
+ *           mais antigo do quadro. Os registros seguintes têm números de
+ *           sequência consecutivos.
+ *   para cada registro: idade em minutos (uint16, little-endian) + dados.
+ *   Como todos os registros de uma aplicação têm o mesmo tamanho, o
+ *   tamanho do quadro agrupado (1 + n*(2 + tamanho)) nunca coincide com o
+ *   tamanho do registro único, o que permite ao decoder distinguir os formatos.
+ */
+
+#ifndef HEADER_FILA_UPLINKS
+#define HEADER_FILA_UPLINKS
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definições - dimensões da fila */
+#ifndef FILA_UPLINKS_QTDE_MAX_REGISTROS
+#define FILA_UPLINKS_QTDE_MAX_REGISTROS      32
+#endif
+
+#ifndef FILA_UPLINKS_TAM_MAX_DADOS
+#define FILA_UPLINKS_TAM_MAX_DADOS           8    //bytes
+#endif
+
+/* Definição - tamanho do cabeçalho de um quadro agrupado e de cada registro nele */
+#define FILA_UPLINKS_TAM_CABECALHO_QUADRO    1    //bytes
+#define FILA_UPLINKS_TAM_IDADE_REGISTRO      2    //bytes
+
+/* Estrutura de um registro (uplink pendente) */
+typedef struct
+{
+    uint32_t instante_s;
+    uint16_t seq;
+    uint8_t tamanho;
+    uint8_t dados[FILA_UPLINKS_TAM_MAX_DADOS];
+}TRegistro_uplink;
+
+/* Estrutura da fila de uplinks pendentes */
+typedef struct
+{
+    uint32_t assinatura;
+    uint32_t total_inseridos;
+    uint32_t total_enviados;
+    uint32_t total_descartados;
+    uint16_t proximo_seq;
+    uint8_t idx_inicio;
+    uint8_t qtde;
+    TRegistro_uplink registros[FILA_UPLINKS_QTDE_MAX_REGISTROS];
+    uint32_t checksum;
+}TFila_uplinks;
+
+#endif
+
+/* Protótipos */
+void fila_uplinks_inicializa(TFila_uplinks * pt_fila);
+bool fila_uplinks_insere(TFila_uplinks * pt_fila, const uint8_t * pt_dados, int tamanho, uint32_t instante_s);
+int fila_uplinks_monta_quadro(TFila_uplinks * pt_fila, uint32_t instante_atual_s, uint8_t * pt_quadro, int tam_max_quadro, int * pt_qtde_registros);
+void fila_uplinks_confirma_envio(TFila_uplinks * pt_fila, int qtde_registros);
+int fila_uplinks_quantidade(TFila_uplinks * pt_fila);
+const TRegistro_uplink * fila_uplinks_consulta(TFila_uplinks * pt_fila, int posicao);
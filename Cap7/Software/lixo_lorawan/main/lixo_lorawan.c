@@ -1,27 +1,75 @@
 /* Aplicação de comunicação LoRaWAN e sensores */
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
 #include <esp_task_wdt.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
 #include "driver/uart.h"
 #include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_sleep.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_system.h"
 
 /* Includes dos módulos */
 #include "lorawan/lorawan.h"
 #include "sensor_ultrassonico/sensor_ultrassonico.h"
 #include "deteccao_tamper/deteccao_tamper.h"
+#include "fila_uplinks/fila_uplinks.h"
+#include "log_diferido/log_diferido.h"
+#include "perfil_wakeup/perfil_wakeup.h"
+#include "wake_stub/wake_stub.h"
+#include "lote_leituras/lote_leituras.h"
+#include "sleep_adaptativo/sleep_adaptativo.h"
+#include "fase_uplinks/fase_uplinks.h"
 
-/* Definições - deep sleep */
+/* Definições - deep sleep. O ESP32 acorda pelo timer a cada TEMPO_EM_SLEEP segundos (o
+ * período mínimo do sleep adaptativo); períodos maiores são feitos pelo wake stub, que
+ * volta a dormir sem boot completo nos wake-ups intermediários.
+ */
 #define FATOR_US_PARA_S   (uint64_t )1000000
-#define TEMPO_EM_SLEEP    (uint64_t)1800
+#define TEMPO_EM_SLEEP    (uint64_t)CONFIG_LIXO_PERIODO_SLEEP_MIN_S
+#define PERIODO_SLEEP_MAX (uint64_t)CONFIG_LIXO_PERIODO_SLEEP_MAX_S
+
+/* Definições - espalhamento dos wake-ups da frota. Depois de um power-on (ou reset), o
+ * primeiro sleep dura a fase do dispositivo (derivada do DevAddr) dentro de TEMPO_EM_SLEEP,
+ * e não TEMPO_EM_SLEEP: uma queda de energia que reinicia a frota inteira não sincroniza
+ * os envios. Cada sleep por timer recebe também um jitter aleatório limitado, para que
+ * dois dispositivos com fases próximas não colidam em todos os ciclos.
+ */
+#define FATOR_US_PARA_MS  (uint64_t)1000
+#define JITTER_MAX_SLEEP_MS  30000 //ms
 
 /* Definições - motivos de wake-up (para envio LoRaWAN) */
 #define MOTIVO_WAKEUP_TAMPER             0x01
 #define MOTIVO_WAKEUP_TIMER              0x02
 #define MOTIVO_WAKEUP_DESCONHECIDO       0x03
+#define MOTIVO_WAKEUP_TAMPER_DESFEITO    0x04
+
+/* Definição - distância da lixeira quase cheia: toda wake-up lê o sensor (período mínimo)
+ * e o lote de leituras é enviado na hora
+ */
+#define DISTANCIA_LIXEIRA_QUASE_CHEIA_CM 30
+
+/* Definição - tempo máximo para o debounce confirmar uma mudança do tamper */
+#define TEMPO_MAX_CONFIRMACAO_TAMPER     1000 //ms
+
+/* Definição - distância informada no alerta de tamper (sensor não lido) */
+#define DISTANCIA_NAO_MEDIDA             LOTE_LEITURAS_DISTANCIA_NAO_MEDIDA
+
+/* Definições - leitura (registro da fila de uplinks) e envio dos lotes pendentes na fila */
+#define TAM_PAYLOAD_LEITURA              LOTE_LEITURAS_TAM_LEITURA
+#define QTDE_MAX_QUADROS_POR_WAKEUP      3
+
+/* Definições - preparação do módulo LoRaWAN e leitura do sensor em paralelo (eventos de conclusão) */
+#define EVENTO_MODULO_LORAWAN_PRONTO       (1 << 0)
+#define EVENTO_LEITURA_SENSOR_PRONTA       (1 << 1)
+#define PRIO_TASKS_ETAPAS_PARALELAS        10
+#define TEMPO_ENTRE_VERIFICACOES_ETAPAS    1000 //ms
 
 /* Definição - tempo máximo sem feed do watchdog */
 #define TEMPO_MAX_SEM_FEED_WATCHDOG        20 //s
@@ -29,10 +77,257 @@
 /* Tag de debug */
 static const char* TAG_LOGS_LORAWAN_SENSORES = "LIXO_LORAWAN";
 
+/* Fila de uplinks pendentes (preservada em memória RTC durante o deep sleep) */
+static RTC_DATA_ATTR TFila_uplinks fila_uplinks;
+
+/* Indica tamper acionado e ainda não desfeito (preservado em memória RTC durante o deep sleep).
+ * Define o nível do GPIO de tamper que acorda o ESP32: alto (acionamento) ou baixo (fim do tamper).
+ */
+static RTC_DATA_ATTR bool tamper_acionado = false;
+
+/* Perfil de tempo acordado por fase do ciclo (preservado em memória RTC durante o deep sleep) */
+static RTC_DATA_ATTR TPerfil_wakeup perfil_wakeup;
+
+/* Histórico de distâncias filtradas para o sleep adaptativo (preservado em memória RTC durante o deep sleep) */
+static RTC_DATA_ATTR THistorico_distancias historico_distancias;
+
+/* Grupo de eventos das etapas em paralelo do wake-up e resultado da rajada de medições da etapa do sensor */
+static EventGroupHandle_t grupo_eventos_wakeup;
+static TResultado_rajada medicao_sensor;
+
+/* Distância filtrada (sleep adaptativo), usada nas decisões de envio e de wake-up */
+static float distancia_filtrada = 0.0;
+
+/* Indica que um envio deste wake-up deixou leituras na fila (falha ou limite de quadros) */
+static bool envio_incompleto = false;
+
+/* Indica se este boot é um power-on (ou reset): o próximo sleep dura a fase do dispositivo */
+static bool primeiro_sleep_apos_reset = false;
+
 /* Protótipos */
 static void le_sensor_e_envia_lorawan(void *arg);
+static int envia_uplinks_pendentes(void);
 static void configura_wake_up_e_entra_deep_sleep(void);
 static esp_sleep_wakeup_cause_t obtem_motivo_wake_up(void);
+static void preenche_config_lorawan(TConfig_LoRaWAN * pt_config_lorawan);
+static void converte_para_hex(const uint8_t * pt_bytes, int qtde_bytes, char * pt_hex);
+static void envia_alerta_tamper(void);
+static bool confirma_evento_tamper(int evento_esperado);
+static void marca_fim_fase(int fase);
+static uint32_t duracao_desde_us(int64_t instante_inicio_us);
+static void prepara_modulo_lorawan(void *arg);
+static void le_distancia(void *arg);
+static void aguarda_etapas_paralelas(EventBits_t eventos_aguardados);
+static uint8_t motivo_para_lote(esp_sleep_wakeup_cause_t motivo_wakeup);
+static void encerra_e_loga_perfil_wakeup(void);
+static bool leitura_sensor_feita(void);
+static void inicializa_e_loga_wake_stub(void);
+static uint64_t calcula_tempo_em_sleep_us(void);
+
+/* Função: marca o fim de uma fase do ciclo de wake-up no perfil
+ * Parâmetros: fase que terminou (PERFIL_WAKEUP_FASE_...)
+ * Retorno: nenhum
+ */
+static void marca_fim_fase(int fase)
+{
+    perfil_wakeup_marca_fim_fase(&perfil_wakeup, fase, (uint32_t)esp_timer_get_time());
+}
+
+/* Função: calcula o tempo decorrido desde um instante (para o perfil de wake-up)
+ * Parâmetros: instante inicial (us, esp_timer_get_time())
+ * Retorno: tempo decorrido (us)
+ */
+static uint32_t duracao_desde_us(int64_t instante_inicio_us)
+{
+    return (uint32_t)(esp_timer_get_time() - instante_inicio_us);
+}
+
+/* Função: tarefa que inicializa a UART e configura o módulo LoRaWAN,
+ *         em paralelo com a leitura do sensor
+ * Parâmetros: ponteiro para as configurações do módulo LoRaWAN
+ * Retorno: nenhum
+ */
+static void prepara_modulo_lorawan(void *arg)
+{
+    TConfig_LoRaWAN * pt_config_lorawan = (TConfig_LoRaWAN *)arg;
+    int64_t instante_inicio_us;
+
+    esp_task_wdt_add(NULL);
+
+    instante_inicio_us = esp_timer_get_time();
+    inicializa_uart_lorawan();
+    perfil_wakeup_registra_fase(&perfil_wakeup, PERFIL_WAKEUP_FASE_UART, duracao_desde_us(instante_inicio_us));
+    esp_task_wdt_reset();
+
+    instante_inicio_us = esp_timer_get_time();
+    configurar_lorawan(pt_config_lorawan);
+    perfil_wakeup_registra_fase(&perfil_wakeup, PERFIL_WAKEUP_FASE_CONFIG_LORAWAN, duracao_desde_us(instante_inicio_us));
+
+    esp_task_wdt_delete(NULL);
+    xEventGroupSetBits(grupo_eventos_wakeup, EVENTO_MODULO_LORAWAN_PRONTO);
+    vTaskDelete(NULL);
+}
+
+/* Função: tarefa que inicializa e lê o sensor de distância, em paralelo
+ *         com a preparação do módulo LoRaWAN
+ * Parâmetros: ponteiro para as configurações dos sensores
+ * Retorno: nenhum
+ */
+static void le_distancia(void *arg)
+{
+    TConfig_sensores * pt_config_sensores = (TConfig_sensores *)arg;
+    int64_t instante_inicio_us;
+
+    esp_task_wdt_add(NULL);
+
+    instante_inicio_us = esp_timer_get_time();
+    inicializa_sensor(pt_config_sensores);
+    perfil_wakeup_registra_fase(&perfil_wakeup, PERFIL_WAKEUP_FASE_INICIA_SENSOR, duracao_desde_us(instante_inicio_us));
+    ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Sensor configurado");
+
+    ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Lendo sensor...");
+    instante_inicio_us = esp_timer_get_time();
+    le_sensor(pt_config_sensores, &medicao_sensor);
+    perfil_wakeup_registra_fase(&perfil_wakeup, PERFIL_WAKEUP_FASE_LE_SENSOR, duracao_desde_us(instante_inicio_us));
+
+    esp_task_wdt_delete(NULL);
+    xEventGroupSetBits(grupo_eventos_wakeup, EVENTO_LEITURA_SENSOR_PRONTA);
+    vTaskDelete(NULL);
+}
+
+/* Função: aguarda a preparação do módulo LoRaWAN e/ou a leitura do sensor
+ *         terminarem, alimentando o watchdog enquanto isso
+ * Parâmetros: eventos de conclusão aguardados (EVENTO_...)
+ * Retorno: nenhum
+ */
+static void aguarda_etapas_paralelas(EventBits_t eventos_aguardados)
+{
+    EventBits_t eventos = 0;
+
+    while ((eventos & eventos_aguardados) != eventos_aguardados)
+    {
+        esp_task_wdt_reset();
+        eventos = xEventGroupWaitBits(grupo_eventos_wakeup, eventos_aguardados, pdFALSE, pdTRUE,
+                                      pdMS_TO_TICKS(TEMPO_ENTRE_VERIFICACOES_ETAPAS));
+    }
+}
+
+/* Função: inicializa o wake stub e loga os wake-ups que ele resolveu sem
+ *         boot completo desde o último boot completo
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void inicializa_e_loga_wake_stub(void)
+{
+    uint32_t wakes_pulados;
+    uint32_t tempo_medio_no_stub_us;
+
+    wake_stub_inicializa(DISTANCIA_LIXEIRA_QUASE_CHEIA_CM);
+    wake_stub_obtem_estatisticas(&wakes_pulados, &tempo_medio_no_stub_us);
+    LOGD_I(TAG_LOGS_LORAWAN_SENSORES, "Wake stub: pulados=%u stub_medio_us=%u", wakes_pulados, tempo_medio_no_stub_us);
+}
+
+/* Função: converte o motivo do wake-up no motivo de uma leitura do lote
+ * Parâmetros: motivo do wake-up (MOTIVO_WAKEUP_...)
+ * Retorno: motivo da leitura (LOTE_LEITURAS_MOTIVO_...)
+ */
+static uint8_t motivo_para_lote(esp_sleep_wakeup_cause_t motivo_wakeup)
+{
+    switch (motivo_wakeup)
+    {
+        case MOTIVO_WAKEUP_TIMER:
+            return LOTE_LEITURAS_MOTIVO_TIMER;
+
+        case MOTIVO_WAKEUP_TAMPER:
+            return LOTE_LEITURAS_MOTIVO_TAMPER;
+
+        case MOTIVO_WAKEUP_TAMPER_DESFEITO:
+            return LOTE_LEITURAS_MOTIVO_TAMPER_DESFEITO;
+
+        default:
+            return LOTE_LEITURAS_MOTIVO_OUTRO;
+    }
+}
+
+/* Função: informa se o sensor foi lido neste wake-up
+ * Parâmetros: nenhum
+ * Retorno: true: medicao_sensor contém uma distância válida lida neste wake-up
+ */
+static bool leitura_sensor_feita(void)
+{
+    if (grupo_eventos_wakeup == NULL)
+    {
+        return false;
+    }
+
+    return ( ((xEventGroupGetBits(grupo_eventos_wakeup) & EVENTO_LEITURA_SENSOR_PRONTA) != 0) &&
+             (medicao_sensor.qualidade != RAJADA_QUALIDADE_FALHA) );
+}
+
+/* Função: encerra o ciclo de wake-up no perfil e loga as durações do ciclo.
+ *         Ao fim de cada janela, loga também mínimo, média e máximo de cada fase.
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void encerra_e_loga_perfil_wakeup(void)
+{
+    const uint32_t * pt_duracao;
+    const TEstatisticas_fase * pt_estatisticas;
+    int fase;
+
+    if (perfil_wakeup_encerra_ciclo(&perfil_wakeup, (uint32_t)esp_timer_get_time()) == false)
+    {
+        pt_duracao = perfil_wakeup.duracao_ciclo_us;
+        LOGD_I(TAG_LOGS_LORAWAN_SENSORES, "Perfil (ms): boot=%u tamper=%u uart=%u config_lorawan=%u",
+               pt_duracao[PERFIL_WAKEUP_FASE_BOOT] / 1000, pt_duracao[PERFIL_WAKEUP_FASE_TAMPER] / 1000,
+               pt_duracao[PERFIL_WAKEUP_FASE_UART] / 1000, pt_duracao[PERFIL_WAKEUP_FASE_CONFIG_LORAWAN] / 1000);
+        LOGD_I(TAG_LOGS_LORAWAN_SENSORES, "Perfil (ms): inicia_sensor=%u le_sensor=%u paralelo=%u envio=%u total=%u",
+               pt_duracao[PERFIL_WAKEUP_FASE_INICIA_SENSOR] / 1000, pt_duracao[PERFIL_WAKEUP_FASE_LE_SENSOR] / 1000,
+               pt_duracao[PERFIL_WAKEUP_FASE_PARALELO] / 1000, pt_duracao[PERFIL_WAKEUP_FASE_ENVIO] / 1000,
+               pt_duracao[PERFIL_WAKEUP_FASE_TOTAL] / 1000);
+        return;
+    }
+
+    ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Perfil dos ultimos %d wake-ups (%u no total), em ms:",
+             PERFIL_WAKEUP_CICLOS_POR_JANELA, perfil_wakeup.total_ciclos);
+
+    for (fase = 0; fase < PERFIL_WAKEUP_QTDE_FASES; fase++)
+    {
+        pt_estatisticas = &perfil_wakeup.janela_fechada[fase];
+        ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "  %-14s min=%u media=%u max=%u",
+                 perfil_wakeup_nome_fase(fase), pt_estatisticas->minimo_us / 1000,
+                 perfil_wakeup_media_us(pt_estatisticas) / 1000, pt_estatisticas->maximo_us / 1000);
+    }
+}
+
+/* Função: calcula a duração do próximo sleep por timer: a fase do dispositivo
+ *         dentro de TEMPO_EM_SLEEP no primeiro sleep após um power-on (ou reset),
+ *         senão TEMPO_EM_SLEEP mais um jitter aleatório limitado
+ * Parâmetros: nenhum
+ * Retorno: duração do sleep (us)
+ */
+static uint64_t calcula_tempo_em_sleep_us(void)
+{
+    TConfig_LoRaWAN config_lorawan;
+    uint32_t dev_addr = 0;
+    uint32_t fase_ms = 0;
+
+    if (primeiro_sleep_apos_reset == false)
+    {
+        return (FATOR_US_PARA_S * TEMPO_EM_SLEEP) + (FATOR_US_PARA_MS * (esp_random() % JITTER_MAX_SLEEP_MS));
+    }
+
+    preenche_config_lorawan(&config_lorawan);
+    if (fase_uplinks_le_dev_addr(obtem_dev_addr_lorawan(&config_lorawan), &dev_addr) == false)
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN_SENSORES, "DevAddr invalido (ou sem sessao LoRaWAN). Fase dos wake-ups sorteada.");
+        dev_addr = esp_random();
+    }
+
+    fase_ms = fase_uplinks_deslocamento_ms(dev_addr, (uint32_t)(TEMPO_EM_SLEEP * 1000));
+    ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Primeiro sleep apos reset: fase de %u ms", fase_ms);
+    return FATOR_US_PARA_MS * fase_ms;
+}
 
 /* Função: configura fontes de wake-up para o ESP32 e entra em deep sleep
  * Parâmetros: nenhum
@@ -42,12 +337,51 @@ static void configura_wake_up_e_entra_deep_sleep(void)
 {
     /* Variáveis para o deep sleep */
     uint64_t tempo_em_sleep_us = 0;
+    uint32_t periodo_leituras_s;
+    uint32_t wakes_a_pular;
+
+    TDebounce_tamper contadores_tamper;
+
+    /* Execuções do software de tamper neste wake-up (interrupções e expirações do timer de debounce) */
+    obtem_contadores_tamper(&contadores_tamper);
+    LOGD_I(TAG_LOGS_LORAWAN_SENSORES, "Tamper: %u borda(s), %u expiracao(oes) do debounce, %u evento(s)",
+           contadores_tamper.qtde_bordas, contadores_tamper.qtde_expiracoes_timer, contadores_tamper.qtde_eventos);
 
-    ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "entrando em modo deep sleep por %lld segundos\n", TEMPO_EM_SLEEP);
-    tempo_em_sleep_us = FATOR_US_PARA_S * TEMPO_EM_SLEEP;
+    /* A RAM (e o anel do log diferido) não é mantida em deep sleep: escreve os logs pendentes */
+    log_diferido_descarrega();
 
-    /* Configura fonte de wake-up como timer e GPIO de tamper indo para nivel alto e entra em deep-sleep */
-    esp_sleep_enable_ext0_wakeup(GPIO_TAMPER, 1);
+    /* Próxima leitura do sensor pela taxa de enchimento prevista: o wake stub pula os
+     * wake-ups por timer intermediários
+     */
+    sleep_adaptativo_inicializa(&historico_distancias);
+    periodo_leituras_s = sleep_adaptativo_proximo_periodo_s(&historico_distancias, DISTANCIA_LIXEIRA_QUASE_CHEIA_CM,
+                                                            TEMPO_EM_SLEEP, PERIODO_SLEEP_MAX);
+    wakes_a_pular = ((periodo_leituras_s + (TEMPO_EM_SLEEP / 2)) / TEMPO_EM_SLEEP) - 1;
+    if (wakes_a_pular > UINT8_MAX)
+    {
+        wakes_a_pular = UINT8_MAX;
+    }
+
+    LOGD_I(TAG_LOGS_LORAWAN_SENSORES, "Sleep adaptativo: enchimento %d mm/h, proxima leitura em %u s",
+           (int32_t)(historico_distancias.taxa_enchimento_cm_h * 10.0f), periodo_leituras_s);
+    tempo_em_sleep_us = calcula_tempo_em_sleep_us();
+    ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "entrando em modo deep sleep por %lld ms\n", tempo_em_sleep_us / FATOR_US_PARA_MS);
+
+    /* Estado para o wake stub decidir os próximos wake-ups por timer. Nos ciclos
+     * que não leem o sensor (tamper), a última distância medida é mantida. Leituras
+     * guardadas no lote só exigem boot completo se o envio delas falhou ou já é devido.
+     * O wake stub rearma o timer sempre com o período normal (nunca com a fase).
+     */
+    fila_uplinks_inicializa(&fila_uplinks);
+    wake_stub_prepara_deep_sleep(leitura_sensor_feita() ? decisao_wake_stub_converte_distancia(distancia_filtrada) : DECISAO_WAKE_STUB_DISTANCIA_NAO_MEDIDA,
+                                 (envio_incompleto == true) || lote_leituras_deve_enviar(&fila_uplinks, (uint32_t)time(NULL), false),
+                                 (uint8_t)wakes_a_pular,
+                                 (primeiro_sleep_apos_reset == true) ? (FATOR_US_PARA_S * TEMPO_EM_SLEEP) : tempo_em_sleep_us);
+
+    /* Configura fonte de wake-up como timer e GPIO de tamper e entra em deep-sleep. Com o tamper
+     * acionado, o ESP32 acorda quando o tamper for desfeito (nivel baixo); senão, quando for acionado (nivel alto).
+     */
+    esp_sleep_enable_ext0_wakeup(GPIO_TAMPER, (tamper_acionado == true) ? 0 : 1);
     esp_sleep_enable_timer_wakeup(tempo_em_sleep_us);    
     esp_deep_sleep_start();
 }
@@ -65,8 +399,16 @@ static esp_sleep_wakeup_cause_t obtem_motivo_wake_up(void)
     switch(motivo_wakeup)
     {
         case ESP_SLEEP_WAKEUP_EXT0:
-            ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Motivo do wake-up: tamper acionado");
-            motivo_wakeup = MOTIVO_WAKEUP_TAMPER;
+            if (tamper_acionado == true)
+            {
+                ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Motivo do wake-up: tamper desfeito");
+                motivo_wakeup = MOTIVO_WAKEUP_TAMPER_DESFEITO;
+            }
+            else
+            {
+                ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Motivo do wake-up: tamper acionado");
+                motivo_wakeup = MOTIVO_WAKEUP_TAMPER;
+            }
             break;   
 
         case ESP_SLEEP_WAKEUP_TIMER: 
@@ -83,101 +425,314 @@ static esp_sleep_wakeup_cause_t obtem_motivo_wake_up(void)
     return motivo_wakeup;
 }
 
+/* Função: preenche as configurações (credenciais e parâmetros) do módulo LoRaWAN
+ * Parâmetros: ponteiro para as configurações
+ * Retorno: nenhum
+ */
+static void preenche_config_lorawan(TConfig_LoRaWAN * pt_config_lorawan)
+{
+    memset(pt_config_lorawan->APPSKEY, 0x00, sizeof(pt_config_lorawan->APPSKEY));
+    memset(pt_config_lorawan->NWSKEY, 0x00, sizeof(pt_config_lorawan->NWSKEY));
+    memset(pt_config_lorawan->APPEUI, 0x00, sizeof(pt_config_lorawan->APPEUI));                                   
+    memset(pt_config_lorawan->DEVADDR, 0x00, sizeof(pt_config_lorawan->DEVADDR));
+    memset(pt_config_lorawan->CHMASK, 0x00, sizeof(pt_config_lorawan->CHMASK));
+    memset(pt_config_lorawan->DEVEUI, 0x00, sizeof(pt_config_lorawan->DEVEUI));
+    memset(pt_config_lorawan->APPKEY, 0x00, sizeof(pt_config_lorawan->APPKEY));
+
+    /* Substitua as credenciais abaixo pelas suas, credenciais estas fornecidas pelo 
+     * seu distribuidor LoRaWAN
+     */
+    snprintf(pt_config_lorawan->APPSKEY, sizeof(pt_config_lorawan->APPSKEY), "00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00"); 
+    snprintf(pt_config_lorawan->NWSKEY, sizeof(pt_config_lorawan->NWSKEY), "00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00"); 
+    snprintf(pt_config_lorawan->APPEUI, sizeof(pt_config_lorawan->APPEUI), "00:00:00:00:00:00:00:00"); 
+    snprintf(pt_config_lorawan->DEVADDR, sizeof(pt_config_lorawan->DEVADDR), "00:00:00:00"); 
+    snprintf(pt_config_lorawan->CHMASK, sizeof(pt_config_lorawan->CHMASK), "00FF:0000:0000:0000:0000:0000"); 
+    snprintf(pt_config_lorawan->DEVEUI, sizeof(pt_config_lorawan->DEVEUI), "00:00:00:00:00:00:00:00"); 
+    snprintf(pt_config_lorawan->APPKEY, sizeof(pt_config_lorawan->APPKEY), "00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00"); 
+    
+    pt_config_lorawan->confirmacao_de_envio = LORAWAN_ENVIO_SEM_CONFIRMACAO;
+    /* ABP (padrão): DEVADDR, APPSKEY e NWSKEY acima. Com LORAWAN_JOIN_MODE_OTAA
+     * (opcional, DEVEUI e APPKEY acima), a sessão é obtida num join e persistida
+     */
+    pt_config_lorawan->join_mode = LORAWAN_JOIN_MODE_ABP;
+    pt_config_lorawan->adr = LORAWAN_ADR_DESABILITADO;
+    pt_config_lorawan->dr = LORAWAN_DR_NIVEL_2;
+    pt_config_lorawan->classe = LORAWAN_CLASSE_A;
+}
+
+/* Função: converte bytes em string hexadecimal (payload do módulo LoRaWAN)
+ * Parâmetros: - bytes e quantidade de bytes
+ *             - ponteiro para a string (com espaço para 2 caracteres por byte + terminador)
+ * Retorno: nenhum
+ */
+static void converte_para_hex(const uint8_t * pt_bytes, int qtde_bytes, char * pt_hex)
+{
+    int i;
+
+    pt_hex[0] = '\0';
+    for (i = 0; i < qtde_bytes; i++)
+    {
+        snprintf(&pt_hex[i * 2], 3, "%02X", pt_bytes[i]);
+    }
+}
+
+/* Função: aguarda o debounce do tamper (por interrupção e timer) confirmar
+ *         a mudança de nível que acordou o ESP32
+ * Parâmetros: evento esperado (EVENTO_TAMPER_ACIONADO ou EVENTO_TAMPER_DESFEITO)
+ * Retorno: true: evento esperado confirmado
+ *          false: nível não se manteve (ruído / trepidação no GPIO)
+ */
+static bool confirma_evento_tamper(int evento_esperado)
+{
+    TEvento_tamper evento;
+
+    while (aguarda_evento_tamper(&evento, pdMS_TO_TICKS(TEMPO_MAX_CONFIRMACAO_TAMPER)) == true)
+    {
+        if (evento.evento == evento_esperado)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Função: caminho rápido do wake-up por tamper. Configura o módulo LoRaWAN e
+ *         envia imediatamente um alerta compacto (sem ler o sensor), sem
+ *         esperar o tamper ser desfeito. O fim do tamper gera outro wake-up
+ *         (ext0 em nível baixo), tratado como um evento à parte.
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void envia_alerta_tamper(void)
+{
+    TConfig_LoRaWAN config_lorawan;
+    uint8_t alerta[TAM_PAYLOAD_LEITURA];
+
+    /* Confirma o tamper após o debounce (evita alerta falso por ruído no GPIO) */
+    if (confirma_evento_tamper(EVENTO_TAMPER_ACIONADO) == false)
+    {
+        ESP_LOGW(TAG_LOGS_LORAWAN_SENSORES, "Tamper nao confirmado apos debounce. Alerta nao enviado.");
+        return;
+    }
+
+    tamper_acionado = true;
+
+    inicializa_uart_lorawan();
+    esp_task_wdt_reset();
+    preenche_config_lorawan(&config_lorawan);
+    configurar_lorawan(&config_lorawan);
+    esp_task_wdt_reset();
+
+    /* Alerta: leitura sem distância medida. Entra no fim do lote pendente,
+     * que é enviado na hora (o alerta antecipa o envio do lote).
+     */
+    lote_leituras_monta_registro(DISTANCIA_NAO_MEDIDA, LOTE_LEITURAS_MOTIVO_TAMPER, alerta);
+    fila_uplinks_inicializa(&fila_uplinks);
+    fila_uplinks_insere(&fila_uplinks, alerta, sizeof(alerta), (uint32_t)time(NULL));
+    envia_uplinks_pendentes();
+
+    if (fila_uplinks_quantidade(&fila_uplinks) == 0)
+    {
+        ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Alerta de tamper enviado %lld ms apos o wake-up", esp_timer_get_time() / 1000);
+    }
+    else
+    {
+        /* Envio recusado: o alerta fica na fila e sai no próximo wake-up */
+        ESP_LOGE(TAG_LOGS_LORAWAN_SENSORES, "Envio do alerta de tamper falhou. Alerta mantido na fila de uplinks.");
+    }
+
+    esp_task_wdt_reset();
+}
+
+/* Função: envia as leituras pendentes na fila, da mais antiga para a mais
+ *         nova, em quadros de lote. Leituras só saem da fila se o módulo
+ *         LoRaWAN aceitar o envio.
+ * Parâmetros: nenhum
+ * Retorno: quantidade de leituras enviadas
+ */
+static int envia_uplinks_pendentes(void)
+{
+    uint8_t quadro[TAM_MAX_PAYLOAD_LORAWAN] = {0};
+    char payload_lorawan[(TAM_MAX_PAYLOAD_LORAWAN * 2) + 1] = {0};
+    int tam_quadro = 0;
+    int qtde_registros = 0;
+    int qtde_quadros = 0;
+    int qtde_enviados = 0;
+
+    while (qtde_quadros < QTDE_MAX_QUADROS_POR_WAKEUP)
+    {
+        tam_quadro = lote_leituras_monta_quadro(&fila_uplinks, (uint32_t)time(NULL), quadro, sizeof(quadro), &qtde_registros);
+
+        if (tam_quadro == 0)
+        {
+            break;
+        }
+
+        /* Entre dois quadros, o próprio envio aguarda o módulo terminar a transmissão
+         * e as janelas de recepção anteriores (agendador de uplinks). Se o orçamento
+         * de tempo no ar não permitir o envio, os registros ficam na fila e são
+         * agrupados no quadro do próximo wake-up.
+         */
+        esp_task_wdt_reset();
+
+        converte_para_hex(quadro, tam_quadro, payload_lorawan);
+
+        if (envia_payload_lorawan_na_porta(LOTE_LEITURAS_PORTA, payload_lorawan) != ESP_OK)
+        {
+            ESP_LOGE(TAG_LOGS_LORAWAN_SENSORES, "Envio falhou. %d leitura(s) permanecem na fila", fila_uplinks_quantidade(&fila_uplinks));
+            break;
+        }
+
+        LOGD_I(TAG_LOGS_LORAWAN_SENSORES, "Lote de %d leitura(s) enviado em %d bytes", qtde_registros, tam_quadro);
+        fila_uplinks_confirma_envio(&fila_uplinks, qtde_registros);
+        qtde_enviados += qtde_registros;
+        qtde_quadros++;
+    }
+
+    envio_incompleto = (fila_uplinks_quantidade(&fila_uplinks) > 0);
+    return qtde_enviados;
+}
+
 static void le_sensor_e_envia_lorawan(void *arg)
 {             
     esp_sleep_wakeup_cause_t motivo_wakeup;         
     TConfig_LoRaWAN config_lorawan;          /* Variável de configs  do modulo LoRaWAN */
-    float distancia = 0.0;                   /* Variável relativa a distancia medida */    
     TConfig_sensores config_sensores;        /* Variável ralativa a config aos sensores */
-    char payload_lorawan[5] = {0};          /* Variável para compor payload */       
+    uint8_t leitura[TAM_PAYLOAD_LEITURA];    /* Variável para compor a leitura (registro do lote) */
+    bool envio_previsto;
+    bool forca_envio;
 
     esp_task_wdt_add(NULL);
 
+    /* Inicia o perfil do ciclo: o tempo desde o reset até aqui é a fase de boot */
+    perfil_wakeup_inicializa(&perfil_wakeup);
+    perfil_wakeup_inicia_ciclo(&perfil_wakeup, (uint32_t)esp_timer_get_time());
+
     /* Obtem motivo do wake-up do ESP32 */    
     motivo_wakeup = obtem_motivo_wake_up();  
+    primeiro_sleep_apos_reset = (motivo_wakeup == MOTIVO_WAKEUP_DESCONHECIDO);
+    inicializa_e_loga_wake_stub();
 
-    /* Configura tamper */     
-    configura_tamper();
+    /* Configura tamper por interrupção. O nível anterior é o do tamper antes do deep sleep:
+     * se o ESP32 acordou pelo tamper, o debounce confirma a mudança sem polling do GPIO.
+     */
+    if (configura_tamper_por_interrupcao((tamper_acionado == true) ? 1 : 0) != ESP_OK)
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN_SENSORES, "Falha ao configurar tamper por interrupcao");
+    }
     esp_task_wdt_reset();
 
-    /* Se o motivo do wake-up foi tamper, aguarda o tamper ser desfeito para prosseguir */
+    /* Tamper acionado: caminho rápido. O alerta é enviado sem esperar o tamper ser
+     * desfeito e o ESP32 volta a dormir, acordando no fim do tamper. Este ciclo não
+     * lê o sensor e, por isso, não entra no perfil de wake-up.
+     */
     if (motivo_wakeup == MOTIVO_WAKEUP_TAMPER)
     {       
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        envia_alerta_tamper();
+        configura_wake_up_e_entra_deep_sleep();
+    }
 
-        while (1)
+    /* Fim do tamper: confirma com debounce e segue o ciclo normal, cuja leitura é
+     * enviada como evento de tamper desfeito. Se o tamper ainda estiver acionado
+     * (ruído no GPIO), volta a dormir aguardando o fim do tamper.
+     */
+    if (motivo_wakeup == MOTIVO_WAKEUP_TAMPER_DESFEITO)
+    {
+        if (confirma_evento_tamper(EVENTO_TAMPER_DESFEITO) == false)
         {
-            ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Aguardando tamper ser desfeito..."); 
-            esp_task_wdt_reset();
-
-            /* Le tamper com debounce */
-            if (le_tamper() == 0)
-            {
-                vTaskDelay(pdMS_TO_TICKS(TEMPO_DEBOUNCE_TAMPER));
-                if (le_tamper() == 0)
-                {
-                    break;
-                }
-            }
-
-            vTaskDelay(pdMS_TO_TICKS(10));
+            ESP_LOGW(TAG_LOGS_LORAWAN_SENSORES, "Fim do tamper nao confirmado apos debounce.");
+            configura_wake_up_e_entra_deep_sleep();
         }
 
+        tamper_acionado = false;
         ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Tamper desfeito."); 
     }
 
+    marca_fim_fase(PERFIL_WAKEUP_FASE_TAMPER);
     esp_task_wdt_reset();
 
     /*  
      *   Configuração do módulo LoRaWAN
      */
-    inicializa_uart_lorawan();    
-    esp_task_wdt_reset();
-
-    memset(config_lorawan.APPSKEY, 0x00, sizeof(config_lorawan.APPSKEY));
-    memset(config_lorawan.NWSKEY, 0x00, sizeof(config_lorawan.NWSKEY));
-    memset(config_lorawan.APPEUI, 0x00, sizeof(config_lorawan.APPEUI));                                   
-    memset(config_lorawan.DEVADDR, 0x00, sizeof(config_lorawan.DEVADDR));
-    memset(config_lorawan.CHMASK, 0x00, sizeof(config_lorawan.CHMASK));
-
-    /* Substitua as credenciais abaixo pelas suas, credenciais estas fornecidas pelo 
-     * seu distribuidor LoRaWAN
-     */
-    snprintf(config_lorawan.APPSKEY, sizeof(config_lorawan.APPSKEY), "00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00"); 
-    snprintf(config_lorawan.NWSKEY, sizeof(config_lorawan.NWSKEY), "00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00"); 
-    snprintf(config_lorawan.APPEUI, sizeof(config_lorawan.APPEUI), "00:00:00:00:00:00:00:00"); 
-    snprintf(config_lorawan.DEVADDR, sizeof(config_lorawan.DEVADDR), "00:00:00:00"); 
-    snprintf(config_lorawan.CHMASK, sizeof(config_lorawan.CHMASK), "00FF:0000:0000:0000:0000:0000"); 
-    
-    config_lorawan.confirmacao_de_envio = LORAWAN_ENVIO_SEM_CONFIRMACAO;
-    config_lorawan.join_mode = LORAWAN_JOIN_MODE_ABP;
-    config_lorawan.adr = LORAWAN_ADR_DESABILITADO;
-    config_lorawan.dr = LORAWAN_DR_NIVEL_2;
-    config_lorawan.classe = LORAWAN_CLASSE_A;
+    preenche_config_lorawan(&config_lorawan);
     
-    configurar_lorawan(&config_lorawan);
-    esp_task_wdt_reset();
-
     /*  
      *   Configura sensores
      */
     config_sensores.gpio_echo = 33;
     config_sensores.gpio_trigger = 25;
     config_sensores.gpio_liga_desliga = 21;    
-    inicializa_sensor(&config_sensores);
-    
-    ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Sensor configurado");
-    ESP_LOGI(TAG_LOGS_LORAWAN_SENSORES, "Lendo sensor...");
-    le_sensor(&config_sensores, &distancia); 
+
+    /* As leituras são enviadas em lotes: o módulo LoRaWAN só é preparado nos wake-ups
+     * em que o lote é enviado. Se o envio já é previsto antes da leitura (lote completo
+     * com ela, leitura mais antiga velha demais ou fim de tamper), módulo LoRaWAN e
+     * sensor, que usam periféricos diferentes e passam a maior parte do tempo aguardando
+     * (respostas AT e intervalo entre leituras), são preparados em paralelo, em tarefas
+     * próprias. As configurações ficam na pilha desta tarefa, que espera.
+     */
+    fila_uplinks_inicializa(&fila_uplinks);
+    envio_previsto = lote_leituras_envio_previsto(&fila_uplinks, (uint32_t)time(NULL), (motivo_wakeup == MOTIVO_WAKEUP_TAMPER_DESFEITO));
+
+    grupo_eventos_wakeup = xEventGroupCreate();
+    if (envio_previsto == true)
+    {
+        xTaskCreate(prepara_modulo_lorawan, "PREPARA_LORAWAN", CONFIG_SENSORES_LORAWAN_TASK_STACK_SIZE, &config_lorawan, PRIO_TASKS_ETAPAS_PARALELAS, NULL);
+    }
+    xTaskCreate(le_distancia, "LE_DISTANCIA", CONFIG_SENSORES_LORAWAN_TASK_STACK_SIZE, &config_sensores, PRIO_TASKS_ETAPAS_PARALELAS, NULL);
+    aguarda_etapas_paralelas((envio_previsto == true) ? (EVENTO_MODULO_LORAWAN_PRONTO | EVENTO_LEITURA_SENSOR_PRONTA) : EVENTO_LEITURA_SENSOR_PRONTA);
+    marca_fim_fase(PERFIL_WAKEUP_FASE_PARALELO);
     esp_task_wdt_reset();
     
-    /* Monta payload e o envia por LoRaWAN */
-    memset(payload_lorawan, 0x00, sizeof(payload_lorawan));
-    snprintf(payload_lorawan, sizeof(payload_lorawan), "%02X%02X", (uint8_t)distancia,
-                                                                   (uint8_t)motivo_wakeup);
-    envia_payload_lorawan(payload_lorawan);                                                                   
+    LOGD_I(TAG_LOGS_LORAWAN_SENSORES, "Sensor: qualidade %s, %u leitura(s) (%u erro(s), %u outlier(s)), ligado por %u ms",
+           rajada_medicoes_nome_qualidade(medicao_sensor.qualidade), medicao_sensor.qtde_leituras,
+           medicao_sensor.qtde_erros, medicao_sensor.qtde_outliers, medicao_sensor.tempo_ligado_ms);
+
+    /* Monta leitura e a insere no lote (fila de uplinks pendentes). Sem leitura válida,
+     * a distância vai como não medida e o sleep adaptativo mantém o histórico.
+     */
+    lote_leituras_monta_registro(leitura_sensor_feita() ? (int32_t)lroundf(medicao_sensor.distancia_cm) : DISTANCIA_NAO_MEDIDA,
+                                 motivo_para_lote(motivo_wakeup), leitura);
+
+    if (fila_uplinks_insere(&fila_uplinks, leitura, sizeof(leitura), (uint32_t)time(NULL)) == true)
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN_SENSORES, "Fila de uplinks cheia. Leitura mais antiga descartada.");
+    }
+
+    /* Leitura filtrada entra no histórico do sleep adaptativo */
+    sleep_adaptativo_inicializa(&historico_distancias);
+    if (leitura_sensor_feita() == true)
+    {
+        distancia_filtrada = sleep_adaptativo_registra_leitura(&historico_distancias, (uint32_t)time(NULL), medicao_sensor.distancia_cm);
+    }
+
+    /* Fim de tamper e lixeira quase cheia antecipam o envio do lote */
+    forca_envio = (motivo_wakeup == MOTIVO_WAKEUP_TAMPER_DESFEITO) ||
+                  ((leitura_sensor_feita() == true) && (distancia_filtrada <= DISTANCIA_LIXEIRA_QUASE_CHEIA_CM));
+
+    if (lote_leituras_deve_enviar(&fila_uplinks, (uint32_t)time(NULL), forca_envio) == true)
+    {
+        if (envio_previsto == false)
+        {
+            xTaskCreate(prepara_modulo_lorawan, "PREPARA_LORAWAN", CONFIG_SENSORES_LORAWAN_TASK_STACK_SIZE, &config_lorawan, PRIO_TASKS_ETAPAS_PARALELAS, NULL);
+            aguarda_etapas_paralelas(EVENTO_MODULO_LORAWAN_PRONTO);
+        }
+
+        envia_uplinks_pendentes();
+    }
+    else
+    {
+        LOGD_I(TAG_LOGS_LORAWAN_SENSORES, "Leitura guardada no lote (%d de %d)",
+               fila_uplinks_quantidade(&fila_uplinks), LOTE_LEITURAS_QTDE_POR_ENVIO);
+    }
+
+    marca_fim_fase(PERFIL_WAKEUP_FASE_ENVIO);
     esp_task_wdt_reset();
 
+    /* Métricas da comunicação com o módulo LoRaWAN, acumuladas desde o último reset */
+    loga_metricas_lorawan();
+    encerra_e_loga_perfil_wakeup();
+
     /* Configura fontes de wake-up para o ESP32 e entra em deep sleep */
     configura_wake_up_e_entra_deep_sleep();
 }
@@ -185,5 +740,6 @@ static void le_sensor_e_envia_lorawan(void *arg)
 void app_main(void)
 {
     esp_task_wdt_init(TEMPO_MAX_SEM_FEED_WATCHDOG, true);
+    log_diferido_inicializa();
     xTaskCreate(le_sensor_e_envia_lorawan, "SENSOR_LORAWAN", CONFIG_SENSORES_LORAWAN_TASK_STACK_SIZE, NULL, 10, NULL);
 }
@@ -1,10 +1,22 @@
 /* Módulo LoRaWAN */
+#include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include <esp_task_wdt.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "driver/uart.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include "nvs_flash.h"
 #include "lorawan.h"
+#include "../sessao_lorawan/sessao_lorawan.h"
+
+/* Log diferido: nível de log deste módulo */
+#define LOG_DIFERIDO_NIVEL_MODULO  LOG_DIFERIDO_NIVEL_INFO
+#include "../log_diferido/log_diferido.h"
 
 /* Definições da UART de comunicação com módulo LoRaWAN */
 #define SENS_LORAWAN_TEST_TXD (CONFIG_SENSORES_LORAWAN_UART_TXD)
@@ -14,6 +26,10 @@
 #define SENS_LORAWAN_UART_PORT_NUM (CONFIG_SENSORES_LORAWAN_UART_PORT_NUM)
 #define SENS_LORAWAN_UART_BAUD_RATE (CONFIG_SENSORES_LORAWAN_UART_BAUD_RATE)
 
+/* Definições - namespace e chave da sessão LoRaWAN (OTAA) na NVS */
+#define NAMESPACE_NVS_LORAWAN    "lorawan"
+#define CHAVE_NVS_SESSAO_LORAWAN "sessao"
+
 /* Tamanho do buffer da UART */
 #define BUF_SIZE (512)
 
@@ -23,50 +39,184 @@ static char buffer_recepcao[BUF_SIZE] = {0};
 /* Tag de debug */
 static const char *TAG_LOGS_LORAWAN = "LORAWAN";
 
-/* Função: envia comando AT via UART para módulo LoRaWAN
- * Parâmetros: estrutura de configuração LoRaWAN
+/* Agendador de uplinks (tempo no ar, duty cycle e fair-use) e DR configurado.
+ * Ficam em memória RTC para que o orçamento de tempo no ar seja
+ * contabilizado ao longo dos ciclos de deep sleep.
+ */
+static RTC_DATA_ATTR TAgendador_uplinks agendador_uplinks;
+static RTC_DATA_ATTR int dr_configurado = 0;
+
+/* Métricas da comunicação com o módulo LoRaWAN (acumuladas ao longo dos
+ * ciclos de deep sleep)
+ */
+static RTC_DATA_ATTR TMetricas_lorawan metricas_lorawan;
+
+/* Fila de eventos da UART (consumida pela tarefa leitora do despachante AT) */
+static QueueHandle_t fila_eventos_uart = NULL;
+
+/* Tratador de downlinks registrado pela aplicação */
+static TTratador_downlink_lorawan tratador_downlink = NULL;
+
+/* Sessão LoRaWAN (OTAA) e estado do join em andamento (backoff e DR), em
+ * memória RTC: os wake-ups de deep sleep continuam a sessão (ou o backoff)
+ * sem novo join. A cópia da NVS cobre os resets e as quedas de energia, e só
+ * é gravada a cada SESSAO_LORAWAN_RESERVA_FCNT uplinks (ver sessao_lorawan).
+ */
+static RTC_DATA_ATTR TSessao_lorawan sessao_lorawan;
+static RTC_DATA_ATTR TJoin_lorawan join_lorawan;
+static RTC_DATA_ATTR bool gravacao_sessao_pendente = false;
+static volatile uint32_t downlinks_nao_registrados = 0;
+static bool modo_otaa = false;
+static bool nvs_inicializada = false;
+static char dev_addr_sessao[SESSAO_LORAWAN_TAM_TEXTO(SESSAO_LORAWAN_TAM_DEV_ADDR)] = {0};
+
+/* Fila dos resultados das tentativas de join (preenchida pelo tratador do evento de join) */
+static QueueHandle_t fila_resultados_join = NULL;
+
+/* Funções locais */
+static void trata_evento_downlink(TFatia_at evento, void *pt_contexto);
+static void trata_evento_join(TFatia_at evento, void *pt_contexto);
+static int64_t instante_atual_ms(void);
+static void ativa_sessao_lorawan(void);
+static esp_err_t restaura_sessao_no_modulo(void);
+static esp_err_t tenta_join_lorawan(void);
+static esp_err_t le_campo_sessao_do_modulo(const char *pt_campo, uint8_t *pt_bytes, int qtde_bytes);
+static esp_err_t inicializa_nvs_lorawan(void);
+static esp_err_t le_sessao_lorawan_da_flash(TSessao_lorawan *pt_sessao);
+static esp_err_t grava_sessao_lorawan_na_flash(void);
+static esp_err_t prepara_sessao_para_envio(void);
+static void registra_uplink_na_sessao(void);
+
+/* Função: obtém o instante atual, em ms (relógio do sistema, mantido durante o deep sleep)
+ * Parâmetros: nenhum
+ * Retorno: instante atual (ms)
+ */
+static int64_t instante_atual_ms(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return ((int64_t)tv.tv_sec * 1000LL) + (tv.tv_usec / 1000);
+}
+
+/* Função: tratador do evento de downlink (+EVT:RX_...), executado na tarefa
+ *         leitora da UART. Repassa o downlink ao tratador da aplicação.
+ * Parâmetros: - fatia do evento (após o prefixo)
+ *             - contexto (não utilizado)
  * Retorno: nenhum
  */
-void envia_comando_uart(char *pt_cmd, int tamanho)
+static void trata_evento_downlink(TFatia_at evento, void *pt_contexto)
 {
-    int tam = 0;
-    bool houve_resposta_busy = false;
+    TDownlink_at downlink;
 
-    do
+    if (despachante_at_interpreta_downlink(evento, &downlink) == false)
     {
-        uart_write_bytes(SENS_LORAWAN_UART_PORT_NUM, pt_cmd, tamanho);
-        vTaskDelay(pdMS_TO_TICKS(TEMPO_ENTRE_COMANDOS_AT));
-        esp_task_wdt_reset();
+        ESP_LOGE(TAG_LOGS_LORAWAN, "Evento de downlink em formato desconhecido: %.*s", evento.tamanho, evento.pt_dados);
+        return;
+    }
 
-        memset(buffer_recepcao, 0x00, BUF_SIZE);
-        tam = uart_read_bytes(SENS_LORAWAN_UART_PORT_NUM,
-                              (char *)buffer_recepcao, (BUF_SIZE - 1),
-                              TEMPO_ENTRE_COMANDOS_AT / portTICK_PERIOD_MS);
+    downlinks_nao_registrados++;
 
-        /* Verifica se não houve resposta de busy */
-        if (strstr(buffer_recepcao, "BUSY") != NULL)
-        {
-            /* Busy detectado. O comando deve ser enviado novamente. */
-            ESP_LOGE(TAG_LOGS_LORAWAN, "BUSY detectado na resposta: %s. Reenviando comando em 5 segundos...", buffer_recepcao);
-            vTaskDelay(pdMS_TO_TICKS(5000));
-            esp_task_wdt_reset();
-            houve_resposta_busy = true;
-        }
-        else
-        {
-            ESP_LOGI(TAG_LOGS_LORAWAN, "BUSY nao detectado na resposta. Prosseguindo com o software");
-            houve_resposta_busy = false;
-        }
-    } while (houve_resposta_busy == true);
+    LOGD_I(TAG_LOGS_LORAWAN, "Downlink recebido (RX%c, RSSI %d, SNR %d, porta %d, %d bytes)",
+           (downlink.janela == 'C') ? 'C' : ('0' + downlink.janela),
+           downlink.rssi,
+           downlink.snr,
+           downlink.porta,
+           downlink.dados_hex.tamanho / 2);
+
+    if (tratador_downlink != NULL)
+    {
+        tratador_downlink(&downlink);
+    }
+}
+
+/* Função: obtém as métricas da comunicação com o módulo LoRaWAN
+ * Parâmetros: ponteiro para a estrutura que receberá as métricas
+ * Retorno: nenhum
+ */
+void obtem_metricas_lorawan(TMetricas_lorawan *pt_metricas)
+{
+    memcpy(pt_metricas, &metricas_lorawan, sizeof(TMetricas_lorawan));
+}
+
+/* Função: loga resumo das métricas da comunicação com o módulo LoRaWAN e
+ *         seu snapshot binário (em hexadecimal, para decodificação no
+ *         computador com Ferramentas/decodifica_metricas_lorawan)
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+void loga_metricas_lorawan(void)
+{
+    uint8_t snapshot[METRICAS_LORAWAN_TAM_MAX_SNAPSHOT] = {0};
+    char snapshot_hex[(METRICAS_LORAWAN_TAM_MAX_SNAPSHOT * 2) + 1] = {0};
+    int tam_snapshot = 0;
+    int i;
+
+    ESP_LOGI(TAG_LOGS_LORAWAN, "Metricas: %u comandos (%u OK, %u erros, %u BUSY, %u timeouts), UART: %u bytes escritos, %u lidos, %u overflows",
+             metricas_lorawan.total_comandos,
+             metricas_lorawan.total_ok,
+             metricas_lorawan.total_erros,
+             metricas_lorawan.total_busy,
+             metricas_lorawan.total_timeouts,
+             metricas_lorawan.bytes_escritos_uart,
+             metricas_lorawan.bytes_lidos_uart,
+             metricas_lorawan.total_overflows_uart);
+
+    tam_snapshot = metricas_lorawan_gera_snapshot(&metricas_lorawan, snapshot, sizeof(snapshot));
+
+    for (i = 0; i < tam_snapshot; i++)
+    {
+        snprintf(&snapshot_hex[i * 2], 3, "%02X", snapshot[i]);
+    }
+
+    ESP_LOGI(TAG_LOGS_LORAWAN, "Snapshot das metricas: %s", snapshot_hex);
+}
+
+/* Função: registra o tratador de downlinks recebidos (classe A ou C)
+ * Parâmetros: função tratadora (não deve bloquear)
+ * Retorno: nenhum
+ */
+void registra_tratador_downlink_lorawan(TTratador_downlink_lorawan tratador)
+{
+    tratador_downlink = tratador;
+}
+
+/* Função: envia comando AT via UART para módulo LoRaWAN e aguarda seu
+ *         resultado final (OK, ERROR ou BUSY), entregue pelo despachante AT.
+ *         BUSY não é reenviado aqui: o agendador de uplinks só libera o envio
+ *         após a janela de ocupação do módulo, então um BUSY indica erro no
+ *         agendador (fica nas métricas e o uplink permanece na fila).
+ * Parâmetros: - ponteiro para o comando AT
+ *             - tamanho do comando
+ * Retorno: ESP_OK: comando aceito pelo módulo LoRaWAN
+ *          ESP_ERR_INVALID_STATE: módulo respondeu BUSY
+ *          demais: comando recusado pelo módulo (ou sem resposta)
+ */
+esp_err_t envia_comando_uart(char *pt_cmd, int tamanho)
+{
+    esp_err_t resultado;
+
+    resultado = despachante_at_envia_comando(pt_cmd, tamanho,
+                                             buffer_recepcao, sizeof(buffer_recepcao),
+                                             TEMPO_MAX_RESPOSTA_AT);
+    esp_task_wdt_reset();
+
+    if (resultado == ESP_ERR_INVALID_STATE)
+    {
+        LOGD_W(TAG_LOGS_LORAWAN, "BUSY na resposta: %s", buffer_recepcao);
+        return resultado;
+    }
 
-    if (tam > 0)
+    if (resultado != ESP_ERR_TIMEOUT)
     {
-        ESP_LOGI(TAG_LOGS_LORAWAN, "Dados recebidos: %s", buffer_recepcao);
+        ESP_LOGD(TAG_LOGS_LORAWAN, "Dados recebidos: %s", buffer_recepcao);
     }
     else
     {
-        ESP_LOGI(TAG_LOGS_LORAWAN, "Nenhum dado recebido");
+        LOGD_W(TAG_LOGS_LORAWAN, "Nenhum dado recebido");
     }
+
+    return resultado;
 }
 
 /* Função: inicializa UART de comunicação com módulo LoRaWAN
@@ -90,9 +240,28 @@ void inicializa_uart_lorawan(void)
     intr_alloc_flags = ESP_INTR_FLAG_IRAM;
 #endif
 
-    ESP_ERROR_CHECK(uart_driver_install(SENS_LORAWAN_UART_PORT_NUM, BUF_SIZE * 2, 0, 0, NULL, intr_alloc_flags));
+    ESP_ERROR_CHECK(uart_driver_install(SENS_LORAWAN_UART_PORT_NUM, BUF_SIZE * 2, 0,
+                                        DESPACHANTE_AT_TAM_FILA_EVENTOS_UART, &fila_eventos_uart, intr_alloc_flags));
     ESP_ERROR_CHECK(uart_param_config(SENS_LORAWAN_UART_PORT_NUM, &uart_config));
     ESP_ERROR_CHECK(uart_set_pin(SENS_LORAWAN_UART_PORT_NUM, SENS_LORAWAN_TEST_TXD, SENS_LORAWAN_TEST_RXD, SENS_LORAWAN_TEST_RTS, SENS_LORAWAN_TEST_CTS));
+
+    /* Inicializa despachante AT (tarefa leitora da UART): resultados de comandos
+     * vão para envia_comando_uart() e downlinks (inclusive de classe C, a
+     * qualquer momento) para o tratador de downlinks
+     */
+    metricas_lorawan_inicializa(&metricas_lorawan);
+    ESP_ERROR_CHECK(despachante_at_inicializa(SENS_LORAWAN_UART_PORT_NUM, fila_eventos_uart, &metricas_lorawan));
+    ESP_ERROR_CHECK(despachante_at_registra_tratador(DESPACHANTE_AT_PREFIXO_DOWNLINK, trata_evento_downlink, NULL));
+
+    /* Resultados das tentativas de join (OTAA) */
+    fila_resultados_join = xQueueCreate(1, sizeof(bool));
+
+    if (fila_resultados_join == NULL)
+    {
+        ESP_ERROR_CHECK(ESP_ERR_NO_MEM);
+    }
+
+    ESP_ERROR_CHECK(despachante_at_registra_tratador(DESPACHANTE_AT_PREFIXO_JOIN, trata_evento_join, NULL));
 }
 
 /* Função: configura módulo LoRaWAN segundo estrutura de configuração LoRaWAN
@@ -105,6 +274,10 @@ void configurar_lorawan(TConfig_LoRaWAN *pt_lorawan)
 
     esp_task_wdt_reset();
 
+    /* Inicializa agendador de uplinks (mantendo estado e contadores de wake-ups anteriores) */
+    dr_configurado = pt_lorawan->dr - LORAWAN_DR_NIVEL_0;
+    agendador_uplinks_inicializa(&agendador_uplinks, PLANO_FREQUENCIAS_LORAWAN, ORCAMENTO_DIARIO_TEMPO_NO_AR_LORAWAN_MS, instante_atual_ms());
+
     /* Configuração da máscara de canais (para LA915) */
     ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao da mascara de canais em %s ...", pt_lorawan->CHMASK);
     memset(cmd_at, 0x00, sizeof(cmd_at));
@@ -112,40 +285,71 @@ void configurar_lorawan(TConfig_LoRaWAN *pt_lorawan)
     envia_comando_uart(cmd_at, strlen(cmd_at));
     esp_task_wdt_reset();
 
-    /* Configuração do join mode para ABP */
-    ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do join mode ...");
-    memset(cmd_at, 0x00, sizeof(cmd_at));
-    snprintf(cmd_at, sizeof(cmd_at), "AT+NJM=%c\n\r", pt_lorawan->join_mode);
-    envia_comando_uart(cmd_at, strlen(cmd_at));
-    esp_task_wdt_reset();
+    /* Configuração do join mode. Em OTAA, o modo é configurado ao restaurar a
+     * sessão (ou ao fazer o join), no fim da configuração.
+     */
+    modo_otaa = (pt_lorawan->join_mode == LORAWAN_JOIN_MODE_OTAA);
 
-    /* Configuração do endereço LoRaWAN */
-    ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do endereco LoRaWAN em %s ...", pt_lorawan->DEVADDR);
-    memset(cmd_at, 0x00, sizeof(cmd_at));
-    snprintf(cmd_at, sizeof(cmd_at), "AT+DADDR=%s\n\r", pt_lorawan->DEVADDR);
-    envia_comando_uart(cmd_at, strlen(cmd_at));
-    esp_task_wdt_reset();
+    if (modo_otaa == true)
+    {
+        /* Configuração do Device EUI */
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Device EUI em %s ...", pt_lorawan->DEVEUI);
+        memset(cmd_at, 0x00, sizeof(cmd_at));
+        snprintf(cmd_at, sizeof(cmd_at), "AT+DEVEUI=%s\n\r", pt_lorawan->DEVEUI);
+        envia_comando_uart(cmd_at, strlen(cmd_at));
+        esp_task_wdt_reset();
 
-    /* Configuração do Application EUI */
-    ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Application EUI em %s ...", pt_lorawan->APPEUI);
-    memset(cmd_at, 0x00, sizeof(cmd_at));
-    snprintf(cmd_at, sizeof(cmd_at), "AT+APPEUI=%s\n\r", pt_lorawan->APPEUI);
-    envia_comando_uart(cmd_at, strlen(cmd_at));
-    esp_task_wdt_reset();
+        /* Configuração do Application EUI */
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Application EUI em %s ...", pt_lorawan->APPEUI);
+        memset(cmd_at, 0x00, sizeof(cmd_at));
+        snprintf(cmd_at, sizeof(cmd_at), "AT+APPEUI=%s\n\r", pt_lorawan->APPEUI);
+        envia_comando_uart(cmd_at, strlen(cmd_at));
+        esp_task_wdt_reset();
 
-    /* Configuração do Application Session Key */
-    ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Application Session Key em %s ...", pt_lorawan->APPSKEY);
-    memset(cmd_at, 0x00, sizeof(cmd_at));
-    snprintf(cmd_at, sizeof(cmd_at), "AT+APPSKEY=%s\n\r", pt_lorawan->APPSKEY);
-    envia_comando_uart(cmd_at, strlen(cmd_at));
-    esp_task_wdt_reset();
+        /* Configuração do Application Key */
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Application Key ...");
+        memset(cmd_at, 0x00, sizeof(cmd_at));
+        snprintf(cmd_at, sizeof(cmd_at), "AT+APPKEY=%s\n\r", pt_lorawan->APPKEY);
+        envia_comando_uart(cmd_at, strlen(cmd_at));
+        esp_task_wdt_reset();
+    }
+    else
+    {
+        /* Configuração do join mode para ABP */
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do join mode ...");
+        memset(cmd_at, 0x00, sizeof(cmd_at));
+        snprintf(cmd_at, sizeof(cmd_at), "AT+NJM=%c\n\r", pt_lorawan->join_mode);
+        envia_comando_uart(cmd_at, strlen(cmd_at));
+        esp_task_wdt_reset();
 
-    /* Configuração do Network Session Key */
-    ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Network Session Key em %s ...", pt_lorawan->NWSKEY);
-    memset(cmd_at, 0x00, sizeof(cmd_at));
-    snprintf(cmd_at, sizeof(cmd_at), "AT+NWKSKEY=%s\n\r", pt_lorawan->NWSKEY);
-    envia_comando_uart(cmd_at, strlen(cmd_at));
-    esp_task_wdt_reset();
+        /* Configuração do endereço LoRaWAN */
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do endereco LoRaWAN em %s ...", pt_lorawan->DEVADDR);
+        memset(cmd_at, 0x00, sizeof(cmd_at));
+        snprintf(cmd_at, sizeof(cmd_at), "AT+DADDR=%s\n\r", pt_lorawan->DEVADDR);
+        envia_comando_uart(cmd_at, strlen(cmd_at));
+        esp_task_wdt_reset();
+
+        /* Configuração do Application EUI */
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Application EUI em %s ...", pt_lorawan->APPEUI);
+        memset(cmd_at, 0x00, sizeof(cmd_at));
+        snprintf(cmd_at, sizeof(cmd_at), "AT+APPEUI=%s\n\r", pt_lorawan->APPEUI);
+        envia_comando_uart(cmd_at, strlen(cmd_at));
+        esp_task_wdt_reset();
+
+        /* Configuração do Application Session Key */
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Application Session Key em %s ...", pt_lorawan->APPSKEY);
+        memset(cmd_at, 0x00, sizeof(cmd_at));
+        snprintf(cmd_at, sizeof(cmd_at), "AT+APPSKEY=%s\n\r", pt_lorawan->APPSKEY);
+        envia_comando_uart(cmd_at, strlen(cmd_at));
+        esp_task_wdt_reset();
+
+        /* Configuração do Network Session Key */
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do Network Session Key em %s ...", pt_lorawan->NWSKEY);
+        memset(cmd_at, 0x00, sizeof(cmd_at));
+        snprintf(cmd_at, sizeof(cmd_at), "AT+NWKSKEY=%s\n\r", pt_lorawan->NWSKEY);
+        envia_comando_uart(cmd_at, strlen(cmd_at));
+        esp_task_wdt_reset();
+    }
 
     /* Configuração do ADR como desabilitado */
     ESP_LOGI(TAG_LOGS_LORAWAN, "Configuracao do ADR em %c ...", pt_lorawan->adr);
@@ -175,19 +379,551 @@ void configurar_lorawan(TConfig_LoRaWAN *pt_lorawan)
     envia_comando_uart(cmd_at, strlen(cmd_at));
     esp_task_wdt_reset();
 
+    /* Sessão (OTAA): retomada da memória RTC ou da NVS, ou uma tentativa de join */
+    if (modo_otaa == true)
+    {
+        ativa_sessao_lorawan();
+    }
+
     ESP_LOGI(TAG_LOGS_LORAWAN, "Modulo LoRaWAN totalmente configurado");
 }
 
-/* Função: envia payload por LoRaWAN
- * Parâmetros: payload a ser enviado
+/* Função: informa quanto tempo falta para um uplink poder ser feito
+ *         (módulo ocupado, duty cycle e orçamento diário de tempo no ar)
+ * Parâmetros: quantidade de bytes do payload pretendido
+ * Retorno: tempo de espera (ms). 0 = pode enviar agora.
+ *          -1 = payload não pode ser enviado no DR configurado.
+ */
+int64_t tempo_ate_liberar_envio_lorawan_ms(int qtde_bytes)
+{
+    return agendador_uplinks_tempo_ate_liberar_ms(&agendador_uplinks, instante_atual_ms(), dr_configurado, qtde_bytes);
+}
+
+/* Função: obtém o DevAddr do dispositivo (formato dos comandos AT, ex: "26:0B:12:34"):
+ *         em OTAA, o atribuído no join (vazio se ainda não houver sessão);
+ *         em ABP, o da configuração
+ * Parâmetros: estrutura de configuração LoRaWAN
+ * Retorno: DevAddr
+ */
+const char * obtem_dev_addr_lorawan(const TConfig_LoRaWAN *pt_lorawan)
+{
+    if (pt_lorawan->join_mode != LORAWAN_JOIN_MODE_OTAA)
+    {
+        return pt_lorawan->DEVADDR;
+    }
+
+    if (sessao_lorawan_valida(&sessao_lorawan) == false)
+    {
+        dev_addr_sessao[0] = '\0';
+    }
+    else
+    {
+        sessao_lorawan_formata_hex(sessao_lorawan.dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR, dev_addr_sessao);
+    }
+
+    return dev_addr_sessao;
+}
+
+/* Função: obtém os contadores de tempo no ar dos uplinks feitos
+ * Parâmetros: ponteiro para a estrutura que receberá os contadores
  * Retorno: nenhum
  */
-void envia_payload_lorawan(char *pt_payload)
+void obtem_contadores_tempo_no_ar_lorawan(TAgendador_uplinks *pt_contadores)
+{
+    memcpy(pt_contadores, &agendador_uplinks, sizeof(TAgendador_uplinks));
+}
+
+/* Função: envia payload por LoRaWAN, na porta padrão
+ * Parâmetros: payload a ser enviado (bytes em hexadecimal, como string)
+ * Retorno: ver envia_payload_lorawan_na_porta()
+ */
+esp_err_t envia_payload_lorawan(char *pt_payload)
+{
+    return envia_payload_lorawan_na_porta(PORTA_PADRAO_LORAWAN, pt_payload);
+}
+
+/* Função: envia payload por LoRaWAN
+ * Parâmetros: - porta LoRaWAN (FPort) do uplink
+ *             - payload a ser enviado (bytes em hexadecimal, como string)
+ * Retorno: ESP_OK: envio aceito pelo módulo LoRaWAN
+ *          ESP_ERR_TIMEOUT: envio adiado pelo agendador de uplinks (orçamento
+ *                           de tempo no ar ou duty cycle)
+ *          demais: envio recusado pelo módulo (ou payload inválido)
+ */
+esp_err_t envia_payload_lorawan_na_porta(int porta, char *pt_payload)
 {
     char cmd_envio_payload[TAM_MAX_CMD_AT] = {0};
+    esp_err_t status_envio;
+    int qtde_bytes = strlen(pt_payload) / 2;
+    int64_t tempo_espera_ms = 0;
+
+    /* Consulta o agendador: espera curta (módulo ocupado) é aguardada aqui,
+     * evitando respostas de BUSY; espera longa (orçamento/duty cycle) faz
+     * o envio ser adiado
+     */
+    tempo_espera_ms = tempo_ate_liberar_envio_lorawan_ms(qtde_bytes);
+
+    if (tempo_espera_ms < 0)
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN, "Payload de %d bytes nao pode ser enviado em DR%d", qtde_bytes, dr_configurado);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (tempo_espera_ms > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+    {
+        LOGD_I(TAG_LOGS_LORAWAN, "Envio adiado pelo agendador (liberado em %d ms)", (int32_t)tempo_espera_ms);
+        agendador_uplinks_registra_adiamento(&agendador_uplinks);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (modo_otaa == true)
+    {
+        status_envio = prepara_sessao_para_envio();
+
+        if (status_envio != ESP_OK)
+        {
+            return status_envio;
+        }
+
+        /* Uma tentativa de join pode ter ocupado o módulo e o tempo no ar */
+        tempo_espera_ms = tempo_ate_liberar_envio_lorawan_ms(qtde_bytes);
+
+        if (tempo_espera_ms > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+        {
+            LOGD_I(TAG_LOGS_LORAWAN, "Envio adiado pelo agendador (liberado em %d ms)", (int32_t)tempo_espera_ms);
+            agendador_uplinks_registra_adiamento(&agendador_uplinks);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    if (tempo_espera_ms > 0)
+    {
+        vTaskDelay(pdMS_TO_TICKS(tempo_espera_ms));
+        esp_task_wdt_reset();
+    }
 
-    snprintf(cmd_envio_payload, sizeof(cmd_envio_payload), "AT+SENDB=5:%s", pt_payload);
-    ESP_LOGI(TAG_LOGS_LORAWAN, "Comando para envio do payload: %s", cmd_envio_payload);
-    envia_comando_uart(cmd_envio_payload, strlen(cmd_envio_payload));
+    snprintf(cmd_envio_payload, sizeof(cmd_envio_payload), "AT+SENDB=%d:%s\n\r", porta, pt_payload);
+    ESP_LOGD(TAG_LOGS_LORAWAN, "Comando para envio do payload: %s", cmd_envio_payload);
+    status_envio = envia_comando_uart(cmd_envio_payload, strlen(cmd_envio_payload));
     esp_task_wdt_reset();
-}
\ No newline at end of file
+
+    if (status_envio != ESP_OK)
+    {
+        LOGD_E(TAG_LOGS_LORAWAN, "Envio recusado pelo modulo LoRaWAN (%s)", esp_err_to_name(status_envio));
+        return status_envio;
+    }
+
+    agendador_uplinks_registra_envio(&agendador_uplinks, instante_atual_ms(), dr_configurado, qtde_bytes);
+
+    if (modo_otaa == true)
+    {
+        registra_uplink_na_sessao();
+    }
+
+    LOGD_I(TAG_LOGS_LORAWAN, "Tempo no ar: %u us neste uplink, %u ms em %u uplinks (%u adiamentos)",
+           agendador_uplinks.tempo_no_ar_ultimo_uplink_us,
+           (uint32_t)(agendador_uplinks.tempo_no_ar_total_us / 1000),
+           agendador_uplinks.total_uplinks,
+           agendador_uplinks.total_adiamentos);
+
+    return status_envio;
+}
+
+/* Função: tratador do evento de resultado do join (+EVT:JOINED ou
+ *         +EVT:JOIN_FAILED_...), executado na tarefa leitora da UART.
+ *         Repassa o resultado à tentativa de join em andamento.
+ * Parâmetros: - fatia do evento (após o prefixo)
+ *             - contexto (não utilizado)
+ * Retorno: nenhum
+ */
+static void trata_evento_join(TFatia_at evento, void *pt_contexto)
+{
+    bool sucesso = despachante_at_fatia_comeca_com(evento, "ED");
+
+    LOGD_I(TAG_LOGS_LORAWAN, "Resultado do join: %s", sucesso ? "join-accept recebido" : "sem join-accept");
+    xQueueOverwrite(fila_resultados_join, &sucesso);
+}
+
+/* Função: ativa a sessão LoRaWAN (OTAA): retoma a sessão da memória RTC
+ *         (wake-up de deep sleep) ou da NVS (reset ou queda de energia) e a
+ *         restaura no módulo; sem sessão válida, faz uma tentativa de join,
+ *         se o backoff permitir (sem sessão, os envios são adiados)
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void ativa_sessao_lorawan(void)
+{
+    TSessao_lorawan sessao_flash;
+
+    if (inicializa_nvs_lorawan() != ESP_OK)
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN, "NVS indisponivel: sessao LoRaWAN nao pode ser persistida");
+    }
+
+    if ( (sessao_lorawan_valida(&sessao_lorawan) == true) && (sessao_lorawan_expirou(&sessao_lorawan) == false) )
+    {
+        LOGD_I(TAG_LOGS_LORAWAN, "Sessao LoRaWAN retomada da memoria RTC (FCntUp %u)", sessao_lorawan.fcnt_up);
+    }
+    else if ( (le_sessao_lorawan_da_flash(&sessao_flash) == ESP_OK) && (sessao_lorawan_valida(&sessao_flash) == true) )
+    {
+        /* Contadores abaixo do reservado podem ter sido usados depois da gravação */
+        memcpy(&sessao_lorawan, &sessao_flash, sizeof(TSessao_lorawan));
+        sessao_lorawan_retoma_da_flash(&sessao_lorawan);
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Sessao LoRaWAN retomada da NVS (FCntUp %u)", sessao_lorawan.fcnt_up);
+
+        if (sessao_lorawan_expirou(&sessao_lorawan) == true)
+        {
+            sessao_lorawan_invalida(&sessao_lorawan);
+        }
+        else
+        {
+            gravacao_sessao_pendente = true;
+            grava_sessao_lorawan_na_flash();
+        }
+    }
+    else
+    {
+        sessao_lorawan_invalida(&sessao_lorawan);
+    }
+
+    if ( (sessao_lorawan_valida(&sessao_lorawan) == true) && (restaura_sessao_no_modulo() != ESP_OK) )
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN, "Falha ao restaurar a sessao no modulo LoRaWAN. Fazendo novo join...");
+        sessao_lorawan_invalida(&sessao_lorawan);
+    }
+
+    if (sessao_lorawan_valida(&sessao_lorawan) == false)
+    {
+        tenta_join_lorawan();
+    }
+}
+
+/* Função: restaura no módulo LoRaWAN a sessão obtida num join (DevAddr,
+ *         chaves de sessão e contadores de quadros), sem novo join
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: sessão restaurada
+ *          !ESP_OK: módulo recusou algum comando
+ */
+static esp_err_t restaura_sessao_no_modulo(void)
+{
+    char cmd_at[TAM_MAX_CMD_AT] = {0};
+    char campo[SESSAO_LORAWAN_TAM_TEXTO(SESSAO_LORAWAN_TAM_CHAVE)] = {0};
+    esp_err_t resultado;
+
+    /* A sessão do join é usada como uma sessão ABP */
+    snprintf(cmd_at, sizeof(cmd_at), "AT+NJM=%c\n\r", LORAWAN_JOIN_MODE_ABP);
+    resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+
+    if (resultado == ESP_OK)
+    {
+        sessao_lorawan_formata_hex(sessao_lorawan.dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR, campo);
+        snprintf(cmd_at, sizeof(cmd_at), "AT+DADDR=%s\n\r", campo);
+        resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        sessao_lorawan_formata_hex(sessao_lorawan.app_s_key, SESSAO_LORAWAN_TAM_CHAVE, campo);
+        snprintf(cmd_at, sizeof(cmd_at), "AT+APPSKEY=%s\n\r", campo);
+        resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        sessao_lorawan_formata_hex(sessao_lorawan.nwk_s_key, SESSAO_LORAWAN_TAM_CHAVE, campo);
+        snprintf(cmd_at, sizeof(cmd_at), "AT+NWKSKEY=%s\n\r", campo);
+        resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        snprintf(cmd_at, sizeof(cmd_at), "AT+FCU=%u\n\r", sessao_lorawan.fcnt_up);
+        resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        snprintf(cmd_at, sizeof(cmd_at), "AT+FCD=%u\n\r", sessao_lorawan.fcnt_down);
+        resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+    }
+
+    esp_task_wdt_reset();
+    return resultado;
+}
+
+/* Função: faz uma tentativa de join (OTAA), se o backoff permitir: envia o
+ *         join-request no DR da tentativa e aguarda o evento de resultado.
+ *         Com o join-accept, lê a sessão do módulo e a grava na NVS. O
+ *         estado do join fica em memória RTC: o backoff continua nos
+ *         wake-ups seguintes.
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: join feito, sessão ativa
+ *          ESP_ERR_TIMEOUT: próxima tentativa ainda não liberada pelo backoff
+ *          demais: tentativa sem join-accept (a próxima é agendada)
+ */
+static esp_err_t tenta_join_lorawan(void)
+{
+    char cmd_at[TAM_MAX_CMD_AT] = {0};
+    uint8_t dev_addr[SESSAO_LORAWAN_TAM_DEV_ADDR];
+    uint8_t app_s_key[SESSAO_LORAWAN_TAM_CHAVE];
+    uint8_t nwk_s_key[SESSAO_LORAWAN_TAM_CHAVE];
+    int64_t tempo_espera_ms;
+    bool join_aceito = false;
+    esp_err_t resultado;
+    int dr;
+
+    /* Mantém o backoff de um join em andamento (memória RTC) ou começa um novo */
+    sessao_lorawan_join_inicializa(&join_lorawan, PLANO_FREQUENCIAS_LORAWAN, DR_JOIN_INICIAL_LORAWAN, DR_JOIN_MINIMO_LORAWAN,
+                                   esp_random(), instante_atual_ms());
+    tempo_espera_ms = sessao_lorawan_join_tempo_ate_tentativa_ms(&join_lorawan, instante_atual_ms());
+
+    if (tempo_espera_ms > 0)
+    {
+        LOGD_I(TAG_LOGS_LORAWAN, "Sem sessao LoRaWAN. Proxima tentativa de join em %d ms", (int32_t)tempo_espera_ms);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    dr = sessao_lorawan_join_dr(&join_lorawan);
+    ESP_LOGI(TAG_LOGS_LORAWAN, "Tentativa de join %u no DR%d...", join_lorawan.total_tentativas + 1, dr);
+
+    snprintf(cmd_at, sizeof(cmd_at), "AT+NJM=%c\n\r", LORAWAN_JOIN_MODE_OTAA);
+    resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+
+    if (resultado == ESP_OK)
+    {
+        snprintf(cmd_at, sizeof(cmd_at), "AT+DR=%d\n\r", dr);
+        resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        /* Uma tentativa por comando (sem o auto-join do módulo: o backoff é do firmware) */
+        xQueueReset(fila_resultados_join);
+        snprintf(cmd_at, sizeof(cmd_at), "AT+JOIN=1:0:10:1\n\r");
+        resultado = envia_comando_uart(cmd_at, strlen(cmd_at));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        /* O join-request ocupa o canal: entra na conta de tempo no ar do agendador */
+        agendador_uplinks_registra_envio(&agendador_uplinks, instante_atual_ms(), dr,
+                                         SESSAO_LORAWAN_TAM_JOIN_REQUEST - OVERHEAD_PAYLOAD_LORAWAN);
+
+        if (xQueueReceive(fila_resultados_join, &join_aceito, pdMS_TO_TICKS(TEMPO_MAX_RESULTADO_JOIN_LORAWAN_MS)) != pdTRUE)
+        {
+            ESP_LOGE(TAG_LOGS_LORAWAN, "Resultado do join nao recebido em %d ms", TEMPO_MAX_RESULTADO_JOIN_LORAWAN_MS);
+        }
+
+        esp_task_wdt_reset();
+    }
+
+    if (join_aceito == false)
+    {
+        sessao_lorawan_join_registra_falha(&join_lorawan, instante_atual_ms());
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Join sem sucesso (%u tentativas, %u ms no ar)", join_lorawan.total_tentativas,
+                 (uint32_t)(join_lorawan.tempo_no_ar_total_us / 1000));
+        return ESP_FAIL;
+    }
+
+    sessao_lorawan_join_registra_sucesso(&join_lorawan, instante_atual_ms());
+    ESP_LOGI(TAG_LOGS_LORAWAN, "Join feito em %u tentativa(s), %u ms no ar", join_lorawan.total_tentativas,
+             (uint32_t)(join_lorawan.tempo_no_ar_total_us / 1000));
+
+    /* Sessão atribuída no join */
+    if ( (le_campo_sessao_do_modulo("DADDR", dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR) != ESP_OK) ||
+         (le_campo_sessao_do_modulo("APPSKEY", app_s_key, SESSAO_LORAWAN_TAM_CHAVE) != ESP_OK) ||
+         (le_campo_sessao_do_modulo("NWKSKEY", nwk_s_key, SESSAO_LORAWAN_TAM_CHAVE) != ESP_OK) )
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN, "Falha ao ler a sessao do modulo LoRaWAN");
+        return ESP_FAIL;
+    }
+
+    sessao_lorawan_inicia(&sessao_lorawan, dev_addr, app_s_key, nwk_s_key);
+    downlinks_nao_registrados = 0;
+    gravacao_sessao_pendente = true;
+    grava_sessao_lorawan_na_flash();
+
+    /* Uplinks voltam ao DR configurado */
+    snprintf(cmd_at, sizeof(cmd_at), "AT+DR=%d\n\r", dr_configurado);
+    envia_comando_uart(cmd_at, strlen(cmd_at));
+
+    sessao_lorawan_formata_hex(sessao_lorawan.dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR, dev_addr_sessao);
+    ESP_LOGI(TAG_LOGS_LORAWAN, "Sessao LoRaWAN ativa (DevAddr %s)", dev_addr_sessao);
+    return ESP_OK;
+}
+
+/* Função: lê um campo da sessão do módulo LoRaWAN (AT+<campo>=?)
+ * Parâmetros: - nome do campo no comando AT (ex: "DADDR")
+ *             - ponteiro para os bytes lidos e quantidade de bytes esperada
+ * Retorno: ESP_OK: campo lido
+ *          !ESP_OK: comando recusado ou resposta inválida
+ */
+static esp_err_t le_campo_sessao_do_modulo(const char *pt_campo, uint8_t *pt_bytes, int qtde_bytes)
+{
+    char cmd_at[TAM_MAX_CMD_AT] = {0};
+
+    snprintf(cmd_at, sizeof(cmd_at), "AT+%s=?\n\r", pt_campo);
+
+    if (envia_comando_uart(cmd_at, strlen(cmd_at)) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+
+    return (sessao_lorawan_le_hex(buffer_recepcao, pt_bytes, qtde_bytes) == true) ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+/* Função: inicializa a NVS (uma vez por boot), onde a sessão LoRaWAN é persistida
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: NVS inicializada
+ *          !ESP_OK: falha na inicialização
+ */
+static esp_err_t inicializa_nvs_lorawan(void)
+{
+    esp_err_t resultado;
+
+    if (nvs_inicializada == true)
+    {
+        return ESP_OK;
+    }
+
+    resultado = nvs_flash_init();
+
+    if ((resultado == ESP_ERR_NVS_NO_FREE_PAGES) || (resultado == ESP_ERR_NVS_NEW_VERSION_FOUND))
+    {
+        nvs_flash_erase();
+        resultado = nvs_flash_init();
+    }
+
+    nvs_inicializada = (resultado == ESP_OK);
+    return resultado;
+}
+
+/* Função: lê a sessão LoRaWAN gravada na NVS
+ * Parâmetros: ponteiro para a sessão lida (ainda não validada)
+ * Retorno: ESP_OK: sessão lida
+ *          !ESP_OK: sessão nunca gravada ou falha na leitura
+ */
+static esp_err_t le_sessao_lorawan_da_flash(TSessao_lorawan *pt_sessao)
+{
+    nvs_handle handler_particao_nvs;
+    size_t tamanho = sizeof(TSessao_lorawan);
+    esp_err_t resultado;
+
+    resultado = nvs_open(NAMESPACE_NVS_LORAWAN, NVS_READWRITE, &handler_particao_nvs);
+
+    if (resultado != ESP_OK)
+    {
+        return resultado;
+    }
+
+    resultado = nvs_get_blob(handler_particao_nvs, CHAVE_NVS_SESSAO_LORAWAN, pt_sessao, &tamanho);
+    nvs_close(handler_particao_nvs);
+
+    if ((resultado == ESP_OK) && (tamanho != sizeof(TSessao_lorawan)))
+    {
+        resultado = ESP_ERR_INVALID_SIZE;
+    }
+
+    return resultado;
+}
+
+/* Função: grava a sessão LoRaWAN na NVS, se houver gravação pendente
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: sessão gravada (ou nada pendente)
+ *          !ESP_OK: falha na gravação (continua pendente)
+ */
+static esp_err_t grava_sessao_lorawan_na_flash(void)
+{
+    nvs_handle handler_particao_nvs;
+    esp_err_t resultado;
+
+    if (gravacao_sessao_pendente == false)
+    {
+        return ESP_OK;
+    }
+
+    resultado = inicializa_nvs_lorawan();
+
+    if (resultado == ESP_OK)
+    {
+        resultado = nvs_open(NAMESPACE_NVS_LORAWAN, NVS_READWRITE, &handler_particao_nvs);
+    }
+
+    if (resultado != ESP_OK)
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN, "Falha ao abrir particao NVS");
+        return resultado;
+    }
+
+    resultado = nvs_set_blob(handler_particao_nvs, CHAVE_NVS_SESSAO_LORAWAN, &sessao_lorawan, sizeof(TSessao_lorawan));
+
+    if (resultado == ESP_OK)
+    {
+        resultado = nvs_commit(handler_particao_nvs);
+    }
+
+    nvs_close(handler_particao_nvs);
+
+    if (resultado != ESP_OK)
+    {
+        ESP_LOGE(TAG_LOGS_LORAWAN, "Falha ao gravar a sessao LoRaWAN na NVS (%s)", esp_err_to_name(resultado));
+    }
+    else
+    {
+        gravacao_sessao_pendente = false;
+        LOGD_I(TAG_LOGS_LORAWAN, "Sessao LoRaWAN gravada na NVS (contadores reservados ate %u)", sessao_lorawan.fcnt_up_reservado);
+    }
+
+    return resultado;
+}
+
+/* Função: prepara a sessão para um envio: sem sessão (ou com ela expirada),
+ *         faz uma tentativa de join (se o backoff permitir); com a gravação
+ *         da reserva de contadores pendente, grava a sessão antes do envio
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: envio pode ser feito
+ *          ESP_ERR_TIMEOUT: sem sessão (join em andamento): envio adiado
+ *          demais: reserva de contadores não gravada: envio recusado
+ */
+static esp_err_t prepara_sessao_para_envio(void)
+{
+    if (sessao_lorawan_valida(&sessao_lorawan) == false)
+    {
+        if (tenta_join_lorawan() != ESP_OK)
+        {
+            agendador_uplinks_registra_adiamento(&agendador_uplinks);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    /* Um contador acima da reserva gravada poderia ser repetido depois de uma queda de energia */
+    return grava_sessao_lorawan_na_flash();
+}
+
+/* Função: registra na sessão um uplink aceito pelo módulo e os downlinks
+ *         recebidos desde o anterior; grava a sessão na NVS quando o contador
+ *         alcança a reserva e invalida a sessão expirada (novo join no
+ *         próximo envio)
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void registra_uplink_na_sessao(void)
+{
+    uint32_t qtde_downlinks = downlinks_nao_registrados;
+
+    downlinks_nao_registrados -= qtde_downlinks;
+    sessao_lorawan_registra_downlinks(&sessao_lorawan, qtde_downlinks);
+
+    if (sessao_lorawan_registra_uplink(&sessao_lorawan) == true)
+    {
+        gravacao_sessao_pendente = true;
+        grava_sessao_lorawan_na_flash();
+    }
+
+    if (sessao_lorawan_expirou(&sessao_lorawan) == true)
+    {
+        ESP_LOGI(TAG_LOGS_LORAWAN, "Sessao LoRaWAN expirada (FCntUp %u). Novo join no proximo envio.", sessao_lorawan.fcnt_up);
+        sessao_lorawan_invalida(&sessao_lorawan);
+        gravacao_sessao_pendente = false;
+    }
+}
@@ -3,20 +3,60 @@
 #ifndef LORAWAN_DEFS_H
 #define LORAWAN_DEFS_H
 
+#include "../agendador_uplinks/agendador_uplinks.h"
+#include "../despachante_at/despachante_at.h"
+
 /* Definição - tamanho máximo de um comando AT */
 #define TAM_MAX_CMD_AT                   150
 
-/* Definição: tempo entre dois comandos AT */
-#define TEMPO_ENTRE_COMANDOS_AT     1000  //ms
+/* Definição - plano de frequências usado nos uplinks (máscara de canais 00FF:...) */
+#define PLANO_FREQUENCIAS_LORAWAN        PLANO_LA915
+
+/* Definição - orçamento diário de tempo no ar dos uplinks. Padrão: sem
+ *             orçamento (o LA915 não tem limite legal de duty cycle). Em
+ *             redes com fair-use, use ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS
+ *             (os envios passam a ser espaçados/adiados pelo agendador).
+ */
+#define ORCAMENTO_DIARIO_TEMPO_NO_AR_LORAWAN_MS  AGENDADOR_UPLINKS_SEM_ORCAMENTO
+
+/* Definição - tamanho máximo do payload LoRaWAN (DR2 em LA915, com dwell time de 400ms) */
+#define TAM_MAX_PAYLOAD_LORAWAN          11  //bytes
+
+/* Definição - porta LoRaWAN usada por envia_payload_lorawan() */
+#define PORTA_PADRAO_LORAWAN             5
+
+/* Definição - maior espera pelo agendador de uplinks feita dentro de um envio.
+ *             Esperas maiores fazem o envio ser adiado.
+ */
+#define TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS  5000 //ms
+
+/* Definição: tempo máximo de espera pelo resultado (OK/ERROR/BUSY) de um comando AT */
+#define TEMPO_MAX_RESPOSTA_AT       2000  //ms
 
 /* Definições - confirmação de envio */
 #define LORAWAN_ENVIO_COM_CONFIRMACAO    '1'
 #define LORAWAN_ENVIO_SEM_CONFIRMACAO    '0'
 
-/* Definições - Join mode */
+/* Definições - Join mode. Em OTAA, a sessão obtida no join fica em memória
+ *              RTC e na NVS (ver sessao_lorawan): os wake-ups de deep sleep e os
+ *              reboots a retomam sem novo join. Sem sessão, cada wake-up faz no
+ *              máximo uma tentativa de join, quando o backoff permitir.
+ */
 #define LORAWAN_JOIN_MODE_ABP             '0'
 #define LORAWAN_JOIN_MODE_OTAA            '1'
 
+/* Definições - DRs das tentativas de join: a primeira no DR inicial (join-request
+ *              mais curto), descendo até o DR mínimo (LA915: DR0 e DR1 não são
+ *              permitidos com o dwell time de 400 ms)
+ */
+#define DR_JOIN_INICIAL_LORAWAN           5
+#define DR_JOIN_MINIMO_LORAWAN            2
+
+/* Definição - tempo máximo de espera pelo resultado de uma tentativa de join
+ *             (join-accept nas janelas de 5 s e 6 s depois do join-request)
+ */
+#define TEMPO_MAX_RESULTADO_JOIN_LORAWAN_MS 10000 //ms
+
 /* Definições - ADR */
 #define LORAWAN_ADR_DESABILITADO          '0'
 #define LORAWAN_ADR_HABILITADO            '1'
@@ -38,12 +78,14 @@
 /* Estrutura de configuração LoRaWAN */
 typedef struct __attribute__((__packed__))
 {
-    /* Chaves e endereços */
+    /* Chaves e endereços (ABP: DEVADDR, APPSKEY e NWSKEY; OTAA: DEVEUI, APPEUI e APPKEY) */
     char APPSKEY[60];
     char NWSKEY[60];
     char APPEUI[30];
     char DEVADDR[15];
     char CHMASK[35];
+    char DEVEUI[30];
+    char APPKEY[60];
 
     /* Confirmação de envio */
     char confirmacao_de_envio;
@@ -61,9 +103,19 @@ typedef struct __attribute__((__packed__))
     char classe;
 }TConfig_LoRaWAN;
 
+/* Tratador de downlinks recebidos (executado no contexto da tarefa leitora da UART) */
+typedef void (*TTratador_downlink_lorawan)(const TDownlink_at * pt_downlink);
+
 #endif
 
 /* Protótipos */
 void inicializa_uart_lorawan(void);
 void configurar_lorawan(TConfig_LoRaWAN * pt_lorawan);
-void envia_payload_lorawan(char * pt_payload);
\ No newline at end of file
+esp_err_t envia_payload_lorawan(char * pt_payload);
+esp_err_t envia_payload_lorawan_na_porta(int porta, char * pt_payload);
+int64_t tempo_ate_liberar_envio_lorawan_ms(int qtde_bytes);
+void obtem_contadores_tempo_no_ar_lorawan(TAgendador_uplinks * pt_contadores);
+const char * obtem_dev_addr_lorawan(const TConfig_LoRaWAN * pt_lorawan);
+void registra_tratador_downlink_lorawan(TTratador_downlink_lorawan tratador);
+void obtem_metricas_lorawan(TMetricas_lorawan * pt_metricas);
+void loga_metricas_lorawan(void);
\ No newline at end of file
@@ -0,0 +1,222 @@
+/* Módulo: lote de leituras da lixeira (várias leituras por uplink)
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado no computador (ex: pelo decoder dos quadros).
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "lote_leituras.h"
+
+/* Definição - segundos por unidade de tempo do quadro */
+#define SEGUNDOS_POR_UNIDADE        (LOTE_LEITURAS_UNIDADE_TEMPO_MIN * 60)
+
+/* Os registros das leituras (registro leitura_lote) são guardados na fila de uplinks pendentes */
+_Static_assert(LOTE_LEITURAS_TAM_LEITURA <= FILA_UPLINKS_TAM_MAX_DADOS, "registro de leitura nao cabe na fila de uplinks");
+
+/* Funções locais */
+static bool lote_completo(TFila_uplinks * pt_fila, int qtde_leituras, uint32_t instante_atual_s);
+static uint32_t idade_em_unidades(uint32_t instante_atual_s, uint32_t instante_s);
+
+/* Função: verifica se um lote com a quantidade de leituras informada deve ser enviado
+ * Parâmetros: - ponteiro para a fila
+ *             - quantidade de leituras do lote
+ *             - instante atual (em segundos)
+ * Retorno: true: lote completo ou leitura mais antiga velha demais
+ */
+static bool lote_completo(TFila_uplinks * pt_fila, int qtde_leituras, uint32_t instante_atual_s)
+{
+    const TRegistro_uplink * pt_mais_antigo = fila_uplinks_consulta(pt_fila, 0);
+
+    if (qtde_leituras >= LOTE_LEITURAS_QTDE_POR_ENVIO)
+    {
+        return true;
+    }
+
+    return ( (pt_mais_antigo != NULL) &&
+             (instante_atual_s > pt_mais_antigo->instante_s) &&
+             ((instante_atual_s - pt_mais_antigo->instante_s) >= LOTE_LEITURAS_IDADE_MAX_ENVIO_S) );
+}
+
+/* Função: idade de uma leitura, arredondada para unidades do quadro
+ * Parâmetros: - instante atual (em segundos)
+ *             - instante da leitura (em segundos)
+ * Retorno: idade (em unidades de LOTE_LEITURAS_UNIDADE_TEMPO_MIN minutos)
+ */
+static uint32_t idade_em_unidades(uint32_t instante_atual_s, uint32_t instante_s)
+{
+    if (instante_atual_s <= instante_s)
+    {
+        return 0;
+    }
+
+    return (instante_atual_s - instante_s + (SEGUNDOS_POR_UNIDADE / 2)) / SEGUNDOS_POR_UNIDADE;
+}
+
+/* Função: monta o registro de uma leitura, a ser inserido na fila de uplinks
+ * Parâmetros: - distância (cm), ou LOTE_LEITURAS_DISTANCIA_NAO_MEDIDA
+ *             - motivo (LOTE_LEITURAS_MOTIVO_...)
+ *             - ponteiro para o registro (LOTE_LEITURAS_TAM_LEITURA bytes)
+ * Retorno: nenhum
+ */
+void lote_leituras_monta_registro(int32_t distancia_cm, uint8_t motivo, uint8_t * pt_registro)
+{
+    TPayload_leitura_lote leitura;
+
+    /* Distâncias acima do máximo do campo saturam (não dão a volta) */
+    leitura.distancia_cm = distancia_cm;
+    leitura.motivo = motivo;
+    leitura.intervalo = 0.0f;
+    payload_leitura_lote_empacota(&leitura, pt_registro);
+}
+
+/* Função: verifica se o lote pendente na fila deve ser enviado agora
+ * Parâmetros: - ponteiro para a fila
+ *             - instante atual (em segundos)
+ *             - true: envio forçado pela aplicação (tamper, lixeira quase cheia)
+ * Retorno: true: enviar
+ */
+bool lote_leituras_deve_enviar(TFila_uplinks * pt_fila, uint32_t instante_atual_s, bool forca_envio)
+{
+    int qtde_leituras = fila_uplinks_quantidade(pt_fila);
+
+    if (qtde_leituras == 0)
+    {
+        return false;
+    }
+
+    return (forca_envio == true) || lote_completo(pt_fila, qtde_leituras, instante_atual_s);
+}
+
+/* Função: verifica, antes da leitura do wake-up atual, se o lote será enviado
+ *         depois que ela for inserida (para preparar o módulo LoRaWAN só
+ *         quando houver envio)
+ * Parâmetros: - ponteiro para a fila
+ *             - instante atual (em segundos)
+ *             - true: envio forçado pela aplicação
+ * Retorno: true: o lote será enviado neste wake-up
+ */
+bool lote_leituras_envio_previsto(TFila_uplinks * pt_fila, uint32_t instante_atual_s, bool forca_envio)
+{
+    return (forca_envio == true) || lote_completo(pt_fila, fila_uplinks_quantidade(pt_fila) + 1, instante_atual_s);
+}
+
+/* Função: monta o próximo quadro de lote, a partir das leituras mais antigas
+ *         da fila. As leituras só são removidas da fila após a chamada de
+ *         fila_uplinks_confirma_envio().
+ * Parâmetros: - ponteiro para a fila
+ *             - instante atual (em segundos)
+ *             - ponteiro para o buffer do quadro
+ *             - tamanho máximo do quadro (payload máximo do DR em uso)
+ *             - ponteiro para variável que receberá a quantidade de leituras
+ *               contidas no quadro
+ * Retorno: tamanho do quadro montado (0 se não há nada a enviar ou se nem
+ *          uma leitura cabe no tamanho máximo informado)
+ */
+int lote_leituras_monta_quadro(TFila_uplinks * pt_fila, uint32_t instante_atual_s, uint8_t * pt_quadro, int tam_max_quadro, int * pt_qtde_leituras)
+{
+    const TRegistro_uplink * pt_registro;
+    const TRegistro_uplink * pt_seguinte;
+    TPayload_lote_leituras cabecalho;
+    TPayload_leitura_lote leitura;
+    uint32_t intervalo;
+    int qtde_leituras;
+    int tam_quadro = LOTE_LEITURAS_TAM_CABECALHO;
+    int i;
+
+    *pt_qtde_leituras = 0;
+
+    qtde_leituras = (tam_max_quadro - LOTE_LEITURAS_TAM_CABECALHO) / LOTE_LEITURAS_TAM_LEITURA;
+    if (qtde_leituras > fila_uplinks_quantidade(pt_fila))
+    {
+        qtde_leituras = fila_uplinks_quantidade(pt_fila);
+    }
+
+    if (qtde_leituras <= 0)
+    {
+        return 0;
+    }
+
+    /* Cabeçalho: sequência da mais antiga e idade da mais recente do quadro */
+    cabecalho.seq = fila_uplinks_consulta(pt_fila, 0)->seq & 0xFF;
+    cabecalho.idade = (float)(idade_em_unidades(instante_atual_s, fila_uplinks_consulta(pt_fila, qtde_leituras - 1)->instante_s) *
+                              LOTE_LEITURAS_UNIDADE_TEMPO_MIN);
+    payload_lote_leituras_empacota(&cabecalho, pt_quadro);
+
+    /* Leituras: os intervalos são calculados a partir das idades arredondadas,
+     * de forma que os erros de arredondamento não se acumulem
+     */
+    for (i = 0; i < qtde_leituras; i++)
+    {
+        pt_registro = fila_uplinks_consulta(pt_fila, i);
+        intervalo = 0;
+
+        if (i < (qtde_leituras - 1))
+        {
+            pt_seguinte = fila_uplinks_consulta(pt_fila, i + 1);
+            intervalo = idade_em_unidades(instante_atual_s, pt_registro->instante_s) -
+                        idade_em_unidades(instante_atual_s, pt_seguinte->instante_s);
+        }
+
+        /* O registro guardado na fila já está no formato do quadro: só o intervalo (que satura) é preenchido */
+        payload_leitura_lote_desempacota(pt_registro->dados, &leitura);
+        leitura.intervalo = (float)(intervalo * LOTE_LEITURAS_UNIDADE_TEMPO_MIN);
+        payload_leitura_lote_empacota(&leitura, &pt_quadro[tam_quadro]);
+        tam_quadro += LOTE_LEITURAS_TAM_LEITURA;
+    }
+
+    *pt_qtde_leituras = qtde_leituras;
+    return tam_quadro;
+}
+
+/* Função: decodifica um quadro de lote
+ * Parâmetros: - ponteiro para o quadro
+ *             - tamanho do quadro
+ *             - ponteiro para o vetor que receberá as leituras (da mais antiga para a mais recente)
+ *             - tamanho do vetor
+ * Retorno: quantidade de leituras decodificadas, ou -1 se o quadro é inválido
+ */
+int lote_leituras_decodifica(const uint8_t * pt_quadro, int tam_quadro, TLeitura_lote * pt_leituras, int qtde_max_leituras)
+{
+    TPayload_lote_leituras cabecalho;
+    TPayload_leitura_lote leitura;
+    uint32_t idade_min;
+    int qtde_leituras;
+    int i;
+
+    if ( (tam_quadro < (LOTE_LEITURAS_TAM_CABECALHO + LOTE_LEITURAS_TAM_LEITURA)) ||
+         (((tam_quadro - LOTE_LEITURAS_TAM_CABECALHO) % LOTE_LEITURAS_TAM_LEITURA) != 0) )
+    {
+        return -1;
+    }
+
+    qtde_leituras = (tam_quadro - LOTE_LEITURAS_TAM_CABECALHO) / LOTE_LEITURAS_TAM_LEITURA;
+    if (qtde_leituras > qtde_max_leituras)
+    {
+        return -1;
+    }
+
+    /* Idades: da mais recente (cabeçalho) para a mais antiga, somando os intervalos */
+    payload_lote_leituras_desempacota(pt_quadro, &cabecalho);
+    idade_min = (uint32_t)cabecalho.idade;
+
+    for (i = qtde_leituras - 1; i >= 0; i--)
+    {
+        payload_leitura_lote_desempacota(&pt_quadro[LOTE_LEITURAS_TAM_CABECALHO + (i * LOTE_LEITURAS_TAM_LEITURA)], &leitura);
+
+        pt_leituras[i].seq = (uint8_t)(cabecalho.seq + i);
+        pt_leituras[i].distancia_cm = (leitura.distancia_cm == LOTE_LEITURAS_DISTANCIA_NAO_MEDIDA) ? 0xFF : (uint8_t)leitura.distancia_cm;
+        pt_leituras[i].motivo = (uint8_t)leitura.motivo;
+        pt_leituras[i].idade_min = idade_min;
+
+        if (i > 0)
+        {
+            payload_leitura_lote_desempacota(&pt_quadro[LOTE_LEITURAS_TAM_CABECALHO + ((i - 1) * LOTE_LEITURAS_TAM_LEITURA)], &leitura);
+            idade_min += (uint32_t)leitura.intervalo;
+        }
+    }
+
+    return qtde_leituras;
+}
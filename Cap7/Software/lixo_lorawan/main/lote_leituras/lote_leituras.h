@@ -0,0 +1,77 @@
+/* Header file: lote de leituras da lixeira (várias leituras por uplink)
+ *
+ * As leituras de vários wake-ups ficam na fila de uplinks pendentes
+ * (memória RTC) e são enviadas juntas, num quadro compacto, a cada
+ * LOTE_LEITURAS_QTDE_POR_ENVIO leituras, quando a leitura mais antiga
+ * passa de LOTE_LEITURAS_IDADE_MAX_ENVIO_S ou quando a aplicação força o
+ * envio (tamper, lixeira quase cheia). Assim, o cabeçalho LoRaWAN e o
+ * custo fixo de cada transmissão são divididos entre várias leituras.
+ *
+ * Formato do quadro (enviado na porta LOTE_LEITURAS_PORTA), descrito no
+ * esquema dos payloads (payloads/payloads.esquema) e empacotado pelo código
+ * gerado a partir dele:
+ *   cabeçalho (payload lote_leituras):
+ *     seq: número de sequência (8 bits menos significativos) da leitura
+ *          mais antiga do quadro. As seguintes têm números consecutivos.
+ *     idade: idade da leitura mais recente do quadro, em unidades de
+ *            LOTE_LEITURAS_UNIDADE_TEMPO_MIN minutos (satura em 255).
+ *   para cada leitura, da mais antiga para a mais recente (registro leitura_lote):
+ *     distancia_cm: distância (cm, satura em 254), ou 255 se não medida
+ *                   (alerta de tamper)
+ *     motivo: LOTE_LEITURAS_MOTIVO_...
+ *     intervalo: até a leitura seguinte, em unidades de
+ *                LOTE_LEITURAS_UNIDADE_TEMPO_MIN minutos (satura em 63; 0
+ *                na leitura mais recente)
+ * Os registros ficam na fila de uplinks já no formato do quadro (com
+ * intervalo 0), que é preenchido na montagem do quadro.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado no computador (ex: pelo decoder dos quadros).
+ */
+
+#ifndef HEADER_LOTE_LEITURAS
+#define HEADER_LOTE_LEITURAS
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../fila_uplinks/fila_uplinks.h"
+#include "../payloads/payloads.h"
+
+/* Definição - porta LoRaWAN dos quadros de lote (leituras avulsas usam a porta 5) */
+#define LOTE_LEITURAS_PORTA                  PAYLOAD_LOTE_LEITURAS_PORTA
+
+/* Definições - política de envio */
+#define LOTE_LEITURAS_QTDE_POR_ENVIO         4
+#define LOTE_LEITURAS_IDADE_MAX_ENVIO_S      (12 * 3600)
+
+/* Definições - formato do quadro */
+#define LOTE_LEITURAS_TAM_CABECALHO          PAYLOAD_LOTE_LEITURAS_TAM
+#define LOTE_LEITURAS_TAM_LEITURA            PAYLOAD_LEITURA_LOTE_TAM
+#define LOTE_LEITURAS_UNIDADE_TEMPO_MIN      5
+
+/* Definição - distância de uma leitura sem medição (alerta de tamper) */
+#define LOTE_LEITURAS_DISTANCIA_NAO_MEDIDA   ESQUEMA_PAYLOADS_SEM_VALOR
+
+/* Definições - motivo de cada leitura (2 bits) */
+#define LOTE_LEITURAS_MOTIVO_TIMER           0
+#define LOTE_LEITURAS_MOTIVO_TAMPER          1
+#define LOTE_LEITURAS_MOTIVO_TAMPER_DESFEITO 2
+#define LOTE_LEITURAS_MOTIVO_OUTRO           3
+
+/* Leitura decodificada de um quadro */
+typedef struct
+{
+    uint8_t seq;
+    uint8_t distancia_cm;
+    uint8_t motivo;
+    uint32_t idade_min;  // em relação ao envio do quadro
+}TLeitura_lote;
+
+#endif
+
+/* Protótipos */
+void lote_leituras_monta_registro(int32_t distancia_cm, uint8_t motivo, uint8_t * pt_registro);
+bool lote_leituras_deve_enviar(TFila_uplinks * pt_fila, uint32_t instante_atual_s, bool forca_envio);
+bool lote_leituras_envio_previsto(TFila_uplinks * pt_fila, uint32_t instante_atual_s, bool forca_envio);
+int lote_leituras_monta_quadro(TFila_uplinks * pt_fila, uint32_t instante_atual_s, uint8_t * pt_quadro, int tam_max_quadro, int * pt_qtde_leituras);
+int lote_leituras_decodifica(const uint8_t * pt_quadro, int tam_quadro, TLeitura_lote * pt_leituras, int qtde_max_leituras);
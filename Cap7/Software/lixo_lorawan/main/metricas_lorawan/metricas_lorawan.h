@@ -0,0 +1,81 @@
+/* Header file: métricas da comunicação com o módulo LoRaWAN
+ *
+ * Contadores (comandos, erros, BUSY, timeouts, bytes na UART etc.) e
+ * histogramas de latência de comandos AT, com faixas fixas, por tipo de
+ * comando. Atualizar uma métrica custa poucas instruções (sem alocação e
+ * sem ponto flutuante).
+ *
+ * Snapshot binário (little-endian), para log ou uplink de diagnóstico:
+ *   byte 0: versão do formato (METRICAS_LORAWAN_VERSAO_SNAPSHOT)
+ *   byte 1: máscara dos tipos de comando cujos histogramas estão presentes
+ *           (bit n = tipo n; só vão tipos com ao menos um comando)
+ *   bytes 2 a 21: comandos, respostas OK, erros, BUSY, timeouts, overflows
+ *                 da UART (uint16 cada), bytes escritos e bytes lidos da
+ *                 UART (uint32 cada)
+ *   para cada tipo presente na máscara: contagem em cada faixa de latência
+ *           (METRICAS_LORAWAN_QTDE_FAIXAS x uint8, saturada em 255)
+ * Contadores que não cabem em seus campos também são saturados.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado no computador (ver Ferramentas/decodifica_metricas_lorawan).
+ */
+
+#ifndef HEADER_METRICAS_LORAWAN
+#define HEADER_METRICAS_LORAWAN
+
+#include <stdint.h>
+
+/* Definições - tipos de comando AT */
+#define METRICAS_LORAWAN_CMD_CONFIGURACAO     0   // AT+XXX=valor
+#define METRICAS_LORAWAN_CMD_CONSULTA         1   // AT+XXX=? / AT+XXX?
+#define METRICAS_LORAWAN_CMD_ENVIO            2   // AT+SEND / AT+SENDB
+#define METRICAS_LORAWAN_CMD_JOIN             3   // AT+JOIN
+#define METRICAS_LORAWAN_CMD_OUTROS           4   // AT, ATZ e demais
+#define METRICAS_LORAWAN_QTDE_TIPOS_CMD       5
+
+/* Definições - resultado de um comando AT */
+#define METRICAS_LORAWAN_RESULTADO_OK         0
+#define METRICAS_LORAWAN_RESULTADO_ERRO       1
+#define METRICAS_LORAWAN_RESULTADO_BUSY       2
+#define METRICAS_LORAWAN_RESULTADO_TIMEOUT    3
+
+/* Definição - quantidade de faixas de latência dos histogramas. Limites
+ *             superiores (ms): 20, 50, 100, 200, 500, 1000, 2000 e acima.
+ */
+#define METRICAS_LORAWAN_QTDE_FAIXAS          8
+
+/* Definições - snapshot binário */
+#define METRICAS_LORAWAN_VERSAO_SNAPSHOT      1
+#define METRICAS_LORAWAN_TAM_CABECALHO_SNAPSHOT  22   //bytes
+#define METRICAS_LORAWAN_TAM_MAX_SNAPSHOT     (METRICAS_LORAWAN_TAM_CABECALHO_SNAPSHOT + \
+                                               (METRICAS_LORAWAN_QTDE_TIPOS_CMD * METRICAS_LORAWAN_QTDE_FAIXAS))
+
+/* Estrutura das métricas */
+typedef struct
+{
+    uint32_t assinatura;
+
+    /* Contadores */
+    uint32_t total_comandos;
+    uint32_t total_ok;
+    uint32_t total_erros;
+    uint32_t total_busy;
+    uint32_t total_timeouts;
+    uint32_t total_overflows_uart;
+    uint32_t bytes_escritos_uart;
+    uint32_t bytes_lidos_uart;
+
+    /* Histogramas de latência, por tipo de comando */
+    uint16_t histograma[METRICAS_LORAWAN_QTDE_TIPOS_CMD][METRICAS_LORAWAN_QTDE_FAIXAS];
+    uint32_t latencia_max_ms[METRICAS_LORAWAN_QTDE_TIPOS_CMD];
+}TMetricas_lorawan;
+
+#endif
+
+/* Protótipos */
+void metricas_lorawan_inicializa(TMetricas_lorawan * pt_metricas);
+void metricas_lorawan_zera(TMetricas_lorawan * pt_metricas);
+int metricas_lorawan_tipo_comando(const char * pt_cmd, int tamanho);
+int metricas_lorawan_faixa_latencia(uint32_t latencia_ms);
+void metricas_lorawan_registra_comando(TMetricas_lorawan * pt_metricas, int tipo_cmd, int resultado, uint32_t latencia_ms);
+int metricas_lorawan_gera_snapshot(TMetricas_lorawan * pt_metricas, uint8_t * pt_snapshot, int tam_max_snapshot);
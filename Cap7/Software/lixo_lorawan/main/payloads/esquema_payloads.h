@@ -0,0 +1,38 @@
+/* Header file: tipos comuns dos módulos de payloads gerados
+ *
+ * O módulo payloads.c / payloads.h é gerado por Ferramentas/gera_payloads a
+ * partir do esquema dos payloads da aplicação (payloads.esquema). Este
+ * header traz os tipos usados pela tabela de payloads, que permite a um
+ * decoder genérico (Ferramentas/decodifica_payloads) decodificar qualquer
+ * payload descrito no esquema.
+ */
+
+#ifndef HEADER_ESQUEMA_PAYLOADS
+#define HEADER_ESQUEMA_PAYLOADS
+
+#include <stdint.h>
+
+/* Definição - valor físico de um campo inteiro "não medido" (sem_valor no esquema) */
+#define ESQUEMA_PAYLOADS_SEM_VALOR   INT32_MIN
+
+/* Campo de um payload */
+typedef struct
+{
+    const char * pt_nome;
+    const char * pt_unidade;
+    double escala;              // resolução do valor físico (passo de um valor bruto)
+}TEsquema_campo;
+
+/* Payload (ou registro) descrito no esquema */
+typedef struct
+{
+    const char * pt_nome;
+    int porta;                  // 0: registro (parte de outro payload)
+    int tam;                    // bytes (parte fixa, se houver registro repetido)
+    int qtde_campos;
+    const TEsquema_campo * pt_campos;
+    void (* decodifica)(const uint8_t * pt_quadro, double * pt_valores);
+    int idx_repetido;           // índice do registro repetido até o fim do payload, ou -1
+}TEsquema_payload;
+
+#endif
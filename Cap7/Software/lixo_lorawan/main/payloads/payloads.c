@@ -0,0 +1,209 @@
+/* Módulo: payloads LoRaWAN - lixeira
+ *
+ * ARQUIVO GERADO por Ferramentas/gera_payloads a partir de payloads.esquema.
+ * Não editar: altere o esquema e gere novamente (make -C Ferramentas payloads).
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também é compilado
+ *      no computador (decoder dos payloads).
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "payloads.h"
+
+/* Funções locais */
+static int64_t satura_inteiro(int64_t valor, int64_t min, int64_t max);
+static int64_t satura_real(float valor, int64_t min, int64_t max);
+static void decodifica_leitura_lote(const uint8_t * pt_quadro, double * pt_valores);
+static void decodifica_lote_leituras(const uint8_t * pt_quadro, double * pt_valores);
+
+/* Campos do registro leitura_lote */
+static const TEsquema_campo campos_leitura_lote[] =
+{
+    { "distancia_cm", "cm", 1 },
+    { "motivo", "", 1 },
+    { "intervalo", "min", 5 },
+};
+
+/* Campos do payload lote_leituras */
+static const TEsquema_campo campos_lote_leituras[] =
+{
+    { "seq", "", 1 },
+    { "idade", "min", 5 },
+};
+
+/* Tabela dos payloads (decoder genérico) */
+const TEsquema_payload payloads_cap7[QTDE_PAYLOADS_CAP7] =
+{
+    { "leitura_lote", 0, PAYLOAD_LEITURA_LOTE_TAM, 3, campos_leitura_lote, decodifica_leitura_lote, -1 },
+    { "lote_leituras", 6, PAYLOAD_LOTE_LEITURAS_TAM, 2, campos_lote_leituras, decodifica_lote_leituras, 0 },
+};
+
+/* Função: satura um valor inteiro na faixa de um campo
+ * Parâmetros: - valor
+ *             - valores mínimo e máximo
+ * Retorno: valor saturado
+ */
+static int64_t satura_inteiro(int64_t valor, int64_t min, int64_t max)
+{
+    if (valor < min)
+    {
+        return min;
+    }
+
+    return (valor > max) ? max : valor;
+}
+
+/* Função: arredonda e satura um valor (já em unidades brutas) na faixa de um campo
+ * Parâmetros: - valor
+ *             - valores mínimo e máximo
+ * Retorno: valor bruto
+ */
+static int64_t satura_real(float valor, int64_t min, int64_t max)
+{
+    if (!(valor > (float)min))
+    {
+        return min;
+    }
+
+    if (valor >= (float)max)
+    {
+        return max;
+    }
+
+    return (int64_t)lroundf(valor);
+}
+
+/* Função: empacota o registro leitura_lote
+ * Parâmetros: - ponteiro para os valores
+ *             - ponteiro para o quadro (PAYLOAD_LEITURA_LOTE_TAM bytes)
+ * Retorno: nenhum
+ */
+void payload_leitura_lote_empacota(const TPayload_leitura_lote * pt_payload, uint8_t * pt_quadro)
+{
+    int64_t bruto;
+
+    memset(pt_quadro, 0, PAYLOAD_LEITURA_LOTE_TAM);
+
+    /* distancia_cm */
+    if (pt_payload->distancia_cm == ESQUEMA_PAYLOADS_SEM_VALOR)
+    {
+        bruto = 255;
+    }
+    else
+    {
+        bruto = satura_inteiro(pt_payload->distancia_cm, 0, 254);
+    }
+    pt_quadro[0] |= (uint8_t)(bruto & 0xFFU);
+
+    /* motivo */
+    bruto = satura_inteiro(pt_payload->motivo, 0, 3);
+    pt_quadro[1] |= (uint8_t)((bruto & 0x3U) << 6);
+
+    /* intervalo */
+    bruto = satura_real(pt_payload->intervalo / 5.0f, 0, 63);
+    pt_quadro[1] |= (uint8_t)(bruto & 0x3FU);
+}
+
+/* Função: desempacota o registro leitura_lote
+ * Parâmetros: - ponteiro para o quadro (PAYLOAD_LEITURA_LOTE_TAM bytes)
+ *             - ponteiro para os valores
+ * Retorno: nenhum
+ */
+void payload_leitura_lote_desempacota(const uint8_t * pt_quadro, TPayload_leitura_lote * pt_payload)
+{
+    uint32_t bruto;
+
+    /* distancia_cm */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[0] & 0xFFU);
+    if (bruto == (uint32_t)255)
+    {
+        pt_payload->distancia_cm = ESQUEMA_PAYLOADS_SEM_VALOR;
+    }
+    else
+    {
+        pt_payload->distancia_cm = (int32_t)bruto;
+    }
+
+    /* motivo */
+    bruto = 0;
+    bruto |= (uint32_t)((pt_quadro[1] >> 6) & 0x3U);
+    pt_payload->motivo = (int32_t)bruto;
+
+    /* intervalo */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[1] & 0x3FU);
+    pt_payload->intervalo = (float)bruto * 5.0f;
+}
+
+/* Função: decodifica o registro leitura_lote para o decoder genérico
+ * Parâmetros: - ponteiro para o quadro (PAYLOAD_LEITURA_LOTE_TAM bytes)
+ *             - ponteiro para os valores (um por campo, NAN se sem valor)
+ * Retorno: nenhum
+ */
+static void decodifica_leitura_lote(const uint8_t * pt_quadro, double * pt_valores)
+{
+    TPayload_leitura_lote payload;
+
+    payload_leitura_lote_desempacota(pt_quadro, &payload);
+    pt_valores[0] = (payload.distancia_cm == ESQUEMA_PAYLOADS_SEM_VALOR) ? NAN : (double)payload.distancia_cm;
+    pt_valores[1] = (double)payload.motivo;
+    pt_valores[2] = (double)payload.intervalo;
+}
+
+/* Função: empacota o payload lote_leituras
+ * Parâmetros: - ponteiro para os valores
+ *             - ponteiro para o quadro (PAYLOAD_LOTE_LEITURAS_TAM bytes)
+ * Retorno: nenhum
+ */
+void payload_lote_leituras_empacota(const TPayload_lote_leituras * pt_payload, uint8_t * pt_quadro)
+{
+    int64_t bruto;
+
+    memset(pt_quadro, 0, PAYLOAD_LOTE_LEITURAS_TAM);
+
+    /* seq */
+    bruto = satura_inteiro(pt_payload->seq, 0, 255);
+    pt_quadro[0] |= (uint8_t)(bruto & 0xFFU);
+
+    /* idade */
+    bruto = satura_real(pt_payload->idade / 5.0f, 0, 255);
+    pt_quadro[1] |= (uint8_t)(bruto & 0xFFU);
+}
+
+/* Função: desempacota o payload lote_leituras
+ * Parâmetros: - ponteiro para o quadro (PAYLOAD_LOTE_LEITURAS_TAM bytes)
+ *             - ponteiro para os valores
+ * Retorno: nenhum
+ */
+void payload_lote_leituras_desempacota(const uint8_t * pt_quadro, TPayload_lote_leituras * pt_payload)
+{
+    uint32_t bruto;
+
+    /* seq */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[0] & 0xFFU);
+    pt_payload->seq = (int32_t)bruto;
+
+    /* idade */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[1] & 0xFFU);
+    pt_payload->idade = (float)bruto * 5.0f;
+}
+
+/* Função: decodifica o payload lote_leituras para o decoder genérico
+ * Parâmetros: - ponteiro para o quadro (PAYLOAD_LOTE_LEITURAS_TAM bytes)
+ *             - ponteiro para os valores (um por campo, NAN se sem valor)
+ * Retorno: nenhum
+ */
+static void decodifica_lote_leituras(const uint8_t * pt_quadro, double * pt_valores)
+{
+    TPayload_lote_leituras payload;
+
+    payload_lote_leituras_desempacota(pt_quadro, &payload);
+    pt_valores[0] = (double)payload.seq;
+    pt_valores[1] = (double)payload.idade;
+}
@@ -0,0 +1,64 @@
+/* Header file: payloads LoRaWAN - lixeira
+ *
+ * ARQUIVO GERADO por Ferramentas/gera_payloads a partir de payloads.esquema.
+ * Não editar: altere o esquema e gere novamente (make -C Ferramentas payloads).
+ *
+ * Campos em bits, do bit mais significativo de cada byte para o menos
+ * significativo (big-endian). Valor físico = bruto x escala + deslocamento.
+ *
+ * Registro leitura_lote (2 bytes):
+ *   bits   0..  7: distancia_cm (u8, bruto 0..254, sem valor = 255) cm
+ *   bits   8..  9: motivo (u2, bruto 0..3)
+ *   bits  10.. 15: intervalo (u6, x 5, bruto 0..63) min
+ *
+ * Payload lote_leituras (porta 6, 2 bytes + registros repetidos):
+ *   bits   0..  7: seq (u8, bruto 0..255)
+ *   bits   8.. 15: idade (u8, x 5, bruto 0..255) min
+ *   seguido de registros leitura_lote até o fim do payload
+ */
+
+#ifndef HEADER_PAYLOADS_CAP7
+#define HEADER_PAYLOADS_CAP7
+
+#include <stdint.h>
+#include "esquema_payloads.h"
+
+/* Registro leitura_lote */
+#define PAYLOAD_LEITURA_LOTE_TAM                 2   //bytes
+#define PAYLOAD_LEITURA_LOTE_DISTANCIA_CM_MAX    254
+#define PAYLOAD_LEITURA_LOTE_MOTIVO_MAX          3
+
+typedef struct
+{
+    int32_t distancia_cm;  // cm
+    int32_t motivo;
+    float intervalo;  // min
+}TPayload_leitura_lote;
+
+_Static_assert(PAYLOAD_LEITURA_LOTE_TAM <= 242, "payload leitura_lote maior que o maximo do esquema");
+
+/* Payload lote_leituras */
+#define PAYLOAD_LOTE_LEITURAS_PORTA              6
+#define PAYLOAD_LOTE_LEITURAS_TAM                2   //bytes
+#define PAYLOAD_LOTE_LEITURAS_SEQ_MAX            255
+
+typedef struct
+{
+    int32_t seq;
+    float idade;  // min
+}TPayload_lote_leituras;
+
+_Static_assert(PAYLOAD_LOTE_LEITURAS_TAM + PAYLOAD_LEITURA_LOTE_TAM <= 11, "payload lote_leituras maior que o maximo do esquema");
+
+/* Tabela dos payloads (decoder genérico) */
+#define QTDE_PAYLOADS_CAP7                       2
+
+extern const TEsquema_payload payloads_cap7[QTDE_PAYLOADS_CAP7];
+
+#endif
+
+/* Protótipos */
+void payload_leitura_lote_empacota(const TPayload_leitura_lote * pt_payload, uint8_t * pt_quadro);
+void payload_leitura_lote_desempacota(const uint8_t * pt_quadro, TPayload_leitura_lote * pt_payload);
+void payload_lote_leituras_empacota(const TPayload_lote_leituras * pt_payload, uint8_t * pt_quadro);
+void payload_lote_leituras_desempacota(const uint8_t * pt_quadro, TPayload_lote_leituras * pt_payload);
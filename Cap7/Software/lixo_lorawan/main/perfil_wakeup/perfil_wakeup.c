@@ -0,0 +1,198 @@
+/* Módulo: perfil de tempo acordado por fase do ciclo de wake-up
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include "perfil_wakeup.h"
+
+/* Definição - assinatura que indica perfil válido na memória RTC */
+#define ASSINATURA_PERFIL_WAKEUP     0x50574B31  // "PWK1"
+
+/* Nomes das fases (para logs) */
+static const char * nomes_fases[PERFIL_WAKEUP_QTDE_FASES] = {
+    "boot", "tamper", "uart", "config_lorawan", "inicia_sensor", "le_sensor", "paralelo", "envio", "total"
+};
+
+/* Funções locais */
+static uint32_t calcula_checksum_perfil(TPerfil_wakeup * pt_perfil);
+static void acumula_estatisticas(TEstatisticas_fase * pt_estatisticas, uint32_t duracao_us);
+
+/* Função: calcula checksum do perfil (para validar conteúdo mantido em memória RTC)
+ * Parâmetros: ponteiro para o perfil
+ * Retorno: checksum calculado
+ */
+static uint32_t calcula_checksum_perfil(TPerfil_wakeup * pt_perfil)
+{
+    const uint8_t * pt_byte = (const uint8_t *)pt_perfil;
+    uint32_t checksum = 0x811C9DC5;
+    int i;
+
+    /* FNV-1a sobre toda a estrutura, exceto o próprio campo de checksum */
+    for (i = 0; i < (int)offsetof(TPerfil_wakeup, checksum); i++)
+    {
+        checksum = (checksum ^ pt_byte[i]) * 0x01000193;
+    }
+
+    return checksum;
+}
+
+/* Função: acumula uma duração nas estatísticas de uma fase
+ * Parâmetros: - ponteiro para as estatísticas
+ *             - duração (us)
+ * Retorno: nenhum
+ */
+static void acumula_estatisticas(TEstatisticas_fase * pt_estatisticas, uint32_t duracao_us)
+{
+    if ( (pt_estatisticas->qtde == 0) || (duracao_us < pt_estatisticas->minimo_us) )
+    {
+        pt_estatisticas->minimo_us = duracao_us;
+    }
+
+    if (duracao_us > pt_estatisticas->maximo_us)
+    {
+        pt_estatisticas->maximo_us = duracao_us;
+    }
+
+    pt_estatisticas->soma_us += duracao_us;
+    pt_estatisticas->qtde++;
+}
+
+/* Função: inicializa perfil. Se o perfil contido na memória for válido
+ *         (preservado em memória RTC durante o deep sleep), seu conteúdo é
+ *         mantido. Caso contrário, é zerado.
+ * Parâmetros: ponteiro para o perfil
+ * Retorno: nenhum
+ */
+void perfil_wakeup_inicializa(TPerfil_wakeup * pt_perfil)
+{
+    if ( (pt_perfil->assinatura == ASSINATURA_PERFIL_WAKEUP) &&
+         (pt_perfil->checksum == calcula_checksum_perfil(pt_perfil)) )
+    {
+        return;
+    }
+
+    memset(pt_perfil, 0x00, sizeof(TPerfil_wakeup));
+    pt_perfil->assinatura = ASSINATURA_PERFIL_WAKEUP;
+    pt_perfil->checksum = calcula_checksum_perfil(pt_perfil);
+}
+
+/* Função: inicia um ciclo de wake-up. O tempo decorrido desde o reset até
+ *         aqui é contabilizado como fase de boot.
+ * Parâmetros: - ponteiro para o perfil
+ *             - instante atual, contado a partir do reset (us)
+ * Retorno: nenhum
+ */
+void perfil_wakeup_inicia_ciclo(TPerfil_wakeup * pt_perfil, uint32_t instante_us)
+{
+    memset(pt_perfil->duracao_ciclo_us, 0x00, sizeof(pt_perfil->duracao_ciclo_us));
+    pt_perfil->inicio_ciclo_us = 0;
+    pt_perfil->ultima_marca_us = instante_us;
+    pt_perfil->duracao_ciclo_us[PERFIL_WAKEUP_FASE_BOOT] = instante_us;
+    pt_perfil->checksum = calcula_checksum_perfil(pt_perfil);
+}
+
+/* Função: marca o fim de uma fase. A duração da fase é o tempo decorrido
+ *         desde a marca anterior (fases repetidas num ciclo são somadas).
+ * Parâmetros: - ponteiro para o perfil
+ *             - fase que terminou (PERFIL_WAKEUP_FASE_...)
+ *             - instante atual (us)
+ * Retorno: nenhum
+ */
+void perfil_wakeup_marca_fim_fase(TPerfil_wakeup * pt_perfil, int fase, uint32_t instante_us)
+{
+    if ( (fase < 0) || (fase >= PERFIL_WAKEUP_FASE_TOTAL) )
+    {
+        return;
+    }
+
+    pt_perfil->duracao_ciclo_us[fase] += (instante_us - pt_perfil->ultima_marca_us);
+    pt_perfil->ultima_marca_us = instante_us;
+}
+
+/* Função: registra a duração de uma fase executada em paralelo com outras
+ *         (medida pela própria tarefa que a executa). Não altera a marca
+ *         anterior do ciclo, de forma que pode ser chamada por outra tarefa
+ *         enquanto o ciclo está em andamento (cada fase deve ser registrada
+ *         por uma única tarefa).
+ * Parâmetros: - ponteiro para o perfil
+ *             - fase (PERFIL_WAKEUP_FASE_...)
+ *             - duração da fase (us)
+ * Retorno: nenhum
+ */
+void perfil_wakeup_registra_fase(TPerfil_wakeup * pt_perfil, int fase, uint32_t duracao_us)
+{
+    if ( (fase < 0) || (fase >= PERFIL_WAKEUP_FASE_TOTAL) )
+    {
+        return;
+    }
+
+    pt_perfil->duracao_ciclo_us[fase] += duracao_us;
+}
+
+/* Função: encerra o ciclo de wake-up, acumulando suas durações nas
+ *         estatísticas da janela
+ * Parâmetros: - ponteiro para o perfil
+ *             - instante atual (us)
+ * Retorno: true: a janela de estatísticas foi fechada neste ciclo
+ *          false: janela ainda em andamento
+ */
+bool perfil_wakeup_encerra_ciclo(TPerfil_wakeup * pt_perfil, uint32_t instante_us)
+{
+    bool janela_fechada = false;
+    int fase;
+
+    pt_perfil->duracao_ciclo_us[PERFIL_WAKEUP_FASE_TOTAL] = instante_us - pt_perfil->inicio_ciclo_us;
+
+    for (fase = 0; fase < PERFIL_WAKEUP_QTDE_FASES; fase++)
+    {
+        acumula_estatisticas(&pt_perfil->janela_atual[fase], pt_perfil->duracao_ciclo_us[fase]);
+    }
+
+    pt_perfil->total_ciclos++;
+    pt_perfil->ciclos_janela++;
+
+    if (pt_perfil->ciclos_janela >= PERFIL_WAKEUP_CICLOS_POR_JANELA)
+    {
+        memcpy(pt_perfil->janela_fechada, pt_perfil->janela_atual, sizeof(pt_perfil->janela_fechada));
+        memset(pt_perfil->janela_atual, 0x00, sizeof(pt_perfil->janela_atual));
+        pt_perfil->ciclos_janela = 0;
+        janela_fechada = true;
+    }
+
+    pt_perfil->checksum = calcula_checksum_perfil(pt_perfil);
+    return janela_fechada;
+}
+
+/* Função: obtém o nome de uma fase (para logs)
+ * Parâmetros: fase (PERFIL_WAKEUP_FASE_...)
+ * Retorno: nome da fase
+ */
+const char * perfil_wakeup_nome_fase(int fase)
+{
+    if ( (fase < 0) || (fase >= PERFIL_WAKEUP_QTDE_FASES) )
+    {
+        return "?";
+    }
+
+    return nomes_fases[fase];
+}
+
+/* Função: calcula a duração média de uma fase numa janela
+ * Parâmetros: ponteiro para as estatísticas da fase
+ * Retorno: duração média (us). 0 se não há ciclos na janela.
+ */
+uint32_t perfil_wakeup_media_us(const TEstatisticas_fase * pt_estatisticas)
+{
+    if (pt_estatisticas->qtde == 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t)(pt_estatisticas->soma_us / pt_estatisticas->qtde);
+}
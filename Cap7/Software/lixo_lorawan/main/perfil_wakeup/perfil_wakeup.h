@@ -0,0 +1,75 @@
+/* Header file: perfil de tempo acordado por fase do ciclo de wake-up
+ *
+ * A cada wake-up, a aplicação marca o fim de cada fase do ciclo (boot,
+ * tamper, UART, configuração LoRaWAN, sensor, envio) com o instante atual.
+ * Fases executadas em paralelo (em outras tarefas) registram sua própria
+ * duração; o tempo de parede do trecho paralelo inteiro é uma fase à parte.
+ * A duração de cada fase é acumulada, numa estrutura mantida em memória
+ * RTC, em estatísticas (mínimo, média e máximo) de uma janela de
+ * PERFIL_WAKEUP_CICLOS_POR_JANELA ciclos. Ao fim de cada janela, as
+ * estatísticas são fechadas (ficam disponíveis para log/diagnóstico) e uma
+ * nova janela começa.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+#ifndef HEADER_PERFIL_WAKEUP
+#define HEADER_PERFIL_WAKEUP
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definições - fases do ciclo de wake-up */
+#define PERFIL_WAKEUP_FASE_BOOT              0   // do reset até o início da aplicação
+#define PERFIL_WAKEUP_FASE_TAMPER            1   // configura_tamper() e espera do tamper
+#define PERFIL_WAKEUP_FASE_UART              2   // inicializa_uart_lorawan()
+#define PERFIL_WAKEUP_FASE_CONFIG_LORAWAN    3   // configurar_lorawan()
+#define PERFIL_WAKEUP_FASE_INICIA_SENSOR     4   // inicializa_sensor()
+#define PERFIL_WAKEUP_FASE_LE_SENSOR         5   // le_sensor()
+#define PERFIL_WAKEUP_FASE_PARALELO          6   // módulo LoRaWAN e sensor em paralelo, até ambos terminarem
+#define PERFIL_WAKEUP_FASE_ENVIO             7   // fila de uplinks e envia_payload_lorawan()
+#define PERFIL_WAKEUP_FASE_TOTAL             8   // ciclo inteiro (tempo acordado)
+#define PERFIL_WAKEUP_QTDE_FASES             9
+
+/* Definição - quantidade de ciclos de uma janela de estatísticas */
+#define PERFIL_WAKEUP_CICLOS_POR_JANELA      48  // 1 dia, com wake-up a cada 30 minutos
+
+/* Estatísticas de uma fase numa janela */
+typedef struct
+{
+    uint32_t minimo_us;
+    uint32_t maximo_us;
+    uint64_t soma_us;
+    uint16_t qtde;
+}TEstatisticas_fase;
+
+/* Estrutura do perfil (mantida em memória RTC pela aplicação) */
+typedef struct
+{
+    uint32_t assinatura;
+    uint32_t total_ciclos;
+
+    /* Ciclo em andamento */
+    uint32_t inicio_ciclo_us;
+    uint32_t ultima_marca_us;
+    uint32_t duracao_ciclo_us[PERFIL_WAKEUP_QTDE_FASES];
+
+    /* Janela em andamento e última janela fechada */
+    uint16_t ciclos_janela;
+    TEstatisticas_fase janela_atual[PERFIL_WAKEUP_QTDE_FASES];
+    TEstatisticas_fase janela_fechada[PERFIL_WAKEUP_QTDE_FASES];
+
+    uint32_t checksum;
+}TPerfil_wakeup;
+
+#endif
+
+/* Protótipos */
+void perfil_wakeup_inicializa(TPerfil_wakeup * pt_perfil);
+void perfil_wakeup_inicia_ciclo(TPerfil_wakeup * pt_perfil, uint32_t instante_us);
+void perfil_wakeup_marca_fim_fase(TPerfil_wakeup * pt_perfil, int fase, uint32_t instante_us);
+void perfil_wakeup_registra_fase(TPerfil_wakeup * pt_perfil, int fase, uint32_t duracao_us);
+bool perfil_wakeup_encerra_ciclo(TPerfil_wakeup * pt_perfil, uint32_t instante_us);
+const char * perfil_wakeup_nome_fase(int fase);
+uint32_t perfil_wakeup_media_us(const TEstatisticas_fase * pt_estatisticas);
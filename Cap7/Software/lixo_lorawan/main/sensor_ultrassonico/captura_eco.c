@@ -0,0 +1,164 @@
+/* Módulo de captura do eco do sensor ultrassônico por hardware (MCPWM) */
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "driver/gpio.h"
+#include "driver/mcpwm.h"
+#include "soc/rtc.h"
+#include "captura_eco.h"
+
+/* Definições - unidade e canal de captura do MCPWM usados pelo eco */
+#define UNIDADE_MCPWM_ECO                MCPWM_UNIT_0
+#define CANAL_CAPTURA_ECO                MCPWM_SELECT_CAP0
+#define SINAL_CAPTURA_ECO                MCPWM_CAP_0
+
+/* Definição - velocidade do som: cm por us, ida e volta (343 m/s / 2) */
+#define CM_POR_US_IDA_E_VOLTA            0.01715f
+
+/* Tag de debug */
+static const char* TAG_LOGS_CAPTURA_ECO = "CAPTURA_ECO";
+
+/* Estado da captura (compartilhado com a ISR) */
+static QueueHandle_t fila_capturas_eco = NULL;
+static int gpio_trigger_eco = -1;
+static volatile uint32_t contagem_borda_subida = 0;
+static volatile bool borda_subida_capturada = false;
+static volatile uint32_t tempo_isr_us = 0;
+
+/* Funções locais */
+static bool trata_captura_eco(mcpwm_unit_t mcpwm, mcpwm_capture_channel_id_t cap_channel, const cap_event_data_t * edata, void * user_data);
+
+/*
+ *  Callback da ISR de captura do MCPWM (bordas do eco)
+ */
+static bool IRAM_ATTR trata_captura_eco(mcpwm_unit_t mcpwm, mcpwm_capture_channel_id_t cap_channel, const cap_event_data_t * edata, void * user_data)
+{
+    BaseType_t tarefa_acordada = pdFALSE;
+    int64_t instante_entrada_us = esp_timer_get_time();
+    TCaptura_eco captura;
+
+    if (edata->cap_edge == MCPWM_POS_EDGE)
+    {
+        contagem_borda_subida = edata->cap_value;
+        borda_subida_capturada = true;
+        tempo_isr_us += (uint32_t)(esp_timer_get_time() - instante_entrada_us);
+        return false;
+    }
+
+    /* Borda de descida sem a de subida deste pulso (ex: eco de um pulso anterior): ignora */
+    if (borda_subida_capturada == false)
+    {
+        return false;
+    }
+
+    borda_subida_capturada = false;
+    captura.contagem = edata->cap_value - contagem_borda_subida;   // contador de 32 bits: a subtração trata o estouro
+    tempo_isr_us += (uint32_t)(esp_timer_get_time() - instante_entrada_us);
+    captura.tempo_isr_us = tempo_isr_us;
+    xQueueSendFromISR(fila_capturas_eco, &captura, &tarefa_acordada);
+
+    return (tarefa_acordada == pdTRUE);
+}
+
+/* Função: inicializa a captura do eco (GPIOs de trigger e eco, canal de captura do MCPWM)
+ * Parâmetros: - GPIO de trigger
+ *             - GPIO de eco
+ * Retorno: ESP_OK: captura inicializada
+ *          ESP_ERR_NO_MEM: falha ao criar a fila de capturas
+ *          demais: erro ao configurar GPIO / MCPWM
+ */
+esp_err_t captura_eco_inicializa(int gpio_trigger, int gpio_echo)
+{
+    gpio_config_t io_conf_trigger = {};
+    mcpwm_capture_config_t config_captura = {};
+    esp_err_t status;
+
+    if (fila_capturas_eco == NULL)
+    {
+        fila_capturas_eco = xQueueCreate(TAM_FILA_CAPTURAS_ECO, sizeof(TCaptura_eco));
+    }
+
+    if (fila_capturas_eco == NULL)
+    {
+        ESP_LOGE(TAG_LOGS_CAPTURA_ECO, "Falha ao criar fila de capturas");
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Trigger: saída, em nível baixo */
+    io_conf_trigger.intr_type = GPIO_INTR_DISABLE;
+    io_conf_trigger.mode = GPIO_MODE_OUTPUT;
+    io_conf_trigger.pin_bit_mask = (1ULL<<gpio_trigger);
+    io_conf_trigger.pull_down_en = 0;
+    io_conf_trigger.pull_up_en = 0;
+    gpio_config(&io_conf_trigger);
+    gpio_set_level(gpio_trigger, 0);
+    gpio_trigger_eco = gpio_trigger;
+
+    /* Eco: entrada do canal de captura, nas duas bordas */
+    status = mcpwm_gpio_init(UNIDADE_MCPWM_ECO, SINAL_CAPTURA_ECO, gpio_echo);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAG_LOGS_CAPTURA_ECO, "Falha ao configurar GPIO de eco (%s)", esp_err_to_name(status));
+        return status;
+    }
+
+    config_captura.cap_edge = MCPWM_BOTH_EDGE;
+    config_captura.cap_prescale = 1;
+    config_captura.capture_cb = trata_captura_eco;
+    config_captura.user_data = NULL;
+    status = mcpwm_capture_enable_channel(UNIDADE_MCPWM_ECO, CANAL_CAPTURA_ECO, &config_captura);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAG_LOGS_CAPTURA_ECO, "Falha ao habilitar captura do MCPWM (%s)", esp_err_to_name(status));
+    }
+
+    return status;
+}
+
+/* Função: dispara um pulso do sensor. Retorna logo após o trigger; o eco é
+ *         capturado por hardware e obtido com captura_eco_aguarda().
+ * Parâmetros: nenhum
+ * Retorno: tempo de CPU usado no disparo (us)
+ */
+uint32_t captura_eco_dispara(void)
+{
+    int64_t instante_inicio_us = esp_timer_get_time();
+
+    /* Descarta capturas de pulsos anteriores (ex: eco que chegou após o tempo máximo) */
+    xQueueReset(fila_capturas_eco);
+    borda_subida_capturada = false;
+    tempo_isr_us = 0;
+
+    gpio_set_level(gpio_trigger_eco, 1);
+    esp_rom_delay_us(DURACAO_PULSO_TRIGGER_US);
+    gpio_set_level(gpio_trigger_eco, 0);
+
+    return (uint32_t)(esp_timer_get_time() - instante_inicio_us);
+}
+
+/* Função: aguarda a captura do eco do último pulso disparado. A tarefa fica
+ *         bloqueada (CPU livre) até a ISR de captura ou o tempo máximo.
+ * Parâmetros: - ponteiro para a captura
+ *             - tempo máximo de espera (ticks)
+ * Retorno: ESP_OK: eco capturado
+ *          ESP_ERR_TIMEOUT: sem eco no tempo máximo
+ */
+esp_err_t captura_eco_aguarda(TCaptura_eco * pt_captura, TickType_t tempo_max)
+{
+    uint32_t frequencia_apb_hz;
+
+    if (xQueueReceive(fila_capturas_eco, pt_captura, tempo_max) != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    frequencia_apb_hz = rtc_clk_apb_freq_get();
+    pt_captura->duracao_ns = (uint32_t)(((uint64_t)pt_captura->contagem * 1000000000ULL) / frequencia_apb_hz);
+    pt_captura->distancia_cm = ((float)pt_captura->duracao_ns / 1000.0f) * CM_POR_US_IDA_E_VOLTA;
+
+    return ESP_OK;
+}
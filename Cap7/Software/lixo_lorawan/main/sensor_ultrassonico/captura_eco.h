@@ -0,0 +1,39 @@
+/* Header file do módulo de captura do eco do sensor ultrassônico por hardware
+ *
+ * O pulso de trigger é gerado pelo GPIO e as bordas do eco são marcadas no
+ * tempo pelo periférico de captura do MCPWM (contador do clock APB, 80 MHz:
+ * resolução de 12,5 ns). A cada borda de descida do eco, a ISR de captura
+ * calcula a duração do eco e a coloca numa fila: durante o tempo de voo, a
+ * CPU fica livre (a tarefa que aguarda a fila fica bloqueada). Uso:
+ * captura_eco_dispara() e, depois (em seguida ou após outro processamento),
+ * captura_eco_aguarda().
+ */
+
+#ifndef CAPTURA_ECO_DEFS_H
+#define CAPTURA_ECO_DEFS_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+/* Definição - tamanho da fila de capturas */
+#define TAM_FILA_CAPTURAS_ECO            2
+
+/* Definição - duração do pulso de trigger do HC-SR04 */
+#define DURACAO_PULSO_TRIGGER_US         10
+
+/* Captura de um eco */
+typedef struct
+{
+    uint32_t contagem;       // duração do eco em ciclos do clock APB
+    uint32_t duracao_ns;     // duração do eco
+    uint32_t tempo_isr_us;   // tempo de CPU nas ISRs de captura deste eco
+    float distancia_cm;
+}TCaptura_eco;
+
+#endif
+
+/* Prototipos */
+esp_err_t captura_eco_inicializa(int gpio_trigger, int gpio_echo);
+uint32_t captura_eco_dispara(void);
+esp_err_t captura_eco_aguarda(TCaptura_eco * pt_captura, TickType_t tempo_max);
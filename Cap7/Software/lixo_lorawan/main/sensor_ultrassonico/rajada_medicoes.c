@@ -0,0 +1,205 @@
+/* Módulo: rajada de medições do sensor ultrassônico com término antecipado
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "rajada_medicoes.h"
+
+/* Funções locais */
+static float mediana_aceitas(TRajada_medicoes * pt_rajada);
+static float dispersao_aceitas(TRajada_medicoes * pt_rajada);
+static void conclui(TRajada_medicoes * pt_rajada, uint32_t tempo_decorrido_ms);
+
+/* Função: calcula a mediana das leituras aceitas
+ * Parâmetros: ponteiro para a rajada
+ * Retorno: mediana (cm)
+ */
+static float mediana_aceitas(TRajada_medicoes * pt_rajada)
+{
+    float ordenadas[RAJADA_QTDE_CONFIRMACAO];
+    float valor;
+    int qtde = pt_rajada->qtde_aceitas;
+    int i;
+    int j;
+
+    /* Ordenação por inserção: poucas leituras */
+    for (i = 0; i < qtde; i++)
+    {
+        valor = pt_rajada->aceitas[i];
+        for (j = i; (j > 0) && (ordenadas[j - 1] > valor); j--)
+        {
+            ordenadas[j] = ordenadas[j - 1];
+        }
+        ordenadas[j] = valor;
+    }
+
+    if ((qtde % 2) == 0)
+    {
+        return (ordenadas[(qtde / 2) - 1] + ordenadas[qtde / 2]) / 2.0f;
+    }
+
+    return ordenadas[qtde / 2];
+}
+
+/* Função: calcula a dispersão (máximo - mínimo) das leituras aceitas
+ * Parâmetros: ponteiro para a rajada
+ * Retorno: dispersão (cm)
+ */
+static float dispersao_aceitas(TRajada_medicoes * pt_rajada)
+{
+    float minimo = pt_rajada->aceitas[0];
+    float maximo = pt_rajada->aceitas[0];
+    int i;
+
+    for (i = 1; i < pt_rajada->qtde_aceitas; i++)
+    {
+        if (pt_rajada->aceitas[i] < minimo)
+        {
+            minimo = pt_rajada->aceitas[i];
+        }
+
+        if (pt_rajada->aceitas[i] > maximo)
+        {
+            maximo = pt_rajada->aceitas[i];
+        }
+    }
+
+    return maximo - minimo;
+}
+
+/* Função: conclui a rajada, definindo distância e qualidade do resultado
+ * Parâmetros: - ponteiro para a rajada
+ *             - tempo desde o início da rajada (ms)
+ * Retorno: nenhum
+ */
+static void conclui(TRajada_medicoes * pt_rajada, uint32_t tempo_decorrido_ms)
+{
+    TResultado_rajada * pt_resultado = &pt_rajada->resultado;
+
+    pt_resultado->tempo_ligado_ms = tempo_decorrido_ms;
+
+    if ( (pt_rajada->qtde_aceitas == RAJADA_QTDE_CONFIRMACAO) &&
+         (dispersao_aceitas(pt_rajada) <= RAJADA_DISPERSAO_MAX_CM) )
+    {
+        pt_resultado->qualidade = RAJADA_QUALIDADE_BOA;
+        pt_resultado->distancia_cm = mediana_aceitas(pt_rajada);
+    }
+    else if (pt_rajada->qtde_aceitas >= RAJADA_QTDE_MIN_DEGRADADA)
+    {
+        pt_resultado->qualidade = RAJADA_QUALIDADE_DEGRADADA;
+        pt_resultado->distancia_cm = mediana_aceitas(pt_rajada);
+    }
+    else
+    {
+        pt_resultado->qualidade = RAJADA_QUALIDADE_FALHA;
+        pt_resultado->distancia_cm = 0.0f;
+    }
+}
+
+/* Função: inicia uma rajada de medições
+ * Parâmetros: ponteiro para a rajada
+ * Retorno: nenhum
+ */
+void rajada_medicoes_inicia(TRajada_medicoes * pt_rajada)
+{
+    memset(pt_rajada, 0x00, sizeof(TRajada_medicoes));
+    pt_rajada->resultado.qualidade = RAJADA_QUALIDADE_FALHA;
+}
+
+/* Função: registra uma leitura da rajada e verifica se ela pode terminar
+ * Parâmetros: - ponteiro para a rajada
+ *             - true: sensor retornou leitura; false: erro (ex: sem eco)
+ *             - distância lida (cm)
+ *             - distância máxima válida (cm)
+ *             - tempo desde o início da rajada (ms)
+ * Retorno: RAJADA_CONTINUA: fazer outra leitura; RAJADA_CONCLUIDA: resultado disponível
+ */
+int rajada_medicoes_registra(TRajada_medicoes * pt_rajada, bool leitura_ok, float distancia_cm, float distancia_max_cm, uint32_t tempo_decorrido_ms)
+{
+    TResultado_rajada * pt_resultado = &pt_rajada->resultado;
+    float diferenca;
+
+    pt_resultado->qtde_leituras++;
+
+    if ( (leitura_ok == false) || (distancia_cm <= 0.0f) || (distancia_cm >= distancia_max_cm) )
+    {
+        pt_resultado->qtde_erros++;
+    }
+    else
+    {
+        diferenca = (pt_rajada->qtde_aceitas >= RAJADA_QTDE_MIN_OUTLIER) ? (distancia_cm - mediana_aceitas(pt_rajada)) : 0.0f;
+
+        if ((diferenca > RAJADA_LIMIAR_OUTLIER_CM) || (diferenca < -RAJADA_LIMIAR_OUTLIER_CM))
+        {
+            pt_resultado->qtde_outliers++;
+            pt_rajada->outliers_seguidos++;
+
+            /* Nível mudou durante a rajada: recomeça com as leituras novas */
+            if (pt_rajada->outliers_seguidos >= RAJADA_QTDE_MIN_OUTLIER)
+            {
+                pt_rajada->qtde_aceitas = 0;
+                pt_rajada->idx_proxima = 0;
+                pt_rajada->outliers_seguidos = 0;
+            }
+        }
+        else
+        {
+            pt_rajada->outliers_seguidos = 0;
+            pt_rajada->aceitas[pt_rajada->idx_proxima] = distancia_cm;
+            pt_rajada->idx_proxima = (pt_rajada->idx_proxima + 1) % RAJADA_QTDE_CONFIRMACAO;
+
+            if (pt_rajada->qtde_aceitas < RAJADA_QTDE_CONFIRMACAO)
+            {
+                pt_rajada->qtde_aceitas++;
+            }
+
+            if ( (pt_rajada->qtde_aceitas == RAJADA_QTDE_CONFIRMACAO) &&
+                 (dispersao_aceitas(pt_rajada) <= RAJADA_DISPERSAO_MAX_CM) )
+            {
+                conclui(pt_rajada, tempo_decorrido_ms);
+                return RAJADA_CONCLUIDA;
+            }
+        }
+    }
+
+    if ( (pt_resultado->qtde_leituras >= RAJADA_QTDE_MAX_LEITURAS) || (tempo_decorrido_ms >= RAJADA_TEMPO_MAX_MS) )
+    {
+        conclui(pt_rajada, tempo_decorrido_ms);
+        return RAJADA_CONCLUIDA;
+    }
+
+    return RAJADA_CONTINUA;
+}
+
+/* Função: obtém o resultado da rajada (válido após RAJADA_CONCLUIDA)
+ * Parâmetros: ponteiro para a rajada
+ * Retorno: ponteiro para o resultado
+ */
+const TResultado_rajada * rajada_medicoes_resultado(TRajada_medicoes * pt_rajada)
+{
+    return &pt_rajada->resultado;
+}
+
+/* Função: obtém o nome de uma qualidade de resultado (para logs)
+ * Parâmetros: qualidade (RAJADA_QUALIDADE_...)
+ * Retorno: nome
+ */
+const char * rajada_medicoes_nome_qualidade(uint8_t qualidade)
+{
+    switch (qualidade)
+    {
+        case RAJADA_QUALIDADE_BOA:
+            return "boa";
+
+        case RAJADA_QUALIDADE_DEGRADADA:
+            return "degradada";
+
+        default:
+            return "falha";
+    }
+}
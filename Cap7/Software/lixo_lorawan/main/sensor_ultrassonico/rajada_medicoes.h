@@ -0,0 +1,71 @@
+/* Header file: rajada de medições do sensor ultrassônico com término antecipado
+ *
+ * Com o sensor ligado, as leituras são feitas em sequência, com o menor
+ * intervalo permitido entre pulsos, e entregues uma a uma a este módulo.
+ * Leituras com erro (sem eco, fora da faixa) são descartadas e leituras
+ * distantes da mediana das últimas aceitas são rejeitadas como outliers
+ * (ecos espúrios). A rajada termina assim que:
+ * - as últimas RAJADA_QTDE_CONFIRMACAO leituras aceitas variam menos de
+ *   RAJADA_DISPERSAO_MAX_CM (qualidade boa), ou
+ * - o tempo máximo ou a quantidade máxima de leituras é atingido: o
+ *   resultado é a mediana das leituras aceitas (qualidade degradada) ou
+ *   nenhum, se não há leituras suficientes (falha).
+ * Se várias leituras seguidas são rejeitadas, o nível mudou durante a
+ * rajada (ex: lixo jogado) e as leituras aceitas são descartadas.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+#ifndef HEADER_RAJADA_MEDICOES
+#define HEADER_RAJADA_MEDICOES
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definições - critério de término e rejeição de outliers */
+#define RAJADA_QTDE_CONFIRMACAO          5     // leituras aceitas que precisam concordar
+#define RAJADA_DISPERSAO_MAX_CM          2.0   // máximo - mínimo dessas leituras
+#define RAJADA_LIMIAR_OUTLIER_CM         10.0  // distância da mediana para rejeitar a leitura
+#define RAJADA_QTDE_MIN_OUTLIER          3     // leituras aceitas para começar a rejeitar outliers
+#define RAJADA_QTDE_MIN_DEGRADADA        3     // leituras aceitas para um resultado degradado
+#define RAJADA_QTDE_MAX_LEITURAS         20
+#define RAJADA_TEMPO_MAX_MS              1500
+
+/* Definições - estado da rajada após cada leitura */
+#define RAJADA_CONTINUA                  0
+#define RAJADA_CONCLUIDA                 1
+
+/* Definições - qualidade do resultado */
+#define RAJADA_QUALIDADE_BOA             0
+#define RAJADA_QUALIDADE_DEGRADADA       1
+#define RAJADA_QUALIDADE_FALHA           2
+
+/* Resultado da rajada */
+typedef struct
+{
+    float distancia_cm;
+    uint8_t qualidade;
+    uint8_t qtde_leituras;      // pulsos disparados
+    uint8_t qtde_erros;         // leituras sem eco ou fora da faixa
+    uint8_t qtde_outliers;      // leituras rejeitadas por distância da mediana
+    uint32_t tempo_ligado_ms;   // sensor ligado, do início da rajada ao resultado
+}TResultado_rajada;
+
+/* Estado da rajada */
+typedef struct
+{
+    float aceitas[RAJADA_QTDE_CONFIRMACAO];
+    uint8_t idx_proxima;
+    uint8_t qtde_aceitas;
+    uint8_t outliers_seguidos;
+    TResultado_rajada resultado;
+}TRajada_medicoes;
+
+#endif
+
+/* Protótipos */
+void rajada_medicoes_inicia(TRajada_medicoes * pt_rajada);
+int rajada_medicoes_registra(TRajada_medicoes * pt_rajada, bool leitura_ok, float distancia_cm, float distancia_max_cm, uint32_t tempo_decorrido_ms);
+const TResultado_rajada * rajada_medicoes_resultado(TRajada_medicoes * pt_rajada);
+const char * rajada_medicoes_nome_qualidade(uint8_t qualidade);
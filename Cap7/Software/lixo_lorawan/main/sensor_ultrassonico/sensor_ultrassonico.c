@@ -4,21 +4,90 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "driver/gpio.h"
+#include "esp_timer.h"
 #include "sensor_ultrassonico.h"
 
-/* Biblioteca do HC-SR04 (https://github.com/UncleRus/esp-idf-lib/) */
+/* Log diferido: nível de log deste módulo. As leituras individuais são
+ * logadas em nível debug e, portanto, não são compiladas.
+ */
+#define LOG_DIFERIDO_NIVEL_MODULO  LOG_DIFERIDO_NIVEL_INFO
+#include "log_diferido/log_diferido.h"
+
+/* Eco medido pelo periférico de captura do MCPWM (CPU livre durante o tempo de voo)
+ * ou pela biblioteca do HC-SR04 (https://github.com/UncleRus/esp-idf-lib/), que
+ * aguarda o eco em espera ocupada
+ */
+#if CONFIG_LIXO_SENSOR_CAPTURA_HARDWARE
+#include "captura_eco.h"
+#define NOME_MEDICAO_ECO                        "captura MCPWM"
+#else
 #include <ultrasonic.h>
+#define NOME_MEDICAO_ECO                        "ultrasonic_measure"
+#endif
+
+/* Intervalo mínimo entre pulsos do HC-SR04 (ciclo de medição do datasheet),
+ * para que o eco de um pulso não seja lido como eco do seguinte
+ */
+#define TEMPO_MIN_ENTRE_PULSOS_MS               60
 
-/* Tamanho do buffer do sensor ultrassônico e tempo entre leituras */
-#define TAM_BUFFER_DISTANCIAS                   100
-#define TEMPO_ENTRE_LEITURAS                    100 //ms
+/* Tempo máximo de espera do eco na captura por hardware: sem obstáculo, o
+ * HC-SR04 mantém o eco em nível alto por cerca de 38 ms
+ */
+#define TEMPO_MAX_ECO_MS                        40
 
 /* Tag de debug */
 static const char* TAG_LOGS_SENSORES = "SENSORES";
 
 /* Variáveis especificas do sensor ultrassônico */
+#if !CONFIG_LIXO_SENSOR_CAPTURA_HARDWARE
 ultrasonic_sensor_t sensor_ultrassonico;
-float buffer_sensor_ultrassonico[TAM_BUFFER_DISTANCIAS] = {0.0};
+#endif
+
+/* Funções locais */
+static esp_err_t mede_distancia(float * pt_distancia_cm, uint32_t * pt_tempo_cpu_us);
+
+/* Função: dispara um pulso e mede a distância pelo eco
+ * Parâmetros: - ponteiro para a distância medida (cm)
+ *             - ponteiro para o tempo de CPU ocupada na medição (us)
+ * Retorno: ESP_OK: distância medida; demais: erro (ex: sem eco)
+ */
+static esp_err_t mede_distancia(float * pt_distancia_cm, uint32_t * pt_tempo_cpu_us)
+{
+#if CONFIG_LIXO_SENSOR_CAPTURA_HARDWARE
+    TCaptura_eco captura;
+    uint32_t tempo_disparo_us;
+    int64_t instante_inicio_us;
+    esp_err_t status;
+
+    /* Enquanto a tarefa aguarda a captura, a CPU fica livre: conta apenas o
+     * disparo, as ISRs de captura e o tratamento do resultado
+     */
+    tempo_disparo_us = captura_eco_dispara();
+    status = captura_eco_aguarda(&captura, pdMS_TO_TICKS(TEMPO_MAX_ECO_MS));
+
+    instante_inicio_us = esp_timer_get_time();
+    *pt_tempo_cpu_us = tempo_disparo_us;
+    if (status == ESP_OK)
+    {
+        *pt_distancia_cm = captura.distancia_cm;
+        LOGD_D(TAG_LOGS_SENSORES, "Eco: %u ns", captura.duracao_ns);
+        *pt_tempo_cpu_us += captura.tempo_isr_us;
+    }
+    *pt_tempo_cpu_us += (uint32_t)(esp_timer_get_time() - instante_inicio_us);
+
+    return status;
+#else
+    int64_t instante_inicio_us = esp_timer_get_time();
+    esp_err_t status;
+
+    /* A biblioteca aguarda o eco em espera ocupada: toda a medição ocupa a CPU */
+    status = ultrasonic_measure(&sensor_ultrassonico, MAX_DISTANCE_CM, pt_distancia_cm);
+    *pt_distancia_cm = *pt_distancia_cm*100.0;
+    *pt_tempo_cpu_us = (uint32_t)(esp_timer_get_time() - instante_inicio_us);
+
+    return status;
+#endif
+}
 
 /* Função: inicializa sensor
  * Parâmetros: ponteiro para estrutura de configuração do sensor
@@ -27,8 +96,6 @@ float buffer_sensor_ultrassonico[TAM_BUFFER_DISTANCIAS] = {0.0};
 void inicializa_sensor(TConfig_sensores * pt_config_sensores)
 {
     gpio_config_t io_conf_liga_desliga = {};    
-    int cont_leituras = 0;
-    float distancia_lida = 0.0;
 
     /* Configura liga/desliga do sensor */     
     io_conf_liga_desliga.intr_type = GPIO_INTR_DISABLE;  //Desabilita interrupção    
@@ -39,78 +106,72 @@ void inicializa_sensor(TConfig_sensores * pt_config_sensores)
     gpio_config(&io_conf_liga_desliga);
 
     /* Configura sensor HC-SR04 */     
+#if CONFIG_LIXO_SENSOR_CAPTURA_HARDWARE
+    captura_eco_inicializa(pt_config_sensores->gpio_trigger, pt_config_sensores->gpio_echo);
+#else
     sensor_ultrassonico.trigger_pin = pt_config_sensores->gpio_trigger;
     sensor_ultrassonico.echo_pin = pt_config_sensores->gpio_echo;
     ultrasonic_init(&sensor_ultrassonico);
-
-    /* Preenche buffer de distâncias */
-    cont_leituras = 1;
-    while (cont_leituras < TAM_BUFFER_DISTANCIAS)
-    {
-        esp_task_wdt_reset();
-
-        if (ultrasonic_measure(&sensor_ultrassonico, MAX_DISTANCE_CM, &distancia_lida) != ESP_OK) 
-        {
-            ESP_LOGE(TAG_LOGS_SENSORES, "erro ao ler sensor ultrassonico. Tentando novamente em 1s ...");   
-            vTaskDelay(pdMS_TO_TICKS(1000));
-        }
-        else
-        {
-            distancia_lida = distancia_lida*100.0;             
-            buffer_sensor_ultrassonico[cont_leituras] = distancia_lida;
-            ESP_LOGI(TAG_LOGS_SENSORES, "Leitura %d: %.2fcm", cont_leituras, buffer_sensor_ultrassonico[cont_leituras]);   
-            cont_leituras++;
-            vTaskDelay(pdMS_TO_TICKS(TEMPO_ENTRE_LEITURAS));
-        }
-    }
+#endif
 }
 
-/* Função: le sensor de distância
- * Parâmetros: ponteiro para leitura do sensor
+/* Função: le sensor de distância numa rajada de medições, que termina assim
+ *         que as leituras concordam ou no tempo máximo (ver rajada_medicoes.h)
+ * Parâmetros: - ponteiro para estrutura de configuração do sensor
+ *             - ponteiro para o resultado (distância, qualidade, leituras e tempo ligado)
  * Retorno: nenhum 
  */
-void le_sensor(TConfig_sensores * pt_config_sensores, float * pt_distancia_cm)
+void le_sensor(TConfig_sensores * pt_config_sensores, TResultado_rajada * pt_resultado)
 {
+    TRajada_medicoes rajada;
     float distancia_medida = 0.0;
-    float soma_distancias = 0.0;
-    int i = 0;
+    bool leitura_ok;
+    int64_t instante_inicio_us;
+    int64_t instante_pulso_us;
+    int64_t tempo_pulso_ms;
+    uint32_t tempo_cpu_us = 0;
+    uint32_t tempo_cpu_total_us = 0;
+
+    rajada_medicoes_inicia(&rajada);
 
     /* Le HC-SR04 */
     gpio_set_level(pt_config_sensores->gpio_liga_desliga, 1);
+    instante_inicio_us = esp_timer_get_time();
 
-    while (1)
+    do
     {
         esp_task_wdt_reset();
-        
-        if (ultrasonic_measure(&sensor_ultrassonico, MAX_DISTANCE_CM, &distancia_medida) != ESP_OK) 
+
+        instante_pulso_us = esp_timer_get_time();
+        leitura_ok = (mede_distancia(&distancia_medida, &tempo_cpu_us) == ESP_OK);
+        tempo_cpu_total_us += tempo_cpu_us;
+        LOGD_D(TAG_LOGS_SENSORES, "Leitura: ok=%d %.2f cm", leitura_ok, distancia_medida);
+
+        if (rajada_medicoes_registra(&rajada, leitura_ok, distancia_medida, MAX_DISTANCE_CM,
+                                     (uint32_t)((esp_timer_get_time() - instante_inicio_us) / 1000)) == RAJADA_CONCLUIDA)
         {
-            ESP_LOGE(TAG_LOGS_SENSORES, "erro ao ler sensor ultrassonico. Tentando novamente em 1s ...");   
-            vTaskDelay(pdMS_TO_TICKS(TEMPO_ENTRE_LEITURAS));
+            break;
         }
-        else
-        {
-            /* Aplica filtro de média móvel */
-            for(i=0; i<(TAM_BUFFER_DISTANCIAS-1); i++)
-            {
-                buffer_sensor_ultrassonico[i] = buffer_sensor_ultrassonico[i+1];
-            }
 
-            distancia_medida = distancia_medida*100.0;
-            buffer_sensor_ultrassonico[TAM_BUFFER_DISTANCIAS-1] = distancia_medida;
-
-            soma_distancias = 0.0;
-            for(i=0; i<TAM_BUFFER_DISTANCIAS; i++)
-            {
-                soma_distancias = soma_distancias + buffer_sensor_ultrassonico[i];
-                ESP_LOGI(TAG_LOGS_SENSORES, "Valor: %.2f cm; Soma: %.2f cm", buffer_sensor_ultrassonico[i], soma_distancias);   
-            }
+        /* Próximo pulso após o intervalo mínimo */
+        tempo_pulso_ms = (esp_timer_get_time() - instante_pulso_us) / 1000;
+        if (tempo_pulso_ms < TEMPO_MIN_ENTRE_PULSOS_MS)
+        {
+            vTaskDelay(pdMS_TO_TICKS(TEMPO_MIN_ENTRE_PULSOS_MS - tempo_pulso_ms));
+        }
+    } while (1);
 
-            *pt_distancia_cm = soma_distancias/TAM_BUFFER_DISTANCIAS;
+    gpio_set_level(pt_config_sensores->gpio_liga_desliga, 0);    
+    *pt_resultado = *rajada_medicoes_resultado(&rajada);
+    LOGD_I(TAG_LOGS_SENSORES, "Eco (%s): CPU ocupada por %u us em media por leitura",
+           NOME_MEDICAO_ECO, tempo_cpu_total_us / pt_resultado->qtde_leituras);
 
-            break;
-        }
+    if (pt_resultado->qualidade == RAJADA_QUALIDADE_FALHA)
+    {
+        ESP_LOGE(TAG_LOGS_SENSORES, "Sem leitura valida do sensor ultrassonico (%u leituras, %u erros, %u outliers)",
+                 pt_resultado->qtde_leituras, pt_resultado->qtde_erros, pt_resultado->qtde_outliers);
+        return;
     }
 
-    gpio_set_level(pt_config_sensores->gpio_liga_desliga, 0);    
-    ESP_LOGI(TAG_LOGS_SENSORES, "Sensor ultrassonico lido: distancia: %.2f cm\n", *pt_distancia_cm);
-}
\ No newline at end of file
+    LOGD_I(TAG_LOGS_SENSORES, "Sensor ultrassonico lido: distancia: %.2f cm", pt_resultado->distancia_cm);
+}
@@ -3,6 +3,8 @@
 #ifndef SENSORES_DEFS_H
 #define SENSORES_DEFS_H
 
+#include "rajada_medicoes.h"
+
 /* Definição - máxima distância */
 #define MAX_DISTANCE_CM        500
 
@@ -18,4 +20,4 @@ typedef struct __attribute__((__packed__))
 
 /* Protótipos */
 void inicializa_sensor(TConfig_sensores * pt_config_sensores);
-void le_sensor(TConfig_sensores * pt_config_sensores, float * pt_distancia_cm);
\ No newline at end of file
+void le_sensor(TConfig_sensores * pt_config_sensores, TResultado_rajada * pt_resultado);
\ No newline at end of file
@@ -0,0 +1,504 @@
+/* Módulo: sessão LoRaWAN (OTAA): join com backoff e sessão persistida
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "sessao_lorawan.h"
+#include "../agendador_uplinks/agendador_uplinks.h"
+
+/* Definições - assinaturas que indicam sessão e join válidos na memória (RTC ou flash) */
+#define ASSINATURA_SESSAO_LORAWAN        0x53534E31  // "SSN1"
+#define ASSINATURA_JOIN_LORAWAN          0x4A4E5231  // "JNR1"
+
+/* Definições - limites de tempo no ar dos join-requests (RP002), por período
+ *             contado a partir do início do join
+ */
+#define LIMITE_JOIN_PRIMEIRA_HORA_US     36000000ULL
+#define LIMITE_JOIN_DEZ_HORAS_US         36000000ULL
+#define LIMITE_JOIN_POR_DIA_US           8700000ULL
+#define FIM_PRIMEIRA_HORA_MS             (1LL * 3600LL * 1000LL)
+#define FIM_DEZ_HORAS_SEGUINTES_MS       (11LL * 3600LL * 1000LL)
+#define DURACAO_DIA_MS                   (24LL * 3600LL * 1000LL)
+
+/* Funções locais */
+static uint32_t calcula_crc(const TSessao_lorawan * pt_sessao);
+static void atualiza_crc(TSessao_lorawan * pt_sessao);
+static uint32_t sorteia(TJoin_lorawan * pt_join);
+static int valor_digito_hex(char caractere);
+static int periodo_limite_join(int64_t decorrido_ms);
+static int64_t inicio_periodo_limite_join_ms(int periodo);
+static uint64_t limite_periodo_join_us(int periodo);
+static void contabiliza_tentativa(TJoin_lorawan * pt_join);
+
+/* Função: calcula o CRC-32 (polinômio 0xEDB88320) da sessão, sem o próprio CRC
+ * Parâmetros: ponteiro para a sessão
+ * Retorno: CRC
+ */
+static uint32_t calcula_crc(const TSessao_lorawan * pt_sessao)
+{
+    const uint8_t * pt_bytes = (const uint8_t *)pt_sessao;
+    uint32_t crc = 0xFFFFFFFF;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < offsetof(TSessao_lorawan, crc); i++)
+    {
+        crc ^= pt_bytes[i];
+
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+    }
+
+    return ~crc;
+}
+
+/* Função: atualiza o CRC da sessão (depois de qualquer alteração)
+ * Parâmetros: ponteiro para a sessão
+ * Retorno: nenhum
+ */
+static void atualiza_crc(TSessao_lorawan * pt_sessao)
+{
+    pt_sessao->crc = calcula_crc(pt_sessao);
+}
+
+/* Função: sorteia um número (xorshift32)
+ * Parâmetros: ponteiro para o join
+ * Retorno: número sorteado
+ */
+static uint32_t sorteia(TJoin_lorawan * pt_join)
+{
+    pt_join->estado_aleatorio ^= pt_join->estado_aleatorio << 13;
+    pt_join->estado_aleatorio ^= pt_join->estado_aleatorio >> 17;
+    pt_join->estado_aleatorio ^= pt_join->estado_aleatorio << 5;
+    return pt_join->estado_aleatorio;
+}
+
+/* Função: obtém o valor de um dígito hexadecimal
+ * Parâmetros: caractere
+ * Retorno: valor (0 a 15). -1 se não for dígito hexadecimal.
+ */
+static int valor_digito_hex(char caractere)
+{
+    if ((caractere >= '0') && (caractere <= '9'))
+    {
+        return caractere - '0';
+    }
+
+    if ((caractere >= 'A') && (caractere <= 'F'))
+    {
+        return caractere - 'A' + 10;
+    }
+
+    if ((caractere >= 'a') && (caractere <= 'f'))
+    {
+        return caractere - 'a' + 10;
+    }
+
+    return -1;
+}
+
+/* Função: obtém o período do limite de tempo no ar dos join-requests
+ * Parâmetros: tempo decorrido desde o início do join (ms)
+ * Retorno: período (0: primeira hora, 1: 10 h seguintes, 2 em diante: cada dia seguinte)
+ */
+static int periodo_limite_join(int64_t decorrido_ms)
+{
+    if (decorrido_ms < FIM_PRIMEIRA_HORA_MS)
+    {
+        return 0;
+    }
+
+    if (decorrido_ms < FIM_DEZ_HORAS_SEGUINTES_MS)
+    {
+        return 1;
+    }
+
+    return 2 + (int)((decorrido_ms - FIM_DEZ_HORAS_SEGUINTES_MS) / DURACAO_DIA_MS);
+}
+
+/* Função: obtém o início de um período do limite de tempo no ar dos join-requests
+ * Parâmetros: período
+ * Retorno: início do período, contado do início do join (ms)
+ */
+static int64_t inicio_periodo_limite_join_ms(int periodo)
+{
+    if (periodo == 0)
+    {
+        return 0;
+    }
+
+    if (periodo == 1)
+    {
+        return FIM_PRIMEIRA_HORA_MS;
+    }
+
+    return FIM_DEZ_HORAS_SEGUINTES_MS + ((int64_t)(periodo - 2) * DURACAO_DIA_MS);
+}
+
+/* Função: obtém o limite de tempo no ar dos join-requests de um período
+ * Parâmetros: período
+ * Retorno: limite (us)
+ */
+static uint64_t limite_periodo_join_us(int periodo)
+{
+    if (periodo == 0)
+    {
+        return LIMITE_JOIN_PRIMEIRA_HORA_US;
+    }
+
+    if (periodo == 1)
+    {
+        return LIMITE_JOIN_DEZ_HORAS_US;
+    }
+
+    return LIMITE_JOIN_POR_DIA_US;
+}
+
+/* Função: contabiliza o tempo no ar da tentativa feita (no DR atual, no
+ *         instante em que estava agendada)
+ * Parâmetros: ponteiro para o join
+ * Retorno: nenhum
+ */
+static void contabiliza_tentativa(TJoin_lorawan * pt_join)
+{
+    uint32_t tempo_no_ar_us = sessao_lorawan_join_tempo_no_ar_us(pt_join->plano, pt_join->dr_atual);
+    int periodo = periodo_limite_join(pt_join->instante_proxima_tentativa_ms - pt_join->instante_inicio_ms);
+
+    if (periodo != pt_join->periodo_limite)
+    {
+        pt_join->periodo_limite = periodo;
+        pt_join->tempo_no_ar_periodo_us = 0;
+    }
+
+    pt_join->total_tentativas++;
+    pt_join->tempo_no_ar_total_us += tempo_no_ar_us;
+    pt_join->tempo_no_ar_periodo_us += tempo_no_ar_us;
+}
+
+/* Função: inicia uma sessão obtida num join (contadores zerados)
+ * Parâmetros: - ponteiro para a sessão
+ *             - DevAddr, AppSKey e NwkSKey atribuídos no join
+ * Retorno: nenhum. A sessão deve ser gravada na flash em seguida.
+ */
+void sessao_lorawan_inicia(TSessao_lorawan * pt_sessao, const uint8_t * pt_dev_addr, const uint8_t * pt_app_s_key, const uint8_t * pt_nwk_s_key)
+{
+    memset(pt_sessao, 0x00, sizeof(TSessao_lorawan));
+    pt_sessao->assinatura = ASSINATURA_SESSAO_LORAWAN;
+    memcpy(pt_sessao->dev_addr, pt_dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR);
+    memcpy(pt_sessao->app_s_key, pt_app_s_key, SESSAO_LORAWAN_TAM_CHAVE);
+    memcpy(pt_sessao->nwk_s_key, pt_nwk_s_key, SESSAO_LORAWAN_TAM_CHAVE);
+    pt_sessao->fcnt_up_reservado = SESSAO_LORAWAN_RESERVA_FCNT;
+    atualiza_crc(pt_sessao);
+}
+
+/* Função: verifica se a sessão contida na memória é válida (assinatura e CRC)
+ * Parâmetros: ponteiro para a sessão
+ * Retorno: true: sessão válida; false: sessão inexistente ou corrompida
+ */
+bool sessao_lorawan_valida(const TSessao_lorawan * pt_sessao)
+{
+    return (pt_sessao->assinatura == ASSINATURA_SESSAO_LORAWAN) && (pt_sessao->crc == calcula_crc(pt_sessao));
+}
+
+/* Função: invalida a sessão (força um novo join)
+ * Parâmetros: ponteiro para a sessão
+ * Retorno: nenhum
+ */
+void sessao_lorawan_invalida(TSessao_lorawan * pt_sessao)
+{
+    memset(pt_sessao, 0x00, sizeof(TSessao_lorawan));
+}
+
+/* Função: retoma uma sessão lida da flash: o contador de uplinks passa a ser
+ *         o reservado (contadores abaixo dele podem ter sido usados depois da
+ *         gravação) e uma nova reserva é feita
+ * Parâmetros: ponteiro para a sessão (válida)
+ * Retorno: nenhum. A sessão deve ser gravada na flash antes do próximo uplink.
+ */
+void sessao_lorawan_retoma_da_flash(TSessao_lorawan * pt_sessao)
+{
+    pt_sessao->fcnt_up = pt_sessao->fcnt_up_reservado;
+    pt_sessao->fcnt_up_reservado = pt_sessao->fcnt_up + SESSAO_LORAWAN_RESERVA_FCNT;
+    atualiza_crc(pt_sessao);
+}
+
+/* Função: registra um uplink aceito pelo módulo LoRaWAN (avança o contador)
+ * Parâmetros: ponteiro para a sessão
+ * Retorno: true: o contador alcançou o reservado; a sessão (com nova reserva)
+ *                deve ser gravada na flash antes do próximo uplink
+ *          false: só a cópia em memória RTC precisa ser atualizada
+ */
+bool sessao_lorawan_registra_uplink(TSessao_lorawan * pt_sessao)
+{
+    bool gravar_na_flash = false;
+
+    pt_sessao->fcnt_up++;
+
+    if (pt_sessao->fcnt_up >= pt_sessao->fcnt_up_reservado)
+    {
+        pt_sessao->fcnt_up_reservado = pt_sessao->fcnt_up + SESSAO_LORAWAN_RESERVA_FCNT;
+        gravar_na_flash = true;
+    }
+
+    atualiza_crc(pt_sessao);
+    return gravar_na_flash;
+}
+
+/* Função: registra downlinks recebidos na sessão (avança o contador de downlinks)
+ * Parâmetros: - ponteiro para a sessão
+ *             - quantidade de downlinks recebidos desde o último registro
+ * Retorno: nenhum
+ */
+void sessao_lorawan_registra_downlinks(TSessao_lorawan * pt_sessao, uint32_t qtde_downlinks)
+{
+    if (qtde_downlinks == 0)
+    {
+        return;
+    }
+
+    pt_sessao->fcnt_down += qtde_downlinks;
+    atualiza_crc(pt_sessao);
+}
+
+/* Função: verifica se a sessão expirou (quantidade máxima de uplinks)
+ * Parâmetros: ponteiro para a sessão
+ * Retorno: true: sessão expirada, um novo join deve ser feito
+ *          false: sessão pode continuar sendo usada
+ */
+bool sessao_lorawan_expirou(const TSessao_lorawan * pt_sessao)
+{
+    return (pt_sessao->fcnt_up >= SESSAO_LORAWAN_FCNT_MAX);
+}
+
+/* Função: lê um campo em hexadecimal da resposta de um comando AT
+ *         ("26:0B:12:34", "260B1234" ou "AT+DADDR=26:0B:12:34")
+ * Parâmetros: - texto da resposta (só a última linha não vazia é lida, e o
+ *               que vem antes do '=' nela é ignorado)
+ *             - ponteiro para os bytes lidos
+ *             - quantidade de bytes esperada
+ * Retorno: true: campo lido; false: texto inválido ou com outra quantidade de bytes
+ */
+bool sessao_lorawan_le_hex(const char * pt_texto, uint8_t * pt_bytes, int qtde_bytes)
+{
+    const char * pt_linha = pt_texto;
+    const char * pt_caractere;
+    int qtde_digitos = 0;
+    int valor;
+
+    /* Última linha não vazia (a resposta pode trazer o eco do comando antes) */
+    for (pt_caractere = pt_texto; *pt_caractere != '\0'; pt_caractere++)
+    {
+        if ( ((*pt_caractere == '\r') || (*pt_caractere == '\n')) &&
+             (pt_caractere[1] != '\0') && (pt_caractere[1] != '\r') && (pt_caractere[1] != '\n') )
+        {
+            pt_linha = pt_caractere + 1;
+        }
+    }
+
+    for (pt_caractere = pt_linha; (*pt_caractere != '\0') && (*pt_caractere != '\r') && (*pt_caractere != '\n'); pt_caractere++)
+    {
+        if (*pt_caractere == '=')
+        {
+            pt_linha = pt_caractere + 1;
+        }
+    }
+
+    for (pt_caractere = pt_linha; (*pt_caractere != '\0') && (*pt_caractere != '\r') && (*pt_caractere != '\n'); pt_caractere++)
+    {
+        if ((*pt_caractere == ':') || (*pt_caractere == ' '))
+        {
+            continue;
+        }
+
+        valor = valor_digito_hex(*pt_caractere);
+
+        if ((valor < 0) || (qtde_digitos >= (qtde_bytes * 2)))
+        {
+            return false;
+        }
+
+        if ((qtde_digitos % 2) == 0)
+        {
+            pt_bytes[qtde_digitos / 2] = (uint8_t)(valor << 4);
+        }
+        else
+        {
+            pt_bytes[qtde_digitos / 2] |= (uint8_t)valor;
+        }
+
+        qtde_digitos++;
+    }
+
+    return (qtde_digitos == (qtde_bytes * 2));
+}
+
+/* Função: formata bytes em hexadecimal no formato dos comandos AT ("26:0B:12:34")
+ * Parâmetros: - bytes e quantidade de bytes
+ *             - ponteiro para o texto (SESSAO_LORAWAN_TAM_TEXTO(qtde_bytes) caracteres)
+ * Retorno: nenhum
+ */
+void sessao_lorawan_formata_hex(const uint8_t * pt_bytes, int qtde_bytes, char * pt_texto)
+{
+    static const char digitos[] = "0123456789ABCDEF";
+    int i;
+
+    for (i = 0; i < qtde_bytes; i++)
+    {
+        pt_texto[(i * 3) + 0] = digitos[pt_bytes[i] >> 4];
+        pt_texto[(i * 3) + 1] = digitos[pt_bytes[i] & 0x0F];
+        pt_texto[(i * 3) + 2] = ':';
+    }
+
+    pt_texto[(qtde_bytes > 0) ? ((qtde_bytes * 3) - 1) : 0] = '\0';
+}
+
+/* Função: inicializa o join. Se o join contido na memória estiver em andamento
+ *         (ex: preservado em memória RTC durante deep sleep ou num reset) e com
+ *         a mesma configuração, seu estado (backoff e DR) é mantido; senão, um
+ *         novo join começa, com a primeira tentativa sorteada em até
+ *         SESSAO_LORAWAN_JOIN_ATRASO_INICIAL_MAX_MS.
+ * Parâmetros: - ponteiro para o join
+ *             - plano de frequências
+ *             - DR da primeira tentativa e DR mínimo (tentativas seguintes)
+ *             - semente do sorteio (ex: número aleatório do hardware)
+ *             - instante atual (ms)
+ * Retorno: nenhum
+ */
+void sessao_lorawan_join_inicializa(TJoin_lorawan * pt_join, int plano, int dr_inicial, int dr_minimo, uint32_t semente, int64_t instante_atual_ms)
+{
+    if ( (pt_join->assinatura == ASSINATURA_JOIN_LORAWAN) &&
+         (pt_join->em_andamento == true) &&
+         (pt_join->plano == plano) &&
+         (pt_join->dr_inicial == dr_inicial) &&
+         (pt_join->dr_minimo == dr_minimo) &&
+         (pt_join->instante_inicio_ms <= instante_atual_ms) )
+    {
+        return;
+    }
+
+    memset(pt_join, 0x00, sizeof(TJoin_lorawan));
+    pt_join->assinatura = ASSINATURA_JOIN_LORAWAN;
+    pt_join->plano = plano;
+    pt_join->dr_inicial = dr_inicial;
+    pt_join->dr_minimo = (dr_minimo < dr_inicial) ? dr_minimo : dr_inicial;
+    pt_join->em_andamento = true;
+    pt_join->estado_aleatorio = (semente != 0) ? semente : 1;
+    pt_join->instante_inicio_ms = instante_atual_ms;
+    pt_join->instante_proxima_tentativa_ms = instante_atual_ms + (sorteia(pt_join) % (SESSAO_LORAWAN_JOIN_ATRASO_INICIAL_MAX_MS + 1));
+    pt_join->dr_atual = dr_inicial;
+}
+
+/* Função: calcula quanto tempo falta para a próxima tentativa de join
+ * Parâmetros: - ponteiro para o join
+ *             - instante atual (ms)
+ * Retorno: tempo de espera (ms). 0 = pode tentar agora.
+ */
+int64_t sessao_lorawan_join_tempo_ate_tentativa_ms(const TJoin_lorawan * pt_join, int64_t instante_atual_ms)
+{
+    if (pt_join->instante_proxima_tentativa_ms <= instante_atual_ms)
+    {
+        return 0;
+    }
+
+    return pt_join->instante_proxima_tentativa_ms - instante_atual_ms;
+}
+
+/* Função: obtém o DR da próxima tentativa de join
+ * Parâmetros: ponteiro para o join
+ * Retorno: DR
+ */
+int sessao_lorawan_join_dr(const TJoin_lorawan * pt_join)
+{
+    return pt_join->dr_atual;
+}
+
+/* Função: calcula o tempo no ar de um join-request
+ * Parâmetros: plano de frequências e DR
+ * Retorno: tempo no ar (us). 0 se o DR não existir ou não for permitido.
+ */
+uint32_t sessao_lorawan_join_tempo_no_ar_us(int plano, int dr)
+{
+    return agendador_uplinks_tempo_no_ar_us(plano, dr, SESSAO_LORAWAN_TAM_JOIN_REQUEST - OVERHEAD_PAYLOAD_LORAWAN);
+}
+
+/* Função: registra uma tentativa de join sem join-accept e agenda a próxima
+ *         (backoff exponencial com jitter, degrau de DR e limite de tempo no ar)
+ * Parâmetros: - ponteiro para o join
+ *             - instante atual (ms)
+ * Retorno: nenhum
+ */
+void sessao_lorawan_join_registra_falha(TJoin_lorawan * pt_join, int64_t instante_atual_ms)
+{
+    int64_t espera_ms = SESSAO_LORAWAN_JOIN_ESPERA_BASE_MS;
+    int64_t instante_tentativa_ms;
+    uint32_t tempo_no_ar_us;
+    uint64_t usado_us;
+    int periodo;
+    uint32_t i;
+
+    contabiliza_tentativa(pt_join);
+
+    /* Degrau de DR: mais alcance depois de SESSAO_LORAWAN_JOIN_TENTATIVAS_POR_DR falhas */
+    pt_join->falhas_no_dr++;
+
+    if ( (pt_join->falhas_no_dr >= SESSAO_LORAWAN_JOIN_TENTATIVAS_POR_DR) && (pt_join->dr_atual > pt_join->dr_minimo) )
+    {
+        pt_join->dr_atual--;
+        pt_join->falhas_no_dr = 0;
+    }
+
+    /* Backoff exponencial: metade fixa, metade sorteada */
+    for (i = 1; (i < pt_join->total_tentativas) && (espera_ms < SESSAO_LORAWAN_JOIN_ESPERA_MAX_MS); i++)
+    {
+        espera_ms *= 2;
+    }
+
+    if (espera_ms > SESSAO_LORAWAN_JOIN_ESPERA_MAX_MS)
+    {
+        espera_ms = SESSAO_LORAWAN_JOIN_ESPERA_MAX_MS;
+    }
+
+    espera_ms = (espera_ms / 2) + (sorteia(pt_join) % ((espera_ms / 2) + 1));
+    instante_tentativa_ms = instante_atual_ms + espera_ms;
+
+    /* Limite de tempo no ar: se a próxima tentativa estourar o do seu período,
+     * ela vai para o início do período seguinte
+     */
+    tempo_no_ar_us = sessao_lorawan_join_tempo_no_ar_us(pt_join->plano, pt_join->dr_atual);
+
+    while (true)
+    {
+        periodo = periodo_limite_join(instante_tentativa_ms - pt_join->instante_inicio_ms);
+        usado_us = (periodo == pt_join->periodo_limite) ? pt_join->tempo_no_ar_periodo_us : 0;
+
+        if ((usado_us + tempo_no_ar_us) <= limite_periodo_join_us(periodo))
+        {
+            break;
+        }
+
+        instante_tentativa_ms = pt_join->instante_inicio_ms + inicio_periodo_limite_join_ms(periodo + 1);
+    }
+
+    pt_join->instante_proxima_tentativa_ms = instante_tentativa_ms;
+}
+
+/* Função: registra a tentativa de join que recebeu o join-accept (encerra o
+ *         join: o próximo recomeça do DR inicial)
+ * Parâmetros: - ponteiro para o join
+ *             - instante atual (ms)
+ * Retorno: nenhum
+ */
+void sessao_lorawan_join_registra_sucesso(TJoin_lorawan * pt_join, int64_t instante_atual_ms)
+{
+    contabiliza_tentativa(pt_join);
+    pt_join->em_andamento = false;
+    pt_join->instante_proxima_tentativa_ms = instante_atual_ms;
+}
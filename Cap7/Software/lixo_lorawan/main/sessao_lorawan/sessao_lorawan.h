@@ -0,0 +1,125 @@
+/* Header file: sessão LoRaWAN (OTAA): join com backoff e sessão persistida
+ *
+ * Join (OTAA): o join-request é enviado pelo driver do módulo LoRaWAN e o
+ * resultado (join-accept ou falha) chega como evento. Entre tentativas:
+ * - a primeira tentativa depois do boot é sorteada em até
+ *   SESSAO_LORAWAN_JOIN_ATRASO_INICIAL_MAX_MS: depois de uma queda de
+ *   energia que reinicia a frota inteira, os joins não saem juntos;
+ * - o DR começa no DR inicial (join-request curto, pouco tempo no ar) e
+ *   desce um DR a cada SESSAO_LORAWAN_JOIN_TENTATIVAS_POR_DR falhas, até o
+ *   DR mínimo (maior alcance);
+ * - a espera dobra a cada falha (backoff exponencial, de
+ *   SESSAO_LORAWAN_JOIN_ESPERA_BASE_MS até SESSAO_LORAWAN_JOIN_ESPERA_MAX_MS),
+ *   metade dela sorteada (jitter);
+ * - as tentativas respeitam o limite de tempo no ar dos join-requests do
+ *   RP002, contado a partir do início do join: 36 s na primeira hora,
+ *   36 s nas 10 h seguintes e 8,7 s a cada 24 h depois disso. Uma
+ *   tentativa que estouraria o limite do período vai para o início do
+ *   período seguinte.
+ * O estado do join pode ficar em memória RTC: em deep sleep ou depois de
+ * um reset, o backoff continua de onde parou.
+ *
+ * Sessão: DevAddr, chaves de sessão e contadores de quadros obtidos no
+ * join. A aplicação guarda uma cópia exata em memória RTC (atualizada a
+ * cada uplink) e uma cópia na flash (NVS), gravada apenas quando o
+ * contador de uplinks alcança o valor reservado na última gravação
+ * (SESSAO_LORAWAN_RESERVA_FCNT uplinks depois dela). Todo contador já
+ * usado é menor que o reservado gravado: ao retomar a sessão da flash,
+ * o contador de uplinks passa a ser o reservado (pulando no máximo
+ * SESSAO_LORAWAN_RESERVA_FCNT valores), e nunca é reutilizado - o
+ * servidor de rede descarta uplinks com contador repetido.
+ * Reboots e wake-ups de deep sleep retomam a sessão sem um novo join.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+#ifndef HEADER_SESSAO_LORAWAN
+#define HEADER_SESSAO_LORAWAN
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definições - tamanhos do DevAddr, das chaves e do EUI */
+#define SESSAO_LORAWAN_TAM_DEV_ADDR                4
+#define SESSAO_LORAWAN_TAM_CHAVE                   16
+#define SESSAO_LORAWAN_TAM_EUI                     8
+
+/* Definição - tamanho do texto de um campo no formato dos comandos AT
+ *             ("26:0B:12:34"): 3 caracteres por byte, com o terminador
+ */
+#define SESSAO_LORAWAN_TAM_TEXTO(qtde_bytes)       ((qtde_bytes) * 3)
+
+/* Definição - uplinks entre duas gravações da sessão na flash */
+#define SESSAO_LORAWAN_RESERVA_FCNT                64
+
+/* Definição - uplinks de uma sessão: ao alcançá-los, a sessão expira e um
+ *             novo join é feito (renova as chaves de sessão e mantém o
+ *             contador dentro dos 16 bits usados por alguns servidores)
+ */
+#define SESSAO_LORAWAN_FCNT_MAX                    0xFF00
+
+/* Definição - tamanho do join-request (MHDR + JoinEUI + DevEUI + DevNonce + MIC) */
+#define SESSAO_LORAWAN_TAM_JOIN_REQUEST            23   //bytes
+
+/* Definições - tentativas de join */
+#define SESSAO_LORAWAN_JOIN_ATRASO_INICIAL_MAX_MS  60000    //ms
+#define SESSAO_LORAWAN_JOIN_TENTATIVAS_POR_DR      2
+#define SESSAO_LORAWAN_JOIN_ESPERA_BASE_MS         10000    //ms
+#define SESSAO_LORAWAN_JOIN_ESPERA_MAX_MS          3600000  //ms
+
+/* Estrutura da sessão (persistida em memória RTC e na flash) */
+typedef struct
+{
+    uint32_t assinatura;
+    uint8_t dev_addr[SESSAO_LORAWAN_TAM_DEV_ADDR];
+    uint8_t app_s_key[SESSAO_LORAWAN_TAM_CHAVE];
+    uint8_t nwk_s_key[SESSAO_LORAWAN_TAM_CHAVE];
+    uint32_t fcnt_up;                   // contador do próximo uplink
+    uint32_t fcnt_down;                 // contador do último downlink recebido
+    uint32_t fcnt_up_reservado;         // contadores abaixo deste podem ter sido usados
+    uint32_t crc;
+}TSessao_lorawan;
+
+/* Estrutura do join (configuração, estado e contadores) */
+typedef struct
+{
+    /* Configuração */
+    uint32_t assinatura;
+    int plano;
+    int dr_inicial;
+    int dr_minimo;
+
+    /* Estado */
+    bool em_andamento;
+    uint32_t estado_aleatorio;
+    int64_t instante_inicio_ms;         // início do join (referência dos limites de tempo no ar)
+    int64_t instante_proxima_tentativa_ms;
+    int dr_atual;
+    uint32_t falhas_no_dr;
+    int periodo_limite;                 // período do limite de tempo no ar (0: 1a hora, 1: 10 h seguintes, 2...: dias)
+    uint64_t tempo_no_ar_periodo_us;
+
+    /* Contadores do join em andamento (ou do último concluído) */
+    uint32_t total_tentativas;
+    uint64_t tempo_no_ar_total_us;
+}TJoin_lorawan;
+
+#endif
+
+/* Protótipos */
+void sessao_lorawan_inicia(TSessao_lorawan * pt_sessao, const uint8_t * pt_dev_addr, const uint8_t * pt_app_s_key, const uint8_t * pt_nwk_s_key);
+bool sessao_lorawan_valida(const TSessao_lorawan * pt_sessao);
+void sessao_lorawan_invalida(TSessao_lorawan * pt_sessao);
+void sessao_lorawan_retoma_da_flash(TSessao_lorawan * pt_sessao);
+bool sessao_lorawan_registra_uplink(TSessao_lorawan * pt_sessao);
+void sessao_lorawan_registra_downlinks(TSessao_lorawan * pt_sessao, uint32_t qtde_downlinks);
+bool sessao_lorawan_expirou(const TSessao_lorawan * pt_sessao);
+bool sessao_lorawan_le_hex(const char * pt_texto, uint8_t * pt_bytes, int qtde_bytes);
+void sessao_lorawan_formata_hex(const uint8_t * pt_bytes, int qtde_bytes, char * pt_texto);
+void sessao_lorawan_join_inicializa(TJoin_lorawan * pt_join, int plano, int dr_inicial, int dr_minimo, uint32_t semente, int64_t instante_atual_ms);
+int64_t sessao_lorawan_join_tempo_ate_tentativa_ms(const TJoin_lorawan * pt_join, int64_t instante_atual_ms);
+int sessao_lorawan_join_dr(const TJoin_lorawan * pt_join);
+uint32_t sessao_lorawan_join_tempo_no_ar_us(int plano, int dr);
+void sessao_lorawan_join_registra_falha(TJoin_lorawan * pt_join, int64_t instante_atual_ms);
+void sessao_lorawan_join_registra_sucesso(TJoin_lorawan * pt_join, int64_t instante_atual_ms);
@@ -0,0 +1,261 @@
+/* Módulo: período de sleep adaptativo pela taxa de enchimento da lixeira
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include "sleep_adaptativo.h"
+
+/* Definição - assinatura que indica histórico válido na memória RTC */
+#define ASSINATURA_HISTORICO_DISTANCIAS  0x48445331  // "HDS1"
+
+/* Funções locais */
+static uint32_t calcula_checksum_historico(THistorico_distancias * pt_historico);
+static TPonto_distancia * obtem_ponto(THistorico_distancias * pt_historico, int posicao);
+static float filtra_leitura(THistorico_distancias * pt_historico, float distancia_cm);
+static void reinicia_historico(THistorico_distancias * pt_historico);
+
+/* Função: calcula checksum do histórico (para validar conteúdo mantido em memória RTC)
+ * Parâmetros: ponteiro para o histórico
+ * Retorno: checksum calculado
+ */
+static uint32_t calcula_checksum_historico(THistorico_distancias * pt_historico)
+{
+    const uint8_t * pt_byte = (const uint8_t *)pt_historico;
+    uint32_t checksum = 0x811C9DC5;
+    int i;
+
+    /* FNV-1a sobre toda a estrutura, exceto o próprio campo de checksum */
+    for (i = 0; i < (int)offsetof(THistorico_distancias, checksum); i++)
+    {
+        checksum = (checksum ^ pt_byte[i]) * 0x01000193;
+    }
+
+    return checksum;
+}
+
+/* Função: obtém ponto do histórico pela posição (0 = mais antigo)
+ * Parâmetros: - ponteiro para o histórico
+ *             - posição
+ * Retorno: ponteiro para o ponto
+ */
+static TPonto_distancia * obtem_ponto(THistorico_distancias * pt_historico, int posicao)
+{
+    return &pt_historico->pontos[(pt_historico->idx_inicio + posicao) % SLEEP_ADAPTATIVO_QTDE_PONTOS];
+}
+
+/* Função: filtra a leitura pela mediana dela com as anteriores
+ * Parâmetros: - ponteiro para o histórico
+ *             - distância lida (cm)
+ * Retorno: distância filtrada (cm)
+ */
+static float filtra_leitura(THistorico_distancias * pt_historico, float distancia_cm)
+{
+    float a;
+    float b;
+    float mediana = distancia_cm;
+
+    if (pt_historico->qtde_leituras_filtro == (SLEEP_ADAPTATIVO_TAM_FILTRO - 1))
+    {
+        a = pt_historico->leituras_filtro[0];
+        b = pt_historico->leituras_filtro[1];
+
+        if ( ((a <= distancia_cm) && (distancia_cm <= b)) || ((b <= distancia_cm) && (distancia_cm <= a)) )
+        {
+            mediana = distancia_cm;
+        }
+        else if ( ((distancia_cm <= a) && (a <= b)) || ((b <= a) && (a <= distancia_cm)) )
+        {
+            mediana = a;
+        }
+        else
+        {
+            mediana = b;
+        }
+
+        pt_historico->leituras_filtro[0] = b;
+        pt_historico->leituras_filtro[1] = distancia_cm;
+    }
+    else
+    {
+        pt_historico->leituras_filtro[pt_historico->qtde_leituras_filtro++] = distancia_cm;
+    }
+
+    return mediana;
+}
+
+/* Função: reinicia o histórico e o filtro (lixeira esvaziada)
+ * Parâmetros: ponteiro para o histórico
+ * Retorno: nenhum
+ */
+static void reinicia_historico(THistorico_distancias * pt_historico)
+{
+    pt_historico->idx_inicio = 0;
+    pt_historico->qtde = 0;
+    pt_historico->qtde_leituras_filtro = 0;
+    pt_historico->taxa_enchimento_cm_h = 0.0f;
+}
+
+/* Função: inicializa histórico. Se o histórico contido na memória for válido
+ *         (preservado em memória RTC durante o deep sleep), seu conteúdo é
+ *         mantido. Caso contrário, é zerado.
+ * Parâmetros: ponteiro para o histórico
+ * Retorno: nenhum
+ */
+void sleep_adaptativo_inicializa(THistorico_distancias * pt_historico)
+{
+    if ( (pt_historico->assinatura == ASSINATURA_HISTORICO_DISTANCIAS) &&
+         (pt_historico->qtde <= SLEEP_ADAPTATIVO_QTDE_PONTOS) &&
+         (pt_historico->idx_inicio < SLEEP_ADAPTATIVO_QTDE_PONTOS) &&
+         (pt_historico->checksum == calcula_checksum_historico(pt_historico)) )
+    {
+        return;
+    }
+
+    memset(pt_historico, 0x00, sizeof(THistorico_distancias));
+    pt_historico->assinatura = ASSINATURA_HISTORICO_DISTANCIAS;
+    pt_historico->checksum = calcula_checksum_historico(pt_historico);
+}
+
+/* Função: registra uma leitura do sensor no histórico
+ * Parâmetros: - ponteiro para o histórico
+ *             - instante da leitura (em segundos)
+ *             - distância lida (cm)
+ * Retorno: distância filtrada (cm)
+ */
+float sleep_adaptativo_registra_leitura(THistorico_distancias * pt_historico, uint32_t instante_s, float distancia_cm)
+{
+    TPonto_distancia * pt_ponto;
+    float distancia_filtrada;
+
+    distancia_filtrada = filtra_leitura(pt_historico, distancia_cm);
+
+    /* Distância filtrada aumentou muito em relação ao último ponto: lixeira
+     * esvaziada. Comparar a distância filtrada evita que uma medição espúria
+     * (eco perdido) reinicie o histórico.
+     */
+    if ( (pt_historico->qtde > 0) &&
+         (distancia_filtrada > (obtem_ponto(pt_historico, pt_historico->qtde - 1)->distancia_cm + SLEEP_ADAPTATIVO_AUMENTO_ESVAZIADA_CM)) )
+    {
+        reinicia_historico(pt_historico);
+        distancia_filtrada = filtra_leitura(pt_historico, distancia_cm);
+    }
+
+    /* Histórico cheio: descarta o ponto mais antigo */
+    if (pt_historico->qtde == SLEEP_ADAPTATIVO_QTDE_PONTOS)
+    {
+        pt_historico->idx_inicio = (pt_historico->idx_inicio + 1) % SLEEP_ADAPTATIVO_QTDE_PONTOS;
+        pt_historico->qtde--;
+    }
+
+    pt_ponto = obtem_ponto(pt_historico, pt_historico->qtde);
+    pt_ponto->instante_s = instante_s;
+    pt_ponto->distancia_cm = distancia_filtrada;
+    pt_historico->qtde++;
+
+    sleep_adaptativo_ajusta_tendencia(pt_historico, &pt_historico->taxa_enchimento_cm_h);
+    pt_historico->checksum = calcula_checksum_historico(pt_historico);
+
+    return distancia_filtrada;
+}
+
+/* Função: ajusta, por mínimos quadrados, uma reta (distância x tempo) aos
+ *         pontos do histórico. Os instantes são tomados em relação ao ponto
+ *         mais recente, o que evita perda de precisão com floats.
+ * Parâmetros: - ponteiro para o histórico
+ *             - ponteiro para a taxa de enchimento (cm/h; positiva: lixeira enchendo)
+ * Retorno: true: taxa calculada
+ *          false: pontos insuficientes (ou todos no mesmo instante)
+ */
+bool sleep_adaptativo_ajusta_tendencia(THistorico_distancias * pt_historico, float * pt_taxa_cm_h)
+{
+    TPonto_distancia * pt_ponto;
+    uint32_t instante_ref_s;
+    float soma_t = 0.0f;
+    float soma_d = 0.0f;
+    float soma_tt = 0.0f;
+    float soma_td = 0.0f;
+    float t;
+    float n = (float)pt_historico->qtde;
+    float denominador;
+    int i;
+
+    if (pt_historico->qtde < SLEEP_ADAPTATIVO_QTDE_MIN_AJUSTE)
+    {
+        return false;
+    }
+
+    instante_ref_s = obtem_ponto(pt_historico, pt_historico->qtde - 1)->instante_s;
+
+    for (i = 0; i < pt_historico->qtde; i++)
+    {
+        pt_ponto = obtem_ponto(pt_historico, i);
+        t = -((float)(instante_ref_s - pt_ponto->instante_s) / 3600.0f);   // horas (<= 0)
+
+        soma_t += t;
+        soma_d += pt_ponto->distancia_cm;
+        soma_tt += t * t;
+        soma_td += t * pt_ponto->distancia_cm;
+    }
+
+    denominador = (n * soma_tt) - (soma_t * soma_t);
+    if (denominador <= 0.0f)
+    {
+        return false;
+    }
+
+    /* Inclinação da reta (cm/h). A distância diminui conforme a lixeira enche. */
+    *pt_taxa_cm_h = -(((n * soma_td) - (soma_t * soma_d)) / denominador);
+    return true;
+}
+
+/* Função: escolhe o próximo período de sleep
+ * Parâmetros: - ponteiro para o histórico
+ *             - distância (cm) a partir da qual a lixeira é considerada cheia
+ *             - período mínimo e máximo (s)
+ * Retorno: período de sleep (s)
+ */
+uint32_t sleep_adaptativo_proximo_periodo_s(THistorico_distancias * pt_historico, float distancia_cheia_cm, uint32_t periodo_min_s, uint32_t periodo_max_s)
+{
+    float distancia_atual_cm;
+    float periodo_s;
+
+    /* Sem histórico suficiente (início ou lixeira recém-esvaziada): aprende com o período mínimo */
+    if (pt_historico->qtde < SLEEP_ADAPTATIVO_QTDE_MIN_AJUSTE)
+    {
+        return periodo_min_s;
+    }
+
+    distancia_atual_cm = obtem_ponto(pt_historico, pt_historico->qtde - 1)->distancia_cm;
+
+    if (distancia_atual_cm <= distancia_cheia_cm)
+    {
+        return periodo_min_s;
+    }
+
+    if (pt_historico->taxa_enchimento_cm_h < SLEEP_ADAPTATIVO_TAXA_ESTAVEL_CM_H)
+    {
+        return periodo_max_s;
+    }
+
+    /* Fração do tempo previsto até a lixeira ficar cheia */
+    periodo_s = SLEEP_ADAPTATIVO_FRACAO_TEMPO_ATE_CHEIA * 3600.0f *
+                ((distancia_atual_cm - distancia_cheia_cm) / pt_historico->taxa_enchimento_cm_h);
+
+    if (periodo_s < (float)periodo_min_s)
+    {
+        return periodo_min_s;
+    }
+
+    if (periodo_s > (float)periodo_max_s)
+    {
+        return periodo_max_s;
+    }
+
+    return (uint32_t)periodo_s;
+}
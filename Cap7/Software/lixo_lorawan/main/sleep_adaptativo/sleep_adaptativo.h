@@ -0,0 +1,59 @@
+/* Header file: período de sleep adaptativo pela taxa de enchimento da lixeira
+ *
+ * A cada leitura do sensor, a distância é filtrada (mediana das 3 últimas
+ * leituras, descartando medições espúrias do sensor ultrassônico) e
+ * guardada num histórico curto, mantido em memória RTC. Uma reta de
+ * mínimos quadrados ajustada ao histórico dá a taxa de enchimento (cm/h)
+ * e, com ela, o tempo previsto até a lixeira ficar cheia. O próximo
+ * período de sleep é uma fração desse tempo, limitada a [mínimo, máximo]:
+ * longo com o nível estável, curto com a lixeira perto de encher.
+ * Quando a distância aumenta muito de uma leitura para outra (lixeira
+ * esvaziada), o histórico é reiniciado.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+#ifndef HEADER_SLEEP_ADAPTATIVO
+#define HEADER_SLEEP_ADAPTATIVO
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Definições - histórico e ajuste da tendência */
+#define SLEEP_ADAPTATIVO_QTDE_PONTOS            8
+#define SLEEP_ADAPTATIVO_QTDE_MIN_AJUSTE        3     // pontos necessários para ajustar a reta
+#define SLEEP_ADAPTATIVO_TAM_FILTRO             3     // leituras da mediana
+#define SLEEP_ADAPTATIVO_AUMENTO_ESVAZIADA_CM   15.0  // aumento de distância que indica lixeira esvaziada
+
+/* Definições - escolha do período */
+#define SLEEP_ADAPTATIVO_TAXA_ESTAVEL_CM_H      0.05  // abaixo disso, nível considerado estável
+#define SLEEP_ADAPTATIVO_FRACAO_TEMPO_ATE_CHEIA 0.25  // período = fração do tempo previsto até encher
+
+/* Ponto do histórico (distância filtrada) */
+typedef struct
+{
+    uint32_t instante_s;
+    float distancia_cm;
+}TPonto_distancia;
+
+/* Histórico de distâncias (mantido em memória RTC durante o deep sleep) */
+typedef struct
+{
+    uint32_t assinatura;
+    TPonto_distancia pontos[SLEEP_ADAPTATIVO_QTDE_PONTOS];
+    uint8_t idx_inicio;
+    uint8_t qtde;
+    float leituras_filtro[SLEEP_ADAPTATIVO_TAM_FILTRO - 1];
+    uint8_t qtde_leituras_filtro;
+    float taxa_enchimento_cm_h;   // último ajuste (positiva: lixeira enchendo)
+    uint32_t checksum;
+}THistorico_distancias;
+
+#endif
+
+/* Protótipos */
+void sleep_adaptativo_inicializa(THistorico_distancias * pt_historico);
+float sleep_adaptativo_registra_leitura(THistorico_distancias * pt_historico, uint32_t instante_s, float distancia_cm);
+bool sleep_adaptativo_ajusta_tendencia(THistorico_distancias * pt_historico, float * pt_taxa_cm_h);
+uint32_t sleep_adaptativo_proximo_periodo_s(THistorico_distancias * pt_historico, float distancia_cheia_cm, uint32_t periodo_min_s, uint32_t periodo_max_s);
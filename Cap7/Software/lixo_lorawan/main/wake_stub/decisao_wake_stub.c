@@ -0,0 +1,112 @@
+/* Módulo: decisão do wake stub (boot completo ou volta a dormir)
+ *
+ * OBS: as funções chamadas pelo wake stub não podem usar a flash (nem
+ *      funções de biblioteca fora da ROM): só comparações e atribuições.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "decisao_wake_stub.h"
+
+/* Função: inicializa o estado do wake stub (estado inválido ou primeiro boot)
+ * Parâmetros: - ponteiro para o estado
+ *             - distância (cm) a partir da qual a lixeira é considerada quase cheia
+ * Retorno: nenhum
+ */
+void decisao_wake_stub_inicializa(TEstado_wake_stub * pt_estado, uint8_t distancia_quase_cheia_cm)
+{
+    if (pt_estado->assinatura == ASSINATURA_ESTADO_WAKE_STUB)
+    {
+        return;
+    }
+
+    memset(pt_estado, 0x00, sizeof(TEstado_wake_stub));
+    pt_estado->distancia_quase_cheia_cm = distancia_quase_cheia_cm;
+    pt_estado->assinatura = ASSINATURA_ESTADO_WAKE_STUB;
+}
+
+/* Função: decide se o wake-up precisa de boot completo
+ * Parâmetros: - ponteiro para o estado
+ *             - true: wake-up pelo timer RTC
+ * Retorno: DECISAO_WAKE_STUB_BOOT_COMPLETO ou DECISAO_WAKE_STUB_VOLTA_A_DORMIR
+ */
+ATRIBUTO_WAKE_STUB int decisao_wake_stub_decide(const TEstado_wake_stub * pt_estado, bool acordou_pelo_timer)
+{
+    if ((acordou_pelo_timer == false) || (pt_estado->assinatura != ASSINATURA_ESTADO_WAKE_STUB))
+    {
+        return DECISAO_WAKE_STUB_BOOT_COMPLETO;
+    }
+
+    if ((pt_estado->uplinks_pendentes == true) || (pt_estado->ticks_sleep == 0))
+    {
+        return DECISAO_WAKE_STUB_BOOT_COMPLETO;
+    }
+
+    if (pt_estado->ultima_distancia_cm <= pt_estado->distancia_quase_cheia_cm)
+    {
+        return DECISAO_WAKE_STUB_BOOT_COMPLETO;
+    }
+
+    if (pt_estado->wakes_pulados_seguidos >= pt_estado->max_wakes_pulados)
+    {
+        return DECISAO_WAKE_STUB_BOOT_COMPLETO;
+    }
+
+    return DECISAO_WAKE_STUB_VOLTA_A_DORMIR;
+}
+
+/* Função: registra um wake-up em que o ESP32 voltou direto a dormir
+ * Parâmetros: - ponteiro para o estado
+ *             - ticks do clock lento gastos no wake stub
+ * Retorno: nenhum
+ */
+ATRIBUTO_WAKE_STUB void decisao_wake_stub_registra_pulo(TEstado_wake_stub * pt_estado, uint32_t ticks_no_stub)
+{
+    pt_estado->wakes_pulados_seguidos++;
+    pt_estado->ticks_no_stub += ticks_no_stub;
+}
+
+/* Função: registra o fim de um boot completo (antes de entrar em deep sleep)
+ * Parâmetros: - ponteiro para o estado
+ *             - distância medida (cm) ou DECISAO_WAKE_STUB_DISTANCIA_NAO_MEDIDA
+ *             - true: há uplinks pendentes na fila
+ *             - quantidade máxima de wake-ups seguidos sem boot completo até o próximo
+ *             - tempo de deep sleep, em ticks do clock lento (para o wake stub rearmar o timer)
+ * Retorno: nenhum
+ */
+void decisao_wake_stub_registra_boot_completo(TEstado_wake_stub * pt_estado, uint8_t distancia_cm, bool uplinks_pendentes, uint8_t max_wakes_pulados, uint64_t ticks_sleep)
+{
+    if (distancia_cm != DECISAO_WAKE_STUB_DISTANCIA_NAO_MEDIDA)
+    {
+        pt_estado->ultima_distancia_cm = distancia_cm;
+    }
+
+    pt_estado->uplinks_pendentes = uplinks_pendentes;
+    pt_estado->max_wakes_pulados = max_wakes_pulados;
+    pt_estado->ticks_sleep = ticks_sleep;
+    pt_estado->wakes_pulados_seguidos = 0;
+    pt_estado->ticks_no_stub = 0;
+}
+
+/* Função: converte a distância filtrada para o formato guardado no estado,
+ *         saturando em 0..DECISAO_WAKE_STUB_DISTANCIA_MAX_CM (255 é reservado
+ *         para DECISAO_WAKE_STUB_DISTANCIA_NAO_MEDIDA)
+ * Parâmetros: distância filtrada (cm)
+ * Retorno: distância (cm) para decisao_wake_stub_registra_boot_completo()
+ */
+uint8_t decisao_wake_stub_converte_distancia(float distancia_cm)
+{
+    if (!(distancia_cm > 0.0f))
+    {
+        return 0;
+    }
+
+    if (distancia_cm >= (float)DECISAO_WAKE_STUB_DISTANCIA_MAX_CM)
+    {
+        return DECISAO_WAKE_STUB_DISTANCIA_MAX_CM;
+    }
+
+    return (uint8_t)distancia_cm;
+}
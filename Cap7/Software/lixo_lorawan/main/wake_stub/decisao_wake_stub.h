@@ -0,0 +1,75 @@
+/* Header file: decisão do wake stub (boot completo ou volta a dormir)
+ *
+ * A cada wake-up por timer, o wake stub (executado da memória RTC, antes
+ * do bootloader e da aplicação) decide, com o estado mantido em memória
+ * RTC (última distância medida, uplinks pendentes e política de envio), se
+ * o ESP32 precisa de um boot completo (ler o sensor e enviar) ou se pode
+ * voltar direto ao deep sleep. O boot completo é necessário quando:
+ * - o wake-up não foi pelo timer (tamper, reset etc.);
+ * - o estado não é válido (primeiro boot, perda de alimentação);
+ * - há uplinks pendentes na fila;
+ * - a última distância medida indica lixeira quase cheia;
+ * - o ESP32 já voltou a dormir max_wakes_pulados vezes seguidas (definido a
+ *   cada boot completo pela aplicação, ex: pelo período de sleep adaptativo).
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador. No firmware, as funções usadas
+ *      pelo wake stub são colocadas na memória RTC (ATRIBUTO_WAKE_STUB).
+ */
+
+#ifndef HEADER_DECISAO_WAKE_STUB
+#define HEADER_DECISAO_WAKE_STUB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#define ATRIBUTO_WAKE_STUB              RTC_IRAM_ATTR
+#else
+#define ATRIBUTO_WAKE_STUB
+#endif
+
+/* Definição - assinatura do estado em memória RTC */
+#define ASSINATURA_ESTADO_WAKE_STUB     0x57414B45  // "WAKE"
+
+/* Definições - decisões do wake stub */
+#define DECISAO_WAKE_STUB_BOOT_COMPLETO 0
+#define DECISAO_WAKE_STUB_VOLTA_A_DORMIR 1
+
+/* Definições - distância não medida no boot completo (mantém a última distância) e
+ * maior distância medida guardada no estado (as maiores são saturadas nela) */
+#define DECISAO_WAKE_STUB_DISTANCIA_NAO_MEDIDA 0xFF
+#define DECISAO_WAKE_STUB_DISTANCIA_MAX_CM     (DECISAO_WAKE_STUB_DISTANCIA_NAO_MEDIDA - 1)
+
+/* Estado do wake stub (mantido em memória RTC durante o deep sleep) */
+typedef struct
+{
+    uint32_t assinatura;
+
+    /* Política de envio */
+    uint8_t distancia_quase_cheia_cm;   // a partir desta distância (ou menos), toda wake-up lê o sensor
+    uint8_t max_wakes_pulados;          // wake-ups seguidos sem boot completo (definido a cada boot completo)
+
+    /* Estado do último boot completo */
+    uint8_t ultima_distancia_cm;
+    bool uplinks_pendentes;
+
+    /* Wake-ups seguidos sem boot completo (desde o último boot completo) */
+    uint8_t wakes_pulados_seguidos;
+
+    /* Tempo para rearmar o timer RTC (em ticks do clock lento) */
+    uint64_t ticks_sleep;
+
+    /* Ticks do clock lento gastos no wake stub desde o último boot completo */
+    uint32_t ticks_no_stub;
+}TEstado_wake_stub;
+
+#endif
+
+/* Protótipos */
+void decisao_wake_stub_inicializa(TEstado_wake_stub * pt_estado, uint8_t distancia_quase_cheia_cm);
+int decisao_wake_stub_decide(const TEstado_wake_stub * pt_estado, bool acordou_pelo_timer);
+void decisao_wake_stub_registra_pulo(TEstado_wake_stub * pt_estado, uint32_t ticks_no_stub);
+void decisao_wake_stub_registra_boot_completo(TEstado_wake_stub * pt_estado, uint8_t distancia_cm, bool uplinks_pendentes, uint8_t max_wakes_pulados, uint64_t ticks_sleep);
+uint8_t decisao_wake_stub_converte_distancia(float distancia_cm);
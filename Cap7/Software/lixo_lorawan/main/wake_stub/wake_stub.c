@@ -0,0 +1,128 @@
+/* Módulo do wake stub do deep sleep
+ *
+ * OBS: o wake stub roda antes da inicialização da flash e da RAM: todo o
+ *      código que ele executa deve estar na memória RTC rápida (RTC_IRAM_ATTR)
+ *      e todos os dados que ele usa, na memória RTC lenta (RTC_DATA_ATTR).
+ *      Como o CRC verificado pela ROM antes de chamar o stub cobre apenas a
+ *      memória RTC rápida, o stub pode alterar o seu estado e voltar a dormir
+ *      sem recalcular o CRC.
+ */
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "soc/rtc.h"
+#include "soc/rtc_cntl_reg.h"
+#include "wake_stub.h"
+
+/* Estado do wake stub (preservado em memória RTC durante o deep sleep) */
+static RTC_DATA_ATTR TEstado_wake_stub estado_wake_stub;
+
+/* Funções locais */
+static uint64_t le_tempo_rtc(void);
+static void rearma_timer_rtc(uint64_t instante_atual, uint64_t ticks_sleep);
+
+/* Função: lê o contador do timer RTC (clock lento)
+ * Parâmetros: nenhum
+ * Retorno: contador, em ticks do clock lento
+ */
+static RTC_IRAM_ATTR uint64_t le_tempo_rtc(void)
+{
+    uint64_t instante;
+
+    SET_PERI_REG_MASK(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_UPDATE);
+
+    while (GET_PERI_REG_MASK(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_VALID) == 0)
+    {
+    }
+
+    SET_PERI_REG_MASK(RTC_CNTL_INT_CLR_REG, RTC_CNTL_TIME_VALID_INT_CLR);
+    instante = READ_PERI_REG(RTC_CNTL_TIME0_REG);
+    instante |= ((uint64_t)READ_PERI_REG(RTC_CNTL_TIME1_REG)) << 32;
+
+    return instante;
+}
+
+/* Função: rearma o timer RTC para o próximo wake-up
+ * Parâmetros: - contador atual do timer RTC
+ *             - tempo de deep sleep, em ticks do clock lento
+ * Retorno: nenhum
+ */
+static RTC_IRAM_ATTR void rearma_timer_rtc(uint64_t instante_atual, uint64_t ticks_sleep)
+{
+    uint64_t instante_wakeup = instante_atual + ticks_sleep;
+
+    WRITE_PERI_REG(RTC_CNTL_SLP_TIMER0_REG, (uint32_t)(instante_wakeup & UINT32_MAX));
+    WRITE_PERI_REG(RTC_CNTL_SLP_TIMER1_REG, (uint32_t)(instante_wakeup >> 32));
+}
+
+/*
+ *  Wake stub: substitui o wake stub padrão do ESP-IDF
+ */
+void RTC_IRAM_ATTR esp_wake_deep_sleep(void)
+{
+    uint64_t instante_inicio = le_tempo_rtc();
+    uint32_t causa_wakeup = REG_GET_FIELD(RTC_CNTL_WAKEUP_STATE_REG, RTC_CNTL_WAKEUP_CAUSE);
+    bool acordou_pelo_timer = ((causa_wakeup & RTC_TIMER_TRIG_EN) != 0);
+
+    if (decisao_wake_stub_decide(&estado_wake_stub, acordou_pelo_timer) == DECISAO_WAKE_STUB_BOOT_COMPLETO)
+    {
+        esp_default_wake_deep_sleep();
+        return;
+    }
+
+    /* Volta a dormir: as fontes de wake-up (timer e tamper) continuam configuradas,
+     * basta rearmar o timer e reiniciar o deep sleep com este mesmo stub.
+     */
+    rearma_timer_rtc(instante_inicio, estado_wake_stub.ticks_sleep);
+    decisao_wake_stub_registra_pulo(&estado_wake_stub, (uint32_t)(le_tempo_rtc() - instante_inicio));
+
+    REG_WRITE(RTC_ENTRY_ADDR_REG, (uint32_t)&esp_wake_deep_sleep);
+    CLEAR_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_SLEEP_EN);
+    SET_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_SLEEP_EN);
+
+    /* O deep sleep começa alguns ciclos depois */
+    while (true)
+    {
+    }
+}
+
+/* Função: inicializa o estado do wake stub, se não for válido (primeiro boot)
+ * Parâmetros: distância (cm) a partir da qual a lixeira é considerada quase cheia
+ * Retorno: nenhum
+ */
+void wake_stub_inicializa(uint8_t distancia_quase_cheia_cm)
+{
+    decisao_wake_stub_inicializa(&estado_wake_stub, distancia_quase_cheia_cm);
+}
+
+/* Função: registra o resultado do boot completo para o wake stub usar nos
+ *         próximos wake-ups. Deve ser chamada logo antes de entrar em deep sleep.
+ * Parâmetros: - distância medida (cm) ou DECISAO_WAKE_STUB_DISTANCIA_NAO_MEDIDA (sensor não lido)
+ *             - true: há uplinks pendentes na fila
+ *             - quantidade máxima de wake-ups por timer seguidos sem boot completo
+ *             - tempo de deep sleep entre dois wake-ups por timer (us)
+ * Retorno: nenhum
+ */
+void wake_stub_prepara_deep_sleep(uint8_t distancia_cm, bool uplinks_pendentes, uint8_t max_wakes_pulados, uint64_t tempo_em_sleep_us)
+{
+    uint64_t ticks_sleep = rtc_time_us_to_slowclk(tempo_em_sleep_us, REG_READ(RTC_SLOW_CLK_CAL_REG));
+
+    decisao_wake_stub_registra_boot_completo(&estado_wake_stub, distancia_cm, uplinks_pendentes, max_wakes_pulados, ticks_sleep);
+}
+
+/* Função: obtém os wake-ups resolvidos pelo wake stub desde o último boot completo
+ * Parâmetros: - ponteiro para a quantidade de wake-ups em que o ESP32 voltou direto a dormir
+ *             - ponteiro para o tempo médio gasto no wake stub nesses wake-ups (us)
+ * Retorno: nenhum
+ */
+void wake_stub_obtem_estatisticas(uint32_t * pt_wakes_pulados, uint32_t * pt_tempo_medio_no_stub_us)
+{
+    *pt_wakes_pulados = estado_wake_stub.wakes_pulados_seguidos;
+    *pt_tempo_medio_no_stub_us = 0;
+
+    if (estado_wake_stub.wakes_pulados_seguidos > 0)
+    {
+        *pt_tempo_medio_no_stub_us = (uint32_t)(rtc_time_slowclk_to_us(estado_wake_stub.ticks_no_stub, REG_READ(RTC_SLOW_CLK_CAL_REG)) /
+                                                estado_wake_stub.wakes_pulados_seguidos);
+    }
+}
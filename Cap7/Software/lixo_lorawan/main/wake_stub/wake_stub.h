@@ -0,0 +1,23 @@
+/* Header file do wake stub do deep sleep
+ *
+ * O wake stub (esp_wake_deep_sleep()) é executado da memória RTC logo que o
+ * ESP32 acorda do deep sleep, antes do bootloader, da aplicação e do
+ * FreeRTOS. Nos wake-ups por timer em que não há nada a fazer (ver
+ * decisao_wake_stub), ele rearma o timer RTC e volta direto ao deep sleep,
+ * evitando o boot completo, a configuração do módulo LoRaWAN e a leitura
+ * do sensor. Nos demais casos, o boot segue normalmente.
+ */
+
+#ifndef WAKE_STUB_DEFS_H
+#define WAKE_STUB_DEFS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "decisao_wake_stub.h"
+
+#endif
+
+/* Prototipos */
+void wake_stub_inicializa(uint8_t distancia_quase_cheia_cm);
+void wake_stub_prepara_deep_sleep(uint8_t distancia_cm, bool uplinks_pendentes, uint8_t max_wakes_pulados, uint64_t tempo_em_sleep_us);
+void wake_stub_obtem_estatisticas(uint32_t * pt_wakes_pulados, uint32_t * pt_tempo_medio_no_stub_us);
@@ -5,39 +5,87 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include "nvs_flash.h"
 #include "LoRaWAN.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 
+/* Log diferido: nível de log deste módulo */
+#define LOG_DIFERIDO_NIVEL_MODULO  LOG_DIFERIDO_NIVEL_INFO
+#include "../log_diferido/log_diferido.h"
+#include "../sessao_lorawan/sessao_lorawan.h"
+
 /* Definição - debug */
 #define LORAWAN_TAG "LORAWAN"
 
 /* Definição - tamanho máximo de um comando AT para módulo LoRaWAN */
 #define TAM_MAX_CMD_AT_LORAWAN 100
 
-/* Definição - tamanho máximo do payload LoRaWAN */
-#define TAM_MAX_PAYLOAD_LORAWAN 80
-
 /* Definição - tamanho máximo da resposta enviada pelo módulo LoRaWAN */
 #define TAM_MAX_RESP_MOD_LORAWAN 200
 
+/* Definições - namespace e chave da sessão LoRaWAN (OTAA) na NVS */
+#define NAMESPACE_NVS_LORAWAN    "lorawan"
+#define CHAVE_NVS_SESSAO_LORAWAN "sessao"
+
 /* Funções locais */
-static void envia_bytes_uart(char *pt_bytes, int qtde_bytes);
-static void aguarda_e_recebe_resposta_mod_lorawan(char *pt_bytes, int qtde_bytes);
+static void envia_bytes_uart(char *pt_bytes, int qtde_bytes, char *pt_resposta, int tam_max_resposta);
+static esp_err_t aguarda_e_recebe_resposta_mod_lorawan(void);
+static void trata_evento_downlink(TFatia_at evento, void *pt_contexto);
+static int64_t instante_atual_ms(void);
+static esp_err_t executa_comando_mod_lorawan(char *pt_cmd, char *pt_resposta, int tam_max_resposta);
+static void trata_evento_join(TFatia_at evento, void *pt_contexto);
+static void ativa_sessao_lorawan(void);
+static esp_err_t restaura_sessao_no_modulo(void);
+static esp_err_t tenta_join_lorawan(void);
+static esp_err_t le_campo_sessao_do_modulo(const char *pt_campo, uint8_t *pt_bytes, int qtde_bytes);
+static esp_err_t grava_sessao_lorawan_na_flash(void);
+static esp_err_t le_sessao_lorawan_da_flash(TSessao_lorawan *pt_sessao);
+static esp_err_t prepara_sessao_para_envio(void);
+static void registra_uplink_na_sessao(void);
 
 /* Credenciais LoRaWAN */
 static const char DEVADDR[] = "00:00:00:00";
 static const char APPSKEY[] = "00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00";
 static const char NWKSKEY[] = "00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00";
 static const char APPEUI[] = "00:00:00:00:00:00:00:00";
+static const char DEVEUI[] = "00:00:00:00:00:00:00:00";
+static const char APPKEY[] = "00:00:00:00:00:00:00:00:00:00:00:00:00:00:00:00";
+
+
+/* Agendador de uplinks (tempo no ar, duty cycle e fair-use) */
+static TAgendador_uplinks agendador_uplinks;
 
+/* Métricas da comunicação com o módulo LoRaWAN */
+static TMetricas_lorawan metricas_lorawan;
+
+/* Fila de eventos da UART (consumida pela tarefa leitora do despachante AT) */
+static QueueHandle_t fila_eventos_uart = NULL;
+
+/* Tratador de downlinks registrado pela aplicação */
+static TTratador_downlink_lorawan tratador_downlink = NULL;
+
+/* Sessão LoRaWAN (OTAA): cópia exata em memória RTC, mantida em reboots, e
+ * estado do join em andamento (backoff e DR). A cópia da NVS só é gravada a
+ * cada SESSAO_LORAWAN_RESERVA_FCNT uplinks (ver sessao_lorawan).
+ */
+static RTC_NOINIT_ATTR TSessao_lorawan sessao_lorawan;
+static RTC_NOINIT_ATTR TJoin_lorawan join_lorawan;
+static bool gravacao_sessao_pendente = false;
+static volatile uint32_t downlinks_nao_registrados = 0;
+static char dev_addr_sessao[SESSAO_LORAWAN_TAM_TEXTO(SESSAO_LORAWAN_TAM_DEV_ADDR)] = {0};
 
-/* Porta LoRaWAN */
-static const int porta_lorawan = 12;
+/* Fila dos resultados das tentativas de join (preenchida pelo tratador do evento de join) */
+static QueueHandle_t fila_resultados_join = NULL;
 
 /* Função: inicializa LoRaWAN
  * Parâmetros: nenhum
@@ -48,6 +96,9 @@ void init_lorawan(void)
     char cmd_modulo_lorawan[TAM_MAX_CMD_AT_LORAWAN] = {0};
     char resposta_modulo_lorawan[TAM_MAX_RESP_MOD_LORAWAN] = {0};
     int intr_alloc_flags = 0;
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_OTAA)
+    esp_err_t resultado_nvs;
+#endif
     uart_config_t uart_config = {
         .baud_rate = UART_BAUD_RATE,
         .data_bits = UART_DATA_8_BITS,
@@ -59,10 +110,27 @@ void init_lorawan(void)
 
     ESP_LOGI(LORAWAN_TAG, "Inicializando LoRaWAN...");
 
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_OTAA)
+    /* Inicializa NVS (sessão LoRaWAN) */
+    resultado_nvs = nvs_flash_init();
+
+    if ((resultado_nvs == ESP_ERR_NVS_NO_FREE_PAGES) || (resultado_nvs == ESP_ERR_NVS_NEW_VERSION_FOUND))
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        resultado_nvs = nvs_flash_init();
+    }
+
+    ESP_ERROR_CHECK(resultado_nvs);
+#endif
+
+    /* Inicializa agendador de uplinks */
+    agendador_uplinks_inicializa(&agendador_uplinks, PLANO_FREQUENCIAS_LORAWAN, ORCAMENTO_DIARIO_TEMPO_NO_AR_LORAWAN_MS, instante_atual_ms());
+
     /* Inicializa comunicação serial com módulo LoRaWAN */
     ESP_LOGI(LORAWAN_TAG, "Configurando UART para comunicar com MOD_LORAWAN...\n");
 
-    ESP_ERROR_CHECK(uart_driver_install(PORTA_UART_MOD_LORAWAN, TAM_BUFFER_UART_MOD_LORAWAN * 2, 0, 0, NULL, intr_alloc_flags));
+    ESP_ERROR_CHECK(uart_driver_install(PORTA_UART_MOD_LORAWAN, TAM_BUFFER_UART_MOD_LORAWAN * 2, 0,
+                                        DESPACHANTE_AT_TAM_FILA_EVENTOS_UART, &fila_eventos_uart, intr_alloc_flags));
     ESP_ERROR_CHECK(uart_param_config(PORTA_UART_MOD_LORAWAN, &uart_config));
     ESP_ERROR_CHECK(uart_set_pin(PORTA_UART_MOD_LORAWAN,
                                  GPIO_COMM_UART_MOD_LORAWAN_TX,
@@ -70,15 +138,31 @@ void init_lorawan(void)
                                  GPIO_COMM_UART_MOD_LORAWAN_RTS,
                                  GPIO_COMM_UART_MOD_LORAWAN_CTS));
 
+    /* Inicializa despachante AT (tarefa leitora da UART) e tratador de downlinks */
+    metricas_lorawan_inicializa(&metricas_lorawan);
+    ESP_ERROR_CHECK(despachante_at_inicializa(PORTA_UART_MOD_LORAWAN, fila_eventos_uart, &metricas_lorawan));
+    ESP_ERROR_CHECK(despachante_at_registra_tratador(DESPACHANTE_AT_PREFIXO_DOWNLINK, trata_evento_downlink, NULL));
+
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_OTAA)
+    fila_resultados_join = xQueueCreate(1, sizeof(bool));
+
+    if (fila_resultados_join == NULL)
+    {
+        ESP_ERROR_CHECK(ESP_ERR_NO_MEM);
+    }
+
+    ESP_ERROR_CHECK(despachante_at_registra_tratador(DESPACHANTE_AT_PREFIXO_JOIN, trata_evento_join, NULL));
+#endif
+
     /* Inicializa módulo LoRaWAN */
     /* Acorda módulo */
     ESP_LOGI(LORAWAN_TAG, "Acordando modulo LoRaWAN...");
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
     snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT\n");
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
 
     /* Reseta módulo */
@@ -86,40 +170,43 @@ void init_lorawan(void)
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
     snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "ATZ\n");
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     vTaskDelay(5000 / portTICK_PERIOD_MS);
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
     
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_ABP)
     /* Configura Join mode para ABP */
     ESP_LOGI(LORAWAN_TAG, "Configurando Join mode em ABP...");
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
     snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+NJM=0\n");
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
+#endif
 
-    /* Configura Classe LoRaWAN como A */
-    ESP_LOGI(LORAWAN_TAG, "Configurando classe LoRaWAN como A...");
+    /* Configura Classe LoRaWAN */
+    ESP_LOGI(LORAWAN_TAG, "Configurando classe LoRaWAN como %c...", CLASSE_LORAWAN);
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
-    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+CLASS=A\n");
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+CLASS=%c\n", CLASSE_LORAWAN);
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
 
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_ABP)
      /* Configura Device Address */
     ESP_LOGI(LORAWAN_TAG, "Configurando Device Address...");
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
     snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+DADDR=%s\n", DEVADDR);
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
 
     /* Le DEVADDR de volta */
@@ -127,9 +214,9 @@ void init_lorawan(void)
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
     snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+DADDR=?\n");
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Leitura do Device Address: %s", resposta_modulo_lorawan);
 
     /* Configura Application Session Key */
@@ -137,9 +224,9 @@ void init_lorawan(void)
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
     snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+APPSKEY=%s\n", APPSKEY);
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
 
     /* Configura Network Session Key */
@@ -147,57 +234,105 @@ void init_lorawan(void)
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
     snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+NWKSKEY=%s\n", NWKSKEY);
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
+    aguarda_e_recebe_resposta_mod_lorawan();
+    ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
+
+#else
+    /* Configura Device EUI (OTAA) */
+    ESP_LOGI(LORAWAN_TAG, "Configurando Device EUI...");
+    memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
+    memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+DEVEUI=%s\n", DEVEUI);
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
+    aguarda_e_recebe_resposta_mod_lorawan();
+    ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
+
+    /* Configura Application Key (OTAA) */
+    ESP_LOGI(LORAWAN_TAG, "Configurando Application Key...");
+    memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
+    memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+APPKEY=%s\n", APPKEY);
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
+#endif
 
     /* Configura Application EUI */
     ESP_LOGI(LORAWAN_TAG, "Configurando Application EUI...");
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
     snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+APPEUI=%s\n", APPEUI);
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
 
-    /* Liga ADR */
-    ESP_LOGI(LORAWAN_TAG, "Configurando ADR em 1");
+    /* Desliga ADR: o DR fica fixo em DR_LORAWAN, pois o tempo no ar contabilizado
+     * pelo agendador de uplinks (janela de ocupação do módulo e orçamento diário)
+     * e o limite de payload (TAM_MAX_PAYLOAD_LORAWAN) são calculados com ele.
+     * Com ADR, a rede (ou o back-off do ADR) mudaria o DR sem o agendador saber.
+     */
+    ESP_LOGI(LORAWAN_TAG, "Configurando ADR em 0");
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
-    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+ADR=1\n");
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+ADR=0\n");
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
 
     /* Configura DR em DR2 (adequado para o envio de 8 bytes do payload do projeto) */
-    ESP_LOGI(LORAWAN_TAG, "Configurando DR em DR2");
+    ESP_LOGI(LORAWAN_TAG, "Configurando DR em DR%d", DR_LORAWAN);
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
-    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+DR=2\n");
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+DR=%d\n", DR_LORAWAN);
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
     ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    aguarda_e_recebe_resposta_mod_lorawan();
     ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
 
-    
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_OTAA)
+    /* Sessão: retomada da memória RTC ou da NVS, ou obtida num join. Sem
+     * sessão, a inicialização não espera pelo join: ele é tentado nos envios
+     * (que são adiados até o join-accept), conforme o backoff.
+     */
+    ativa_sessao_lorawan();
+#endif
 
     ESP_LOGI(LORAWAN_TAG, "LoRaWAN inicializado");
 }
 
-/* Função: envia mensagem (binaria) via LoRaWAN (ABP)
+/* Função: envia mensagem (binaria) via LoRaWAN (ABP), na porta padrão
  * Parâmetros: - ponteiro para array de bytes a enviar
  *             - quantidade de bytes a serem enviados
- * Retorno: nenhum
+ * Retorno: ver envia_mensagem_binaria_lorawan_ABP_na_porta()
  */
-void envia_mensagem_binaria_lorawan_ABP(char *pt_bytes, int qtde_bytes)
+esp_err_t envia_mensagem_binaria_lorawan_ABP(char *pt_bytes, int qtde_bytes)
+{
+    return envia_mensagem_binaria_lorawan_ABP_na_porta(PORTA_PADRAO_LORAWAN, pt_bytes, qtde_bytes);
+}
+
+/* Função: envia mensagem (binaria) via LoRaWAN (ABP)
+ * Parâmetros: - porta LoRaWAN (FPort) do uplink
+ *             - ponteiro para array de bytes a enviar
+ *             - quantidade de bytes a serem enviados
+ * Retorno: ESP_OK: envio aceito pelo módulo LoRaWAN
+ *          ESP_ERR_TIMEOUT: envio adiado pelo agendador de uplinks (orçamento
+ *                           de tempo no ar ou duty cycle)
+ *          demais: envio recusado pelo módulo (ou payload inválido)
+ */
+esp_err_t envia_mensagem_binaria_lorawan_ABP_na_porta(int porta, char *pt_bytes, int qtde_bytes)
 {
     char cmd_modulo_lorawan[TAM_MAX_CMD_AT_LORAWAN] = {0};
     char resposta_modulo_lorawan[TAM_MAX_RESP_MOD_LORAWAN] = {0};
-    char payload[TAM_MAX_PAYLOAD_LORAWAN] = {0};
+    char payload[(TAM_MAX_PAYLOAD_LORAWAN * 2) + 1] = {0};
     char byte_convertido[3] = {0};
+    int64_t tempo_espera_ms = 0;
+    esp_err_t status_envio;
     int i = 0;
 
     /* Se o numero de bytes a serem enviados exceder o limite, nada é feito */
@@ -206,49 +341,634 @@ void envia_mensagem_binaria_lorawan_ABP(char *pt_bytes, int qtde_bytes)
         ESP_LOGE(LORAWAN_TAG, "Tamanho do payload (%d) excedeu o tamaho maximo permitido (%d)",
                  qtde_bytes,
                  TAM_MAX_PAYLOAD_LORAWAN);
-        return;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    /* Consulta o agendador: espera curta (módulo ocupado) é aguardada aqui;
+     * espera longa (orçamento/duty cycle) faz o envio ser adiado
+     */
+    tempo_espera_ms = tempo_ate_liberar_envio_lorawan_ms(qtde_bytes);
+
+    if (tempo_espera_ms < 0)
+    {
+        ESP_LOGE(LORAWAN_TAG, "Payload de %d bytes nao pode ser enviado em DR%d", qtde_bytes, DR_LORAWAN);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (tempo_espera_ms > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+    {
+        LOGD_I(LORAWAN_TAG, "Envio adiado pelo agendador (liberado em %d ms)", (int32_t)tempo_espera_ms);
+        agendador_uplinks_registra_adiamento(&agendador_uplinks);
+        return ESP_ERR_TIMEOUT;
+    }
+
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_OTAA)
+    status_envio = prepara_sessao_para_envio();
+
+    if (status_envio != ESP_OK)
+    {
+        return status_envio;
+    }
+
+    /* Uma tentativa de join pode ter ocupado o módulo e o tempo no ar */
+    tempo_espera_ms = tempo_ate_liberar_envio_lorawan_ms(qtde_bytes);
+
+    if (tempo_espera_ms > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+    {
+        LOGD_I(LORAWAN_TAG, "Envio adiado pelo agendador (liberado em %d ms)", (int32_t)tempo_espera_ms);
+        agendador_uplinks_registra_adiamento(&agendador_uplinks);
+        return ESP_ERR_TIMEOUT;
+    }
+#endif
+
+    if (tempo_espera_ms > 0)
+    {
+        vTaskDelay((tempo_espera_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
     }
 
     for (i = 0; i < qtde_bytes; i++)
     {
         memset(byte_convertido, 0x00, sizeof(byte_convertido));
-        snprintf(byte_convertido, sizeof(byte_convertido), "%02X", pt_bytes[i]);        
+        snprintf(byte_convertido, sizeof(byte_convertido), "%02X", (uint8_t)pt_bytes[i]);
         strcat(payload, byte_convertido);
     }
 
-    ESP_LOGI(LORAWAN_TAG, "Enviando mensagem (binaria)...");
+    LOGD_I(LORAWAN_TAG, "Enviando mensagem (binaria), %d bytes...", qtde_bytes);
     memset(cmd_modulo_lorawan, 0x00, sizeof(cmd_modulo_lorawan));
     memset(resposta_modulo_lorawan, 0x00, sizeof(resposta_modulo_lorawan));
-    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+SENDB=%d:%s\n", porta_lorawan, payload);
-    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan));
-    ESP_LOGI(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
-    aguarda_e_recebe_resposta_mod_lorawan(resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
-    ESP_LOGI(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+SENDB=%d:%s\n", porta, payload);
+    envia_bytes_uart(cmd_modulo_lorawan, strlen(cmd_modulo_lorawan), resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    ESP_LOGD(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", cmd_modulo_lorawan);
+    status_envio = aguarda_e_recebe_resposta_mod_lorawan();
+    ESP_LOGD(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", resposta_modulo_lorawan);
+
+    if (status_envio != ESP_OK)
+    {
+        LOGD_E(LORAWAN_TAG, "Envio recusado pelo modulo LoRaWAN (%s)", esp_err_to_name(status_envio));
+        return status_envio;
+    }
+
+    agendador_uplinks_registra_envio(&agendador_uplinks, instante_atual_ms(), DR_LORAWAN, qtde_bytes);
+
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_OTAA)
+    registra_uplink_na_sessao();
+#endif
+
+    LOGD_I(LORAWAN_TAG, "Tempo no ar: %u us neste uplink, %u ms em %u uplinks (%u adiamentos)",
+           agendador_uplinks.tempo_no_ar_ultimo_uplink_us,
+           (uint32_t)(agendador_uplinks.tempo_no_ar_total_us / 1000),
+           agendador_uplinks.total_uplinks,
+           agendador_uplinks.total_adiamentos);
+
+    return ESP_OK;
+}
+
+/* Função: informa quanto tempo falta para um uplink poder ser feito
+ *         (módulo ocupado, duty cycle e orçamento diário de tempo no ar)
+ * Parâmetros: quantidade de bytes do payload pretendido
+ * Retorno: tempo de espera (ms). 0 = pode enviar agora.
+ *          -1 = payload não pode ser enviado no DR configurado.
+ */
+int64_t tempo_ate_liberar_envio_lorawan_ms(int qtde_bytes)
+{
+    return agendador_uplinks_tempo_ate_liberar_ms(&agendador_uplinks, instante_atual_ms(), DR_LORAWAN, qtde_bytes);
+}
+
+/* Função: obtém o DevAddr configurado no módulo LoRaWAN (formato dos comandos AT, ex: "26:0B:12:34").
+ *         Em OTAA, é o DevAddr atribuído no join (da sessão ativa).
+ * Parâmetros: nenhum
+ * Retorno: DevAddr
+ */
+const char * obtem_dev_addr_lorawan(void)
+{
+#if (MODO_JOIN_LORAWAN == MODO_JOIN_LORAWAN_OTAA)
+    return dev_addr_sessao;
+#else
+    return DEVADDR;
+#endif
+}
+
+/* Função: obtém os contadores de tempo no ar dos uplinks feitos
+ * Parâmetros: ponteiro para a estrutura que receberá os contadores
+ * Retorno: nenhum
+ */
+void obtem_contadores_tempo_no_ar_lorawan(TAgendador_uplinks *pt_contadores)
+{
+    memcpy(pt_contadores, &agendador_uplinks, sizeof(TAgendador_uplinks));
+}
+
+/* Função: obtém as métricas da comunicação com o módulo LoRaWAN
+ * Parâmetros: ponteiro para a estrutura que receberá as métricas
+ * Retorno: nenhum
+ */
+void obtem_metricas_lorawan(TMetricas_lorawan *pt_metricas)
+{
+    memcpy(pt_metricas, &metricas_lorawan, sizeof(TMetricas_lorawan));
+}
+
+/* Função: loga resumo das métricas da comunicação com o módulo LoRaWAN e
+ *         seu snapshot binário (em hexadecimal, para decodificação no
+ *         computador com Ferramentas/decodifica_metricas_lorawan)
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+void loga_metricas_lorawan(void)
+{
+    uint8_t snapshot[METRICAS_LORAWAN_TAM_MAX_SNAPSHOT] = {0};
+    char snapshot_hex[(METRICAS_LORAWAN_TAM_MAX_SNAPSHOT * 2) + 1] = {0};
+    int tam_snapshot = 0;
+    int i;
+
+    ESP_LOGI(LORAWAN_TAG, "Metricas: %u comandos (%u OK, %u erros, %u BUSY, %u timeouts), UART: %u bytes escritos, %u lidos, %u overflows",
+             metricas_lorawan.total_comandos,
+             metricas_lorawan.total_ok,
+             metricas_lorawan.total_erros,
+             metricas_lorawan.total_busy,
+             metricas_lorawan.total_timeouts,
+             metricas_lorawan.bytes_escritos_uart,
+             metricas_lorawan.bytes_lidos_uart,
+             metricas_lorawan.total_overflows_uart);
+
+    tam_snapshot = metricas_lorawan_gera_snapshot(&metricas_lorawan, snapshot, sizeof(snapshot));
+
+    for (i = 0; i < tam_snapshot; i++)
+    {
+        snprintf(&snapshot_hex[i * 2], 3, "%02X", snapshot[i]);
+    }
+
+    ESP_LOGI(LORAWAN_TAG, "Snapshot das metricas: %s", snapshot_hex);
+}
+
+/* Função: registra o tratador de downlinks recebidos (classe A ou C)
+ * Parâmetros: função tratadora (não deve bloquear)
+ * Retorno: nenhum
+ */
+void registra_tratador_downlink_lorawan(TTratador_downlink_lorawan tratador)
+{
+    tratador_downlink = tratador;
 }
 
-/* Função: envia bytes para uart (do módulo LoRaWAN)
+/* Função: envia bytes para uart (do módulo LoRaWAN), iniciando um comando AT
+ *         no despachante. Deve ser seguida de aguarda_e_recebe_resposta_mod_lorawan().
  * Parâmetros: - ponteiro para array de bytes a enviar
  *             - quantidade de bytes a serem enviados
+ *             - ponteiro para array de bytes da resposta (preenchido até
+ *               aguarda_e_recebe_resposta_mod_lorawan() retornar)
+ *             - quantidade máxima de bytes permitidos na resposta
+ * Retorno: nenhum
+ */
+static void envia_bytes_uart(char *pt_bytes, int qtde_bytes, char *pt_resposta, int tam_max_resposta)
+{
+    if (despachante_at_inicia_comando(pt_bytes, qtde_bytes, pt_resposta, tam_max_resposta) != ESP_OK)
+    {
+        ESP_LOGE(LORAWAN_TAG, "Falha ao escrever comando na UART");
+    }
+}
+
+/* Função: aguarda e recebe resposta enviada do módulo LoRaWAN (até o
+ *         resultado final do comando: OK, ERROR ou BUSY), no array informado
+ *         a envia_bytes_uart()
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: comando aceito
+ *          !ESP_OK: comando recusado (erro, busy ou nenhuma resposta)
+ */
+static esp_err_t aguarda_e_recebe_resposta_mod_lorawan(void)
+{
+    esp_err_t resultado = despachante_at_aguarda_resultado(TEMPO_MAX_RESPOSTA_MOD_LORAWAN_MS);
+
+    if (resultado == ESP_ERR_TIMEOUT)
+    {
+        ESP_LOGE(LORAWAN_TAG, "Modulo LoRaWAN nao respondeu em %d ms", TEMPO_MAX_RESPOSTA_MOD_LORAWAN_MS);
+    }
+
+    return resultado;
+}
+
+/* Função: tratador do evento de downlink (+EVT:RX_...), executado na tarefa
+ *         leitora da UART. Repassa o downlink ao tratador da aplicação.
+ * Parâmetros: - fatia do evento (após o prefixo)
+ *             - contexto (não utilizado)
+ * Retorno: nenhum
+ */
+static void trata_evento_downlink(TFatia_at evento, void *pt_contexto)
+{
+    TDownlink_at downlink;
+
+    if (despachante_at_interpreta_downlink(evento, &downlink) == false)
+    {
+        ESP_LOGE(LORAWAN_TAG, "Evento de downlink em formato desconhecido: %.*s", evento.tamanho, evento.pt_dados);
+        return;
+    }
+
+    downlinks_nao_registrados++;
+
+    LOGD_I(LORAWAN_TAG, "Downlink recebido (RX%c, RSSI %d, SNR %d, porta %d, %d bytes)",
+           (downlink.janela == 'C') ? 'C' : ('0' + downlink.janela),
+           downlink.rssi,
+           downlink.snr,
+           downlink.porta,
+           downlink.dados_hex.tamanho / 2);
+
+    if (tratador_downlink != NULL)
+    {
+        tratador_downlink(&downlink);
+    }
+}
+
+/* Função: obtém o instante atual, em ms (relógio do sistema)
+ * Parâmetros: nenhum
+ * Retorno: instante atual (ms)
+ */
+static int64_t instante_atual_ms(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return ((int64_t)tv.tv_sec * 1000LL) + (tv.tv_usec / 1000);
+}
+
+/* Função: envia um comando AT ao módulo LoRaWAN e aguarda seu resultado
+ * Parâmetros: - comando (terminado em '\n')
+ *             - ponteiro para array de bytes da resposta e quantidade máxima de bytes
+ * Retorno: ver aguarda_e_recebe_resposta_mod_lorawan()
+ */
+static esp_err_t executa_comando_mod_lorawan(char *pt_cmd, char *pt_resposta, int tam_max_resposta)
+{
+    esp_err_t resultado;
+
+    memset(pt_resposta, 0x00, tam_max_resposta);
+    envia_bytes_uart(pt_cmd, strlen(pt_cmd), pt_resposta, tam_max_resposta);
+    ESP_LOGD(LORAWAN_TAG, "Enviando comando ao modulo LoRaWAN: %s", pt_cmd);
+    resultado = aguarda_e_recebe_resposta_mod_lorawan();
+    ESP_LOGD(LORAWAN_TAG, "Resposta do modulo LoRaWAN: %s", pt_resposta);
+
+    return resultado;
+}
+
+/* Função: tratador do evento de resultado do join (+EVT:JOINED ou
+ *         +EVT:JOIN_FAILED_...), executado na tarefa leitora da UART.
+ *         Repassa o resultado à tentativa de join em andamento.
+ * Parâmetros: - fatia do evento (após o prefixo)
+ *             - contexto (não utilizado)
  * Retorno: nenhum
  */
-static void envia_bytes_uart(char *pt_bytes, int qtde_bytes)
+static void trata_evento_join(TFatia_at evento, void *pt_contexto)
+{
+    bool sucesso = despachante_at_fatia_comeca_com(evento, "ED");
+
+    LOGD_I(LORAWAN_TAG, "Resultado do join: %s", sucesso ? "join-accept recebido" : "sem join-accept");
+    xQueueOverwrite(fila_resultados_join, &sucesso);
+}
+
+/* Função: ativa a sessão LoRaWAN (OTAA): retoma a sessão da memória RTC
+ *         (reboot) ou da NVS (queda de energia) e a restaura no módulo; sem
+ *         sessão válida, faz uma tentativa de join, se o backoff permitir
+ *         (as seguintes são feitas nos envios, sem bloquear a aplicação)
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void ativa_sessao_lorawan(void)
+{
+    TSessao_lorawan sessao_flash;
+
+    if ( (sessao_lorawan_valida(&sessao_lorawan) == true) && (sessao_lorawan_expirou(&sessao_lorawan) == false) )
+    {
+        ESP_LOGI(LORAWAN_TAG, "Sessao LoRaWAN retomada da memoria RTC (FCntUp %u)", sessao_lorawan.fcnt_up);
+    }
+    else if ( (le_sessao_lorawan_da_flash(&sessao_flash) == ESP_OK) &&
+              (sessao_lorawan_valida(&sessao_flash) == true) )
+    {
+        /* Contadores abaixo do reservado podem ter sido usados depois da gravação */
+        memcpy(&sessao_lorawan, &sessao_flash, sizeof(TSessao_lorawan));
+        sessao_lorawan_retoma_da_flash(&sessao_lorawan);
+        ESP_LOGI(LORAWAN_TAG, "Sessao LoRaWAN retomada da NVS (FCntUp %u)", sessao_lorawan.fcnt_up);
+
+        if (sessao_lorawan_expirou(&sessao_lorawan) == true)
+        {
+            sessao_lorawan_invalida(&sessao_lorawan);
+        }
+        else
+        {
+            gravacao_sessao_pendente = true;
+            grava_sessao_lorawan_na_flash();
+        }
+    }
+    else
+    {
+        sessao_lorawan_invalida(&sessao_lorawan);
+    }
+
+    if ( (sessao_lorawan_valida(&sessao_lorawan) == true) && (restaura_sessao_no_modulo() != ESP_OK) )
+    {
+        ESP_LOGE(LORAWAN_TAG, "Falha ao restaurar a sessao no modulo LoRaWAN. Fazendo novo join...");
+        sessao_lorawan_invalida(&sessao_lorawan);
+    }
+
+    if (sessao_lorawan_valida(&sessao_lorawan) == false)
+    {
+        tenta_join_lorawan();
+    }
+}
+
+/* Função: restaura no módulo LoRaWAN a sessão obtida num join (DevAddr,
+ *         chaves de sessão e contadores de quadros), sem novo join
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: sessão restaurada
+ *          !ESP_OK: módulo recusou algum comando
+ */
+static esp_err_t restaura_sessao_no_modulo(void)
+{
+    char cmd_modulo_lorawan[TAM_MAX_CMD_AT_LORAWAN] = {0};
+    char resposta_modulo_lorawan[TAM_MAX_RESP_MOD_LORAWAN] = {0};
+    char campo[SESSAO_LORAWAN_TAM_TEXTO(SESSAO_LORAWAN_TAM_CHAVE)] = {0};
+    esp_err_t resultado;
+
+    /* A sessão do join é usada como uma sessão ABP */
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+NJM=0\n");
+    resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+
+    if (resultado == ESP_OK)
+    {
+        sessao_lorawan_formata_hex(sessao_lorawan.dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR, campo);
+        snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+DADDR=%s\n", campo);
+        resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        sessao_lorawan_formata_hex(sessao_lorawan.app_s_key, SESSAO_LORAWAN_TAM_CHAVE, campo);
+        snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+APPSKEY=%s\n", campo);
+        resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        sessao_lorawan_formata_hex(sessao_lorawan.nwk_s_key, SESSAO_LORAWAN_TAM_CHAVE, campo);
+        snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+NWKSKEY=%s\n", campo);
+        resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+FCU=%u\n", sessao_lorawan.fcnt_up);
+        resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+FCD=%u\n", sessao_lorawan.fcnt_down);
+        resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        sessao_lorawan_formata_hex(sessao_lorawan.dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR, dev_addr_sessao);
+    }
+
+    return resultado;
+}
+
+/* Função: faz uma tentativa de join (OTAA), se o backoff permitir: envia o
+ *         join-request no DR da tentativa e aguarda o evento de resultado.
+ *         Com o join-accept, lê a sessão do módulo e a grava na NVS.
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: join feito, sessão ativa
+ *          ESP_ERR_TIMEOUT: próxima tentativa ainda não liberada pelo backoff
+ *          demais: tentativa sem join-accept (a próxima é agendada)
+ */
+static esp_err_t tenta_join_lorawan(void)
+{
+    char cmd_modulo_lorawan[TAM_MAX_CMD_AT_LORAWAN] = {0};
+    char resposta_modulo_lorawan[TAM_MAX_RESP_MOD_LORAWAN] = {0};
+    uint8_t dev_addr[SESSAO_LORAWAN_TAM_DEV_ADDR];
+    uint8_t app_s_key[SESSAO_LORAWAN_TAM_CHAVE];
+    uint8_t nwk_s_key[SESSAO_LORAWAN_TAM_CHAVE];
+    int64_t tempo_espera_ms;
+    bool join_aceito = false;
+    esp_err_t resultado;
+    int dr;
+
+    /* Mantém o backoff de um join em andamento (memória RTC) ou começa um novo */
+    sessao_lorawan_join_inicializa(&join_lorawan, PLANO_FREQUENCIAS_LORAWAN, DR_JOIN_INICIAL_LORAWAN, DR_JOIN_MINIMO_LORAWAN,
+                                   esp_random(), instante_atual_ms());
+    tempo_espera_ms = sessao_lorawan_join_tempo_ate_tentativa_ms(&join_lorawan, instante_atual_ms());
+
+    if (tempo_espera_ms > 0)
+    {
+        LOGD_I(LORAWAN_TAG, "Sem sessao LoRaWAN. Proxima tentativa de join em %d ms", (int32_t)tempo_espera_ms);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    dr = sessao_lorawan_join_dr(&join_lorawan);
+    ESP_LOGI(LORAWAN_TAG, "Tentativa de join %u no DR%d...", join_lorawan.total_tentativas + 1, dr);
+
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+NJM=1\n");
+    resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+
+    if (resultado == ESP_OK)
+    {
+        snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+DR=%d\n", dr);
+        resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        /* Uma tentativa por comando (sem o auto-join do módulo: o backoff é do firmware) */
+        xQueueReset(fila_resultados_join);
+        snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+JOIN=1:0:10:1\n");
+        resultado = executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+    }
+
+    if (resultado == ESP_OK)
+    {
+        /* O join-request ocupa o canal: entra na conta de tempo no ar do agendador */
+        agendador_uplinks_registra_envio(&agendador_uplinks, instante_atual_ms(), dr,
+                                         SESSAO_LORAWAN_TAM_JOIN_REQUEST - OVERHEAD_PAYLOAD_LORAWAN);
+
+        if (xQueueReceive(fila_resultados_join, &join_aceito, TEMPO_MAX_RESULTADO_JOIN_LORAWAN_MS / portTICK_PERIOD_MS) != pdTRUE)
+        {
+            ESP_LOGE(LORAWAN_TAG, "Resultado do join nao recebido em %d ms", TEMPO_MAX_RESULTADO_JOIN_LORAWAN_MS);
+        }
+    }
+
+    if (join_aceito == false)
+    {
+        sessao_lorawan_join_registra_falha(&join_lorawan, instante_atual_ms());
+        ESP_LOGI(LORAWAN_TAG, "Join sem sucesso (%u tentativas, %u ms no ar)", join_lorawan.total_tentativas,
+                 (uint32_t)(join_lorawan.tempo_no_ar_total_us / 1000));
+        return ESP_FAIL;
+    }
+
+    sessao_lorawan_join_registra_sucesso(&join_lorawan, instante_atual_ms());
+    ESP_LOGI(LORAWAN_TAG, "Join feito em %u tentativa(s), %u ms no ar", join_lorawan.total_tentativas,
+             (uint32_t)(join_lorawan.tempo_no_ar_total_us / 1000));
+
+    /* Sessão atribuída no join */
+    if ( (le_campo_sessao_do_modulo("DADDR", dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR) != ESP_OK) ||
+         (le_campo_sessao_do_modulo("APPSKEY", app_s_key, SESSAO_LORAWAN_TAM_CHAVE) != ESP_OK) ||
+         (le_campo_sessao_do_modulo("NWKSKEY", nwk_s_key, SESSAO_LORAWAN_TAM_CHAVE) != ESP_OK) )
+    {
+        ESP_LOGE(LORAWAN_TAG, "Falha ao ler a sessao do modulo LoRaWAN");
+        return ESP_FAIL;
+    }
+
+    sessao_lorawan_inicia(&sessao_lorawan, dev_addr, app_s_key, nwk_s_key);
+    sessao_lorawan_formata_hex(sessao_lorawan.dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR, dev_addr_sessao);
+    downlinks_nao_registrados = 0;
+    gravacao_sessao_pendente = true;
+    grava_sessao_lorawan_na_flash();
+
+    /* Uplinks voltam ao DR de uso */
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+DR=%d\n", DR_LORAWAN);
+    executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan));
+
+    ESP_LOGI(LORAWAN_TAG, "Sessao LoRaWAN ativa (DevAddr %s)", dev_addr_sessao);
+    return ESP_OK;
+}
+
+/* Função: lê um campo da sessão do módulo LoRaWAN (AT+<campo>=?)
+ * Parâmetros: - nome do campo no comando AT (ex: "DADDR")
+ *             - ponteiro para os bytes lidos e quantidade de bytes esperada
+ * Retorno: ESP_OK: campo lido
+ *          !ESP_OK: comando recusado ou resposta inválida
+ */
+static esp_err_t le_campo_sessao_do_modulo(const char *pt_campo, uint8_t *pt_bytes, int qtde_bytes)
 {
-    int qtde_bytes_escritos = uart_write_bytes(PORTA_UART_MOD_LORAWAN, pt_bytes, qtde_bytes);
-    ESP_LOGI(LORAWAN_TAG, "Quantidade de bytes escritos na UART: %d", qtde_bytes_escritos);
+    char cmd_modulo_lorawan[TAM_MAX_CMD_AT_LORAWAN] = {0};
+    char resposta_modulo_lorawan[TAM_MAX_RESP_MOD_LORAWAN] = {0};
+
+    snprintf(cmd_modulo_lorawan, sizeof(cmd_modulo_lorawan), "AT+%s=?\n", pt_campo);
+
+    if (executa_comando_mod_lorawan(cmd_modulo_lorawan, resposta_modulo_lorawan, sizeof(resposta_modulo_lorawan)) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+
+    return (sessao_lorawan_le_hex(resposta_modulo_lorawan, pt_bytes, qtde_bytes) == true) ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
 }
 
-/* Função: aguarda e recebe resposta enviada do módulo LoRaWAN
- * Parâmetros: - ponteiro para array de bytes da resposta
- *             - quantidade máxima de bytes permitidos
+/* Função: grava a sessão LoRaWAN na NVS, se houver gravação pendente
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: sessão gravada (ou nada pendente)
+ *          !ESP_OK: falha na gravação (continua pendente)
+ */
+static esp_err_t grava_sessao_lorawan_na_flash(void)
+{
+    nvs_handle handler_particao_nvs;
+    esp_err_t resultado;
+
+    if (gravacao_sessao_pendente == false)
+    {
+        return ESP_OK;
+    }
+
+    resultado = nvs_open(NAMESPACE_NVS_LORAWAN, NVS_READWRITE, &handler_particao_nvs);
+
+    if (resultado != ESP_OK)
+    {
+        ESP_LOGE(LORAWAN_TAG, "Falha ao abrir particao NVS");
+        return resultado;
+    }
+
+    resultado = nvs_set_blob(handler_particao_nvs, CHAVE_NVS_SESSAO_LORAWAN, &sessao_lorawan, sizeof(TSessao_lorawan));
+
+    if (resultado == ESP_OK)
+    {
+        resultado = nvs_commit(handler_particao_nvs);
+    }
+
+    nvs_close(handler_particao_nvs);
+
+    if (resultado != ESP_OK)
+    {
+        ESP_LOGE(LORAWAN_TAG, "Falha ao gravar a sessao LoRaWAN na NVS (%s)", esp_err_to_name(resultado));
+    }
+    else
+    {
+        gravacao_sessao_pendente = false;
+        LOGD_I(LORAWAN_TAG, "Sessao LoRaWAN gravada na NVS (contadores reservados ate %u)", sessao_lorawan.fcnt_up_reservado);
+    }
+
+    return resultado;
+}
+
+/* Função: lê a sessão LoRaWAN gravada na NVS
+ * Parâmetros: ponteiro para a sessão lida (ainda não validada)
+ * Retorno: ESP_OK: sessão lida
+ *          !ESP_OK: sessão nunca gravada ou falha na leitura
+ */
+static esp_err_t le_sessao_lorawan_da_flash(TSessao_lorawan *pt_sessao)
+{
+    nvs_handle handler_particao_nvs;
+    size_t tamanho = sizeof(TSessao_lorawan);
+    esp_err_t resultado;
+
+    resultado = nvs_open(NAMESPACE_NVS_LORAWAN, NVS_READWRITE, &handler_particao_nvs);
+
+    if (resultado != ESP_OK)
+    {
+        ESP_LOGE(LORAWAN_TAG, "Falha ao abrir particao NVS");
+        return resultado;
+    }
+
+    resultado = nvs_get_blob(handler_particao_nvs, CHAVE_NVS_SESSAO_LORAWAN, pt_sessao, &tamanho);
+    nvs_close(handler_particao_nvs);
+
+    if ((resultado == ESP_OK) && (tamanho != sizeof(TSessao_lorawan)))
+    {
+        resultado = ESP_ERR_INVALID_SIZE;
+    }
+
+    return resultado;
+}
+
+/* Função: prepara a sessão para um envio: com a sessão expirada ou perdida,
+ *         faz uma tentativa de join (se o backoff permitir); com a gravação
+ *         da reserva de contadores pendente, grava a sessão antes do envio
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: envio pode ser feito
+ *          ESP_ERR_TIMEOUT: sem sessão (join em andamento): envio adiado
+ *          demais: reserva de contadores não gravada: envio recusado
+ */
+static esp_err_t prepara_sessao_para_envio(void)
+{
+    if (sessao_lorawan_valida(&sessao_lorawan) == false)
+    {
+        if (tenta_join_lorawan() != ESP_OK)
+        {
+            agendador_uplinks_registra_adiamento(&agendador_uplinks);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    /* Um contador acima da reserva gravada poderia ser repetido depois de uma queda de energia */
+    return grava_sessao_lorawan_na_flash();
+}
+
+/* Função: registra na sessão um uplink aceito pelo módulo e os downlinks
+ *         recebidos desde o anterior; grava a sessão na NVS quando o contador
+ *         alcança a reserva e invalida a sessão expirada (novo join no
+ *         próximo envio)
+ * Parâmetros: nenhum
  * Retorno: nenhum
  */
-static void aguarda_e_recebe_resposta_mod_lorawan(char *pt_bytes, int qtde_bytes)
+static void registra_uplink_na_sessao(void)
 {
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    int qtde_bytes_lidos = uart_read_bytes(PORTA_UART_MOD_LORAWAN,
-                                           pt_bytes,
-                                           qtde_bytes,
-                                           TEMPO_ESPERA_RECEBE_BYTES);
+    uint32_t qtde_downlinks = downlinks_nao_registrados;
+
+    downlinks_nao_registrados -= qtde_downlinks;
+    sessao_lorawan_registra_downlinks(&sessao_lorawan, qtde_downlinks);
+
+    if (sessao_lorawan_registra_uplink(&sessao_lorawan) == true)
+    {
+        gravacao_sessao_pendente = true;
+        grava_sessao_lorawan_na_flash();
+    }
 
-    ESP_LOGI(LORAWAN_TAG, "Quantidade de bytes lidos da UART: %d", qtde_bytes_lidos);
-}
\ No newline at end of file
+    if (sessao_lorawan_expirou(&sessao_lorawan) == true)
+    {
+        ESP_LOGI(LORAWAN_TAG, "Sessao LoRaWAN expirada (FCntUp %u). Novo join no proximo envio.", sessao_lorawan.fcnt_up);
+        sessao_lorawan_invalida(&sessao_lorawan);
+        gravacao_sessao_pendente = false;
+    }
+}
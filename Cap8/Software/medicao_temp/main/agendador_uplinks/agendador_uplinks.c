@@ -0,0 +1,304 @@
+/* Módulo: agendador de uplinks (tempo no ar, duty cycle e fair-use)
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include "agendador_uplinks.h"
+
+/* Definição - assinatura que indica agendador válido na memória RTC */
+#define ASSINATURA_AGENDADOR_UPLINKS     0x41474431  // "AGD1"
+
+/* Definições - parâmetros fixos da modulação LoRa nos uplinks LoRaWAN */
+#define QTDE_SIMBOLOS_PREAMBULO          8
+#define CODING_RATE                      1    // 4/5
+#define CRC_HABILITADO                   1
+#define HEADER_IMPLICITO                 0
+
+/* Definição - capacidade do balde de créditos: 1/24 do orçamento diário
+ *             (permite rajadas de até uma hora de orçamento)
+ */
+#define FRACAO_ORCAMENTO_CAPACIDADE      24
+
+/* Definição - duração de um dia */
+#define DURACAO_DIA_MS                   (24LL * 3600LL * 1000LL)
+
+/* Estrutura de um DR: spreading factor, largura de banda e payload máximo */
+typedef struct
+{
+    uint8_t sf;
+    uint32_t bw_hz;
+    uint8_t payload_maximo;
+}TDR_plano;
+
+/* Estrutura de um plano de frequências */
+typedef struct
+{
+    TDR_plano drs[QTDE_DR_UPLINK];
+    uint16_t ciclo_de_trabalho_permil;   // 1000 = sem restrição de duty cycle
+}TPlano_frequencias;
+
+/* Tabelas dos planos de frequência (RP002). Payload máximo 0 = DR não
+ * permitido. LA915 tem dwell time de 400ms nos uplinks; AU915 é usado
+ * aqui sem dwell time.
+ */
+static const TPlano_frequencias planos[] =
+{
+    [PLANO_LA915] =
+    {
+        .drs =
+        {
+            { 12, 125000, 0 },
+            { 11, 125000, 0 },
+            { 10, 125000, 11 },
+            { 9,  125000, 53 },
+            { 8,  125000, 125 },
+            { 7,  125000, 242 },
+            { 8,  500000, 242 },
+        },
+        .ciclo_de_trabalho_permil = 1000,
+    },
+    [PLANO_AU915] =
+    {
+        .drs =
+        {
+            { 12, 125000, 51 },
+            { 11, 125000, 51 },
+            { 10, 125000, 51 },
+            { 9,  125000, 115 },
+            { 8,  125000, 222 },
+            { 7,  125000, 222 },
+            { 8,  500000, 222 },
+        },
+        .ciclo_de_trabalho_permil = 1000,
+    },
+};
+
+/* Funções locais */
+static int plano_e_dr_validos(int plano, int dr);
+static int64_t capacidade_credito_us(TAgendador_uplinks * pt_agendador);
+static void atualiza_credito(TAgendador_uplinks * pt_agendador, int64_t instante_atual_ms);
+
+/* Função: verifica se plano e DR informados existem
+ * Parâmetros: plano de frequências e DR
+ * Retorno: 1: válidos
+ *          0: inválidos
+ */
+static int plano_e_dr_validos(int plano, int dr)
+{
+    if ( (plano < 0) || (plano >= (int)(sizeof(planos) / sizeof(planos[0]))) )
+    {
+        return 0;
+    }
+
+    return ( (dr >= 0) && (dr < QTDE_DR_UPLINK) );
+}
+
+/* Função: calcula a capacidade do balde de créditos de tempo no ar
+ * Parâmetros: ponteiro para o agendador
+ * Retorno: capacidade (us)
+ */
+static int64_t capacidade_credito_us(TAgendador_uplinks * pt_agendador)
+{
+    return ((int64_t)pt_agendador->orcamento_diario_ms * 1000LL) / FRACAO_ORCAMENTO_CAPACIDADE;
+}
+
+/* Função: reabastece o balde de créditos proporcionalmente ao tempo decorrido
+ * Parâmetros: ponteiro para o agendador e instante atual (ms)
+ * Retorno: nenhum
+ */
+static void atualiza_credito(TAgendador_uplinks * pt_agendador, int64_t instante_atual_ms)
+{
+    int64_t tempo_decorrido_ms = instante_atual_ms - pt_agendador->instante_ultima_atualizacao_ms;
+
+    if (tempo_decorrido_ms <= 0)
+    {
+        return;
+    }
+
+    pt_agendador->credito_tempo_no_ar_us += (tempo_decorrido_ms * (int64_t)pt_agendador->orcamento_diario_ms * 1000LL) / DURACAO_DIA_MS;
+
+    if (pt_agendador->credito_tempo_no_ar_us > capacidade_credito_us(pt_agendador))
+    {
+        pt_agendador->credito_tempo_no_ar_us = capacidade_credito_us(pt_agendador);
+    }
+
+    pt_agendador->instante_ultima_atualizacao_ms = instante_atual_ms;
+}
+
+/* Função: inicializa agendador. Se o agendador contido na memória for
+ *         válido (ex: preservado em memória RTC durante deep sleep) e com
+ *         a mesma configuração, seu estado e contadores são mantidos.
+ * Parâmetros: - ponteiro para o agendador
+ *             - plano de frequências (PLANO_LA915 ou PLANO_AU915)
+ *             - orçamento diário de tempo no ar (ms). 0 = sem limite.
+ *             - instante atual (ms)
+ * Retorno: nenhum
+ */
+void agendador_uplinks_inicializa(TAgendador_uplinks * pt_agendador, int plano, uint32_t orcamento_diario_ms, int64_t instante_atual_ms)
+{
+    if ( (pt_agendador->assinatura == ASSINATURA_AGENDADOR_UPLINKS) &&
+         (pt_agendador->plano == plano) &&
+         (pt_agendador->orcamento_diario_ms == orcamento_diario_ms) &&
+         (pt_agendador->instante_ultima_atualizacao_ms <= instante_atual_ms) )
+    {
+        return;
+    }
+
+    memset(pt_agendador, 0x00, sizeof(TAgendador_uplinks));
+    pt_agendador->assinatura = ASSINATURA_AGENDADOR_UPLINKS;
+    pt_agendador->plano = plano;
+    pt_agendador->orcamento_diario_ms = orcamento_diario_ms;
+    pt_agendador->instante_livre_ms = instante_atual_ms;
+    pt_agendador->instante_ultima_atualizacao_ms = instante_atual_ms;
+    pt_agendador->credito_tempo_no_ar_us = capacidade_credito_us(pt_agendador);
+}
+
+/* Função: calcula o tempo no ar de um uplink (fórmula da Semtech, AN1200.13)
+ * Parâmetros: - plano de frequências
+ *             - DR do uplink
+ *             - tamanho do payload da aplicação (bytes)
+ * Retorno: tempo no ar (us). 0 se o DR não existir ou o payload não couber nele.
+ */
+uint32_t agendador_uplinks_tempo_no_ar_us(int plano, int dr, int tam_payload)
+{
+    const TDR_plano * pt_dr;
+    uint32_t tempo_simbolo_us;
+    int32_t numerador;
+    int32_t denominador;
+    int32_t qtde_simbolos_payload;
+    int low_data_rate_optimize;
+    int tam_phy_payload;
+
+    if ( (plano_e_dr_validos(plano, dr) == 0) || (tam_payload > agendador_uplinks_payload_maximo(plano, dr)) )
+    {
+        return 0;
+    }
+
+    pt_dr = &planos[plano].drs[dr];
+    tam_phy_payload = tam_payload + OVERHEAD_PAYLOAD_LORAWAN;
+    tempo_simbolo_us = (uint32_t)(((uint64_t)1000000 << pt_dr->sf) / pt_dr->bw_hz);
+    low_data_rate_optimize = (tempo_simbolo_us >= 16000) ? 1 : 0;
+
+    numerador = (8 * tam_phy_payload) - (4 * pt_dr->sf) + 28 + (16 * CRC_HABILITADO) - (20 * HEADER_IMPLICITO);
+    denominador = 4 * (pt_dr->sf - (2 * low_data_rate_optimize));
+    qtde_simbolos_payload = 8;
+
+    if (numerador > 0)
+    {
+        qtde_simbolos_payload += ((numerador + denominador - 1) / denominador) * (CODING_RATE + 4);
+    }
+
+    /* Preâmbulo: QTDE_SIMBOLOS_PREAMBULO + 4,25 símbolos */
+    return ((QTDE_SIMBOLOS_PREAMBULO * 4 + 17) * tempo_simbolo_us) / 4 + (qtde_simbolos_payload * tempo_simbolo_us);
+}
+
+/* Função: obtém o payload máximo (da aplicação) permitido num DR
+ * Parâmetros: plano de frequências e DR
+ * Retorno: payload máximo (bytes). 0 se o DR não existir ou não for permitido.
+ */
+int agendador_uplinks_payload_maximo(int plano, int dr)
+{
+    if (plano_e_dr_validos(plano, dr) == 0)
+    {
+        return 0;
+    }
+
+    return planos[plano].drs[dr].payload_maximo;
+}
+
+/* Função: calcula quanto tempo falta para um uplink poder ser feito, respeitando
+ *         módulo ocupado, duty cycle e orçamento diário de tempo no ar
+ * Parâmetros: - ponteiro para o agendador
+ *             - instante atual (ms)
+ *             - DR e tamanho do payload do uplink pretendido
+ * Retorno: tempo de espera (ms). 0 = pode enviar agora. -1 = uplink impossível
+ *          (DR inválido, payload maior que o permitido ou maior que o orçamento).
+ */
+int64_t agendador_uplinks_tempo_ate_liberar_ms(TAgendador_uplinks * pt_agendador, int64_t instante_atual_ms, int dr, int tam_payload)
+{
+    uint32_t tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(pt_agendador->plano, dr, tam_payload);
+    int64_t espera_ms = 0;
+    int64_t espera_credito_ms = 0;
+    int64_t credito_faltante_us = 0;
+
+    if (tempo_no_ar_us == 0)
+    {
+        return -1;
+    }
+
+    /* Módulo ocupado (transmissão/janelas de recepção anteriores) ou em off-time de duty cycle */
+    if (pt_agendador->instante_livre_ms > instante_atual_ms)
+    {
+        espera_ms = pt_agendador->instante_livre_ms - instante_atual_ms;
+    }
+
+    /* Orçamento diário de tempo no ar (fair-use) */
+    if (pt_agendador->orcamento_diario_ms > 0)
+    {
+        if ((int64_t)tempo_no_ar_us > capacidade_credito_us(pt_agendador))
+        {
+            return -1;
+        }
+
+        atualiza_credito(pt_agendador, instante_atual_ms);
+        credito_faltante_us = (int64_t)tempo_no_ar_us - pt_agendador->credito_tempo_no_ar_us;
+
+        if (credito_faltante_us > 0)
+        {
+            espera_credito_ms = (credito_faltante_us * DURACAO_DIA_MS) / ((int64_t)pt_agendador->orcamento_diario_ms * 1000LL) + 1;
+
+            if (espera_credito_ms > espera_ms)
+            {
+                espera_ms = espera_credito_ms;
+            }
+        }
+    }
+
+    return espera_ms;
+}
+
+/* Função: registra um uplink feito (aceito pelo módulo), consumindo o tempo
+ *         no ar correspondente e marcando o módulo como ocupado
+ * Parâmetros: - ponteiro para o agendador
+ *             - instante do envio (ms)
+ *             - DR e tamanho do payload enviado
+ * Retorno: nenhum
+ */
+void agendador_uplinks_registra_envio(TAgendador_uplinks * pt_agendador, int64_t instante_atual_ms, int dr, int tam_payload)
+{
+    uint32_t tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(pt_agendador->plano, dr, tam_payload);
+    uint32_t ciclo_de_trabalho_permil = planos[pt_agendador->plano].ciclo_de_trabalho_permil;
+    int64_t off_time_ms = 0;
+
+    atualiza_credito(pt_agendador, instante_atual_ms);
+    pt_agendador->credito_tempo_no_ar_us -= tempo_no_ar_us;
+
+    /* Off-time de duty cycle: tempo_no_ar * (1/ciclo - 1) */
+    if (ciclo_de_trabalho_permil < 1000)
+    {
+        off_time_ms = ((int64_t)tempo_no_ar_us * (1000 - ciclo_de_trabalho_permil)) / ((int64_t)ciclo_de_trabalho_permil * 1000);
+    }
+
+    if (off_time_ms < TEMPO_OCUPADO_APOS_TX_MS)
+    {
+        off_time_ms = TEMPO_OCUPADO_APOS_TX_MS;
+    }
+
+    pt_agendador->instante_livre_ms = instante_atual_ms + (tempo_no_ar_us / 1000) + off_time_ms;
+    pt_agendador->tempo_no_ar_total_us += tempo_no_ar_us;
+    pt_agendador->tempo_no_ar_ultimo_uplink_us = tempo_no_ar_us;
+    pt_agendador->total_uplinks++;
+}
+
+/* Função: registra que um uplink teve de ser adiado (ou agrupado a um próximo)
+ * Parâmetros: ponteiro para o agendador
+ * Retorno: nenhum
+ */
+void agendador_uplinks_registra_adiamento(TAgendador_uplinks * pt_agendador)
+{
+    pt_agendador->total_adiamentos++;
+}
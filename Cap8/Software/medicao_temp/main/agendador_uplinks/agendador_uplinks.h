@@ -0,0 +1,72 @@
+/* Header file: agendador de uplinks (tempo no ar, duty cycle e fair-use)
+ *
+ * Calcula o tempo no ar (time-on-air) de cada uplink LoRa a partir do
+ * tamanho do payload e do DR, usando tabelas dos planos de frequência
+ * LA915 e AU915, e controla quando o próximo uplink pode ser feito:
+ * - módulo ocupado: transmissão + janelas de recepção RX1/RX2 (classe A);
+ * - duty cycle do plano de frequências (se houver);
+ * - orçamento diário de tempo no ar (fair-use), controlado por um balde
+ *   de créditos que é reabastecido continuamente ao longo do dia. O
+ *   orçamento é opcional e configurado por aplicação: o LA915 não tem
+ *   limite legal de duty cycle, mas algumas redes públicas impõem um
+ *   fair-use.
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e simulado no computador.
+ */
+
+#ifndef HEADER_AGENDADOR_UPLINKS
+#define HEADER_AGENDADOR_UPLINKS
+
+#include <stdint.h>
+
+/* Definições - planos de frequência suportados */
+#define PLANO_LA915                          0
+#define PLANO_AU915                          1
+
+/* Definição - quantidade de DRs de uplink dos planos suportados (DR0 a DR6) */
+#define QTDE_DR_UPLINK                       7
+
+/* Definição - overhead LoRaWAN de um uplink sem FOpts (MHDR + FHDR + FPort + MIC) */
+#define OVERHEAD_PAYLOAD_LORAWAN             13   //bytes
+
+/* Definição - tempo em que o módulo fica ocupado após o fim da transmissão
+ *             (RECEIVE_DELAY2 de 2s + janela RX2 + margem)
+ */
+#define TEMPO_OCUPADO_APOS_TX_MS             3000 //ms
+
+/* Definições - orçamento diário de tempo no ar: sem orçamento ou o
+ *              fair-use de 30s/dia de algumas redes públicas
+ */
+#define AGENDADOR_UPLINKS_SEM_ORCAMENTO      0
+#define ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS    30000 //ms
+
+/* Estrutura do agendador (configuração, estado e contadores) */
+typedef struct
+{
+    /* Configuração */
+    uint32_t assinatura;
+    int plano;
+    uint32_t orcamento_diario_ms;
+
+    /* Estado */
+    int64_t instante_livre_ms;
+    int64_t instante_ultima_atualizacao_ms;
+    int64_t credito_tempo_no_ar_us;
+
+    /* Contadores de tempo no ar */
+    uint64_t tempo_no_ar_total_us;
+    uint32_t tempo_no_ar_ultimo_uplink_us;
+    uint32_t total_uplinks;
+    uint32_t total_adiamentos;
+}TAgendador_uplinks;
+
+#endif
+
+/* Protótipos */
+void agendador_uplinks_inicializa(TAgendador_uplinks * pt_agendador, int plano, uint32_t orcamento_diario_ms, int64_t instante_atual_ms);
+uint32_t agendador_uplinks_tempo_no_ar_us(int plano, int dr, int tam_payload);
+int agendador_uplinks_payload_maximo(int plano, int dr);
+int64_t agendador_uplinks_tempo_ate_liberar_ms(TAgendador_uplinks * pt_agendador, int64_t instante_atual_ms, int dr, int tam_payload);
+void agendador_uplinks_registra_envio(TAgendador_uplinks * pt_agendador, int64_t instante_atual_ms, int dr, int tam_payload);
+void agendador_uplinks_registra_adiamento(TAgendador_uplinks * pt_agendador);
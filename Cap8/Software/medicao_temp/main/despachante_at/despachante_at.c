@@ -0,0 +1,611 @@
+/* Módulo: despachante de comandos AT e eventos (URCs) do módulo LoRaWAN */
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "driver/uart.h"
+#include "despachante_at.h"
+
+/* Definição - debug */
+#define DESPACHANTE_AT_TAG "DESPACHANTE_AT"
+
+/* Definição - prefixo dos eventos não solicitados (URCs) */
+#define PREFIXO_EVENTO_AT           "+EVT:"
+
+/* Definição - tamanho do bloco lido da UART a cada evento */
+#define TAM_BLOCO_LEITURA_UART      64   //bytes
+
+/* Tipos de linha recebida do módulo */
+typedef enum
+{
+    LINHA_INTERMEDIARIA = 0,
+    LINHA_RESULTADO_OK,
+    LINHA_RESULTADO_ERRO,
+    LINHA_RESULTADO_BUSY,
+    LINHA_EVENTO
+}TTipo_linha_at;
+
+/* Registro de um tratador de eventos */
+typedef struct
+{
+    const char * pt_prefixo;
+    int tam_prefixo;
+    TTratador_evento_at tratador;
+    void * pt_contexto;
+}TRegistro_tratador_at;
+
+/* Estado do comando em andamento (compartilhado com a tarefa leitora) */
+typedef struct
+{
+    bool pendente;
+    char * pt_resposta;
+    int tam_max_resposta;
+    int tam_resposta;
+    esp_err_t resultado;
+    int tipo;
+    int64_t instante_inicio_us;
+    int64_t instante_resultado_us;
+}TComando_at;
+
+/* Variáveis locais */
+static int porta_uart_modulo = 0;
+static QueueHandle_t fila_eventos_uart_modulo = NULL;
+static TMetricas_lorawan * pt_metricas_modulo = NULL;
+static SemaphoreHandle_t mutex_comando = NULL;
+static SemaphoreHandle_t semaforo_resultado = NULL;
+static portMUX_TYPE spinlock_comando = portMUX_INITIALIZER_UNLOCKED;
+static TComando_at comando_atual = {0};
+static TRegistro_tratador_at tratadores[DESPACHANTE_AT_QTDE_MAX_TRATADORES];
+static int qtde_tratadores = 0;
+static char linha_recebida[DESPACHANTE_AT_TAM_MAX_LINHA];
+static int tam_linha_recebida = 0;
+
+/* Tarefa deste módulo */
+static void leitor_uart_task(void *arg);
+
+/* Funções locais */
+static TTipo_linha_at classifica_linha(const char * pt_linha, int tamanho);
+static void trata_linha(void);
+static void despacha_evento(void);
+static bool proximo_campo(TFatia_at * pt_restante, TFatia_at * pt_campo);
+static bool campo_para_inteiro(TFatia_at campo, int * pt_valor);
+
+/* Função: inicializa despachante AT (cria a tarefa leitora da UART)
+ * Parâmetros: - porta UART do módulo LoRaWAN (driver já instalado)
+ *             - fila de eventos da UART (criada por uart_driver_install())
+ *             - ponteiro para as métricas da comunicação (já inicializadas)
+ * Retorno: ESP_OK: despachante inicializado
+ *          !ESP_OK: falha ao alocar recursos
+ */
+esp_err_t despachante_at_inicializa(int porta_uart, QueueHandle_t fila_eventos_uart, TMetricas_lorawan * pt_metricas)
+{
+    porta_uart_modulo = porta_uart;
+    fila_eventos_uart_modulo = fila_eventos_uart;
+    pt_metricas_modulo = pt_metricas;
+    mutex_comando = xSemaphoreCreateMutex();
+    semaforo_resultado = xSemaphoreCreateBinary();
+
+    if ( (mutex_comando == NULL) || (semaforo_resultado == NULL) || (fila_eventos_uart_modulo == NULL) )
+    {
+        ESP_LOGE(DESPACHANTE_AT_TAG, "Falha ao alocar recursos do despachante AT");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(leitor_uart_task, "leitor_uart_at",
+                    DESPACHANTE_AT_TAM_TASK_STACK,
+                    NULL,
+                    DESPACHANTE_AT_PRIO_TASK,
+                    NULL) != pdPASS)
+    {
+        ESP_LOGE(DESPACHANTE_AT_TAG, "Falha ao criar tarefa leitora da UART");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+/* Função: registra um tratador para eventos não solicitados (URCs)
+ * Parâmetros: - prefixo do evento, incluindo "+EVT:" (ex: "+EVT:RX_"). A
+ *               string deve permanecer válida enquanto o despachante existir.
+ *             - função tratadora (executada no contexto da tarefa leitora;
+ *               não deve bloquear)
+ *             - contexto repassado ao tratador
+ * Retorno: ESP_OK: tratador registrado
+ *          ESP_ERR_NO_MEM: limite de tratadores atingido
+ */
+esp_err_t despachante_at_registra_tratador(const char * pt_prefixo, TTratador_evento_at tratador, void * pt_contexto)
+{
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&spinlock_comando);
+
+    if (qtde_tratadores >= DESPACHANTE_AT_QTDE_MAX_TRATADORES)
+    {
+        ret = ESP_ERR_NO_MEM;
+    }
+    else
+    {
+        tratadores[qtde_tratadores].pt_prefixo = pt_prefixo;
+        tratadores[qtde_tratadores].tam_prefixo = strlen(pt_prefixo);
+        tratadores[qtde_tratadores].tratador = tratador;
+        tratadores[qtde_tratadores].pt_contexto = pt_contexto;
+        qtde_tratadores++;
+    }
+
+    portEXIT_CRITICAL(&spinlock_comando);
+    return ret;
+}
+
+/* Função: inicia um comando AT (escreve na UART e passa a esperar seu resultado).
+ *         Deve sempre ser seguida de despachante_at_aguarda_resultado().
+ * Parâmetros: - ponteiro para o comando
+ *             - tamanho do comando
+ *             - ponteiro para buffer que receberá a resposta (linhas
+ *               intermediárias e a linha de resultado, separadas por '\n').
+ *               Pode ser NULL. Deve permanecer válido até
+ *               despachante_at_aguarda_resultado() retornar.
+ *             - tamanho do buffer de resposta
+ * Retorno: ESP_OK: comando escrito na UART
+ *          !ESP_OK: falha ao escrever comando
+ */
+esp_err_t despachante_at_inicia_comando(const char * pt_cmd, int tamanho, char * pt_resposta, int tam_max_resposta)
+{
+    xSemaphoreTake(mutex_comando, portMAX_DELAY);
+
+    /* Descarta sinalização atrasada de um comando anterior que expirou */
+    xSemaphoreTake(semaforo_resultado, 0);
+
+    if ( (pt_resposta == NULL) || (tam_max_resposta <= 0) )
+    {
+        pt_resposta = NULL;
+        tam_max_resposta = 0;
+    }
+    else
+    {
+        memset(pt_resposta, 0x00, tam_max_resposta);
+    }
+
+    /* O buffer de resposta é registrado antes de escrever o comando: uma
+     * resposta rápida, recebida antes de despachante_at_aguarda_resultado(),
+     * já é acumulada nele
+     */
+    portENTER_CRITICAL(&spinlock_comando);
+    comando_atual.pendente = true;
+    comando_atual.pt_resposta = pt_resposta;
+    comando_atual.tam_max_resposta = tam_max_resposta;
+    comando_atual.tam_resposta = 0;
+    comando_atual.resultado = ESP_ERR_TIMEOUT;
+    comando_atual.tipo = metricas_lorawan_tipo_comando(pt_cmd, tamanho);
+    comando_atual.instante_inicio_us = esp_timer_get_time();
+    comando_atual.instante_resultado_us = comando_atual.instante_inicio_us;
+    portEXIT_CRITICAL(&spinlock_comando);
+
+    if (uart_write_bytes(porta_uart_modulo, pt_cmd, tamanho) != tamanho)
+    {
+        return ESP_FAIL;
+    }
+
+    pt_metricas_modulo->bytes_escritos_uart += tamanho;
+    return ESP_OK;
+}
+
+/* Função: aguarda o resultado final do comando AT iniciado (a resposta fica
+ *         no buffer informado a despachante_at_inicia_comando())
+ * Parâmetros: tempo máximo de espera (ms)
+ * Retorno: ESP_OK: módulo respondeu OK
+ *          ESP_FAIL: módulo respondeu com erro
+ *          ESP_ERR_INVALID_STATE: módulo respondeu BUSY
+ *          ESP_ERR_TIMEOUT: nenhum resultado final dentro do tempo máximo
+ */
+esp_err_t despachante_at_aguarda_resultado(uint32_t tempo_max_ms)
+{
+    esp_err_t resultado;
+    int resultado_metricas;
+    uint32_t latencia_ms;
+
+    xSemaphoreTake(semaforo_resultado, pdMS_TO_TICKS(tempo_max_ms));
+
+    portENTER_CRITICAL(&spinlock_comando);
+    comando_atual.pendente = false;
+    comando_atual.pt_resposta = NULL;
+    resultado = comando_atual.resultado;
+    latencia_ms = (uint32_t)((comando_atual.instante_resultado_us - comando_atual.instante_inicio_us) / 1000);
+    portEXIT_CRITICAL(&spinlock_comando);
+
+    switch (resultado)
+    {
+        case ESP_OK:
+            resultado_metricas = METRICAS_LORAWAN_RESULTADO_OK;
+            break;
+
+        case ESP_ERR_INVALID_STATE:
+            resultado_metricas = METRICAS_LORAWAN_RESULTADO_BUSY;
+            break;
+
+        case ESP_ERR_TIMEOUT:
+            resultado_metricas = METRICAS_LORAWAN_RESULTADO_TIMEOUT;
+            break;
+
+        default:
+            resultado_metricas = METRICAS_LORAWAN_RESULTADO_ERRO;
+            break;
+    }
+
+    metricas_lorawan_registra_comando(pt_metricas_modulo, comando_atual.tipo, resultado_metricas, latencia_ms);
+
+    xSemaphoreGive(mutex_comando);
+    return resultado;
+}
+
+/* Função: envia um comando AT e aguarda seu resultado final
+ * Parâmetros: - ponteiro para o comando e seu tamanho
+ *             - ponteiro e tamanho do buffer de resposta (pode ser NULL)
+ *             - tempo máximo de espera (ms)
+ * Retorno: mesmos de despachante_at_aguarda_resultado()
+ */
+esp_err_t despachante_at_envia_comando(const char * pt_cmd, int tamanho, char * pt_resposta, int tam_max_resposta, uint32_t tempo_max_ms)
+{
+    if (despachante_at_inicia_comando(pt_cmd, tamanho, pt_resposta, tam_max_resposta) != ESP_OK)
+    {
+        despachante_at_aguarda_resultado(0);
+        return ESP_FAIL;
+    }
+
+    return despachante_at_aguarda_resultado(tempo_max_ms);
+}
+
+/* Função: verifica se uma fatia começa com um prefixo
+ * Parâmetros: fatia e prefixo
+ * Retorno: true: começa com o prefixo
+ *          false: não começa com o prefixo
+ */
+bool despachante_at_fatia_comeca_com(TFatia_at fatia, const char * pt_prefixo)
+{
+    int tam_prefixo = strlen(pt_prefixo);
+
+    return ( (fatia.tamanho >= tam_prefixo) && (memcmp(fatia.pt_dados, pt_prefixo, tam_prefixo) == 0) );
+}
+
+/* Função: interpreta o evento de downlink recebido
+ *         (o que segue "+EVT:RX_", ex: "1:-72:9:UNICAST:10:0102A0")
+ * Parâmetros: - fatia do evento recebida pelo tratador
+ *             - ponteiro para estrutura que receberá o downlink (os dados
+ *               apontam para a linha da tarefa leitora, sem cópia)
+ * Retorno: true: downlink interpretado
+ *          false: evento em formato não reconhecido
+ */
+bool despachante_at_interpreta_downlink(TFatia_at evento, TDownlink_at * pt_downlink)
+{
+    TFatia_at campo;
+
+    memset(pt_downlink, 0x00, sizeof(TDownlink_at));
+
+    /* Janela de recepção: RX_1, RX_2 ou RX_C */
+    if (proximo_campo(&evento, &campo) == false)
+    {
+        return false;
+    }
+
+    if ( (campo.tamanho == 1) && (campo.pt_dados[0] == 'C') )
+    {
+        pt_downlink->janela = 'C';
+    }
+    else if (campo_para_inteiro(campo, &pt_downlink->janela) == false)
+    {
+        return false;
+    }
+
+    /* RSSI, SNR e tipo (UNICAST/MULTICAST) */
+    if ( (proximo_campo(&evento, &campo) == false) || (campo_para_inteiro(campo, &pt_downlink->rssi) == false) )
+    {
+        return false;
+    }
+
+    if ( (proximo_campo(&evento, &campo) == false) || (campo_para_inteiro(campo, &pt_downlink->snr) == false) )
+    {
+        return false;
+    }
+
+    if (proximo_campo(&evento, &campo) == false)
+    {
+        return false;
+    }
+
+    /* Porta e dados (downlink sem dados, ex: só ACK, termina no tipo) */
+    if (proximo_campo(&evento, &campo) == false)
+    {
+        return true;
+    }
+
+    if (campo_para_inteiro(campo, &pt_downlink->porta) == false)
+    {
+        return false;
+    }
+
+    proximo_campo(&evento, &pt_downlink->dados_hex);
+    return true;
+}
+
+/* Função: separa o próximo campo (delimitado por ':') de uma fatia
+ * Parâmetros: - ponteiro para a fatia restante (avança após o campo)
+ *             - ponteiro para a fatia que receberá o campo
+ * Retorno: true: campo obtido
+ *          false: não há mais campos
+ */
+static bool proximo_campo(TFatia_at * pt_restante, TFatia_at * pt_campo)
+{
+    int i = 0;
+
+    if (pt_restante->tamanho <= 0)
+    {
+        return false;
+    }
+
+    while ( (i < pt_restante->tamanho) && (pt_restante->pt_dados[i] != ':') )
+    {
+        i++;
+    }
+
+    pt_campo->pt_dados = pt_restante->pt_dados;
+    pt_campo->tamanho = i;
+
+    /* Pula o campo e o delimitador */
+    if (i < pt_restante->tamanho)
+    {
+        i++;
+    }
+
+    pt_restante->pt_dados += i;
+    pt_restante->tamanho -= i;
+    return true;
+}
+
+/* Função: converte um campo decimal (com sinal opcional) em inteiro
+ * Parâmetros: - campo
+ *             - ponteiro para variável que receberá o valor
+ * Retorno: true: conversão feita
+ *          false: campo não é um número decimal
+ */
+static bool campo_para_inteiro(TFatia_at campo, int * pt_valor)
+{
+    int valor = 0;
+    int sinal = 1;
+    int i = 0;
+
+    if ( (campo.tamanho > 0) && ((campo.pt_dados[0] == '-') || (campo.pt_dados[0] == '+')) )
+    {
+        sinal = (campo.pt_dados[0] == '-') ? -1 : 1;
+        i++;
+    }
+
+    if (i >= campo.tamanho)
+    {
+        return false;
+    }
+
+    for (; i < campo.tamanho; i++)
+    {
+        if ( (campo.pt_dados[i] < '0') || (campo.pt_dados[i] > '9') )
+        {
+            return false;
+        }
+
+        valor = (valor * 10) + (campo.pt_dados[i] - '0');
+    }
+
+    *pt_valor = sinal * valor;
+    return true;
+}
+
+/* Função: classifica uma linha recebida do módulo LoRaWAN
+ * Parâmetros: ponteiro para a linha e seu tamanho
+ * Retorno: tipo da linha
+ */
+static TTipo_linha_at classifica_linha(const char * pt_linha, int tamanho)
+{
+    if (strncmp(pt_linha, PREFIXO_EVENTO_AT, strlen(PREFIXO_EVENTO_AT)) == 0)
+    {
+        return LINHA_EVENTO;
+    }
+
+    if ( (tamanho == 2) && (strcmp(pt_linha, "OK") == 0) )
+    {
+        return LINHA_RESULTADO_OK;
+    }
+
+    if (strstr(pt_linha, "BUSY") != NULL)
+    {
+        return LINHA_RESULTADO_BUSY;
+    }
+
+    if (strstr(pt_linha, "ERROR") != NULL)
+    {
+        return LINHA_RESULTADO_ERRO;
+    }
+
+    return LINHA_INTERMEDIARIA;
+}
+
+/* Função: despacha a linha recebida (evento) para o tratador cujo prefixo casar.
+ *         A tabela de tratadores é consultada sob o mesmo lock usado no registro,
+ *         mas o tratador é chamado fora dele.
+ * Parâmetros: nenhum (usa a linha recebida)
+ * Retorno: nenhum
+ */
+static void despacha_evento(void)
+{
+    TRegistro_tratador_at registro;
+    TFatia_at fatia;
+    bool encontrou = false;
+    int i;
+
+    portENTER_CRITICAL(&spinlock_comando);
+
+    for (i = 0; i < qtde_tratadores; i++)
+    {
+        if (strncmp(linha_recebida, tratadores[i].pt_prefixo, tratadores[i].tam_prefixo) == 0)
+        {
+            registro = tratadores[i];
+            encontrou = true;
+            break;
+        }
+    }
+
+    portEXIT_CRITICAL(&spinlock_comando);
+
+    if (encontrou == true)
+    {
+        fatia.pt_dados = &linha_recebida[registro.tam_prefixo];
+        fatia.tamanho = tam_linha_recebida - registro.tam_prefixo;
+        registro.tratador(fatia, registro.pt_contexto);
+        return;
+    }
+
+    ESP_LOGI(DESPACHANTE_AT_TAG, "Evento sem tratador: %s", linha_recebida);
+}
+
+/* Função: trata uma linha completa recebida do módulo LoRaWAN
+ * Parâmetros: nenhum (usa a linha recebida)
+ * Retorno: nenhum
+ */
+static void trata_linha(void)
+{
+    TTipo_linha_at tipo = classifica_linha(linha_recebida, tam_linha_recebida);
+    bool resultado_final = false;
+    int espaco_livre = 0;
+
+    if (tipo == LINHA_EVENTO)
+    {
+        despacha_evento();
+        return;
+    }
+
+    portENTER_CRITICAL(&spinlock_comando);
+
+    if (comando_atual.pendente == true)
+    {
+        /* Acrescenta a linha à resposta do comando em andamento */
+        if (comando_atual.pt_resposta != NULL)
+        {
+            espaco_livre = comando_atual.tam_max_resposta - comando_atual.tam_resposta - 1;
+
+            if (espaco_livre > tam_linha_recebida)
+            {
+                memcpy(&comando_atual.pt_resposta[comando_atual.tam_resposta], linha_recebida, tam_linha_recebida);
+                comando_atual.tam_resposta += tam_linha_recebida;
+                comando_atual.pt_resposta[comando_atual.tam_resposta++] = '\n';
+                comando_atual.pt_resposta[comando_atual.tam_resposta] = 0x00;
+            }
+        }
+
+        if (tipo != LINHA_INTERMEDIARIA)
+        {
+            switch (tipo)
+            {
+                case LINHA_RESULTADO_OK:
+                    comando_atual.resultado = ESP_OK;
+                    break;
+
+                case LINHA_RESULTADO_BUSY:
+                    comando_atual.resultado = ESP_ERR_INVALID_STATE;
+                    break;
+
+                default:
+                    comando_atual.resultado = ESP_FAIL;
+                    break;
+            }
+
+            comando_atual.pendente = false;
+            comando_atual.instante_resultado_us = esp_timer_get_time();
+            resultado_final = true;
+        }
+    }
+
+    portEXIT_CRITICAL(&spinlock_comando);
+
+    if (resultado_final == true)
+    {
+        xSemaphoreGive(semaforo_resultado);
+    }
+}
+
+/* Função: tarefa leitora da UART do módulo LoRaWAN. Fica bloqueada na fila
+ *         de eventos da UART e separa os bytes recebidos em linhas.
+ * Parâmetros: argumentos da task
+ * Retorno: nenhum
+ */
+static void leitor_uart_task(void *arg)
+{
+    uart_event_t evento_uart;
+    uint8_t bloco[TAM_BLOCO_LEITURA_UART];
+    size_t qtde_disponivel = 0;
+    int qtde_lida = 0;
+    int i;
+
+    while (1)
+    {
+        if (xQueueReceive(fila_eventos_uart_modulo, &evento_uart, portMAX_DELAY) != pdPASS)
+        {
+            continue;
+        }
+
+        if ( (evento_uart.type == UART_FIFO_OVF) || (evento_uart.type == UART_BUFFER_FULL) )
+        {
+            ESP_LOGE(DESPACHANTE_AT_TAG, "Overflow na UART do modulo LoRaWAN. Descartando dados recebidos.");
+            uart_flush_input(porta_uart_modulo);
+            pt_metricas_modulo->total_overflows_uart++;
+            xQueueReset(fila_eventos_uart_modulo);
+            tam_linha_recebida = 0;
+            continue;
+        }
+
+        if (evento_uart.type != UART_DATA)
+        {
+            continue;
+        }
+
+        uart_get_buffered_data_len(porta_uart_modulo, &qtde_disponivel);
+
+        while (qtde_disponivel > 0)
+        {
+            qtde_lida = uart_read_bytes(porta_uart_modulo, bloco,
+                                        (qtde_disponivel < sizeof(bloco)) ? qtde_disponivel : sizeof(bloco),
+                                        0);
+
+            if (qtde_lida <= 0)
+            {
+                break;
+            }
+
+            qtde_disponivel -= qtde_lida;
+            pt_metricas_modulo->bytes_lidos_uart += qtde_lida;
+
+            for (i = 0; i < qtde_lida; i++)
+            {
+                if ( (bloco[i] == '\r') || (bloco[i] == '\n') )
+                {
+                    /* Fim de linha. Linhas vazias são ignoradas. */
+                    if (tam_linha_recebida > 0)
+                    {
+                        linha_recebida[tam_linha_recebida] = 0x00;
+                        trata_linha();
+                        tam_linha_recebida = 0;
+                    }
+                }
+                else if (tam_linha_recebida < (DESPACHANTE_AT_TAM_MAX_LINHA - 1))
+                {
+                    linha_recebida[tam_linha_recebida++] = (char)bloco[i];
+                }
+            }
+        }
+    }
+}
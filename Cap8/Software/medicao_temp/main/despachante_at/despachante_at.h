@@ -0,0 +1,72 @@
+/* Header file: despachante de comandos AT e eventos (URCs) do módulo LoRaWAN
+ *
+ * Uma tarefa dedicada lê a UART do módulo LoRaWAN, separa o que chega em
+ * linhas e as encaminha:
+ * - linhas de resultado final (OK, *ERROR, BUSY) encerram o comando em
+ *   andamento e acordam a tarefa que o enviou;
+ * - demais linhas recebidas durante um comando compõem sua resposta;
+ * - eventos não solicitados (URCs, ex: +EVT:RX_1:..., +EVT:TX_DONE) vão
+ *   para os tratadores registrados, a qualquer momento, inclusive com um
+ *   comando em andamento. O tratador recebe uma fatia (ponteiro + tamanho)
+ *   do buffer de linha da tarefa leitora, sem cópia, válida apenas durante
+ *   a chamada do tratador.
+ *
+ * Cada comando (tipo, resultado e latência até o resultado final) e os
+ * bytes que passam pela UART são contabilizados nas métricas informadas
+ * na inicialização (ver metricas_lorawan).
+ */
+
+#ifndef HEADER_DESPACHANTE_AT
+#define HEADER_DESPACHANTE_AT
+
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_err.h"
+#include "../metricas_lorawan/metricas_lorawan.h"
+
+/* Definições - dimensões */
+#define DESPACHANTE_AT_TAM_MAX_LINHA             256  //bytes
+#define DESPACHANTE_AT_QTDE_MAX_TRATADORES       6
+#define DESPACHANTE_AT_TAM_FILA_EVENTOS_UART     20
+
+/* Definições - tarefa leitora da UART */
+#define DESPACHANTE_AT_TAM_TASK_STACK            3072
+#define DESPACHANTE_AT_PRIO_TASK                 8
+
+/* Fatia de uma linha recebida (sem cópia) */
+typedef struct
+{
+    const char * pt_dados;
+    int tamanho;
+}TFatia_at;
+
+/* Tratador de eventos: recebe o restante da linha após o prefixo registrado */
+typedef void (*TTratador_evento_at)(TFatia_at evento, void * pt_contexto);
+
+/* Prefixo do evento de downlink recebido (+EVT:RX_<janela>:<rssi>:<snr>:<tipo>:<porta>:<dados em hex>) */
+#define DESPACHANTE_AT_PREFIXO_DOWNLINK          "+EVT:RX_"
+
+/* Prefixo dos eventos de resultado do join OTAA (+EVT:JOINED ou +EVT:JOIN_FAILED_RX_TIMEOUT) */
+#define DESPACHANTE_AT_PREFIXO_JOIN              "+EVT:JOIN"
+
+/* Downlink interpretado a partir do evento de recepção */
+typedef struct
+{
+    int janela;          // 1 ou 2 (classe A), C (classe C)
+    int rssi;
+    int snr;
+    int porta;
+    TFatia_at dados_hex; // fatia da linha, sem cópia
+}TDownlink_at;
+
+#endif
+
+/* Protótipos */
+esp_err_t despachante_at_inicializa(int porta_uart, QueueHandle_t fila_eventos_uart, TMetricas_lorawan * pt_metricas);
+esp_err_t despachante_at_registra_tratador(const char * pt_prefixo, TTratador_evento_at tratador, void * pt_contexto);
+esp_err_t despachante_at_inicia_comando(const char * pt_cmd, int tamanho, char * pt_resposta, int tam_max_resposta);
+esp_err_t despachante_at_aguarda_resultado(uint32_t tempo_max_ms);
+esp_err_t despachante_at_envia_comando(const char * pt_cmd, int tamanho, char * pt_resposta, int tam_max_resposta, uint32_t tempo_max_ms);
+bool despachante_at_fatia_comeca_com(TFatia_at fatia, const char * pt_prefixo);
+bool despachante_at_interpreta_downlink(TFatia_at evento, TDownlink_at * pt_downlink);
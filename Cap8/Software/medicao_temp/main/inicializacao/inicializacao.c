@@ -0,0 +1,150 @@
+/* Módulo: inicialização assíncrona dos módulos, com eventos de prontidão */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "inicializacao.h"
+
+/* Definição - debug */
+#define INICIALIZACAO_TAG   "INICIALIZACAO"
+
+/* Módulo a ser inicializado (argumento da tarefa de inicialização) */
+typedef struct
+{
+    const char * pt_nome;
+    TFuncao_inicializacao funcao;
+    EventBits_t dependencias;
+    EventBits_t evento_pronto;
+}TModulo_inicializacao;
+
+/* Variáveis locais */
+static EventGroupHandle_t grupo_eventos_inicializacao = NULL;
+static TModulo_inicializacao modulos[INICIALIZACAO_QTDE_MAX_MODULOS];
+static int qtde_modulos = 0;
+
+/* Tarefas deste módulo */
+static void inicializacao_task(void *arg);
+
+/* Função: tarefa de inicialização de um módulo. Aguarda as dependências,
+ *         inicializa o módulo, sinaliza que ele está pronto e termina.
+ * Parâmetros: ponteiro para o módulo a ser inicializado
+ * Retorno: nenhum
+ */
+static void inicializacao_task(void *arg)
+{
+    TModulo_inicializacao * pt_modulo = (TModulo_inicializacao *)arg;
+    int64_t instante_inicio_ms;
+
+    if (pt_modulo->dependencias != 0)
+    {
+        xEventGroupWaitBits(grupo_eventos_inicializacao, pt_modulo->dependencias, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+
+    instante_inicio_ms = esp_timer_get_time() / 1000;
+    pt_modulo->funcao();
+
+    ESP_LOGI(INICIALIZACAO_TAG, "%s pronto em %lld ms desde o boot (inicializacao: %lld ms)",
+             pt_modulo->pt_nome, esp_timer_get_time() / 1000, (esp_timer_get_time() / 1000) - instante_inicio_ms);
+
+    xEventGroupSetBits(grupo_eventos_inicializacao, pt_modulo->evento_pronto);
+    vTaskDelete(NULL);
+}
+
+/* Função: inicia o controle de inicialização (cria o grupo de eventos)
+ * Parâmetros: nenhum
+ * Retorno: ESP_OK: sucesso
+ *          ESP_ERR_NO_MEM: não foi possível criar o grupo de eventos
+ */
+esp_err_t inicializacao_inicia(void)
+{
+    if (grupo_eventos_inicializacao != NULL)
+    {
+        return ESP_OK;
+    }
+
+    grupo_eventos_inicializacao = xEventGroupCreate();
+
+    if (grupo_eventos_inicializacao == NULL)
+    {
+        ESP_LOGE(INICIALIZACAO_TAG, "Falha ao criar grupo de eventos da inicializacao");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+/* Função: dispara a inicialização de um módulo em uma tarefa própria
+ * Parâmetros: - nome do módulo (para logs e nome da tarefa)
+ *             - função de inicialização do módulo
+ *             - eventos dos módulos que precisam estar prontos antes (0 se nenhum)
+ *             - evento sinalizado quando o módulo estiver pronto
+ * Retorno: ESP_OK: inicialização disparada
+ *          ESP_ERR_INVALID_STATE: inicializacao_inicia() não foi chamada
+ *          ESP_ERR_NO_MEM: quantidade máxima de módulos atingida ou falha ao criar a tarefa
+ */
+esp_err_t inicializacao_dispara(const char * pt_nome, TFuncao_inicializacao funcao, EventBits_t dependencias, EventBits_t evento_pronto)
+{
+    TModulo_inicializacao * pt_modulo;
+
+    if (grupo_eventos_inicializacao == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (qtde_modulos >= INICIALIZACAO_QTDE_MAX_MODULOS)
+    {
+        ESP_LOGE(INICIALIZACAO_TAG, "Quantidade maxima de modulos atingida (%s)", pt_nome);
+        return ESP_ERR_NO_MEM;
+    }
+
+    pt_modulo = &modulos[qtde_modulos++];
+    pt_modulo->pt_nome = pt_nome;
+    pt_modulo->funcao = funcao;
+    pt_modulo->dependencias = dependencias;
+    pt_modulo->evento_pronto = evento_pronto;
+
+    if (xTaskCreate(inicializacao_task, pt_nome, INICIALIZACAO_TAM_TASK_STACK, pt_modulo, INICIALIZACAO_PRIO_TASK, NULL) != pdPASS)
+    {
+        ESP_LOGE(INICIALIZACAO_TAG, "Falha ao criar tarefa de inicializacao (%s)", pt_nome);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+/* Função: aguarda módulos ficarem prontos
+ * Parâmetros: - eventos dos módulos aguardados
+ *             - tempo máximo de espera (ticks)
+ * Retorno: eventos sinalizados no momento do retorno (todos os aguardados,
+ *          se os módulos ficaram prontos dentro do tempo máximo)
+ */
+EventBits_t inicializacao_aguarda(EventBits_t eventos, TickType_t tempo_max)
+{
+    if (grupo_eventos_inicializacao == NULL)
+    {
+        return 0;
+    }
+
+    return xEventGroupWaitBits(grupo_eventos_inicializacao, eventos, pdFALSE, pdTRUE, tempo_max);
+}
+
+/* Função: verifica, sem aguardar, se módulos estão prontos
+ * Parâmetros: eventos dos módulos
+ * Retorno: true: todos os módulos estão prontos
+ *          false: algum módulo ainda não está pronto
+ */
+bool inicializacao_esta_pronto(EventBits_t eventos)
+{
+    if (grupo_eventos_inicializacao == NULL)
+    {
+        return false;
+    }
+
+    return ((xEventGroupGetBits(grupo_eventos_inicializacao) & eventos) == eventos);
+}
@@ -0,0 +1,37 @@
+/* Header file: inicialização assíncrona dos módulos, com eventos de prontidão
+ *
+ * Cada módulo é inicializado em uma tarefa própria, disparada por
+ * inicializacao_dispara(). A tarefa aguarda apenas os eventos dos módulos
+ * dos quais depende, executa a função de inicialização do módulo e então
+ * sinaliza o evento de "pronto" do módulo, num grupo de eventos comum.
+ * Assim, módulos independentes são inicializados em paralelo (ex: o
+ * contador de pulsos não espera o módulo LoRaWAN ser configurado) e
+ * quem depende de um módulo pode aguardá-lo ou consultá-lo a qualquer
+ * momento (inicializacao_aguarda() / inicializacao_esta_pronto()).
+ *
+ * Os eventos (bits) de cada módulo são definidos pela aplicação.
+ */
+
+#ifndef HEADER_INICIALIZACAO
+#define HEADER_INICIALIZACAO
+
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_err.h"
+
+/* Definições - tarefas de inicialização */
+#define INICIALIZACAO_QTDE_MAX_MODULOS       8
+#define INICIALIZACAO_TAM_TASK_STACK         4096
+#define INICIALIZACAO_PRIO_TASK              5
+
+/* Função de inicialização de um módulo */
+typedef void (*TFuncao_inicializacao)(void);
+
+#endif
+
+/* Protótipos */
+esp_err_t inicializacao_inicia(void);
+esp_err_t inicializacao_dispara(const char * pt_nome, TFuncao_inicializacao funcao, EventBits_t dependencias, EventBits_t evento_pronto);
+EventBits_t inicializacao_aguarda(EventBits_t eventos, TickType_t tempo_max);
+bool inicializacao_esta_pronto(EventBits_t eventos);
@@ -0,0 +1,125 @@
+/* Header file: log diferido (binário)
+ *
+ * Os pontos de log gravam, em vez de texto, um registro binário compacto
+ * (instante, ponteiros para a tag e para a string de formato, nível e até
+ * LOG_DIFERIDO_QTDE_MAX_ARGS argumentos de 32 bits) num anel em RAM, sem
+ * travas (lock-free). A formatação e a escrita no console ficam para uma
+ * tarefa de baixa prioridade (ou, com LOG_DIFERIDO_SAIDA_BINARIA, para o
+ * computador: ver Ferramentas/decodifica_log_diferido).
+ *
+ * Uso (semelhante ao ESP_LOGx):
+ *     #define LOG_DIFERIDO_NIVEL_MODULO  LOG_DIFERIDO_NIVEL_INFO  // opcional, antes do include
+ *     #include "log_diferido/log_diferido.h"
+ *     LOGD_I(TAG, "Leitura %d: %.2fcm", i, distancia);
+ *
+ * Logs acima do nível do módulo (definido em tempo de compilação) são
+ * eliminados pelo compilador e não custam nada.
+ *
+ * Restrições dos argumentos:
+ * - inteiros de até 32 bits (int64_t é truncado), float/double (gravados
+ *   como float) e ponteiros;
+ * - %s só pode receber strings constantes (literais ou const globais), pois
+ *   o ponteiro é formatado depois, fora do ponto de log;
+ * - a tag e a string de formato também devem ser constantes.
+ */
+
+#ifndef HEADER_LOG_DIFERIDO
+#define HEADER_LOG_DIFERIDO
+
+#include <stdint.h>
+#include <string.h>
+
+/* Definições - níveis de log */
+#define LOG_DIFERIDO_NIVEL_NENHUM        0
+#define LOG_DIFERIDO_NIVEL_ERRO          1
+#define LOG_DIFERIDO_NIVEL_AVISO         2
+#define LOG_DIFERIDO_NIVEL_INFO          3
+#define LOG_DIFERIDO_NIVEL_DEBUG         4
+
+/* Definição - nível de log do módulo (cada .c pode definir o seu antes do include) */
+#ifndef LOG_DIFERIDO_NIVEL_MODULO
+#define LOG_DIFERIDO_NIVEL_MODULO        LOG_DIFERIDO_NIVEL_INFO
+#endif
+
+/* Definições - dimensões do anel de registros */
+#define LOG_DIFERIDO_QTDE_REGISTROS      64   //potência de 2
+#define LOG_DIFERIDO_QTDE_MAX_ARGS       6
+
+/* Definição - saída da tarefa de log: 0 = texto formatado no ESP32;
+ *             1 = registros em hexadecimal ("LOGD:..."), formatados no
+ *             computador a partir do .elf do firmware
+ */
+#ifndef LOG_DIFERIDO_SAIDA_BINARIA
+#define LOG_DIFERIDO_SAIDA_BINARIA       0
+#endif
+
+/* Definição - prefixo das linhas de saída binária */
+#define LOG_DIFERIDO_PREFIXO_BINARIO     "LOGD:"
+
+/* Definições - tarefa de log */
+#define LOG_DIFERIDO_TAM_TASK_STACK      3072
+#define LOG_DIFERIDO_PRIO_TASK           1
+#define LOG_DIFERIDO_PERIODO_TASK_MS     50   //ms
+
+/* Conversão de cada argumento para 32 bits (float é gravado com seus bits) */
+static inline uint32_t log_diferido_arg_inteiro(uint32_t valor) { return valor; }
+static inline uint32_t log_diferido_arg_ponteiro(const void * pt) { return (uint32_t)(uintptr_t)pt; }
+static inline uint32_t log_diferido_arg_float(double valor)
+{
+    float valor_float = (float)valor;
+    uint32_t bits;
+
+    memcpy(&bits, &valor_float, sizeof(bits));
+    return bits;
+}
+
+#define LOG_DIFERIDO_ARG(x) _Generic((x),                       \
+    float: log_diferido_arg_float,                              \
+    double: log_diferido_arg_float,                             \
+    char *: log_diferido_arg_ponteiro,                          \
+    const char *: log_diferido_arg_ponteiro,                    \
+    void *: log_diferido_arg_ponteiro,                          \
+    const void *: log_diferido_arg_ponteiro,                    \
+    default: log_diferido_arg_inteiro)(x)
+
+/* Contagem e conversão dos argumentos (até LOG_DIFERIDO_QTDE_MAX_ARGS) */
+#define LOG_DIFERIDO_CONTA_ARGS(...)  LOG_DIFERIDO_CONTA_ARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_DIFERIDO_CONTA_ARGS_(_0, _1, _2, _3, _4, _5, _6, N, ...)  N
+
+#define LOG_DIFERIDO_ARGS_0()
+#define LOG_DIFERIDO_ARGS_1(a)                , LOG_DIFERIDO_ARG(a)
+#define LOG_DIFERIDO_ARGS_2(a, b)             LOG_DIFERIDO_ARGS_1(a) , LOG_DIFERIDO_ARG(b)
+#define LOG_DIFERIDO_ARGS_3(a, b, c)          LOG_DIFERIDO_ARGS_2(a, b) , LOG_DIFERIDO_ARG(c)
+#define LOG_DIFERIDO_ARGS_4(a, b, c, d)       LOG_DIFERIDO_ARGS_3(a, b, c) , LOG_DIFERIDO_ARG(d)
+#define LOG_DIFERIDO_ARGS_5(a, b, c, d, e)    LOG_DIFERIDO_ARGS_4(a, b, c, d) , LOG_DIFERIDO_ARG(e)
+#define LOG_DIFERIDO_ARGS_6(a, b, c, d, e, f) LOG_DIFERIDO_ARGS_5(a, b, c, d, e) , LOG_DIFERIDO_ARG(f)
+#define LOG_DIFERIDO_ARGS_N(n, ...)           LOG_DIFERIDO_ARGS_##n(__VA_ARGS__)
+#define LOG_DIFERIDO_ARGS(n, ...)             LOG_DIFERIDO_ARGS_N(n, ##__VA_ARGS__)
+
+/* Ponto de log */
+#define LOG_DIFERIDO(nivel, tag, formato, ...)                                          \
+    do {                                                                                \
+        if ((nivel) <= LOG_DIFERIDO_NIVEL_MODULO)                                       \
+        {                                                                               \
+            log_diferido_registra((nivel), (tag), (formato),                            \
+                                  LOG_DIFERIDO_CONTA_ARGS(__VA_ARGS__)                  \
+                                  LOG_DIFERIDO_ARGS(LOG_DIFERIDO_CONTA_ARGS(__VA_ARGS__), ##__VA_ARGS__)); \
+        }                                                                               \
+    } while (0)
+
+#define LOGD_E(tag, formato, ...)  LOG_DIFERIDO(LOG_DIFERIDO_NIVEL_ERRO, tag, formato, ##__VA_ARGS__)
+#define LOGD_W(tag, formato, ...)  LOG_DIFERIDO(LOG_DIFERIDO_NIVEL_AVISO, tag, formato, ##__VA_ARGS__)
+#define LOGD_I(tag, formato, ...)  LOG_DIFERIDO(LOG_DIFERIDO_NIVEL_INFO, tag, formato, ##__VA_ARGS__)
+#define LOGD_D(tag, formato, ...)  LOG_DIFERIDO(LOG_DIFERIDO_NIVEL_DEBUG, tag, formato, ##__VA_ARGS__)
+
+/* Função que obtém a string apontada por um argumento %s (ou NULL, se inválido) */
+typedef const char * (*TResolve_string_log)(uint32_t endereco);
+
+/* Protótipos */
+void log_diferido_inicializa(void);
+void log_diferido_registra(int nivel, const char * pt_tag, const char * pt_formato, int qtde_args, ...);
+void log_diferido_descarrega(void);
+uint32_t log_diferido_total_descartados(void);
+int log_diferido_formata(char * pt_texto, int tam_max, const char * pt_formato, const uint32_t * pt_args, int qtde_args, TResolve_string_log resolve_string);
+
+#endif
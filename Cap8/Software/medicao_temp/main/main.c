@@ -1,14 +1,23 @@
 #include <stdio.h>
+#include <time.h>
 #include <esp_task_wdt.h>
 #include "sdkconfig.h"
+#include "esp_attr.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_system.h"
 
 /* Includes de outros módulos */
 #include "LoRaWAN/LoRaWAN.h"
 #include "medicao_temperatura/medicao_temperatura.h"
+#include "fila_uplinks/fila_uplinks.h"
+#include "log_diferido/log_diferido.h"
+#include "inicializacao/inicializacao.h"
+#include "serie_temperaturas/serie_temperaturas.h"
+#include "payloads/payloads.h"
+#include "fase_uplinks/fase_uplinks.h"
 
 /* Includes dos header files com as priorizações e tamanho das stacks das tarefas */
 #include "prio_tasks.h"
@@ -21,24 +30,41 @@
 /* Definição - tempo máximo sem feed do watchdog */
 #define TEMPO_MAX_SEM_FEED_WATCHDOG        60 //s
 
+/* Definição - envio dos uplinks pendentes na fila */
+#define QTDE_MAX_QUADROS_POR_CICLO         3
+
+/* Definições - eventos de prontidão dos módulos (inicialização assíncrona) */
+#define EVENTO_MEDICAO_TEMPERATURA_PRONTA  (1 << 0)
+#define EVENTO_LORAWAN_PRONTO              (1 << 1)
+
 /* Definição - tag para debug */
 #define MAIN_TAG    "MAIN"
 
-/* Definições - temperaturas para envio LoRaWAN */
-#define TAM_ARRAY_TEMP_ENVIO   4
-#define IDX_TEMP_MEDIA         0
-#define IDX_TEMP_MINIMA        1
-#define IDX_TEMP_MAXIMA        2
-#define IDX_DESVIO_PADRAO_X10  3
+/* O resumo da janela (payload resumo_temperaturas) é guardado na fila de uplinks pendentes */
+_Static_assert(PAYLOAD_RESUMO_TEMPERATURAS_TAM <= FILA_UPLINKS_TAM_MAX_DADOS, "resumo de temperaturas nao cabe na fila de uplinks");
+
+/* Definição - porta LoRaWAN da série de temperaturas (o resumo vai na porta padrão) */
+#define PORTA_SERIE_TEMPERATURAS  13
 
 /* Variável para indicar se está durante o tempo de burn-in para o sensor de temperatura*/
 static bool esta_em_tempo_de_burn_in = true;
 
+/* Variável para indicar se o primeiro uplink já foi enviado (medição do tempo até o primeiro uplink) */
+static bool primeiro_uplink_enviado = false;
+
+/* Fila de uplinks pendentes. Fica em memória RTC não inicializada, de forma
+ * a sobreviver a resets por software e por watchdog.
+ */
+static RTC_NOINIT_ATTR TFila_uplinks fila_uplinks;
+
 /* Tarefa do projeto */
 static void faz_medicao_temp(void *arg);
 
 /* Protótipos */
 static unsigned long diferenca_tempo(unsigned long tref);
+static void envia_uplinks_pendentes(void);
+static bool envia_serie_temperaturas(void);
+static bool inicializa_fase_uplinks(TFase_uplinks * pt_fase, int64_t instante_referencia_ms);
 
 /* Função: calcula diferença de tempo do instante atual e uma referência de tempo
  *  Parâmetros: referência de tempo
@@ -52,6 +78,125 @@ static unsigned long diferenca_tempo(unsigned long tref)
     return (timestamp_atual - tref);
 }
 
+/* Função: inicializa a grade de fase dos uplinks com a fase derivada do
+ *         DevAddr, ou sorteada se ainda não houver um DevAddr (OTAA antes
+ *         do join)
+ * Parâmetros: - ponteiro para a fase dos uplinks
+ *             - instante de referência da grade (ms)
+ * Retorno: true: fase derivada do DevAddr
+ *          false: fase sorteada
+ */
+static bool inicializa_fase_uplinks(TFase_uplinks * pt_fase, int64_t instante_referencia_ms)
+{
+    uint32_t dev_addr = 0;
+    bool dev_addr_valido;
+
+    dev_addr_valido = fase_uplinks_le_dev_addr(obtem_dev_addr_lorawan(), &dev_addr);
+
+    if (dev_addr_valido == false)
+    {
+        ESP_LOGE(MAIN_TAG, "DevAddr invalido (ou sem sessao LoRaWAN). Fase dos uplinks sorteada.");
+        dev_addr = esp_random();
+    }
+
+    fase_uplinks_inicializa(pt_fase, dev_addr, PERIODO_TRANSMISSOES, JITTER_MAX_TRANSMISSOES, esp_random(), instante_referencia_ms);
+    ESP_LOGI(MAIN_TAG, "Envios a cada %u ms, fase de %u ms", pt_fase->periodo_ms, pt_fase->deslocamento_ms);
+    return dev_addr_valido;
+}
+
+/* Função: envia os uplinks pendentes na fila, do mais antigo para o mais novo.
+ *         Registros só saem da fila se o módulo LoRaWAN aceitar o envio.
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void envia_uplinks_pendentes(void)
+{
+    uint8_t quadro[TAM_MAX_PAYLOAD_LORAWAN] = {0};
+    int tam_quadro = 0;
+    int qtde_registros = 0;
+    int qtde_quadros = 0;
+
+    while (qtde_quadros < QTDE_MAX_QUADROS_POR_CICLO)
+    {
+        tam_quadro = fila_uplinks_monta_quadro(&fila_uplinks, (uint32_t)time(NULL), quadro, sizeof(quadro), &qtde_registros);
+
+        if (tam_quadro == 0)
+        {
+            break;
+        }
+
+        /* Entre dois quadros, o próprio envio aguarda o módulo terminar a transmissão
+         * e as janelas de recepção anteriores (agendador de uplinks). Se o orçamento
+         * de tempo no ar não permitir o envio, os registros ficam na fila e são
+         * agrupados no próximo quadro.
+         */
+        esp_task_wdt_reset();
+
+        if (envia_mensagem_binaria_lorawan_ABP((char *)quadro, tam_quadro) != ESP_OK)
+        {
+            ESP_LOGE(MAIN_TAG, "Envio falhou. %d uplink(s) permanecem na fila", fila_uplinks_quantidade(&fila_uplinks));
+            break;
+        }
+
+        fila_uplinks_confirma_envio(&fila_uplinks, qtde_registros);
+        qtde_quadros++;
+
+        if (primeiro_uplink_enviado == false)
+        {
+            ESP_LOGI(MAIN_TAG, "Primeiro uplink enviado %lld ms apos o boot", esp_timer_get_time() / 1000);
+            primeiro_uplink_enviado = true;
+        }
+    }
+}
+
+/* Função: codifica a série de temperaturas da janela (0,1 °C) no payload
+ *         máximo do DR e a envia, sem passar pela fila de uplinks
+ * Parâmetros: nenhum
+ * Retorno: true: série enviada; false: série não cabe no payload ou envio
+ *          falhou (a aplicação envia o resumo da janela)
+ */
+static bool envia_serie_temperaturas(void)
+{
+    uint8_t quadro[TAM_MAX_PAYLOAD_LORAWAN] = {0};
+    const int16_t * pt_amostras_x10;
+    int qtde_amostras = 0;
+    int tam_max_quadro = 0;
+    int tam_quadro = 0;
+    int passo = 0;
+
+    tam_max_quadro = agendador_uplinks_payload_maximo(PLANO_FREQUENCIAS_LORAWAN, DR_LORAWAN);
+    if (tam_max_quadro > TAM_MAX_PAYLOAD_LORAWAN)
+    {
+        tam_max_quadro = TAM_MAX_PAYLOAD_LORAWAN;
+    }
+
+    pt_amostras_x10 = obtem_amostras_temperatura_x10(&qtde_amostras);
+    tam_quadro = serie_temperaturas_codifica(pt_amostras_x10, qtde_amostras, quadro, tam_max_quadro, &passo);
+
+    if (tam_quadro == 0)
+    {
+        ESP_LOGI(MAIN_TAG, "Serie de %d temperaturas nao cabe em %d bytes. Enviando resumo.", qtde_amostras, tam_max_quadro);
+        return false;
+    }
+
+    ESP_LOGI(MAIN_TAG, "Serie: %d temperaturas em %d amostras (media de %d), %d bytes",
+             qtde_amostras, quadro[0], passo, tam_quadro);
+
+    if (envia_mensagem_binaria_lorawan_ABP_na_porta(PORTA_SERIE_TEMPERATURAS, (char *)quadro, tam_quadro) != ESP_OK)
+    {
+        ESP_LOGW(MAIN_TAG, "Envio da serie falhou. Resumo vai para a fila de uplinks.");
+        return false;
+    }
+
+    if (primeiro_uplink_enviado == false)
+    {
+        ESP_LOGI(MAIN_TAG, "Primeiro uplink enviado %lld ms apos o boot", esp_timer_get_time() / 1000);
+        primeiro_uplink_enviado = true;
+    }
+
+    return true;
+}
+
 /* Função: tarefa de medição de temperatura, cálculo do desvio padrão
  *         e envio para nuvem via LoRaWAN
  * Parâmetros: argumentos da tarefa
@@ -60,19 +205,43 @@ static unsigned long diferenca_tempo(unsigned long tref)
 static void faz_medicao_temp(void *arg)
 {
     int64_t timestamp_medicao_temperatura = 0;
-    int64_t timestamp_envio_temperatura = 0;
-    int64_t timestamp_burn_in_sensor_temp = 0;
-    int8_t array_temperaturas_envio[TAM_ARRAY_TEMP_ENVIO] = {0};
+    int64_t timestamp_fim_burn_in_sensor_temp = 0;
+    int64_t timestamp_inicio = 0;
+    bool fase_do_dev_addr = false;
+    uint32_t dev_addr = 0;
+    TFase_uplinks fase_uplinks;
+    uint8_t resumo_envio[PAYLOAD_RESUMO_TEMPERATURAS_TAM] = {0};
+    TPayload_resumo_temperaturas resumo;
+
+    /* Aguarda apenas o sensor de temperatura: o burn-in começa enquanto o
+     * módulo LoRaWAN ainda está sendo configurado
+     */
+    inicializacao_aguarda(EVENTO_MEDICAO_TEMPERATURA_PRONTA, portMAX_DELAY);
+    timestamp_inicio = esp_timer_get_time() / 1000;
+
+    ESP_LOGI(MAIN_TAG, "Programa iniciado. Entrando em fase de espera pelo tempo de burn-in do sensor de temperatura...");
+
+    /* O DevAddr só é lido com o módulo LoRaWAN configurado (em OTAA, é o da
+     * sessão, escrito por init_lorawan). A espera é limitada ao burn-in, em
+     * que nenhuma medição é feita.
+     */
+    inicializacao_aguarda(EVENTO_LORAWAN_PRONTO, TEMPO_BURN_IN_SENSOR_TEMP / portTICK_PERIOD_MS);
 
     /* Habilita o watchdog para esta tarefa */
     esp_task_wdt_add(NULL);
 
-    ESP_LOGI(MAIN_TAG, "Programa iniciado. Entrando em fase de espera pelo tempo de burn-in do sensor de temperatura...");
-    
-    /* Inicializa temporizações */ 
+    /* Os envios seguem a grade de fase dos uplinks: o primeiro é feito na fase
+     * do dispositivo (derivada do DevAddr) depois do burn-in e da primeira
+     * janela de amostras. Assim, depois de uma queda de energia que reinicia a
+     * frota inteira, os dispositivos não transmitem todos ao mesmo tempo.
+     */
+    fase_do_dev_addr = inicializa_fase_uplinks(&fase_uplinks, timestamp_inicio + TEMPO_BURN_IN_SENSOR_TEMP + TEMPO_ENTRE_TRANSMISSOES);
+
+    /* Inicializa temporizações. O burn-in é estendido até o início da janela
+     * de amostras do primeiro envio (burn-in + fase).
+     */
     timestamp_medicao_temperatura = esp_timer_get_time() / 1000;
-    timestamp_envio_temperatura = esp_timer_get_time() / 1000;
-    timestamp_burn_in_sensor_temp = esp_timer_get_time() / 1000;
+    timestamp_fim_burn_in_sensor_temp = fase_uplinks.instante_ciclo_ms - TEMPO_ENTRE_TRANSMISSOES;
 
     while(1)
     {
@@ -80,12 +249,11 @@ static void faz_medicao_temp(void *arg)
         esp_task_wdt_reset();
 
         /* Enquanto estiver em tempo de burn-in, nenhuma medição deve acontecer */
-        if ( (diferenca_tempo(timestamp_burn_in_sensor_temp) >= TEMPO_BURN_IN_SENSOR_TEMP) && (esta_em_tempo_de_burn_in == true) )
+        if ( ((esp_timer_get_time() / 1000) >= timestamp_fim_burn_in_sensor_temp) && (esta_em_tempo_de_burn_in == true) )
         {
             /* Após o tempo de burn-in do sensor de temperartura, as medições de 
              * temperaturas e posteriores envios estão liberados
              */
-            timestamp_envio_temperatura = esp_timer_get_time() / 1000;
             timestamp_medicao_temperatura = esp_timer_get_time() / 1000;
             esta_em_tempo_de_burn_in = false;
             ESP_LOGI(MAIN_TAG, "Fase de burn-in do sensor de temperatura terminou.");
@@ -106,39 +274,75 @@ static void faz_medicao_temp(void *arg)
         }
 
         /* Verifica se é o momento de fazer um envio de temperaturas (média, mínima e máxima),
-         * assim como o desvio padrão (x10).
+         * assim como o desvio padrão (grade de fase dos uplinks).
          * O envio só é feito quando o buffer de amostras de temperaturas está cheio.
+         * Como o período da grade é a janela de amostras mais o jitter máximo, o
+         * buffer sempre está cheio no instante do envio.
          * 
          * OBS: o envio só é feito se o tempo de burn-in já passou.
          */
         if ( (esta_em_tempo_de_burn_in == false) &&
-             (diferenca_tempo(timestamp_envio_temperatura) >= TEMPO_ENTRE_TRANSMISSOES) &&
+             (fase_uplinks_envio_liberado(&fase_uplinks, esp_timer_get_time() / 1000) == true) &&
              (quantidade_de_temperaturas_lidas() == QTDE_AMOSTRAS_TEMPERATURA) )
         {
             /* Obtém temperaturas média, máxima e mínima, assim como o 
-             * desvio padrão (x10) das amostras de temperatura 
+             * desvio padrão das amostras de temperatura, e empacota o resumo
+             * no formato do esquema dos payloads
              */
-            array_temperaturas_envio[IDX_TEMP_MEDIA] = obtem_media_temperaturas();
-            array_temperaturas_envio[IDX_TEMP_MAXIMA] = obtem_temperatura_maxima();
-            array_temperaturas_envio[IDX_TEMP_MINIMA] = obtem_temperatura_minima();
-            array_temperaturas_envio[IDX_DESVIO_PADRAO_X10] = calcula_desvio_padrao_x10();
+            resumo.media = obtem_media_temperaturas();
+            resumo.maxima = obtem_temperatura_maxima();
+            resumo.minima = obtem_temperatura_minima();
+            resumo.desvio_padrao = calcula_desvio_padrao();
+            payload_resumo_temperaturas_empacota(&resumo, resumo_envio);
             ESP_LOGI(MAIN_TAG, "Resumo:");
             ESP_LOGI(MAIN_TAG, "- Quantidade de temperaturas: %d", QTDE_AMOSTRAS_TEMPERATURA);
-            ESP_LOGI(MAIN_TAG, "- Temperatura media: %dC", array_temperaturas_envio[IDX_TEMP_MEDIA]);
-            ESP_LOGI(MAIN_TAG, "- Temperatura minima: %dC", array_temperaturas_envio[IDX_TEMP_MINIMA]);
-            ESP_LOGI(MAIN_TAG, "- Temperatura maxima: %dC", array_temperaturas_envio[IDX_TEMP_MAXIMA]);
-            ESP_LOGI(MAIN_TAG, "- Desvio padrao das temperaturas (x10): %dC", array_temperaturas_envio[IDX_DESVIO_PADRAO_X10]);
+            ESP_LOGI(MAIN_TAG, "- Temperatura media: %.1fC", resumo.media);
+            ESP_LOGI(MAIN_TAG, "- Temperatura minima: %.1fC", resumo.minima);
+            ESP_LOGI(MAIN_TAG, "- Temperatura maxima: %.1fC", resumo.maxima);
+            ESP_LOGI(MAIN_TAG, "- Desvio padrao das temperaturas: %.2fC", resumo.desvio_padrao);
 
-            /* Faz envio das temperaturas por LoRaWAN */
-            envia_mensagem_binaria_lorawan_ABP((char *)array_temperaturas_envio, TAM_ARRAY_TEMP_ENVIO);
+            /* Envia a série das temperaturas da janela, se couber no payload do DR. Senão
+             * (ou se o envio falhar), insere o resumo na fila de uplinks pendentes, que
+             * guarda os envios não feitos
+             */
+            if ( (inicializacao_esta_pronto(EVENTO_LORAWAN_PRONTO) == false) || (envia_serie_temperaturas() == false) )
+            {
+                if (fila_uplinks_insere(&fila_uplinks, resumo_envio, PAYLOAD_RESUMO_TEMPERATURAS_TAM, (uint32_t)time(NULL)) == true)
+                {
+                    ESP_LOGE(MAIN_TAG, "Fila de uplinks cheia. Resumo mais antigo descartado.");
+                }
+            }
+
+            /* Envia o que for possível da fila de uplinks */
+            if (inicializacao_esta_pronto(EVENTO_LORAWAN_PRONTO) == true)
+            {
+                envia_uplinks_pendentes();
+                loga_metricas_lorawan();
+            }
+            else
+            {
+                ESP_LOGW(MAIN_TAG, "Modulo LoRaWAN ainda nao inicializado. Resumo permanece na fila de uplinks.");
+            }
 
             /* Reinicializa medições medições de temperatura, limpando buffer de amostras
              * de temperaturas 
              */
             reinicializa_medicoes_temperatura();
 
-            /* Reinicia temporização do envio de temperaturas */
-            timestamp_envio_temperatura = esp_timer_get_time() / 1000;
+            /* Passa para o próximo ciclo da grade de envios */
+            fase_uplinks_avanca(&fase_uplinks, esp_timer_get_time() / 1000);
+
+            /* Fase sorteada (OTAA sem sessão no boot): com a sessão ativa, a grade
+             * passa para a fase do DevAddr. As medições param até o início da
+             * janela de amostras do novo ciclo, como no burn-in.
+             */
+            if ( (fase_do_dev_addr == false) && (inicializacao_esta_pronto(EVENTO_LORAWAN_PRONTO) == true) &&
+                 (fase_uplinks_le_dev_addr(obtem_dev_addr_lorawan(), &dev_addr) == true) )
+            {
+                fase_do_dev_addr = inicializa_fase_uplinks(&fase_uplinks, (esp_timer_get_time() / 1000) + TEMPO_ENTRE_TRANSMISSOES);
+                timestamp_fim_burn_in_sensor_temp = fase_uplinks.instante_ciclo_ms - TEMPO_ENTRE_TRANSMISSOES;
+                esta_em_tempo_de_burn_in = true;
+            }
         }
 
         /* Aguarda 10ms para verificar novamente as temporizações */
@@ -150,16 +354,24 @@ void app_main(void)
 {
    esp_task_wdt_init(TEMPO_MAX_SEM_FEED_WATCHDOG, true);
 
+   /* Inicializa log diferido (tarefa que escreve os logs no console) */
+   log_diferido_inicializa();
+
+   /* Medição de temperatura e LoRaWAN são inicializados em paralelo, cada um
+    * em uma tarefa própria, de forma que o burn-in do sensor não espera a
+    * configuração do módulo LoRaWAN
+    */
+   ESP_ERROR_CHECK(inicializacao_inicia());
+
    /* Inicializa medição de temperatura */
-   ESP_LOGI(MAIN_TAG, "Inicializando medicao de temperatura...");
    esta_em_tempo_de_burn_in = true;
-   init_medicao_temperatura();
-   ESP_LOGI(MAIN_TAG, "Medicao de temperatura inicializada");
+   ESP_ERROR_CHECK(inicializacao_dispara("init_medicao", init_medicao_temperatura, 0, EVENTO_MEDICAO_TEMPERATURA_PRONTA));
 
    /* Inicializa LoRaWAN */
-   ESP_LOGI(MAIN_TAG, "Inicializando LoRaWAN...");
-   init_lorawan();
-   ESP_LOGI(MAIN_TAG, "LoRaWAN inicializado");
+   ESP_ERROR_CHECK(inicializacao_dispara("init_lorawan", init_lorawan, 0, EVENTO_LORAWAN_PRONTO));
+
+   /* Inicializa fila de uplinks pendentes (mantendo o conteúdo anterior, se válido) */
+   fila_uplinks_inicializa(&fila_uplinks);
 
    /* Criação /agendamento da tarefa do projeto, responsável por:
     * - Fazer medições de temperatura
@@ -15,11 +15,15 @@
 /* Includes - demais módulos */
 #include "../LoRaWAN/LoRaWAN.h"
 
+/* Log diferido: nível de log deste módulo */
+#define LOG_DIFERIDO_NIVEL_MODULO  LOG_DIFERIDO_NIVEL_INFO
+#include "../log_diferido/log_diferido.h"
+
 /* Definição - tag de debug */
 #define MEDICAO_TEMP_TAG   "MEDICAO_TEMP"
 
-/* Variáveis estáticas */
-static int8_t amostras_temperatura[QTDE_AMOSTRAS_TEMPERATURA] = {0};
+/* Variáveis estáticas (amostras com resolução de 0,1 °C) */
+static int16_t amostras_temperatura_x10[QTDE_AMOSTRAS_TEMPERATURA] = {0};
 static int idx_temperatura = 0;
 
 /* Coloque o endereço do seu sensor DS18B20 aqui. Para obtê-lo, observe as 
@@ -59,7 +63,7 @@ void init_medicao_temperatura(void)
  */
 void reinicializa_medicoes_temperatura(void)
 {
-    memset((char *)&amostras_temperatura, 0x00, sizeof(amostras_temperatura));
+    memset((char *)&amostras_temperatura_x10, 0x00, sizeof(amostras_temperatura_x10));
     idx_temperatura = 0;  
 }
 
@@ -123,8 +127,8 @@ void le_temperatura_atual_e_insere_buffer(void)
         if (status_leitura_temperatura == ESP_OK)
         {
             /* Leitura bem sucedida */            
-            amostras_temperatura[idx_temperatura] = (int8_t)temperatura_lida_float;
-            ESP_LOGI(MEDICAO_TEMP_TAG, "Temperatura #%d/%d lida = %dC", idx_temperatura+1, QTDE_AMOSTRAS_TEMPERATURA, amostras_temperatura[idx_temperatura]);
+            amostras_temperatura_x10[idx_temperatura] = (int16_t)lroundf(temperatura_lida_float * 10.0);
+            LOGD_I(MEDICAO_TEMP_TAG, "Temperatura #%d/%d lida = %d (x0,1C)", idx_temperatura+1, QTDE_AMOSTRAS_TEMPERATURA, amostras_temperatura_x10[idx_temperatura]);
             idx_temperatura++;            
         }
         else
@@ -135,14 +139,13 @@ void le_temperatura_atual_e_insere_buffer(void)
     }
 }
 
-/* Função: calcula desvio padrão (multiplicado por 10)
+/* Função: calcula desvio padrão das amostras de temperatura
  * Parâmetros: nenhum
- * Retorno: desvio padrão (multiplicado por 10)
+ * Retorno: desvio padrão (°C)
 */
-int8_t calcula_desvio_padrao_x10(void)
+float calcula_desvio_padrao(void)
 {
-    int8_t desvio_padrao_x10_calculado_int = 0;
-    float desvio_padrao_x10_calculado_float = 0.0;
+    float desvio_padrao_x10 = 0.0;
     float media_temperaturas = 0.0;
     float fator_variancia = 0.0;
     int i = 0;
@@ -151,86 +154,83 @@ int8_t calcula_desvio_padrao_x10(void)
     media_temperaturas = 0.0;
     for (i = 0; i < QTDE_AMOSTRAS_TEMPERATURA; i++)
     {
-        media_temperaturas = media_temperaturas + amostras_temperatura[i];
+        media_temperaturas = media_temperaturas + amostras_temperatura_x10[i];
     }
 
     media_temperaturas = media_temperaturas / QTDE_AMOSTRAS_TEMPERATURA;
 
     /* Calcula variância amostral */
-    desvio_padrao_x10_calculado_float = 0.0;
+    desvio_padrao_x10 = 0.0;
     for (i = 0; i < QTDE_AMOSTRAS_TEMPERATURA; i++)
     {
-        fator_variancia = (float)amostras_temperatura[i] - media_temperaturas;
+        fator_variancia = (float)amostras_temperatura_x10[i] - media_temperaturas;
         fator_variancia = fator_variancia * fator_variancia;
-        desvio_padrao_x10_calculado_float = desvio_padrao_x10_calculado_float + fator_variancia;
+        desvio_padrao_x10 = desvio_padrao_x10 + fator_variancia;
     }
 
-    desvio_padrao_x10_calculado_float = sqrt(desvio_padrao_x10_calculado_float / QTDE_AMOSTRAS_TEMPERATURA);
-    desvio_padrao_x10_calculado_float = desvio_padrao_x10_calculado_float * 10.0;
-    desvio_padrao_x10_calculado_int = (int8_t)desvio_padrao_x10_calculado_float;
-    
-    return desvio_padrao_x10_calculado_int;
+    /* Amostras estão em 0,1 °C: o desvio padrão sai multiplicado por 10 */
+    desvio_padrao_x10 = sqrt(desvio_padrao_x10 / QTDE_AMOSTRAS_TEMPERATURA);
+
+    return desvio_padrao_x10 / 10.0;
 }
 
 /* Função: obtem temperatura máxima do array de 
  *         amopstras de temperaturas
  *  Parâmetros: nenhum
- *  Retorno: temperatura máxima
+ *  Retorno: temperatura máxima (°C)
 */
-int8_t obtem_temperatura_maxima(void)
+float obtem_temperatura_maxima(void)
 {
-    int8_t temp_max = -10;
+    int16_t temp_max_x10 = INT16_MIN;
     int i;
 
     for (i = 0; i < QTDE_AMOSTRAS_TEMPERATURA; i++)
     {
-        if ( amostras_temperatura[i] > temp_max)
+        if ( amostras_temperatura_x10[i] > temp_max_x10)
         {
-            temp_max = amostras_temperatura[i];
+            temp_max_x10 = amostras_temperatura_x10[i];
         }
     }
 
-    return temp_max;
+    return temp_max_x10 / 10.0;
 }
 
 /* Função: obtem temperatura mínima do array de amostras
  *         de temperaturas
  *  Parâmetros: nenhum
- *  Retorno: temperatura mínima
+ *  Retorno: temperatura mínima (°C)
 */
-int8_t obtem_temperatura_minima(void)
+float obtem_temperatura_minima(void)
 {
-    int8_t temp_min = 110;
+    int16_t temp_min_x10 = INT16_MAX;
     int i;
 
     for (i = 0; i < QTDE_AMOSTRAS_TEMPERATURA; i++)
     {
-        if ( amostras_temperatura[i] < temp_min)
+        if ( amostras_temperatura_x10[i] < temp_min_x10)
         {
-            temp_min = amostras_temperatura[i];
+            temp_min_x10 = amostras_temperatura_x10[i];
         }
     }
 
-    return temp_min;
+    return temp_min_x10 / 10.0;
 }
 
 /* Função: obtem média das temperaturas até o momento
  *  Parâmetros: nenhum
- *  Retorno: média calculada
+ *  Retorno: média calculada (°C)
 */
-int8_t obtem_media_temperaturas(void)
+float obtem_media_temperaturas(void)
 {
     int i;
     int soma_temp = 0;
-    int8_t media = 0;
 
     for (i = 0; i < QTDE_AMOSTRAS_TEMPERATURA; i++)
     {
-        soma_temp = soma_temp + amostras_temperatura[i];
+        soma_temp = soma_temp + amostras_temperatura_x10[i];
     }
 
-    media = (int8_t)(soma_temp / QTDE_AMOSTRAS_TEMPERATURA);
-    return media;
+    return (float)soma_temp / (QTDE_AMOSTRAS_TEMPERATURA * 10);
 }
 
 /* Função: retorna a quantidade de temperaturas lidas ate
@@ -241,4 +241,15 @@ int8_t obtem_media_temperaturas(void)
 int quantidade_de_temperaturas_lidas(void)
 {
     return idx_temperatura;
-}
\ No newline at end of file
+}
+
+/* Função: obtém as amostras de temperatura lidas até o momento, com
+ *         resolução de 0,1 °C (para o envio da série)
+ *  Parâmetros: ponteiro para a quantidade de amostras lidas
+ *  Retorno: ponteiro para as amostras (0,1 °C)
+*/
+const int16_t * obtem_amostras_temperatura_x10(int * pt_qtde_amostras)
+{
+    *pt_qtde_amostras = idx_temperatura;
+    return amostras_temperatura_x10;
+}
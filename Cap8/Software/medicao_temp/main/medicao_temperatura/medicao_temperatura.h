@@ -16,8 +16,9 @@
 void init_medicao_temperatura(void);
 void reinicializa_medicoes_temperatura(void);
 void le_temperatura_atual_e_insere_buffer(void);
-int8_t calcula_desvio_padrao_x10(void);
-int8_t obtem_temperatura_maxima(void);
-int8_t obtem_temperatura_minima(void);
-int8_t obtem_media_temperaturas(void);
-int quantidade_de_temperaturas_lidas(void);
\ No newline at end of file
+float calcula_desvio_padrao(void);
+float obtem_temperatura_maxima(void);
+float obtem_temperatura_minima(void);
+float obtem_media_temperaturas(void);
+int quantidade_de_temperaturas_lidas(void);
+const int16_t * obtem_amostras_temperatura_x10(int * pt_qtde_amostras);
\ No newline at end of file
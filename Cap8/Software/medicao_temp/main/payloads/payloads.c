@@ -0,0 +1,133 @@
+/* Módulo: payloads LoRaWAN - medicao de temperatura
+ *
+ * ARQUIVO GERADO por Ferramentas/gera_payloads a partir de payloads.esquema.
+ * Não editar: altere o esquema e gere novamente (make -C Ferramentas payloads).
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também é compilado
+ *      no computador (decoder dos payloads).
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "payloads.h"
+
+/* Funções locais */
+static int64_t satura_real(float valor, int64_t min, int64_t max);
+static void decodifica_resumo_temperaturas(const uint8_t * pt_quadro, double * pt_valores);
+
+/* Campos do payload resumo_temperaturas */
+static const TEsquema_campo campos_resumo_temperaturas[] =
+{
+    { "media", "C", 0.5 },
+    { "minima", "C", 0.5 },
+    { "maxima", "C", 0.5 },
+    { "desvio_padrao", "C", 0.25 },
+};
+
+/* Tabela dos payloads (decoder genérico) */
+const TEsquema_payload payloads_cap8[QTDE_PAYLOADS_CAP8] =
+{
+    { "resumo_temperaturas", 12, PAYLOAD_RESUMO_TEMPERATURAS_TAM, 4, campos_resumo_temperaturas, decodifica_resumo_temperaturas, -1 },
+};
+
+/* Função: arredonda e satura um valor (já em unidades brutas) na faixa de um campo
+ * Parâmetros: - valor
+ *             - valores mínimo e máximo
+ * Retorno: valor bruto
+ */
+static int64_t satura_real(float valor, int64_t min, int64_t max)
+{
+    if (!(valor > (float)min))
+    {
+        return min;
+    }
+
+    if (valor >= (float)max)
+    {
+        return max;
+    }
+
+    return (int64_t)lroundf(valor);
+}
+
+/* Função: empacota o payload resumo_temperaturas
+ * Parâmetros: - ponteiro para os valores
+ *             - ponteiro para o quadro (PAYLOAD_RESUMO_TEMPERATURAS_TAM bytes)
+ * Retorno: nenhum
+ */
+void payload_resumo_temperaturas_empacota(const TPayload_resumo_temperaturas * pt_payload, uint8_t * pt_quadro)
+{
+    int64_t bruto;
+
+    memset(pt_quadro, 0, PAYLOAD_RESUMO_TEMPERATURAS_TAM);
+
+    /* media */
+    bruto = satura_real((pt_payload->media + 55.0f) / 0.5f, 0, 511);
+    pt_quadro[0] |= (uint8_t)((bruto >> 1) & 0xFFU);
+    pt_quadro[1] |= (uint8_t)((bruto & 0x1U) << 7);
+
+    /* minima */
+    bruto = satura_real((pt_payload->minima + 55.0f) / 0.5f, 0, 511);
+    pt_quadro[1] |= (uint8_t)((bruto >> 2) & 0x7FU);
+    pt_quadro[2] |= (uint8_t)((bruto & 0x3U) << 6);
+
+    /* maxima */
+    bruto = satura_real((pt_payload->maxima + 55.0f) / 0.5f, 0, 511);
+    pt_quadro[2] |= (uint8_t)((bruto >> 3) & 0x3FU);
+    pt_quadro[3] |= (uint8_t)((bruto & 0x7U) << 5);
+
+    /* desvio_padrao */
+    bruto = satura_real(pt_payload->desvio_padrao / 0.25f, 0, 31);
+    pt_quadro[3] |= (uint8_t)(bruto & 0x1FU);
+}
+
+/* Função: desempacota o payload resumo_temperaturas
+ * Parâmetros: - ponteiro para o quadro (PAYLOAD_RESUMO_TEMPERATURAS_TAM bytes)
+ *             - ponteiro para os valores
+ * Retorno: nenhum
+ */
+void payload_resumo_temperaturas_desempacota(const uint8_t * pt_quadro, TPayload_resumo_temperaturas * pt_payload)
+{
+    uint32_t bruto;
+
+    /* media */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[0] & 0xFFU) << 1;
+    bruto |= (uint32_t)((pt_quadro[1] >> 7) & 0x1U);
+    pt_payload->media = (float)bruto * 0.5f - 55.0f;
+
+    /* minima */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[1] & 0x7FU) << 2;
+    bruto |= (uint32_t)((pt_quadro[2] >> 6) & 0x3U);
+    pt_payload->minima = (float)bruto * 0.5f - 55.0f;
+
+    /* maxima */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[2] & 0x3FU) << 3;
+    bruto |= (uint32_t)((pt_quadro[3] >> 5) & 0x7U);
+    pt_payload->maxima = (float)bruto * 0.5f - 55.0f;
+
+    /* desvio_padrao */
+    bruto = 0;
+    bruto |= (uint32_t)(pt_quadro[3] & 0x1FU);
+    pt_payload->desvio_padrao = (float)bruto * 0.25f;
+}
+
+/* Função: decodifica o payload resumo_temperaturas para o decoder genérico
+ * Parâmetros: - ponteiro para o quadro (PAYLOAD_RESUMO_TEMPERATURAS_TAM bytes)
+ *             - ponteiro para os valores (um por campo, NAN se sem valor)
+ * Retorno: nenhum
+ */
+static void decodifica_resumo_temperaturas(const uint8_t * pt_quadro, double * pt_valores)
+{
+    TPayload_resumo_temperaturas payload;
+
+    payload_resumo_temperaturas_desempacota(pt_quadro, &payload);
+    pt_valores[0] = (double)payload.media;
+    pt_valores[1] = (double)payload.minima;
+    pt_valores[2] = (double)payload.maxima;
+    pt_valores[3] = (double)payload.desvio_padrao;
+}
@@ -0,0 +1,45 @@
+/* Header file: payloads LoRaWAN - medicao de temperatura
+ *
+ * ARQUIVO GERADO por Ferramentas/gera_payloads a partir de payloads.esquema.
+ * Não editar: altere o esquema e gere novamente (make -C Ferramentas payloads).
+ *
+ * Campos em bits, do bit mais significativo de cada byte para o menos
+ * significativo (big-endian). Valor físico = bruto x escala + deslocamento.
+ *
+ * Payload resumo_temperaturas (porta 12, 4 bytes):
+ *   bits   0..  8: media (u9, x 0.5 -55, bruto 0..511) C
+ *   bits   9.. 17: minima (u9, x 0.5 -55, bruto 0..511) C
+ *   bits  18.. 26: maxima (u9, x 0.5 -55, bruto 0..511) C
+ *   bits  27.. 31: desvio_padrao (u5, x 0.25, bruto 0..31) C
+ */
+
+#ifndef HEADER_PAYLOADS_CAP8
+#define HEADER_PAYLOADS_CAP8
+
+#include <stdint.h>
+#include "esquema_payloads.h"
+
+/* Payload resumo_temperaturas */
+#define PAYLOAD_RESUMO_TEMPERATURAS_PORTA        12
+#define PAYLOAD_RESUMO_TEMPERATURAS_TAM          4   //bytes
+
+typedef struct
+{
+    float media;  // C
+    float minima;  // C
+    float maxima;  // C
+    float desvio_padrao;  // C
+}TPayload_resumo_temperaturas;
+
+_Static_assert(PAYLOAD_RESUMO_TEMPERATURAS_TAM <= 11, "payload resumo_temperaturas maior que o maximo do esquema");
+
+/* Tabela dos payloads (decoder genérico) */
+#define QTDE_PAYLOADS_CAP8                       1
+
+extern const TEsquema_payload payloads_cap8[QTDE_PAYLOADS_CAP8];
+
+#endif
+
+/* Protótipos */
+void payload_resumo_temperaturas_empacota(const TPayload_resumo_temperaturas * pt_payload, uint8_t * pt_quadro);
+void payload_resumo_temperaturas_desempacota(const uint8_t * pt_quadro, TPayload_resumo_temperaturas * pt_payload);
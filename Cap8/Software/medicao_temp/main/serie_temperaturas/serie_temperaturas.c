@@ -0,0 +1,316 @@
+/* Módulo: codec da série de temperaturas de uma janela de envio
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e testado no computador.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "serie_temperaturas.h"
+
+/* Fluxo de bits (escrita ou leitura) sobre um buffer de bytes */
+typedef struct
+{
+    uint8_t * pt_bytes;
+    int tam_max_bits;
+    int qtde_bits;
+}TFluxo_bits;
+
+/* Funções locais */
+static uint32_t zig_zag(int32_t valor);
+static int32_t desfaz_zig_zag(uint32_t valor);
+static bool escreve_bits(TFluxo_bits * pt_fluxo, uint32_t valor, int qtde_bits);
+static bool le_bits(TFluxo_bits * pt_fluxo, uint32_t * pt_valor, int qtde_bits);
+static int codifica_com_passo(const int16_t * pt_amostras_x10, int qtde_amostras, int passo, uint8_t * pt_quadro, int tam_max_quadro);
+
+/* Função: converte valor com sinal para zig-zag (0, -1, 1, -2, 2, ... -> 0, 1, 2, 3, 4, ...)
+ * Parâmetros: valor
+ * Retorno: valor convertido
+ */
+static uint32_t zig_zag(int32_t valor)
+{
+    return (valor >= 0) ? ((uint32_t)valor << 1) : ((((uint32_t)(-valor)) << 1) - 1);
+}
+
+/* Função: desfaz a conversão zig-zag
+ * Parâmetros: valor em zig-zag
+ * Retorno: valor com sinal
+ */
+static int32_t desfaz_zig_zag(uint32_t valor)
+{
+    return ((valor & 1) == 0) ? (int32_t)(valor >> 1) : -(int32_t)((valor + 1) >> 1);
+}
+
+/* Função: escreve bits no fluxo (mais significativo primeiro)
+ * Parâmetros: - ponteiro para o fluxo
+ *             - valor (nos qtde_bits menos significativos)
+ *             - quantidade de bits
+ * Retorno: true: escrito; false: não cabe no buffer
+ */
+static bool escreve_bits(TFluxo_bits * pt_fluxo, uint32_t valor, int qtde_bits)
+{
+    int bit;
+    int i;
+
+    if ((pt_fluxo->qtde_bits + qtde_bits) > pt_fluxo->tam_max_bits)
+    {
+        return false;
+    }
+
+    for (i = qtde_bits - 1; i >= 0; i--)
+    {
+        bit = (valor >> i) & 1;
+        if (bit != 0)
+        {
+            pt_fluxo->pt_bytes[pt_fluxo->qtde_bits / 8] |= (uint8_t)(0x80 >> (pt_fluxo->qtde_bits % 8));
+        }
+        pt_fluxo->qtde_bits++;
+    }
+
+    return true;
+}
+
+/* Função: lê bits do fluxo (mais significativo primeiro)
+ * Parâmetros: - ponteiro para o fluxo
+ *             - ponteiro para o valor lido
+ *             - quantidade de bits
+ * Retorno: true: lido; false: fim do buffer
+ */
+static bool le_bits(TFluxo_bits * pt_fluxo, uint32_t * pt_valor, int qtde_bits)
+{
+    int i;
+
+    if ((pt_fluxo->qtde_bits + qtde_bits) > pt_fluxo->tam_max_bits)
+    {
+        return false;
+    }
+
+    *pt_valor = 0;
+    for (i = 0; i < qtde_bits; i++)
+    {
+        *pt_valor = (*pt_valor << 1) | ((pt_fluxo->pt_bytes[pt_fluxo->qtde_bits / 8] >> (7 - (pt_fluxo->qtde_bits % 8))) & 1);
+        pt_fluxo->qtde_bits++;
+    }
+
+    return true;
+}
+
+/* Função: codifica a série com um passo (média de cada bloco de "passo" amostras)
+ * Parâmetros: - ponteiro para as amostras da janela (0,1 °C)
+ *             - quantidade de amostras da janela
+ *             - passo
+ *             - ponteiro para o quadro
+ *             - tamanho máximo do quadro
+ * Retorno: tamanho do quadro (bytes). 0 se não couber.
+ */
+static int codifica_com_passo(const int16_t * pt_amostras_x10, int qtde_amostras, int passo, uint8_t * pt_quadro, int tam_max_quadro)
+{
+    TFluxo_bits fluxo;
+    int32_t soma;
+    int32_t amostra;
+    int32_t anterior = 0;
+    int32_t delta_anterior = 0;
+    int32_t delta_de_delta;
+    uint32_t codigo;
+    int qtde_codificadas = (qtde_amostras + passo - 1) / passo;
+    int qtde_bloco;
+    int i;
+    int j;
+    bool cabe = true;
+
+    if ( (qtde_codificadas > SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS) || (passo > UINT8_MAX) ||
+         (tam_max_quadro <= SERIE_TEMPERATURAS_TAM_CABECALHO) )
+    {
+        return 0;
+    }
+
+    memset(pt_quadro, 0x00, tam_max_quadro);
+    pt_quadro[0] = (uint8_t)qtde_codificadas;
+    pt_quadro[1] = (uint8_t)passo;
+
+    fluxo.pt_bytes = &pt_quadro[SERIE_TEMPERATURAS_TAM_CABECALHO];
+    fluxo.tam_max_bits = (tam_max_quadro - SERIE_TEMPERATURAS_TAM_CABECALHO) * 8;
+    fluxo.qtde_bits = 0;
+
+    for (i = 0; (i < qtde_codificadas) && (cabe == true); i++)
+    {
+        /* Média do bloco, arredondada para o 0,1 °C mais próximo */
+        soma = 0;
+        qtde_bloco = 0;
+        for (j = i * passo; (j < ((i + 1) * passo)) && (j < qtde_amostras); j++)
+        {
+            soma += pt_amostras_x10[j];
+            qtde_bloco++;
+        }
+        amostra = (soma >= 0) ? ((soma + (qtde_bloco / 2)) / qtde_bloco) : -((-soma + (qtde_bloco / 2)) / qtde_bloco);
+
+        if (i == 0)
+        {
+            if ((amostra < SERIE_TEMPERATURAS_AMOSTRA_MIN) || (amostra > SERIE_TEMPERATURAS_AMOSTRA_MAX))
+            {
+                return 0;
+            }
+
+            cabe = escreve_bits(&fluxo, (uint32_t)amostra & 0x0FFF, SERIE_TEMPERATURAS_BITS_PRIMEIRA);
+            anterior = amostra;
+            continue;
+        }
+
+        delta_de_delta = (amostra - anterior) - delta_anterior;
+        delta_anterior = amostra - anterior;
+        anterior = amostra;
+        codigo = zig_zag(delta_de_delta);
+
+        if (codigo == 0)
+        {
+            cabe = escreve_bits(&fluxo, 0x0, 1);
+        }
+        else if (codigo < (1 << 3))
+        {
+            cabe = escreve_bits(&fluxo, (0x2 << 3) | codigo, 2 + 3);
+        }
+        else if (codigo < (1 << 6))
+        {
+            cabe = escreve_bits(&fluxo, (0x6 << 6) | codigo, 3 + 6);
+        }
+        else if (codigo < (1 << 12))
+        {
+            cabe = escreve_bits(&fluxo, (0x7 << 12) | codigo, 3 + 12);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    if (cabe == false)
+    {
+        return 0;
+    }
+
+    return SERIE_TEMPERATURAS_TAM_CABECALHO + ((fluxo.qtde_bits + 7) / 8);
+}
+
+/* Função: codifica a série de temperaturas da janela com o menor passo
+ *         que cabe no tamanho máximo do quadro
+ * Parâmetros: - ponteiro para as amostras da janela (0,1 °C)
+ *             - quantidade de amostras da janela
+ *             - ponteiro para o quadro
+ *             - tamanho máximo do quadro (payload máximo do DR)
+ *             - ponteiro para o passo usado
+ * Retorno: tamanho do quadro (bytes). 0 se a série não couber nem com
+ *          SERIE_TEMPERATURAS_QTDE_MIN_AMOSTRAS amostras (enviar o resumo).
+ */
+int serie_temperaturas_codifica(const int16_t * pt_amostras_x10, int qtde_amostras, uint8_t * pt_quadro, int tam_max_quadro, int * pt_passo)
+{
+    int tam_quadro;
+    int passo;
+
+    if (qtde_amostras <= 0)
+    {
+        return 0;
+    }
+
+    for (passo = 1; ((qtde_amostras + passo - 1) / passo) >= SERIE_TEMPERATURAS_QTDE_MIN_AMOSTRAS; passo++)
+    {
+        tam_quadro = codifica_com_passo(pt_amostras_x10, qtde_amostras, passo, pt_quadro, tam_max_quadro);
+
+        if (tam_quadro > 0)
+        {
+            *pt_passo = passo;
+            return tam_quadro;
+        }
+    }
+
+    return 0;
+}
+
+/* Função: decodifica um quadro de série de temperaturas
+ * Parâmetros: - ponteiro para o quadro
+ *             - tamanho do quadro
+ *             - ponteiro para as amostras decodificadas (0,1 °C)
+ *             - quantidade máxima de amostras
+ *             - ponteiro para o passo (amostras da janela por amostra decodificada)
+ * Retorno: quantidade de amostras decodificadas. -1 se o quadro for inválido.
+ */
+int serie_temperaturas_decodifica(const uint8_t * pt_quadro, int tam_quadro, int16_t * pt_amostras_x10, int qtde_max_amostras, int * pt_passo)
+{
+    TFluxo_bits fluxo;
+    int32_t amostra;
+    int32_t delta = 0;
+    uint32_t prefixo;
+    uint32_t codigo;
+    int qtde_amostras;
+    int i;
+
+    if (tam_quadro <= SERIE_TEMPERATURAS_TAM_CABECALHO)
+    {
+        return -1;
+    }
+
+    qtde_amostras = pt_quadro[0];
+    *pt_passo = pt_quadro[1];
+
+    if ((qtde_amostras == 0) || (qtde_amostras > qtde_max_amostras) || (*pt_passo == 0))
+    {
+        return -1;
+    }
+
+    fluxo.pt_bytes = (uint8_t *)&pt_quadro[SERIE_TEMPERATURAS_TAM_CABECALHO];
+    fluxo.tam_max_bits = (tam_quadro - SERIE_TEMPERATURAS_TAM_CABECALHO) * 8;
+    fluxo.qtde_bits = 0;
+
+    if (le_bits(&fluxo, &codigo, SERIE_TEMPERATURAS_BITS_PRIMEIRA) == false)
+    {
+        return -1;
+    }
+
+    /* Primeira amostra: 12 bits em complemento de 2 */
+    amostra = (codigo & 0x800) ? ((int32_t)codigo - 0x1000) : (int32_t)codigo;
+    pt_amostras_x10[0] = (int16_t)amostra;
+
+    for (i = 1; i < qtde_amostras; i++)
+    {
+        if (le_bits(&fluxo, &prefixo, 1) == false)
+        {
+            return -1;
+        }
+
+        codigo = 0;
+        if (prefixo == 1)
+        {
+            if (le_bits(&fluxo, &prefixo, 1) == false)
+            {
+                return -1;
+            }
+
+            if (prefixo == 0)
+            {
+                if (le_bits(&fluxo, &codigo, 3) == false)
+                {
+                    return -1;
+                }
+            }
+            else
+            {
+                if (le_bits(&fluxo, &prefixo, 1) == false)
+                {
+                    return -1;
+                }
+
+                if (le_bits(&fluxo, &codigo, (prefixo == 0) ? 6 : 12) == false)
+                {
+                    return -1;
+                }
+            }
+        }
+
+        delta += desfaz_zig_zag(codigo);
+        amostra += delta;
+        pt_amostras_x10[i] = (int16_t)amostra;
+    }
+
+    return qtde_amostras;
+}
@@ -0,0 +1,52 @@
+/* Header file: codec da série de temperaturas de uma janela de envio
+ *
+ * As amostras da janela (resolução de 0,1 °C) são codificadas por
+ * delta-de-delta: cada amostra é prevista pela anterior mais a última
+ * variação, e só o erro da previsão (zig-zag) é gravado, num fluxo de bits
+ * com códigos de tamanho variável:
+ *   '0'                     -> delta-de-delta = 0
+ *   '10'  + 3 bits zig-zag  -> delta-de-delta em [-4, 3]
+ *   '110' + 6 bits zig-zag  -> delta-de-delta em [-32, 31]
+ *   '111' + 12 bits zig-zag -> demais valores
+ * Temperaturas estáveis ou variando a taxa constante custam 1 bit por amostra.
+ *
+ * Formato do quadro:
+ *   byte 0: quantidade de amostras codificadas
+ *   byte 1: passo (amostras da janela por amostra codificada)
+ *   bytes 2 em diante: fluxo de bits (do bit mais significativo de cada
+ *           byte para o menos significativo): primeira amostra (12 bits,
+ *           complemento de 2, 0,1 °C) e os códigos das amostras seguintes.
+ * Se a janela inteira não cabe no payload máximo, as amostras são agrupadas
+ * em blocos de "passo" amostras consecutivas, cada bloco representado pela
+ * sua média, usando o menor passo que cabe. Se nem com
+ * SERIE_TEMPERATURAS_QTDE_MIN_AMOSTRAS amostras a série cabe, a codificação
+ * falha e a aplicação envia o resumo (média, mínima, máxima e desvio padrão).
+ *
+ * OBS: este módulo não depende do ESP-IDF, de forma que também pode ser
+ *      compilado e testado no computador.
+ */
+
+#ifndef HEADER_SERIE_TEMPERATURAS
+#define HEADER_SERIE_TEMPERATURAS
+
+#include <stdint.h>
+
+/* Definições - formato do quadro */
+#define SERIE_TEMPERATURAS_TAM_CABECALHO      2
+#define SERIE_TEMPERATURAS_BITS_PRIMEIRA      12
+#define SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS  255
+
+/* Definição - menor quantidade de amostras codificadas que vale a série
+ *             (abaixo disso, o resumo da janela é enviado)
+ */
+#define SERIE_TEMPERATURAS_QTDE_MIN_AMOSTRAS  8
+
+/* Definições - faixa das amostras (0,1 °C) representável na primeira amostra */
+#define SERIE_TEMPERATURAS_AMOSTRA_MIN        (-2048)
+#define SERIE_TEMPERATURAS_AMOSTRA_MAX        2047
+
+#endif
+
+/* Protótipos */
+int serie_temperaturas_codifica(const int16_t * pt_amostras_x10, int qtde_amostras, uint8_t * pt_quadro, int tam_max_quadro, int * pt_passo);
+int serie_temperaturas_decodifica(const uint8_t * pt_quadro, int tam_quadro, int16_t * pt_amostras_x10, int qtde_max_amostras, int * pt_passo);
@@ -0,0 +1,790 @@
+/* Módulo: arquivo colunar da telemetria decodificada (computador)
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "arquivo_colunar.h"
+
+/* Definições - codificação */
+#define TAM_MAX_VARINT              10      // bytes de um valor de 64 bits
+#define CODIGO_SEM_VALOR            0
+#define TAM_MAPA_COLUNA             ((size_t)ARQUIVO_COLUNAR_LINHAS_SEGMENTO * TAM_MAX_VARINT)
+
+/* Definições - dicionário de DevAddr */
+#define TAM_INICIAL_HASH            4096
+#define POSICAO_HASH_LIVRE          (-1)
+
+/* Tabela em escrita */
+typedef struct
+{
+    char nome[ARQUIVO_COLUNAR_TAM_MAX_NOME];
+    char caminho[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO];
+    int qtde_colunas;
+    TColuna_arquivo colunas[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    uint32_t proximo_segmento;
+
+    /* Segmento aberto */
+    bool segmento_aberto;
+    int descritores[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    uint8_t * pt_mapas[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    size_t tam_usado[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    int64_t anteriores[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    TIndice_segmento indice;
+}TTabela_escrita;
+
+/* Escritor */
+struct TArquivo_colunar
+{
+    char diretorio[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO / 2];
+    int qtde_tabelas;
+    TTabela_escrita tabelas[ARQUIVO_COLUNAR_QTDE_MAX_TABELAS];
+
+    /* Dicionário de DevAddr: identificador -> DevAddr e tabela hash DevAddr -> identificador */
+    uint32_t * pt_dev_addrs;
+    int qtde_dev_addrs;
+    int capacidade_dev_addrs;
+    int32_t * pt_hash;
+    int tam_hash;
+    FILE * pt_dicionario;
+};
+
+/* Funções locais */
+static int escreve_varint(uint8_t * pt_bytes, uint64_t valor);
+static uint64_t le_varint(const uint8_t ** pt_pt_bytes, const uint8_t * pt_fim);
+static uint64_t zig_zag(int64_t valor);
+static int64_t desfaz_zig_zag(uint64_t valor);
+static int posicao_hash(const TArquivo_colunar * pt_arquivo, uint32_t dev_addr);
+static bool insere_dev_addr(TArquivo_colunar * pt_arquivo, uint32_t dev_addr);
+static int identificador_dev_addr(TArquivo_colunar * pt_arquivo, uint32_t dev_addr);
+static int le_colunas(const char * pt_caminho_tabela, TColuna_arquivo * pt_colunas);
+static TTabela_escrita * tabela_escrita(TArquivo_colunar * pt_arquivo, const TTabela_lote * pt_tabela_lote);
+static bool abre_segmento(TTabela_escrita * pt_tabela);
+static bool fecha_segmento(TTabela_escrita * pt_tabela);
+static void escreve_valor(TTabela_escrita * pt_tabela, int coluna, double valor, int64_t codigo);
+
+/* Função: escreve um valor em varint (LEB128)
+ * Parâmetros: - ponteiro para os bytes
+ *             - valor
+ * Retorno: quantidade de bytes escritos
+ */
+static int escreve_varint(uint8_t * pt_bytes, uint64_t valor)
+{
+    int qtde_bytes = 0;
+
+    while (valor >= 0x80)
+    {
+        pt_bytes[qtde_bytes++] = (uint8_t)(valor | 0x80);
+        valor >>= 7;
+    }
+
+    pt_bytes[qtde_bytes++] = (uint8_t)valor;
+    return qtde_bytes;
+}
+
+/* Função: lê um valor em varint (LEB128)
+ * Parâmetros: - ponteiro para o ponteiro dos bytes (avança)
+ *             - ponteiro para o fim dos bytes
+ * Retorno: valor lido (0 se os bytes acabarem)
+ */
+static uint64_t le_varint(const uint8_t ** pt_pt_bytes, const uint8_t * pt_fim)
+{
+    const uint8_t * pt_bytes = *pt_pt_bytes;
+    uint64_t valor = 0;
+    int deslocamento = 0;
+
+    while ((pt_bytes < pt_fim) && ((*pt_bytes & 0x80) != 0))
+    {
+        valor |= (uint64_t)(*pt_bytes++ & 0x7F) << deslocamento;
+        deslocamento += 7;
+    }
+
+    if (pt_bytes < pt_fim)
+    {
+        valor |= (uint64_t)*pt_bytes++ << deslocamento;
+    }
+
+    *pt_pt_bytes = pt_bytes;
+    return valor;
+}
+
+/* Função: converte valor com sinal para zig-zag (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...)
+ * Parâmetros: valor
+ * Retorno: valor convertido
+ */
+static uint64_t zig_zag(int64_t valor)
+{
+    return ((uint64_t)valor << 1) ^ (uint64_t)(valor >> 63);
+}
+
+/* Função: desfaz a conversão zig-zag
+ * Parâmetros: valor em zig-zag
+ * Retorno: valor com sinal
+ */
+static int64_t desfaz_zig_zag(uint64_t valor)
+{
+    return (int64_t)(valor >> 1) ^ -(int64_t)(valor & 1);
+}
+
+/* Função: posição de um DevAddr na tabela hash (a dele ou a livre onde entraria)
+ * Parâmetros: - ponteiro para o arquivo
+ *             - DevAddr
+ * Retorno: posição
+ */
+static int posicao_hash(const TArquivo_colunar * pt_arquivo, uint32_t dev_addr)
+{
+    int posicao = (int)((dev_addr * 2654435761U) & (uint32_t)(pt_arquivo->tam_hash - 1));
+
+    while ( (pt_arquivo->pt_hash[posicao] != POSICAO_HASH_LIVRE) &&
+            (pt_arquivo->pt_dev_addrs[pt_arquivo->pt_hash[posicao]] != dev_addr) )
+    {
+        posicao = (posicao + 1) & (pt_arquivo->tam_hash - 1);
+    }
+
+    return posicao;
+}
+
+/* Função: insere um DevAddr novo no dicionário (em memória)
+ * Parâmetros: - ponteiro para o arquivo
+ *             - DevAddr
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool insere_dev_addr(TArquivo_colunar * pt_arquivo, uint32_t dev_addr)
+{
+    void * pt_novo;
+    int i;
+
+    if (pt_arquivo->qtde_dev_addrs == pt_arquivo->capacidade_dev_addrs)
+    {
+        if ((pt_novo = realloc(pt_arquivo->pt_dev_addrs, 2 * pt_arquivo->capacidade_dev_addrs * sizeof(uint32_t))) == NULL)
+        {
+            return false;
+        }
+
+        pt_arquivo->pt_dev_addrs = pt_novo;
+        pt_arquivo->capacidade_dev_addrs *= 2;
+    }
+
+    /* Tabela hash com no máximo metade das posições ocupadas */
+    if ((2 * (pt_arquivo->qtde_dev_addrs + 1)) > pt_arquivo->tam_hash)
+    {
+        if ((pt_novo = realloc(pt_arquivo->pt_hash, 2 * pt_arquivo->tam_hash * sizeof(int32_t))) == NULL)
+        {
+            return false;
+        }
+
+        pt_arquivo->pt_hash = pt_novo;
+        pt_arquivo->tam_hash *= 2;
+        memset(pt_arquivo->pt_hash, 0xFF, pt_arquivo->tam_hash * sizeof(int32_t));
+
+        for (i = 0; i < pt_arquivo->qtde_dev_addrs; i++)
+        {
+            pt_arquivo->pt_hash[posicao_hash(pt_arquivo, pt_arquivo->pt_dev_addrs[i])] = i;
+        }
+    }
+
+    pt_arquivo->pt_dev_addrs[pt_arquivo->qtde_dev_addrs] = dev_addr;
+    pt_arquivo->pt_hash[posicao_hash(pt_arquivo, dev_addr)] = pt_arquivo->qtde_dev_addrs;
+    pt_arquivo->qtde_dev_addrs++;
+    return true;
+}
+
+/* Função: identificador de um DevAddr no dicionário (inclui no dicionário
+ *         e no arquivo do dicionário, se for novo)
+ * Parâmetros: - ponteiro para o arquivo
+ *             - DevAddr
+ * Retorno: identificador. -1 em caso de falha.
+ */
+static int identificador_dev_addr(TArquivo_colunar * pt_arquivo, uint32_t dev_addr)
+{
+    int posicao = posicao_hash(pt_arquivo, dev_addr);
+
+    if (pt_arquivo->pt_hash[posicao] != POSICAO_HASH_LIVRE)
+    {
+        return pt_arquivo->pt_hash[posicao];
+    }
+
+    if ( (insere_dev_addr(pt_arquivo, dev_addr) == false) ||
+         (fwrite(&dev_addr, sizeof(dev_addr), 1, pt_arquivo->pt_dicionario) != 1) )
+    {
+        return -1;
+    }
+
+    return pt_arquivo->qtde_dev_addrs - 1;
+}
+
+/* Função: lê a descrição das colunas de uma tabela do arquivo
+ * Parâmetros: - caminho da tabela
+ *             - ponteiro para as colunas
+ * Retorno: quantidade de colunas. -1 se a tabela não existir ou a descrição for inválida.
+ */
+static int le_colunas(const char * pt_caminho_tabela, TColuna_arquivo * pt_colunas)
+{
+    char caminho[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO + 16];
+    FILE * pt_arquivo;
+    int qtde_colunas = 0;
+
+    snprintf(caminho, sizeof(caminho), "%s/colunas", pt_caminho_tabela);
+
+    if ((pt_arquivo = fopen(caminho, "r")) == NULL)
+    {
+        return -1;
+    }
+
+    while ( (qtde_colunas < ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS) &&
+            (fscanf(pt_arquivo, "%47s %lf %47s", pt_colunas[qtde_colunas].nome, &pt_colunas[qtde_colunas].resolucao,
+                    pt_colunas[qtde_colunas].unidade) == 3) )
+    {
+        if (strcmp(pt_colunas[qtde_colunas].unidade, "-") == 0)
+        {
+            pt_colunas[qtde_colunas].unidade[0] = '\0';
+        }
+
+        qtde_colunas++;
+    }
+
+    fclose(pt_arquivo);
+    return (qtde_colunas > ARQUIVO_COLUNAR_COLUNA_INSTANTE) ? qtde_colunas : -1;
+}
+
+/* Função: tabela em escrita correspondente a uma tabela do decodificador
+ *         (cria o diretório e a descrição das colunas, ou continua uma
+ *         tabela já existente no arquivo)
+ * Parâmetros: - ponteiro para o arquivo
+ *             - ponteiro para a tabela do decodificador
+ * Retorno: ponteiro para a tabela em escrita. NULL em caso de falha
+ *          (inclusive colunas diferentes das já gravadas).
+ */
+static TTabela_escrita * tabela_escrita(TArquivo_colunar * pt_arquivo, const TTabela_lote * pt_tabela_lote)
+{
+    TColuna_arquivo colunas_gravadas[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    TTabela_escrita * pt_tabela;
+    char caminho_tabela[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO];
+    char caminho[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO + 16];
+    struct stat estado;
+    FILE * pt_colunas;
+    int qtde_colunas_gravadas;
+    int i;
+
+    for (i = 0; i < pt_arquivo->qtde_tabelas; i++)
+    {
+        if (strcmp(pt_arquivo->tabelas[i].nome, pt_tabela_lote->pt_nome) == 0)
+        {
+            return &pt_arquivo->tabelas[i];
+        }
+    }
+
+    if (pt_arquivo->qtde_tabelas >= ARQUIVO_COLUNAR_QTDE_MAX_TABELAS)
+    {
+        return NULL;
+    }
+
+    pt_tabela = &pt_arquivo->tabelas[pt_arquivo->qtde_tabelas];
+    memset(pt_tabela, 0x00, sizeof(TTabela_escrita));
+    snprintf(pt_tabela->nome, sizeof(pt_tabela->nome), "%s", pt_tabela_lote->pt_nome);
+    snprintf(caminho_tabela, sizeof(caminho_tabela), "%s/%s", pt_arquivo->diretorio, pt_tabela_lote->pt_nome);
+    memcpy(pt_tabela->caminho, caminho_tabela, sizeof(pt_tabela->caminho));
+
+    /* Colunas: dev_addr, instante e as colunas da tabela */
+    snprintf(pt_tabela->colunas[ARQUIVO_COLUNAR_COLUNA_DEV_ADDR].nome, ARQUIVO_COLUNAR_TAM_MAX_NOME, "dev_addr");
+    pt_tabela->colunas[ARQUIVO_COLUNAR_COLUNA_DEV_ADDR].resolucao = 1.0;
+    snprintf(pt_tabela->colunas[ARQUIVO_COLUNAR_COLUNA_INSTANTE].nome, ARQUIVO_COLUNAR_TAM_MAX_NOME, "instante");
+    snprintf(pt_tabela->colunas[ARQUIVO_COLUNAR_COLUNA_INSTANTE].unidade, ARQUIVO_COLUNAR_TAM_MAX_NOME, "s");
+    pt_tabela->colunas[ARQUIVO_COLUNAR_COLUNA_INSTANTE].resolucao = 1.0;
+    pt_tabela->qtde_colunas = 2 + pt_tabela_lote->qtde_colunas;
+
+    for (i = 0; i < pt_tabela_lote->qtde_colunas; i++)
+    {
+        snprintf(pt_tabela->colunas[2 + i].nome, ARQUIVO_COLUNAR_TAM_MAX_NOME, "%s", pt_tabela_lote->pt_nomes_colunas[i]);
+        snprintf(pt_tabela->colunas[2 + i].unidade, ARQUIVO_COLUNAR_TAM_MAX_NOME, "%s", pt_tabela_lote->pt_unidades_colunas[i]);
+        pt_tabela->colunas[2 + i].resolucao = pt_tabela_lote->resolucoes_colunas[i];
+    }
+
+    if ((mkdir(pt_tabela->caminho, 0755) != 0) && (errno != EEXIST))
+    {
+        return NULL;
+    }
+
+    qtde_colunas_gravadas = le_colunas(pt_tabela->caminho, colunas_gravadas);
+
+    if (qtde_colunas_gravadas >= 0)
+    {
+        /* Tabela existente: mesmas colunas; continua no segmento seguinte ao último do índice */
+        if (qtde_colunas_gravadas != pt_tabela->qtde_colunas)
+        {
+            return NULL;
+        }
+
+        for (i = 0; i < qtde_colunas_gravadas; i++)
+        {
+            if ( (strcmp(colunas_gravadas[i].nome, pt_tabela->colunas[i].nome) != 0) ||
+                 (colunas_gravadas[i].resolucao != pt_tabela->colunas[i].resolucao) )
+            {
+                return NULL;
+            }
+        }
+
+        snprintf(caminho, sizeof(caminho), "%s/indice", pt_tabela->caminho);
+        pt_tabela->proximo_segmento = (stat(caminho, &estado) == 0) ? (uint32_t)(estado.st_size / sizeof(TIndice_segmento)) : 0;
+    }
+    else
+    {
+        snprintf(caminho, sizeof(caminho), "%s/colunas", pt_tabela->caminho);
+
+        if ((pt_colunas = fopen(caminho, "w")) == NULL)
+        {
+            return NULL;
+        }
+
+        for (i = 0; i < pt_tabela->qtde_colunas; i++)
+        {
+            fprintf(pt_colunas, "%s %.17g %s\n", pt_tabela->colunas[i].nome, pt_tabela->colunas[i].resolucao,
+                    (pt_tabela->colunas[i].unidade[0] != '\0') ? pt_tabela->colunas[i].unidade : "-");
+        }
+
+        fclose(pt_colunas);
+    }
+
+    pt_arquivo->qtde_tabelas++;
+    return pt_tabela;
+}
+
+/* Função: abre um novo segmento da tabela (um arquivo mapeado por coluna)
+ * Parâmetros: ponteiro para a tabela
+ * Retorno: true: sucesso; false: falha
+ */
+static bool abre_segmento(TTabela_escrita * pt_tabela)
+{
+    char caminho[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO + ARQUIVO_COLUNAR_TAM_MAX_NOME + 16];
+    int i;
+
+    memset(&pt_tabela->indice, 0x00, sizeof(TIndice_segmento));
+    pt_tabela->indice.segmento = pt_tabela->proximo_segmento;
+
+    for (i = 0; i < pt_tabela->qtde_colunas; i++)
+    {
+        snprintf(caminho, sizeof(caminho), "%s/%06u.%s", pt_tabela->caminho, pt_tabela->proximo_segmento, pt_tabela->colunas[i].nome);
+        pt_tabela->descritores[i] = open(caminho, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+        /* Arquivo esparso do tamanho máximo do segmento; reduzido ao usado no fechamento */
+        if ((pt_tabela->descritores[i] < 0) || (ftruncate(pt_tabela->descritores[i], TAM_MAPA_COLUNA) != 0))
+        {
+            return false;
+        }
+
+        pt_tabela->pt_mapas[i] = mmap(NULL, TAM_MAPA_COLUNA, PROT_READ | PROT_WRITE, MAP_SHARED, pt_tabela->descritores[i], 0);
+
+        if (pt_tabela->pt_mapas[i] == MAP_FAILED)
+        {
+            return false;
+        }
+
+        pt_tabela->tam_usado[i] = 0;
+        pt_tabela->anteriores[i] = 0;
+        pt_tabela->indice.min[i] = INFINITY;
+        pt_tabela->indice.max[i] = -INFINITY;
+    }
+
+    pt_tabela->segmento_aberto = true;
+    return true;
+}
+
+/* Função: fecha o segmento aberto da tabela e grava o índice dele
+ * Parâmetros: ponteiro para a tabela
+ * Retorno: true: sucesso; false: falha
+ */
+static bool fecha_segmento(TTabela_escrita * pt_tabela)
+{
+    char caminho[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO + 16];
+    FILE * pt_indice;
+    bool sucesso = true;
+    int i;
+
+    for (i = 0; i < pt_tabela->qtde_colunas; i++)
+    {
+        sucesso &= (munmap(pt_tabela->pt_mapas[i], TAM_MAPA_COLUNA) == 0);
+        sucesso &= (ftruncate(pt_tabela->descritores[i], (off_t)pt_tabela->tam_usado[i]) == 0);
+        sucesso &= (close(pt_tabela->descritores[i]) == 0);
+    }
+
+    snprintf(caminho, sizeof(caminho), "%s/indice", pt_tabela->caminho);
+
+    if ((pt_indice = fopen(caminho, "ab")) == NULL)
+    {
+        return false;
+    }
+
+    sucesso &= (fwrite(&pt_tabela->indice, sizeof(TIndice_segmento), 1, pt_indice) == 1);
+    sucesso &= (fclose(pt_indice) == 0);
+
+    pt_tabela->segmento_aberto = false;
+    pt_tabela->proximo_segmento++;
+    return sucesso;
+}
+
+/* Função: escreve o valor de uma coluna na linha seguinte do segmento aberto
+ * Parâmetros: - ponteiro para a tabela
+ *             - coluna
+ *             - valor (para o índice; NAN: sem valor)
+ *             - código gravado: identificador do DevAddr, ou valor em passos da resolução
+ * Retorno: nenhum
+ */
+static void escreve_valor(TTabela_escrita * pt_tabela, int coluna, double valor, int64_t codigo)
+{
+    uint8_t * pt_bytes = &pt_tabela->pt_mapas[coluna][pt_tabela->tam_usado[coluna]];
+
+    if (isnan(valor))
+    {
+        *pt_bytes = CODIGO_SEM_VALOR;
+        pt_tabela->tam_usado[coluna]++;
+        return;
+    }
+
+    pt_tabela->indice.min[coluna] = (valor < pt_tabela->indice.min[coluna]) ? valor : pt_tabela->indice.min[coluna];
+    pt_tabela->indice.max[coluna] = (valor > pt_tabela->indice.max[coluna]) ? valor : pt_tabela->indice.max[coluna];
+
+    if (coluna == ARQUIVO_COLUNAR_COLUNA_DEV_ADDR)
+    {
+        pt_tabela->tam_usado[coluna] += escreve_varint(pt_bytes, (uint64_t)codigo);
+        return;
+    }
+
+    pt_tabela->tam_usado[coluna] += escreve_varint(pt_bytes, zig_zag(codigo - pt_tabela->anteriores[coluna]) + 1);
+    pt_tabela->anteriores[coluna] = codigo;
+}
+
+/* Função: abre um arquivo colunar para escrita (cria o diretório, ou
+ *         continua um arquivo existente)
+ * Parâmetros: diretório do arquivo
+ * Retorno: ponteiro para o arquivo. NULL em caso de falha.
+ */
+TArquivo_colunar * arquivo_colunar_abre(const char * pt_diretorio)
+{
+    TArquivo_colunar * pt_arquivo;
+    char caminho[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO + 16];
+    uint32_t dev_addr;
+    FILE * pt_dicionario;
+    bool sucesso = true;
+
+    if ( ((mkdir(pt_diretorio, 0755) != 0) && (errno != EEXIST)) || (strlen(pt_diretorio) >= (ARQUIVO_COLUNAR_TAM_MAX_CAMINHO / 2)) ||
+         ((pt_arquivo = calloc(1, sizeof(TArquivo_colunar))) == NULL) )
+    {
+        return NULL;
+    }
+
+    snprintf(pt_arquivo->diretorio, sizeof(pt_arquivo->diretorio), "%s", pt_diretorio);
+    pt_arquivo->capacidade_dev_addrs = TAM_INICIAL_HASH / 2;
+    pt_arquivo->tam_hash = TAM_INICIAL_HASH;
+    pt_arquivo->pt_dev_addrs = malloc(pt_arquivo->capacidade_dev_addrs * sizeof(uint32_t));
+    pt_arquivo->pt_hash = malloc(pt_arquivo->tam_hash * sizeof(int32_t));
+
+    if ((pt_arquivo->pt_dev_addrs == NULL) || (pt_arquivo->pt_hash == NULL))
+    {
+        sucesso = false;
+    }
+    else
+    {
+        memset(pt_arquivo->pt_hash, 0xFF, pt_arquivo->tam_hash * sizeof(int32_t));
+
+        /* Dicionário existente: mesmos identificadores */
+        snprintf(caminho, sizeof(caminho), "%s/dev_addr", pt_diretorio);
+
+        if ((pt_dicionario = fopen(caminho, "rb")) != NULL)
+        {
+            while (sucesso && (fread(&dev_addr, sizeof(dev_addr), 1, pt_dicionario) == 1))
+            {
+                sucesso = insere_dev_addr(pt_arquivo, dev_addr);
+            }
+
+            fclose(pt_dicionario);
+        }
+
+        pt_arquivo->pt_dicionario = fopen(caminho, "ab");
+        sucesso &= (pt_arquivo->pt_dicionario != NULL);
+    }
+
+    if (sucesso == false)
+    {
+        if (pt_arquivo->pt_dicionario != NULL)
+        {
+            fclose(pt_arquivo->pt_dicionario);
+        }
+
+        free(pt_arquivo->pt_dev_addrs);
+        free(pt_arquivo->pt_hash);
+        free(pt_arquivo);
+        return NULL;
+    }
+
+    return pt_arquivo;
+}
+
+/* Função: acrescenta ao arquivo as linhas das tabelas de um lote decodificado
+ * Parâmetros: - ponteiro para o arquivo
+ *             - ponteiro para o resultado do decodificador em lote
+ *             - ponteiro para o instante (s) de cada uplink do lote
+ * Retorno: quantidade de linhas acrescentadas. -1 em caso de falha.
+ */
+int arquivo_colunar_adiciona(TArquivo_colunar * pt_arquivo, const TSaida_lote * pt_saida, const int64_t * pt_instantes_uplinks)
+{
+    const TTabela_lote * pt_tabela_lote;
+    TTabela_escrita * pt_tabela;
+    double valor;
+    int64_t instante;
+    int qtde_linhas = 0;
+    int id_dev_addr;
+    int linha;
+    int i;
+    int j;
+
+    for (i = 0; i < pt_saida->qtde_tabelas; i++)
+    {
+        pt_tabela_lote = &pt_saida->tabelas[i];
+
+        if (pt_tabela_lote->qtde_linhas == 0)
+        {
+            continue;
+        }
+
+        if ((pt_tabela = tabela_escrita(pt_arquivo, pt_tabela_lote)) == NULL)
+        {
+            return -1;
+        }
+
+        for (linha = 0; linha < pt_tabela_lote->qtde_linhas; linha++)
+        {
+            if ((pt_tabela->segmento_aberto == false) && (abre_segmento(pt_tabela) == false))
+            {
+                return -1;
+            }
+
+            if ((id_dev_addr = identificador_dev_addr(pt_arquivo, pt_tabela_lote->pt_dev_addr[linha])) < 0)
+            {
+                return -1;
+            }
+
+            instante = pt_instantes_uplinks[pt_tabela_lote->pt_idx_uplink[linha]];
+            escreve_valor(pt_tabela, ARQUIVO_COLUNAR_COLUNA_DEV_ADDR, pt_tabela_lote->pt_dev_addr[linha], id_dev_addr);
+            escreve_valor(pt_tabela, ARQUIVO_COLUNAR_COLUNA_INSTANTE, (double)instante, instante);
+
+            for (j = 0; j < pt_tabela_lote->qtde_colunas; j++)
+            {
+                valor = pt_tabela_lote->pt_colunas[j][linha];
+                escreve_valor(pt_tabela, 2 + j, valor, isnan(valor) ? 0 : llround(valor / pt_tabela->colunas[2 + j].resolucao));
+            }
+
+            pt_tabela->indice.qtde_linhas++;
+            qtde_linhas++;
+
+            if ((pt_tabela->indice.qtde_linhas == ARQUIVO_COLUNAR_LINHAS_SEGMENTO) && (fecha_segmento(pt_tabela) == false))
+            {
+                return -1;
+            }
+        }
+    }
+
+    return qtde_linhas;
+}
+
+/* Função: fecha o arquivo (fecha os segmentos abertos e grava o dicionário)
+ * Parâmetros: ponteiro para o arquivo
+ * Retorno: 0: sucesso; -1: falha
+ */
+int arquivo_colunar_fecha(TArquivo_colunar * pt_arquivo)
+{
+    bool sucesso = true;
+    int i;
+
+    for (i = 0; i < pt_arquivo->qtde_tabelas; i++)
+    {
+        if (pt_arquivo->tabelas[i].segmento_aberto)
+        {
+            sucesso &= fecha_segmento(&pt_arquivo->tabelas[i]);
+        }
+    }
+
+    sucesso &= (fclose(pt_arquivo->pt_dicionario) == 0);
+    free(pt_arquivo->pt_dev_addrs);
+    free(pt_arquivo->pt_hash);
+    free(pt_arquivo);
+    return sucesso ? 0 : -1;
+}
+
+/* Função: abre uma tabela do arquivo para leitura (colunas, índice dos
+ *         segmentos e dicionário de DevAddr)
+ * Parâmetros: - ponteiro para a leitura
+ *             - diretório do arquivo
+ *             - nome da tabela
+ * Retorno: quantidade de segmentos. -1 se a tabela não existir.
+ */
+int arquivo_colunar_abre_tabela(TLeitura_colunar * pt_leitura, const char * pt_diretorio, const char * pt_tabela)
+{
+    char caminho[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO + 16];
+    struct stat estado;
+    FILE * pt_arquivo;
+    bool sucesso = true;
+
+    memset(pt_leitura, 0x00, sizeof(TLeitura_colunar));
+    snprintf(pt_leitura->caminho_tabela, sizeof(pt_leitura->caminho_tabela), "%s/%s", pt_diretorio, pt_tabela);
+
+    if ((pt_leitura->qtde_colunas = le_colunas(pt_leitura->caminho_tabela, pt_leitura->colunas)) < 0)
+    {
+        return -1;
+    }
+
+    snprintf(caminho, sizeof(caminho), "%s/indice", pt_leitura->caminho_tabela);
+    if ((stat(caminho, &estado) == 0) && (estado.st_size > 0) && ((pt_arquivo = fopen(caminho, "rb")) != NULL))
+    {
+        pt_leitura->qtde_segmentos = (int)(estado.st_size / sizeof(TIndice_segmento));
+        pt_leitura->pt_indices = malloc(pt_leitura->qtde_segmentos * sizeof(TIndice_segmento));
+        sucesso &= (pt_leitura->pt_indices != NULL) &&
+                   (fread(pt_leitura->pt_indices, sizeof(TIndice_segmento), pt_leitura->qtde_segmentos, pt_arquivo) == (size_t)pt_leitura->qtde_segmentos);
+        fclose(pt_arquivo);
+    }
+
+    snprintf(caminho, sizeof(caminho), "%s/dev_addr", pt_diretorio);
+    if ((stat(caminho, &estado) == 0) && (estado.st_size > 0) && ((pt_arquivo = fopen(caminho, "rb")) != NULL))
+    {
+        pt_leitura->qtde_dev_addrs = (int)(estado.st_size / sizeof(uint32_t));
+        pt_leitura->pt_dev_addrs = malloc(pt_leitura->qtde_dev_addrs * sizeof(uint32_t));
+        sucesso &= (pt_leitura->pt_dev_addrs != NULL) &&
+                   (fread(pt_leitura->pt_dev_addrs, sizeof(uint32_t), pt_leitura->qtde_dev_addrs, pt_arquivo) == (size_t)pt_leitura->qtde_dev_addrs);
+        fclose(pt_arquivo);
+    }
+
+    if (sucesso == false)
+    {
+        arquivo_colunar_fecha_tabela(pt_leitura);
+        return -1;
+    }
+
+    return pt_leitura->qtde_segmentos;
+}
+
+/* Função: libera a memória da leitura de uma tabela
+ * Parâmetros: ponteiro para a leitura
+ * Retorno: nenhum
+ */
+void arquivo_colunar_fecha_tabela(TLeitura_colunar * pt_leitura)
+{
+    free(pt_leitura->pt_indices);
+    free(pt_leitura->pt_dev_addrs);
+    pt_leitura->pt_indices = NULL;
+    pt_leitura->pt_dev_addrs = NULL;
+    pt_leitura->qtde_segmentos = 0;
+}
+
+/* Função: índice de uma coluna da tabela pelo nome
+ * Parâmetros: - ponteiro para a leitura
+ *             - nome da coluna
+ * Retorno: índice da coluna. -1 se não existir.
+ */
+int arquivo_colunar_coluna(const TLeitura_colunar * pt_leitura, const char * pt_nome)
+{
+    int i;
+
+    for (i = 0; i < pt_leitura->qtde_colunas; i++)
+    {
+        if (strcmp(pt_leitura->colunas[i].nome, pt_nome) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* Função: verifica, pelo índice, se um segmento pode ter valores de uma
+ *         coluna na faixa [min, max]
+ * Parâmetros: - ponteiro para a leitura
+ *             - segmento
+ *             - coluna
+ *             - faixa procurada
+ * Retorno: true: pode ter (o segmento precisa ser lido); false: não tem
+ */
+bool arquivo_colunar_segmento_na_faixa(const TLeitura_colunar * pt_leitura, int segmento, int coluna, double min, double max)
+{
+    const TIndice_segmento * pt_indice = &pt_leitura->pt_indices[segmento];
+
+    return (pt_indice->max[coluna] >= min) && (pt_indice->min[coluna] <= max);
+}
+
+/* Função: lê (decodifica) uma coluna de um segmento
+ * Parâmetros: - ponteiro para a leitura
+ *             - segmento
+ *             - coluna
+ *             - ponteiro para os valores (ARQUIVO_COLUNAR_LINHAS_SEGMENTO; NAN: sem valor)
+ * Retorno: quantidade de linhas. -1 em caso de falha.
+ */
+int arquivo_colunar_le_coluna(TLeitura_colunar * pt_leitura, int segmento, int coluna, double * pt_valores)
+{
+    char caminho[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO + ARQUIVO_COLUNAR_TAM_MAX_NOME + 16];
+    const double resolucao = pt_leitura->colunas[coluna].resolucao;
+    const double inverso = round(1.0 / resolucao);
+    const bool divide = (resolucao < 1.0) && (fabs((inverso * resolucao) - 1.0) < 1e-12);
+    const uint8_t * pt_mapa;
+    const uint8_t * pt_bytes;
+    const uint8_t * pt_fim;
+    struct stat estado;
+    uint64_t codigo;
+    int64_t anterior = 0;
+    int qtde_linhas = (int)pt_leitura->pt_indices[segmento].qtde_linhas;
+    int descritor;
+    int i;
+
+    snprintf(caminho, sizeof(caminho), "%s/%06u.%s", pt_leitura->caminho_tabela, pt_leitura->pt_indices[segmento].segmento,
+             pt_leitura->colunas[coluna].nome);
+
+    if (((descritor = open(caminho, O_RDONLY)) < 0) || (fstat(descritor, &estado) != 0) || (estado.st_size == 0))
+    {
+        if (descritor >= 0)
+        {
+            close(descritor);
+        }
+        return -1;
+    }
+
+    pt_mapa = mmap(NULL, (size_t)estado.st_size, PROT_READ, MAP_PRIVATE, descritor, 0);
+    close(descritor);
+
+    if (pt_mapa == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    pt_bytes = pt_mapa;
+    pt_fim = pt_mapa + estado.st_size;
+
+    for (i = 0; i < qtde_linhas; i++)
+    {
+        codigo = le_varint(&pt_bytes, pt_fim);
+
+        if (coluna == ARQUIVO_COLUNAR_COLUNA_DEV_ADDR)
+        {
+            pt_valores[i] = (codigo < (uint64_t)pt_leitura->qtde_dev_addrs) ? (double)pt_leitura->pt_dev_addrs[codigo] : NAN;
+        }
+        else if (codigo == CODIGO_SEM_VALOR)
+        {
+            pt_valores[i] = NAN;
+        }
+        else
+        {
+            anterior += desfaz_zig_zag(codigo - 1);
+            /* Resolução 0,1: 219 / 10 dá 21,9 (o double mais próximo), 219 * 0,1 não */
+            pt_valores[i] = divide ? (anterior / inverso) : (anterior * resolucao);
+        }
+    }
+
+    pt_leitura->bytes_lidos += (uint64_t)estado.st_size;
+    munmap((void *)pt_mapa, (size_t)estado.st_size);
+    return qtde_linhas;
+}
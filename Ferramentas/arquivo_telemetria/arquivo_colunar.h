@@ -0,0 +1,92 @@
+/* Header file: arquivo colunar da telemetria decodificada (computador)
+ *
+ * Guarda as tabelas do decodificador em lote (ingestao_uplinks) em
+ * segmentos colunares: cada segmento tem até ARQUIVO_COLUNAR_LINHAS_SEGMENTO
+ * linhas de uma tabela, e cada coluna do segmento é um arquivo próprio,
+ * escrito por mmap à medida que as linhas chegam. Uma consulta lê só as
+ * colunas de que precisa, e só dos segmentos cuja faixa (índice) pode
+ * conter o que ela procura.
+ *
+ * Codificação das colunas (varint LEB128: 7 bits por byte, bit 7 = continua):
+ * - dev_addr: identificador do DevAddr no dicionário do arquivo
+ *   (0, 1, 2, ... na ordem em que os dispositivos aparecem);
+ * - instante (s) e colunas da tabela: valor em passos da resolução da
+ *   coluna (escala do esquema), como diferença para o valor anterior da
+ *   coluna no segmento, em zig-zag, mais 1 (0: sem valor).
+ * Séries de contadores, instantes e temperaturas variam pouco entre linhas
+ * vizinhas, e a maioria das diferenças cabe em 1 ou 2 bytes.
+ *
+ * Estrutura do diretório do arquivo:
+ *   dev_addr                       dicionário: DevAddr (uint32) de cada identificador
+ *   <tabela>/colunas               nome, unidade e resolução de cada coluna (texto)
+ *   <tabela>/indice                TIndice_segmento de cada segmento fechado
+ *   <tabela>/<segmento>.<coluna>   dados de uma coluna de um segmento
+ * Um arquivo existente pode ser reaberto: as novas linhas vão para novos
+ * segmentos.
+ */
+
+#ifndef HEADER_ARQUIVO_COLUNAR
+#define HEADER_ARQUIVO_COLUNAR
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "decodificador_lote.h"
+
+/* Definições - formato */
+#define ARQUIVO_COLUNAR_LINHAS_SEGMENTO     65536
+#define ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS    (2 + DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS)
+#define ARQUIVO_COLUNAR_QTDE_MAX_TABELAS    8
+#define ARQUIVO_COLUNAR_TAM_MAX_NOME        48
+#define ARQUIVO_COLUNAR_TAM_MAX_CAMINHO     512
+
+/* Definições - colunas presentes em todas as tabelas */
+#define ARQUIVO_COLUNAR_COLUNA_DEV_ADDR     0
+#define ARQUIVO_COLUNAR_COLUNA_INSTANTE     1
+
+/* Coluna de uma tabela do arquivo */
+typedef struct
+{
+    char nome[ARQUIVO_COLUNAR_TAM_MAX_NOME];
+    char unidade[ARQUIVO_COLUNAR_TAM_MAX_NOME];
+    double resolucao;
+}TColuna_arquivo;
+
+/* Índice de um segmento: faixa de valores de cada coluna (sem contar os
+ * "sem valor"; min > max se a coluna só tem "sem valor") */
+typedef struct
+{
+    uint32_t segmento;
+    uint32_t qtde_linhas;
+    double min[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    double max[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+}TIndice_segmento;
+
+/* Escritor (estado interno em arquivo_colunar.c) */
+typedef struct TArquivo_colunar TArquivo_colunar;
+
+/* Leitura de uma tabela do arquivo */
+typedef struct
+{
+    char caminho_tabela[ARQUIVO_COLUNAR_TAM_MAX_CAMINHO];
+    int qtde_colunas;
+    TColuna_arquivo colunas[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    int qtde_segmentos;
+    TIndice_segmento * pt_indices;
+    int qtde_dev_addrs;
+    uint32_t * pt_dev_addrs;            // DevAddr de cada identificador do dicionário
+    uint64_t bytes_lidos;               // bytes de colunas lidos desde a abertura
+}TLeitura_colunar;
+
+#endif
+
+/* Protótipos - escrita */
+TArquivo_colunar * arquivo_colunar_abre(const char * pt_diretorio);
+int arquivo_colunar_adiciona(TArquivo_colunar * pt_arquivo, const TSaida_lote * pt_saida, const int64_t * pt_instantes_uplinks);
+int arquivo_colunar_fecha(TArquivo_colunar * pt_arquivo);
+
+/* Protótipos - leitura */
+int arquivo_colunar_abre_tabela(TLeitura_colunar * pt_leitura, const char * pt_diretorio, const char * pt_tabela);
+void arquivo_colunar_fecha_tabela(TLeitura_colunar * pt_leitura);
+int arquivo_colunar_coluna(const TLeitura_colunar * pt_leitura, const char * pt_nome);
+bool arquivo_colunar_segmento_na_faixa(const TLeitura_colunar * pt_leitura, int segmento, int coluna, double min, double max);
+int arquivo_colunar_le_coluna(TLeitura_colunar * pt_leitura, int segmento, int coluna, double * pt_valores);
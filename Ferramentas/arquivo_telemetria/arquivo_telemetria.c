@@ -0,0 +1,1223 @@
+/* Ferramenta: arquivo colunar da telemetria de uma frota simulada
+ *
+ * Gera uplinks de uma frota de dispositivos dos capítulos 6 (contador de
+ * pulsos), 7 (lixeira) e 8 (temperatura), decodifica-os com o decodificador
+ * em lote (ingestao_uplinks) e grava as tabelas no arquivo colunar
+ * (arquivo_colunar.c). Para comparação, grava as mesmas linhas em JSON, uma
+ * linha por registro. Mede a vazão de gravação, o tamanho por linha e a
+ * vazão de duas consultas, no arquivo colunar (com e sem o índice dos
+ * segmentos) e no JSON:
+ * - Q1: lixeiras quase cheias (distância <= 30 cm, 80% de uma lixeira de
+ *       150 cm) nas últimas 24 horas: linhas e dispositivos;
+ * - Q2: pulsos do contador 1 por hora, somados na frota (diferença entre
+ *       leituras consecutivas de cada dispositivo).
+ *
+ * Uso: arquivo_telemetria [-d dispositivos por aplicação] [-n dias] [-o diretório]
+ *      arquivo_telemetria -t
+ * Sem -o, o arquivo é gravado em um diretório temporário, apagado no fim.
+ * Retorno: 0 em caso de sucesso (-t: todos os testes passaram), 1 caso contrário
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include "arquivo_colunar.h"
+#include "decodificador_lote.h"
+#include "texto_binario.h"
+#include "Cap6/contador_pulsos_lorawan/main/payloads/payloads.h"
+#include "Cap7/Software/lixo_lorawan/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/serie_temperaturas/serie_temperaturas.h"
+
+/* Definições - frota */
+#define QTDE_DISPOSITIVOS_PADRAO    500
+#define QTDE_DIAS_PADRAO            7
+#define PERIODO_CAP6_S              900
+#define PERIODO_CAP7_S              3600
+#define PERIODO_CAP8_S              900
+#define LEITURAS_POR_LOTE_CAP7      4
+#define INTERVALO_LEITURAS_CAP7_MIN 15
+#define ALTURA_LIXEIRA_CM           150.0
+#define AMOSTRAS_JANELA_CAP8        15
+#define TAM_MAX_SERIE_CAP8          51      // payload máximo do DR3
+#define PERCENTUAL_SERIES_CAP8      15
+#define PORTA_SERIE_TEMPERATURAS    13      // main.c do capítulo 8
+
+/* Definições - lotes e threads do decodificador */
+#define TAM_LOTE_UPLINKS            65536
+#define TAM_MAX_TEXTO               ((2 * DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD) + 1)
+#define QTDE_THREADS_DECODIFICADOR  2
+
+/* Definições - consultas */
+#define DISTANCIA_QUASE_CHEIA_CM    (0.2 * ALTURA_LIXEIRA_CM)
+#define JANELA_Q1_S                 86400
+#define QTDE_MAX_HORAS              (24 * 366)
+
+/* Definições - testes */
+#define QTDE_DISPOSITIVOS_TESTE     400
+#define QTDE_DIAS_TESTE             2
+
+/* Dispositivo simulado */
+typedef struct
+{
+    uint32_t dev_addr;
+    int64_t fase_s;
+    double taxa;            // cap6: pulsos por período; cap7: enchimento (cm/h); cap8: temperatura média (C)
+    double estado;          // cap6: contador 1; cap7: distância (cm); cap8: fase diária (rad)
+    double limite;          // cap7: distância em que a lixeira é esvaziada
+    uint32_t contador_2;
+    int seq;
+}TDispositivo;
+
+/* Frota de uma aplicação */
+typedef struct
+{
+    TAplicacao_lote aplicacao;
+    int qtde_dispositivos;
+    TDispositivo * pt_dispositivos;     // em ordem de fase
+    int64_t periodo_s;
+    int64_t proximo_periodo;
+}TFrota;
+
+/* Linhas de uma tabela em memória (referência dos testes e JSON) */
+typedef struct
+{
+    char nome[ARQUIVO_COLUNAR_TAM_MAX_NOME];
+    int qtde_colunas;                   // dev_addr, instante e as colunas da tabela
+    const char * pt_nomes_colunas[ARQUIVO_COLUNAR_QTDE_MAX_COLUNAS];
+    long qtde_linhas;
+    long capacidade_linhas;
+    double * pt_valores;                // qtde_colunas valores por linha (só com referência)
+    char * pt_json;
+    size_t tam_json;
+    size_t capacidade_json;
+}TTabela_memoria;
+
+/* Destino dos lotes decodificados */
+typedef struct
+{
+    TDecodificador_lote * pt_decodificadores[QTDE_APLICACOES_LOTE];
+    TSaida_lote saida;
+    TArquivo_colunar * pt_arquivo;
+    bool guarda_referencia;
+    bool guarda_json;
+    int qtde_tabelas_memoria;
+    TTabela_memoria tabelas_memoria[ARQUIVO_COLUNAR_QTDE_MAX_TABELAS];
+
+    /* Lote em montagem */
+    int qtde_uplinks;
+    TUplink_texto * pt_uplinks;
+    int64_t * pt_instantes;
+    char * pt_textos;
+
+    /* Medições */
+    long qtde_linhas;
+    double tempo_decodificacao_s;
+    double tempo_arquivo_s;
+    double tempo_json_s;
+}TDestino;
+
+/* Resultado das consultas */
+typedef struct
+{
+    long linhas_q1;
+    int dispositivos_q1;
+    double pulsos_por_hora[QTDE_MAX_HORAS];
+    long linhas_lidas;
+    uint64_t bytes_lidos;
+    int segmentos_lidos;
+    int segmentos_total;
+}TResultado_consultas;
+
+/* Função: gera número aleatório uniforme em [min, max]
+ * Parâmetros: valores mínimo e máximo
+ * Retorno: número gerado
+ */
+static double aleatorio(double min, double max)
+{
+    return min + ((double)rand() / (double)RAND_MAX) * (max - min);
+}
+
+/* Função: lê o relógio monotônico
+ * Parâmetros: nenhum
+ * Retorno: instante em segundos
+ */
+static double instante_s(void)
+{
+    struct timespec agora;
+
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return agora.tv_sec + (agora.tv_nsec / 1e9);
+}
+
+/* Função: compara as fases de dois dispositivos (qsort)
+ * Parâmetros: ponteiros para os dispositivos
+ * Retorno: <0, 0 ou >0
+ */
+static int compara_fases(const void * pt_a, const void * pt_b)
+{
+    const TDispositivo * pt_dispositivo_a = (const TDispositivo *)pt_a;
+    const TDispositivo * pt_dispositivo_b = (const TDispositivo *)pt_b;
+
+    return (pt_dispositivo_a->fase_s > pt_dispositivo_b->fase_s) - (pt_dispositivo_a->fase_s < pt_dispositivo_b->fase_s);
+}
+
+/* Função: compara dois valores (qsort)
+ * Parâmetros: ponteiros para os valores
+ * Retorno: <0, 0 ou >0
+ */
+static int compara_valores(const void * pt_a, const void * pt_b)
+{
+    double a = *(const double *)pt_a;
+    double b = *(const double *)pt_b;
+
+    return (a > b) - (a < b);
+}
+
+/* Função: cria a frota simulada de uma aplicação
+ * Parâmetros: - ponteiro para a frota
+ *             - aplicação
+ *             - quantidade de dispositivos
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool cria_frota(TFrota * pt_frota, TAplicacao_lote aplicacao, int qtde_dispositivos)
+{
+    static const int64_t periodos_s[QTDE_APLICACOES_LOTE] = { PERIODO_CAP6_S, PERIODO_CAP7_S, PERIODO_CAP8_S };
+    TDispositivo * pt_dispositivo;
+    int i;
+
+    pt_frota->aplicacao = aplicacao;
+    pt_frota->qtde_dispositivos = qtde_dispositivos;
+    pt_frota->periodo_s = periodos_s[aplicacao];
+    pt_frota->proximo_periodo = 0;
+
+    if ((pt_frota->pt_dispositivos = calloc(qtde_dispositivos, sizeof(TDispositivo))) == NULL)
+    {
+        return false;
+    }
+
+    for (i = 0; i < qtde_dispositivos; i++)
+    {
+        pt_dispositivo = &pt_frota->pt_dispositivos[i];
+        pt_dispositivo->dev_addr = 0x26000000U + ((uint32_t)aplicacao << 16) + (uint32_t)i;
+        pt_dispositivo->fase_s = rand() % pt_frota->periodo_s;
+
+        switch (aplicacao)
+        {
+            case APLICACAO_CAP6:
+                pt_dispositivo->taxa = aleatorio(5.0, 500.0);
+                pt_dispositivo->estado = rand() % 100000;
+                break;
+
+            case APLICACAO_CAP7:
+                pt_dispositivo->taxa = aleatorio(0.5, 6.0);
+                pt_dispositivo->estado = aleatorio(20.0, ALTURA_LIXEIRA_CM);
+                pt_dispositivo->limite = aleatorio(10.0, 25.0);
+                break;
+
+            default:
+                pt_dispositivo->taxa = aleatorio(-5.0, 30.0);
+                pt_dispositivo->estado = aleatorio(0.0, 2.0 * M_PI);
+                break;
+        }
+    }
+
+    qsort(pt_frota->pt_dispositivos, qtde_dispositivos, sizeof(TDispositivo), compara_fases);
+    return true;
+}
+
+/* Função: gera o payload do próximo uplink de um dispositivo
+ * Parâmetros: - ponteiro para a frota
+ *             - ponteiro para o dispositivo
+ *             - instante do uplink (s)
+ *             - ponteiro para a porta
+ *             - ponteiro para os bytes
+ * Retorno: quantidade de bytes
+ */
+static int gera_payload(const TFrota * pt_frota, TDispositivo * pt_dispositivo, int64_t instante, uint8_t * pt_porta, uint8_t * pt_bytes)
+{
+    TPayload_contadores contadores;
+    TPayload_lote_leituras cabecalho;
+    TPayload_leitura_lote leitura;
+    TPayload_resumo_temperaturas resumo;
+    int16_t amostras_x10[AMOSTRAS_JANELA_CAP8];
+    double soma = 0.0;
+    double soma_quadrados = 0.0;
+    double pulsos;
+    int passo;
+    int i;
+
+    switch (pt_frota->aplicacao)
+    {
+        case APLICACAO_CAP6:
+            /* Consumo com ciclo diário */
+            pulsos = pt_dispositivo->taxa * (1.0 + (0.8 * sin((2.0 * M_PI * instante) / 86400.0))) * aleatorio(0.7, 1.3);
+            pt_dispositivo->estado += floor(pulsos);
+            pt_dispositivo->contador_2 += (uint32_t)(pulsos / 10.0);
+            contadores.contador_1 = (uint32_t)pt_dispositivo->estado;
+            contadores.contador_2 = pt_dispositivo->contador_2;
+            payload_contadores_empacota(&contadores, pt_bytes);
+            *pt_porta = PAYLOAD_CONTADORES_PORTA;
+            return PAYLOAD_CONTADORES_TAM;
+
+        case APLICACAO_CAP7:
+            cabecalho.seq = pt_dispositivo->seq++ % 256;
+            cabecalho.idade = 0.0f;
+            payload_lote_leituras_empacota(&cabecalho, pt_bytes);
+
+            for (i = 0; i < LEITURAS_POR_LOTE_CAP7; i++)
+            {
+                pt_dispositivo->estado -= pt_dispositivo->taxa * (INTERVALO_LEITURAS_CAP7_MIN / 60.0);
+                if (pt_dispositivo->estado <= pt_dispositivo->limite)
+                {
+                    pt_dispositivo->estado = aleatorio(140.0, ALTURA_LIXEIRA_CM);
+                }
+
+                leitura.distancia_cm = ((rand() % 50) == 0) ? ESQUEMA_PAYLOADS_SEM_VALOR : (int32_t)lround(pt_dispositivo->estado);
+                leitura.motivo = 0;
+                leitura.intervalo = (float)((i == 0) ? 0 : INTERVALO_LEITURAS_CAP7_MIN);
+                payload_leitura_lote_empacota(&leitura, &pt_bytes[PAYLOAD_LOTE_LEITURAS_TAM + (i * PAYLOAD_LEITURA_LOTE_TAM)]);
+            }
+
+            *pt_porta = PAYLOAD_LOTE_LEITURAS_PORTA;
+            return PAYLOAD_LOTE_LEITURAS_TAM + (LEITURAS_POR_LOTE_CAP7 * PAYLOAD_LEITURA_LOTE_TAM);
+
+        default:
+            /* Janela de 15 leituras (1 por minuto) com ciclo diário */
+            for (i = 0; i < AMOSTRAS_JANELA_CAP8; i++)
+            {
+                amostras_x10[i] = (int16_t)lround(10.0 * (pt_dispositivo->taxa + (6.0 * sin(((2.0 * M_PI * (instante + (60 * i))) / 86400.0) + pt_dispositivo->estado)) +
+                                                           aleatorio(-0.1, 0.1)));
+                soma += amostras_x10[i] / 10.0;
+                soma_quadrados += (amostras_x10[i] / 10.0) * (amostras_x10[i] / 10.0);
+            }
+
+            if ((rand() % 100) < PERCENTUAL_SERIES_CAP8)
+            {
+                *pt_porta = PORTA_SERIE_TEMPERATURAS;
+                return serie_temperaturas_codifica(amostras_x10, AMOSTRAS_JANELA_CAP8, pt_bytes, TAM_MAX_SERIE_CAP8, &passo);
+            }
+
+            resumo.media = (float)(soma / AMOSTRAS_JANELA_CAP8);
+            resumo.minima = resumo.maxima = amostras_x10[0] / 10.0f;
+            for (i = 1; i < AMOSTRAS_JANELA_CAP8; i++)
+            {
+                resumo.minima = fminf(resumo.minima, amostras_x10[i] / 10.0f);
+                resumo.maxima = fmaxf(resumo.maxima, amostras_x10[i] / 10.0f);
+            }
+            resumo.desvio_padrao = (float)sqrt(fmax(0.0, (soma_quadrados / AMOSTRAS_JANELA_CAP8) - (resumo.media * resumo.media)));
+            payload_resumo_temperaturas_empacota(&resumo, pt_bytes);
+            *pt_porta = PAYLOAD_RESUMO_TEMPERATURAS_PORTA;
+            return PAYLOAD_RESUMO_TEMPERATURAS_TAM;
+    }
+}
+
+/* Função: tabela em memória com o nome de uma tabela do decodificador (cria, se necessário)
+ * Parâmetros: - ponteiro para o destino
+ *             - ponteiro para a tabela do decodificador
+ * Retorno: ponteiro para a tabela em memória. NULL se não houver espaço.
+ */
+static TTabela_memoria * tabela_memoria(TDestino * pt_destino, const TTabela_lote * pt_tabela_lote)
+{
+    TTabela_memoria * pt_tabela;
+    int i;
+
+    for (i = 0; i < pt_destino->qtde_tabelas_memoria; i++)
+    {
+        if (strcmp(pt_destino->tabelas_memoria[i].nome, pt_tabela_lote->pt_nome) == 0)
+        {
+            return &pt_destino->tabelas_memoria[i];
+        }
+    }
+
+    if (pt_destino->qtde_tabelas_memoria >= ARQUIVO_COLUNAR_QTDE_MAX_TABELAS)
+    {
+        return NULL;
+    }
+
+    pt_tabela = &pt_destino->tabelas_memoria[pt_destino->qtde_tabelas_memoria++];
+    memset(pt_tabela, 0x00, sizeof(TTabela_memoria));
+    snprintf(pt_tabela->nome, sizeof(pt_tabela->nome), "%s", pt_tabela_lote->pt_nome);
+    pt_tabela->qtde_colunas = 2 + pt_tabela_lote->qtde_colunas;
+    pt_tabela->pt_nomes_colunas[0] = "dev_addr";
+    pt_tabela->pt_nomes_colunas[1] = "instante";
+
+    for (i = 0; i < pt_tabela_lote->qtde_colunas; i++)
+    {
+        pt_tabela->pt_nomes_colunas[2 + i] = pt_tabela_lote->pt_nomes_colunas[i];
+    }
+
+    return pt_tabela;
+}
+
+/* Função: guarda as linhas de um lote decodificado em memória (referência
+ *         dos testes) e/ou em JSON (uma linha por registro)
+ * Parâmetros: - ponteiro para o destino
+ *             - ponteiro para o resultado do decodificador
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool guarda_linhas_memoria(TDestino * pt_destino, const TSaida_lote * pt_saida)
+{
+    const TTabela_lote * pt_tabela_lote;
+    TTabela_memoria * pt_tabela;
+    double * pt_linha;
+    void * pt_novo;
+    int64_t instante;
+    long linha;
+    int i;
+    int j;
+
+    for (i = 0; i < pt_saida->qtde_tabelas; i++)
+    {
+        pt_tabela_lote = &pt_saida->tabelas[i];
+
+        if ((pt_tabela_lote->qtde_linhas == 0) || ((pt_tabela = tabela_memoria(pt_destino, pt_tabela_lote)) == NULL))
+        {
+            continue;
+        }
+
+        for (linha = 0; linha < pt_tabela_lote->qtde_linhas; linha++)
+        {
+            instante = pt_destino->pt_instantes[pt_tabela_lote->pt_idx_uplink[linha]];
+
+            if (pt_destino->guarda_referencia)
+            {
+                if (pt_tabela->qtde_linhas == pt_tabela->capacidade_linhas)
+                {
+                    pt_tabela->capacidade_linhas = (pt_tabela->capacidade_linhas > 0) ? (2 * pt_tabela->capacidade_linhas) : 65536;
+                    if ((pt_novo = realloc(pt_tabela->pt_valores, pt_tabela->capacidade_linhas * pt_tabela->qtde_colunas * sizeof(double))) == NULL)
+                    {
+                        return false;
+                    }
+                    pt_tabela->pt_valores = pt_novo;
+                }
+
+                pt_linha = &pt_tabela->pt_valores[pt_tabela->qtde_linhas * pt_tabela->qtde_colunas];
+                pt_linha[0] = pt_tabela_lote->pt_dev_addr[linha];
+                pt_linha[1] = (double)instante;
+                for (j = 0; j < pt_tabela_lote->qtde_colunas; j++)
+                {
+                    pt_linha[2 + j] = pt_tabela_lote->pt_colunas[j][linha];
+                }
+            }
+
+            if (pt_destino->guarda_json)
+            {
+                if ((pt_tabela->capacidade_json - pt_tabela->tam_json) < 1024)
+                {
+                    pt_tabela->capacidade_json = (pt_tabela->capacidade_json > 0) ? (2 * pt_tabela->capacidade_json) : (1 << 20);
+                    if ((pt_novo = realloc(pt_tabela->pt_json, pt_tabela->capacidade_json)) == NULL)
+                    {
+                        return false;
+                    }
+                    pt_tabela->pt_json = pt_novo;
+                }
+
+                pt_tabela->tam_json += sprintf(&pt_tabela->pt_json[pt_tabela->tam_json], "{\"dev_addr\":\"%08X\",\"instante\":%lld",
+                                               pt_tabela_lote->pt_dev_addr[linha], (long long)instante);
+                for (j = 0; j < pt_tabela_lote->qtde_colunas; j++)
+                {
+                    pt_tabela->tam_json += sprintf(&pt_tabela->pt_json[pt_tabela->tam_json], isnan(pt_tabela_lote->pt_colunas[j][linha]) ? ",\"%s\":null" : ",\"%s\":%.10g",
+                                                   pt_tabela_lote->pt_nomes_colunas[j], pt_tabela_lote->pt_colunas[j][linha]);
+                }
+                pt_tabela->tam_json += sprintf(&pt_tabela->pt_json[pt_tabela->tam_json], "}\n");
+            }
+
+            pt_tabela->qtde_linhas++;
+        }
+    }
+
+    return true;
+}
+
+/* Função: decodifica o lote em montagem e grava as linhas no arquivo (e em memória)
+ * Parâmetros: - ponteiro para o destino
+ *             - aplicação
+ * Retorno: true: sucesso; false: falha
+ */
+static bool grava_lote(TDestino * pt_destino, TAplicacao_lote aplicacao)
+{
+    double inicio;
+    int qtde_linhas;
+
+    if (pt_destino->qtde_uplinks == 0)
+    {
+        return true;
+    }
+
+    inicio = instante_s();
+    if (decodificador_lote_decodifica(pt_destino->pt_decodificadores[aplicacao], pt_destino->pt_uplinks, pt_destino->qtde_uplinks, &pt_destino->saida) < 0)
+    {
+        return false;
+    }
+    pt_destino->tempo_decodificacao_s += instante_s() - inicio;
+
+    inicio = instante_s();
+    if ((qtde_linhas = arquivo_colunar_adiciona(pt_destino->pt_arquivo, &pt_destino->saida, pt_destino->pt_instantes)) < 0)
+    {
+        return false;
+    }
+    pt_destino->tempo_arquivo_s += instante_s() - inicio;
+    pt_destino->qtde_linhas += qtde_linhas;
+
+    inicio = instante_s();
+    if ((pt_destino->guarda_referencia || pt_destino->guarda_json) && (guarda_linhas_memoria(pt_destino, &pt_destino->saida) == false))
+    {
+        return false;
+    }
+    pt_destino->tempo_json_s += instante_s() - inicio;
+
+    pt_destino->qtde_uplinks = 0;
+    return true;
+}
+
+/* Função: simula os uplinks da frota em um intervalo de tempo e os grava
+ * Parâmetros: - ponteiro para a frota
+ *             - ponteiro para o destino
+ *             - fim do intervalo (s; o início é o fim da chamada anterior)
+ * Retorno: true: sucesso; false: falha
+ */
+static bool simula_frota(TFrota * pt_frota, TDestino * pt_destino, int64_t fim_s)
+{
+    static const char digitos_hex[] = "0123456789ABCDEF";
+    uint8_t bytes[DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD];
+    TUplink_texto * pt_uplink;
+    TDispositivo * pt_dispositivo;
+    char * pt_texto;
+    int64_t instante;
+    int qtde_bytes;
+    int i;
+    int j;
+
+    for (; (pt_frota->proximo_periodo * pt_frota->periodo_s) < fim_s; pt_frota->proximo_periodo++)
+    {
+        for (i = 0; i < pt_frota->qtde_dispositivos; i++)
+        {
+            pt_dispositivo = &pt_frota->pt_dispositivos[i];
+            instante = (pt_frota->proximo_periodo * pt_frota->periodo_s) + pt_dispositivo->fase_s;
+            pt_uplink = &pt_destino->pt_uplinks[pt_destino->qtde_uplinks];
+            pt_texto = &pt_destino->pt_textos[(size_t)pt_destino->qtde_uplinks * TAM_MAX_TEXTO];
+
+            qtde_bytes = gera_payload(pt_frota, pt_dispositivo, instante, &pt_uplink->porta, bytes);
+            for (j = 0; j < qtde_bytes; j++)
+            {
+                pt_texto[2 * j] = digitos_hex[bytes[j] >> 4];
+                pt_texto[(2 * j) + 1] = digitos_hex[bytes[j] & 0x0F];
+            }
+
+            pt_uplink->dev_addr = pt_dispositivo->dev_addr;
+            pt_uplink->codificacao = TEXTO_HEX;
+            pt_uplink->tam_texto = (uint16_t)(2 * qtde_bytes);
+            pt_uplink->pt_texto = pt_texto;
+            pt_destino->pt_instantes[pt_destino->qtde_uplinks] = instante;
+            pt_destino->qtde_uplinks++;
+
+            if ((pt_destino->qtde_uplinks == TAM_LOTE_UPLINKS) && (grava_lote(pt_destino, pt_frota->aplicacao) == false))
+            {
+                return false;
+            }
+        }
+    }
+
+    return grava_lote(pt_destino, pt_frota->aplicacao);
+}
+
+/* Função: prepara o destino dos lotes (decodificadores, lote em montagem, arquivo)
+ * Parâmetros: - ponteiro para o destino
+ *             - diretório do arquivo colunar
+ *             - guarda as linhas em memória (referência dos testes)
+ *             - guarda as linhas em JSON
+ * Retorno: true: sucesso; false: falha
+ */
+static bool prepara_destino(TDestino * pt_destino, const char * pt_diretorio, bool guarda_referencia, bool guarda_json)
+{
+    int i;
+
+    memset(pt_destino, 0x00, sizeof(TDestino));
+    pt_destino->guarda_referencia = guarda_referencia;
+    pt_destino->guarda_json = guarda_json;
+    decodificador_lote_inicia_saida(&pt_destino->saida);
+
+    for (i = 0; i < QTDE_APLICACOES_LOTE; i++)
+    {
+        if ((pt_destino->pt_decodificadores[i] = decodificador_lote_cria((TAplicacao_lote)i, QTDE_THREADS_DECODIFICADOR)) == NULL)
+        {
+            return false;
+        }
+    }
+
+    pt_destino->pt_uplinks = malloc(TAM_LOTE_UPLINKS * sizeof(TUplink_texto));
+    pt_destino->pt_instantes = malloc(TAM_LOTE_UPLINKS * sizeof(int64_t));
+    pt_destino->pt_textos = malloc((size_t)TAM_LOTE_UPLINKS * TAM_MAX_TEXTO);
+    pt_destino->pt_arquivo = arquivo_colunar_abre(pt_diretorio);
+
+    return (pt_destino->pt_uplinks != NULL) && (pt_destino->pt_instantes != NULL) && (pt_destino->pt_textos != NULL) && (pt_destino->pt_arquivo != NULL);
+}
+
+/* Função: libera o destino dos lotes (fecha o arquivo colunar, se aberto)
+ * Parâmetros: ponteiro para o destino
+ * Retorno: true: sucesso; false: falha ao fechar o arquivo
+ */
+static bool libera_destino(TDestino * pt_destino)
+{
+    bool sucesso = (pt_destino->pt_arquivo == NULL) || (arquivo_colunar_fecha(pt_destino->pt_arquivo) == 0);
+    int i;
+
+    for (i = 0; i < QTDE_APLICACOES_LOTE; i++)
+    {
+        decodificador_lote_destroi(pt_destino->pt_decodificadores[i]);
+    }
+
+    for (i = 0; i < pt_destino->qtde_tabelas_memoria; i++)
+    {
+        free(pt_destino->tabelas_memoria[i].pt_valores);
+        free(pt_destino->tabelas_memoria[i].pt_json);
+    }
+
+    decodificador_lote_libera_saida(&pt_destino->saida);
+    free(pt_destino->pt_uplinks);
+    free(pt_destino->pt_instantes);
+    free(pt_destino->pt_textos);
+    pt_destino->pt_arquivo = NULL;
+    return sucesso;
+}
+
+/* Função: posição de um DevAddr em uma tabela hash de dispositivos (a dele
+ *         ou a livre onde entraria); posições livres têm DevAddr 0
+ * Parâmetros: - tabela hash (DevAddr de cada posição)
+ *             - tamanho da tabela (potência de 2)
+ *             - DevAddr
+ * Retorno: posição
+ */
+static int posicao_dispositivo(const uint32_t * pt_dev_addrs, int tam_tabela, uint32_t dev_addr)
+{
+    int posicao = (int)((dev_addr * 2654435761U) & (uint32_t)(tam_tabela - 1));
+
+    while ((pt_dev_addrs[posicao] != 0) && (pt_dev_addrs[posicao] != dev_addr))
+    {
+        posicao = (posicao + 1) & (tam_tabela - 1);
+    }
+
+    return posicao;
+}
+
+/* Estado da Q2 por dispositivo: última leitura do contador */
+typedef struct
+{
+    int tam_tabela;
+    uint32_t * pt_dev_addrs;
+    double * pt_instantes;
+    double * pt_contadores;
+}TEstado_q2;
+
+/* Função: registra uma leitura do contador na Q2 (pulsos desde a leitura
+ *         anterior do dispositivo, na hora da leitura)
+ * Parâmetros: - ponteiro para o estado
+ *             - ponteiro para o resultado
+ *             - DevAddr, instante (s) e contador
+ * Retorno: nenhum
+ */
+static void registra_q2(TEstado_q2 * pt_estado, TResultado_consultas * pt_resultado, uint32_t dev_addr, double instante, double contador)
+{
+    int posicao = posicao_dispositivo(pt_estado->pt_dev_addrs, pt_estado->tam_tabela, dev_addr);
+    long hora = (long)(instante / 3600.0);
+
+    if ((pt_estado->pt_dev_addrs[posicao] == dev_addr) && (hora < QTDE_MAX_HORAS) && (instante > pt_estado->pt_instantes[posicao]))
+    {
+        pt_resultado->pulsos_por_hora[hora] += contador - pt_estado->pt_contadores[posicao];
+    }
+
+    pt_estado->pt_dev_addrs[posicao] = dev_addr;
+    pt_estado->pt_instantes[posicao] = instante;
+    pt_estado->pt_contadores[posicao] = contador;
+}
+
+/* Função: cria o estado da Q2
+ * Parâmetros: - ponteiro para o estado
+ *             - quantidade máxima de dispositivos
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool cria_estado_q2(TEstado_q2 * pt_estado, int qtde_dispositivos)
+{
+    for (pt_estado->tam_tabela = 1024; pt_estado->tam_tabela < (2 * qtde_dispositivos); pt_estado->tam_tabela *= 2)
+    {
+    }
+
+    pt_estado->pt_dev_addrs = calloc(pt_estado->tam_tabela, sizeof(uint32_t));
+    pt_estado->pt_instantes = calloc(pt_estado->tam_tabela, sizeof(double));
+    pt_estado->pt_contadores = calloc(pt_estado->tam_tabela, sizeof(double));
+    return (pt_estado->pt_dev_addrs != NULL) && (pt_estado->pt_instantes != NULL) && (pt_estado->pt_contadores != NULL);
+}
+
+/* Função: libera o estado da Q2
+ * Parâmetros: ponteiro para o estado
+ * Retorno: nenhum
+ */
+static void libera_estado_q2(TEstado_q2 * pt_estado)
+{
+    free(pt_estado->pt_dev_addrs);
+    free(pt_estado->pt_instantes);
+    free(pt_estado->pt_contadores);
+}
+
+/* Função: conta os dispositivos distintos de uma lista de DevAddr (ordena a lista)
+ * Parâmetros: - ponteiro para os DevAddr
+ *             - quantidade
+ * Retorno: quantidade de dispositivos distintos
+ */
+static int conta_distintos(double * pt_dev_addrs, long qtde)
+{
+    int distintos = 0;
+    long i;
+
+    qsort(pt_dev_addrs, qtde, sizeof(double), compara_valores);
+    for (i = 0; i < qtde; i++)
+    {
+        distintos += (i == 0) || (pt_dev_addrs[i] != pt_dev_addrs[i - 1]);
+    }
+
+    return distintos;
+}
+
+/* Função: executa Q1 e Q2 no arquivo colunar
+ * Parâmetros: - diretório do arquivo
+ *             - fim do período simulado (s)
+ *             - true: usa o índice dos segmentos para pular segmentos
+ *             - ponteiro para o resultado
+ * Retorno: true: sucesso; false: falha
+ */
+static bool consulta_colunar(const char * pt_diretorio, int64_t fim_s, bool usa_indice, TResultado_consultas * pt_resultado)
+{
+    static double dev_addrs[ARQUIVO_COLUNAR_LINHAS_SEGMENTO];
+    static double instantes[ARQUIVO_COLUNAR_LINHAS_SEGMENTO];
+    static double valores[ARQUIVO_COLUNAR_LINHAS_SEGMENTO];
+    TLeitura_colunar leitura;
+    TEstado_q2 estado_q2;
+    double * pt_encontrados = NULL;
+    long qtde_encontrados = 0;
+    int coluna_distancia;
+    int coluna_contador;
+    int qtde_linhas;
+    int segmento;
+    bool sucesso = true;
+    bool leu_dev_addrs;
+    int i;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_consultas));
+
+    /* Q1: lixeiras quase cheias nas últimas 24 h (colunas instante, distancia_cm e, nos segmentos com linhas encontradas, dev_addr) */
+    if (arquivo_colunar_abre_tabela(&leitura, pt_diretorio, "lote_leituras") < 0)
+    {
+        return false;
+    }
+
+    coluna_distancia = arquivo_colunar_coluna(&leitura, "distancia_cm");
+    pt_encontrados = malloc((size_t)leitura.qtde_segmentos * ARQUIVO_COLUNAR_LINHAS_SEGMENTO * sizeof(double));
+    sucesso = (coluna_distancia >= 0) && (pt_encontrados != NULL);
+
+    for (segmento = 0; sucesso && (segmento < leitura.qtde_segmentos); segmento++)
+    {
+        pt_resultado->segmentos_total++;
+
+        if ( usa_indice &&
+             ( !arquivo_colunar_segmento_na_faixa(&leitura, segmento, ARQUIVO_COLUNAR_COLUNA_INSTANTE, (double)(fim_s - JANELA_Q1_S), INFINITY) ||
+               !arquivo_colunar_segmento_na_faixa(&leitura, segmento, coluna_distancia, -INFINITY, DISTANCIA_QUASE_CHEIA_CM) ) )
+        {
+            continue;
+        }
+
+        pt_resultado->segmentos_lidos++;
+        qtde_linhas = arquivo_colunar_le_coluna(&leitura, segmento, ARQUIVO_COLUNAR_COLUNA_INSTANTE, instantes);
+        sucesso = (qtde_linhas >= 0) && (arquivo_colunar_le_coluna(&leitura, segmento, coluna_distancia, valores) == qtde_linhas);
+        leu_dev_addrs = false;
+
+        for (i = 0; sucesso && (i < qtde_linhas); i++)
+        {
+            if ((instantes[i] >= (double)(fim_s - JANELA_Q1_S)) && (valores[i] <= DISTANCIA_QUASE_CHEIA_CM))
+            {
+                if (leu_dev_addrs == false)
+                {
+                    sucesso = (arquivo_colunar_le_coluna(&leitura, segmento, ARQUIVO_COLUNAR_COLUNA_DEV_ADDR, dev_addrs) == qtde_linhas);
+                    leu_dev_addrs = true;
+                }
+
+                pt_encontrados[qtde_encontrados++] = dev_addrs[i];
+            }
+        }
+
+        pt_resultado->linhas_lidas += qtde_linhas;
+    }
+
+    pt_resultado->linhas_q1 = qtde_encontrados;
+    pt_resultado->dispositivos_q1 = conta_distintos(pt_encontrados, qtde_encontrados);
+    pt_resultado->bytes_lidos += leitura.bytes_lidos;
+    free(pt_encontrados);
+    arquivo_colunar_fecha_tabela(&leitura);
+
+    /* Q2: pulsos por hora (colunas dev_addr, instante e contador_1 de todos os segmentos) */
+    if (!sucesso || (arquivo_colunar_abre_tabela(&leitura, pt_diretorio, "contadores") < 0))
+    {
+        return false;
+    }
+
+    coluna_contador = arquivo_colunar_coluna(&leitura, "contador_1");
+    sucesso = (coluna_contador >= 0) && cria_estado_q2(&estado_q2, leitura.qtde_dev_addrs);
+
+    for (segmento = 0; sucesso && (segmento < leitura.qtde_segmentos); segmento++)
+    {
+        pt_resultado->segmentos_total++;
+        pt_resultado->segmentos_lidos++;
+        qtde_linhas = arquivo_colunar_le_coluna(&leitura, segmento, ARQUIVO_COLUNAR_COLUNA_DEV_ADDR, dev_addrs);
+        sucesso = (qtde_linhas >= 0) &&
+                  (arquivo_colunar_le_coluna(&leitura, segmento, ARQUIVO_COLUNAR_COLUNA_INSTANTE, instantes) == qtde_linhas) &&
+                  (arquivo_colunar_le_coluna(&leitura, segmento, coluna_contador, valores) == qtde_linhas);
+
+        for (i = 0; sucesso && (i < qtde_linhas); i++)
+        {
+            registra_q2(&estado_q2, pt_resultado, (uint32_t)dev_addrs[i], instantes[i], valores[i]);
+        }
+
+        pt_resultado->linhas_lidas += qtde_linhas;
+    }
+
+    pt_resultado->bytes_lidos += leitura.bytes_lidos;
+    libera_estado_q2(&estado_q2);
+    arquivo_colunar_fecha_tabela(&leitura);
+    return sucesso;
+}
+
+/* Função: valor numérico de um campo de uma linha JSON
+ * Parâmetros: - ponteiro para a linha
+ *             - campo, com aspas e dois pontos ("campo":)
+ * Retorno: valor. NAN se o campo não existir ou for null.
+ */
+static double valor_json(const char * pt_linha, const char * pt_campo)
+{
+    const char * pt_valor = strstr(pt_linha, pt_campo);
+
+    if ((pt_valor == NULL) || (pt_valor[strlen(pt_campo)] == 'n'))
+    {
+        return NAN;
+    }
+
+    pt_valor += strlen(pt_campo);
+    return (*pt_valor == '"') ? (double)strtoul(pt_valor + 1, NULL, 16) : strtod(pt_valor, NULL);
+}
+
+/* Função: executa Q1 e Q2 nas linhas JSON
+ * Parâmetros: - ponteiro para o destino (tabelas em JSON)
+ *             - fim do período simulado (s)
+ *             - ponteiro para o resultado
+ * Retorno: true: sucesso; false: falha
+ */
+static bool consulta_json(const TDestino * pt_destino, int64_t fim_s, TResultado_consultas * pt_resultado)
+{
+    const TTabela_memoria * pt_tabela;
+    TEstado_q2 estado_q2;
+    double * pt_encontrados = NULL;
+    const char * pt_linha;
+    const char * pt_fim;
+    long qtde_encontrados = 0;
+    bool sucesso = true;
+    int i;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_consultas));
+
+    for (i = 0; sucesso && (i < pt_destino->qtde_tabelas_memoria); i++)
+    {
+        pt_tabela = &pt_destino->tabelas_memoria[i];
+        pt_linha = pt_tabela->pt_json;
+        pt_fim = pt_tabela->pt_json + pt_tabela->tam_json;
+
+        if (strcmp(pt_tabela->nome, "lote_leituras") == 0)
+        {
+            if ((pt_encontrados = malloc(pt_tabela->qtde_linhas * sizeof(double))) == NULL)
+            {
+                return false;
+            }
+
+            for (; pt_linha < pt_fim; pt_linha = strchr(pt_linha, '\n') + 1)
+            {
+                if ( (valor_json(pt_linha, "\"instante\":") >= (double)(fim_s - JANELA_Q1_S)) &&
+                     (valor_json(pt_linha, "\"distancia_cm\":") <= DISTANCIA_QUASE_CHEIA_CM) )
+                {
+                    pt_encontrados[qtde_encontrados++] = valor_json(pt_linha, "\"dev_addr\":");
+                }
+                pt_resultado->linhas_lidas++;
+            }
+
+            pt_resultado->linhas_q1 = qtde_encontrados;
+            pt_resultado->dispositivos_q1 = conta_distintos(pt_encontrados, qtde_encontrados);
+            pt_resultado->bytes_lidos += pt_tabela->tam_json;
+            free(pt_encontrados);
+        }
+        else if (strcmp(pt_tabela->nome, "contadores") == 0)
+        {
+            sucesso = cria_estado_q2(&estado_q2, (int)pt_tabela->qtde_linhas);
+
+            for (; sucesso && (pt_linha < pt_fim); pt_linha = strchr(pt_linha, '\n') + 1)
+            {
+                registra_q2(&estado_q2, pt_resultado, (uint32_t)valor_json(pt_linha, "\"dev_addr\":"), valor_json(pt_linha, "\"instante\":"),
+                            valor_json(pt_linha, "\"contador_1\":"));
+                pt_resultado->linhas_lidas++;
+            }
+
+            pt_resultado->bytes_lidos += pt_tabela->tam_json;
+            libera_estado_q2(&estado_q2);
+        }
+    }
+
+    return sucesso;
+}
+
+/* Função: compara os resultados de duas execuções das consultas
+ * Parâmetros: ponteiros para os resultados
+ * Retorno: true: iguais; false: diferentes
+ */
+static bool resultados_iguais(const TResultado_consultas * pt_a, const TResultado_consultas * pt_b)
+{
+    return (pt_a->linhas_q1 == pt_b->linhas_q1) && (pt_a->dispositivos_q1 == pt_b->dispositivos_q1) &&
+           (memcmp(pt_a->pulsos_por_hora, pt_b->pulsos_por_hora, sizeof(pt_a->pulsos_por_hora)) == 0);
+}
+
+/* Função: tamanho total dos arquivos de um diretório (nftw)
+ * Parâmetros: ver nftw()
+ * Retorno: 0 (continua)
+ */
+static uint64_t tam_diretorio;
+static int soma_tamanho(const char * pt_caminho, const struct stat * pt_estado, int tipo, struct FTW * pt_ftw)
+{
+    (void)pt_caminho;
+    (void)pt_ftw;
+    tam_diretorio += (tipo == FTW_F) ? (uint64_t)pt_estado->st_size : 0;
+    return 0;
+}
+
+/* Função: apaga um arquivo ou diretório vazio (nftw, em pós-ordem)
+ * Parâmetros: ver nftw()
+ * Retorno: resultado de remove()
+ */
+static int apaga_caminho(const char * pt_caminho, const struct stat * pt_estado, int tipo, struct FTW * pt_ftw)
+{
+    (void)pt_estado;
+    (void)tipo;
+    (void)pt_ftw;
+    return remove(pt_caminho);
+}
+
+/* Função: compara as linhas lidas do arquivo colunar com as linhas de referência
+ * Parâmetros: - diretório do arquivo
+ *             - ponteiro para o destino (referência em memória)
+ * Retorno: quantidade de diferenças
+ */
+static long compara_arquivo_com_referencia(const char * pt_diretorio, const TDestino * pt_destino)
+{
+    static double valores[ARQUIVO_COLUNAR_LINHAS_SEGMENTO];
+    const TTabela_memoria * pt_tabela;
+    TLeitura_colunar leitura;
+    double referencia;
+    long diferencas = 0;
+    long linha_inicial;
+    int qtde_linhas;
+    int segmento;
+    int coluna;
+    int i;
+    int t;
+
+    for (t = 0; t < pt_destino->qtde_tabelas_memoria; t++)
+    {
+        pt_tabela = &pt_destino->tabelas_memoria[t];
+
+        if (arquivo_colunar_abre_tabela(&leitura, pt_diretorio, pt_tabela->nome) < 0)
+        {
+            diferencas++;
+            continue;
+        }
+
+        diferencas += (leitura.qtde_colunas != pt_tabela->qtde_colunas);
+
+        for (coluna = 0; (coluna < leitura.qtde_colunas) && (coluna < pt_tabela->qtde_colunas); coluna++)
+        {
+            for (segmento = 0, linha_inicial = 0; segmento < leitura.qtde_segmentos; segmento++)
+            {
+                qtde_linhas = arquivo_colunar_le_coluna(&leitura, segmento, coluna, valores);
+                diferencas += (qtde_linhas < 0);
+
+                for (i = 0; i < qtde_linhas; i++)
+                {
+                    referencia = pt_tabela->pt_valores[((linha_inicial + i) * pt_tabela->qtde_colunas) + coluna];
+
+                    /* Valor igual (ou os dois sem valor) e dentro da faixa do índice do segmento */
+                    if ( ((valores[i] != referencia) && !(isnan(valores[i]) && isnan(referencia))) ||
+                         (!isnan(valores[i]) && ((valores[i] < leitura.pt_indices[segmento].min[coluna]) || (valores[i] > leitura.pt_indices[segmento].max[coluna]))) )
+                    {
+                        diferencas++;
+                    }
+                }
+
+                linha_inicial += (qtde_linhas > 0) ? qtde_linhas : 0;
+            }
+
+            diferencas += (linha_inicial != pt_tabela->qtde_linhas);
+        }
+
+        arquivo_colunar_fecha_tabela(&leitura);
+    }
+
+    return diferencas;
+}
+
+/* Função: executa os testes: ida e volta das linhas (em duas sessões de
+ *         gravação, com o arquivo reaberto) e consultas no arquivo colunar
+ *         (com e sem índice) x JSON
+ * Parâmetros: nenhum
+ * Retorno: 0 se todos os testes passaram, 1 caso contrário
+ */
+static int executa_testes(void)
+{
+    char diretorio[] = "/tmp/arquivo_telemetria_teste.XXXXXX";
+    TFrota frotas[QTDE_APLICACOES_LOTE];
+    TDestino destino;
+    TResultado_consultas resultado_json;
+    TResultado_consultas resultado_indice;
+    TResultado_consultas resultado_completo;
+    const int64_t fim_s = QTDE_DIAS_TESTE * 86400;
+    long diferencas;
+    int falhas = 0;
+    int i;
+
+    srand(1);
+    texto_binario_seleciona(IMPLEMENTACAO_AVX2);
+
+    if ((mkdtemp(diretorio) == NULL) || (prepara_destino(&destino, diretorio, true, true) == false))
+    {
+        printf("Falha ao preparar o arquivo em %s\n", diretorio);
+        return 1;
+    }
+
+    /* Sessão 1: primeiro dia; sessão 2: arquivo reaberto, segundo dia */
+    for (i = 0; i < QTDE_APLICACOES_LOTE; i++)
+    {
+        falhas += (cria_frota(&frotas[i], (TAplicacao_lote)i, QTDE_DISPOSITIVOS_TESTE) == false);
+        falhas += (falhas == 0) && (simula_frota(&frotas[i], &destino, fim_s / 2) == false);
+    }
+
+    falhas += (arquivo_colunar_fecha(destino.pt_arquivo) != 0);
+    falhas += ((destino.pt_arquivo = arquivo_colunar_abre(diretorio)) == NULL);
+
+    for (i = 0; (falhas == 0) && (i < QTDE_APLICACOES_LOTE); i++)
+    {
+        falhas += (simula_frota(&frotas[i], &destino, fim_s) == false);
+    }
+
+    falhas += (destino.pt_arquivo != NULL) && (arquivo_colunar_fecha(destino.pt_arquivo) != 0);
+    destino.pt_arquivo = NULL;
+    printf("Gravacao (%d dispositivos por aplicacao, %d dias, arquivo reaberto no meio): %ld linhas -> %s\n",
+           QTDE_DISPOSITIVOS_TESTE, QTDE_DIAS_TESTE, destino.qtde_linhas, (falhas == 0) ? "OK" : "FALHA");
+
+    /* Leitura de todas as colunas x referência, dentro da faixa do índice */
+    diferencas = (falhas == 0) ? compara_arquivo_com_referencia(diretorio, &destino) : 1;
+    printf("Leitura das %d tabelas x referencia (valores, sem valor e indice): %ld diferenca(s) -> %s\n",
+           destino.qtde_tabelas_memoria, diferencas, (diferencas == 0) ? "OK" : "FALHA");
+    falhas += (diferencas != 0);
+
+    /* Consultas: colunar com índice = colunar sem índice = JSON, e o índice deve pular segmentos */
+    if ( (consulta_colunar(diretorio, fim_s, true, &resultado_indice) == false) ||
+         (consulta_colunar(diretorio, fim_s, false, &resultado_completo) == false) ||
+         (consulta_json(&destino, fim_s, &resultado_json) == false) )
+    {
+        printf("Consultas: falha na execucao -> FALHA\n");
+        falhas++;
+    }
+    else
+    {
+        printf("Q1 (distancia <= %.0f cm nas ultimas 24 h): %ld linhas, %d dispositivos; segmentos lidos com indice %d de %d\n",
+               DISTANCIA_QUASE_CHEIA_CM, resultado_indice.linhas_q1, resultado_indice.dispositivos_q1,
+               resultado_indice.segmentos_lidos, resultado_indice.segmentos_total);
+        printf("Consultas colunar (com e sem indice) x JSON -> %s\n",
+               ( resultados_iguais(&resultado_indice, &resultado_json) && resultados_iguais(&resultado_completo, &resultado_json) &&
+                 (resultado_json.linhas_q1 > 0) && (resultado_indice.segmentos_lidos < resultado_indice.segmentos_total) ) ? "OK" : "FALHA");
+        falhas += !( resultados_iguais(&resultado_indice, &resultado_json) && resultados_iguais(&resultado_completo, &resultado_json) &&
+                     (resultado_json.linhas_q1 > 0) && (resultado_indice.segmentos_lidos < resultado_indice.segmentos_total) );
+    }
+
+    for (i = 0; i < QTDE_APLICACOES_LOTE; i++)
+    {
+        free(frotas[i].pt_dispositivos);
+    }
+
+    falhas += (libera_destino(&destino) == false);
+    nftw(diretorio, apaga_caminho, 16, FTW_DEPTH | FTW_PHYS);
+
+    printf("%s\n", (falhas == 0) ? "Todos os testes passaram" : "Houve falhas");
+    return (falhas == 0) ? 0 : 1;
+}
+
+/* Função: executa o benchmark: gravação da frota no arquivo colunar e em
+ *         JSON, tamanhos e vazão das consultas
+ * Parâmetros: - dispositivos por aplicação
+ *             - dias simulados
+ *             - diretório do arquivo (NULL: diretório temporário)
+ * Retorno: 0: sucesso; 1: falha
+ */
+static int executa_benchmark(int qtde_dispositivos, int qtde_dias, const char * pt_diretorio)
+{
+    char diretorio_temporario[] = "/tmp/arquivo_telemetria.XXXXXX";
+    TFrota frotas[QTDE_APLICACOES_LOTE];
+    TDestino destino;
+    static TResultado_consultas resultados[3];
+    static const char * nomes_consultas[3] = { "colunar com indice", "colunar sem indice", "JSON" };
+    const int64_t fim_s = (int64_t)qtde_dias * 86400;
+    size_t tam_json = 0;
+    double tempos[3];
+    double inicio;
+    double pulsos = 0.0;
+    bool sucesso = true;
+    int i;
+
+    srand(1);
+    texto_binario_seleciona(IMPLEMENTACAO_AVX2);
+
+    if ((pt_diretorio == NULL) && ((pt_diretorio = mkdtemp(diretorio_temporario)) == NULL))
+    {
+        printf("Falha ao criar o diretorio temporario\n");
+        return 1;
+    }
+
+    if (prepara_destino(&destino, pt_diretorio, false, true) == false)
+    {
+        printf("Falha ao preparar o arquivo em %s\n", pt_diretorio);
+        return 1;
+    }
+
+    printf("Frota: %d dispositivos por aplicacao (cap6 a cada %d s, cap7 a cada %d s, cap8 a cada %d s), %d dias\n",
+           qtde_dispositivos, PERIODO_CAP6_S, PERIODO_CAP7_S, PERIODO_CAP8_S, qtde_dias);
+
+    for (i = 0; sucesso && (i < QTDE_APLICACOES_LOTE); i++)
+    {
+        sucesso = cria_frota(&frotas[i], (TAplicacao_lote)i, qtde_dispositivos) && simula_frota(&frotas[i], &destino, fim_s);
+        free(frotas[i].pt_dispositivos);
+    }
+
+    inicio = instante_s();
+    sucesso = sucesso && (arquivo_colunar_fecha(destino.pt_arquivo) == 0);
+    destino.tempo_arquivo_s += instante_s() - inicio;
+    destino.pt_arquivo = NULL;
+
+    if (sucesso == false)
+    {
+        printf("Falha na gravacao\n");
+        libera_destino(&destino);
+        return 1;
+    }
+
+    tam_diretorio = 0;
+    nftw(pt_diretorio, soma_tamanho, 16, FTW_PHYS);
+    for (i = 0; i < destino.qtde_tabelas_memoria; i++)
+    {
+        tam_json += destino.tabelas_memoria[i].tam_json;
+        printf("  tabela %-20s %9ld linhas\n", destino.tabelas_memoria[i].nome, destino.tabelas_memoria[i].qtde_linhas);
+    }
+
+    printf("\nGravacao (%ld linhas):\n", destino.qtde_linhas);
+    printf("  decodificacao em lote        %8.3f s  (%6.2f M linhas/s)\n", destino.tempo_decodificacao_s, destino.qtde_linhas / destino.tempo_decodificacao_s / 1e6);
+    printf("  arquivo colunar (mmap)       %8.3f s  (%6.2f M linhas/s)  %10llu bytes  %5.2f bytes/linha\n",
+           destino.tempo_arquivo_s, destino.qtde_linhas / destino.tempo_arquivo_s / 1e6, (unsigned long long)tam_diretorio,
+           (double)tam_diretorio / destino.qtde_linhas);
+    printf("  linhas JSON (memoria)        %8.3f s  (%6.2f M linhas/s)  %10zu bytes  %5.2f bytes/linha  (%.1fx o colunar)\n",
+           destino.tempo_json_s, destino.qtde_linhas / destino.tempo_json_s / 1e6, tam_json, (double)tam_json / destino.qtde_linhas,
+           (double)tam_json / tam_diretorio);
+
+    /* Consultas (arquivos recém-gravados: leitura a partir do cache de páginas) */
+    for (i = 0; sucesso && (i < 3); i++)
+    {
+        inicio = instante_s();
+        sucesso = (i < 2) ? consulta_colunar(pt_diretorio, fim_s, (i == 0), &resultados[i]) : consulta_json(&destino, fim_s, &resultados[i]);
+        tempos[i] = instante_s() - inicio;
+    }
+
+    if (sucesso)
+    {
+        for (i = 0; i < QTDE_MAX_HORAS; i++)
+        {
+            pulsos += resultados[0].pulsos_por_hora[i];
+        }
+
+        printf("\nQ1: %ld leituras com distancia <= %.0f cm nas ultimas 24 h, em %d lixeiras\n", resultados[0].linhas_q1, DISTANCIA_QUASE_CHEIA_CM,
+               resultados[0].dispositivos_q1);
+        printf("Q2: %.0f pulsos do contador 1 em %d horas (media de %.0f por hora na frota)\n", pulsos, qtde_dias * 24, pulsos / (qtde_dias * 24));
+        printf("\nConsultas Q1 + Q2:\n");
+        for (i = 0; i < 3; i++)
+        {
+            printf("  %-20s %8.4f s  %10ld linhas lidas  %10llu bytes lidos  %7.2f M linhas/s  segmentos %d/%d  %s\n", nomes_consultas[i], tempos[i],
+                   resultados[i].linhas_lidas, (unsigned long long)resultados[i].bytes_lidos, resultados[i].linhas_lidas / tempos[i] / 1e6,
+                   resultados[i].segmentos_lidos, resultados[i].segmentos_total, resultados_iguais(&resultados[i], &resultados[2]) ? "" : "(RESULTADO DIFERENTE)");
+        }
+    }
+
+    libera_destino(&destino);
+    if (pt_diretorio == diretorio_temporario)
+    {
+        nftw(pt_diretorio, apaga_caminho, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    else
+    {
+        printf("\nArquivo gravado em %s\n", pt_diretorio);
+    }
+
+    return sucesso ? 0 : 1;
+}
+
+/* Função: ponto de entrada
+ * Parâmetros: ver o cabeçalho do arquivo
+ * Retorno: ver o cabeçalho do arquivo
+ */
+int main(int argc, char * argv[])
+{
+    const char * pt_diretorio = NULL;
+    int qtde_dispositivos = QTDE_DISPOSITIVOS_PADRAO;
+    int qtde_dias = QTDE_DIAS_PADRAO;
+    int opcao;
+
+    while ((opcao = getopt(argc, argv, "td:n:o:")) != -1)
+    {
+        switch (opcao)
+        {
+            case 't':
+                return executa_testes();
+
+            case 'd':
+                qtde_dispositivos = atoi(optarg);
+                break;
+
+            case 'n':
+                qtde_dias = atoi(optarg);
+                break;
+
+            case 'o':
+                pt_diretorio = optarg;
+                break;
+
+            default:
+                fprintf(stderr, "Uso: %s [-d dispositivos por aplicacao] [-n dias] [-o diretorio] | -t\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if ((qtde_dispositivos <= 0) || (qtde_dispositivos > 0xFFFF) || (qtde_dias <= 0) || ((qtde_dias * 24) > QTDE_MAX_HORAS))
+    {
+        fprintf(stderr, "Parametros invalidos (1 a 65535 dispositivos, 1 a %d dias)\n", QTDE_MAX_HORAS / 24);
+        return 1;
+    }
+
+    return executa_benchmark(qtde_dispositivos, qtde_dias, pt_diretorio);
+}
@@ -0,0 +1,591 @@
+/* Ferramenta: codec do histórico minuto a minuto dos contadores do Cap6
+ *
+ * Usa o mesmo código do firmware (historico_pulsos.c) para:
+ * - decodificar quadros de histórico recebidos (porta 13);
+ * - testar ida e volta (registra/codifica/decodifica) com históricos
+ *   sintéticos e casos extremos, conferindo as somas de cada bloco, o
+ *   contador inicial e se o passo usado é o menor que cabe;
+ * - comparar o tempo no ar por hora e a resolução obtida com o envio dos
+ *   contadores absolutos e com o envio do histórico, para perfis de pulsos
+ *   sintéticos e vários períodos de envio.
+ *
+ * Uso: codec_historico_pulsos -d <quadro em hexadecimal | AT+SENDB=13:quadro>
+ *      codec_historico_pulsos -t
+ *      codec_historico_pulsos
+ * Retorno (-t): 0 se todos os testes passaram, 1 caso contrário
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "historico_pulsos.h"
+#include "agendador_uplinks.h"
+
+/* Definições - rádio do Cap6 (LoRaWAN.h) */
+#define PLANO_FREQUENCIAS             PLANO_LA915
+#define DR                            2
+#define TAM_MAX_PAYLOAD               11      //bytes
+#define TAM_PAYLOAD_CONTADORES        8       //bytes
+
+/* Definições - envios do Cap6 (envios_lorawan.c) */
+#define TEMPO_MIN_ENTRE_ENVIOS_S      15
+#define JITTER_MAX_ENVIOS_S           10
+
+/* Definições - limites da ferramenta */
+#define TAM_MAX_QUADRO                256
+#define QTDE_TESTES_ALEATORIOS        20000
+#define QTDE_MINUTOS_PERFIL           (7 * 24 * 60)
+
+/* Payloads máximos avaliados nos testes: DR2, DR3, DR4 e DR5 do LA915 (dwell time de 400 ms) */
+static const int payloads_maximos[] = { 11, 53, 125, 242 };
+#define QTDE_PAYLOADS_MAXIMOS         ((int)(sizeof(payloads_maximos) / sizeof(payloads_maximos[0])))
+
+/* Passos do formato do quadro (referência independente do firmware) */
+static const int passos_referencia[HISTORICO_PULSOS_QTDE_PASSOS] = { 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 30, 40, 60, 120, 240 };
+
+/* Períodos de envio do histórico avaliados (minutos) */
+static const int periodos_envio_min[] = { 18, 30, 60, 120, 240 };
+#define QTDE_PERIODOS_ENVIO           ((int)(sizeof(periodos_envio_min) / sizeof(periodos_envio_min[0])))
+
+/* Perfil de pulsos sintético (pulsos por minuto de cada canal) */
+typedef struct
+{
+    char nome[80];
+    uint16_t pulsos[HISTORICO_PULSOS_QTDE_CANAIS][QTDE_MINUTOS_PERFIL];
+}TPerfil_pulsos;
+
+/* Função: gera número aleatório uniforme em [0, 1)
+ * Parâmetros: nenhum
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+/* Função: sorteia a quantidade de pulsos de um minuto (Poisson; aproximação
+ *         normal para taxas altas)
+ * Parâmetros: taxa média (pulsos por minuto)
+ * Retorno: quantidade de pulsos (limitada a 65535)
+ */
+static uint16_t sorteia_pulsos(double taxa)
+{
+    double limite;
+    double produto;
+    double valor;
+    int qtde = 0;
+
+    if (taxa <= 0.0)
+    {
+        return 0;
+    }
+
+    if (taxa > 30.0)
+    {
+        valor = taxa + sqrt(taxa) * sqrt(-2.0 * log(1.0 - aleatorio_uniforme())) * cos(2.0 * M_PI * aleatorio_uniforme());
+        valor = (valor < 0.0) ? 0.0 : floor(valor + 0.5);
+        return (valor > UINT16_MAX) ? UINT16_MAX : (uint16_t)valor;
+    }
+
+    limite = exp(-taxa);
+    produto = aleatorio_uniforme();
+    while (produto > limite)
+    {
+        qtde++;
+        produto *= aleatorio_uniforme();
+    }
+
+    return (uint16_t)qtde;
+}
+
+/* Função: calcula quantos bits um histórico ocupa com um passo (referência
+ *         independente do firmware)
+ * Parâmetros: - pulsos de cada canal, minuto a minuto
+ *             - quantidade de minutos
+ *             - passo
+ *             - ponteiro para as somas esperadas dos blocos (NULL: não preenche)
+ * Retorno: quantidade de bits do quadro
+ */
+static uint64_t bits_com_passo(uint16_t pulsos[HISTORICO_PULSOS_QTDE_CANAIS][HISTORICO_PULSOS_QTDE_MAX_MINUTOS], int qtde_minutos, int passo,
+                               uint32_t somas[HISTORICO_PULSOS_QTDE_CANAIS][HISTORICO_PULSOS_QTDE_MAX_MINUTOS])
+{
+    uint32_t somas_locais[HISTORICO_PULSOS_QTDE_MAX_MINUTOS];
+    uint64_t qtde_bits = HISTORICO_PULSOS_BITS_CABECALHO;
+    uint64_t bits_k;
+    uint64_t menor;
+    int qtde_blocos = (qtde_minutos + passo - 1) / passo;
+    int canal;
+    int k;
+    int i;
+
+    for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+    {
+        memset(somas_locais, 0x00, sizeof(somas_locais));
+        for (i = 0; i < qtde_minutos; i++)
+        {
+            somas_locais[i / passo] += pulsos[canal][i];
+        }
+
+        if (somas != NULL)
+        {
+            memcpy(somas[canal], somas_locais, qtde_blocos * sizeof(uint32_t));
+        }
+
+        menor = UINT64_MAX;
+        for (k = 0; k < (1 << HISTORICO_PULSOS_BITS_K); k++)
+        {
+            bits_k = 0;
+            for (i = 0; i < qtde_blocos; i++)
+            {
+                bits_k += (somas_locais[i] >> k) + 1 + k;
+            }
+            menor = (bits_k < menor) ? bits_k : menor;
+        }
+
+        qtde_bits += menor;
+    }
+
+    return qtde_bits;
+}
+
+/* Função: testa ida e volta de um histórico
+ * Parâmetros: - pulsos de cada canal, minuto a minuto
+ *             - quantidade de minutos
+ *             - contadores no início do histórico
+ *             - payload máximo
+ *             - nome do teste (para mensagens de erro)
+ * Retorno: true: teste passou
+ */
+static bool testa_ida_e_volta(uint16_t pulsos[HISTORICO_PULSOS_QTDE_CANAIS][HISTORICO_PULSOS_QTDE_MAX_MINUTOS], int qtde_minutos,
+                              const uint32_t * pt_bases, int tam_max, const char * pt_nome)
+{
+    static THistorico_pulsos historico;
+    static THistorico_pulsos_quadro decodificado;
+    static uint32_t esperadas[HISTORICO_PULSOS_QTDE_CANAIS][HISTORICO_PULSOS_QTDE_MAX_MINUTOS];
+    uint8_t quadro[TAM_MAX_QUADRO];
+    uint32_t contadores[HISTORICO_PULSOS_QTDE_CANAIS];
+    int tam_quadro;
+    int passo = 0;
+    int qtde_blocos;
+    int canal;
+    int i;
+
+    contadores[0] = pt_bases[0];
+    contadores[1] = pt_bases[1];
+    historico_pulsos_inicializa(&historico, contadores[0], contadores[1]);
+
+    for (i = 0; i < qtde_minutos; i++)
+    {
+        contadores[0] += pulsos[0][i];
+        contadores[1] += pulsos[1][i];
+        if (historico_pulsos_registra_minuto(&historico, contadores[0], contadores[1]) == false)
+        {
+            printf("FALHA %s: minuto %d nao registrado\n", pt_nome, i);
+            return false;
+        }
+    }
+
+    tam_quadro = historico_pulsos_codifica(&historico, quadro, tam_max, &passo);
+    if (tam_quadro == 0)
+    {
+        /* Não coube: confere que nem um único bloco cabe */
+        if (bits_com_passo(pulsos, qtde_minutos, qtde_minutos, NULL) <= (uint64_t)tam_max * 8)
+        {
+            printf("FALHA %s: codificacao falhou, mas um bloco cabe em %d bytes\n", pt_nome, tam_max);
+            return false;
+        }
+        return true;
+    }
+
+    if (tam_quadro > tam_max)
+    {
+        printf("FALHA %s: quadro de %d bytes (maximo %d)\n", pt_nome, tam_quadro, tam_max);
+        return false;
+    }
+
+    qtde_blocos = historico_pulsos_decodifica(quadro, tam_quadro, &decodificado);
+    bits_com_passo(pulsos, qtde_minutos, passo, esperadas);
+
+    if ( (qtde_blocos != ((qtde_minutos + passo - 1) / passo)) || (decodificado.passo != passo) ||
+         (decodificado.qtde_minutos != qtde_minutos) )
+    {
+        printf("FALHA %s: %d blocos / passo %d / %d minutos decodificados, esperados passo %d / %d minutos\n", pt_nome,
+               qtde_blocos, decodificado.passo, decodificado.qtde_minutos, passo, qtde_minutos);
+        return false;
+    }
+
+    for (canal = 0; canal < HISTORICO_PULSOS_QTDE_CANAIS; canal++)
+    {
+        if (decodificado.bases[canal] != (uint16_t)pt_bases[canal])
+        {
+            printf("FALHA %s: contador inicial %d decodificado %u, esperado %u\n", pt_nome, canal + 1,
+                   decodificado.bases[canal], (uint16_t)pt_bases[canal]);
+            return false;
+        }
+
+        for (i = 0; i < qtde_blocos; i++)
+        {
+            if (decodificado.somas[canal][i] != esperadas[canal][i])
+            {
+                printf("FALHA %s: canal %d, bloco %d decodificado %u, esperado %u\n", pt_nome, canal + 1, i,
+                       decodificado.somas[canal][i], esperadas[canal][i]);
+                return false;
+            }
+        }
+    }
+
+    /* O passo usado deve ser o menor que cabe */
+    for (i = 0; passos_referencia[i] < passo; i++)
+    {
+        if (bits_com_passo(pulsos, qtde_minutos, passos_referencia[i], NULL) <= (uint64_t)tam_max * 8)
+        {
+            printf("FALHA %s: passo %d, mas passo %d cabe\n", pt_nome, passo, passos_referencia[i]);
+            return false;
+        }
+    }
+
+    /* Quadro truncado (o último byte sempre tem bits do quadro) deve ser rejeitado */
+    if (historico_pulsos_decodifica(quadro, tam_quadro - 1, &decodificado) >= 0)
+    {
+        printf("FALHA %s: quadro truncado aceito\n", pt_nome);
+        return false;
+    }
+
+    return true;
+}
+
+/* Função: executa os testes de ida e volta
+ * Parâmetros: nenhum
+ * Retorno: 0 se todos passaram, 1 caso contrário
+ */
+static int executa_testes(void)
+{
+    static uint16_t pulsos[HISTORICO_PULSOS_QTDE_CANAIS][HISTORICO_PULSOS_QTDE_MAX_MINUTOS];
+    static THistorico_pulsos historico;
+    uint8_t quadro[TAM_MAX_QUADRO];
+    uint32_t bases[HISTORICO_PULSOS_QTDE_CANAIS];
+    char nome[64];
+    double taxa;
+    int qtde_minutos;
+    int passo;
+    int falhas = 0;
+    int testes = 0;
+    int i;
+    int j;
+    int k;
+
+    /* Casos extremos */
+    for (k = 0; k < QTDE_PAYLOADS_MAXIMOS; k++)
+    {
+        bases[0] = 123456;
+        bases[1] = 0xFFFFFFF0;   // contador 2 passa por 2^32 dentro do histórico
+
+        memset(pulsos, 0x00, sizeof(pulsos));
+        falhas += (testa_ida_e_volta(pulsos, HISTORICO_PULSOS_QTDE_MAX_MINUTOS, bases, payloads_maximos[k], "sem pulsos") == false);
+        falhas += (testa_ida_e_volta(pulsos, 1, bases, payloads_maximos[k], "um minuto sem pulsos") == false);
+
+        for (i = 0; i < HISTORICO_PULSOS_QTDE_MAX_MINUTOS; i++)
+        {
+            pulsos[0][i] = 10;
+            pulsos[1][i] = 1;
+        }
+        falhas += (testa_ida_e_volta(pulsos, HISTORICO_PULSOS_QTDE_MAX_MINUTOS, bases, payloads_maximos[k], "constante") == false);
+        falhas += (testa_ida_e_volta(pulsos, 17, bases, payloads_maximos[k], "constante, ultimo bloco parcial") == false);
+
+        for (i = 0; i < HISTORICO_PULSOS_QTDE_MAX_MINUTOS; i++)
+        {
+            pulsos[0][i] = ((i % 60) < 5) ? 3000 : 0;
+            pulsos[1][i] = 0;
+        }
+        falhas += (testa_ida_e_volta(pulsos, HISTORICO_PULSOS_QTDE_MAX_MINUTOS, bases, payloads_maximos[k], "rajadas") == false);
+
+        for (i = 0; i < HISTORICO_PULSOS_QTDE_MAX_MINUTOS; i++)
+        {
+            pulsos[0][i] = UINT16_MAX;
+            pulsos[1][i] = UINT16_MAX;
+        }
+        falhas += (testa_ida_e_volta(pulsos, HISTORICO_PULSOS_QTDE_MAX_MINUTOS, bases, payloads_maximos[k], "maximo por minuto") == false);
+        testes += 6;
+    }
+
+    /* Registro: histórico cheio, pulsos demais num minuto e contador passando por 2^32 */
+    testes++;
+    historico_pulsos_inicializa(&historico, 0xFFFFFFF0, 0);
+    if ( (historico_pulsos_codifica(&historico, quadro, TAM_MAX_PAYLOAD, &passo) != 0) ||
+         (historico_pulsos_registra_minuto(&historico, 0x00000010, 0) == false) || (historico.pulsos[0][0] != 32) ||
+         (historico_pulsos_registra_minuto(&historico, 0x00010011, 0) == true) || (historico.qtde_minutos != 1) )
+    {
+        printf("FALHA: registro de minutos (vazio, 2^32, pulsos demais)\n");
+        falhas++;
+    }
+
+    testes++;
+    historico_pulsos_inicializa(&historico, 0, 0);
+    for (i = 0; i < HISTORICO_PULSOS_QTDE_MAX_MINUTOS; i++)
+    {
+        historico_pulsos_registra_minuto(&historico, (uint32_t)i + 1, 0);
+    }
+    if (historico_pulsos_registra_minuto(&historico, HISTORICO_PULSOS_QTDE_MAX_MINUTOS + 1, 0) == true)
+    {
+        printf("FALHA: minuto registrado com o historico cheio\n");
+        falhas++;
+    }
+
+    /* Depois de um envio aceito, o histórico recomeça no fim do último minuto registrado */
+    testes++;
+    historico_pulsos_reinicia(&historico);
+    if ( (historico.qtde_minutos != 0) || (historico.bases[0] != HISTORICO_PULSOS_QTDE_MAX_MINUTOS) ||
+         (historico_pulsos_registra_minuto(&historico, HISTORICO_PULSOS_QTDE_MAX_MINUTOS + 7, 0) == false) ||
+         (historico.pulsos[0][0] != 7) )
+    {
+        printf("FALHA: reinicio do historico\n");
+        falhas++;
+    }
+
+    /* Históricos aleatórios: taxas de 0 a milhares de pulsos por minuto, com rajadas e pausas */
+    srand(1);
+    for (j = 0; j < QTDE_TESTES_ALEATORIOS; j++)
+    {
+        qtde_minutos = 1 + (rand() % HISTORICO_PULSOS_QTDE_MAX_MINUTOS);
+        bases[0] = (uint32_t)rand() * 7919u;
+        bases[1] = (uint32_t)rand() * 104729u;
+
+        for (k = 0; k < HISTORICO_PULSOS_QTDE_CANAIS; k++)
+        {
+            taxa = pow(10.0, aleatorio_uniforme() * 5.0 - 2.0);
+            for (i = 0; i < qtde_minutos; i++)
+            {
+                pulsos[k][i] = (aleatorio_uniforme() < 0.1) ? 0 : sorteia_pulsos(taxa);
+                if (aleatorio_uniforme() < 0.02)
+                {
+                    taxa = pow(10.0, aleatorio_uniforme() * 5.0 - 2.0);
+                }
+            }
+        }
+
+        snprintf(nome, sizeof(nome), "aleatorio %d", j);
+        falhas += (testa_ida_e_volta(pulsos, qtde_minutos, bases, payloads_maximos[j % QTDE_PAYLOADS_MAXIMOS], nome) == false);
+        testes++;
+    }
+
+    printf("%d teste(s) de ida e volta, %d falha(s)\n", testes, falhas);
+    return (falhas == 0) ? 0 : 1;
+}
+
+/* Função: decodifica e mostra um quadro em hexadecimal
+ * Parâmetros: quadro em hexadecimal (aceita também a linha do log, "AT+SENDB=13:<quadro>")
+ * Retorno: 0: sucesso; 1: quadro inválido
+ */
+static int decodifica_quadro_hex(const char * pt_hex)
+{
+    static THistorico_pulsos_quadro decodificado;
+    uint8_t quadro[TAM_MAX_QUADRO];
+    unsigned int byte;
+    uint32_t contadores[HISTORICO_PULSOS_QTDE_CANAIS];
+    int tam_quadro = 0;
+    int qtde_blocos;
+    int minutos_bloco;
+    int i;
+
+    if (strchr(pt_hex, ':') != NULL)
+    {
+        pt_hex = strrchr(pt_hex, ':') + 1;
+    }
+
+    while ((pt_hex[0] != '\0') && (pt_hex[1] != '\0') && (tam_quadro < TAM_MAX_QUADRO) && (sscanf(pt_hex, "%2x", &byte) == 1))
+    {
+        quadro[tam_quadro++] = (uint8_t)byte;
+        pt_hex += 2;
+    }
+
+    qtde_blocos = historico_pulsos_decodifica(quadro, tam_quadro, &decodificado);
+    if (qtde_blocos < 0)
+    {
+        printf("Quadro invalido\n");
+        return 1;
+    }
+
+    printf("%d minutos em %d blocos de %d min, %d bytes. Contadores iniciais (16 bits): %u / %u\n",
+           decodificado.qtde_minutos, qtde_blocos, decodificado.passo, tam_quadro, decodificado.bases[0], decodificado.bases[1]);
+    printf("%5s %8s %10s %10s %12s %12s\n", "bloco", "minutos", "pulsos 1", "pulsos 2", "contador 1", "contador 2");
+
+    /* Contadores no fim de cada bloco, nos 16 bits menos significativos */
+    contadores[0] = decodificado.bases[0];
+    contadores[1] = decodificado.bases[1];
+    for (i = 0; i < qtde_blocos; i++)
+    {
+        minutos_bloco = (i < (qtde_blocos - 1)) ? decodificado.passo : (decodificado.qtde_minutos - i * decodificado.passo);
+        contadores[0] += decodificado.somas[0][i];
+        contadores[1] += decodificado.somas[1][i];
+        printf("%5d %8d %10u %10u %12u %12u\n", i, minutos_bloco, decodificado.somas[0][i], decodificado.somas[1][i],
+               contadores[0] & 0xFFFF, contadores[1] & 0xFFFF);
+    }
+
+    return 0;
+}
+
+/* Função: gera um perfil de pulsos sintético de 7 dias
+ * Parâmetros: - ponteiro para o perfil
+ *             - nome
+ *             - taxa média do canal 1 (pulsos por minuto) e fração dela no canal 2
+ *             - amplitude do ciclo diário (fração da taxa média)
+ *             - probabilidade por minuto de o consumo parar (e de voltar)
+ * Retorno: nenhum
+ */
+static void gera_perfil(TPerfil_pulsos * pt_perfil, const char * pt_nome, double taxa_media, double fracao_canal_2,
+                        double amplitude, double prob_pausa)
+{
+    bool em_pausa = false;
+    double taxa;
+    int i;
+
+    snprintf(pt_perfil->nome, sizeof(pt_perfil->nome), "%s", pt_nome);
+
+    for (i = 0; i < QTDE_MINUTOS_PERFIL; i++)
+    {
+        if (aleatorio_uniforme() < prob_pausa)
+        {
+            em_pausa = !em_pausa;
+        }
+
+        taxa = em_pausa ? 0.0 : taxa_media * (1.0 + amplitude * sin(2.0 * M_PI * i / (24.0 * 60.0)));
+        pt_perfil->pulsos[0][i] = sorteia_pulsos(taxa);
+        pt_perfil->pulsos[1][i] = sorteia_pulsos(taxa * fracao_canal_2);
+    }
+}
+
+/* Função: mede, para um perfil, o envio do histórico a vários períodos de envio
+ * Parâmetros: ponteiro para o perfil
+ * Retorno: nenhum
+ */
+static void mede_perfil(const TPerfil_pulsos * pt_perfil)
+{
+    static THistorico_pulsos historico;
+    uint8_t quadro[TAM_MAX_QUADRO];
+    uint32_t contadores[HISTORICO_PULSOS_QTDE_CANAIS] = { 0, 0 };
+    double tempo_no_ar_s;
+    double soma_tempo_no_ar_s;
+    long soma_bytes;
+    long soma_passos;
+    int maior_passo;
+    int qtde_quadros;
+    int qtde_absolutos;
+    int tam_quadro;
+    int passo;
+    int periodo;
+    int inicio;
+    int i;
+    int p;
+
+    printf("\n%s\n", pt_perfil->nome);
+    printf("  %8s %11s %9s %11s %10s %11s %12s\n", "periodo", "uplinks/h", "bytes", "tempo/h", "orcamento", "passo med",
+           "passo max");
+
+    for (p = 0; p < QTDE_PERIODOS_ENVIO; p++)
+    {
+        periodo = periodos_envio_min[p];
+        soma_tempo_no_ar_s = 0.0;
+        soma_bytes = 0;
+        soma_passos = 0;
+        maior_passo = 0;
+        qtde_quadros = 0;
+        qtde_absolutos = 0;
+
+        for (inicio = 0; (inicio + periodo) <= QTDE_MINUTOS_PERFIL; inicio += periodo)
+        {
+            historico_pulsos_inicializa(&historico, contadores[0], contadores[1]);
+            for (i = inicio; i < (inicio + periodo); i++)
+            {
+                contadores[0] += pt_perfil->pulsos[0][i];
+                contadores[1] += pt_perfil->pulsos[1][i];
+                historico_pulsos_registra_minuto(&historico, contadores[0], contadores[1]);
+            }
+
+            tam_quadro = historico_pulsos_codifica(&historico, quadro, TAM_MAX_PAYLOAD, &passo);
+            if (tam_quadro == 0)
+            {
+                /* Não cabe: vão os contadores absolutos */
+                tam_quadro = TAM_PAYLOAD_CONTADORES;
+                passo = periodo;
+                qtde_absolutos++;
+            }
+
+            tempo_no_ar_s = agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS, DR, tam_quadro) / 1e6;
+            soma_tempo_no_ar_s += tempo_no_ar_s;
+            soma_bytes += tam_quadro;
+            soma_passos += passo;
+            maior_passo = (passo > maior_passo) ? passo : maior_passo;
+            qtde_quadros++;
+        }
+
+        printf("  %5d min %11.2f %9.1f %9.2f s %9.0f%% %7.1f min %8d min", periodo, 60.0 / periodo,
+               (double)soma_bytes / qtde_quadros, soma_tempo_no_ar_s * (60.0 / periodo) / qtde_quadros,
+               100.0 * soma_tempo_no_ar_s * (1440.0 / periodo) / qtde_quadros / (ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS / 1000.0),
+               (double)soma_passos / qtde_quadros, maior_passo);
+        if (qtde_absolutos > 0)
+        {
+            printf("  (%d absolutos)", qtde_absolutos);
+        }
+        printf("\n");
+    }
+}
+
+/* Função: mostra o tempo no ar por hora do envio dos contadores absolutos
+ * Parâmetros: nenhum
+ * Retorno: nenhum
+ */
+static void mostra_contadores_absolutos(void)
+{
+    double tempo_no_ar_s = agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS, DR, TAM_PAYLOAD_CONTADORES) / 1e6;
+    double tempo_no_ar_max_s = agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS, DR, TAM_MAX_PAYLOAD) / 1e6;
+    double orcamento_hora_s = ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS / 1000.0 / 24.0;
+    double periodo_grade_s = tempo_no_ar_max_s * 86400.0 / (ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS / 1000.0) + JITTER_MAX_ENVIOS_S;
+
+    printf("Tempo no ar em DR%d: %.1f ms com %d bytes (contadores), %.1f ms com %d bytes (payload maximo)\n", DR,
+           tempo_no_ar_s * 1000.0, TAM_PAYLOAD_CONTADORES, tempo_no_ar_max_s * 1000.0, TAM_MAX_PAYLOAD);
+    printf("Orcamento de fair-use (opcional nos firmwares): %.0f s/dia = %.2f s/h\n\n", ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS / 1000.0, orcamento_hora_s);
+    printf("Contadores absolutos (%d bytes):\n", TAM_PAYLOAD_CONTADORES);
+    printf("  %-38s %11s %11s %10s %11s\n", "envio", "uplinks/h", "tempo/h", "orcamento", "resolucao");
+    printf("  %-38s %11.2f %9.2f s %9.0f%% %7.1f min\n", "a cada 15 s (sem orcamento)", 3600.0 / TEMPO_MIN_ENTRE_ENVIOS_S,
+           tempo_no_ar_s * 3600.0 / TEMPO_MIN_ENTRE_ENVIOS_S, 100.0 * tempo_no_ar_s * 3600.0 / TEMPO_MIN_ENTRE_ENVIOS_S / orcamento_hora_s,
+           TEMPO_MIN_ENTRE_ENVIOS_S / 60.0);
+    printf("  %-38s %11.2f %9.2f s %9.0f%% %7.1f min\n", "a cada minuto (resolucao de 1 min)", 60.0, tempo_no_ar_s * 60.0,
+           100.0 * tempo_no_ar_s * 60.0 / orcamento_hora_s, 1.0);
+    printf("  %-38s %11.2f %9.2f s %9.0f%% %7.1f min\n", "grade do fair-use (opcional)", 3600.0 / periodo_grade_s,
+           tempo_no_ar_s * 3600.0 / periodo_grade_s, 100.0 * tempo_no_ar_s * 3600.0 / periodo_grade_s / orcamento_hora_s,
+           periodo_grade_s / 60.0);
+    printf("\nHistorico minuto a minuto (ate %d bytes; resolucao = passo):\n", TAM_MAX_PAYLOAD);
+}
+
+int main(int argc, char * argv[])
+{
+    static TPerfil_pulsos perfil;
+
+    if ((argc == 3) && (strcmp(argv[1], "-d") == 0))
+    {
+        return decodifica_quadro_hex(argv[2]);
+    }
+
+    if ((argc == 2) && (strcmp(argv[1], "-t") == 0))
+    {
+        return executa_testes();
+    }
+
+    mostra_contadores_absolutos();
+
+    srand(1);
+
+    gera_perfil(&perfil, "sintetico: hidrometro residencial (0,5 pulso/min, pausas longas)", 0.5, 0.2, 0.8, 0.02);
+    mede_perfil(&perfil);
+
+    gera_perfil(&perfil, "sintetico: medidor de energia (10 pulsos/min, ciclo diario)", 10.0, 0.1, 0.5, 0.0);
+    mede_perfil(&perfil);
+
+    gera_perfil(&perfil, "sintetico: linha de producao (200 pulsos/min, paradas)", 200.0, 0.05, 0.2, 0.01);
+    mede_perfil(&perfil);
+
+    return 0;
+}
@@ -0,0 +1,570 @@
+/* Ferramenta: codec da série de temperaturas do Cap8
+ *
+ * Usa o mesmo código do firmware (serie_temperaturas.c) para:
+ * - decodificar quadros de série recebidos (porta 13);
+ * - testar ida e volta (codifica/decodifica) com janelas sintéticas e casos
+ *   extremos, conferindo as amostras com as médias de bloco esperadas;
+ * - medir bytes por amostra e erro de reconstrução em séries de
+ *   temperaturas (gravadas ou sintéticas), para vários payloads máximos.
+ *
+ * Uso: codec_serie_temperaturas -d <quadro em hexadecimal | AT+SENDB=13:quadro>
+ *      codec_serie_temperaturas -t
+ *      codec_serie_temperaturas [serie.csv ...]
+ *      Cada linha da série: temperatura em °C, ou instante,temperatura
+ *      (linhas com # são ignoradas). Sem argumentos, usa séries sintéticas.
+ * Retorno (-t): 0 se todos os testes passaram, 1 caso contrário
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include "serie_temperaturas.h"
+
+/* Definições - janela de envio do Cap8 (15 minutos, uma leitura a cada 10 s) */
+#define QTDE_AMOSTRAS_JANELA          90
+
+/* Definições - limites da ferramenta */
+#define TAM_MAX_QUADRO                256
+#define QTDE_MAX_AMOSTRAS_SERIE       200000
+#define QTDE_TESTES_ALEATORIOS        20000
+
+/* Definição - resolução do DS18B20 em 12 bits (°C) */
+#define RESOLUCAO_DS18B20             0.0625
+
+/* Payloads máximos avaliados: DR2, DR3, DR4 e DR5 do LA915 (dwell time de 400 ms) */
+static const int payloads_maximos[] = { 11, 53, 125, 242 };
+#define QTDE_PAYLOADS_MAXIMOS         ((int)(sizeof(payloads_maximos) / sizeof(payloads_maximos[0])))
+
+/* Série de temperaturas (0,1 °C) */
+typedef struct
+{
+    char nome[64];
+    int qtde;
+    int16_t * amostras_x10;
+}TSerie_temperaturas;
+
+/* Função: gera número aleatório uniforme em [0, 1)
+ * Parâmetros: nenhum
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+/* Função: converte temperatura lida (°C) para 0,1 °C, como o firmware
+ * Parâmetros: temperatura (°C)
+ * Retorno: temperatura (0,1 °C)
+ */
+static int16_t temperatura_x10(double temperatura)
+{
+    return (int16_t)lround(temperatura * 10.0);
+}
+
+/* Função: quantiza a temperatura na resolução do DS18B20
+ * Parâmetros: temperatura (°C)
+ * Retorno: temperatura quantizada (°C)
+ */
+static double quantiza_ds18b20(double temperatura)
+{
+    return floor(temperatura / RESOLUCAO_DS18B20) * RESOLUCAO_DS18B20;
+}
+
+/* Função: calcula as médias de bloco esperadas (referência independente do firmware)
+ * Parâmetros: - amostras da janela
+ *             - quantidade de amostras
+ *             - passo
+ *             - ponteiro para as médias
+ * Retorno: quantidade de médias
+ */
+static int calcula_medias_bloco(const int16_t * pt_amostras, int qtde, int passo, int16_t * pt_medias)
+{
+    int qtde_medias = 0;
+    int inicio;
+    int fim;
+    int i;
+    double soma;
+
+    for (inicio = 0; inicio < qtde; inicio += passo)
+    {
+        fim = (inicio + passo < qtde) ? (inicio + passo) : qtde;
+        soma = 0.0;
+        for (i = inicio; i < fim; i++)
+        {
+            soma += pt_amostras[i];
+        }
+        pt_medias[qtde_medias++] = (int16_t)lround(soma / (fim - inicio));
+    }
+
+    return qtde_medias;
+}
+
+/* Função: calcula o tamanho do quadro com um passo, sem limite de payload
+ * Parâmetros: - amostras da janela
+ *             - quantidade de amostras
+ *             - passo
+ * Retorno: tamanho do quadro (bytes); INT_MAX se as amostras não são representáveis com o passo
+ */
+static int tamanho_com_passo(const int16_t * pt_amostras, int qtde, int passo)
+{
+    int16_t medias[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    uint8_t quadro[TAM_MAX_QUADRO * 4];
+    int passo_medias = 0;
+    int tam_quadro;
+
+    /* O fluxo de bits das médias com passo 1 é o mesmo da janela com o passo */
+    tam_quadro = serie_temperaturas_codifica(medias, calcula_medias_bloco(pt_amostras, qtde, passo, medias),
+                                             quadro, sizeof(quadro), &passo_medias);
+
+    return ((tam_quadro > 0) && (passo_medias == 1)) ? tam_quadro : INT_MAX;
+}
+
+/* Função: testa ida e volta de uma janela
+ * Parâmetros: - amostras da janela
+ *             - quantidade de amostras
+ *             - payload máximo
+ *             - nome do teste (para mensagens de erro)
+ * Retorno: true: teste passou
+ */
+static bool testa_ida_e_volta(const int16_t * pt_amostras, int qtde, int tam_max, const char * pt_nome)
+{
+    uint8_t quadro[TAM_MAX_QUADRO];
+    int16_t decodificadas[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    int16_t esperadas[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    int tam_quadro;
+    int passo = 0;
+    int passo_decodificado = 0;
+    int qtde_decodificadas;
+    int qtde_esperadas;
+    int i;
+
+    tam_quadro = serie_temperaturas_codifica(pt_amostras, qtde, quadro, tam_max, &passo);
+    if (tam_quadro == 0)
+    {
+        /* Não coube: confere que nenhum passo permitido cabe */
+        for (passo = 1; ((qtde + passo - 1) / passo) >= SERIE_TEMPERATURAS_QTDE_MIN_AMOSTRAS; passo++)
+        {
+            if (tamanho_com_passo(pt_amostras, qtde, passo) <= tam_max)
+            {
+                printf("FALHA %s: codificacao falhou, mas passo %d cabe em %d bytes\n", pt_nome, passo, tam_max);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if ((tam_quadro > tam_max) || (passo < 1))
+    {
+        printf("FALHA %s: quadro de %d bytes (maximo %d), passo %d\n", pt_nome, tam_quadro, tam_max, passo);
+        return false;
+    }
+
+    qtde_decodificadas = serie_temperaturas_decodifica(quadro, tam_quadro, decodificadas, SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS, &passo_decodificado);
+    qtde_esperadas = calcula_medias_bloco(pt_amostras, qtde, passo, esperadas);
+
+    if ((qtde_decodificadas != qtde_esperadas) || (passo_decodificado != passo))
+    {
+        printf("FALHA %s: %d amostras / passo %d decodificados, esperados %d / %d\n", pt_nome,
+               qtde_decodificadas, passo_decodificado, qtde_esperadas, passo);
+        return false;
+    }
+
+    for (i = 0; i < qtde_esperadas; i++)
+    {
+        if (decodificadas[i] != esperadas[i])
+        {
+            printf("FALHA %s: amostra %d decodificada %d, esperada %d\n", pt_nome, i, decodificadas[i], esperadas[i]);
+            return false;
+        }
+    }
+
+    /* O passo usado deve ser o menor que cabe */
+    for (i = 1; i < passo; i++)
+    {
+        if (tamanho_com_passo(pt_amostras, qtde, i) <= tam_max)
+        {
+            printf("FALHA %s: passo %d, mas passo %d cabe\n", pt_nome, passo, i);
+            return false;
+        }
+    }
+
+    /* Quadro truncado (sem todos os bits da primeira amostra) deve ser rejeitado */
+    if (serie_temperaturas_decodifica(quadro, SERIE_TEMPERATURAS_TAM_CABECALHO + 1, decodificadas,
+                                      SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS, &passo_decodificado) >= 0)
+    {
+        printf("FALHA %s: quadro truncado aceito\n", pt_nome);
+        return false;
+    }
+
+    return true;
+}
+
+/* Função: executa os testes de ida e volta
+ * Parâmetros: nenhum
+ * Retorno: 0 se todos passaram, 1 caso contrário
+ */
+static int executa_testes(void)
+{
+    int16_t janela[QTDE_AMOSTRAS_JANELA];
+    uint8_t quadro[TAM_MAX_QUADRO];
+    char nome[64];
+    double temperatura;
+    int passo;
+    int falhas = 0;
+    int testes = 0;
+    int i;
+    int j;
+    int k;
+
+    /* Casos extremos */
+    for (k = 0; k < QTDE_PAYLOADS_MAXIMOS; k++)
+    {
+        for (i = 0; i < QTDE_AMOSTRAS_JANELA; i++)
+        {
+            janela[i] = 235;
+        }
+        falhas += (testa_ida_e_volta(janela, QTDE_AMOSTRAS_JANELA, payloads_maximos[k], "constante") == false);
+
+        for (i = 0; i < QTDE_AMOSTRAS_JANELA; i++)
+        {
+            janela[i] = (i % 2 == 0) ? -550 : 1250;
+        }
+        falhas += (testa_ida_e_volta(janela, QTDE_AMOSTRAS_JANELA, payloads_maximos[k], "alternando -55/125 C") == false);
+
+        for (i = 0; i < QTDE_AMOSTRAS_JANELA; i++)
+        {
+            janela[i] = (int16_t)(-550 + i * 20);
+        }
+        falhas += (testa_ida_e_volta(janela, QTDE_AMOSTRAS_JANELA, payloads_maximos[k], "rampa") == false);
+
+        for (i = 0; i < QTDE_AMOSTRAS_JANELA; i++)
+        {
+            janela[i] = (i < 45) ? 40 : 220;
+        }
+        falhas += (testa_ida_e_volta(janela, QTDE_AMOSTRAS_JANELA, payloads_maximos[k], "degrau") == false);
+
+        for (i = 0; i < QTDE_AMOSTRAS_JANELA; i++)
+        {
+            janela[i] = (int16_t)(-1 - (i % 3));
+        }
+        falhas += (testa_ida_e_volta(janela, QTDE_AMOSTRAS_JANELA, payloads_maximos[k], "negativas pequenas") == false);
+        testes += 5;
+    }
+
+    /* Fora da faixa da primeira amostra: não deve ser codificada */
+    janela[0] = SERIE_TEMPERATURAS_AMOSTRA_MAX + 1;
+    for (i = 1; i < QTDE_AMOSTRAS_JANELA; i++)
+    {
+        janela[i] = janela[0];
+    }
+    testes++;
+    if (serie_temperaturas_codifica(janela, QTDE_AMOSTRAS_JANELA, quadro, 242, &passo) != 0)
+    {
+        printf("FALHA: amostra fora da faixa codificada\n");
+        falhas++;
+    }
+
+    /* Janelas aleatórias: passeio aleatório, ruído e degraus, com quantidades variadas */
+    srand(1);
+    for (j = 0; j < QTDE_TESTES_ALEATORIOS; j++)
+    {
+        int qtde = SERIE_TEMPERATURAS_QTDE_MIN_AMOSTRAS + (rand() % (QTDE_AMOSTRAS_JANELA - SERIE_TEMPERATURAS_QTDE_MIN_AMOSTRAS + 1));
+        double ruido = aleatorio_uniforme() * ((j % 4 == 0) ? 20.0 : 0.5);
+
+        temperatura = -40.0 + aleatorio_uniforme() * 160.0;
+        for (i = 0; i < qtde; i++)
+        {
+            temperatura += (aleatorio_uniforme() - 0.5) * ruido;
+            if (aleatorio_uniforme() < 0.01)
+            {
+                temperatura += (aleatorio_uniforme() - 0.5) * 60.0;
+            }
+            if (temperatura < -55.0)
+            {
+                temperatura = -55.0;
+            }
+            if (temperatura > 125.0)
+            {
+                temperatura = 125.0;
+            }
+            janela[i] = temperatura_x10(quantiza_ds18b20(temperatura));
+        }
+
+        snprintf(nome, sizeof(nome), "aleatorio %d", j);
+        falhas += (testa_ida_e_volta(janela, qtde, payloads_maximos[j % QTDE_PAYLOADS_MAXIMOS], nome) == false);
+        testes++;
+    }
+
+    printf("%d teste(s) de ida e volta, %d falha(s)\n", testes, falhas);
+    return (falhas == 0) ? 0 : 1;
+}
+
+/* Função: decodifica e mostra um quadro em hexadecimal
+ * Parâmetros: quadro em hexadecimal (aceita também a linha do log, "AT+SENDB=13:<quadro>")
+ * Retorno: 0: sucesso; 1: quadro inválido
+ */
+static int decodifica_quadro_hex(const char * pt_hex)
+{
+    uint8_t quadro[TAM_MAX_QUADRO];
+    int16_t amostras[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    unsigned int byte;
+    int tam_quadro = 0;
+    int qtde;
+    int passo;
+    int i;
+
+    if (strchr(pt_hex, ':') != NULL)
+    {
+        pt_hex = strrchr(pt_hex, ':') + 1;
+    }
+
+    while ((pt_hex[0] != '\0') && (pt_hex[1] != '\0') && (tam_quadro < TAM_MAX_QUADRO) && (sscanf(pt_hex, "%2x", &byte) == 1))
+    {
+        quadro[tam_quadro++] = (uint8_t)byte;
+        pt_hex += 2;
+    }
+
+    qtde = serie_temperaturas_decodifica(quadro, tam_quadro, amostras, SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS, &passo);
+    if (qtde < 0)
+    {
+        printf("Quadro invalido\n");
+        return 1;
+    }
+
+    printf("%d amostras (cada uma a media de %d leituras), %d bytes:\n", qtde, passo, tam_quadro);
+    for (i = 0; i < qtde; i++)
+    {
+        printf("%3d: %6.1f C\n", i, amostras[i] / 10.0);
+    }
+
+    return 0;
+}
+
+/* Função: lê uma série gravada
+ * Parâmetros: - nome do arquivo
+ *             - ponteiro para a série
+ * Retorno: 0: sucesso; -1: erro
+ */
+static int le_serie(const char * pt_arquivo, TSerie_temperaturas * pt_serie)
+{
+    FILE * arquivo = fopen(pt_arquivo, "r");
+    char linha[256];
+    char * pt_virgula;
+    double temperatura;
+
+    pt_serie->qtde = 0;
+    pt_serie->amostras_x10 = malloc(QTDE_MAX_AMOSTRAS_SERIE * sizeof(int16_t));
+    snprintf(pt_serie->nome, sizeof(pt_serie->nome), "%s", pt_arquivo);
+
+    if ((arquivo == NULL) || (pt_serie->amostras_x10 == NULL))
+    {
+        fprintf(stderr, "Nao foi possivel ler %s\n", pt_arquivo);
+        if (arquivo != NULL)
+        {
+            fclose(arquivo);
+        }
+        return -1;
+    }
+
+    while ((fgets(linha, sizeof(linha), arquivo) != NULL) && (pt_serie->qtde < QTDE_MAX_AMOSTRAS_SERIE))
+    {
+        pt_virgula = strchr(linha, ',');
+        if ((linha[0] == '#') || (sscanf((pt_virgula != NULL) ? (pt_virgula + 1) : linha, "%lf", &temperatura) != 1))
+        {
+            continue;
+        }
+
+        pt_serie->amostras_x10[pt_serie->qtde++] = temperatura_x10(temperatura);
+    }
+
+    fclose(arquivo);
+    return (pt_serie->qtde >= QTDE_AMOSTRAS_JANELA) ? 0 : -1;
+}
+
+/* Função: gera uma série sintética de 7 dias (uma leitura a cada 10 s)
+ * Parâmetros: - ponteiro para a série
+ *             - nome
+ *             - temperatura média (°C) e amplitude do ciclo diário (°C)
+ *             - ruído (°C, pico) e probabilidade por leitura de uma perturbação (ex: porta aberta)
+ * Retorno: 0: sucesso; -1: falta de memória
+ */
+static int gera_serie(TSerie_temperaturas * pt_serie, const char * pt_nome, double media, double amplitude,
+                      double ruido, double prob_perturbacao)
+{
+    int qtde = 7 * 24 * 360;
+    double perturbacao = 0.0;
+    double temperatura;
+    int i;
+
+    pt_serie->qtde = 0;
+    pt_serie->amostras_x10 = malloc(qtde * sizeof(int16_t));
+    snprintf(pt_serie->nome, sizeof(pt_serie->nome), "%s", pt_nome);
+
+    if (pt_serie->amostras_x10 == NULL)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < qtde; i++)
+    {
+        if (aleatorio_uniforme() < prob_perturbacao)
+        {
+            perturbacao = 3.0 + aleatorio_uniforme() * 5.0;
+        }
+        perturbacao *= 0.97;
+
+        temperatura = media + amplitude * sin(2.0 * M_PI * i / (24.0 * 360.0)) + perturbacao +
+                      ruido * (2.0 * aleatorio_uniforme() - 1.0);
+        pt_serie->amostras_x10[pt_serie->qtde++] = temperatura_x10(quantiza_ds18b20(temperatura));
+    }
+
+    return 0;
+}
+
+/* Função: mede bytes por amostra e erro de reconstrução de uma série, janela a janela
+ * Parâmetros: ponteiro para a série
+ * Retorno: nenhum
+ */
+static void mede_serie(const TSerie_temperaturas * pt_serie)
+{
+    uint8_t quadro[TAM_MAX_QUADRO];
+    int16_t decodificadas[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    const int16_t * pt_janela;
+    char rotulo[16];
+    int qtde_janelas = pt_serie->qtde / QTDE_AMOSTRAS_JANELA;
+    int qtde_series;
+    int tam_quadro;
+    int passo;
+    int qtde;
+    int janela;
+    int i;
+    int k;
+    long soma_bytes;
+    long soma_amostras;
+    long soma_passos;
+    double soma_erro;
+    double maior_erro;
+    double erro;
+
+    printf("\n%s (%d janelas de %d leituras)\n", pt_serie->nome, qtde_janelas, QTDE_AMOSTRAS_JANELA);
+    printf("  %8s %8s %9s %7s %11s %13s %10s %10s\n", "payload", "series", "amostras", "passo",
+           "bytes/leit.", "bits/amostra", "erro med", "erro max");
+
+    for (k = 0; k <= QTDE_PAYLOADS_MAXIMOS; k++)
+    {
+        /* Última linha: sem limite de payload (janela inteira) */
+        int tam_max = (k < QTDE_PAYLOADS_MAXIMOS) ? payloads_maximos[k] : TAM_MAX_QUADRO;
+
+        qtde_series = 0;
+        soma_bytes = 0;
+        soma_amostras = 0;
+        soma_passos = 0;
+        soma_erro = 0.0;
+        maior_erro = 0.0;
+
+        for (janela = 0; janela < qtde_janelas; janela++)
+        {
+            pt_janela = &pt_serie->amostras_x10[janela * QTDE_AMOSTRAS_JANELA];
+            tam_quadro = serie_temperaturas_codifica(pt_janela, QTDE_AMOSTRAS_JANELA, quadro, tam_max, &passo);
+            if (tam_quadro == 0)
+            {
+                continue;
+            }
+
+            qtde = serie_temperaturas_decodifica(quadro, tam_quadro, decodificadas, SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS, &passo);
+            qtde_series++;
+            soma_bytes += tam_quadro;
+            soma_amostras += qtde;
+            soma_passos += passo;
+
+            /* Erro de cada leitura em relação à amostra (média de bloco) que a representa */
+            for (i = 0; i < QTDE_AMOSTRAS_JANELA; i++)
+            {
+                erro = fabs((pt_janela[i] - decodificadas[i / passo]) / 10.0);
+                soma_erro += erro;
+                if (erro > maior_erro)
+                {
+                    maior_erro = erro;
+                }
+            }
+        }
+
+        if (k < QTDE_PAYLOADS_MAXIMOS)
+        {
+            snprintf(rotulo, sizeof(rotulo), "%d", tam_max);
+        }
+        else
+        {
+            snprintf(rotulo, sizeof(rotulo), "ilimit.");
+        }
+
+        if (qtde_series == 0)
+        {
+            printf("  %8s %7.1f%% %9s\n", rotulo, 0.0, "-");
+            continue;
+        }
+
+        printf("  %8s %7.1f%% %9.1f %7.1f %11.3f %13.2f %8.2f C %8.2f C\n", rotulo, 100.0 * qtde_series / qtde_janelas,
+               (double)soma_amostras / qtde_series, (double)soma_passos / qtde_series,
+               (double)soma_bytes / (qtde_series * (double)QTDE_AMOSTRAS_JANELA),
+               (8.0 * (soma_bytes - qtde_series * SERIE_TEMPERATURAS_TAM_CABECALHO)) / soma_amostras,
+               soma_erro / (qtde_series * (double)QTDE_AMOSTRAS_JANELA), maior_erro);
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    TSerie_temperaturas serie;
+    int i;
+
+    if ((argc == 3) && (strcmp(argv[1], "-d") == 0))
+    {
+        return decodifica_quadro_hex(argv[2]);
+    }
+
+    if ((argc == 2) && (strcmp(argv[1], "-t") == 0))
+    {
+        return executa_testes();
+    }
+
+    printf("Series de temperaturas: janelas de %d leituras (0,1 C); resumo atual: 4 bytes por janela\n", QTDE_AMOSTRAS_JANELA);
+
+    if (argc > 1)
+    {
+        for (i = 1; i < argc; i++)
+        {
+            if (le_serie(argv[i], &serie) == 0)
+            {
+                mede_serie(&serie);
+            }
+            free(serie.amostras_x10);
+        }
+        return 0;
+    }
+
+    srand(1);
+
+    if (gera_serie(&serie, "sintetica: ambiente interno (22 C, ciclo de 2 C)", 22.0, 2.0, 0.05, 0.0) == 0)
+    {
+        mede_serie(&serie);
+    }
+    free(serie.amostras_x10);
+
+    if (gera_serie(&serie, "sintetica: externo (20 C, ciclo de 8 C, ruido 0,3 C)", 20.0, 8.0, 0.3, 0.0) == 0)
+    {
+        mede_serie(&serie);
+    }
+    free(serie.amostras_x10);
+
+    if (gera_serie(&serie, "sintetica: refrigerador (4 C, portas abertas)", 4.0, 0.5, 0.05, 0.0005) == 0)
+    {
+        mede_serie(&serie);
+    }
+    free(serie.amostras_x10);
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+/* Ferramenta: decodifica log diferido em formato binário
+ *
+ * Com LOG_DIFERIDO_SAIDA_BINARIA = 1, o firmware escreve cada registro de
+ * log como uma linha "LOGD:<hex>" (instante, endereços da tag e da string
+ * de formato, nível e argumentos), sem formatar nada no ESP32. Esta
+ * ferramenta lê o log (entrada padrão), obtém as strings a partir do .elf
+ * do firmware (o mesmo que foi gravado no ESP32) e escreve o log em texto,
+ * usando a mesma formatação do firmware (log_diferido_formata()). Linhas
+ * que não são registros binários são repassadas sem alteração.
+ *
+ * Uso: decodifica_log_diferido <firmware.elf> < log.txt
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include "log_diferido.h"
+
+/* Definições - ELF */
+#define ELF_CLASSE_32         1
+#define ELF_CLASSE_64         2
+#define ELF_LITTLE_ENDIAN     1
+#define ELF_SECAO_NOBITS      8
+#define ELF_FLAG_ALLOC        0x2
+
+/* Definição - tamanhos máximos */
+#define TAM_MAX_LINHA         1024
+#define TAM_MAX_TEXTO         512
+#define QTDE_MAX_SECOES       256
+
+/* Definição - tamanho mínimo de um registro binário (sem argumentos) */
+#define TAM_MIN_REGISTRO      14
+
+/* Seção do .elf carregada na memória do ESP32 (com conteúdo no arquivo) */
+typedef struct
+{
+    uint64_t endereco;
+    uint64_t tamanho;
+    uint64_t offset;
+}TSecao_elf;
+
+/* Variáveis locais */
+static uint8_t * pt_elf = NULL;
+static long tam_elf = 0;
+static TSecao_elf secoes[QTDE_MAX_SECOES];
+static int qtde_secoes = 0;
+
+/* Funções locais */
+static uint64_t le_uint_le(const uint8_t * pt, int qtde_bytes);
+static int carrega_elf(const char * pt_nome_arquivo);
+static const char * resolve_string(uint32_t endereco);
+static int converte_hex(const char * pt_hex, uint8_t * pt_bytes, int tam_max);
+
+/* Função: lê inteiro little-endian de 1 a 8 bytes
+ * Parâmetros: ponteiro para os bytes e quantidade de bytes
+ * Retorno: valor lido
+ */
+static uint64_t le_uint_le(const uint8_t * pt, int qtde_bytes)
+{
+    uint64_t valor = 0;
+    int i;
+
+    for (i = qtde_bytes - 1; i >= 0; i--)
+    {
+        valor = (valor << 8) | pt[i];
+    }
+
+    return valor;
+}
+
+/* Função: carrega o .elf e a tabela de seções alocadas (ELF de 32 ou 64 bits, little-endian)
+ * Parâmetros: nome do arquivo .elf
+ * Retorno: 0: .elf carregado
+ *          -1: erro
+ */
+static int carrega_elf(const char * pt_nome_arquivo)
+{
+    FILE * pt_arquivo = fopen(pt_nome_arquivo, "rb");
+    uint64_t offset_secoes;
+    uint64_t flags;
+    uint32_t tipo;
+    int tam_entrada;
+    int qtde_entradas;
+    int eh_64_bits;
+    const uint8_t * pt_secao;
+    int i;
+
+    if (pt_arquivo == NULL)
+    {
+        perror(pt_nome_arquivo);
+        return -1;
+    }
+
+    fseek(pt_arquivo, 0, SEEK_END);
+    tam_elf = ftell(pt_arquivo);
+    fseek(pt_arquivo, 0, SEEK_SET);
+    pt_elf = malloc(tam_elf);
+
+    if ( (pt_elf == NULL) || (fread(pt_elf, 1, tam_elf, pt_arquivo) != (size_t)tam_elf) )
+    {
+        fprintf(stderr, "Falha ao ler %s\n", pt_nome_arquivo);
+        fclose(pt_arquivo);
+        return -1;
+    }
+
+    fclose(pt_arquivo);
+
+    if ( (tam_elf < 64) || (memcmp(pt_elf, "\x7F" "ELF", 4) != 0) || (pt_elf[5] != ELF_LITTLE_ENDIAN) )
+    {
+        fprintf(stderr, "%s nao e um ELF little-endian\n", pt_nome_arquivo);
+        return -1;
+    }
+
+    eh_64_bits = (pt_elf[4] == ELF_CLASSE_64);
+    offset_secoes = eh_64_bits ? le_uint_le(&pt_elf[0x28], 8) : le_uint_le(&pt_elf[0x20], 4);
+    tam_entrada = (int)le_uint_le(&pt_elf[eh_64_bits ? 0x3A : 0x2E], 2);
+    qtde_entradas = (int)le_uint_le(&pt_elf[eh_64_bits ? 0x3C : 0x30], 2);
+
+    for (i = 0; i < qtde_entradas; i++)
+    {
+        if ((offset_secoes + ((uint64_t)(i + 1) * tam_entrada)) > (uint64_t)tam_elf)
+        {
+            break;
+        }
+
+        pt_secao = &pt_elf[offset_secoes + ((uint64_t)i * tam_entrada)];
+        tipo = (uint32_t)le_uint_le(&pt_secao[4], 4);
+        flags = eh_64_bits ? le_uint_le(&pt_secao[8], 8) : le_uint_le(&pt_secao[8], 4);
+
+        if ( (tipo == ELF_SECAO_NOBITS) || ((flags & ELF_FLAG_ALLOC) == 0) || (qtde_secoes >= QTDE_MAX_SECOES) )
+        {
+            continue;
+        }
+
+        secoes[qtde_secoes].endereco = eh_64_bits ? le_uint_le(&pt_secao[0x10], 8) : le_uint_le(&pt_secao[0x0C], 4);
+        secoes[qtde_secoes].offset = eh_64_bits ? le_uint_le(&pt_secao[0x18], 8) : le_uint_le(&pt_secao[0x10], 4);
+        secoes[qtde_secoes].tamanho = eh_64_bits ? le_uint_le(&pt_secao[0x20], 8) : le_uint_le(&pt_secao[0x14], 4);
+
+        if ( (secoes[qtde_secoes].endereco != 0) &&
+             ((secoes[qtde_secoes].offset + secoes[qtde_secoes].tamanho) <= (uint64_t)tam_elf) )
+        {
+            qtde_secoes++;
+        }
+    }
+
+    return 0;
+}
+
+/* Função: obtém, no .elf, a string que estava num endereço do firmware
+ * Parâmetros: endereço da string
+ * Retorno: ponteiro para a string (NULL se o endereço não pertence a nenhuma
+ *          seção ou se a string não termina dentro da seção)
+ */
+static const char * resolve_string(uint32_t endereco)
+{
+    const char * pt_string;
+    uint64_t deslocamento;
+    int i;
+
+    for (i = 0; i < qtde_secoes; i++)
+    {
+        if ( (endereco >= secoes[i].endereco) && (endereco < (secoes[i].endereco + secoes[i].tamanho)) )
+        {
+            deslocamento = endereco - secoes[i].endereco;
+            pt_string = (const char *)&pt_elf[secoes[i].offset + deslocamento];
+
+            if (memchr(pt_string, 0x00, secoes[i].tamanho - deslocamento) == NULL)
+            {
+                return NULL;
+            }
+
+            return pt_string;
+        }
+    }
+
+    return NULL;
+}
+
+/* Função: converte string hexadecimal em bytes
+ * Parâmetros: - string hexadecimal
+ *             - ponteiro para os bytes e quantidade máxima de bytes
+ * Retorno: quantidade de bytes convertidos (-1 se a quantidade de dígitos é ímpar)
+ */
+static int converte_hex(const char * pt_hex, uint8_t * pt_bytes, int tam_max)
+{
+    unsigned int byte;
+    int qtde = 0;
+
+    while ( isxdigit((unsigned char)pt_hex[0]) && (qtde < tam_max) )
+    {
+        if (isxdigit((unsigned char)pt_hex[1]) == 0)
+        {
+            return -1;
+        }
+
+        sscanf(pt_hex, "%2x", &byte);
+        pt_bytes[qtde++] = (uint8_t)byte;
+        pt_hex += 2;
+    }
+
+    return qtde;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char letras_niveis[] = {'N', 'E', 'W', 'I', 'D'};
+    uint8_t registro[TAM_MIN_REGISTRO + (LOG_DIFERIDO_QTDE_MAX_ARGS * 4)];
+    uint32_t args[LOG_DIFERIDO_QTDE_MAX_ARGS];
+    char linha[TAM_MAX_LINHA];
+    char texto[TAM_MAX_TEXTO];
+    const char * pt_tag;
+    const char * pt_formato;
+    char * pt_hex;
+    int tam_registro;
+    int nivel;
+    int qtde_args;
+    int qtde_decodificados = 0;
+    int qtde_invalidos = 0;
+    int i;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Uso: %s <firmware.elf> < log.txt\n", argv[0]);
+        return 1;
+    }
+
+    if (carrega_elf(argv[1]) != 0)
+    {
+        return 1;
+    }
+
+    while (fgets(linha, sizeof(linha), stdin) != NULL)
+    {
+        pt_hex = strstr(linha, LOG_DIFERIDO_PREFIXO_BINARIO);
+
+        if (pt_hex == NULL)
+        {
+            fputs(linha, stdout);
+            continue;
+        }
+
+        tam_registro = converte_hex(pt_hex + strlen(LOG_DIFERIDO_PREFIXO_BINARIO), registro, sizeof(registro));
+        qtde_args = (tam_registro >= TAM_MIN_REGISTRO) ? registro[13] : -1;
+
+        if ( (qtde_args < 0) || (qtde_args > LOG_DIFERIDO_QTDE_MAX_ARGS) || (tam_registro != (TAM_MIN_REGISTRO + (qtde_args * 4))) )
+        {
+            printf("(registro invalido) %s", linha);
+            qtde_invalidos++;
+            continue;
+        }
+
+        for (i = 0; i < qtde_args; i++)
+        {
+            args[i] = (uint32_t)le_uint_le(&registro[TAM_MIN_REGISTRO + (i * 4)], 4);
+        }
+
+        pt_tag = resolve_string((uint32_t)le_uint_le(&registro[4], 4));
+        pt_formato = resolve_string((uint32_t)le_uint_le(&registro[8], 4));
+        nivel = (registro[12] <= LOG_DIFERIDO_NIVEL_DEBUG) ? registro[12] : LOG_DIFERIDO_NIVEL_DEBUG;
+
+        if (pt_formato == NULL)
+        {
+            printf("(formato nao encontrado no .elf: firmware diferente?) %s", linha);
+            qtde_invalidos++;
+            continue;
+        }
+
+        log_diferido_formata(texto, sizeof(texto), pt_formato, args, qtde_args, resolve_string);
+        printf("%c (%u) %s: %s\n",
+               letras_niveis[nivel],
+               (unsigned int)(le_uint_le(&registro[0], 4) / 1000),
+               (pt_tag != NULL) ? pt_tag : "?",
+               texto);
+        qtde_decodificados++;
+    }
+
+    fprintf(stderr, "%d registro(s) decodificado(s), %d invalido(s)\n", qtde_decodificados, qtde_invalidos);
+    free(pt_elf);
+    return (qtde_invalidos == 0) ? 0 : 1;
+}
@@ -0,0 +1,273 @@
+/* Ferramenta: decodifica quadros de lote de leituras do Cap7 (lixeira)
+ *
+ * Lê quadros em hexadecimal (argumentos da linha de comando ou, sem
+ * argumentos, linhas da entrada padrão) e mostra cada leitura do lote:
+ * número de sequência, idade em relação ao envio, distância e motivo.
+ * Linhas de log contendo o comando de envio na porta dos lotes
+ * ("AT+SENDB=6:...") são aceitas diretamente, de forma que o log inteiro
+ * pode ser passado pela entrada padrão.
+ *
+ * Com -t, executa um auto-teste: monta lotes com o código do firmware
+ * (fila_uplinks.c e lote_leituras.c), confere a decodificação e compara o
+ * tempo no ar por leitura (agendador_uplinks.c) do envio avulso, do quadro
+ * agrupado da fila e do quadro de lote.
+ *
+ * Formato do quadro: ver lote_leituras.h
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "lote_leituras.h"
+#include "agendador_uplinks.h"
+
+/* Definição - marcador do quadro nas linhas de log */
+#define MARCADOR_QUADRO_LOG     "AT+SENDB=6:"
+
+/* Definição - tamanho máximo de uma linha de entrada */
+#define TAM_MAX_LINHA           1024
+
+/* Definições - tamanho máximo de um quadro e parâmetros do auto-teste (DR2 em LA915) */
+#define TAM_MAX_QUADRO          64
+#define TAM_QUADRO_DR2          11
+#define DR_AUTO_TESTE           2
+#define TAM_LEITURA_AVULSA      2
+
+/* Nomes dos motivos das leituras */
+static const char * nomes_motivos[] = { "timer", "tamper", "tamper desfeito", "outro" };
+
+/* Funções locais */
+static int converte_hex(const char * pt_hex, uint8_t * pt_bytes, int tam_max);
+static int decodifica_quadro(const uint8_t * pt_quadro, int tamanho);
+static int auto_teste(void);
+
+/* Função: converte string hexadecimal em bytes (para no primeiro caractere
+ *         que não é hexadecimal)
+ * Parâmetros: - string hexadecimal
+ *             - ponteiro para os bytes e quantidade máxima de bytes
+ * Retorno: quantidade de bytes convertidos (-1 se a quantidade de dígitos é ímpar)
+ */
+static int converte_hex(const char * pt_hex, uint8_t * pt_bytes, int tam_max)
+{
+    unsigned int byte;
+    int qtde = 0;
+
+    while ( isxdigit((unsigned char)pt_hex[0]) && (qtde < tam_max) )
+    {
+        if (isxdigit((unsigned char)pt_hex[1]) == 0)
+        {
+            return -1;
+        }
+
+        sscanf(pt_hex, "%2x", &byte);
+        pt_bytes[qtde++] = (uint8_t)byte;
+        pt_hex += 2;
+    }
+
+    return qtde;
+}
+
+/* Função: decodifica e mostra um quadro de lote
+ * Parâmetros: - ponteiro para o quadro
+ *             - tamanho do quadro
+ * Retorno: 0: quadro válido
+ *          -1: quadro inválido
+ */
+static int decodifica_quadro(const uint8_t * pt_quadro, int tamanho)
+{
+    TLeitura_lote leituras[TAM_MAX_QUADRO / LOTE_LEITURAS_TAM_LEITURA];
+    int qtde_leituras;
+    int i;
+
+    qtde_leituras = lote_leituras_decodifica(pt_quadro, tamanho, leituras, sizeof(leituras) / sizeof(leituras[0]));
+
+    if (qtde_leituras < 0)
+    {
+        printf("Quadro invalido (%d bytes)\n", tamanho);
+        return -1;
+    }
+
+    printf("Lote com %d leitura(s), %d bytes:\n", qtde_leituras, tamanho);
+
+    for (i = 0; i < qtde_leituras; i++)
+    {
+        printf("  seq %3u  ha %5u min  ", leituras[i].seq, leituras[i].idade_min);
+
+        if (leituras[i].distancia_cm == 0xFF)
+        {
+            printf("distancia nao medida");
+        }
+        else
+        {
+            printf("distancia %3u cm    ", leituras[i].distancia_cm);
+        }
+
+        printf("  %s\n", nomes_motivos[leituras[i].motivo]);
+    }
+
+    return 0;
+}
+
+/* Função: auto-teste do formato de lote e comparação de tempo no ar
+ * Parâmetros: nenhum
+ * Retorno: 0: decodificação confere com as leituras montadas
+ *          1: divergência encontrada
+ */
+static int auto_teste(void)
+{
+    static TFila_uplinks fila;
+    TLeitura_lote leituras[TAM_QUADRO_DR2 / LOTE_LEITURAS_TAM_LEITURA];
+    uint8_t quadro[TAM_QUADRO_DR2];
+    uint8_t registro[LOTE_LEITURAS_TAM_LEITURA];
+    uint32_t instantes[LOTE_LEITURAS_QTDE_POR_ENVIO];
+    int32_t distancias[LOTE_LEITURAS_QTDE_POR_ENVIO];
+    uint8_t motivos[LOTE_LEITURAS_QTDE_POR_ENVIO];
+    uint32_t instante_s = 1700000000;
+    uint32_t tempo_no_ar_us;
+    int32_t erro_min;
+    int tam_quadro;
+    int qtde_leituras;
+    int qtde_decodificadas;
+    int falhas = 0;
+    int rodada;
+    int i;
+
+    srand(1);
+
+    /* Lotes com intervalos variados (wake-ups por timer, pulados pelo wake stub e por tamper) */
+    for (rodada = 0; rodada < 1000; rodada++)
+    {
+        memset(&fila, 0x00, sizeof(fila));
+        fila_uplinks_inicializa(&fila);
+
+        for (i = 0; i < LOTE_LEITURAS_QTDE_POR_ENVIO; i++)
+        {
+            instante_s += 60 + (rand() % (4 * 3600));
+            instantes[i] = instante_s;
+            /* Distâncias até 400 cm (alcance do HC-SR04) e leituras sem medição */
+            distancias[i] = ((rand() % 8) == 0) ? LOTE_LEITURAS_DISTANCIA_NAO_MEDIDA : (rand() % 401);
+            motivos[i] = (uint8_t)(rand() % 4);
+            lote_leituras_monta_registro(distancias[i], motivos[i], registro);
+            fila_uplinks_insere(&fila, registro, sizeof(registro), instante_s);
+        }
+
+        instante_s += rand() % 600;
+        tam_quadro = lote_leituras_monta_quadro(&fila, instante_s, quadro, sizeof(quadro), &qtde_leituras);
+        qtde_decodificadas = lote_leituras_decodifica(quadro, tam_quadro, leituras, sizeof(leituras) / sizeof(leituras[0]));
+
+        if (qtde_decodificadas != qtde_leituras)
+        {
+            falhas++;
+            continue;
+        }
+
+        for (i = 0; i < qtde_leituras; i++)
+        {
+            const TRegistro_uplink * pt_registro = fila_uplinks_consulta(&fila, i);
+            int32_t distancia_esperada = distancias[i];
+
+            /* Distância sem medição volta como 0xFF; acima de 254 cm, satura */
+            if (distancia_esperada == LOTE_LEITURAS_DISTANCIA_NAO_MEDIDA)
+            {
+                distancia_esperada = 0xFF;
+            }
+            else if (distancia_esperada > PAYLOAD_LEITURA_LOTE_DISTANCIA_CM_MAX)
+            {
+                distancia_esperada = PAYLOAD_LEITURA_LOTE_DISTANCIA_CM_MAX;
+            }
+
+            /* Idade com erro máximo de meia unidade, exceto quando o intervalo satura */
+            erro_min = (int32_t)leituras[i].idade_min - (int32_t)((instante_s - instantes[i]) / 60);
+
+            if ( (leituras[i].distancia_cm != distancia_esperada) ||
+                 (leituras[i].motivo != motivos[i]) ||
+                 (leituras[i].seq != (uint8_t)pt_registro->seq) ||
+                 (abs(erro_min) > LOTE_LEITURAS_UNIDADE_TEMPO_MIN) )
+            {
+                falhas++;
+                break;
+            }
+        }
+    }
+
+    printf("Auto-teste: %d lote(s) montados e decodificados, %d divergencia(s)\n\n", rodada, falhas);
+
+    /* Tempo no ar por leitura em DR2: avulso, quadro agrupado da fila e lote */
+    printf("Tempo no ar por leitura (DR%d, payload maximo de %d bytes):\n", DR_AUTO_TESTE, TAM_QUADRO_DR2);
+    printf("  %-24s %12s %10s %14s\n", "formato", "leituras", "bytes", "us/leitura");
+
+    tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(PLANO_LA915, DR_AUTO_TESTE, TAM_LEITURA_AVULSA);
+    printf("  %-24s %12d %10d %14u\n", "avulso (porta 5)", 1, TAM_LEITURA_AVULSA, tempo_no_ar_us);
+
+    qtde_leituras = (TAM_QUADRO_DR2 - FILA_UPLINKS_TAM_CABECALHO_QUADRO) / (FILA_UPLINKS_TAM_IDADE_REGISTRO + TAM_LEITURA_AVULSA);
+    tam_quadro = FILA_UPLINKS_TAM_CABECALHO_QUADRO + qtde_leituras * (FILA_UPLINKS_TAM_IDADE_REGISTRO + TAM_LEITURA_AVULSA);
+    tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(PLANO_LA915, DR_AUTO_TESTE, tam_quadro);
+    printf("  %-24s %12d %10d %14u\n", "agrupado da fila", qtde_leituras, tam_quadro, tempo_no_ar_us / qtde_leituras);
+
+    qtde_leituras = LOTE_LEITURAS_QTDE_POR_ENVIO;
+    tam_quadro = LOTE_LEITURAS_TAM_CABECALHO + qtde_leituras * LOTE_LEITURAS_TAM_LEITURA;
+    tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(PLANO_LA915, DR_AUTO_TESTE, tam_quadro);
+    printf("  %-24s %12d %10d %14u\n", "lote (porta 6)", qtde_leituras, tam_quadro, tempo_no_ar_us / qtde_leituras);
+
+    return (falhas == 0) ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t quadro[TAM_MAX_QUADRO];
+    char linha[TAM_MAX_LINHA];
+    char * pt_hex;
+    int tamanho;
+    int qtde_quadros = 0;
+    int qtde_invalidos = 0;
+    int i;
+
+    if ((argc == 2) && (strcmp(argv[1], "-t") == 0))
+    {
+        return auto_teste();
+    }
+
+    if (argc > 1)
+    {
+        for (i = 1; i < argc; i++)
+        {
+            tamanho = converte_hex(argv[i], quadro, sizeof(quadro));
+            qtde_quadros++;
+            if ( (tamanho < 0) || (decodifica_quadro(quadro, tamanho) != 0) )
+            {
+                qtde_invalidos++;
+            }
+        }
+    }
+    else
+    {
+        while (fgets(linha, sizeof(linha), stdin) != NULL)
+        {
+            pt_hex = strstr(linha, MARCADOR_QUADRO_LOG);
+            pt_hex = (pt_hex != NULL) ? (pt_hex + strlen(MARCADOR_QUADRO_LOG)) : linha;
+
+            if (isxdigit((unsigned char)pt_hex[0]) == 0)
+            {
+                continue;
+            }
+
+            tamanho = converte_hex(pt_hex, quadro, sizeof(quadro));
+            qtde_quadros++;
+            if ( (tamanho < 0) || (decodifica_quadro(quadro, tamanho) != 0) )
+            {
+                qtde_invalidos++;
+            }
+        }
+    }
+
+    if (qtde_quadros == 0)
+    {
+        fprintf(stderr, "Uso: %s [-t | quadro em hexadecimal ...]  (ou log pela entrada padrao)\n", argv[0]);
+        return 1;
+    }
+
+    return (qtde_invalidos == 0) ? 0 : 1;
+}
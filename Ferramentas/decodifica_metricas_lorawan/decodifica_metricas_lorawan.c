@@ -0,0 +1,222 @@
+/* Ferramenta: decodifica snapshots binários das métricas LoRaWAN
+ *
+ * Lê snapshots em hexadecimal (argumentos da linha de comando ou, sem
+ * argumentos, linhas da entrada padrão) e mostra os contadores e os
+ * histogramas de latência por tipo de comando. Linhas de log contendo
+ * "Snapshot das metricas: " (loga_metricas_lorawan()) são aceitas
+ * diretamente, de forma que o log inteiro pode ser passado pela entrada
+ * padrão.
+ *
+ * Formato do snapshot: ver metricas_lorawan.h
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include "metricas_lorawan.h"
+
+/* Definição - marcador do snapshot nas linhas de log */
+#define MARCADOR_SNAPSHOT_LOG   "Snapshot das metricas: "
+
+/* Definição - tamanho máximo de uma linha de entrada */
+#define TAM_MAX_LINHA           1024
+
+/* Nomes dos tipos de comando e das faixas de latência */
+static const char * nomes_tipos_cmd[METRICAS_LORAWAN_QTDE_TIPOS_CMD] = {
+    "configuracao", "consulta", "envio", "join", "outros"
+};
+
+static const char * nomes_faixas[METRICAS_LORAWAN_QTDE_FAIXAS] = {
+    "<=20ms", "<=50ms", "<=100ms", "<=200ms", "<=500ms", "<=1s", "<=2s", ">2s"
+};
+
+/* Funções locais */
+static int converte_hex(const char * pt_hex, uint8_t * pt_bytes, int tam_max);
+static uint32_t le_uint16(const uint8_t * pt);
+static uint32_t le_uint32(const uint8_t * pt);
+static int decodifica_snapshot(const uint8_t * pt_snapshot, int tamanho);
+
+/* Função: converte string hexadecimal em bytes (para no primeiro caractere
+ *         que não é hexadecimal)
+ * Parâmetros: - string hexadecimal
+ *             - ponteiro para os bytes e quantidade máxima de bytes
+ * Retorno: quantidade de bytes convertidos (-1 se a quantidade de dígitos é ímpar)
+ */
+static int converte_hex(const char * pt_hex, uint8_t * pt_bytes, int tam_max)
+{
+    unsigned int byte;
+    int qtde = 0;
+
+    while ( isxdigit((unsigned char)pt_hex[0]) && (qtde < tam_max) )
+    {
+        if (isxdigit((unsigned char)pt_hex[1]) == 0)
+        {
+            return -1;
+        }
+
+        sscanf(pt_hex, "%2x", &byte);
+        pt_bytes[qtde++] = (uint8_t)byte;
+        pt_hex += 2;
+    }
+
+    return qtde;
+}
+
+/* Função: lê uint16 little-endian
+ * Parâmetros: ponteiro para os bytes
+ * Retorno: valor lido
+ */
+static uint32_t le_uint16(const uint8_t * pt)
+{
+    return (uint32_t)pt[0] | ((uint32_t)pt[1] << 8);
+}
+
+/* Função: lê uint32 little-endian
+ * Parâmetros: ponteiro para os bytes
+ * Retorno: valor lido
+ */
+static uint32_t le_uint32(const uint8_t * pt)
+{
+    return le_uint16(pt) | (le_uint16(&pt[2]) << 16);
+}
+
+/* Função: decodifica e mostra um snapshot
+ * Parâmetros: ponteiro para o snapshot e seu tamanho
+ * Retorno: 0: snapshot decodificado
+ *          -1: snapshot inválido
+ */
+static int decodifica_snapshot(const uint8_t * pt_snapshot, int tamanho)
+{
+    const uint8_t * pt_histograma;
+    uint8_t mascara;
+    uint32_t soma;
+    int tam_esperado = METRICAS_LORAWAN_TAM_CABECALHO_SNAPSHOT;
+    int tipo;
+    int faixa;
+
+    if (tamanho < METRICAS_LORAWAN_TAM_CABECALHO_SNAPSHOT)
+    {
+        printf("Snapshot invalido: %d bytes (minimo: %d)\n", tamanho, METRICAS_LORAWAN_TAM_CABECALHO_SNAPSHOT);
+        return -1;
+    }
+
+    if (pt_snapshot[0] != METRICAS_LORAWAN_VERSAO_SNAPSHOT)
+    {
+        printf("Versao de snapshot desconhecida: %d\n", pt_snapshot[0]);
+        return -1;
+    }
+
+    mascara = pt_snapshot[1];
+    for (tipo = 0; tipo < METRICAS_LORAWAN_QTDE_TIPOS_CMD; tipo++)
+    {
+        if (mascara & (1 << tipo))
+        {
+            tam_esperado += METRICAS_LORAWAN_QTDE_FAIXAS;
+        }
+    }
+
+    if ( (tamanho != tam_esperado) || (mascara >> METRICAS_LORAWAN_QTDE_TIPOS_CMD) )
+    {
+        printf("Snapshot invalido: %d bytes, esperados %d pela mascara 0x%02X\n", tamanho, tam_esperado, mascara);
+        return -1;
+    }
+
+    printf("Comandos: %u (OK: %u, erros: %u, BUSY: %u, timeouts: %u)\n",
+           le_uint16(&pt_snapshot[2]),
+           le_uint16(&pt_snapshot[4]),
+           le_uint16(&pt_snapshot[6]),
+           le_uint16(&pt_snapshot[8]),
+           le_uint16(&pt_snapshot[10]));
+    printf("UART: %u bytes escritos, %u bytes lidos, %u overflows\n",
+           le_uint32(&pt_snapshot[14]),
+           le_uint32(&pt_snapshot[18]),
+           le_uint16(&pt_snapshot[12]));
+
+    printf("%-14s", "latencia");
+    for (faixa = 0; faixa < METRICAS_LORAWAN_QTDE_FAIXAS; faixa++)
+    {
+        printf("%8s", nomes_faixas[faixa]);
+    }
+    printf("%8s\n", "total");
+
+    pt_histograma = &pt_snapshot[METRICAS_LORAWAN_TAM_CABECALHO_SNAPSHOT];
+    for (tipo = 0; tipo < METRICAS_LORAWAN_QTDE_TIPOS_CMD; tipo++)
+    {
+        if ((mascara & (1 << tipo)) == 0)
+        {
+            continue;
+        }
+
+        soma = 0;
+        printf("%-14s", nomes_tipos_cmd[tipo]);
+        for (faixa = 0; faixa < METRICAS_LORAWAN_QTDE_FAIXAS; faixa++)
+        {
+            printf("%7u%c", pt_histograma[faixa], (pt_histograma[faixa] == 0xFF) ? '+' : ' ');
+            soma += pt_histograma[faixa];
+        }
+        printf("%7u\n", soma);
+
+        pt_histograma += METRICAS_LORAWAN_QTDE_FAIXAS;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t snapshot[METRICAS_LORAWAN_TAM_MAX_SNAPSHOT + 1];
+    char linha[TAM_MAX_LINHA];
+    char * pt_hex;
+    int tamanho;
+    int qtde_snapshots = 0;
+    int qtde_invalidos = 0;
+    int i;
+
+    if (argc > 1)
+    {
+        for (i = 1; i < argc; i++)
+        {
+            tamanho = converte_hex(argv[i], snapshot, sizeof(snapshot));
+            qtde_snapshots++;
+            if ( (tamanho < 0) || (decodifica_snapshot(snapshot, tamanho) != 0) )
+            {
+                qtde_invalidos++;
+            }
+        }
+    }
+    else
+    {
+        while (fgets(linha, sizeof(linha), stdin) != NULL)
+        {
+            pt_hex = strstr(linha, MARCADOR_SNAPSHOT_LOG);
+            pt_hex = (pt_hex != NULL) ? (pt_hex + strlen(MARCADOR_SNAPSHOT_LOG)) : linha;
+
+            if (isxdigit((unsigned char)pt_hex[0]) == 0)
+            {
+                continue;
+            }
+
+            if (qtde_snapshots > 0)
+            {
+                printf("\n");
+            }
+
+            tamanho = converte_hex(pt_hex, snapshot, sizeof(snapshot));
+            qtde_snapshots++;
+            if ( (tamanho < 0) || (decodifica_snapshot(snapshot, tamanho) != 0) )
+            {
+                qtde_invalidos++;
+            }
+        }
+    }
+
+    if (qtde_snapshots == 0)
+    {
+        fprintf(stderr, "Uso: %s [snapshot em hexadecimal ...]  (ou log pela entrada padrao)\n", argv[0]);
+        return 1;
+    }
+
+    return (qtde_invalidos == 0) ? 0 : 1;
+}
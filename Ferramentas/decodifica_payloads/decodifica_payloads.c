@@ -0,0 +1,537 @@
+/* Ferramenta: decoder genérico dos payloads LoRaWAN descritos nos esquemas
+ *
+ * Usa os módulos gerados por gera_payloads (payloads.c) dos projetos dos
+ * capítulos 6, 7 e 8 para:
+ * - decodificar payloads recebidos, campo a campo, pela tabela de payloads
+ *   da aplicação;
+ * - testar ida e volta dos payloads (empacota/desempacota) com valores
+ *   aleatórios, inclusive fora da faixa dos campos, e comparar o custo de
+ *   empacotamento e o tamanho com o empacotamento manual anterior de cada
+ *   aplicação.
+ *
+ * Uso: decodifica_payloads -a <cap6|cap7|cap8> <porta> <payload em hexadecimal>
+ *      decodifica_payloads -a <cap6|cap7|cap8> <AT+SENDB=porta:payload>
+ *      decodifica_payloads -a <cap6|cap7|cap8>            (linhas de log na entrada padrão)
+ *      decodifica_payloads -t
+ * Retorno (-t): 0 se todos os testes passaram, 1 caso contrário
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "Cap6/contador_pulsos_lorawan/main/payloads/payloads.h"
+#include "Cap7/Software/lixo_lorawan/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/payloads/payloads.h"
+
+/* Definições - limites da ferramenta */
+#define TAM_MAX_QUADRO          242
+#define TAM_MAX_LINHA           1024
+#define QTDE_MAX_CAMPOS         24
+
+/* Definições - testes */
+#define QTDE_TESTES_IDA_VOLTA   200000
+#define QTDE_REPETICOES_TEMPO   5000000
+
+/* Aplicação: tabela de payloads gerada a partir do esquema */
+typedef struct
+{
+    const char * pt_nome;
+    const TEsquema_payload * pt_payloads;
+    int qtde_payloads;
+}TAplicacao;
+
+static const TAplicacao aplicacoes[] =
+{
+    { "cap6", payloads_cap6, QTDE_PAYLOADS_CAP6 },
+    { "cap7", payloads_cap7, QTDE_PAYLOADS_CAP7 },
+    { "cap8", payloads_cap8, QTDE_PAYLOADS_CAP8 },
+};
+
+#define QTDE_APLICACOES  ((int)(sizeof(aplicacoes) / sizeof(aplicacoes[0])))
+
+/* Resultado da comparação de uma aplicação (empacotamento manual anterior x esquema) */
+typedef struct
+{
+    const char * pt_aplicacao;
+    const char * pt_payload;
+    int tam_manual;
+    int tam_esquema;
+    double ns_manual;
+    double ns_esquema;
+    const char * pt_grandeza;
+    double erro_max_manual;
+    double erro_max_esquema;
+}TComparacao;
+
+/* Acumulador dos bytes empacotados (impede que o compilador elimine os laços de tempo) */
+static volatile uint32_t soma_bytes;
+
+/* Função: gera número aleatório uniforme em [min, max]
+ * Parâmetros: valores mínimo e máximo
+ * Retorno: número gerado
+ */
+static double aleatorio(double min, double max)
+{
+    return min + ((double)rand() / (double)RAND_MAX) * (max - min);
+}
+
+/* Função: lê o relógio monotônico
+ * Parâmetros: nenhum
+ * Retorno: instante em nanossegundos
+ */
+static double instante_ns(void)
+{
+    struct timespec agora;
+
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return (agora.tv_sec * 1e9) + agora.tv_nsec;
+}
+
+/* Função: mostra os campos de um payload/registro decodificado
+ * Parâmetros: - payload
+ *             - bytes do payload
+ * Retorno: nenhum
+ */
+static void mostra_campos(const TEsquema_payload * pt_payload, const uint8_t * pt_quadro)
+{
+    double valores[QTDE_MAX_CAMPOS];
+    int i;
+
+    pt_payload->decodifica(pt_quadro, valores);
+    for (i = 0; i < pt_payload->qtde_campos; i++)
+    {
+        if (isnan(valores[i]))
+        {
+            printf("  %-16s %12s\n", pt_payload->pt_campos[i].pt_nome, "sem valor");
+        }
+        else
+        {
+            printf("  %-16s %12g %s\n", pt_payload->pt_campos[i].pt_nome, valores[i], pt_payload->pt_campos[i].pt_unidade);
+        }
+    }
+}
+
+/* Função: decodifica um payload pela tabela da aplicação
+ * Parâmetros: - aplicação
+ *             - porta LoRaWAN
+ *             - payload em hexadecimal
+ * Retorno: 0: sucesso; 1: porta desconhecida ou tamanho inválido
+ */
+static int decodifica_payload(const TAplicacao * pt_aplicacao, int porta, const char * pt_hex)
+{
+    const TEsquema_payload * pt_payload = NULL;
+    const TEsquema_payload * pt_registro;
+    uint8_t quadro[TAM_MAX_QUADRO];
+    unsigned int byte;
+    int tam_quadro = 0;
+    int deslocamento;
+    int i;
+
+    while ((pt_hex[0] != '\0') && (pt_hex[1] != '\0') && (tam_quadro < TAM_MAX_QUADRO) && (sscanf(pt_hex, "%2x", &byte) == 1))
+    {
+        quadro[tam_quadro++] = (uint8_t)byte;
+        pt_hex += 2;
+    }
+
+    for (i = 0; i < pt_aplicacao->qtde_payloads; i++)
+    {
+        if (pt_aplicacao->pt_payloads[i].porta == porta)
+        {
+            pt_payload = &pt_aplicacao->pt_payloads[i];
+        }
+    }
+
+    if (pt_payload == NULL)
+    {
+        printf("Porta %d: nenhum payload do esquema %s\n", porta, pt_aplicacao->pt_nome);
+        return 1;
+    }
+
+    pt_registro = (pt_payload->idx_repetido >= 0) ? &pt_aplicacao->pt_payloads[pt_payload->idx_repetido] : NULL;
+
+    if ( (tam_quadro < pt_payload->tam) ||
+         ((pt_registro == NULL) && (tam_quadro != pt_payload->tam)) ||
+         ((pt_registro != NULL) && (((tam_quadro - pt_payload->tam) % pt_registro->tam) != 0)) )
+    {
+        printf("Porta %d: payload %s com tamanho invalido (%d bytes)\n", porta, pt_payload->pt_nome, tam_quadro);
+        return 1;
+    }
+
+    printf("Porta %d: %s (%d bytes)\n", porta, pt_payload->pt_nome, tam_quadro);
+    mostra_campos(pt_payload, quadro);
+
+    for (deslocamento = pt_payload->tam, i = 0; (pt_registro != NULL) && (deslocamento < tam_quadro); deslocamento += pt_registro->tam, i++)
+    {
+        printf(" %s #%d:\n", pt_registro->pt_nome, i);
+        mostra_campos(pt_registro, &quadro[deslocamento]);
+    }
+
+    return 0;
+}
+
+/* Função: decodifica uma linha com o comando de envio (AT+SENDB=porta:payload)
+ * Parâmetros: - aplicação
+ *             - linha
+ * Retorno: 0: sucesso ou linha sem envio; 1: payload inválido
+ */
+static int decodifica_linha(const TAplicacao * pt_aplicacao, const char * pt_linha)
+{
+    const char * pt_envio = strstr(pt_linha, "AT+SENDB=");
+    char hex[TAM_MAX_LINHA];
+    int porta;
+
+    if ((pt_envio == NULL) || (sscanf(pt_envio, "AT+SENDB=%d:%1000[0-9A-Fa-f]", &porta, hex) != 2))
+    {
+        return 0;
+    }
+
+    return decodifica_payload(pt_aplicacao, porta, hex);
+}
+
+/* Função: compara o contador de pulsos (cap6): cópia dos bytes do uint32_t
+ *         (ordem dos bytes do processador) x payload contadores
+ * Parâmetros: ponteiro para o resultado
+ * Retorno: quantidade de falhas na ida e volta
+ */
+static int compara_cap6(TComparacao * pt_comparacao)
+{
+    TPayload_contadores contadores;
+    TPayload_contadores decodificados;
+    uint8_t quadro[PAYLOAD_CONTADORES_TAM];
+    uint32_t contador_1;
+    uint32_t contador_2;
+    char * pt_byte_contador;
+    double inicio;
+    int falhas = 0;
+    int i;
+    int j;
+
+    for (i = 0; i < QTDE_TESTES_IDA_VOLTA; i++)
+    {
+        contadores.contador_1 = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        contadores.contador_2 = (i % 2 == 0) ? 0xFFFFFFFFU : (uint32_t)rand();
+        payload_contadores_empacota(&contadores, quadro);
+        payload_contadores_desempacota(quadro, &decodificados);
+
+        if ( (decodificados.contador_1 != contadores.contador_1) || (decodificados.contador_2 != contadores.contador_2) ||
+             (quadro[0] != (uint8_t)(contadores.contador_1 >> 24)) )
+        {
+            falhas++;
+        }
+    }
+
+    /* Empacotamento manual anterior (envios_lorawan.c) */
+    inicio = instante_ns();
+    for (i = 0; i < QTDE_REPETICOES_TEMPO; i++)
+    {
+        contador_1 = (uint32_t)i;
+        contador_2 = (uint32_t)i * 3;
+        pt_byte_contador = (char *)&contador_1;
+        for (j = 0; j < 4; j++)
+        {
+            quadro[j] = (uint8_t)*pt_byte_contador++;
+        }
+        pt_byte_contador = (char *)&contador_2;
+        for (j = 4; j < 8; j++)
+        {
+            quadro[j] = (uint8_t)*pt_byte_contador++;
+        }
+        soma_bytes += quadro[0] + quadro[7];
+    }
+    pt_comparacao->ns_manual = (instante_ns() - inicio) / QTDE_REPETICOES_TEMPO;
+
+    inicio = instante_ns();
+    for (i = 0; i < QTDE_REPETICOES_TEMPO; i++)
+    {
+        contadores.contador_1 = (uint32_t)i;
+        contadores.contador_2 = (uint32_t)i * 3;
+        payload_contadores_empacota(&contadores, quadro);
+        soma_bytes += quadro[0] + quadro[7];
+    }
+    pt_comparacao->ns_esquema = (instante_ns() - inicio) / QTDE_REPETICOES_TEMPO;
+
+    pt_comparacao->pt_aplicacao = "cap6";
+    pt_comparacao->pt_payload = "contadores";
+    pt_comparacao->tam_manual = 8;
+    pt_comparacao->tam_esquema = PAYLOAD_CONTADORES_TAM;
+    pt_comparacao->pt_grandeza = "pulsos";
+    pt_comparacao->erro_max_manual = 0.0;
+    pt_comparacao->erro_max_esquema = 0.0;
+
+    return falhas;
+}
+
+/* Função: compara a leitura da lixeira (cap7): distância convertida para
+ *         uint8_t (dá a volta acima de 255 cm) x registro leitura_lote (satura)
+ * Parâmetros: ponteiro para o resultado
+ * Retorno: quantidade de falhas na ida e volta
+ */
+static int compara_cap7(TComparacao * pt_comparacao)
+{
+    TPayload_leitura_lote leitura;
+    TPayload_leitura_lote decodificada;
+    TPayload_lote_leituras cabecalho;
+    TPayload_lote_leituras cabecalho_decodificado;
+    uint8_t quadro[PAYLOAD_LOTE_LEITURAS_TAM + PAYLOAD_LEITURA_LOTE_TAM];
+    float distancia_cm;
+    double erro;
+    double inicio;
+    int falhas = 0;
+    int i;
+
+    pt_comparacao->erro_max_manual = 0.0;
+    pt_comparacao->erro_max_esquema = 0.0;
+
+    /* Distâncias até o alcance do HC-SR04 (400 cm); o esquema satura em 254 cm */
+    for (i = 0; i < QTDE_TESTES_IDA_VOLTA; i++)
+    {
+        distancia_cm = (float)aleatorio(0.0, 400.0);
+        leitura.distancia_cm = ((i % 16) == 0) ? ESQUEMA_PAYLOADS_SEM_VALOR : (int32_t)lroundf(distancia_cm);
+        leitura.motivo = rand() % 6 - 1;
+        leitura.intervalo = (float)aleatorio(-10.0, 400.0);
+        payload_leitura_lote_empacota(&leitura, quadro);
+        payload_leitura_lote_desempacota(quadro, &decodificada);
+
+        if (leitura.distancia_cm == ESQUEMA_PAYLOADS_SEM_VALOR)
+        {
+            falhas += (decodificada.distancia_cm != ESQUEMA_PAYLOADS_SEM_VALOR);
+        }
+        else
+        {
+            falhas += (decodificada.distancia_cm != ((leitura.distancia_cm > PAYLOAD_LEITURA_LOTE_DISTANCIA_CM_MAX) ?
+                                                     PAYLOAD_LEITURA_LOTE_DISTANCIA_CM_MAX : leitura.distancia_cm));
+
+            /* Erro em relação à distância medida, dentro da faixa do campo */
+            if (distancia_cm <= PAYLOAD_LEITURA_LOTE_DISTANCIA_CM_MAX)
+            {
+                erro = fabs(decodificada.distancia_cm - distancia_cm);
+                pt_comparacao->erro_max_esquema = (erro > pt_comparacao->erro_max_esquema) ? erro : pt_comparacao->erro_max_esquema;
+
+                erro = fabs((uint8_t)distancia_cm - distancia_cm);
+                pt_comparacao->erro_max_manual = (erro > pt_comparacao->erro_max_manual) ? erro : pt_comparacao->erro_max_manual;
+            }
+        }
+
+        falhas += (decodificada.motivo != ((leitura.motivo < 0) ? 0 : ((leitura.motivo > PAYLOAD_LEITURA_LOTE_MOTIVO_MAX) ? PAYLOAD_LEITURA_LOTE_MOTIVO_MAX : leitura.motivo)));
+        falhas += (fabsf(decodificada.intervalo - ((leitura.intervalo < 0.0f) ? 0.0f : ((leitura.intervalo > 315.0f) ? 315.0f : leitura.intervalo))) > 2.5f);
+
+        cabecalho.seq = rand() % 256;
+        cabecalho.idade = (float)aleatorio(0.0, 2000.0);
+        payload_lote_leituras_empacota(&cabecalho, quadro);
+        payload_lote_leituras_desempacota(quadro, &cabecalho_decodificado);
+        falhas += (cabecalho_decodificado.seq != cabecalho.seq);
+        falhas += (fabsf(cabecalho_decodificado.idade - ((cabecalho.idade > 1275.0f) ? 1275.0f : cabecalho.idade)) > 2.5f);
+    }
+
+    /* Empacotamento manual anterior (lote_leituras.c): cópia dos bytes do registro */
+    inicio = instante_ns();
+    for (i = 0; i < QTDE_REPETICOES_TEMPO; i++)
+    {
+        distancia_cm = (float)(i & 0xFF);
+        quadro[0] = (uint8_t)(i & 0xFF);
+        quadro[1] = (uint8_t)(i >> 8);
+        quadro[2] = (uint8_t)distancia_cm;
+        quadro[3] = (uint8_t)(((i & 0x03) << 6) | (i & 0x3F));
+        soma_bytes += quadro[2] + quadro[3];
+    }
+    pt_comparacao->ns_manual = (instante_ns() - inicio) / QTDE_REPETICOES_TEMPO;
+
+    inicio = instante_ns();
+    for (i = 0; i < QTDE_REPETICOES_TEMPO; i++)
+    {
+        cabecalho.seq = i & 0xFF;
+        cabecalho.idade = (float)((i >> 8) & 0xFF);
+        leitura.distancia_cm = i & 0xFF;
+        leitura.motivo = i & 0x03;
+        leitura.intervalo = (float)(i & 0x3F);
+        payload_lote_leituras_empacota(&cabecalho, quadro);
+        payload_leitura_lote_empacota(&leitura, &quadro[PAYLOAD_LOTE_LEITURAS_TAM]);
+        soma_bytes += quadro[2] + quadro[3];
+    }
+    pt_comparacao->ns_esquema = (instante_ns() - inicio) / QTDE_REPETICOES_TEMPO;
+
+    pt_comparacao->pt_aplicacao = "cap7";
+    pt_comparacao->pt_payload = "lote (1 leitura)";
+    pt_comparacao->tam_manual = 4;
+    pt_comparacao->tam_esquema = PAYLOAD_LOTE_LEITURAS_TAM + PAYLOAD_LEITURA_LOTE_TAM;
+    pt_comparacao->pt_grandeza = "cm";
+
+    return falhas;
+}
+
+/* Função: compara o resumo de temperaturas (cap8): int8_t[4] com graus
+ *         inteiros truncados e desvio x10 x payload resumo_temperaturas
+ * Parâmetros: ponteiro para o resultado
+ * Retorno: quantidade de falhas na ida e volta
+ */
+static int compara_cap8(TComparacao * pt_comparacao)
+{
+    TPayload_resumo_temperaturas resumo;
+    TPayload_resumo_temperaturas decodificado;
+    uint8_t quadro[PAYLOAD_RESUMO_TEMPERATURAS_TAM];
+    int8_t resumo_manual[4];
+    double erro;
+    double inicio;
+    int falhas = 0;
+    int i;
+
+    pt_comparacao->erro_max_manual = 0.0;
+    pt_comparacao->erro_max_esquema = 0.0;
+
+    /* Temperaturas na faixa do DS18B20 (-55 a 125 C) e desvios até 7 C */
+    for (i = 0; i < QTDE_TESTES_IDA_VOLTA; i++)
+    {
+        resumo.minima = (float)aleatorio(-55.0, 125.0);
+        resumo.maxima = (float)aleatorio(resumo.minima, 125.0);
+        resumo.media = (float)aleatorio(resumo.minima, resumo.maxima);
+        resumo.desvio_padrao = (float)aleatorio(0.0, 7.0);
+        payload_resumo_temperaturas_empacota(&resumo, quadro);
+        payload_resumo_temperaturas_desempacota(quadro, &decodificado);
+
+        /* Meio passo do campo: 0,25 C nas temperaturas e 0,125 C no desvio padrão */
+        erro = fabsf(decodificado.media - resumo.media);
+        erro = fmax(erro, fabsf(decodificado.minima - resumo.minima));
+        erro = fmax(erro, fabsf(decodificado.maxima - resumo.maxima));
+        falhas += (erro > 0.2501) || (fabsf(decodificado.desvio_padrao - resumo.desvio_padrao) > 0.1251f);
+        pt_comparacao->erro_max_esquema = fmax(erro, pt_comparacao->erro_max_esquema);
+
+        /* Manual anterior: graus inteiros (truncados) */
+        resumo_manual[0] = (int8_t)resumo.media;
+        resumo_manual[1] = (int8_t)resumo.minima;
+        resumo_manual[2] = (int8_t)resumo.maxima;
+        erro = fabs(resumo_manual[0] - resumo.media);
+        erro = fmax(erro, fabs(resumo_manual[1] - resumo.minima));
+        erro = fmax(erro, fabs(resumo_manual[2] - resumo.maxima));
+        pt_comparacao->erro_max_manual = fmax(erro, pt_comparacao->erro_max_manual);
+    }
+
+    /* Fora da faixa: satura, não dá a volta */
+    resumo.media = 300.0f;
+    resumo.minima = -300.0f;
+    resumo.maxima = NAN;
+    resumo.desvio_padrao = 20.0f;
+    payload_resumo_temperaturas_empacota(&resumo, quadro);
+    payload_resumo_temperaturas_desempacota(quadro, &decodificado);
+    falhas += (decodificado.media != 200.5f) || (decodificado.minima != -55.0f) || (decodificado.desvio_padrao != 7.75f);
+
+    inicio = instante_ns();
+    for (i = 0; i < QTDE_REPETICOES_TEMPO; i++)
+    {
+        resumo_manual[0] = (int8_t)(i & 0x3F);
+        resumo_manual[1] = (int8_t)((i & 0x3F) - 5);
+        resumo_manual[2] = (int8_t)((i & 0x3F) + 5);
+        resumo_manual[3] = (int8_t)(i & 0x1F);
+        memcpy(quadro, resumo_manual, sizeof(quadro));
+        soma_bytes += quadro[0] + quadro[3];
+    }
+    pt_comparacao->ns_manual = (instante_ns() - inicio) / QTDE_REPETICOES_TEMPO;
+
+    inicio = instante_ns();
+    for (i = 0; i < QTDE_REPETICOES_TEMPO; i++)
+    {
+        resumo.media = (float)(i & 0x3F);
+        resumo.minima = resumo.media - 5.0f;
+        resumo.maxima = resumo.media + 5.0f;
+        resumo.desvio_padrao = (float)(i & 0x1F) / 10.0f;
+        payload_resumo_temperaturas_empacota(&resumo, quadro);
+        soma_bytes += quadro[0] + quadro[3];
+    }
+    pt_comparacao->ns_esquema = (instante_ns() - inicio) / QTDE_REPETICOES_TEMPO;
+
+    pt_comparacao->pt_aplicacao = "cap8";
+    pt_comparacao->pt_payload = "resumo_temperaturas";
+    pt_comparacao->tam_manual = 4;
+    pt_comparacao->tam_esquema = PAYLOAD_RESUMO_TEMPERATURAS_TAM;
+    pt_comparacao->pt_grandeza = "C";
+
+    return falhas;
+}
+
+/* Função: executa os testes de ida e volta e a comparação com o empacotamento manual
+ * Parâmetros: nenhum
+ * Retorno: 0 se todos os testes passaram, 1 caso contrário
+ */
+static int executa_testes(void)
+{
+    TComparacao comparacoes[3];
+    int falhas[3];
+    int total_falhas = 0;
+    int i;
+
+    srand(1);
+    falhas[0] = compara_cap6(&comparacoes[0]);
+    falhas[1] = compara_cap7(&comparacoes[1]);
+    falhas[2] = compara_cap8(&comparacoes[2]);
+
+    printf("Ida e volta (%d payloads aleatorios por aplicacao, inclusive fora da faixa):\n", QTDE_TESTES_IDA_VOLTA);
+    for (i = 0; i < 3; i++)
+    {
+        printf("  %s %-20s %d falha(s)\n", comparacoes[i].pt_aplicacao, comparacoes[i].pt_payload, falhas[i]);
+        total_falhas += falhas[i];
+    }
+
+    printf("\nEmpacotamento manual anterior x gerado pelo esquema (ns por payload, neste computador):\n");
+    printf("  %-4s %-20s %7s %7s %9s %9s %15s %15s\n", "app", "payload", "bytes", "bytes", "ns", "ns", "erro max", "erro max");
+    printf("  %-4s %-20s %7s %7s %9s %9s %15s %15s\n", "", "", "manual", "esquema", "manual", "esquema", "manual", "esquema");
+    for (i = 0; i < 3; i++)
+    {
+        printf("  %-4s %-20s %7d %7d %9.2f %9.2f %12.2f %-2s %12.2f %-2s\n", comparacoes[i].pt_aplicacao, comparacoes[i].pt_payload,
+               comparacoes[i].tam_manual, comparacoes[i].tam_esquema, comparacoes[i].ns_manual, comparacoes[i].ns_esquema,
+               comparacoes[i].erro_max_manual, comparacoes[i].pt_grandeza, comparacoes[i].erro_max_esquema, comparacoes[i].pt_grandeza);
+    }
+
+    printf("\n%d falha(s)\n", total_falhas);
+    return (total_falhas == 0) ? 0 : 1;
+}
+
+int main(int argc, char * argv[])
+{
+    const TAplicacao * pt_aplicacao = NULL;
+    char linha[TAM_MAX_LINHA];
+    int resultado = 0;
+    int i;
+
+    if ((argc == 2) && (strcmp(argv[1], "-t") == 0))
+    {
+        return executa_testes();
+    }
+
+    if ((argc >= 3) && (strcmp(argv[1], "-a") == 0))
+    {
+        for (i = 0; i < QTDE_APLICACOES; i++)
+        {
+            if (strcmp(argv[2], aplicacoes[i].pt_nome) == 0)
+            {
+                pt_aplicacao = &aplicacoes[i];
+            }
+        }
+    }
+
+    if (pt_aplicacao == NULL)
+    {
+        fprintf(stderr, "Uso: %s -a <cap6|cap7|cap8> [<porta> <payload hex> | <AT+SENDB=porta:payload>]\n", argv[0]);
+        fprintf(stderr, "     %s -t\n", argv[0]);
+        return 1;
+    }
+
+    if (argc == 5)
+    {
+        return decodifica_payload(pt_aplicacao, atoi(argv[3]), argv[4]);
+    }
+
+    if (argc == 4)
+    {
+        return decodifica_linha(pt_aplicacao, argv[3]);
+    }
+
+    while (fgets(linha, sizeof(linha), stdin) != NULL)
+    {
+        resultado |= decodifica_linha(pt_aplicacao, linha);
+    }
+
+    return resultado;
+}
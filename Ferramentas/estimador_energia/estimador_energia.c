@@ -0,0 +1,599 @@
+/* Ferramenta: estimador de consumo de energia e de vida útil da bateria
+ *
+ * Monta o ciclo de funcionamento de cada configuração de firmware dos
+ * projetos dos capítulos 7 (lixeira, deep sleep) e 8 (temperatura) como
+ * uma sequência de etapas (duração e corrente total) mais o repouso no
+ * restante do ciclo, e calcula a carga por ciclo, a corrente média, o
+ * consumo em mAh/ano e a vida útil projetada da bateria. As configurações
+ * são mostradas lado a lado, de forma que uma mudança proposta (DR,
+ * período de sleep, leitura do sensor etc.) possa ser avaliada em mAh/ano
+ * antes de ir para campo.
+ *
+ * As durações das fases do Cap7 podem vir do próprio log do firmware
+ * (perfil_wakeup): linhas "Perfil (ms): boot=... tamper=..." de cada ciclo
+ * ou, na falta delas, a tabela min/media/max de uma janela. O tempo no ar
+ * de cada uplink é calculado pelo mesmo código do firmware
+ * (agendador_uplinks.c).
+ *
+ * Uso: estimador_energia [-b capacidade_mAh] [log_cap7.txt | -]
+ *
+ * OBS: as correntes abaixo são valores típicos de datasheet. Para uma
+ *      estimativa fiel, substitua-as por medições da placa utilizada
+ *      (regulador, LEDs e conversor USB-serial de placas de desenvolvimento
+ *      costumam consumir mais que o próprio ESP32 em deep sleep).
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "agendador_uplinks.h"
+#include "perfil_wakeup.h"
+
+/* Definições - correntes do ESP32 (mA) */
+#define CORRENTE_ESP32_ATIVO_MA                40.0    // 160 MHz, rádios desligados
+#define CORRENTE_ESP32_LIGHT_SLEEP_MA          0.8
+#define CORRENTE_ESP32_DEEP_SLEEP_MA           0.010   // timer RTC + memória RTC
+
+/* Definições - correntes do módulo LoRaWAN (mA). A corrente de TX depende
+ * da potência de transmissão, não do DR: o DR muda o tempo no ar.
+ */
+#define CORRENTE_MODULO_TX_MA                  87.0    // 20 dBm
+#define CORRENTE_MODULO_RX_MA                  5.5
+#define CORRENTE_MODULO_ATIVO_MA               3.0     // processando comandos AT
+#define CORRENTE_MODULO_REPOUSO_MA             0.0017
+
+/* Definições - correntes dos sensores (mA) */
+#define CORRENTE_SENSOR_ULTRASSONICO_MA        15.0    // HC-SR04 ligado
+#define CORRENTE_SENSOR_TEMPERATURA_MA         1.5     // DS18B20 em conversão
+#define CORRENTE_SENSOR_TEMPERATURA_REPOUSO_MA 0.00075
+
+/* Definição - corrente quiescente do regulador de tensão (mA) */
+#define CORRENTE_QUIESCENTE_REGULADOR_MA       0.005
+
+/* Definições - janelas de recepção (classe A, sem downlink) */
+#define QTDE_JANELAS_RX                        2
+#define TEMPO_JANELA_RX_MS                     30.0
+
+/* Definições - bateria */
+#define CAPACIDADE_BATERIA_PADRAO_MAH          2600.0
+#define FRACAO_UTILIZAVEL_BATERIA              0.85    // autodescarga, temperatura e tensão de corte
+
+/* Definições - parâmetros do firmware do Cap7 (lixo_lorawan.c e lorawan.h) */
+#define CAP7_TEMPO_EM_SLEEP_S                  1800
+#define CAP7_PLANO_FREQUENCIAS                 PLANO_LA915
+#define CAP7_DR                                2
+#define CAP7_TAM_PAYLOAD                       2       // leitura única, sem cabeçalho da fila
+
+/* Definições - parâmetros do firmware do Cap8 (LoRaWAN.h e medicao_temperatura.h) */
+#define CAP8_TEMPO_ENTRE_TRANSMISSOES_S        900
+#define CAP8_TEMPO_ENTRE_LEITURAS_S            10
+#define CAP8_TEMPO_CONVERSAO_TEMPERATURA_MS    750.0   // resolução de 12 bits
+#define CAP8_TEMPO_ENVIO_MS                    300.0
+#define CAP8_TEMPO_ACORDA_PARA_LEITURA_MS      5.0
+#define CAP8_PLANO_FREQUENCIAS                 PLANO_LA915
+#define CAP8_DR                                2
+#define CAP8_TAM_PAYLOAD                       4
+
+/* Definições - dimensões */
+#define QTDE_MAX_ETAPAS                        10
+#define QTDE_MAX_CONFIGURACOES                 8
+#define TAM_MAX_LINHA                          1024
+
+/* Definição - marcador das linhas de perfil de cada ciclo no log do Cap7 */
+#define MARCADOR_PERFIL_LOG                    "Perfil (ms):"
+
+/* Etapa de um ciclo (corrente total do sistema durante a etapa) */
+typedef struct
+{
+    const char * nome;
+    double duracao_ms;
+    double corrente_ma;
+    int repeticoes;
+    int em_paralelo;     // 1: carga extra em paralelo com outras etapas (não ocupa tempo do ciclo)
+}TEtapa;
+
+/* Configuração de firmware a ser avaliada */
+typedef struct
+{
+    const char * nome;
+    double periodo_ciclo_s;
+    double corrente_repouso_ma;
+    int plano;
+    int dr;
+    int tam_payload;
+    int uplinks_por_ciclo;
+    int qtde_etapas;
+    TEtapa etapas[QTDE_MAX_ETAPAS];
+}TConfiguracao;
+
+/* Resultado da estimativa de uma configuração */
+typedef struct
+{
+    double carga_etapas_mas[QTDE_MAX_ETAPAS];
+    double carga_radio_mas;
+    double carga_repouso_mas;
+    double carga_total_mas;
+    double tempo_ativo_s;
+    double corrente_media_ma;
+    double consumo_anual_mah;
+    double vida_bateria_dias;
+}TResultado_estimativa;
+
+/* Durações das fases do Cap7 (ms) usadas quando não há log do firmware */
+static const double duracoes_padrao_cap7_ms[PERFIL_WAKEUP_QTDE_FASES] = {
+    250.0,    // boot
+    5.0,      // tamper (wake-up por timer)
+    10.0,     // uart
+    450.0,    // config_lorawan (9 comandos AT)
+    1.0,      // inicia_sensor
+    10000.0,  // le_sensor (100 leituras a cada 100 ms)
+    0.0,      // paralelo (calculado: a mais longa entre módulo LoRaWAN e sensor)
+    150.0,    // envio
+    0.0       // total (calculado)
+};
+
+/* Configurações avaliadas */
+static TConfiguracao configuracoes[QTDE_MAX_CONFIGURACOES];
+static int qtde_configuracoes = 0;
+
+/* Funções locais */
+static void adiciona_etapa(TConfiguracao * pt_config, const char * pt_nome, double duracao_ms, double corrente_ma, int repeticoes);
+static TConfiguracao * nova_configuracao(const char * pt_nome, double periodo_ciclo_s, double corrente_repouso_ma, int plano, int dr, int tam_payload);
+static void adiciona_carga_paralela(TConfiguracao * pt_config, const char * pt_nome, double duracao_ms, double corrente_ma);
+static void monta_configuracao_cap7(const char * pt_nome, const double * pt_duracoes_ms, uint32_t tempo_em_sleep_s, int dr, double tempo_le_sensor_ms, int etapas_em_paralelo);
+static void monta_configuracao_cap8(const char * pt_nome, int usa_light_sleep);
+static void estima_configuracao(const TConfiguracao * pt_config, double capacidade_mah, TResultado_estimativa * pt_resultado);
+static int obtem_fase_por_nome(const char * pt_nome, int tamanho);
+static int le_perfil_cap7(FILE * pt_arquivo, double * pt_duracoes_ms);
+static void mostra_resultados(double capacidade_mah);
+
+/* Função: adiciona uma etapa ao ciclo de uma configuração
+ * Parâmetros: - ponteiro para a configuração
+ *             - nome, duração (ms), corrente total (mA) e repetições por ciclo da etapa
+ * Retorno: nenhum
+ */
+static void adiciona_etapa(TConfiguracao * pt_config, const char * pt_nome, double duracao_ms, double corrente_ma, int repeticoes)
+{
+    TEtapa * pt_etapa;
+
+    if (pt_config->qtde_etapas >= QTDE_MAX_ETAPAS)
+    {
+        return;
+    }
+
+    pt_etapa = &pt_config->etapas[pt_config->qtde_etapas++];
+    pt_etapa->nome = pt_nome;
+    pt_etapa->duracao_ms = duracao_ms;
+    pt_etapa->corrente_ma = corrente_ma;
+    pt_etapa->repeticoes = repeticoes;
+    pt_etapa->em_paralelo = 0;
+}
+
+/* Função: adiciona ao ciclo uma carga que ocorre em paralelo com outra etapa
+ *         (ex: sensor ligado enquanto o ESP32 também configura o módulo).
+ *         Só a carga é contabilizada: o tempo já está na etapa que a contém.
+ * Parâmetros: - ponteiro para a configuração
+ *             - nome, duração (ms) e corrente adicional (mA) da carga
+ * Retorno: nenhum
+ */
+static void adiciona_carga_paralela(TConfiguracao * pt_config, const char * pt_nome, double duracao_ms, double corrente_ma)
+{
+    adiciona_etapa(pt_config, pt_nome, duracao_ms, corrente_ma, 1);
+
+    if (pt_config->qtde_etapas > 0)
+    {
+        pt_config->etapas[pt_config->qtde_etapas - 1].em_paralelo = 1;
+    }
+}
+
+/* Função: cria uma configuração (sem etapas) na lista de configurações avaliadas
+ * Parâmetros: - nome da configuração
+ *             - período do ciclo (s) e corrente total em repouso (mA)
+ *             - plano de frequências, DR e tamanho do payload de cada uplink
+ * Retorno: ponteiro para a configuração criada
+ */
+static TConfiguracao * nova_configuracao(const char * pt_nome, double periodo_ciclo_s, double corrente_repouso_ma, int plano, int dr, int tam_payload)
+{
+    TConfiguracao * pt_config = &configuracoes[qtde_configuracoes++];
+
+    memset(pt_config, 0x00, sizeof(TConfiguracao));
+    pt_config->nome = pt_nome;
+    pt_config->periodo_ciclo_s = periodo_ciclo_s;
+    pt_config->corrente_repouso_ma = corrente_repouso_ma;
+    pt_config->plano = plano;
+    pt_config->dr = dr;
+    pt_config->tam_payload = tam_payload;
+    pt_config->uplinks_por_ciclo = 1;
+
+    return pt_config;
+}
+
+/* Função: monta uma configuração do Cap7 (wake-up, fases e deep sleep)
+ * Parâmetros: - nome da configuração
+ *             - durações das fases (ms), indexadas por PERFIL_WAKEUP_FASE_...
+ *             - tempo em deep sleep (s) e DR dos uplinks
+ *             - duração da leitura do sensor (ms). Se negativa, usa a das fases.
+ *             - 1: módulo LoRaWAN (uart + config_lorawan) e sensor (inicia_sensor
+ *                  + le_sensor) preparados em paralelo (firmware atual)
+ *               0: todas as fases em sequência
+ * Retorno: nenhum
+ */
+static void monta_configuracao_cap7(const char * pt_nome, const double * pt_duracoes_ms, uint32_t tempo_em_sleep_s, int dr, double tempo_le_sensor_ms, int etapas_em_paralelo)
+{
+    TConfiguracao * pt_config;
+    double base_ativo_ma = CORRENTE_ESP32_ATIVO_MA + CORRENTE_MODULO_REPOUSO_MA + CORRENTE_QUIESCENTE_REGULADOR_MA;
+    double tempo_modulo_ms = pt_duracoes_ms[PERFIL_WAKEUP_FASE_UART] + pt_duracoes_ms[PERFIL_WAKEUP_FASE_CONFIG_LORAWAN];
+    double tempo_sensor_ms;
+    double tempo_paralelo_ms = pt_duracoes_ms[PERFIL_WAKEUP_FASE_PARALELO];
+    double tempo_acordado_ms;
+
+    if (tempo_le_sensor_ms < 0.0)
+    {
+        tempo_le_sensor_ms = pt_duracoes_ms[PERFIL_WAKEUP_FASE_LE_SENSOR];
+    }
+    else
+    {
+        /* Leitura do sensor alterada: o tempo medido do trecho paralelo não vale mais */
+        tempo_paralelo_ms = 0.0;
+    }
+
+    tempo_sensor_ms = pt_duracoes_ms[PERFIL_WAKEUP_FASE_INICIA_SENSOR] + tempo_le_sensor_ms;
+
+    if (etapas_em_paralelo == 0)
+    {
+        tempo_paralelo_ms = tempo_modulo_ms + tempo_sensor_ms;
+    }
+    else if (tempo_paralelo_ms <= 0.0)
+    {
+        tempo_paralelo_ms = (tempo_modulo_ms > tempo_sensor_ms) ? tempo_modulo_ms : tempo_sensor_ms;
+    }
+
+    tempo_acordado_ms = pt_duracoes_ms[PERFIL_WAKEUP_FASE_BOOT] + pt_duracoes_ms[PERFIL_WAKEUP_FASE_TAMPER] +
+                        tempo_paralelo_ms + pt_duracoes_ms[PERFIL_WAKEUP_FASE_ENVIO];
+
+    /* O timer de wake-up só começa a contar quando o ESP32 entra em deep sleep */
+    pt_config = nova_configuracao(pt_nome, (double)tempo_em_sleep_s + (tempo_acordado_ms / 1000.0),
+                                  CORRENTE_ESP32_DEEP_SLEEP_MA + CORRENTE_MODULO_REPOUSO_MA + CORRENTE_QUIESCENTE_REGULADOR_MA,
+                                  CAP7_PLANO_FREQUENCIAS, dr, CAP7_TAM_PAYLOAD);
+
+    adiciona_etapa(pt_config, "boot", pt_duracoes_ms[PERFIL_WAKEUP_FASE_BOOT], base_ativo_ma, 1);
+    adiciona_etapa(pt_config, "tamper", pt_duracoes_ms[PERFIL_WAKEUP_FASE_TAMPER], base_ativo_ma, 1);
+
+    if (etapas_em_paralelo)
+    {
+        adiciona_etapa(pt_config, "paralelo", tempo_paralelo_ms, base_ativo_ma, 1);
+        adiciona_carga_paralela(pt_config, "+ config_lorawan", pt_duracoes_ms[PERFIL_WAKEUP_FASE_CONFIG_LORAWAN], CORRENTE_MODULO_ATIVO_MA);
+        adiciona_carga_paralela(pt_config, "+ le_sensor", tempo_le_sensor_ms, CORRENTE_SENSOR_ULTRASSONICO_MA);
+    }
+    else
+    {
+        adiciona_etapa(pt_config, "uart", pt_duracoes_ms[PERFIL_WAKEUP_FASE_UART], base_ativo_ma, 1);
+        adiciona_etapa(pt_config, "config_lorawan", pt_duracoes_ms[PERFIL_WAKEUP_FASE_CONFIG_LORAWAN], base_ativo_ma + CORRENTE_MODULO_ATIVO_MA, 1);
+        adiciona_etapa(pt_config, "inicia_sensor", pt_duracoes_ms[PERFIL_WAKEUP_FASE_INICIA_SENSOR], base_ativo_ma, 1);
+        adiciona_etapa(pt_config, "le_sensor", tempo_le_sensor_ms, base_ativo_ma + CORRENTE_SENSOR_ULTRASSONICO_MA, 1);
+    }
+
+    adiciona_etapa(pt_config, "envio", pt_duracoes_ms[PERFIL_WAKEUP_FASE_ENVIO], base_ativo_ma + CORRENTE_MODULO_ATIVO_MA, 1);
+}
+
+/* Função: monta uma configuração do Cap8 (sempre ligado, leituras periódicas)
+ * Parâmetros: - nome da configuração
+ *             - 1: ESP32 em light sleep automático entre as atividades
+ *               0: ESP32 sempre ativo (firmware atual, sem gerenciamento de energia)
+ * Retorno: nenhum
+ */
+static void monta_configuracao_cap8(const char * pt_nome, int usa_light_sleep)
+{
+    TConfiguracao * pt_config;
+    double corrente_esp32_ma = usa_light_sleep ? CORRENTE_ESP32_LIGHT_SLEEP_MA : CORRENTE_ESP32_ATIVO_MA;
+    double base_ma = corrente_esp32_ma + CORRENTE_MODULO_REPOUSO_MA + CORRENTE_SENSOR_TEMPERATURA_REPOUSO_MA + CORRENTE_QUIESCENTE_REGULADOR_MA;
+    int leituras_por_ciclo = CAP8_TEMPO_ENTRE_TRANSMISSOES_S / CAP8_TEMPO_ENTRE_LEITURAS_S;
+
+    pt_config = nova_configuracao(pt_nome, CAP8_TEMPO_ENTRE_TRANSMISSOES_S, base_ma,
+                                  CAP8_PLANO_FREQUENCIAS, CAP8_DR, CAP8_TAM_PAYLOAD);
+
+    adiciona_etapa(pt_config, "conversao_temp", CAP8_TEMPO_CONVERSAO_TEMPERATURA_MS, base_ma + CORRENTE_SENSOR_TEMPERATURA_MA, leituras_por_ciclo);
+
+    if (usa_light_sleep)
+    {
+        adiciona_etapa(pt_config, "acorda_leitura", CAP8_TEMPO_ACORDA_PARA_LEITURA_MS,
+                       base_ma - corrente_esp32_ma + CORRENTE_ESP32_ATIVO_MA, 2 * leituras_por_ciclo);
+    }
+
+    adiciona_etapa(pt_config, "envio", CAP8_TEMPO_ENVIO_MS,
+                   base_ma - corrente_esp32_ma + CORRENTE_ESP32_ATIVO_MA + CORRENTE_MODULO_ATIVO_MA, 1);
+}
+
+/* Função: estima o consumo de uma configuração
+ * Parâmetros: - ponteiro para a configuração
+ *             - capacidade da bateria (mAh)
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void estima_configuracao(const TConfiguracao * pt_config, double capacidade_mah, TResultado_estimativa * pt_resultado)
+{
+    const TEtapa * pt_etapa;
+    double tempo_no_ar_s;
+    double tempo_repouso_s;
+    int i;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_estimativa));
+
+    for (i = 0; i < pt_config->qtde_etapas; i++)
+    {
+        pt_etapa = &pt_config->etapas[i];
+        pt_resultado->carga_etapas_mas[i] = pt_etapa->corrente_ma * (pt_etapa->duracao_ms / 1000.0) * pt_etapa->repeticoes;
+
+        if (pt_etapa->em_paralelo == 0)
+        {
+            pt_resultado->tempo_ativo_s += (pt_etapa->duracao_ms / 1000.0) * pt_etapa->repeticoes;
+        }
+
+        pt_resultado->carga_total_mas += pt_resultado->carga_etapas_mas[i];
+    }
+
+    /* Rádio: transmissão e janelas de recepção, em paralelo com o que o ESP32 estiver fazendo */
+    tempo_no_ar_s = agendador_uplinks_tempo_no_ar_us(pt_config->plano, pt_config->dr, pt_config->tam_payload) / 1000000.0;
+    pt_resultado->carga_radio_mas = pt_config->uplinks_por_ciclo *
+                                    ( (CORRENTE_MODULO_TX_MA * tempo_no_ar_s) +
+                                      (CORRENTE_MODULO_RX_MA * QTDE_JANELAS_RX * (TEMPO_JANELA_RX_MS / 1000.0)) );
+    pt_resultado->carga_total_mas += pt_resultado->carga_radio_mas;
+
+    tempo_repouso_s = pt_config->periodo_ciclo_s - pt_resultado->tempo_ativo_s;
+
+    if (tempo_repouso_s < 0.0)
+    {
+        tempo_repouso_s = 0.0;
+    }
+
+    pt_resultado->carga_repouso_mas = pt_config->corrente_repouso_ma * tempo_repouso_s;
+    pt_resultado->carga_total_mas += pt_resultado->carga_repouso_mas;
+
+    pt_resultado->corrente_media_ma = pt_resultado->carga_total_mas / pt_config->periodo_ciclo_s;
+    pt_resultado->consumo_anual_mah = pt_resultado->corrente_media_ma * 24.0 * 365.0;
+    pt_resultado->vida_bateria_dias = (capacidade_mah * FRACAO_UTILIZAVEL_BATERIA) / (pt_resultado->corrente_media_ma * 24.0);
+}
+
+/* Função: obtém a fase do perfil de wake-up a partir do seu nome
+ * Parâmetros: nome (não necessariamente terminado em '\0') e seu tamanho
+ * Retorno: fase (PERFIL_WAKEUP_FASE_...) ou -1 se o nome não é de uma fase
+ */
+static int obtem_fase_por_nome(const char * pt_nome, int tamanho)
+{
+    const char * pt_nome_fase;
+    int fase;
+
+    for (fase = 0; fase < PERFIL_WAKEUP_QTDE_FASES; fase++)
+    {
+        pt_nome_fase = perfil_wakeup_nome_fase(fase);
+
+        if ( ((int)strlen(pt_nome_fase) == tamanho) && (strncmp(pt_nome, pt_nome_fase, tamanho) == 0) )
+        {
+            return fase;
+        }
+    }
+
+    return -1;
+}
+
+/* Função: lê as durações das fases do Cap7 do log do firmware. Usa a média
+ *         das linhas de perfil de cada ciclo; se não houver nenhuma, usa as
+ *         médias da última tabela min/media/max.
+ * Parâmetros: - arquivo de log
+ *             - ponteiro para as durações das fases (ms). Fases que não
+ *               aparecem no log mantêm o valor recebido.
+ * Retorno: quantidade de ciclos (ou de janelas) lidos
+ */
+static int le_perfil_cap7(FILE * pt_arquivo, double * pt_duracoes_ms)
+{
+    char linha[TAM_MAX_LINHA];
+    double soma_ciclos_ms[PERFIL_WAKEUP_QTDE_FASES] = {0};
+    int qtde_ciclos_fase[PERFIL_WAKEUP_QTDE_FASES] = {0};
+    double media_janela_ms[PERFIL_WAKEUP_QTDE_FASES] = {0};
+    int fase_na_janela[PERFIL_WAKEUP_QTDE_FASES] = {0};
+    int qtde_linhas_ciclo = 0;
+    int qtde_janelas = 0;
+    char nome[32];
+    unsigned long minimo, media, maximo;
+    const char * pt;
+    const char * pt_igual;
+    int fase;
+
+    while (fgets(linha, sizeof(linha), pt_arquivo) != NULL)
+    {
+        /* Linha de um ciclo: "Perfil (ms): boot=250 tamper=5 ..." */
+        pt = strstr(linha, MARCADOR_PERFIL_LOG);
+
+        if (pt != NULL)
+        {
+            pt += strlen(MARCADOR_PERFIL_LOG);
+
+            while ( (pt_igual = strchr(pt, '=')) != NULL )
+            {
+                while (*pt == ' ')
+                {
+                    pt++;
+                }
+
+                fase = obtem_fase_por_nome(pt, (int)(pt_igual - pt));
+
+                if (fase >= 0)
+                {
+                    soma_ciclos_ms[fase] += strtod(pt_igual + 1, NULL);
+                    qtde_ciclos_fase[fase]++;
+                }
+
+                pt = pt_igual + 1;
+
+                while ( (*pt != ' ') && (*pt != '\0') )
+                {
+                    pt++;
+                }
+            }
+
+            qtde_linhas_ciclo++;
+            continue;
+        }
+
+        /* Linha da tabela de uma janela: "<fase> min=... media=... max=..." */
+        pt = strstr(linha, ": ");
+
+        if ( (pt != NULL) && (strstr(linha, " media=") != NULL) &&
+             (sscanf(pt + 2, "%31s min=%lu media=%lu max=%lu", nome, &minimo, &media, &maximo) == 4) )
+        {
+            fase = obtem_fase_por_nome(nome, (int)strlen(nome));
+
+            if (fase >= 0)
+            {
+                if (fase == PERFIL_WAKEUP_FASE_BOOT)
+                {
+                    qtde_janelas++;
+                }
+
+                media_janela_ms[fase] = (double)media;
+                fase_na_janela[fase] = 1;
+            }
+        }
+    }
+
+    for (fase = 0; fase < PERFIL_WAKEUP_QTDE_FASES; fase++)
+    {
+        if (qtde_ciclos_fase[fase] > 0)
+        {
+            pt_duracoes_ms[fase] = soma_ciclos_ms[fase] / qtde_ciclos_fase[fase];
+        }
+        else if (fase_na_janela[fase])
+        {
+            pt_duracoes_ms[fase] = media_janela_ms[fase];
+        }
+    }
+
+    /* Cada ciclo gera duas linhas de perfil */
+    return (qtde_linhas_ciclo > 0) ? ((qtde_linhas_ciclo + 1) / 2) : qtde_janelas;
+}
+
+/* Função: mostra a estimativa de todas as configurações, lado a lado, e
+ *         onde a carga de cada ciclo é gasta
+ * Parâmetros: capacidade da bateria (mAh)
+ * Retorno: nenhum
+ */
+static void mostra_resultados(double capacidade_mah)
+{
+    TResultado_estimativa resultado;
+    const TConfiguracao * pt_config;
+    int i, j;
+
+    printf("Bateria: %.0f mAh (%.0f%% utilizaveis)\n\n", capacidade_mah, FRACAO_UTILIZAVEL_BATERIA * 100.0);
+    printf("%-36s %9s %10s %12s %12s %9s %10s\n",
+           "configuracao", "ciclo(s)", "ativo(s)", "carga(uAh)", "media(uA)", "mAh/ano", "vida(dias)");
+
+    for (i = 0; i < qtde_configuracoes; i++)
+    {
+        pt_config = &configuracoes[i];
+        estima_configuracao(pt_config, capacidade_mah, &resultado);
+
+        printf("%-36s %9.0f %10.2f %12.2f %12.1f %9.1f %10.0f\n",
+               pt_config->nome, pt_config->periodo_ciclo_s, resultado.tempo_ativo_s,
+               resultado.carga_total_mas / 3.6, resultado.corrente_media_ma * 1000.0,
+               resultado.consumo_anual_mah, resultado.vida_bateria_dias);
+    }
+
+    printf("\nDistribuicao da carga de cada ciclo:\n");
+
+    for (i = 0; i < qtde_configuracoes; i++)
+    {
+        pt_config = &configuracoes[i];
+        estima_configuracao(pt_config, capacidade_mah, &resultado);
+
+        printf("\n%s\n", pt_config->nome);
+
+        for (j = 0; j < pt_config->qtde_etapas; j++)
+        {
+            printf("  %-16s %5.1f%%  (%d x %.1f ms a %.3f mA)\n", pt_config->etapas[j].nome,
+                   100.0 * resultado.carga_etapas_mas[j] / resultado.carga_total_mas,
+                   pt_config->etapas[j].repeticoes, pt_config->etapas[j].duracao_ms, pt_config->etapas[j].corrente_ma);
+        }
+
+        printf("  %-16s %5.1f%%  (DR%d, %d bytes, %.1f ms no ar)\n", "radio (tx/rx)",
+               100.0 * resultado.carga_radio_mas / resultado.carga_total_mas, pt_config->dr, pt_config->tam_payload,
+               agendador_uplinks_tempo_no_ar_us(pt_config->plano, pt_config->dr, pt_config->tam_payload) / 1000.0);
+        printf("  %-16s %5.1f%%  (%.4f mA)\n", "repouso",
+               100.0 * resultado.carga_repouso_mas / resultado.carga_total_mas, pt_config->corrente_repouso_ma);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    double duracoes_cap7_ms[PERFIL_WAKEUP_QTDE_FASES];
+    double capacidade_mah = CAPACIDADE_BATERIA_PADRAO_MAH;
+    const char * pt_arquivo_log = NULL;
+    FILE * pt_arquivo;
+    int qtde_ciclos;
+    int fase;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ( (strcmp(argv[i], "-b") == 0) && ((i + 1) < argc) )
+        {
+            capacidade_mah = atof(argv[++i]);
+        }
+        else
+        {
+            pt_arquivo_log = argv[i];
+        }
+    }
+
+    if (capacidade_mah <= 0.0)
+    {
+        fprintf(stderr, "Uso: %s [-b capacidade_mAh] [log_cap7.txt | -]\n", argv[0]);
+        return 1;
+    }
+
+    memcpy(duracoes_cap7_ms, duracoes_padrao_cap7_ms, sizeof(duracoes_cap7_ms));
+
+    if (pt_arquivo_log != NULL)
+    {
+        pt_arquivo = (strcmp(pt_arquivo_log, "-") == 0) ? stdin : fopen(pt_arquivo_log, "r");
+
+        if (pt_arquivo == NULL)
+        {
+            fprintf(stderr, "Nao foi possivel abrir %s\n", pt_arquivo_log);
+            return 1;
+        }
+
+        qtde_ciclos = le_perfil_cap7(pt_arquivo, duracoes_cap7_ms);
+
+        if (pt_arquivo != stdin)
+        {
+            fclose(pt_arquivo);
+        }
+
+        printf("Fases do Cap7 lidas do log (%d ciclo(s) ou janela(s)):\n", qtde_ciclos);
+    }
+    else
+    {
+        printf("Fases do Cap7 (valores padrao, sem log do firmware):\n");
+    }
+
+    for (fase = 0; fase < PERFIL_WAKEUP_FASE_TOTAL; fase++)
+    {
+        printf("  %-16s %8.1f ms\n", perfil_wakeup_nome_fase(fase), duracoes_cap7_ms[fase]);
+    }
+
+    printf("\n");
+
+    /* Configurações avaliadas: firmware atual e propostas */
+    monta_configuracao_cap7("Cap7 atual (DR2, sleep 30 min)", duracoes_cap7_ms, CAP7_TEMPO_EM_SLEEP_S, CAP7_DR, -1.0, 1);
+    monta_configuracao_cap7("Cap7 fases em sequencia", duracoes_cap7_ms, CAP7_TEMPO_EM_SLEEP_S, CAP7_DR, -1.0, 0);
+    monta_configuracao_cap7("Cap7 DR5", duracoes_cap7_ms, CAP7_TEMPO_EM_SLEEP_S, 5, -1.0, 1);
+    monta_configuracao_cap7("Cap7 sleep 60 min", duracoes_cap7_ms, 2 * CAP7_TEMPO_EM_SLEEP_S, CAP7_DR, -1.0, 1);
+    monta_configuracao_cap7("Cap7 leitura do sensor em 1 s", duracoes_cap7_ms, CAP7_TEMPO_EM_SLEEP_S, CAP7_DR, 1000.0, 1);
+    monta_configuracao_cap8("Cap8 atual (sempre ativo)", 0);
+    monta_configuracao_cap8("Cap8 com light sleep automatico", 1);
+
+    mostra_resultados(capacidade_mah);
+    return 0;
+}
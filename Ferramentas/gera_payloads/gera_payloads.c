@@ -0,0 +1,1063 @@
+/* Ferramenta: gerador dos módulos de payloads LoRaWAN a partir de um esquema
+ *
+ * Lê o esquema dos payloads de uma aplicação (payloads.esquema) e gera o
+ * módulo payloads.c / payloads.h do firmware, com:
+ * - uma estrutura por payload, com os valores físicos de cada campo;
+ * - funções de empacotamento (firmware) e desempacotamento (firmware e
+ *   decoder do computador), com os campos em bits, do bit mais significativo
+ *   de cada byte para o menos significativo (big-endian), sem depender da
+ *   ordem dos bytes do processador;
+ * - uma tabela descrevendo os payloads, usada pelo decoder genérico
+ *   (Ferramentas/decodifica_payloads).
+ * Os tamanhos dos payloads são conferidos na geração e, no firmware, em
+ * tempo de compilação (_Static_assert).
+ *
+ * Formato do esquema (uma diretiva por linha; # inicia comentário):
+ *   aplicacao <nome>             prefixo da tabela de payloads (ex: cap6)
+ *   descricao <texto>            descrição da aplicação
+ *   payload <nome> porta <n> [max <bytes>]
+ *   registro <nome>              parte de um payload (sem porta própria)
+ *     campo <nome> <u|s><bits> [escala <e>] [deslocamento <d>] [min <b>] [max <b>]
+ *                              [sem_valor <b>] [unidade <texto>]
+ *     repete <registro>          o registro se repete até o fim do payload
+ *   fim
+ *
+ * Valor físico = valor bruto * escala + deslocamento. Campos sem escala e
+ * deslocamento são inteiros; os demais, float. No empacotamento, o valor
+ * bruto é arredondado e saturado entre min e max (por padrão, a faixa dos
+ * bits do campo), em vez de dar a volta. sem_valor reserva um valor bruto
+ * para "não medido" (ESQUEMA_PAYLOADS_SEM_VALOR nos inteiros, NAN nos float).
+ *
+ * Uso: gera_payloads <payloads.esquema> <diretório de saída>
+ * Retorno: 0: módulo gerado; 1: erro no esquema
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+/* Definições - limites do esquema */
+#define QTDE_MAX_PAYLOADS        16
+#define QTDE_MAX_CAMPOS          24
+#define TAM_MAX_NOME             32
+#define TAM_MAX_TEXTO            96
+#define TAM_MAX_LINHA            256
+#define QTDE_MAX_TOKENS          24
+
+/* Definição - largura dos nomes nos #define gerados (alinhamento dos valores) */
+#define LARGURA_DEFINE           40
+
+/* Definição - payload máximo do LoRaWAN (DR5 ou maior, LA915) */
+#define TAM_MAX_PAYLOAD_LORAWAN  242
+
+/* Campo de um payload */
+typedef struct
+{
+    char nome[TAM_MAX_NOME];
+    char unidade[TAM_MAX_NOME];
+    bool com_sinal;
+    bool real;
+    int bits;
+    int bit_inicial;
+    double escala;
+    double deslocamento;
+    long long min;
+    long long max;
+    bool tem_sem_valor;
+    long long sem_valor;
+}TCampo;
+
+/* Payload (ou registro) */
+typedef struct
+{
+    char nome[TAM_MAX_NOME];
+    int porta;                 // 0: registro
+    int tam_max;
+    int qtde_campos;
+    TCampo campos[QTDE_MAX_CAMPOS];
+    int bits;
+    int idx_repetido;          // -1: sem registro repetido
+    int linha;
+}TPayload;
+
+/* Esquema de uma aplicação */
+typedef struct
+{
+    char aplicacao[TAM_MAX_NOME];
+    char descricao[TAM_MAX_TEXTO];
+    char arquivo[TAM_MAX_TEXTO];
+    int qtde_payloads;
+    TPayload payloads[QTDE_MAX_PAYLOADS];
+}TEsquema;
+
+static TEsquema esquema;
+
+/* Função: informa erro no esquema e encerra
+ * Parâmetros: - número da linha
+ *             - mensagem
+ *             - detalhe (ou NULL)
+ * Retorno: nenhum (encerra o programa)
+ */
+static void erro_esquema(int linha, const char * pt_mensagem, const char * pt_detalhe)
+{
+    fprintf(stderr, "%s:%d: %s%s%s\n", esquema.arquivo, linha, pt_mensagem,
+            (pt_detalhe != NULL) ? ": " : "", (pt_detalhe != NULL) ? pt_detalhe : "");
+    exit(1);
+}
+
+/* Função: verifica se o texto é um identificador C válido (letras minúsculas, números e _)
+ * Parâmetros: texto
+ * Retorno: true: válido
+ */
+static bool identificador_valido(const char * pt_texto)
+{
+    int i;
+
+    if ((pt_texto[0] == '\0') || (isdigit((unsigned char)pt_texto[0])) || (strlen(pt_texto) >= TAM_MAX_NOME))
+    {
+        return false;
+    }
+
+    for (i = 0; pt_texto[i] != '\0'; i++)
+    {
+        if (!islower((unsigned char)pt_texto[i]) && !isdigit((unsigned char)pt_texto[i]) && (pt_texto[i] != '_'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Função: converte um número do esquema
+ * Parâmetros: - texto
+ *             - linha (para mensagem de erro)
+ * Retorno: número
+ */
+static double converte_numero(const char * pt_texto, int linha)
+{
+    char * pt_fim;
+    double valor = strtod(pt_texto, &pt_fim);
+
+    if ((pt_texto[0] == '\0') || (*pt_fim != '\0'))
+    {
+        erro_esquema(linha, "numero invalido", pt_texto);
+    }
+
+    return valor;
+}
+
+/* Função: interpreta uma linha "campo ..."
+ * Parâmetros: - payload atual
+ *             - tokens da linha e quantidade
+ *             - número da linha
+ * Retorno: nenhum
+ */
+static void interpreta_campo(TPayload * pt_payload, char ** pt_tokens, int qtde_tokens, int linha)
+{
+    TCampo * pt_campo;
+    bool tem_min = false;
+    bool tem_max = false;
+    int i;
+
+    if (pt_payload->idx_repetido >= 0)
+    {
+        erro_esquema(linha, "campo depois de repete", NULL);
+    }
+
+    if ((qtde_tokens < 3) || (pt_payload->qtde_campos >= QTDE_MAX_CAMPOS))
+    {
+        erro_esquema(linha, "campo invalido", NULL);
+    }
+
+    pt_campo = &pt_payload->campos[pt_payload->qtde_campos];
+    memset(pt_campo, 0, sizeof(TCampo));
+
+    if (identificador_valido(pt_tokens[1]) == false)
+    {
+        erro_esquema(linha, "nome de campo invalido", pt_tokens[1]);
+    }
+    snprintf(pt_campo->nome, sizeof(pt_campo->nome), "%s", pt_tokens[1]);
+
+    if ((pt_tokens[2][0] != 'u') && (pt_tokens[2][0] != 's'))
+    {
+        erro_esquema(linha, "tipo deve ser u<bits> ou s<bits>", pt_tokens[2]);
+    }
+    pt_campo->com_sinal = (pt_tokens[2][0] == 's');
+    pt_campo->bits = (int)converte_numero(&pt_tokens[2][1], linha);
+    if ((pt_campo->bits < 1) || (pt_campo->bits > 32) || (pt_campo->com_sinal && (pt_campo->bits < 2)))
+    {
+        erro_esquema(linha, "campo deve ter de 1 a 32 bits", pt_tokens[2]);
+    }
+
+    pt_campo->escala = 1.0;
+    pt_campo->deslocamento = 0.0;
+
+    for (i = 3; i < qtde_tokens; i += 2)
+    {
+        if (i + 1 >= qtde_tokens)
+        {
+            erro_esquema(linha, "falta o valor de", pt_tokens[i]);
+        }
+
+        if (strcmp(pt_tokens[i], "escala") == 0)
+        {
+            pt_campo->escala = converte_numero(pt_tokens[i + 1], linha);
+            if (pt_campo->escala <= 0.0)
+            {
+                erro_esquema(linha, "escala deve ser positiva", NULL);
+            }
+        }
+        else if (strcmp(pt_tokens[i], "deslocamento") == 0)
+        {
+            pt_campo->deslocamento = converte_numero(pt_tokens[i + 1], linha);
+        }
+        else if (strcmp(pt_tokens[i], "min") == 0)
+        {
+            pt_campo->min = (long long)converte_numero(pt_tokens[i + 1], linha);
+            tem_min = true;
+        }
+        else if (strcmp(pt_tokens[i], "max") == 0)
+        {
+            pt_campo->max = (long long)converte_numero(pt_tokens[i + 1], linha);
+            tem_max = true;
+        }
+        else if (strcmp(pt_tokens[i], "sem_valor") == 0)
+        {
+            pt_campo->sem_valor = (long long)converte_numero(pt_tokens[i + 1], linha);
+            pt_campo->tem_sem_valor = true;
+        }
+        else if (strcmp(pt_tokens[i], "unidade") == 0)
+        {
+            snprintf(pt_campo->unidade, sizeof(pt_campo->unidade), "%s", pt_tokens[i + 1]);
+        }
+        else
+        {
+            erro_esquema(linha, "atributo desconhecido", pt_tokens[i]);
+        }
+    }
+
+    pt_campo->real = (pt_campo->escala != 1.0) || (pt_campo->deslocamento != 0.0);
+
+    /* Faixa padrão: a dos bits do campo, sem o valor reservado para "sem valor" */
+    if (tem_min == false)
+    {
+        pt_campo->min = pt_campo->com_sinal ? -(1LL << (pt_campo->bits - 1)) : 0;
+        if (pt_campo->tem_sem_valor && (pt_campo->sem_valor == pt_campo->min))
+        {
+            pt_campo->min++;
+        }
+    }
+
+    if (tem_max == false)
+    {
+        pt_campo->max = pt_campo->com_sinal ? ((1LL << (pt_campo->bits - 1)) - 1) : ((1LL << pt_campo->bits) - 1);
+        if (pt_campo->tem_sem_valor && (pt_campo->sem_valor == pt_campo->max))
+        {
+            pt_campo->max--;
+        }
+    }
+
+    if ( (pt_campo->min > pt_campo->max) ||
+         (pt_campo->min < (pt_campo->com_sinal ? -(1LL << (pt_campo->bits - 1)) : 0)) ||
+         (pt_campo->max > (pt_campo->com_sinal ? ((1LL << (pt_campo->bits - 1)) - 1) : ((1LL << pt_campo->bits) - 1))) )
+    {
+        erro_esquema(linha, "min/max fora da faixa do campo", pt_campo->nome);
+    }
+
+    if ( pt_campo->tem_sem_valor &&
+         ((pt_campo->sem_valor >= pt_campo->min) && (pt_campo->sem_valor <= pt_campo->max)) )
+    {
+        erro_esquema(linha, "sem_valor dentro da faixa min/max", pt_campo->nome);
+    }
+
+    if ((pt_campo->real == false) && (pt_campo->com_sinal == false) && (pt_campo->bits == 32) && (pt_campo->tem_sem_valor))
+    {
+        erro_esquema(linha, "sem_valor nao suportado em u32 inteiro", pt_campo->nome);
+    }
+
+    pt_campo->bit_inicial = pt_payload->bits;
+    pt_payload->bits += pt_campo->bits;
+    pt_payload->qtde_campos++;
+}
+
+/* Função: procura um payload/registro pelo nome
+ * Parâmetros: nome
+ * Retorno: índice, ou -1 se não existe
+ */
+static int procura_payload(const char * pt_nome)
+{
+    int i;
+
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        if (strcmp(esquema.payloads[i].nome, pt_nome) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* Função: lê e valida o esquema
+ * Parâmetros: nome do arquivo
+ * Retorno: nenhum (encerra o programa em caso de erro)
+ */
+static void le_esquema(const char * pt_arquivo)
+{
+    FILE * arquivo = fopen(pt_arquivo, "r");
+    char linha[TAM_MAX_LINHA];
+    char * tokens[QTDE_MAX_TOKENS];
+    char * pt_comentario;
+    TPayload * pt_payload = NULL;
+    int qtde_tokens;
+    int num_linha = 0;
+    int tam_bytes;
+    int i;
+
+    snprintf(esquema.arquivo, sizeof(esquema.arquivo), "%s", pt_arquivo);
+
+    if (arquivo == NULL)
+    {
+        fprintf(stderr, "Nao foi possivel ler %s\n", pt_arquivo);
+        exit(1);
+    }
+
+    while (fgets(linha, sizeof(linha), arquivo) != NULL)
+    {
+        num_linha++;
+
+        pt_comentario = strchr(linha, '#');
+        if (pt_comentario != NULL)
+        {
+            *pt_comentario = '\0';
+        }
+
+        qtde_tokens = 0;
+        for (tokens[0] = strtok(linha, " \t\r\n"); (tokens[qtde_tokens] != NULL) && (qtde_tokens < QTDE_MAX_TOKENS - 1);
+             tokens[qtde_tokens] = strtok(NULL, " \t\r\n"))
+        {
+            qtde_tokens++;
+        }
+
+        if (qtde_tokens == 0)
+        {
+            continue;
+        }
+
+        if (strcmp(tokens[0], "aplicacao") == 0)
+        {
+            if ((qtde_tokens != 2) || (identificador_valido(tokens[1]) == false))
+            {
+                erro_esquema(num_linha, "aplicacao invalida", NULL);
+            }
+            snprintf(esquema.aplicacao, sizeof(esquema.aplicacao), "%s", tokens[1]);
+        }
+        else if (strcmp(tokens[0], "descricao") == 0)
+        {
+            esquema.descricao[0] = '\0';
+            for (i = 1; i < qtde_tokens; i++)
+            {
+                strncat(esquema.descricao, tokens[i], sizeof(esquema.descricao) - strlen(esquema.descricao) - 2);
+                if (i < qtde_tokens - 1)
+                {
+                    strcat(esquema.descricao, " ");
+                }
+            }
+        }
+        else if ((strcmp(tokens[0], "payload") == 0) || (strcmp(tokens[0], "registro") == 0))
+        {
+            if ((pt_payload != NULL) || (esquema.qtde_payloads >= QTDE_MAX_PAYLOADS) || (qtde_tokens < 2) ||
+                (identificador_valido(tokens[1]) == false) || (procura_payload(tokens[1]) >= 0))
+            {
+                erro_esquema(num_linha, "payload/registro invalido ou repetido", (qtde_tokens > 1) ? tokens[1] : NULL);
+            }
+
+            pt_payload = &esquema.payloads[esquema.qtde_payloads];
+            memset(pt_payload, 0, sizeof(TPayload));
+            snprintf(pt_payload->nome, sizeof(pt_payload->nome), "%s", tokens[1]);
+            pt_payload->tam_max = TAM_MAX_PAYLOAD_LORAWAN;
+            pt_payload->idx_repetido = -1;
+            pt_payload->linha = num_linha;
+
+            for (i = 2; i < qtde_tokens; i += 2)
+            {
+                if ((i + 1 < qtde_tokens) && (strcmp(tokens[i], "porta") == 0) && (tokens[0][0] == 'p'))
+                {
+                    pt_payload->porta = (int)converte_numero(tokens[i + 1], num_linha);
+                }
+                else if ((i + 1 < qtde_tokens) && (strcmp(tokens[i], "max") == 0))
+                {
+                    pt_payload->tam_max = (int)converte_numero(tokens[i + 1], num_linha);
+                }
+                else
+                {
+                    erro_esquema(num_linha, "atributo desconhecido", tokens[i]);
+                }
+            }
+
+            if ((tokens[0][0] == 'p') && ((pt_payload->porta < 1) || (pt_payload->porta > 223)))
+            {
+                erro_esquema(num_linha, "payload precisa de porta entre 1 e 223", NULL);
+            }
+        }
+        else if (strcmp(tokens[0], "campo") == 0)
+        {
+            if (pt_payload == NULL)
+            {
+                erro_esquema(num_linha, "campo fora de payload", NULL);
+            }
+            interpreta_campo(pt_payload, tokens, qtde_tokens, num_linha);
+        }
+        else if (strcmp(tokens[0], "repete") == 0)
+        {
+            if ((pt_payload == NULL) || (pt_payload->porta == 0) || (qtde_tokens != 2) || (pt_payload->idx_repetido >= 0))
+            {
+                erro_esquema(num_linha, "repete so vale uma vez, dentro de payload", NULL);
+            }
+
+            pt_payload->idx_repetido = procura_payload(tokens[1]);
+            if ((pt_payload->idx_repetido < 0) || (esquema.payloads[pt_payload->idx_repetido].porta != 0))
+            {
+                erro_esquema(num_linha, "registro nao declarado antes", tokens[1]);
+            }
+        }
+        else if (strcmp(tokens[0], "fim") == 0)
+        {
+            if ((pt_payload == NULL) || (pt_payload->qtde_campos == 0))
+            {
+                erro_esquema(num_linha, "fim sem payload ou payload sem campos", NULL);
+            }
+
+            /* Registros repetidos são endereçados por byte: o tamanho da parte fixa
+             * e do registro devem ser múltiplos de 8 bits
+             */
+            tam_bytes = (pt_payload->bits + 7) / 8;
+            if ( (pt_payload->idx_repetido >= 0) &&
+                 (((pt_payload->bits % 8) != 0) || ((esquema.payloads[pt_payload->idx_repetido].bits % 8) != 0)) )
+            {
+                erro_esquema(num_linha, "payload com repete deve ter partes com bytes inteiros", pt_payload->nome);
+            }
+
+            if (pt_payload->idx_repetido >= 0)
+            {
+                tam_bytes += esquema.payloads[pt_payload->idx_repetido].bits / 8;
+            }
+
+            if ((tam_bytes > pt_payload->tam_max) || (tam_bytes > TAM_MAX_PAYLOAD_LORAWAN))
+            {
+                fprintf(stderr, "%s:%d: payload %s tem %d bytes, maximo %d\n", esquema.arquivo, num_linha,
+                        pt_payload->nome, tam_bytes, pt_payload->tam_max);
+                exit(1);
+            }
+
+            esquema.qtde_payloads++;
+            pt_payload = NULL;
+        }
+        else
+        {
+            erro_esquema(num_linha, "diretiva desconhecida", tokens[0]);
+        }
+    }
+
+    fclose(arquivo);
+
+    if ((pt_payload != NULL) || (esquema.aplicacao[0] == '\0') || (esquema.qtde_payloads == 0))
+    {
+        erro_esquema(num_linha, "esquema incompleto (falta aplicacao, payload ou fim)", NULL);
+    }
+}
+
+/* Função: converte texto para maiúsculas
+ * Parâmetros: - texto
+ *             - ponteiro para o texto convertido
+ * Retorno: ponteiro para o texto convertido
+ */
+static const char * maiusculas(const char * pt_texto, char * pt_saida)
+{
+    int i;
+
+    for (i = 0; pt_texto[i] != '\0'; i++)
+    {
+        pt_saida[i] = (char)toupper((unsigned char)pt_texto[i]);
+    }
+    pt_saida[i] = '\0';
+
+    return pt_saida;
+}
+
+/* Função: formata um número como literal float do C
+ * Parâmetros: - número
+ *             - ponteiro para o texto
+ * Retorno: ponteiro para o texto
+ */
+static const char * literal_float(double valor, char * pt_saida)
+{
+    snprintf(pt_saida, TAM_MAX_NOME, "%.9g", valor);
+    if (strpbrk(pt_saida, ".eEn") == NULL)
+    {
+        strcat(pt_saida, ".0");
+    }
+    strcat(pt_saida, "f");
+
+    return pt_saida;
+}
+
+/* Função: formata um número inteiro como literal do C
+ * Parâmetros: - número
+ *             - ponteiro para o texto
+ * Retorno: ponteiro para o texto
+ */
+static const char * literal_inteiro(long long valor, char * pt_saida)
+{
+    if (valor == -2147483648LL)
+    {
+        snprintf(pt_saida, TAM_MAX_NOME, "INT32_MIN");
+    }
+    else if (valor < 0)
+    {
+        snprintf(pt_saida, TAM_MAX_NOME, "(%lld)", valor);
+    }
+    else if (valor > 2147483647LL)
+    {
+        snprintf(pt_saida, TAM_MAX_NOME, "%lldUL", valor);
+    }
+    else
+    {
+        snprintf(pt_saida, TAM_MAX_NOME, "%lld", valor);
+    }
+
+    return pt_saida;
+}
+
+/* Função: tipo C do valor físico de um campo
+ * Parâmetros: campo
+ * Retorno: tipo
+ */
+static const char * tipo_campo(const TCampo * pt_campo)
+{
+    if (pt_campo->real)
+    {
+        return "float";
+    }
+
+    return ((pt_campo->com_sinal == false) && (pt_campo->bits == 32)) ? "uint32_t" : "int32_t";
+}
+
+/* Função: verifica se o valor de um campo inteiro precisa ser saturado (a
+ *         faixa do tipo C é maior que a faixa do campo)
+ * Parâmetros: campo
+ * Retorno: true: precisa saturar
+ */
+static bool satura_campo_inteiro(const TCampo * pt_campo)
+{
+    return (pt_campo->real == false) &&
+           ((pt_campo->bits < 32) || (pt_campo->min != (pt_campo->com_sinal ? -(1LL << 31) : 0)) ||
+            (pt_campo->max != (pt_campo->com_sinal ? ((1LL << 31) - 1) : ((1LL << 32) - 1))));
+}
+
+/* Função: máscara dos bits de um campo
+ * Parâmetros: quantidade de bits
+ * Retorno: máscara
+ */
+static unsigned long long mascara_bits(int bits)
+{
+    return (bits >= 64) ? ~0ULL : ((1ULL << bits) - 1);
+}
+
+/* Função: gera o comentário com o formato de um payload
+ * Parâmetros: - arquivo de saída
+ *             - payload
+ * Retorno: nenhum
+ */
+static void gera_comentario_formato(FILE * pt_saida, const TPayload * pt_payload)
+{
+    const TCampo * pt_campo;
+    char texto[TAM_MAX_NOME];
+    int i;
+
+    if (pt_payload->porta != 0)
+    {
+        fprintf(pt_saida, " * Payload %s (porta %d, %d bytes%s):\n", pt_payload->nome, pt_payload->porta, (pt_payload->bits + 7) / 8,
+                (pt_payload->idx_repetido >= 0) ? " + registros repetidos" : "");
+    }
+    else
+    {
+        fprintf(pt_saida, " * Registro %s (%d bytes):\n", pt_payload->nome, (pt_payload->bits + 7) / 8);
+    }
+
+    for (i = 0; i < pt_payload->qtde_campos; i++)
+    {
+        pt_campo = &pt_payload->campos[i];
+        fprintf(pt_saida, " *   bits %3d..%3d: %s (%c%d", pt_campo->bit_inicial, pt_campo->bit_inicial + pt_campo->bits - 1,
+                pt_campo->nome, pt_campo->com_sinal ? 's' : 'u', pt_campo->bits);
+        if (pt_campo->real)
+        {
+            snprintf(texto, sizeof(texto), "%g", pt_campo->escala);
+            fprintf(pt_saida, ", x %s", texto);
+            if (pt_campo->deslocamento != 0.0)
+            {
+                fprintf(pt_saida, " %+g", pt_campo->deslocamento);
+            }
+        }
+        fprintf(pt_saida, ", bruto %lld..%lld", pt_campo->min, pt_campo->max);
+        if (pt_campo->tem_sem_valor)
+        {
+            fprintf(pt_saida, ", sem valor = %lld", pt_campo->sem_valor);
+        }
+        fprintf(pt_saida, ")%s%s\n", (pt_campo->unidade[0] != '\0') ? " " : "", pt_campo->unidade);
+    }
+
+    if (pt_payload->idx_repetido >= 0)
+    {
+        fprintf(pt_saida, " *   seguido de registros %s até o fim do payload\n", esquema.payloads[pt_payload->idx_repetido].nome);
+    }
+}
+
+/* Função: gera o header do módulo
+ * Parâmetros: arquivo de saída
+ * Retorno: nenhum
+ */
+static void gera_header(FILE * pt_saida)
+{
+    const TPayload * pt_payload;
+    const TCampo * pt_campo;
+    char nome_maiusculo[TAM_MAX_NOME];
+    char campo_maiusculo[TAM_MAX_NOME];
+    char aplicacao_maiuscula[TAM_MAX_NOME];
+    char texto[3 * TAM_MAX_NOME];
+    char texto_valor[TAM_MAX_NOME];
+    int i;
+    int j;
+
+    maiusculas(esquema.aplicacao, aplicacao_maiuscula);
+
+    fprintf(pt_saida, "/* Header file: payloads LoRaWAN - %s\n", esquema.descricao);
+    fprintf(pt_saida, " *\n");
+    fprintf(pt_saida, " * ARQUIVO GERADO por Ferramentas/gera_payloads a partir de payloads.esquema.\n");
+    fprintf(pt_saida, " * Não editar: altere o esquema e gere novamente (make -C Ferramentas payloads).\n");
+    fprintf(pt_saida, " *\n");
+    fprintf(pt_saida, " * Campos em bits, do bit mais significativo de cada byte para o menos\n");
+    fprintf(pt_saida, " * significativo (big-endian). Valor físico = bruto x escala + deslocamento.\n");
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        fprintf(pt_saida, " *\n");
+        gera_comentario_formato(pt_saida, &esquema.payloads[i]);
+    }
+    fprintf(pt_saida, " */\n\n");
+
+    fprintf(pt_saida, "#ifndef HEADER_PAYLOADS_%s\n", aplicacao_maiuscula);
+    fprintf(pt_saida, "#define HEADER_PAYLOADS_%s\n\n", aplicacao_maiuscula);
+    fprintf(pt_saida, "#include <stdint.h>\n");
+    fprintf(pt_saida, "#include \"esquema_payloads.h\"\n");
+
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        pt_payload = &esquema.payloads[i];
+        maiusculas(pt_payload->nome, nome_maiusculo);
+
+        fprintf(pt_saida, "\n/* %s %s */\n", (pt_payload->porta != 0) ? "Payload" : "Registro", pt_payload->nome);
+        if (pt_payload->porta != 0)
+        {
+            snprintf(texto, sizeof(texto), "PAYLOAD_%s_PORTA", nome_maiusculo);
+            fprintf(pt_saida, "#define %-*s %d\n", LARGURA_DEFINE, texto, pt_payload->porta);
+        }
+        snprintf(texto, sizeof(texto), "PAYLOAD_%s_TAM", nome_maiusculo);
+        fprintf(pt_saida, "#define %-*s %d   //bytes\n", LARGURA_DEFINE, texto, (pt_payload->bits + 7) / 8);
+
+        for (j = 0; j < pt_payload->qtde_campos; j++)
+        {
+            pt_campo = &pt_payload->campos[j];
+            if (pt_campo->real == false)
+            {
+                maiusculas(pt_campo->nome, campo_maiusculo);
+                snprintf(texto, sizeof(texto), "PAYLOAD_%s_%s_MAX", nome_maiusculo, campo_maiusculo);
+                fprintf(pt_saida, "#define %-*s %s\n", LARGURA_DEFINE, texto, literal_inteiro(pt_campo->max, texto_valor));
+            }
+        }
+
+        fprintf(pt_saida, "\ntypedef struct\n{\n");
+        for (j = 0; j < pt_payload->qtde_campos; j++)
+        {
+            pt_campo = &pt_payload->campos[j];
+            fprintf(pt_saida, "    %s %s;%s%s\n", tipo_campo(pt_campo), pt_campo->nome,
+                    (pt_campo->unidade[0] != '\0') ? "  // " : "", pt_campo->unidade);
+        }
+        fprintf(pt_saida, "}TPayload_%s;\n\n", pt_payload->nome);
+
+        if (pt_payload->idx_repetido >= 0)
+        {
+            maiusculas(esquema.payloads[pt_payload->idx_repetido].nome, campo_maiusculo);
+            fprintf(pt_saida, "_Static_assert(PAYLOAD_%s_TAM + PAYLOAD_%s_TAM <= %d, \"payload %s maior que o maximo do esquema\");\n",
+                    nome_maiusculo, campo_maiusculo, pt_payload->tam_max, pt_payload->nome);
+        }
+        else
+        {
+            fprintf(pt_saida, "_Static_assert(PAYLOAD_%s_TAM <= %d, \"payload %s maior que o maximo do esquema\");\n",
+                    nome_maiusculo, pt_payload->tam_max, pt_payload->nome);
+        }
+    }
+
+    fprintf(pt_saida, "\n/* Tabela dos payloads (decoder genérico) */\n");
+    snprintf(texto, sizeof(texto), "QTDE_PAYLOADS_%s", aplicacao_maiuscula);
+    fprintf(pt_saida, "#define %-*s %d\n\n", LARGURA_DEFINE, texto, esquema.qtde_payloads);
+    fprintf(pt_saida, "extern const TEsquema_payload payloads_%s[QTDE_PAYLOADS_%s];\n\n", esquema.aplicacao, aplicacao_maiuscula);
+    fprintf(pt_saida, "#endif\n\n");
+
+    fprintf(pt_saida, "/* Protótipos */\n");
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        pt_payload = &esquema.payloads[i];
+        fprintf(pt_saida, "void payload_%s_empacota(const TPayload_%s * pt_payload, uint8_t * pt_quadro);\n", pt_payload->nome, pt_payload->nome);
+        fprintf(pt_saida, "void payload_%s_desempacota(const uint8_t * pt_quadro, TPayload_%s * pt_payload);\n", pt_payload->nome, pt_payload->nome);
+    }
+}
+
+/* Função: gera o código do valor bruto de um campo, a partir do valor físico
+ * Parâmetros: - arquivo de saída
+ *             - campo
+ * Retorno: nenhum
+ */
+static void gera_valor_bruto(FILE * pt_saida, const TCampo * pt_campo)
+{
+    char texto_min[TAM_MAX_NOME];
+    char texto_max[TAM_MAX_NOME];
+    char texto_escala[TAM_MAX_NOME];
+    char texto_deslocamento[TAM_MAX_NOME];
+    char texto_sem_valor[TAM_MAX_NOME];
+    const char * pt_indentacao = pt_campo->tem_sem_valor ? "        " : "    ";
+
+    literal_inteiro(pt_campo->min, texto_min);
+    literal_inteiro(pt_campo->max, texto_max);
+
+    if (pt_campo->tem_sem_valor)
+    {
+        if (pt_campo->real)
+        {
+            fprintf(pt_saida, "    if (isnan(pt_payload->%s))\n    {\n", pt_campo->nome);
+        }
+        else
+        {
+            fprintf(pt_saida, "    if (pt_payload->%s == ESQUEMA_PAYLOADS_SEM_VALOR)\n    {\n", pt_campo->nome);
+        }
+        fprintf(pt_saida, "        bruto = %s;\n    }\n    else\n    {\n", literal_inteiro(pt_campo->sem_valor, texto_sem_valor));
+    }
+
+    if (pt_campo->real)
+    {
+        if (pt_campo->deslocamento != 0.0)
+        {
+            fprintf(pt_saida, "%sbruto = satura_real((pt_payload->%s %c %s) / %s, %s, %s);\n", pt_indentacao, pt_campo->nome,
+                    (pt_campo->deslocamento < 0.0) ? '+' : '-', literal_float(fabs(pt_campo->deslocamento), texto_deslocamento),
+                    literal_float(pt_campo->escala, texto_escala), texto_min, texto_max);
+        }
+        else
+        {
+            fprintf(pt_saida, "%sbruto = satura_real(pt_payload->%s / %s, %s, %s);\n", pt_indentacao, pt_campo->nome,
+                    literal_float(pt_campo->escala, texto_escala), texto_min, texto_max);
+        }
+    }
+    else if (satura_campo_inteiro(pt_campo) == false)
+    {
+        fprintf(pt_saida, "%sbruto = (int64_t)pt_payload->%s;\n", pt_indentacao, pt_campo->nome);
+    }
+    else
+    {
+        fprintf(pt_saida, "%sbruto = satura_inteiro(pt_payload->%s, %s, %s);\n", pt_indentacao, pt_campo->nome, texto_min, texto_max);
+    }
+
+    if (pt_campo->tem_sem_valor)
+    {
+        fprintf(pt_saida, "    }\n");
+    }
+}
+
+/* Função: gera o código que grava (ou lê) os bits de um campo, byte a byte
+ * Parâmetros: - arquivo de saída
+ *             - campo
+ *             - deslocamento (bytes) do registro no quadro (expressão C)
+ *             - true: grava; false: lê
+ * Retorno: nenhum
+ */
+static void gera_acesso_bits(FILE * pt_saida, const TCampo * pt_campo, bool grava)
+{
+    int inicio = pt_campo->bit_inicial;
+    int fim = pt_campo->bit_inicial + pt_campo->bits;
+    int byte;
+    int inicio_byte;
+    int fim_byte;
+    int qtde_bits;
+    int desloc_valor;
+    int desloc_byte;
+    char texto_valor[TAM_MAX_NOME];
+    char texto_byte[TAM_MAX_NOME];
+
+    for (byte = inicio / 8; byte <= (fim - 1) / 8; byte++)
+    {
+        inicio_byte = (inicio > byte * 8) ? inicio : (byte * 8);
+        fim_byte = (fim < (byte + 1) * 8) ? fim : ((byte + 1) * 8);
+        qtde_bits = fim_byte - inicio_byte;
+        desloc_valor = fim - fim_byte;            // bits do campo abaixo deste trecho
+        desloc_byte = ((byte + 1) * 8) - fim_byte; // bits do byte abaixo deste trecho
+
+        snprintf(texto_valor, sizeof(texto_valor), (desloc_valor != 0) ? "(bruto >> %d)" : "bruto", desloc_valor);
+        snprintf(texto_byte, sizeof(texto_byte), (desloc_byte != 0) ? "(pt_quadro[%d] >> %d)" : "pt_quadro[%d]", byte, desloc_byte);
+
+        if (grava)
+        {
+            fprintf(pt_saida, "    pt_quadro[%d] |= (uint8_t)(", byte);
+            fprintf(pt_saida, (desloc_byte != 0) ? "(%s & 0x%llXU) << %d);\n" : "%s & 0x%llXU);\n", texto_valor,
+                    mascara_bits(qtde_bits), desloc_byte);
+        }
+        else
+        {
+            fprintf(pt_saida, "    bruto |= (uint32_t)(%s & 0x%llXU)", texto_byte, mascara_bits(qtde_bits));
+            fprintf(pt_saida, (desloc_valor != 0) ? " << %d;\n" : ";\n", desloc_valor);
+        }
+    }
+}
+
+/* Função: gera o módulo (.c)
+ * Parâmetros: arquivo de saída
+ * Retorno: nenhum
+ */
+static void gera_modulo(FILE * pt_saida)
+{
+    const TPayload * pt_payload;
+    const TCampo * pt_campo;
+    char nome_maiusculo[TAM_MAX_NOME];
+    char aplicacao_maiuscula[TAM_MAX_NOME];
+    char texto_escala[TAM_MAX_NOME];
+    char texto_deslocamento[TAM_MAX_NOME];
+    char texto_sem_valor[TAM_MAX_NOME];
+    bool tem_real = false;
+    bool tem_inteiro = false;
+    int i;
+    int j;
+
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        for (j = 0; j < esquema.payloads[i].qtde_campos; j++)
+        {
+            tem_real |= esquema.payloads[i].campos[j].real;
+            tem_inteiro |= satura_campo_inteiro(&esquema.payloads[i].campos[j]);
+        }
+    }
+
+    maiusculas(esquema.aplicacao, aplicacao_maiuscula);
+
+    fprintf(pt_saida, "/* Módulo: payloads LoRaWAN - %s\n", esquema.descricao);
+    fprintf(pt_saida, " *\n");
+    fprintf(pt_saida, " * ARQUIVO GERADO por Ferramentas/gera_payloads a partir de payloads.esquema.\n");
+    fprintf(pt_saida, " * Não editar: altere o esquema e gere novamente (make -C Ferramentas payloads).\n");
+    fprintf(pt_saida, " *\n");
+    fprintf(pt_saida, " * OBS: este módulo não depende do ESP-IDF, de forma que também é compilado\n");
+    fprintf(pt_saida, " *      no computador (decoder dos payloads).\n");
+    fprintf(pt_saida, " */\n\n");
+    fprintf(pt_saida, "/* Includes */\n");
+    fprintf(pt_saida, "#include <stdint.h>\n");
+    fprintf(pt_saida, "#include <string.h>\n");
+    fprintf(pt_saida, "#include <math.h>\n");
+    fprintf(pt_saida, "#include \"payloads.h\"\n\n");
+
+    fprintf(pt_saida, "/* Funções locais */\n");
+    if (tem_inteiro)
+    {
+        fprintf(pt_saida, "static int64_t satura_inteiro(int64_t valor, int64_t min, int64_t max);\n");
+    }
+    if (tem_real)
+    {
+        fprintf(pt_saida, "static int64_t satura_real(float valor, int64_t min, int64_t max);\n");
+    }
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        fprintf(pt_saida, "static void decodifica_%s(const uint8_t * pt_quadro, double * pt_valores);\n", esquema.payloads[i].nome);
+    }
+
+    /* Tabela dos payloads */
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        pt_payload = &esquema.payloads[i];
+        fprintf(pt_saida, "\n/* Campos do %s %s */\n", (pt_payload->porta != 0) ? "payload" : "registro", pt_payload->nome);
+        fprintf(pt_saida, "static const TEsquema_campo campos_%s[] =\n{\n", pt_payload->nome);
+        for (j = 0; j < pt_payload->qtde_campos; j++)
+        {
+            fprintf(pt_saida, "    { \"%s\", \"%s\", %g },\n", pt_payload->campos[j].nome, pt_payload->campos[j].unidade, pt_payload->campos[j].escala);
+        }
+        fprintf(pt_saida, "};\n");
+    }
+
+    fprintf(pt_saida, "\n/* Tabela dos payloads (decoder genérico) */\n");
+    fprintf(pt_saida, "const TEsquema_payload payloads_%s[QTDE_PAYLOADS_%s] =\n{\n", esquema.aplicacao, aplicacao_maiuscula);
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        pt_payload = &esquema.payloads[i];
+        maiusculas(pt_payload->nome, nome_maiusculo);
+        fprintf(pt_saida, "    { \"%s\", %d, PAYLOAD_%s_TAM, %d, campos_%s, decodifica_%s, %d },\n", pt_payload->nome,
+                pt_payload->porta, nome_maiusculo, pt_payload->qtde_campos, pt_payload->nome, pt_payload->nome, pt_payload->idx_repetido);
+    }
+    fprintf(pt_saida, "};\n");
+
+    if (tem_inteiro)
+    {
+        fprintf(pt_saida, "\n/* Função: satura um valor inteiro na faixa de um campo\n");
+        fprintf(pt_saida, " * Parâmetros: - valor\n");
+        fprintf(pt_saida, " *             - valores mínimo e máximo\n");
+        fprintf(pt_saida, " * Retorno: valor saturado\n");
+        fprintf(pt_saida, " */\n");
+        fprintf(pt_saida, "static int64_t satura_inteiro(int64_t valor, int64_t min, int64_t max)\n{\n");
+        fprintf(pt_saida, "    if (valor < min)\n    {\n        return min;\n    }\n\n");
+        fprintf(pt_saida, "    return (valor > max) ? max : valor;\n}\n");
+    }
+
+    if (tem_real)
+    {
+        fprintf(pt_saida, "\n/* Função: arredonda e satura um valor (já em unidades brutas) na faixa de um campo\n");
+        fprintf(pt_saida, " * Parâmetros: - valor\n");
+        fprintf(pt_saida, " *             - valores mínimo e máximo\n");
+        fprintf(pt_saida, " * Retorno: valor bruto\n");
+        fprintf(pt_saida, " */\n");
+        fprintf(pt_saida, "static int64_t satura_real(float valor, int64_t min, int64_t max)\n{\n");
+        fprintf(pt_saida, "    if (!(valor > (float)min))\n    {\n        return min;\n    }\n\n");
+        fprintf(pt_saida, "    if (valor >= (float)max)\n    {\n        return max;\n    }\n\n");
+        fprintf(pt_saida, "    return (int64_t)lroundf(valor);\n}\n");
+    }
+
+    for (i = 0; i < esquema.qtde_payloads; i++)
+    {
+        pt_payload = &esquema.payloads[i];
+        maiusculas(pt_payload->nome, nome_maiusculo);
+
+        /* Empacotamento */
+        fprintf(pt_saida, "\n/* Função: empacota %s %s\n", (pt_payload->porta != 0) ? "o payload" : "o registro", pt_payload->nome);
+        fprintf(pt_saida, " * Parâmetros: - ponteiro para os valores\n");
+        fprintf(pt_saida, " *             - ponteiro para o quadro (PAYLOAD_%s_TAM bytes)\n", nome_maiusculo);
+        fprintf(pt_saida, " * Retorno: nenhum\n */\n");
+        fprintf(pt_saida, "void payload_%s_empacota(const TPayload_%s * pt_payload, uint8_t * pt_quadro)\n{\n", pt_payload->nome, pt_payload->nome);
+        fprintf(pt_saida, "    int64_t bruto;\n\n");
+        fprintf(pt_saida, "    memset(pt_quadro, 0, PAYLOAD_%s_TAM);\n", nome_maiusculo);
+        for (j = 0; j < pt_payload->qtde_campos; j++)
+        {
+            pt_campo = &pt_payload->campos[j];
+            fprintf(pt_saida, "\n    /* %s */\n", pt_campo->nome);
+            gera_valor_bruto(pt_saida, pt_campo);
+            gera_acesso_bits(pt_saida, pt_campo, true);
+        }
+        fprintf(pt_saida, "}\n");
+
+        /* Desempacotamento */
+        fprintf(pt_saida, "\n/* Função: desempacota %s %s\n", (pt_payload->porta != 0) ? "o payload" : "o registro", pt_payload->nome);
+        fprintf(pt_saida, " * Parâmetros: - ponteiro para o quadro (PAYLOAD_%s_TAM bytes)\n", nome_maiusculo);
+        fprintf(pt_saida, " *             - ponteiro para os valores\n");
+        fprintf(pt_saida, " * Retorno: nenhum\n */\n");
+        fprintf(pt_saida, "void payload_%s_desempacota(const uint8_t * pt_quadro, TPayload_%s * pt_payload)\n{\n", pt_payload->nome, pt_payload->nome);
+        fprintf(pt_saida, "    uint32_t bruto;\n");
+        for (j = 0; j < pt_payload->qtde_campos; j++)
+        {
+            pt_campo = &pt_payload->campos[j];
+            fprintf(pt_saida, "\n    /* %s */\n", pt_campo->nome);
+            fprintf(pt_saida, "    bruto = 0;\n");
+            gera_acesso_bits(pt_saida, pt_campo, false);
+
+            if (pt_campo->com_sinal && (pt_campo->bits < 32))
+            {
+                fprintf(pt_saida, "    if ((bruto & 0x%llXU) != 0)\n    {\n        bruto |= 0x%llXU;\n    }\n",
+                        1ULL << (pt_campo->bits - 1), 0xFFFFFFFFULL & ~mascara_bits(pt_campo->bits));
+            }
+
+            if (pt_campo->tem_sem_valor)
+            {
+                fprintf(pt_saida, "    if (bruto == (uint32_t)%s)\n    {\n", literal_inteiro(pt_campo->sem_valor, texto_sem_valor));
+                fprintf(pt_saida, "        pt_payload->%s = %s;\n", pt_campo->nome, pt_campo->real ? "NAN" : "ESQUEMA_PAYLOADS_SEM_VALOR");
+                fprintf(pt_saida, "    }\n    else\n    {\n    ");
+            }
+
+            if (pt_campo->real)
+            {
+                fprintf(pt_saida, "    pt_payload->%s = (float)%s * %s", pt_campo->nome,
+                        pt_campo->com_sinal ? "(int32_t)bruto" : "bruto", literal_float(pt_campo->escala, texto_escala));
+                if (pt_campo->deslocamento != 0.0)
+                {
+                    fprintf(pt_saida, " %c %s", (pt_campo->deslocamento < 0.0) ? '-' : '+',
+                            literal_float(fabs(pt_campo->deslocamento), texto_deslocamento));
+                }
+                fprintf(pt_saida, ";\n");
+            }
+            else
+            {
+                fprintf(pt_saida, "    pt_payload->%s = (%s)bruto;\n", pt_campo->nome, tipo_campo(pt_campo));
+            }
+
+            if (pt_campo->tem_sem_valor)
+            {
+                fprintf(pt_saida, "    }\n");
+            }
+        }
+        fprintf(pt_saida, "}\n");
+
+        /* Decodificação genérica (tabela) */
+        fprintf(pt_saida, "\n/* Função: decodifica %s %s para o decoder genérico\n", (pt_payload->porta != 0) ? "o payload" : "o registro", pt_payload->nome);
+        fprintf(pt_saida, " * Parâmetros: - ponteiro para o quadro (PAYLOAD_%s_TAM bytes)\n", nome_maiusculo);
+        fprintf(pt_saida, " *             - ponteiro para os valores (um por campo, NAN se sem valor)\n");
+        fprintf(pt_saida, " * Retorno: nenhum\n */\n");
+        fprintf(pt_saida, "static void decodifica_%s(const uint8_t * pt_quadro, double * pt_valores)\n{\n", pt_payload->nome);
+        fprintf(pt_saida, "    TPayload_%s payload;\n\n", pt_payload->nome);
+        fprintf(pt_saida, "    payload_%s_desempacota(pt_quadro, &payload);\n", pt_payload->nome);
+        for (j = 0; j < pt_payload->qtde_campos; j++)
+        {
+            pt_campo = &pt_payload->campos[j];
+            if (pt_campo->tem_sem_valor && (pt_campo->real == false))
+            {
+                fprintf(pt_saida, "    pt_valores[%d] = (payload.%s == ESQUEMA_PAYLOADS_SEM_VALOR) ? NAN : (double)payload.%s;\n",
+                        j, pt_campo->nome, pt_campo->nome);
+            }
+            else
+            {
+                fprintf(pt_saida, "    pt_valores[%d] = (double)payload.%s;\n", j, pt_campo->nome);
+            }
+        }
+        fprintf(pt_saida, "}\n");
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    char caminho[512];
+    FILE * saida;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "Uso: %s <payloads.esquema> <diretorio de saida>\n", argv[0]);
+        return 1;
+    }
+
+    le_esquema(argv[1]);
+
+    snprintf(caminho, sizeof(caminho), "%s/payloads.h", argv[2]);
+    saida = fopen(caminho, "w");
+    if (saida == NULL)
+    {
+        fprintf(stderr, "Nao foi possivel escrever %s\n", caminho);
+        return 1;
+    }
+    gera_header(saida);
+    fclose(saida);
+
+    snprintf(caminho, sizeof(caminho), "%s/payloads.c", argv[2]);
+    saida = fopen(caminho, "w");
+    if (saida == NULL)
+    {
+        fprintf(stderr, "Nao foi possivel escrever %s\n", caminho);
+        return 1;
+    }
+    gera_modulo(saida);
+    fclose(saida);
+
+    printf("%s: %d payload(s)/registro(s) gerados em %s\n", argv[1], esquema.qtde_payloads, argv[2]);
+    return 0;
+}
@@ -0,0 +1,741 @@
+/* Módulo: decodificador em lote dos uplinks dos projetos (computador)
+ */
+
+/* Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "decodificador_lote.h"
+#include "texto_binario.h"
+#include "Cap6/contador_pulsos_lorawan/main/payloads/payloads.h"
+#include "Cap7/Software/lixo_lorawan/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/serie_temperaturas/serie_temperaturas.h"
+#include "Cap6/contador_pulsos_lorawan/main/historico_pulsos/historico_pulsos.h"
+
+/* Definição - porta da série de temperaturas (main.c do capítulo 8) */
+#define PORTA_SERIE_TEMPERATURAS   13
+
+/* Definição - porta do histórico dos contadores (envios_lorawan.c do capítulo 6) */
+#define PORTA_HISTORICO_PULSOS     13
+
+/* Tipo do formato de uma porta */
+typedef enum
+{
+    FORMATO_ESQUEMA = 0,        // payload do esquema (com ou sem registros repetidos)
+    FORMATO_SERIE,              // série de temperaturas (serie_temperaturas.c)
+    FORMATO_HISTORICO           // histórico dos contadores de pulsos (historico_pulsos.c)
+}TTipo_formato;
+
+/* Formato dos payloads de uma porta */
+typedef struct
+{
+    int porta;
+    TTipo_formato tipo;
+    const TEsquema_payload * pt_payload;
+    const TEsquema_payload * pt_registro;   // registro repetido, ou NULL
+    int qtde_colunas;
+    const char * pt_nomes_colunas[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];
+    const char * pt_unidades_colunas[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];
+    double resolucoes_colunas[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];
+}TFormato_porta;
+
+/* Parte do lote processada por uma thread */
+typedef struct
+{
+    struct TDecodificador_lote * pt_decodificador;
+    int idx_thread;
+    int idx_inicio;
+    int idx_fim;
+    uint8_t * pt_bytes;
+    int capacidade_bytes;
+    int qtde_linhas[DECODIFICADOR_LOTE_QTDE_MAX_TABELAS];
+    int linha_inicial[DECODIFICADOR_LOTE_QTDE_MAX_TABELAS];
+    int qtde_invalidos;
+    bool falha_memoria;
+}TParte_lote;
+
+/* Decodificador */
+struct TDecodificador_lote
+{
+    int qtde_formatos;
+    TFormato_porta formatos[DECODIFICADOR_LOTE_QTDE_MAX_TABELAS];
+    int8_t idx_formato_porta[256];
+    int qtde_threads;
+    TParte_lote partes[DECODIFICADOR_LOTE_QTDE_MAX_THREADS];
+    pthread_barrier_t barreira;
+
+    /* Lote em decodificação */
+    const TUplink_texto * pt_uplinks;
+    int qtde_uplinks;
+    TSaida_lote * pt_saida;
+    int32_t * pt_deslocamentos;     // por uplink: início dos bytes na área da thread
+    int16_t * pt_tams;              // por uplink: quantidade de bytes
+    int capacidade_uplinks;
+    bool falha_memoria;
+};
+
+/* Funções locais */
+static bool adiciona_formato(TDecodificador_lote * pt_decodificador, const TEsquema_payload * pt_payloads, int idx_payload, TTipo_formato tipo);
+static int conta_linhas(const TFormato_porta * pt_formato, const uint8_t * pt_quadro, int tam_quadro);
+static int escreve_linhas(const TFormato_porta * pt_formato, const uint8_t * pt_quadro, int tam_quadro, TTabela_lote * pt_tabela, int linha, uint32_t dev_addr, int32_t idx_uplink);
+static bool garante_capacidade_tabela(TTabela_lote * pt_tabela, int qtde_linhas);
+static void valida_parte(TParte_lote * pt_parte);
+static void posiciona_linhas(TDecodificador_lote * pt_decodificador);
+static void escreve_parte(TParte_lote * pt_parte);
+static void * executa_parte(void * pt_arg);
+
+/* Função: adiciona o formato de uma porta ao decodificador
+ * Parâmetros: - ponteiro para o decodificador
+ *             - tabela de payloads do esquema (NULL na série de temperaturas e no histórico)
+ *             - índice do payload na tabela
+ *             - tipo do formato
+ * Retorno: true: adicionado; false: excede os limites do decodificador
+ */
+static bool adiciona_formato(TDecodificador_lote * pt_decodificador, const TEsquema_payload * pt_payloads, int idx_payload, TTipo_formato tipo)
+{
+    TFormato_porta * pt_formato = &pt_decodificador->formatos[pt_decodificador->qtde_formatos];
+    const TEsquema_payload * pt_parte_payload;
+    int i;
+
+    if (pt_decodificador->qtde_formatos >= DECODIFICADOR_LOTE_QTDE_MAX_TABELAS)
+    {
+        return false;
+    }
+
+    memset(pt_formato, 0x00, sizeof(TFormato_porta));
+    pt_formato->tipo = tipo;
+
+    if (tipo == FORMATO_SERIE)
+    {
+        pt_formato->porta = PORTA_SERIE_TEMPERATURAS;
+        pt_formato->qtde_colunas = 3;
+        pt_formato->pt_nomes_colunas[0] = "passo";
+        pt_formato->pt_unidades_colunas[0] = "";
+        pt_formato->resolucoes_colunas[0] = 1.0;
+        pt_formato->pt_nomes_colunas[1] = "indice";
+        pt_formato->pt_unidades_colunas[1] = "";
+        pt_formato->resolucoes_colunas[1] = 1.0;
+        pt_formato->pt_nomes_colunas[2] = "temperatura";
+        pt_formato->pt_unidades_colunas[2] = "C";
+        pt_formato->resolucoes_colunas[2] = 0.1;
+    }
+    else if (tipo == FORMATO_HISTORICO)
+    {
+        pt_formato->porta = PORTA_HISTORICO_PULSOS;
+        pt_formato->qtde_colunas = 5;
+        pt_formato->pt_nomes_colunas[0] = "passo";
+        pt_formato->pt_unidades_colunas[0] = "min";
+        pt_formato->resolucoes_colunas[0] = 1.0;
+        pt_formato->pt_nomes_colunas[1] = "indice";
+        pt_formato->pt_unidades_colunas[1] = "";
+        pt_formato->resolucoes_colunas[1] = 1.0;
+        pt_formato->pt_nomes_colunas[2] = "minutos";
+        pt_formato->pt_unidades_colunas[2] = "min";
+        pt_formato->resolucoes_colunas[2] = 1.0;
+        pt_formato->pt_nomes_colunas[3] = "pulsos_1";
+        pt_formato->pt_unidades_colunas[3] = "pulsos";
+        pt_formato->resolucoes_colunas[3] = 1.0;
+        pt_formato->pt_nomes_colunas[4] = "pulsos_2";
+        pt_formato->pt_unidades_colunas[4] = "pulsos";
+        pt_formato->resolucoes_colunas[4] = 1.0;
+    }
+    else
+    {
+        pt_formato->pt_payload = &pt_payloads[idx_payload];
+        pt_formato->pt_registro = (pt_formato->pt_payload->idx_repetido >= 0) ? &pt_payloads[pt_formato->pt_payload->idx_repetido] : NULL;
+        pt_formato->porta = pt_formato->pt_payload->porta;
+
+        /* Colunas: campos do payload seguidos dos campos do registro repetido */
+        for (pt_parte_payload = pt_formato->pt_payload; pt_parte_payload != NULL;
+             pt_parte_payload = (pt_parte_payload == pt_formato->pt_payload) ? pt_formato->pt_registro : NULL)
+        {
+            for (i = 0; i < pt_parte_payload->qtde_campos; i++)
+            {
+                if (pt_formato->qtde_colunas >= DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS)
+                {
+                    return false;
+                }
+
+                pt_formato->pt_nomes_colunas[pt_formato->qtde_colunas] = pt_parte_payload->pt_campos[i].pt_nome;
+                pt_formato->pt_unidades_colunas[pt_formato->qtde_colunas] = pt_parte_payload->pt_campos[i].pt_unidade;
+                pt_formato->resolucoes_colunas[pt_formato->qtde_colunas] = pt_parte_payload->pt_campos[i].escala;
+                pt_formato->qtde_colunas++;
+            }
+        }
+    }
+
+    pt_decodificador->idx_formato_porta[pt_formato->porta] = (int8_t)pt_decodificador->qtde_formatos;
+    pt_decodificador->qtde_formatos++;
+    return true;
+}
+
+/* Função: valida um payload e conta as linhas que ele gera na tabela da porta
+ * Parâmetros: - ponteiro para o formato da porta
+ *             - ponteiro para os bytes do payload
+ *             - quantidade de bytes
+ * Retorno: quantidade de linhas. -1 se o payload for inválido.
+ */
+static int conta_linhas(const TFormato_porta * pt_formato, const uint8_t * pt_quadro, int tam_quadro)
+{
+    int16_t amostras_x10[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    THistorico_pulsos_quadro historico;
+    int tam_registros;
+    int passo;
+
+    if (pt_formato->tipo == FORMATO_SERIE)
+    {
+        return serie_temperaturas_decodifica(pt_quadro, tam_quadro, amostras_x10, SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS, &passo);
+    }
+
+    if (pt_formato->tipo == FORMATO_HISTORICO)
+    {
+        return historico_pulsos_decodifica(pt_quadro, tam_quadro, &historico);
+    }
+
+    if (pt_formato->pt_registro == NULL)
+    {
+        return (tam_quadro == pt_formato->pt_payload->tam) ? 1 : -1;
+    }
+
+    tam_registros = tam_quadro - pt_formato->pt_payload->tam;
+
+    if ((tam_registros <= 0) || ((tam_registros % pt_formato->pt_registro->tam) != 0))
+    {
+        return -1;
+    }
+
+    return tam_registros / pt_formato->pt_registro->tam;
+}
+
+/* Função: decodifica um payload (já validado) nas linhas da tabela da porta
+ * Parâmetros: - ponteiro para o formato da porta
+ *             - ponteiro para os bytes do payload
+ *             - quantidade de bytes
+ *             - ponteiro para a tabela
+ *             - primeira linha do payload na tabela
+ *             - DevAddr e índice do uplink no lote
+ * Retorno: quantidade de linhas escritas
+ */
+static int escreve_linhas(const TFormato_porta * pt_formato, const uint8_t * pt_quadro, int tam_quadro, TTabela_lote * pt_tabela, int linha, uint32_t dev_addr, int32_t idx_uplink)
+{
+    int16_t amostras_x10[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    THistorico_pulsos_quadro historico;
+    double valores[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];
+    int qtde_linhas;
+    int qtde_campos_payload;
+    int passo;
+    int i;
+    int j;
+
+    if (pt_formato->tipo == FORMATO_SERIE)
+    {
+        qtde_linhas = serie_temperaturas_decodifica(pt_quadro, tam_quadro, amostras_x10, SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS, &passo);
+
+        for (i = 0; i < qtde_linhas; i++, linha++)
+        {
+            pt_tabela->pt_dev_addr[linha] = dev_addr;
+            pt_tabela->pt_idx_uplink[linha] = idx_uplink;
+            pt_tabela->pt_colunas[0][linha] = passo;
+            pt_tabela->pt_colunas[1][linha] = i;
+            pt_tabela->pt_colunas[2][linha] = amostras_x10[i] / 10.0;
+        }
+
+        return qtde_linhas;
+    }
+
+    if (pt_formato->tipo == FORMATO_HISTORICO)
+    {
+        qtde_linhas = historico_pulsos_decodifica(pt_quadro, tam_quadro, &historico);
+
+        /* Uma linha por bloco; o último bloco pode ter menos que "passo" minutos */
+        for (i = 0; i < qtde_linhas; i++, linha++)
+        {
+            pt_tabela->pt_dev_addr[linha] = dev_addr;
+            pt_tabela->pt_idx_uplink[linha] = idx_uplink;
+            pt_tabela->pt_colunas[0][linha] = historico.passo;
+            pt_tabela->pt_colunas[1][linha] = i;
+            pt_tabela->pt_colunas[2][linha] = (i < (qtde_linhas - 1)) ? historico.passo : (historico.qtde_minutos - (i * historico.passo));
+            pt_tabela->pt_colunas[3][linha] = historico.somas[0][i];
+            pt_tabela->pt_colunas[4][linha] = historico.somas[1][i];
+        }
+
+        return qtde_linhas;
+    }
+
+    pt_formato->pt_payload->decodifica(pt_quadro, valores);
+    qtde_linhas = conta_linhas(pt_formato, pt_quadro, tam_quadro);
+    qtde_campos_payload = pt_formato->pt_payload->qtde_campos;
+
+    for (i = 0; i < qtde_linhas; i++, linha++)
+    {
+        if (pt_formato->pt_registro != NULL)
+        {
+            pt_formato->pt_registro->decodifica(&pt_quadro[pt_formato->pt_payload->tam + (i * pt_formato->pt_registro->tam)], &valores[qtde_campos_payload]);
+        }
+
+        pt_tabela->pt_dev_addr[linha] = dev_addr;
+        pt_tabela->pt_idx_uplink[linha] = idx_uplink;
+
+        for (j = 0; j < pt_formato->qtde_colunas; j++)
+        {
+            pt_tabela->pt_colunas[j][linha] = valores[j];
+        }
+    }
+
+    return qtde_linhas;
+}
+
+/* Função: garante a capacidade das colunas de uma tabela
+ * Parâmetros: - ponteiro para a tabela
+ *             - quantidade de linhas
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool garante_capacidade_tabela(TTabela_lote * pt_tabela, int qtde_linhas)
+{
+    int capacidade = (pt_tabela->capacidade > 0) ? pt_tabela->capacidade : 1024;
+    void * pt_novo;
+    int i;
+
+    if (qtde_linhas <= pt_tabela->capacidade)
+    {
+        return true;
+    }
+
+    while (capacidade < qtde_linhas)
+    {
+        capacidade *= 2;
+    }
+
+    if ((pt_novo = realloc(pt_tabela->pt_dev_addr, capacidade * sizeof(uint32_t))) == NULL)
+    {
+        return false;
+    }
+    pt_tabela->pt_dev_addr = pt_novo;
+
+    if ((pt_novo = realloc(pt_tabela->pt_idx_uplink, capacidade * sizeof(int32_t))) == NULL)
+    {
+        return false;
+    }
+    pt_tabela->pt_idx_uplink = pt_novo;
+
+    for (i = 0; i < DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS; i++)
+    {
+        if ((pt_novo = realloc(pt_tabela->pt_colunas[i], capacidade * sizeof(double))) == NULL)
+        {
+            return false;
+        }
+        pt_tabela->pt_colunas[i] = pt_novo;
+    }
+
+    pt_tabela->capacidade = capacidade;
+    return true;
+}
+
+/* Função: etapa 1 de uma thread: converte os payloads da sua parte do lote
+ *         para bytes, valida e conta as linhas de cada tabela
+ * Parâmetros: ponteiro para a parte do lote
+ * Retorno: nenhum
+ */
+static void valida_parte(TParte_lote * pt_parte)
+{
+    TDecodificador_lote * pt_decodificador = pt_parte->pt_decodificador;
+    const TUplink_texto * pt_uplink;
+    int8_t * pt_idx_tabela = pt_decodificador->pt_saida->pt_idx_tabela;
+    int8_t idx_formato;
+    int tam_bytes = 0;
+    int qtde_linhas;
+    int tam_quadro;
+    int i;
+    void * pt_novo;
+
+    memset(pt_parte->qtde_linhas, 0x00, sizeof(pt_parte->qtde_linhas));
+    pt_parte->qtde_invalidos = 0;
+    pt_parte->falha_memoria = false;
+
+    for (i = pt_parte->idx_inicio; i < pt_parte->idx_fim; i++)
+    {
+        pt_uplink = &pt_decodificador->pt_uplinks[i];
+        tam_bytes += texto_binario_tam_max((TCodificacao_texto)pt_uplink->codificacao, pt_uplink->tam_texto);
+    }
+
+    if (tam_bytes > pt_parte->capacidade_bytes)
+    {
+        if ((pt_novo = realloc(pt_parte->pt_bytes, tam_bytes)) == NULL)
+        {
+            pt_parte->falha_memoria = true;
+            return;
+        }
+
+        pt_parte->pt_bytes = pt_novo;
+        pt_parte->capacidade_bytes = tam_bytes;
+    }
+
+    for (i = pt_parte->idx_inicio, tam_bytes = 0; i < pt_parte->idx_fim; i++)
+    {
+        pt_uplink = &pt_decodificador->pt_uplinks[i];
+        idx_formato = pt_decodificador->idx_formato_porta[pt_uplink->porta];
+        pt_idx_tabela[i] = DECODIFICADOR_LOTE_INVALIDO;
+
+        tam_quadro = (idx_formato < 0) ? -1 : texto_binario_converte((TCodificacao_texto)pt_uplink->codificacao, pt_uplink->pt_texto,
+                                                                      pt_uplink->tam_texto, &pt_parte->pt_bytes[tam_bytes]);
+        qtde_linhas = ((tam_quadro <= 0) || (tam_quadro > DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD)) ? -1 :
+                      conta_linhas(&pt_decodificador->formatos[idx_formato], &pt_parte->pt_bytes[tam_bytes], tam_quadro);
+
+        if (qtde_linhas <= 0)
+        {
+            pt_parte->qtde_invalidos++;
+            continue;
+        }
+
+        pt_idx_tabela[i] = idx_formato;
+        pt_decodificador->pt_deslocamentos[i] = tam_bytes;
+        pt_decodificador->pt_tams[i] = (int16_t)tam_quadro;
+        pt_parte->qtde_linhas[idx_formato] += qtde_linhas;
+        tam_bytes += tam_quadro;
+    }
+}
+
+/* Função: entre as etapas: posiciona as linhas de cada thread nas tabelas
+ *         (soma acumulada, na ordem das partes) e garante a capacidade delas
+ * Parâmetros: ponteiro para o decodificador
+ * Retorno: nenhum
+ */
+static void posiciona_linhas(TDecodificador_lote * pt_decodificador)
+{
+    TSaida_lote * pt_saida = pt_decodificador->pt_saida;
+    int qtde_linhas;
+    int i;
+    int j;
+
+    pt_saida->qtde_invalidos = 0;
+
+    for (j = 0; j < pt_decodificador->qtde_threads; j++)
+    {
+        pt_decodificador->falha_memoria |= pt_decodificador->partes[j].falha_memoria;
+        pt_saida->qtde_invalidos += pt_decodificador->partes[j].qtde_invalidos;
+    }
+
+    for (i = 0; i < pt_decodificador->qtde_formatos; i++)
+    {
+        for (j = 0, qtde_linhas = 0; j < pt_decodificador->qtde_threads; j++)
+        {
+            pt_decodificador->partes[j].linha_inicial[i] = qtde_linhas;
+            qtde_linhas += pt_decodificador->partes[j].qtde_linhas[i];
+        }
+
+        pt_saida->tabelas[i].qtde_linhas = qtde_linhas;
+
+        if (garante_capacidade_tabela(&pt_saida->tabelas[i], qtde_linhas) == false)
+        {
+            pt_decodificador->falha_memoria = true;
+        }
+    }
+}
+
+/* Função: etapa 2 de uma thread: escreve as linhas da sua parte do lote
+ * Parâmetros: ponteiro para a parte do lote
+ * Retorno: nenhum
+ */
+static void escreve_parte(TParte_lote * pt_parte)
+{
+    TDecodificador_lote * pt_decodificador = pt_parte->pt_decodificador;
+    TSaida_lote * pt_saida = pt_decodificador->pt_saida;
+    const TFormato_porta * pt_formato;
+    const uint8_t * pt_quadro;
+    int linha[DECODIFICADOR_LOTE_QTDE_MAX_TABELAS];
+    int8_t idx_formato;
+    int i;
+
+    memcpy(linha, pt_parte->linha_inicial, sizeof(linha));
+
+    for (i = pt_parte->idx_inicio; i < pt_parte->idx_fim; i++)
+    {
+        idx_formato = pt_saida->pt_idx_tabela[i];
+
+        if (idx_formato == DECODIFICADOR_LOTE_INVALIDO)
+        {
+            continue;
+        }
+
+        pt_formato = &pt_decodificador->formatos[idx_formato];
+        pt_quadro = &pt_parte->pt_bytes[pt_decodificador->pt_deslocamentos[i]];
+        linha[idx_formato] += escreve_linhas(pt_formato, pt_quadro, pt_decodificador->pt_tams[i], &pt_saida->tabelas[idx_formato],
+                                             linha[idx_formato], pt_decodificador->pt_uplinks[i].dev_addr, i);
+    }
+}
+
+/* Função: processa a parte do lote de uma thread (as duas etapas)
+ * Parâmetros: ponteiro para a parte do lote
+ * Retorno: NULL
+ */
+static void * executa_parte(void * pt_arg)
+{
+    TParte_lote * pt_parte = (TParte_lote *)pt_arg;
+    TDecodificador_lote * pt_decodificador = pt_parte->pt_decodificador;
+
+    valida_parte(pt_parte);
+
+    if (pt_decodificador->qtde_threads > 1)
+    {
+        pthread_barrier_wait(&pt_decodificador->barreira);
+    }
+
+    if (pt_parte->idx_thread == 0)
+    {
+        posiciona_linhas(pt_decodificador);
+    }
+
+    if (pt_decodificador->qtde_threads > 1)
+    {
+        pthread_barrier_wait(&pt_decodificador->barreira);
+    }
+
+    if (pt_decodificador->falha_memoria == false)
+    {
+        escreve_parte(pt_parte);
+    }
+
+    return NULL;
+}
+
+/* Função: cria o decodificador de uma aplicação
+ * Parâmetros: - aplicação
+ *             - quantidade de threads (1 a DECODIFICADOR_LOTE_QTDE_MAX_THREADS)
+ * Retorno: ponteiro para o decodificador. NULL em caso de falha.
+ */
+TDecodificador_lote * decodificador_lote_cria(TAplicacao_lote aplicacao, int qtde_threads)
+{
+    static const struct
+    {
+        const TEsquema_payload * pt_payloads;
+        int qtde_payloads;
+    }esquemas[QTDE_APLICACOES_LOTE] =
+    {
+        { payloads_cap6, QTDE_PAYLOADS_CAP6 },
+        { payloads_cap7, QTDE_PAYLOADS_CAP7 },
+        { payloads_cap8, QTDE_PAYLOADS_CAP8 },
+    };
+    TDecodificador_lote * pt_decodificador;
+    bool sucesso = true;
+    int i;
+
+    if ((aplicacao >= QTDE_APLICACOES_LOTE) || (qtde_threads < 1) || (qtde_threads > DECODIFICADOR_LOTE_QTDE_MAX_THREADS))
+    {
+        return NULL;
+    }
+
+    if ((pt_decodificador = calloc(1, sizeof(TDecodificador_lote))) == NULL)
+    {
+        return NULL;
+    }
+
+    memset(pt_decodificador->idx_formato_porta, DECODIFICADOR_LOTE_INVALIDO, sizeof(pt_decodificador->idx_formato_porta));
+
+    for (i = 0; i < esquemas[aplicacao].qtde_payloads; i++)
+    {
+        if (esquemas[aplicacao].pt_payloads[i].porta != 0)
+        {
+            sucesso &= adiciona_formato(pt_decodificador, esquemas[aplicacao].pt_payloads, i, FORMATO_ESQUEMA);
+        }
+    }
+
+    if (aplicacao == APLICACAO_CAP6)
+    {
+        sucesso &= adiciona_formato(pt_decodificador, NULL, 0, FORMATO_HISTORICO);
+    }
+
+    if (aplicacao == APLICACAO_CAP8)
+    {
+        sucesso &= adiciona_formato(pt_decodificador, NULL, 0, FORMATO_SERIE);
+    }
+
+    if ((sucesso == false) || ((qtde_threads > 1) && (pthread_barrier_init(&pt_decodificador->barreira, NULL, qtde_threads) != 0)))
+    {
+        free(pt_decodificador);
+        return NULL;
+    }
+
+    pt_decodificador->qtde_threads = qtde_threads;
+
+    for (i = 0; i < qtde_threads; i++)
+    {
+        pt_decodificador->partes[i].pt_decodificador = pt_decodificador;
+        pt_decodificador->partes[i].idx_thread = i;
+    }
+
+    return pt_decodificador;
+}
+
+/* Função: destrói o decodificador
+ * Parâmetros: ponteiro para o decodificador
+ * Retorno: nenhum
+ */
+void decodificador_lote_destroi(TDecodificador_lote * pt_decodificador)
+{
+    int i;
+
+    if (pt_decodificador == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < pt_decodificador->qtde_threads; i++)
+    {
+        free(pt_decodificador->partes[i].pt_bytes);
+    }
+
+    if (pt_decodificador->qtde_threads > 1)
+    {
+        pthread_barrier_destroy(&pt_decodificador->barreira);
+    }
+
+    free(pt_decodificador->pt_deslocamentos);
+    free(pt_decodificador->pt_tams);
+    free(pt_decodificador);
+}
+
+/* Função: decodifica um lote de uplinks
+ * Parâmetros: - ponteiro para o decodificador
+ *             - ponteiro para os uplinks
+ *             - quantidade de uplinks
+ *             - ponteiro para o resultado (iniciado com decodificador_lote_inicia_saida();
+ *               pode ser reaproveitado entre lotes)
+ * Retorno: quantidade de uplinks decodificados. -1 em caso de falta de memória.
+ */
+int decodificador_lote_decodifica(TDecodificador_lote * pt_decodificador, const TUplink_texto * pt_uplinks, int qtde_uplinks, TSaida_lote * pt_saida)
+{
+    pthread_t threads[DECODIFICADOR_LOTE_QTDE_MAX_THREADS];
+    const TFormato_porta * pt_formato;
+    TTabela_lote * pt_tabela;
+    void * pt_novo;
+    int qtde_por_thread;
+    int i;
+
+    if (qtde_uplinks > pt_decodificador->capacidade_uplinks)
+    {
+        if ((pt_novo = realloc(pt_decodificador->pt_deslocamentos, qtde_uplinks * sizeof(int32_t))) == NULL)
+        {
+            return -1;
+        }
+        pt_decodificador->pt_deslocamentos = pt_novo;
+
+        if ((pt_novo = realloc(pt_decodificador->pt_tams, qtde_uplinks * sizeof(int16_t))) == NULL)
+        {
+            return -1;
+        }
+        pt_decodificador->pt_tams = pt_novo;
+        pt_decodificador->capacidade_uplinks = qtde_uplinks;
+    }
+
+    if (qtde_uplinks > pt_saida->capacidade)
+    {
+        if ((pt_novo = realloc(pt_saida->pt_idx_tabela, qtde_uplinks * sizeof(int8_t))) == NULL)
+        {
+            return -1;
+        }
+        pt_saida->pt_idx_tabela = pt_novo;
+        pt_saida->capacidade = qtde_uplinks;
+    }
+
+    pt_saida->qtde_uplinks = qtde_uplinks;
+    pt_saida->qtde_tabelas = pt_decodificador->qtde_formatos;
+
+    for (i = 0; i < pt_decodificador->qtde_formatos; i++)
+    {
+        pt_formato = &pt_decodificador->formatos[i];
+        pt_tabela = &pt_saida->tabelas[i];
+        if (pt_formato->tipo == FORMATO_SERIE)
+        {
+            pt_tabela->pt_nome = "serie_temperaturas";
+        }
+        else if (pt_formato->tipo == FORMATO_HISTORICO)
+        {
+            pt_tabela->pt_nome = "historico_pulsos";
+        }
+        else
+        {
+            pt_tabela->pt_nome = pt_formato->pt_payload->pt_nome;
+        }
+        pt_tabela->porta = pt_formato->porta;
+        pt_tabela->qtde_colunas = pt_formato->qtde_colunas;
+        memcpy(pt_tabela->pt_nomes_colunas, pt_formato->pt_nomes_colunas, sizeof(pt_tabela->pt_nomes_colunas));
+        memcpy(pt_tabela->pt_unidades_colunas, pt_formato->pt_unidades_colunas, sizeof(pt_tabela->pt_unidades_colunas));
+        memcpy(pt_tabela->resolucoes_colunas, pt_formato->resolucoes_colunas, sizeof(pt_tabela->resolucoes_colunas));
+        pt_tabela->qtde_linhas = 0;
+    }
+
+    pt_decodificador->pt_uplinks = pt_uplinks;
+    pt_decodificador->qtde_uplinks = qtde_uplinks;
+    pt_decodificador->pt_saida = pt_saida;
+    pt_decodificador->falha_memoria = false;
+
+    qtde_por_thread = (qtde_uplinks + pt_decodificador->qtde_threads - 1) / pt_decodificador->qtde_threads;
+
+    for (i = 0; i < pt_decodificador->qtde_threads; i++)
+    {
+        pt_decodificador->partes[i].idx_inicio = (i * qtde_por_thread < qtde_uplinks) ? (i * qtde_por_thread) : qtde_uplinks;
+        pt_decodificador->partes[i].idx_fim = (pt_decodificador->partes[i].idx_inicio + qtde_por_thread < qtde_uplinks) ?
+                                              (pt_decodificador->partes[i].idx_inicio + qtde_por_thread) : qtde_uplinks;
+    }
+
+    for (i = 1; i < pt_decodificador->qtde_threads; i++)
+    {
+        if (pthread_create(&threads[i], NULL, executa_parte, &pt_decodificador->partes[i]) != 0)
+        {
+            /* A barreira espera todas as threads: sem uma delas, o lote não pode continuar */
+            abort();
+        }
+    }
+
+    executa_parte(&pt_decodificador->partes[0]);
+
+    for (i = 1; i < pt_decodificador->qtde_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    if (pt_decodificador->falha_memoria == true)
+    {
+        return -1;
+    }
+
+    return qtde_uplinks - pt_saida->qtde_invalidos;
+}
+
+/* Função: inicia o resultado (vazio, sem memória alocada)
+ * Parâmetros: ponteiro para o resultado
+ * Retorno: nenhum
+ */
+void decodificador_lote_inicia_saida(TSaida_lote * pt_saida)
+{
+    memset(pt_saida, 0x00, sizeof(TSaida_lote));
+}
+
+/* Função: libera a memória do resultado
+ * Parâmetros: ponteiro para o resultado
+ * Retorno: nenhum
+ */
+void decodificador_lote_libera_saida(TSaida_lote * pt_saida)
+{
+    int i;
+    int j;
+
+    free(pt_saida->pt_idx_tabela);
+
+    for (i = 0; i < DECODIFICADOR_LOTE_QTDE_MAX_TABELAS; i++)
+    {
+        free(pt_saida->tabelas[i].pt_dev_addr);
+        free(pt_saida->tabelas[i].pt_idx_uplink);
+
+        for (j = 0; j < DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS; j++)
+        {
+            free(pt_saida->tabelas[i].pt_colunas[j]);
+        }
+    }
+
+    decodificador_lote_inicia_saida(pt_saida);
+}
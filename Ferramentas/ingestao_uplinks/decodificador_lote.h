@@ -0,0 +1,92 @@
+/* Header file: decodificador em lote dos uplinks dos projetos (computador)
+ *
+ * Recebe lotes de uplinks de uma aplicação (DevAddr, porta e payload em
+ * hexadecimal ou base64) e decodifica os payloads em tabelas colunares
+ * (uma por porta): cada coluna é um vetor de double com um valor por linha,
+ * e cada linha é um registro decodificado (um resumo, uma leitura de um
+ * lote, uma amostra de uma série), com o DevAddr e o índice do uplink de
+ * origem. Os formatos vêm dos esquemas de payloads de cada aplicação
+ * (payloads.c gerado) e do codec da série de temperaturas (capítulo 8).
+ *
+ * O lote é dividido em partes iguais entre as threads, em duas etapas:
+ * 1) cada thread converte o texto dos seus uplinks para bytes, valida o
+ *    formato e conta as linhas de cada tabela;
+ * 2) com as linhas de cada thread já posicionadas nas tabelas (soma
+ *    acumulada feita entre as etapas), cada thread escreve as suas.
+ * As linhas ficam na ordem dos uplinks no lote, com qualquer quantidade de
+ * threads. A conversão do texto usa a implementação escolhida por
+ * texto_binario_seleciona() (escalar, se ela não for chamada).
+ */
+
+#ifndef HEADER_DECODIFICADOR_LOTE
+#define HEADER_DECODIFICADOR_LOTE
+
+#include <stdint.h>
+#include "texto_binario.h"
+
+/* Definições - limites */
+#define DECODIFICADOR_LOTE_QTDE_MAX_THREADS   64
+#define DECODIFICADOR_LOTE_QTDE_MAX_TABELAS   4
+#define DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS   12
+#define DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD    242   //bytes
+
+/* Definição - índice de tabela de um uplink não decodificado */
+#define DECODIFICADOR_LOTE_INVALIDO           (-1)
+
+/* Aplicação dos uplinks do lote */
+typedef enum
+{
+    APLICACAO_CAP6 = 0,
+    APLICACAO_CAP7,
+    APLICACAO_CAP8,
+    QTDE_APLICACOES_LOTE
+}TAplicacao_lote;
+
+/* Uplink recebido (payload em texto, não copiado) */
+typedef struct
+{
+    uint32_t dev_addr;
+    uint8_t porta;
+    uint8_t codificacao;        // TCodificacao_texto
+    uint16_t tam_texto;         // caracteres
+    const char * pt_texto;
+}TUplink_texto;
+
+/* Tabela colunar dos registros decodificados de uma porta */
+typedef struct
+{
+    const char * pt_nome;
+    int porta;
+    int qtde_colunas;
+    const char * pt_nomes_colunas[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];
+    const char * pt_unidades_colunas[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];
+    double resolucoes_colunas[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];     // passo dos valores de cada coluna
+    int qtde_linhas;
+    int capacidade;
+    uint32_t * pt_dev_addr;
+    int32_t * pt_idx_uplink;
+    double * pt_colunas[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];   // NAN: sem valor
+}TTabela_lote;
+
+/* Resultado da decodificação de um lote */
+typedef struct
+{
+    int qtde_uplinks;
+    int capacidade;
+    int8_t * pt_idx_tabela;     // por uplink: tabela do uplink ou DECODIFICADOR_LOTE_INVALIDO
+    int qtde_invalidos;
+    int qtde_tabelas;
+    TTabela_lote tabelas[DECODIFICADOR_LOTE_QTDE_MAX_TABELAS];
+}TSaida_lote;
+
+/* Decodificador (estado interno em decodificador_lote.c) */
+typedef struct TDecodificador_lote TDecodificador_lote;
+
+#endif
+
+/* Protótipos */
+TDecodificador_lote * decodificador_lote_cria(TAplicacao_lote aplicacao, int qtde_threads);
+void decodificador_lote_destroi(TDecodificador_lote * pt_decodificador);
+int decodificador_lote_decodifica(TDecodificador_lote * pt_decodificador, const TUplink_texto * pt_uplinks, int qtde_uplinks, TSaida_lote * pt_saida);
+void decodificador_lote_inicia_saida(TSaida_lote * pt_saida);
+void decodificador_lote_libera_saida(TSaida_lote * pt_saida);
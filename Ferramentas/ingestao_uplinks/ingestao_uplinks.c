@@ -0,0 +1,904 @@
+/* Ferramenta: ingestão em lote dos uplinks dos projetos (decodificador de alto volume)
+ *
+ * Decodifica lotes de uplinks (DevAddr, porta e payload em hexadecimal ou
+ * base64) de uma aplicação em tabelas colunares, com o decodificador em
+ * lote (decodificador_lote.c) e a conversão vetorizada do texto
+ * (texto_binario.c). Também testa o decodificador contra uma decodificação
+ * de referência (um uplink por vez) e mede a vazão em corpora sintéticos.
+ *
+ * Uso: ingestao_uplinks -a <cap6|cap7|cap8> [-f hex|base64] [-j threads] [uplinks.csv]
+ *      ingestao_uplinks -t
+ *      ingestao_uplinks -b [-j threads]
+ * Cada linha do CSV de entrada: <DevAddr em hexadecimal>,<porta>,<payload>
+ * Retorno: 0 em caso de sucesso (-t: todos os testes passaram), 1 caso contrário
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "decodificador_lote.h"
+#include "texto_binario.h"
+#include "Cap6/contador_pulsos_lorawan/main/payloads/payloads.h"
+#include "Cap7/Software/lixo_lorawan/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/serie_temperaturas/serie_temperaturas.h"
+#include "Cap6/contador_pulsos_lorawan/main/historico_pulsos/historico_pulsos.h"
+
+/* Definições - entrada */
+#define TAM_MAX_LINHA               1024
+#define TAM_LOTE_ENTRADA            65536
+
+/* Definições - corpora sintéticos */
+#define PORTA_SERIE_TEMPERATURAS    13      // main.c do capítulo 8
+#define PORTA_HISTORICO_PULSOS      13      // envios_lorawan.c do capítulo 6
+#define TAM_MAX_HISTORICO           11      // payload máximo do DR2
+#define QTDE_MAX_MINUTOS_HISTORICO  60
+#define PERCENTUAL_HISTORICOS_CAP6  85
+#define QTDE_DISPOSITIVOS           10000
+#define QTDE_MAX_LEITURAS_LOTE      8
+#define QTDE_AMOSTRAS_JANELA        15
+#define TAM_MAX_SERIE               51      // payload máximo do DR3
+#define PERCENTUAL_SERIES_CAP8      15
+
+/* Definições - testes e benchmark */
+#define QTDE_UPLINKS_TESTE          20000
+#define QTDE_UPLINKS_BENCHMARK      65536
+#define TEMPO_MIN_BENCHMARK_S       0.5
+
+/* Corpus sintético: uplinks em texto e os payloads originais em bytes */
+typedef struct
+{
+    int qtde_uplinks;
+    TUplink_texto * pt_uplinks;
+    char * pt_textos;
+    uint8_t * pt_bytes;          // payload original de cada uplink, TAM_MAX_PAYLOAD bytes por uplink
+    int * pt_tams;
+    bool * pt_texto_corrompido;
+}TCorpus;
+
+static const char * nomes_aplicacoes[QTDE_APLICACOES_LOTE] = { "cap6", "cap7", "cap8" };
+
+/* Função: gera número aleatório uniforme em [min, max]
+ * Parâmetros: valores mínimo e máximo
+ * Retorno: número gerado
+ */
+static double aleatorio(double min, double max)
+{
+    return min + ((double)rand() / (double)RAND_MAX) * (max - min);
+}
+
+/* Função: lê o relógio monotônico
+ * Parâmetros: nenhum
+ * Retorno: instante em segundos
+ */
+static double instante_s(void)
+{
+    struct timespec agora;
+
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return agora.tv_sec + (agora.tv_nsec / 1e9);
+}
+
+/* Função: codifica bytes em texto (hexadecimal maiúsculo, como no log do
+ *         firmware, ou base64 com '=', como no JSON do servidor de rede)
+ * Parâmetros: - codificação
+ *             - ponteiro para os bytes
+ *             - quantidade de bytes
+ *             - ponteiro para o texto (terminado em '\0')
+ * Retorno: tamanho do texto (caracteres)
+ */
+static int codifica_texto(TCodificacao_texto codificacao, const uint8_t * pt_bytes, int qtde_bytes, char * pt_texto)
+{
+    static const char alfabeto_base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint32_t grupo;
+    int tam = 0;
+    int i;
+
+    if (codificacao == TEXTO_HEX)
+    {
+        for (i = 0; i < qtde_bytes; i++)
+        {
+            tam += sprintf(&pt_texto[tam], "%02X", pt_bytes[i]);
+        }
+
+        return tam;
+    }
+
+    for (i = 0; i < qtde_bytes; i += 3)
+    {
+        grupo = (uint32_t)pt_bytes[i] << 16;
+        grupo |= (i + 1 < qtde_bytes) ? ((uint32_t)pt_bytes[i + 1] << 8) : 0;
+        grupo |= (i + 2 < qtde_bytes) ? pt_bytes[i + 2] : 0;
+        pt_texto[tam++] = alfabeto_base64[(grupo >> 18) & 0x3F];
+        pt_texto[tam++] = alfabeto_base64[(grupo >> 12) & 0x3F];
+        pt_texto[tam++] = (i + 1 < qtde_bytes) ? alfabeto_base64[(grupo >> 6) & 0x3F] : '=';
+        pt_texto[tam++] = (i + 2 < qtde_bytes) ? alfabeto_base64[grupo & 0x3F] : '=';
+    }
+
+    pt_texto[tam] = '\0';
+    return tam;
+}
+
+/* Função: gera o payload de um uplink sintético da aplicação
+ * Parâmetros: - aplicação
+ *             - ponteiro para a porta
+ *             - ponteiro para os bytes
+ * Retorno: quantidade de bytes
+ */
+static int gera_payload(TAplicacao_lote aplicacao, uint8_t * pt_porta, uint8_t * pt_bytes)
+{
+    TPayload_contadores contadores;
+    TPayload_lote_leituras cabecalho;
+    TPayload_leitura_lote leitura;
+    TPayload_resumo_temperaturas resumo;
+    int16_t amostras_x10[QTDE_AMOSTRAS_JANELA];
+    static THistorico_pulsos historico;
+    uint32_t contadores_historico[2];
+    int qtde_leituras;
+    int qtde_minutos;
+    int passo;
+    int i;
+
+    switch (aplicacao)
+    {
+        case APLICACAO_CAP6:
+            if ((rand() % 100) < PERCENTUAL_HISTORICOS_CAP6)
+            {
+                contadores_historico[0] = ((uint32_t)rand() << 8) ^ (uint32_t)rand();
+                contadores_historico[1] = (uint32_t)rand() % 100000;
+                historico_pulsos_inicializa(&historico, contadores_historico[0], contadores_historico[1]);
+                qtde_minutos = 1 + (rand() % QTDE_MAX_MINUTOS_HISTORICO);
+
+                for (i = 0; i < qtde_minutos; i++)
+                {
+                    contadores_historico[0] += (uint32_t)(rand() % 40);
+                    contadores_historico[1] += (uint32_t)(rand() % 4);
+                    historico_pulsos_registra_minuto(&historico, contadores_historico[0], contadores_historico[1]);
+                }
+
+                *pt_porta = PORTA_HISTORICO_PULSOS;
+                return historico_pulsos_codifica(&historico, pt_bytes, TAM_MAX_HISTORICO, &passo);
+            }
+
+            contadores.contador_1 = ((uint32_t)rand() << 8) ^ (uint32_t)rand();
+            contadores.contador_2 = (uint32_t)rand() % 100000;
+            payload_contadores_empacota(&contadores, pt_bytes);
+            *pt_porta = PAYLOAD_CONTADORES_PORTA;
+            return PAYLOAD_CONTADORES_TAM;
+
+        case APLICACAO_CAP7:
+            cabecalho.seq = rand() % 256;
+            cabecalho.idade = (float)(5 * (rand() % 256));
+            payload_lote_leituras_empacota(&cabecalho, pt_bytes);
+            qtde_leituras = 1 + (rand() % QTDE_MAX_LEITURAS_LOTE);
+
+            for (i = 0; i < qtde_leituras; i++)
+            {
+                leitura.distancia_cm = ((rand() % 20) == 0) ? ESQUEMA_PAYLOADS_SEM_VALOR : (rand() % 300);
+                leitura.motivo = rand() % 4;
+                leitura.intervalo = (float)(5 * (rand() % 64));
+                payload_leitura_lote_empacota(&leitura, &pt_bytes[PAYLOAD_LOTE_LEITURAS_TAM + (i * PAYLOAD_LEITURA_LOTE_TAM)]);
+            }
+
+            *pt_porta = PAYLOAD_LOTE_LEITURAS_PORTA;
+            return PAYLOAD_LOTE_LEITURAS_TAM + (qtde_leituras * PAYLOAD_LEITURA_LOTE_TAM);
+
+        default:
+            if ((rand() % 100) < PERCENTUAL_SERIES_CAP8)
+            {
+                amostras_x10[0] = (int16_t)aleatorio(-200.0, 350.0);
+                for (i = 1; i < QTDE_AMOSTRAS_JANELA; i++)
+                {
+                    amostras_x10[i] = (int16_t)(amostras_x10[i - 1] + (rand() % 5) - 2);
+                }
+
+                *pt_porta = PORTA_SERIE_TEMPERATURAS;
+                return serie_temperaturas_codifica(amostras_x10, QTDE_AMOSTRAS_JANELA, pt_bytes, TAM_MAX_SERIE, &passo);
+            }
+
+            resumo.minima = (float)aleatorio(-20.0, 30.0);
+            resumo.maxima = resumo.minima + (float)aleatorio(0.0, 5.0);
+            resumo.media = (resumo.minima + resumo.maxima) / 2.0f;
+            resumo.desvio_padrao = (float)aleatorio(0.0, 2.0);
+            payload_resumo_temperaturas_empacota(&resumo, pt_bytes);
+            *pt_porta = PAYLOAD_RESUMO_TEMPERATURAS_PORTA;
+            return PAYLOAD_RESUMO_TEMPERATURAS_TAM;
+    }
+}
+
+/* Função: gera um corpus sintético de uplinks de uma aplicação
+ * Parâmetros: - ponteiro para o corpus
+ *             - aplicação
+ *             - quantidade de uplinks
+ *             - codificação do texto
+ *             - true: inclui uplinks com porta desconhecida, com um byte a
+ *               mais e com caractere inválido no texto
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool gera_corpus(TCorpus * pt_corpus, TAplicacao_lote aplicacao, int qtde_uplinks, TCodificacao_texto codificacao, bool com_invalidos)
+{
+    const int tam_max_texto = (2 * DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD) + 4;
+    TUplink_texto * pt_uplink;
+    uint8_t * pt_bytes;
+    char * pt_texto;
+    int sorteio;
+    int i;
+
+    pt_corpus->qtde_uplinks = qtde_uplinks;
+    pt_corpus->pt_uplinks = malloc(qtde_uplinks * sizeof(TUplink_texto));
+    pt_corpus->pt_textos = malloc((size_t)qtde_uplinks * tam_max_texto);
+    pt_corpus->pt_bytes = malloc((size_t)qtde_uplinks * DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD);
+    pt_corpus->pt_tams = malloc(qtde_uplinks * sizeof(int));
+    pt_corpus->pt_texto_corrompido = malloc(qtde_uplinks * sizeof(bool));
+
+    if ( (pt_corpus->pt_uplinks == NULL) || (pt_corpus->pt_textos == NULL) || (pt_corpus->pt_bytes == NULL) ||
+         (pt_corpus->pt_tams == NULL) || (pt_corpus->pt_texto_corrompido == NULL) )
+    {
+        return false;
+    }
+
+    for (i = 0; i < qtde_uplinks; i++)
+    {
+        pt_uplink = &pt_corpus->pt_uplinks[i];
+        pt_bytes = &pt_corpus->pt_bytes[(size_t)i * DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD];
+        pt_texto = &pt_corpus->pt_textos[(size_t)i * tam_max_texto];
+
+        pt_uplink->dev_addr = 0x26000000U + (uint32_t)(rand() % QTDE_DISPOSITIVOS);
+        pt_uplink->codificacao = (uint8_t)codificacao;
+        pt_corpus->pt_tams[i] = gera_payload(aplicacao, &pt_uplink->porta, pt_bytes);
+        pt_corpus->pt_texto_corrompido[i] = false;
+        sorteio = com_invalidos ? (rand() % 100) : 100;
+
+        if (sorteio < 2)
+        {
+            pt_bytes[pt_corpus->pt_tams[i]] = 0x00;
+            pt_corpus->pt_tams[i]++;
+        }
+        else if (sorteio < 3)
+        {
+            pt_uplink->porta = 99;
+        }
+
+        pt_uplink->pt_texto = pt_texto;
+        pt_uplink->tam_texto = (uint16_t)codifica_texto(codificacao, pt_bytes, pt_corpus->pt_tams[i], pt_texto);
+
+        /* Caractere inválido em hexadecimal e em base64 */
+        if (sorteio == 3)
+        {
+            pt_texto[rand() % pt_uplink->tam_texto] = '!';
+            pt_corpus->pt_texto_corrompido[i] = true;
+        }
+    }
+
+    return true;
+}
+
+/* Função: libera a memória de um corpus
+ * Parâmetros: ponteiro para o corpus
+ * Retorno: nenhum
+ */
+static void libera_corpus(TCorpus * pt_corpus)
+{
+    free(pt_corpus->pt_uplinks);
+    free(pt_corpus->pt_textos);
+    free(pt_corpus->pt_bytes);
+    free(pt_corpus->pt_tams);
+    free(pt_corpus->pt_texto_corrompido);
+    memset(pt_corpus, 0x00, sizeof(TCorpus));
+}
+
+/* Função: compara o resultado do decodificador em lote com a decodificação
+ *         de referência (um uplink por vez, a partir dos bytes originais)
+ * Parâmetros: - aplicação
+ *             - ponteiro para o corpus
+ *             - ponteiro para o resultado do decodificador em lote
+ * Retorno: quantidade de diferenças
+ */
+static int compara_com_referencia(TAplicacao_lote aplicacao, const TCorpus * pt_corpus, const TSaida_lote * pt_saida)
+{
+    static const TEsquema_payload * pt_esquemas[QTDE_APLICACOES_LOTE] = { payloads_cap6, payloads_cap7, payloads_cap8 };
+    static const int qtde_payloads[QTDE_APLICACOES_LOTE] = { QTDE_PAYLOADS_CAP6, QTDE_PAYLOADS_CAP7, QTDE_PAYLOADS_CAP8 };
+    const TEsquema_payload * pt_payload;
+    const TEsquema_payload * pt_registro;
+    const TTabela_lote * pt_tabela;
+    const uint8_t * pt_bytes;
+    int16_t amostras_x10[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    static THistorico_pulsos_quadro historico;
+    double valores[DECODIFICADOR_LOTE_QTDE_MAX_COLUNAS];
+    int proxima_linha[DECODIFICADOR_LOTE_QTDE_MAX_TABELAS] = { 0 };
+    int idx_tabela;
+    int qtde_linhas;
+    int linha;
+    int passo;
+    int diferencas = 0;
+    int i;
+    int j;
+    int k;
+
+    for (i = 0; i < pt_corpus->qtde_uplinks; i++)
+    {
+        pt_bytes = &pt_corpus->pt_bytes[(size_t)i * DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD];
+
+        for (idx_tabela = pt_saida->qtde_tabelas - 1; idx_tabela >= 0; idx_tabela--)
+        {
+            if (pt_saida->tabelas[idx_tabela].porta == pt_corpus->pt_uplinks[i].porta)
+            {
+                break;
+            }
+        }
+
+        /* Referência: formato da porta, decodificado direto dos bytes */
+        pt_payload = NULL;
+        for (j = 0; j < qtde_payloads[aplicacao]; j++)
+        {
+            if (pt_esquemas[aplicacao][j].porta == pt_corpus->pt_uplinks[i].porta)
+            {
+                pt_payload = &pt_esquemas[aplicacao][j];
+            }
+        }
+
+        if ((idx_tabela < 0) || pt_corpus->pt_texto_corrompido[i])
+        {
+            qtde_linhas = -1;
+        }
+        else if ((pt_payload == NULL) && (aplicacao == APLICACAO_CAP6))
+        {
+            qtde_linhas = historico_pulsos_decodifica(pt_bytes, pt_corpus->pt_tams[i], &historico);
+        }
+        else if (pt_payload == NULL)
+        {
+            qtde_linhas = serie_temperaturas_decodifica(pt_bytes, pt_corpus->pt_tams[i], amostras_x10, SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS, &passo);
+        }
+        else
+        {
+            pt_registro = (pt_payload->idx_repetido >= 0) ? &pt_esquemas[aplicacao][pt_payload->idx_repetido] : NULL;
+
+            if (pt_registro == NULL)
+            {
+                qtde_linhas = (pt_corpus->pt_tams[i] == pt_payload->tam) ? 1 : -1;
+            }
+            else
+            {
+                qtde_linhas = (((pt_corpus->pt_tams[i] - pt_payload->tam) % pt_registro->tam) == 0) ?
+                              ((pt_corpus->pt_tams[i] - pt_payload->tam) / pt_registro->tam) : -1;
+            }
+        }
+
+        if (qtde_linhas <= 0)
+        {
+            diferencas += (pt_saida->pt_idx_tabela[i] != DECODIFICADOR_LOTE_INVALIDO);
+            continue;
+        }
+
+        if (pt_saida->pt_idx_tabela[i] != idx_tabela)
+        {
+            diferencas++;
+            continue;
+        }
+
+        pt_tabela = &pt_saida->tabelas[idx_tabela];
+
+        for (k = 0; k < qtde_linhas; k++)
+        {
+            if ((pt_payload == NULL) && (aplicacao == APLICACAO_CAP6))
+            {
+                valores[0] = historico.passo;
+                valores[1] = k;
+                valores[2] = (k < (qtde_linhas - 1)) ? historico.passo : (historico.qtde_minutos - (k * historico.passo));
+                valores[3] = historico.somas[0][k];
+                valores[4] = historico.somas[1][k];
+            }
+            else if (pt_payload == NULL)
+            {
+                valores[0] = passo;
+                valores[1] = k;
+                valores[2] = amostras_x10[k] / 10.0;
+            }
+            else
+            {
+                pt_payload->decodifica(pt_bytes, valores);
+
+                if (pt_payload->idx_repetido >= 0)
+                {
+                    pt_registro = &pt_esquemas[aplicacao][pt_payload->idx_repetido];
+                    pt_registro->decodifica(&pt_bytes[pt_payload->tam + (k * pt_registro->tam)], &valores[pt_payload->qtde_campos]);
+                }
+            }
+
+            linha = proxima_linha[idx_tabela]++;
+
+            if ( (linha >= pt_tabela->qtde_linhas) || (pt_tabela->pt_dev_addr[linha] != pt_corpus->pt_uplinks[i].dev_addr) ||
+                 (pt_tabela->pt_idx_uplink[linha] != i) )
+            {
+                diferencas++;
+                continue;
+            }
+
+            for (j = 0; j < pt_tabela->qtde_colunas; j++)
+            {
+                if ((pt_tabela->pt_colunas[j][linha] != valores[j]) && !(isnan(pt_tabela->pt_colunas[j][linha]) && isnan(valores[j])))
+                {
+                    diferencas++;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < pt_saida->qtde_tabelas; i++)
+    {
+        diferencas += (proxima_linha[i] != pt_saida->tabelas[i].qtde_linhas);
+    }
+
+    return diferencas;
+}
+
+/* Função: testa a conversão de texto para bytes em todas as implementações
+ *         suportadas, contra os bytes originais
+ * Parâmetros: nenhum
+ * Retorno: quantidade de falhas
+ */
+static int testa_conversao_texto(void)
+{
+    uint8_t bytes[DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD + 16];
+    uint8_t convertidos[DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD + 16];
+    char texto[(2 * DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD) + 40];
+    TImplementacao_texto implementacao;
+    int codificacao;
+    int tam_texto;
+    int qtde_bytes;
+    int resultado;
+    int falhas = 0;
+    int repeticao;
+    int i;
+
+    for (implementacao = IMPLEMENTACAO_ESCALAR; implementacao < QTDE_IMPLEMENTACOES; implementacao++)
+    {
+        if (texto_binario_seleciona(implementacao) != implementacao)
+        {
+            printf("  %-8s nao suportada neste processador\n", texto_binario_nome_implementacao(implementacao));
+            continue;
+        }
+
+        for (repeticao = 0; repeticao < 20; repeticao++)
+        {
+            for (qtde_bytes = 0; qtde_bytes <= DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD; qtde_bytes++)
+            {
+                for (i = 0; i < qtde_bytes; i++)
+                {
+                    bytes[i] = (uint8_t)rand();
+                }
+
+                for (codificacao = TEXTO_HEX; codificacao <= TEXTO_BASE64; codificacao++)
+                {
+                    tam_texto = codifica_texto((TCodificacao_texto)codificacao, bytes, qtde_bytes, texto);
+
+                    /* Hexadecimal em minúsculas; base64 sem o '=' final */
+                    if ((repeticao % 2) == 1)
+                    {
+                        for (i = 0; (codificacao == TEXTO_HEX) && (i < tam_texto); i++)
+                        {
+                            texto[i] = (char)((texto[i] >= 'A') ? (texto[i] | 0x20) : texto[i]);
+                        }
+
+                        while ((codificacao == TEXTO_BASE64) && (tam_texto > 0) && (texto[tam_texto - 1] == '='))
+                        {
+                            tam_texto--;
+                        }
+                    }
+
+                    resultado = texto_binario_converte((TCodificacao_texto)codificacao, texto, tam_texto, convertidos);
+                    falhas += (resultado != qtde_bytes) || (memcmp(bytes, convertidos, qtde_bytes) != 0);
+
+                    /* Um caractere inválido em qualquer posição invalida o texto */
+                    if (tam_texto > 0)
+                    {
+                        texto[rand() % tam_texto] = (char)((rand() % 2) ? '!' : 0x80 + (rand() % 0x80));
+                        falhas += (texto_binario_converte((TCodificacao_texto)codificacao, texto, tam_texto, convertidos) != -1);
+                    }
+                }
+            }
+        }
+
+        /* Hexadecimal com quantidade ímpar de caracteres; base64 com resto 1 */
+        falhas += (texto_binario_converte(TEXTO_HEX, "0A1", 3, convertidos) != -1);
+        falhas += (texto_binario_converte(TEXTO_BASE64, "QUJDRA=", 7, convertidos) != -1);
+        falhas += (texto_binario_converte(TEXTO_BASE64, "QUJDR", 5, convertidos) != -1);
+        falhas += (texto_binario_converte(TEXTO_BASE64, "QUJDRA==", 8, convertidos) != 4) || (memcmp(convertidos, "ABCD", 4) != 0);
+
+        printf("  %-8s %d falha(s)\n", texto_binario_nome_implementacao(implementacao), falhas);
+    }
+
+    return falhas;
+}
+
+/* Função: executa os testes
+ * Parâmetros: nenhum
+ * Retorno: 0 se todos os testes passaram, 1 caso contrário
+ */
+static int executa_testes(void)
+{
+    static const int qtde_threads_teste[] = { 1, 3, 8 };
+    TDecodificador_lote * pt_decodificador;
+    TImplementacao_texto implementacao;
+    TSaida_lote saida;
+    TCorpus corpus;
+    int aplicacao;
+    int codificacao;
+    int diferencas;
+    int falhas;
+    int total_falhas;
+    int t;
+
+    srand(1);
+    printf("Conversao de texto (0 a %d bytes, hexadecimal e base64, com e sem caractere invalido):\n", DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD);
+    total_falhas = testa_conversao_texto();
+
+    printf("\nDecodificador em lote x referencia (%d uplinks, ~3%% invalidos):\n", QTDE_UPLINKS_TESTE);
+    decodificador_lote_inicia_saida(&saida);
+
+    for (aplicacao = APLICACAO_CAP6; aplicacao < QTDE_APLICACOES_LOTE; aplicacao++)
+    {
+        for (codificacao = TEXTO_HEX; codificacao <= TEXTO_BASE64; codificacao++)
+        {
+            if (gera_corpus(&corpus, (TAplicacao_lote)aplicacao, QTDE_UPLINKS_TESTE, (TCodificacao_texto)codificacao, true) == false)
+            {
+                printf("Falta de memoria\n");
+                return 1;
+            }
+
+            for (implementacao = IMPLEMENTACAO_ESCALAR; implementacao < QTDE_IMPLEMENTACOES; implementacao++)
+            {
+                if (texto_binario_seleciona(implementacao) != implementacao)
+                {
+                    continue;
+                }
+
+                for (t = 0, falhas = 0; t < (int)(sizeof(qtde_threads_teste) / sizeof(qtde_threads_teste[0])); t++)
+                {
+                    pt_decodificador = decodificador_lote_cria((TAplicacao_lote)aplicacao, qtde_threads_teste[t]);
+
+                    if ((pt_decodificador == NULL) || (decodificador_lote_decodifica(pt_decodificador, corpus.pt_uplinks, corpus.qtde_uplinks, &saida) < 0))
+                    {
+                        falhas++;
+                    }
+                    else
+                    {
+                        diferencas = compara_com_referencia((TAplicacao_lote)aplicacao, &corpus, &saida);
+                        falhas += (diferencas > 0);
+                    }
+
+                    decodificador_lote_destroi(pt_decodificador);
+                }
+
+                printf("  %s %-6s %-8s 1/3/8 threads: %d uplinks decodificados, %d invalidos, %d falha(s)\n",
+                       nomes_aplicacoes[aplicacao], (codificacao == TEXTO_HEX) ? "hex" : "base64", texto_binario_nome_implementacao(implementacao),
+                       saida.qtde_uplinks - saida.qtde_invalidos, saida.qtde_invalidos, falhas);
+                total_falhas += falhas;
+            }
+
+            libera_corpus(&corpus);
+        }
+    }
+
+    decodificador_lote_libera_saida(&saida);
+    printf("\n%d falha(s)\n", total_falhas);
+    return (total_falhas == 0) ? 0 : 1;
+}
+
+/* Função: mede a vazão do decodificador em lote em um corpus
+ * Parâmetros: - ponteiro para o decodificador
+ *             - ponteiro para o corpus
+ *             - ponteiro para o resultado
+ * Retorno: uplinks por segundo
+ */
+static double mede_vazao(TDecodificador_lote * pt_decodificador, const TCorpus * pt_corpus, TSaida_lote * pt_saida)
+{
+    double inicio = instante_s();
+    double duracao;
+    long qtde_uplinks = 0;
+
+    do
+    {
+        decodificador_lote_decodifica(pt_decodificador, pt_corpus->pt_uplinks, pt_corpus->qtde_uplinks, pt_saida);
+        qtde_uplinks += pt_corpus->qtde_uplinks;
+        duracao = instante_s() - inicio;
+    }while (duracao < TEMPO_MIN_BENCHMARK_S);
+
+    return qtde_uplinks / duracao;
+}
+
+/* Função: mede a vazão da conversão de texto e do decodificador em lote
+ * Parâmetros: quantidade de threads da medição com várias threads
+ * Retorno: 0
+ */
+static int executa_benchmark(int qtde_threads)
+{
+    static const int tams_payload[] = { 4, 8, 11, 51, 242 };
+    TDecodificador_lote * pt_decodificador;
+    TImplementacao_texto implementacao;
+    TImplementacao_texto melhor_implementacao = IMPLEMENTACAO_ESCALAR;
+    TSaida_lote saida;
+    TCorpus corpus;
+    uint8_t bytes[DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD + 16];
+    char texto[(2 * DECODIFICADOR_LOTE_TAM_MAX_PAYLOAD) + 8];
+    volatile int soma = 0;
+    double inicio;
+    double duracao;
+    double vazao;
+    long repeticoes;
+    int aplicacao;
+    int codificacao;
+    int tam_texto;
+    int t;
+    int i;
+
+    srand(2);
+    for (i = 0; i < (int)sizeof(bytes); i++)
+    {
+        bytes[i] = (uint8_t)rand();
+    }
+
+    printf("Conversao de texto para bytes (ns por payload, 1 thread):\n");
+    printf("  %-8s %-6s", "impl", "texto");
+    for (t = 0; t < (int)(sizeof(tams_payload) / sizeof(tams_payload[0])); t++)
+    {
+        printf(" %7dB", tams_payload[t]);
+    }
+    printf("\n");
+
+    for (codificacao = TEXTO_HEX; codificacao <= TEXTO_BASE64; codificacao++)
+    {
+        for (implementacao = IMPLEMENTACAO_ESCALAR; implementacao < QTDE_IMPLEMENTACOES; implementacao++)
+        {
+            if (texto_binario_seleciona(implementacao) != implementacao)
+            {
+                continue;
+            }
+
+            melhor_implementacao = implementacao;
+            printf("  %-8s %-6s", texto_binario_nome_implementacao(implementacao), (codificacao == TEXTO_HEX) ? "hex" : "base64");
+
+            for (t = 0; t < (int)(sizeof(tams_payload) / sizeof(tams_payload[0])); t++)
+            {
+                tam_texto = codifica_texto((TCodificacao_texto)codificacao, bytes, tams_payload[t], texto);
+                inicio = instante_s();
+                repeticoes = 0;
+
+                do
+                {
+                    for (i = 0; i < 100000; i++)
+                    {
+                        soma += texto_binario_converte((TCodificacao_texto)codificacao, texto, tam_texto, bytes);
+                    }
+                    repeticoes += 100000;
+                    duracao = instante_s() - inicio;
+                }while (duracao < (TEMPO_MIN_BENCHMARK_S / 5));
+
+                printf(" %8.1f", (duracao * 1e9) / repeticoes);
+            }
+            printf("\n");
+        }
+    }
+
+    printf("\nDecodificador em lote (lotes de %d uplinks sinteticos, milhares de uplinks/s):\n", QTDE_UPLINKS_BENCHMARK);
+    printf("  %-4s %-6s", "app", "texto");
+    for (implementacao = IMPLEMENTACAO_ESCALAR; implementacao <= melhor_implementacao; implementacao++)
+    {
+        printf(" %9s", texto_binario_nome_implementacao(implementacao));
+    }
+    printf(" %6s %10s %10s\n", "threads", "total", "por nucleo");
+
+    decodificador_lote_inicia_saida(&saida);
+
+    for (aplicacao = APLICACAO_CAP6; aplicacao < QTDE_APLICACOES_LOTE; aplicacao++)
+    {
+        for (codificacao = TEXTO_HEX; codificacao <= TEXTO_BASE64; codificacao++)
+        {
+            if (gera_corpus(&corpus, (TAplicacao_lote)aplicacao, QTDE_UPLINKS_BENCHMARK, (TCodificacao_texto)codificacao, false) == false)
+            {
+                printf("Falta de memoria\n");
+                return 1;
+            }
+
+            printf("  %-4s %-6s", nomes_aplicacoes[aplicacao], (codificacao == TEXTO_HEX) ? "hex" : "base64");
+
+            /* 1 thread, cada implementação da conversão de texto */
+            pt_decodificador = decodificador_lote_cria((TAplicacao_lote)aplicacao, 1);
+            for (implementacao = IMPLEMENTACAO_ESCALAR; implementacao <= melhor_implementacao; implementacao++)
+            {
+                texto_binario_seleciona(implementacao);
+                printf(" %9.0f", mede_vazao(pt_decodificador, &corpus, &saida) / 1e3);
+            }
+            decodificador_lote_destroi(pt_decodificador);
+
+            /* Várias threads, melhor implementação */
+            pt_decodificador = decodificador_lote_cria((TAplicacao_lote)aplicacao, qtde_threads);
+            vazao = mede_vazao(pt_decodificador, &corpus, &saida);
+            printf(" %6d %10.0f %10.0f\n", qtde_threads, vazao / 1e3, vazao / 1e3 / qtde_threads);
+            decodificador_lote_destroi(pt_decodificador);
+
+            libera_corpus(&corpus);
+        }
+    }
+
+    decodificador_lote_libera_saida(&saida);
+    (void)soma;
+    return 0;
+}
+
+/* Função: decodifica os uplinks de um CSV e mostra as tabelas (CSV)
+ * Parâmetros: - aplicação
+ *             - codificação dos payloads
+ *             - quantidade de threads
+ *             - arquivo de entrada
+ * Retorno: 0: sucesso; 1: falha
+ */
+static int decodifica_arquivo(TAplicacao_lote aplicacao, TCodificacao_texto codificacao, int qtde_threads, FILE * pt_arquivo)
+{
+    TDecodificador_lote * pt_decodificador;
+    TUplink_texto * pt_uplinks = NULL;
+    const TTabela_lote * pt_tabela;
+    TSaida_lote saida;
+    char linha[TAM_MAX_LINHA];
+    char payload[TAM_MAX_LINHA];
+    unsigned int dev_addr;
+    int porta;
+    int qtde_uplinks = 0;
+    int capacidade = 0;
+    int i;
+    int j;
+    int k;
+
+    while (fgets(linha, sizeof(linha), pt_arquivo) != NULL)
+    {
+        if ((linha[0] == '#') || (sscanf(linha, "%x,%d,%1000[^,\r\n ]", &dev_addr, &porta, payload) != 3) || (porta < 0) || (porta > 255))
+        {
+            continue;
+        }
+
+        if (qtde_uplinks == capacidade)
+        {
+            capacidade = (capacidade > 0) ? (2 * capacidade) : TAM_LOTE_ENTRADA;
+            if ((pt_uplinks = realloc(pt_uplinks, capacidade * sizeof(TUplink_texto))) == NULL)
+            {
+                return 1;
+            }
+        }
+
+        pt_uplinks[qtde_uplinks].dev_addr = dev_addr;
+        pt_uplinks[qtde_uplinks].porta = (uint8_t)porta;
+        pt_uplinks[qtde_uplinks].codificacao = (uint8_t)codificacao;
+        pt_uplinks[qtde_uplinks].tam_texto = (uint16_t)strlen(payload);
+        pt_uplinks[qtde_uplinks].pt_texto = strdup(payload);
+        qtde_uplinks++;
+    }
+
+    texto_binario_seleciona(IMPLEMENTACAO_AVX2);
+    decodificador_lote_inicia_saida(&saida);
+    pt_decodificador = decodificador_lote_cria(aplicacao, qtde_threads);
+
+    if ((pt_decodificador == NULL) || (decodificador_lote_decodifica(pt_decodificador, pt_uplinks, qtde_uplinks, &saida) < 0))
+    {
+        fprintf(stderr, "Falha ao decodificar o lote\n");
+        return 1;
+    }
+
+    for (i = 0; i < saida.qtde_tabelas; i++)
+    {
+        pt_tabela = &saida.tabelas[i];
+        printf("# %s (porta %d): %d linha(s)\n", pt_tabela->pt_nome, pt_tabela->porta, pt_tabela->qtde_linhas);
+        printf("dev_addr,uplink");
+        for (k = 0; k < pt_tabela->qtde_colunas; k++)
+        {
+            printf((pt_tabela->pt_unidades_colunas[k][0] != '\0') ? ",%s_%s" : ",%s", pt_tabela->pt_nomes_colunas[k], pt_tabela->pt_unidades_colunas[k]);
+        }
+        printf("\n");
+
+        for (j = 0; j < pt_tabela->qtde_linhas; j++)
+        {
+            printf("%08X,%d", pt_tabela->pt_dev_addr[j], pt_tabela->pt_idx_uplink[j]);
+            for (k = 0; k < pt_tabela->qtde_colunas; k++)
+            {
+                printf(isnan(pt_tabela->pt_colunas[k][j]) ? "," : ",%g", pt_tabela->pt_colunas[k][j]);
+            }
+            printf("\n");
+        }
+    }
+
+    fprintf(stderr, "%d uplink(s), %d invalido(s) ou de porta desconhecida\n", qtde_uplinks, saida.qtde_invalidos);
+
+    for (i = 0; i < qtde_uplinks; i++)
+    {
+        free((void *)pt_uplinks[i].pt_texto);
+    }
+    free(pt_uplinks);
+    decodificador_lote_destroi(pt_decodificador);
+    decodificador_lote_libera_saida(&saida);
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    TCodificacao_texto codificacao = TEXTO_HEX;
+    FILE * pt_arquivo = stdin;
+    int aplicacao = -1;
+    int qtde_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    bool testes = false;
+    bool benchmark = false;
+    int resultado;
+    int opcao;
+    int i;
+
+    while ((opcao = getopt(argc, argv, "a:f:j:tb")) != -1)
+    {
+        switch (opcao)
+        {
+            case 'a':
+                for (i = 0; i < QTDE_APLICACOES_LOTE; i++)
+                {
+                    aplicacao = (strcmp(optarg, nomes_aplicacoes[i]) == 0) ? i : aplicacao;
+                }
+                break;
+
+            case 'f':
+                codificacao = (strcmp(optarg, "base64") == 0) ? TEXTO_BASE64 : TEXTO_HEX;
+                break;
+
+            case 'j':
+                qtde_threads = atoi(optarg);
+                break;
+
+            case 't':
+                testes = true;
+                break;
+
+            case 'b':
+                benchmark = true;
+                break;
+
+            default:
+                aplicacao = -1;
+                break;
+        }
+    }
+
+    qtde_threads = (qtde_threads < 1) ? 1 : ((qtde_threads > DECODIFICADOR_LOTE_QTDE_MAX_THREADS) ? DECODIFICADOR_LOTE_QTDE_MAX_THREADS : qtde_threads);
+
+    if (testes)
+    {
+        return executa_testes();
+    }
+
+    if (benchmark)
+    {
+        return executa_benchmark(qtde_threads);
+    }
+
+    if (aplicacao < 0)
+    {
+        fprintf(stderr, "Uso: %s -a <cap6|cap7|cap8> [-f hex|base64] [-j threads] [uplinks.csv]\n", argv[0]);
+        fprintf(stderr, "     %s -t\n", argv[0]);
+        fprintf(stderr, "     %s -b [-j threads]\n", argv[0]);
+        return 1;
+    }
+
+    if ((optind < argc) && ((pt_arquivo = fopen(argv[optind], "r")) == NULL))
+    {
+        fprintf(stderr, "Nao foi possivel abrir %s\n", argv[optind]);
+        return 1;
+    }
+
+    resultado = decodifica_arquivo((TAplicacao_lote)aplicacao, codificacao, qtde_threads, pt_arquivo);
+
+    if (pt_arquivo != stdin)
+    {
+        fclose(pt_arquivo);
+    }
+
+    return resultado;
+}
@@ -0,0 +1,406 @@
+/* Módulo: conversão de payloads em texto (hexadecimal ou base64) para bytes
+ *
+ * Vetorização (x86):
+ * - hexadecimal: cada caractere vira o valor do nibble (dígito: c - '0';
+ *   letra: (c | 0x20) - 'a' + 10), e pares de nibbles são juntados com
+ *   maddubs (alto x 16 + baixo);
+ * - base64: tabelas por nibble (pshufb) validam os caracteres e dão o
+ *   deslocamento de cada faixa ('A'-'Z', 'a'-'z', '0'-'9', '+', '/') para o
+ *   valor de 6 bits; maddubs/madd juntam 4 valores de 6 bits em 3 bytes.
+ */
+
+/* Includes */
+#include <stdint.h>
+#include <string.h>
+#include "texto_binario.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXTO_BINARIO_X86
+#endif
+
+/* Conversão de uma codificação */
+typedef int (* TConverte_texto)(const char * pt_texto, int tam_texto, uint8_t * pt_bytes);
+
+/* Funções locais */
+static int hex_escalar(const char * pt_texto, int tam_texto, uint8_t * pt_bytes);
+static int base64_escalar(const char * pt_texto, int tam_texto, uint8_t * pt_bytes);
+
+/* Variáveis locais - valor de cada caractere mais 1 (0: caractere inválido) */
+static const uint8_t codigo_hex[256] =
+{
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+static const uint8_t codigo_base64[256] =
+{
+    ['A'] = 1, ['B'] = 2, ['C'] = 3, ['D'] = 4, ['E'] = 5, ['F'] = 6, ['G'] = 7, ['H'] = 8, ['I'] = 9, ['J'] = 10,
+    ['K'] = 11, ['L'] = 12, ['M'] = 13, ['N'] = 14, ['O'] = 15, ['P'] = 16, ['Q'] = 17, ['R'] = 18, ['S'] = 19, ['T'] = 20,
+    ['U'] = 21, ['V'] = 22, ['W'] = 23, ['X'] = 24, ['Y'] = 25, ['Z'] = 26,
+    ['a'] = 27, ['b'] = 28, ['c'] = 29, ['d'] = 30, ['e'] = 31, ['f'] = 32, ['g'] = 33, ['h'] = 34, ['i'] = 35, ['j'] = 36,
+    ['k'] = 37, ['l'] = 38, ['m'] = 39, ['n'] = 40, ['o'] = 41, ['p'] = 42, ['q'] = 43, ['r'] = 44, ['s'] = 45, ['t'] = 46,
+    ['u'] = 47, ['v'] = 48, ['w'] = 49, ['x'] = 50, ['y'] = 51, ['z'] = 52,
+    ['0'] = 53, ['1'] = 54, ['2'] = 55, ['3'] = 56, ['4'] = 57, ['5'] = 58, ['6'] = 59, ['7'] = 60, ['8'] = 61, ['9'] = 62,
+    ['+'] = 63, ['/'] = 64,
+};
+
+static TConverte_texto converte_hex = hex_escalar;
+static TConverte_texto converte_base64 = base64_escalar;
+
+static const char * nomes_implementacoes[QTDE_IMPLEMENTACOES] = { "escalar", "ssse3", "avx2" };
+
+/* Função: converte hexadecimal para bytes (implementação escalar)
+ * Parâmetros: - ponteiro para o texto
+ *             - tamanho do texto (caracteres)
+ *             - ponteiro para os bytes
+ * Retorno: quantidade de bytes. -1 se o texto for inválido.
+ */
+static int hex_escalar(const char * pt_texto, int tam_texto, uint8_t * pt_bytes)
+{
+    uint8_t alto;
+    uint8_t baixo;
+    int i;
+
+    if ((tam_texto % 2) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < tam_texto; i += 2)
+    {
+        alto = codigo_hex[(uint8_t)pt_texto[i]];
+        baixo = codigo_hex[(uint8_t)pt_texto[i + 1]];
+
+        if ((alto == 0) || (baixo == 0))
+        {
+            return -1;
+        }
+
+        pt_bytes[i / 2] = (uint8_t)(((alto - 1) << 4) | (baixo - 1));
+    }
+
+    return tam_texto / 2;
+}
+
+/* Função: converte base64 para bytes (implementação escalar). Aceita o
+ *         texto com ou sem '=' no fim.
+ * Parâmetros: - ponteiro para o texto
+ *             - tamanho do texto (caracteres)
+ *             - ponteiro para os bytes
+ * Retorno: quantidade de bytes. -1 se o texto for inválido.
+ */
+static int base64_escalar(const char * pt_texto, int tam_texto, uint8_t * pt_bytes)
+{
+    uint32_t grupo = 0;
+    uint8_t codigo;
+    int qtde_bytes = 0;
+    int qtde_valores = 0;
+    int i;
+
+    if ((tam_texto > 0) && (pt_texto[tam_texto - 1] == '='))
+    {
+        if ((tam_texto % 4) != 0)
+        {
+            return -1;
+        }
+
+        tam_texto -= (pt_texto[tam_texto - 2] == '=') ? 2 : 1;
+    }
+
+    if ((tam_texto % 4) == 1)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < tam_texto; i++)
+    {
+        codigo = codigo_base64[(uint8_t)pt_texto[i]];
+
+        if (codigo == 0)
+        {
+            return -1;
+        }
+
+        grupo = (grupo << 6) | (uint32_t)(codigo - 1);
+        qtde_valores++;
+
+        if (qtde_valores == 4)
+        {
+            pt_bytes[qtde_bytes++] = (uint8_t)(grupo >> 16);
+            pt_bytes[qtde_bytes++] = (uint8_t)(grupo >> 8);
+            pt_bytes[qtde_bytes++] = (uint8_t)grupo;
+            grupo = 0;
+            qtde_valores = 0;
+        }
+    }
+
+    /* Grupo final incompleto: 2 valores -> 1 byte, 3 valores -> 2 bytes */
+    if (qtde_valores == 2)
+    {
+        pt_bytes[qtde_bytes++] = (uint8_t)(grupo >> 4);
+    }
+    else if (qtde_valores == 3)
+    {
+        pt_bytes[qtde_bytes++] = (uint8_t)(grupo >> 10);
+        pt_bytes[qtde_bytes++] = (uint8_t)(grupo >> 2);
+    }
+
+    return qtde_bytes;
+}
+
+#ifdef TEXTO_BINARIO_X86
+
+/* Função: converte hexadecimal para bytes, 16 caracteres por iteração (SSSE3)
+ * Parâmetros e retorno: ver hex_escalar()
+ */
+__attribute__((target("ssse3")))
+static int hex_ssse3(const char * pt_texto, int tam_texto, uint8_t * pt_bytes)
+{
+    __m128i caracteres;
+    __m128i digito;
+    __m128i letra;
+    __m128i eh_digito;
+    __m128i eh_letra;
+    __m128i nibbles;
+    __m128i bytes;
+    int resultado;
+    int i;
+
+    if ((tam_texto % 2) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; (i + 16) <= tam_texto; i += 16)
+    {
+        caracteres = _mm_loadu_si128((const __m128i *)&pt_texto[i]);
+        digito = _mm_sub_epi8(caracteres, _mm_set1_epi8('0'));
+        letra = _mm_sub_epi8(_mm_or_si128(caracteres, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        eh_digito = _mm_cmpeq_epi8(_mm_min_epu8(digito, _mm_set1_epi8(9)), digito);
+        eh_letra = _mm_cmpeq_epi8(_mm_min_epu8(letra, _mm_set1_epi8(5)), letra);
+
+        if (_mm_movemask_epi8(_mm_or_si128(eh_digito, eh_letra)) != 0xFFFF)
+        {
+            return -1;
+        }
+
+        nibbles = _mm_or_si128(_mm_and_si128(eh_digito, digito), _mm_andnot_si128(eh_digito, _mm_add_epi8(letra, _mm_set1_epi8(10))));
+        bytes = _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110));
+        _mm_storel_epi64((__m128i *)&pt_bytes[i / 2], _mm_packus_epi16(bytes, bytes));
+    }
+
+    resultado = hex_escalar(&pt_texto[i], tam_texto - i, &pt_bytes[i / 2]);
+    return (resultado < 0) ? -1 : (i / 2) + resultado;
+}
+
+/* Função: converte hexadecimal para bytes, 32 caracteres por iteração (AVX2)
+ * Parâmetros e retorno: ver hex_escalar()
+ */
+__attribute__((target("avx2")))
+static int hex_avx2(const char * pt_texto, int tam_texto, uint8_t * pt_bytes)
+{
+    __m256i caracteres;
+    __m256i digito;
+    __m256i letra;
+    __m256i eh_digito;
+    __m256i eh_letra;
+    __m256i nibbles;
+    __m256i bytes;
+    int resultado;
+    int i;
+
+    if ((tam_texto % 2) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; (i + 32) <= tam_texto; i += 32)
+    {
+        caracteres = _mm256_loadu_si256((const __m256i *)&pt_texto[i]);
+        digito = _mm256_sub_epi8(caracteres, _mm256_set1_epi8('0'));
+        letra = _mm256_sub_epi8(_mm256_or_si256(caracteres, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        eh_digito = _mm256_cmpeq_epi8(_mm256_min_epu8(digito, _mm256_set1_epi8(9)), digito);
+        eh_letra = _mm256_cmpeq_epi8(_mm256_min_epu8(letra, _mm256_set1_epi8(5)), letra);
+
+        if (_mm256_movemask_epi8(_mm256_or_si256(eh_digito, eh_letra)) != -1)
+        {
+            return -1;
+        }
+
+        nibbles = _mm256_or_si256(_mm256_and_si256(eh_digito, digito), _mm256_andnot_si256(eh_digito, _mm256_add_epi8(letra, _mm256_set1_epi8(10))));
+        bytes = _mm256_maddubs_epi16(nibbles, _mm256_set1_epi16(0x0110));
+
+        /* packus junta por metade (128 bits): bytes 0-7 na metade baixa, 8-15 na alta */
+        bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(bytes, bytes), 0x08);
+        _mm_storeu_si128((__m128i *)&pt_bytes[i / 2], _mm256_castsi256_si128(bytes));
+    }
+
+    /* Resto (e payloads curtos): blocos de 16 caracteres */
+    resultado = hex_ssse3(&pt_texto[i], tam_texto - i, &pt_bytes[i / 2]);
+    return (resultado < 0) ? -1 : (i / 2) + resultado;
+}
+
+/* Função: converte base64 para bytes, 16 caracteres (12 bytes) por iteração (SSSE3)
+ * Parâmetros e retorno: ver base64_escalar()
+ */
+__attribute__((target("ssse3")))
+static int base64_ssse3(const char * pt_texto, int tam_texto, uint8_t * pt_bytes)
+{
+    const __m128i tabela_nibble_baixo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i tabela_nibble_alto = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i tabela_deslocamento = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i ordem_bytes = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m128i mascara_2f = _mm_set1_epi8(0x2F);
+    __m128i caracteres;
+    __m128i nibble_alto;
+    __m128i classe_baixo;
+    __m128i classe_alto;
+    __m128i valores;
+    uint32_t ultimos_bytes;
+    int resultado;
+    int i;
+
+    /* O último grupo de 4 caracteres (que pode ter '=') fica para a implementação escalar */
+    for (i = 0; (i + 16) <= (tam_texto - 4); i += 16)
+    {
+        caracteres = _mm_loadu_si128((const __m128i *)&pt_texto[i]);
+        nibble_alto = _mm_and_si128(_mm_srli_epi32(caracteres, 4), mascara_2f);
+        classe_baixo = _mm_shuffle_epi8(tabela_nibble_baixo, _mm_and_si128(caracteres, mascara_2f));
+        classe_alto = _mm_shuffle_epi8(tabela_nibble_alto, nibble_alto);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(classe_baixo, classe_alto), _mm_setzero_si128())) != 0xFFFF)
+        {
+            return -1;
+        }
+
+        /* '/' tem o mesmo nibble alto que '+': cmpeq (-1) escolhe a entrada anterior da tabela */
+        valores = _mm_add_epi8(caracteres, _mm_shuffle_epi8(tabela_deslocamento, _mm_add_epi8(_mm_cmpeq_epi8(caracteres, mascara_2f), nibble_alto)));
+        valores = _mm_maddubs_epi16(valores, _mm_set1_epi32(0x01400140));
+        valores = _mm_shuffle_epi8(_mm_madd_epi16(valores, _mm_set1_epi32(0x00011000)), ordem_bytes);
+
+        _mm_storel_epi64((__m128i *)&pt_bytes[(i / 4) * 3], valores);
+        ultimos_bytes = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(valores, 8));
+        memcpy(&pt_bytes[((i / 4) * 3) + 8], &ultimos_bytes, sizeof(ultimos_bytes));
+    }
+
+    resultado = base64_escalar(&pt_texto[i], tam_texto - i, &pt_bytes[(i / 4) * 3]);
+    return (resultado < 0) ? -1 : ((i / 4) * 3) + resultado;
+}
+
+/* Função: converte base64 para bytes, 32 caracteres (24 bytes) por iteração (AVX2)
+ * Parâmetros e retorno: ver base64_escalar()
+ */
+__attribute__((target("avx2")))
+static int base64_avx2(const char * pt_texto, int tam_texto, uint8_t * pt_bytes)
+{
+    const __m256i tabela_nibble_baixo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                                         0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i tabela_nibble_alto = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                                        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i tabela_deslocamento = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                         0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i ordem_bytes = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i mascara_2f = _mm256_set1_epi8(0x2F);
+    __m256i caracteres;
+    __m256i nibble_alto;
+    __m256i classe_baixo;
+    __m256i classe_alto;
+    __m256i valores;
+    int resultado;
+    int i;
+
+    for (i = 0; (i + 32) <= (tam_texto - 4); i += 32)
+    {
+        caracteres = _mm256_loadu_si256((const __m256i *)&pt_texto[i]);
+        nibble_alto = _mm256_and_si256(_mm256_srli_epi32(caracteres, 4), mascara_2f);
+        classe_baixo = _mm256_shuffle_epi8(tabela_nibble_baixo, _mm256_and_si256(caracteres, mascara_2f));
+        classe_alto = _mm256_shuffle_epi8(tabela_nibble_alto, nibble_alto);
+
+        if (_mm256_testz_si256(classe_baixo, classe_alto) == 0)
+        {
+            return -1;
+        }
+
+        valores = _mm256_add_epi8(caracteres, _mm256_shuffle_epi8(tabela_deslocamento, _mm256_add_epi8(_mm256_cmpeq_epi8(caracteres, mascara_2f), nibble_alto)));
+        valores = _mm256_maddubs_epi16(valores, _mm256_set1_epi32(0x01400140));
+        valores = _mm256_shuffle_epi8(_mm256_madd_epi16(valores, _mm256_set1_epi32(0x00011000)), ordem_bytes);
+
+        /* 12 bytes em cada metade de 128 bits: junta os 24 bytes no início */
+        valores = _mm256_permutevar8x32_epi32(valores, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm_storeu_si128((__m128i *)&pt_bytes[(i / 4) * 3], _mm256_castsi256_si128(valores));
+        _mm_storel_epi64((__m128i *)&pt_bytes[((i / 4) * 3) + 16], _mm256_extracti128_si256(valores, 1));
+    }
+
+    resultado = base64_ssse3(&pt_texto[i], tam_texto - i, &pt_bytes[(i / 4) * 3]);
+    return (resultado < 0) ? -1 : ((i / 4) * 3) + resultado;
+}
+
+#endif
+
+/* Função: escolhe a implementação da conversão (a mais
+ *         rápida suportada pelo processador, limitada a implementacao_max)
+ * Parâmetros: implementação mais rápida permitida
+ * Retorno: implementação escolhida
+ */
+TImplementacao_texto texto_binario_seleciona(TImplementacao_texto implementacao_max)
+{
+    TImplementacao_texto implementacao = IMPLEMENTACAO_ESCALAR;
+
+    converte_hex = hex_escalar;
+    converte_base64 = base64_escalar;
+
+#ifdef TEXTO_BINARIO_X86
+    __builtin_cpu_init();
+
+    if ((implementacao_max >= IMPLEMENTACAO_AVX2) && __builtin_cpu_supports("avx2"))
+    {
+        converte_hex = hex_avx2;
+        converte_base64 = base64_avx2;
+        implementacao = IMPLEMENTACAO_AVX2;
+    }
+    else if ((implementacao_max >= IMPLEMENTACAO_SSSE3) && __builtin_cpu_supports("ssse3"))
+    {
+        converte_hex = hex_ssse3;
+        converte_base64 = base64_ssse3;
+        implementacao = IMPLEMENTACAO_SSSE3;
+    }
+#else
+    (void)implementacao_max;
+#endif
+
+    return implementacao;
+}
+
+/* Função: nome de uma implementação
+ * Parâmetros: implementação
+ * Retorno: ponteiro para o nome
+ */
+const char * texto_binario_nome_implementacao(TImplementacao_texto implementacao)
+{
+    return (implementacao < QTDE_IMPLEMENTACOES) ? nomes_implementacoes[implementacao] : "?";
+}
+
+/* Função: tamanho máximo dos bytes convertidos de um texto
+ * Parâmetros: - codificação
+ *             - tamanho do texto (caracteres)
+ * Retorno: tamanho máximo (bytes)
+ */
+int texto_binario_tam_max(TCodificacao_texto codificacao, int tam_texto)
+{
+    return (codificacao == TEXTO_HEX) ? (tam_texto / 2) : (((tam_texto + 3) / 4) * 3);
+}
+
+/* Função: converte um payload em texto para bytes
+ * Parâmetros: - codificação
+ *             - ponteiro para o texto
+ *             - tamanho do texto (caracteres)
+ *             - ponteiro para os bytes (ao menos texto_binario_tam_max() bytes)
+ * Retorno: quantidade de bytes. -1 se o texto for inválido.
+ */
+int texto_binario_converte(TCodificacao_texto codificacao, const char * pt_texto, int tam_texto, uint8_t * pt_bytes)
+{
+    return (codificacao == TEXTO_HEX) ? converte_hex(pt_texto, tam_texto, pt_bytes) : converte_base64(pt_texto, tam_texto, pt_bytes);
+}
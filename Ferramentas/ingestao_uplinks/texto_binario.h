@@ -0,0 +1,44 @@
+/* Header file: conversão de payloads em texto (hexadecimal ou base64) para bytes
+ *
+ * Os servidores de rede entregam os payloads dos uplinks em hexadecimal
+ * (log do firmware, AT+SENDB) ou em base64 (JSON do servidor de rede). A
+ * conversão tem três implementações equivalentes:
+ * - escalar: tabela de 256 entradas, um caractere por vez;
+ * - SSSE3: 16 caracteres por iteração;
+ * - AVX2: 32 caracteres por iteração.
+ * As implementações vetoriais validam todos os caracteres do bloco de uma
+ * vez; o fim do texto (menos que um bloco, ou o último grupo base64, que
+ * pode ter '=') é convertido pela implementação escalar (na AVX2, antes
+ * pelos blocos de 16 caracteres da SSSE3, que os payloads curtos usam).
+ *
+ * Até texto_binario_seleciona() ser chamada, a implementação escalar é usada.
+ */
+
+#ifndef HEADER_TEXTO_BINARIO
+#define HEADER_TEXTO_BINARIO
+
+#include <stdint.h>
+
+/* Codificação do payload em texto */
+typedef enum
+{
+    TEXTO_HEX = 0,
+    TEXTO_BASE64
+}TCodificacao_texto;
+
+/* Implementação da conversão */
+typedef enum
+{
+    IMPLEMENTACAO_ESCALAR = 0,
+    IMPLEMENTACAO_SSSE3,
+    IMPLEMENTACAO_AVX2,
+    QTDE_IMPLEMENTACOES
+}TImplementacao_texto;
+
+#endif
+
+/* Protótipos */
+TImplementacao_texto texto_binario_seleciona(TImplementacao_texto implementacao_max);
+const char * texto_binario_nome_implementacao(TImplementacao_texto implementacao);
+int texto_binario_tam_max(TCodificacao_texto codificacao, int tam_texto);
+int texto_binario_converte(TCodificacao_texto codificacao, const char * pt_texto, int tam_texto, uint8_t * pt_bytes);
@@ -0,0 +1,1062 @@
+/* Ferramenta: planejador de capacidade de um gateway LoRaWAN (modelo ALOHA)
+ *
+ * Estima quantos nós dos capítulos 6, 7 e 8 um gateway comporta na
+ * sub-banda usada pelos firmwares (máscara de canais 00FF:..., LA915:
+ * 8 canais de 125 kHz) antes que a perda de pacotes por colisão fique
+ * inaceitável. Para cada tamanho e mistura da frota, calcula a
+ * probabilidade de entrega dos uplinks de cada aplicação:
+ * - analítica: ALOHA puro por canal e SF, sem captura e com SFs
+ *   ortogonais (um uplink de duração T_i colide com os uplinks de duração
+ *   T_j que começam numa janela de T_i + T_j):
+ *       P_i = exp(-soma_j(lambda_j * (T_i + T_j)))
+ * - Monte Carlo: nós espalhados na área de cobertura do gateway (perda de
+ *   percurso log-distância com sombreamento), um canal sorteado a cada
+ *   uplink, e um uplink é recebido se, para cada SF, a razão entre a sua
+ *   potência e a soma das potências dos uplinks sobrepostos desse SF no
+ *   mesmo canal for maior que o limiar: efeito captura no mesmo SF e
+ *   ortogonalidade imperfeita entre SFs diferentes (matriz de Croce et al.).
+ * O tempo no ar de cada DR e payload vem do agendador de uplinks dos
+ * firmwares, e a taxa de uplinks de cada nó é a nominal dos firmwares (sem
+ * orçamento diário de tempo no ar, o padrão deles) ou, com -l, a que o
+ * fair-use de 30 s/dia permite (o cap6 tenta a cada 15 s, mas o fair-use
+ * limita a cerca de 80 uplinks por dia no DR2).
+ *
+ * As simulações (pontos da varredura x replicações) são divididas entre as
+ * threads; cada uma tem o seu gerador, semeado pelo ponto e pela
+ * replicação, de forma que o resultado é o mesmo com qualquer quantidade
+ * de threads.
+ *
+ * Uso: planejador_capacidade [-n tamanhos da frota] [-m misturas cap6:cap7:cap8] [-r fixo|adr] [-R raio (km)]
+ *                            [-c limiar de captura (dB)] [-l] [-T duração (s)] [-k replicações] [-j threads]
+ *                            [-s semente] [-p perda aceitável (%)]
+ *      planejador_capacidade -t
+ * Tamanhos e misturas são listas separadas por vírgula (ex: -n 1000,5000 -m 1:1:1,1:0:0).
+ * Retorno: 0 em caso de sucesso (-t: todos os testes passaram), 1 caso contrário
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Cap7/Software/lixo_lorawan/main/agendador_uplinks/agendador_uplinks.h"
+#include "Cap7/Software/lixo_lorawan/main/lote_leituras/lote_leituras.h"
+#include "Cap6/contador_pulsos_lorawan/main/payloads/payloads.h"
+
+/* Definições - sub-banda dos firmwares (máscara 00FF:0000:..., canais 0 a 7) */
+#define PLANO_FREQUENCIAS                   PLANO_LA915
+#define QTDE_CANAIS                         8
+#define DR_FIRMWARE                         2
+#define DR_MIN                              2       // LA915: DR0 e DR1 não permitidos (dwell time de 400 ms)
+#define DR_MAX                              5       // DR6 (SF8, 500 kHz) não usa os canais de 125 kHz
+#define SF_MIN                              7
+#define SF_MAX                              12
+#define QTDE_SF                             (SF_MAX - SF_MIN + 1)
+
+/* Definições - aplicações (payload e período de envio dos firmwares) */
+#define QTDE_APLICACOES                     3
+#define TAM_PAYLOAD_CAP6                    PAYLOAD_CONTADORES_TAM
+#define PERIODO_CAP6_S                      15.0    // tarefa de envio do cap6
+#define TAM_PAYLOAD_CAP7                    (LOTE_LEITURAS_TAM_CABECALHO + (LOTE_LEITURAS_QTDE_POR_ENVIO * LOTE_LEITURAS_TAM_LEITURA))
+#define PERIODO_CAP7_S                      1800.0  // wake-up do cap7 (pior caso: um lote a cada wake-up)
+#define TAM_PAYLOAD_CAP8                    11      // série de temperaturas no payload máximo do DR2
+#define PERIODO_CAP8_S                      900.0   // janela de envio do cap8
+#define JITTER_ENVIO_S                      2.0     // variação do instante de cada envio (espera do módulo, boot)
+
+/* Definições - rádio */
+#define POTENCIA_TX_DBM                     14.0
+#define GANHO_ANTENAS_DB                    2.0
+#define PERDA_1KM_DB                        128.1   // perda de percurso: 128,1 + 37,6 * log10(d em km)
+#define EXPOENTE_PERDA_DB                   37.6
+#define DESVIO_SOMBREAMENTO_DB              6.0
+#define DISTANCIA_MIN_KM                    0.05
+#define MARGEM_ADR_DB                       10.0
+#define QTDE_AMOSTRAS_DISTRIBUICAO_DR       200000
+
+/* Definições - padrões */
+#define RAIO_PADRAO_KM                      3.0
+#define LIMIAR_CAPTURA_PADRAO_DB            6.0
+#define DURACAO_PADRAO_S                    3600.0
+#define QTDE_REPLICACOES_PADRAO             4
+#define SEMENTE_PADRAO                      1
+#define PERDA_ACEITAVEL_PADRAO              5.0     // %
+#define TAMANHOS_PADRAO                     "1000,2000,5000,10000,20000,50000,100000,200000"
+#define MISTURAS_PADRAO                     "1:1:1,1:0:0,0:1:0,0:0:1"
+
+/* Definições - limites */
+#define QTDE_MAX_TAMANHOS                   32
+#define QTDE_MAX_MISTURAS                   8
+#define QTDE_MAX_THREADS                    64
+#define QTDE_MAX_NOS                        10000000
+
+/* Definições - testes */
+#define TOLERANCIA_ANALITICA                0.02
+
+/* Uplink de uma simulação */
+typedef struct
+{
+    double inicio_s;
+    double fim_s;
+    double potencia_mw;
+    float potencia_dbm;
+    uint8_t canal;
+    uint8_t sf;
+    uint8_t aplicacao;
+}TUplink_simulado;
+
+/* Configuração do planejamento */
+typedef struct
+{
+    int tamanhos[QTDE_MAX_TAMANHOS];
+    int qtde_tamanhos;
+    double misturas[QTDE_MAX_MISTURAS][QTDE_APLICACOES];
+    int qtde_misturas;
+    bool adr;
+    double raio_km;
+    double limiar_captura_db;
+    bool com_fair_use;
+    double duracao_s;
+    int qtde_replicacoes;
+    int qtde_threads;
+    uint64_t semente;
+    double perda_aceitavel;
+}TConfig_planejamento;
+
+/* Resultado de uma simulação (um ponto da varredura, uma replicação) */
+typedef struct
+{
+    uint64_t enviados[QTDE_APLICACOES];
+    uint64_t entregues[QTDE_APLICACOES];
+    double tempo_no_ar_s;
+    bool sem_memoria;
+}TResultado_simulacao;
+
+/* Trabalho de uma thread */
+typedef struct
+{
+    const TConfig_planejamento * pt_config;
+    TResultado_simulacao * pt_resultados;
+    int qtde_simulacoes;
+    int primeira;
+    int passo;
+}TTrabalho_thread;
+
+static const char * nomes_aplicacoes[QTDE_APLICACOES] = { "cap6", "cap7", "cap8" };
+static const int tams_payload[QTDE_APLICACOES] = { TAM_PAYLOAD_CAP6, TAM_PAYLOAD_CAP7, TAM_PAYLOAD_CAP8 };
+static const double periodos_s[QTDE_APLICACOES] = { PERIODO_CAP6_S, PERIODO_CAP7_S, PERIODO_CAP8_S };
+
+/* SF e sensibilidade do gateway (SX1301, 125 kHz) por DR do LA915 */
+static const uint8_t sf_dr[DR_MAX + 1] = { 12, 11, 10, 9, 8, 7 };
+static const double sensibilidade_dr_dbm[DR_MAX + 1] = { -136.0, -134.5, -132.75, -131.25, -127.25, -126.5 };
+
+/* Relação sinal/interferência mínima (dB) para receber um uplink de SF
+ * [linha] sobreposto a uplinks de SF [coluna] (Croce et al., 2018). A
+ * diagonal (mesmo SF) é o limiar de captura, configurável.
+ */
+static const double limiares_sir_db[QTDE_SF][QTDE_SF] =
+{
+    {   0.0,  -8.0,  -9.0,  -9.0,  -9.0,  -9.0 },
+    { -11.0,   0.0, -11.0, -12.0, -13.0, -13.0 },
+    { -15.0, -13.0,   0.0, -13.0, -14.0, -15.0 },
+    { -19.0, -18.0, -17.0,   0.0, -17.0, -18.0 },
+    { -22.0, -22.0, -21.0, -20.0,   0.0, -20.0 },
+    { -25.0, -25.0, -25.0, -24.0, -23.0,   0.0 },
+};
+
+/* Distribuição dos nós pelos DRs (mesma para todas as aplicações) */
+static double fracoes_dr[DR_MAX + 1];
+
+/* Função: lê o relógio monotônico
+ * Parâmetros: nenhum
+ * Retorno: instante em segundos
+ */
+static double instante_s(void)
+{
+    struct timespec agora;
+
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return agora.tv_sec + (agora.tv_nsec / 1e9);
+}
+
+/* Função: embaralha um valor de 64 bits (splitmix64), para semear os geradores
+ * Parâmetros: valor
+ * Retorno: valor embaralhado
+ */
+static uint64_t embaralha(uint64_t valor)
+{
+    valor += 0x9E3779B97F4A7C15ULL;
+    valor = (valor ^ (valor >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    valor = (valor ^ (valor >> 27)) * 0x94D049BB133111EBULL;
+    return valor ^ (valor >> 31);
+}
+
+/* Função: gera número aleatório uniforme em [0, 1) (xorshift64*)
+ * Parâmetros: ponteiro para o estado do gerador
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(uint64_t * pt_estado)
+{
+    *pt_estado ^= *pt_estado >> 12;
+    *pt_estado ^= *pt_estado << 25;
+    *pt_estado ^= *pt_estado >> 27;
+    return ((*pt_estado * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Função: gera número aleatório com distribuição normal padrão (Box-Muller)
+ * Parâmetros: ponteiro para o estado do gerador
+ * Retorno: número gerado
+ */
+static double aleatorio_normal(uint64_t * pt_estado)
+{
+    double u1 = aleatorio_uniforme(pt_estado);
+    double u2 = aleatorio_uniforme(pt_estado);
+
+    return sqrt(-2.0 * log(1.0 - u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* Função: sorteia a posição de um nó na área de cobertura do gateway (potência
+ *         recebida acima da sensibilidade do DR2) e escolhe o DR dele
+ * Parâmetros: - ponteiro para o estado do gerador
+ *             - ponteiro para a configuração
+ *             - ponteiro para a potência recebida no gateway (dBm)
+ * Retorno: DR do nó (DR2, como nos firmwares, ou pelo ADR: o maior DR com margem)
+ */
+static int posiciona_no(uint64_t * pt_aleatorio, const TConfig_planejamento * pt_config, double * pt_potencia_dbm)
+{
+    double distancia_km;
+    int dr;
+
+    do
+    {
+        distancia_km = pt_config->raio_km * sqrt(aleatorio_uniforme(pt_aleatorio));
+        if (distancia_km < DISTANCIA_MIN_KM)
+        {
+            distancia_km = DISTANCIA_MIN_KM;
+        }
+
+        *pt_potencia_dbm = POTENCIA_TX_DBM + GANHO_ANTENAS_DB - (PERDA_1KM_DB + (EXPOENTE_PERDA_DB * log10(distancia_km))) +
+                           (DESVIO_SOMBREAMENTO_DB * aleatorio_normal(pt_aleatorio));
+    } while (*pt_potencia_dbm < sensibilidade_dr_dbm[DR_FIRMWARE]);
+
+    if (pt_config->adr == false)
+    {
+        return DR_FIRMWARE;
+    }
+
+    for (dr = DR_MAX; dr > DR_MIN; dr--)
+    {
+        if (*pt_potencia_dbm >= (sensibilidade_dr_dbm[dr] + MARGEM_ADR_DB))
+        {
+            break;
+        }
+    }
+
+    return dr;
+}
+
+/* Função: calcula o tempo no ar de um uplink da aplicação
+ * Parâmetros: aplicação e DR
+ * Retorno: tempo no ar (s)
+ */
+static double tempo_no_ar_s(int aplicacao, int dr)
+{
+    return agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS, dr, tams_payload[aplicacao]) / 1e6;
+}
+
+/* Função: calcula o período médio entre uplinks de um nó, limitado pelo
+ *         orçamento de fair-use do agendador de uplinks (se usado)
+ * Parâmetros: - aplicação e DR
+ *             - true: limita ao orçamento de fair-use
+ * Retorno: período (s)
+ */
+static double periodo_efetivo_s(int aplicacao, int dr, bool com_fair_use)
+{
+    double periodo_orcamento_s = (tempo_no_ar_s(aplicacao, dr) * 86400.0) / (ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS / 1000.0);
+
+    if ((com_fair_use == false) || (periodo_orcamento_s < periodos_s[aplicacao]))
+    {
+        return periodos_s[aplicacao];
+    }
+
+    return periodo_orcamento_s;
+}
+
+/* Função: calcula a quantidade de nós de cada aplicação num ponto da varredura
+ * Parâmetros: - tamanho da frota
+ *             - pesos da mistura
+ *             - ponteiro para as quantidades
+ * Retorno: nenhum
+ */
+static void divide_frota(int tamanho, const double * pt_mistura, int * pt_qtdes)
+{
+    double soma_pesos = pt_mistura[0] + pt_mistura[1] + pt_mistura[2];
+    double acumulado = 0.0;
+    int atribuidos = 0;
+    int i;
+
+    for (i = 0; i < QTDE_APLICACOES; i++)
+    {
+        acumulado += pt_mistura[i];
+        pt_qtdes[i] = (int)lround((tamanho * acumulado) / soma_pesos) - atribuidos;
+        atribuidos += pt_qtdes[i];
+    }
+}
+
+/* Função: compara dois uplinks pelo canal e pelo início (qsort)
+ * Parâmetros: ponteiros para os uplinks
+ * Retorno: <0, 0 ou >0
+ */
+static int compara_uplinks(const void * pt_a, const void * pt_b)
+{
+    const TUplink_simulado * pt_uplink_a = (const TUplink_simulado *)pt_a;
+    const TUplink_simulado * pt_uplink_b = (const TUplink_simulado *)pt_b;
+
+    if (pt_uplink_a->canal != pt_uplink_b->canal)
+    {
+        return (int)pt_uplink_a->canal - (int)pt_uplink_b->canal;
+    }
+
+    return (pt_uplink_a->inicio_s > pt_uplink_b->inicio_s) - (pt_uplink_a->inicio_s < pt_uplink_b->inicio_s);
+}
+
+/* Função: verifica se um uplink é recebido, dados os uplinks sobrepostos a ele no mesmo canal
+ * Parâmetros: - ponteiro para os uplinks do canal (ordenados pelo início)
+ *             - quantidade de uplinks do canal
+ *             - índice do uplink
+ *             - maior tempo no ar da simulação (s)
+ *             - limiar de captura (dB)
+ * Retorno: true: recebido; false: perdido por colisão
+ */
+static bool uplink_recebido(const TUplink_simulado * pt_uplinks, int qtde_uplinks, int indice, double tempo_no_ar_max_s, double limiar_captura_db)
+{
+    const TUplink_simulado * pt_uplink = &pt_uplinks[indice];
+    double interferencia_mw[QTDE_SF] = { 0.0 };
+    double limiar_db;
+    bool sobreposto = false;
+    int sf;
+    int i;
+
+    for (i = indice - 1; (i >= 0) && (pt_uplinks[i].inicio_s > (pt_uplink->inicio_s - tempo_no_ar_max_s)); i--)
+    {
+        if (pt_uplinks[i].fim_s > pt_uplink->inicio_s)
+        {
+            interferencia_mw[pt_uplinks[i].sf - SF_MIN] += pt_uplinks[i].potencia_mw;
+            sobreposto = true;
+        }
+    }
+
+    for (i = indice + 1; (i < qtde_uplinks) && (pt_uplinks[i].inicio_s < pt_uplink->fim_s); i++)
+    {
+        interferencia_mw[pt_uplinks[i].sf - SF_MIN] += pt_uplinks[i].potencia_mw;
+        sobreposto = true;
+    }
+
+    if (sobreposto == false)
+    {
+        return true;
+    }
+
+    for (sf = SF_MIN; sf <= SF_MAX; sf++)
+    {
+        if (interferencia_mw[sf - SF_MIN] > 0.0)
+        {
+            limiar_db = (sf == pt_uplink->sf) ? limiar_captura_db : limiares_sir_db[pt_uplink->sf - SF_MIN][sf - SF_MIN];
+
+            if ((pt_uplink->potencia_dbm - (10.0 * log10(interferencia_mw[sf - SF_MIN]))) < limiar_db)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* Função: executa uma simulação Monte Carlo de um ponto da varredura
+ * Parâmetros: - ponteiro para a configuração
+ *             - índice da simulação (ponto da varredura * replicações + replicação)
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void simula_ponto(const TConfig_planejamento * pt_config, int indice_simulacao, TResultado_simulacao * pt_resultado)
+{
+    const int indice_ponto = indice_simulacao / pt_config->qtde_replicacoes;
+    const double * pt_mistura = pt_config->misturas[indice_ponto / pt_config->qtde_tamanhos];
+    TUplink_simulado * pt_uplinks = NULL;
+    TUplink_simulado * pt_uplink;
+    uint64_t aleatorio = embaralha(pt_config->semente ^ embaralha((uint64_t)indice_simulacao + 1)) | 1;
+    double tempo_no_ar_max_s = 0.0;
+    double potencia_dbm;
+    double potencia_mw;
+    double periodo_s;
+    double duracao_s;
+    double instante;
+    int qtdes_nos[QTDE_APLICACOES];
+    int capacidade = 0;
+    int qtde_uplinks = 0;
+    int inicio_canal;
+    int aplicacao;
+    int dr;
+    int i;
+    int j;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_simulacao));
+    divide_frota(pt_config->tamanhos[indice_ponto % pt_config->qtde_tamanhos], pt_mistura, qtdes_nos);
+
+    /* Uplinks de cada nó: periódicos, com fase aleatória e jitter, canal sorteado a cada
+     * envio; gerados também antes e depois da duração, para interferir nos das bordas
+     */
+    for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+    {
+        for (i = 0; i < qtdes_nos[aplicacao]; i++)
+        {
+            dr = posiciona_no(&aleatorio, pt_config, &potencia_dbm);
+            duracao_s = tempo_no_ar_s(aplicacao, dr);
+            periodo_s = periodo_efetivo_s(aplicacao, dr, pt_config->com_fair_use);
+            potencia_mw = pow(10.0, potencia_dbm / 10.0);
+            tempo_no_ar_max_s = fmax(tempo_no_ar_max_s, duracao_s);
+
+            for (instante = (aleatorio_uniforme(&aleatorio) * periodo_s) - periodo_s;
+                 instante < (pt_config->duracao_s + periodo_s); instante += periodo_s)
+            {
+                if (qtde_uplinks == capacidade)
+                {
+                    capacidade = (capacidade > 0) ? (2 * capacidade) : 65536;
+                    pt_uplink = realloc(pt_uplinks, capacidade * sizeof(TUplink_simulado));
+                    if (pt_uplink == NULL)
+                    {
+                        pt_resultado->sem_memoria = true;
+                        free(pt_uplinks);
+                        return;
+                    }
+                    pt_uplinks = pt_uplink;
+                }
+
+                pt_uplink = &pt_uplinks[qtde_uplinks++];
+                pt_uplink->inicio_s = instante + (JITTER_ENVIO_S * (aleatorio_uniforme(&aleatorio) - 0.5));
+                pt_uplink->fim_s = pt_uplink->inicio_s + duracao_s;
+                pt_uplink->potencia_dbm = (float)potencia_dbm;
+                pt_uplink->potencia_mw = potencia_mw;
+                pt_uplink->canal = (uint8_t)(aleatorio_uniforme(&aleatorio) * QTDE_CANAIS);
+                pt_uplink->sf = sf_dr[dr];
+                pt_uplink->aplicacao = (uint8_t)aplicacao;
+            }
+        }
+    }
+
+    /* Recepção: só os uplinks que começam dentro da duração são contados */
+    qsort(pt_uplinks, qtde_uplinks, sizeof(TUplink_simulado), compara_uplinks);
+
+    for (inicio_canal = 0; inicio_canal < qtde_uplinks; inicio_canal = j)
+    {
+        for (j = inicio_canal; (j < qtde_uplinks) && (pt_uplinks[j].canal == pt_uplinks[inicio_canal].canal); j++);
+
+        for (i = inicio_canal; i < j; i++)
+        {
+            if ((pt_uplinks[i].inicio_s < 0.0) || (pt_uplinks[i].inicio_s >= pt_config->duracao_s))
+            {
+                continue;
+            }
+
+            pt_resultado->enviados[pt_uplinks[i].aplicacao]++;
+            pt_resultado->tempo_no_ar_s += pt_uplinks[i].fim_s - pt_uplinks[i].inicio_s;
+            pt_resultado->entregues[pt_uplinks[i].aplicacao] += uplink_recebido(&pt_uplinks[inicio_canal], j - inicio_canal, i - inicio_canal,
+                                                                                tempo_no_ar_max_s, pt_config->limiar_captura_db);
+        }
+    }
+
+    free(pt_uplinks);
+}
+
+/* Função: executa as simulações de uma thread (uma a cada "passo", a partir da primeira)
+ * Parâmetros: ponteiro para o trabalho da thread
+ * Retorno: NULL
+ */
+static void * executa_trabalho(void * pt_argumento)
+{
+    TTrabalho_thread * pt_trabalho = (TTrabalho_thread *)pt_argumento;
+    int i;
+
+    for (i = pt_trabalho->primeira; i < pt_trabalho->qtde_simulacoes; i += pt_trabalho->passo)
+    {
+        simula_ponto(pt_trabalho->pt_config, i, &pt_trabalho->pt_resultados[i]);
+    }
+
+    return NULL;
+}
+
+/* Função: estima a fração dos nós em cada DR (amostragem das posições)
+ * Parâmetros: ponteiro para a configuração
+ * Retorno: nenhum (preenche fracoes_dr)
+ */
+static void estima_distribuicao_dr(const TConfig_planejamento * pt_config)
+{
+    uint64_t aleatorio = embaralha(pt_config->semente) | 1;
+    double potencia_dbm;
+    int i;
+
+    memset(fracoes_dr, 0x00, sizeof(fracoes_dr));
+    for (i = 0; i < QTDE_AMOSTRAS_DISTRIBUICAO_DR; i++)
+    {
+        fracoes_dr[posiciona_no(&aleatorio, pt_config, &potencia_dbm)] += 1.0 / QTDE_AMOSTRAS_DISTRIBUICAO_DR;
+    }
+}
+
+/* Função: calcula a entrega analítica (ALOHA puro, sem captura, SFs ortogonais)
+ * Parâmetros: - ponteiro para a configuração
+ *             - quantidade de nós de cada aplicação
+ *             - ponteiro para a probabilidade de entrega de cada aplicação
+ * Retorno: nenhum
+ */
+static void calcula_entrega_analitica(const TConfig_planejamento * pt_config, const int * pt_qtdes_nos, double * pt_entregas)
+{
+    double expoente;
+    int aplicacao;
+    int outra;
+    int dr;
+
+    for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+    {
+        pt_entregas[aplicacao] = 0.0;
+
+        for (dr = DR_MIN; dr <= DR_MAX; dr++)
+        {
+            if (fracoes_dr[dr] <= 0.0)
+            {
+                continue;
+            }
+
+            /* Taxa de uplinks por canal de cada aplicação nesse DR */
+            expoente = 0.0;
+            for (outra = 0; outra < QTDE_APLICACOES; outra++)
+            {
+                expoente += ((pt_qtdes_nos[outra] * fracoes_dr[dr]) / (QTDE_CANAIS * periodo_efetivo_s(outra, dr, pt_config->com_fair_use))) *
+                            (tempo_no_ar_s(aplicacao, dr) + tempo_no_ar_s(outra, dr));
+            }
+
+            pt_entregas[aplicacao] += fracoes_dr[dr] * exp(-expoente);
+        }
+    }
+}
+
+/* Função: executa todas as simulações da varredura, divididas entre as threads
+ * Parâmetros: - ponteiro para a configuração
+ *             - ponteiro para os resultados (pontos * replicações)
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool executa_varredura(const TConfig_planejamento * pt_config, TResultado_simulacao * pt_resultados)
+{
+    TTrabalho_thread trabalhos[QTDE_MAX_THREADS];
+    pthread_t threads[QTDE_MAX_THREADS];
+    const int qtde_simulacoes = pt_config->qtde_misturas * pt_config->qtde_tamanhos * pt_config->qtde_replicacoes;
+    bool sucesso = true;
+    int i;
+
+    for (i = 0; i < pt_config->qtde_threads; i++)
+    {
+        trabalhos[i].pt_config = pt_config;
+        trabalhos[i].pt_resultados = pt_resultados;
+        trabalhos[i].qtde_simulacoes = qtde_simulacoes;
+        trabalhos[i].primeira = i;
+        trabalhos[i].passo = pt_config->qtde_threads;
+    }
+
+    for (i = 1; i < pt_config->qtde_threads; i++)
+    {
+        if (pthread_create(&threads[i], NULL, executa_trabalho, &trabalhos[i]) != 0)
+        {
+            executa_trabalho(&trabalhos[i]);
+            threads[i] = 0;
+        }
+    }
+    executa_trabalho(&trabalhos[0]);
+    for (i = 1; i < pt_config->qtde_threads; i++)
+    {
+        if (threads[i] != 0)
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    for (i = 0; i < qtde_simulacoes; i++)
+    {
+        sucesso &= !pt_resultados[i].sem_memoria;
+    }
+
+    return sucesso;
+}
+
+/* Função: soma as replicações de um ponto da varredura
+ * Parâmetros: - ponteiro para a configuração
+ *             - ponteiro para os resultados
+ *             - índice do ponto
+ *             - ponteiro para a entrega Monte Carlo de cada aplicação (-1: sem uplinks)
+ *             - ponteiro para a entrega total
+ *             - ponteiro para a carga média por canal (Erlang)
+ * Retorno: nenhum
+ */
+static void resume_ponto(const TConfig_planejamento * pt_config, const TResultado_simulacao * pt_resultados, int indice_ponto,
+                         double * pt_entregas, double * pt_entrega_total, double * pt_carga)
+{
+    uint64_t enviados[QTDE_APLICACOES] = { 0 };
+    uint64_t entregues[QTDE_APLICACOES] = { 0 };
+    uint64_t total_enviados = 0;
+    uint64_t total_entregues = 0;
+    double tempo_no_ar_s = 0.0;
+    int aplicacao;
+    int i;
+
+    for (i = 0; i < pt_config->qtde_replicacoes; i++)
+    {
+        const TResultado_simulacao * pt_resultado = &pt_resultados[(indice_ponto * pt_config->qtde_replicacoes) + i];
+
+        for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+        {
+            enviados[aplicacao] += pt_resultado->enviados[aplicacao];
+            entregues[aplicacao] += pt_resultado->entregues[aplicacao];
+        }
+        tempo_no_ar_s += pt_resultado->tempo_no_ar_s;
+    }
+
+    for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+    {
+        pt_entregas[aplicacao] = (enviados[aplicacao] > 0) ? ((double)entregues[aplicacao] / enviados[aplicacao]) : -1.0;
+        total_enviados += enviados[aplicacao];
+        total_entregues += entregues[aplicacao];
+    }
+
+    *pt_entrega_total = (total_enviados > 0) ? ((double)total_entregues / total_enviados) : 1.0;
+    *pt_carga = tempo_no_ar_s / (pt_config->qtde_replicacoes * QTDE_CANAIS * pt_config->duracao_s);
+}
+
+/* Função: executa o planejamento e mostra a tabela de entrega por tamanho e mistura da frota
+ * Parâmetros: ponteiro para a configuração
+ * Retorno: 0 em caso de sucesso, 1 caso contrário
+ */
+static int planeja(const TConfig_planejamento * pt_config)
+{
+    TResultado_simulacao * pt_resultados;
+    double entregas_analiticas[QTDE_APLICACOES];
+    double entregas[QTDE_APLICACOES];
+    double entrega_total;
+    double carga;
+    double inicio_s;
+    int qtdes_nos[QTDE_APLICACOES];
+    int capacidade;
+    int mistura;
+    int tamanho;
+    int aplicacao;
+    int dr;
+
+    if ((pt_resultados = calloc((size_t)pt_config->qtde_misturas * pt_config->qtde_tamanhos * pt_config->qtde_replicacoes, sizeof(TResultado_simulacao))) == NULL)
+    {
+        return 1;
+    }
+
+    estima_distribuicao_dr(pt_config);
+
+    printf("Sub-banda LA915 00FF (%d canais de 125 kHz), DR %s, raio %.1f km, captura %.1f dB, %s\n", QTDE_CANAIS,
+           pt_config->adr ? "pelo ADR" : "2 (firmwares)", pt_config->raio_km, pt_config->limiar_captura_db,
+           pt_config->com_fair_use ? "com o fair-use de 30 s/dia" : "sem orcamento diario");
+    printf("Nos por DR:");
+    for (dr = DR_MIN; dr <= DR_MAX; dr++)
+    {
+        printf(" DR%d (SF%d) %.1f%%", dr, sf_dr[dr], 100.0 * fracoes_dr[dr]);
+    }
+    printf("\n");
+    for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+    {
+        printf("%s: %d bytes, tempo no ar %.1f ms no DR2, um uplink a cada %.0f s no DR2\n", nomes_aplicacoes[aplicacao], tams_payload[aplicacao],
+               1000.0 * tempo_no_ar_s(aplicacao, DR_FIRMWARE), periodo_efetivo_s(aplicacao, DR_FIRMWARE, pt_config->com_fair_use));
+    }
+
+    inicio_s = instante_s();
+    if (executa_varredura(pt_config, pt_resultados) == false)
+    {
+        free(pt_resultados);
+        fprintf(stderr, "Memoria insuficiente\n");
+        return 1;
+    }
+
+    printf("%d simulacoes de %.0f s (%d replicacoes por ponto) em %.2f s com %d thread(s)\n\n",
+           pt_config->qtde_misturas * pt_config->qtde_tamanhos * pt_config->qtde_replicacoes, pt_config->duracao_s,
+           pt_config->qtde_replicacoes, instante_s() - inicio_s, pt_config->qtde_threads);
+
+    for (mistura = 0; mistura < pt_config->qtde_misturas; mistura++)
+    {
+        printf("Mistura %g:%g:%g (cap6:cap7:cap8)\n", pt_config->misturas[mistura][0], pt_config->misturas[mistura][1], pt_config->misturas[mistura][2]);
+        printf("%9s %8s %8s %8s %7s | %-23s | %-23s | %6s\n", "nos", "cap6", "cap7", "cap8", "carga", "entrega analitica (%)", "entrega Monte Carlo (%)", "total");
+        capacidade = 0;
+
+        for (tamanho = 0; tamanho < pt_config->qtde_tamanhos; tamanho++)
+        {
+            divide_frota(pt_config->tamanhos[tamanho], pt_config->misturas[mistura], qtdes_nos);
+            calcula_entrega_analitica(pt_config, qtdes_nos, entregas_analiticas);
+            resume_ponto(pt_config, pt_resultados, (mistura * pt_config->qtde_tamanhos) + tamanho, entregas, &entrega_total, &carga);
+
+            printf("%9d %8d %8d %8d %7.4f |", pt_config->tamanhos[tamanho], qtdes_nos[0], qtdes_nos[1], qtdes_nos[2], carga);
+            for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+            {
+                if (qtdes_nos[aplicacao] > 0)
+                {
+                    printf(" %7.2f", 100.0 * entregas_analiticas[aplicacao]);
+                }
+                else
+                {
+                    printf(" %7s", "-");
+                }
+            }
+            printf(" |");
+            for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+            {
+                if (entregas[aplicacao] >= 0.0)
+                {
+                    printf(" %7.2f", 100.0 * entregas[aplicacao]);
+                }
+                else
+                {
+                    printf(" %7s", "-");
+                }
+            }
+            printf(" | %6.2f\n", 100.0 * entrega_total);
+
+            if ((1.0 - entrega_total) * 100.0 <= pt_config->perda_aceitavel)
+            {
+                capacidade = pt_config->tamanhos[tamanho];
+            }
+        }
+
+        if (capacidade > 0)
+        {
+            printf("Maior frota com perda de ate %.1f%%: %d nos\n\n", pt_config->perda_aceitavel, capacidade);
+        }
+        else
+        {
+            printf("Nenhum tamanho com perda de ate %.1f%%\n\n", pt_config->perda_aceitavel);
+        }
+    }
+
+    free(pt_resultados);
+    return 0;
+}
+
+/* Função: lê uma lista de números separados por vírgula
+ * Parâmetros: - texto
+ *             - ponteiro para os números
+ *             - quantidade máxima
+ * Retorno: quantidade de números lidos (0 se o texto for inválido)
+ */
+static int le_lista(const char * pt_texto, int * pt_numeros, int qtde_max)
+{
+    char * pt_fim;
+    long numero;
+    int qtde = 0;
+
+    while (qtde < qtde_max)
+    {
+        numero = strtol(pt_texto, &pt_fim, 10);
+        if ((pt_fim == pt_texto) || (numero <= 0) || (numero > QTDE_MAX_NOS))
+        {
+            return 0;
+        }
+
+        pt_numeros[qtde++] = (int)numero;
+        if (*pt_fim == '\0')
+        {
+            return qtde;
+        }
+        if (*pt_fim != ',')
+        {
+            return 0;
+        }
+        pt_texto = pt_fim + 1;
+    }
+
+    return 0;
+}
+
+/* Função: lê uma lista de misturas cap6:cap7:cap8 separadas por vírgula
+ * Parâmetros: - texto
+ *             - ponteiro para as misturas
+ * Retorno: quantidade de misturas lidas (0 se o texto for inválido)
+ */
+static int le_misturas(const char * pt_texto, double misturas[][QTDE_APLICACOES])
+{
+    char * pt_fim;
+    int qtde = 0;
+    int aplicacao;
+
+    while (qtde < QTDE_MAX_MISTURAS)
+    {
+        for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+        {
+            misturas[qtde][aplicacao] = strtod(pt_texto, &pt_fim);
+            if ( (pt_fim == pt_texto) || (misturas[qtde][aplicacao] < 0.0) ||
+                 (*pt_fim != ((aplicacao < (QTDE_APLICACOES - 1)) ? ':' : *pt_fim)) )
+            {
+                return 0;
+            }
+            pt_texto = pt_fim + ((aplicacao < (QTDE_APLICACOES - 1)) ? 1 : 0);
+        }
+
+        if ((misturas[qtde][0] + misturas[qtde][1] + misturas[qtde][2]) <= 0.0)
+        {
+            return 0;
+        }
+
+        qtde++;
+        if (*pt_texto == '\0')
+        {
+            return qtde;
+        }
+        if (*pt_texto != ',')
+        {
+            return 0;
+        }
+        pt_texto++;
+    }
+
+    return 0;
+}
+
+/* Função: preenche a configuração padrão
+ * Parâmetros: ponteiro para a configuração
+ * Retorno: nenhum
+ */
+static void configuracao_padrao(TConfig_planejamento * pt_config)
+{
+    memset(pt_config, 0x00, sizeof(TConfig_planejamento));
+    pt_config->qtde_tamanhos = le_lista(TAMANHOS_PADRAO, pt_config->tamanhos, QTDE_MAX_TAMANHOS);
+    pt_config->qtde_misturas = le_misturas(MISTURAS_PADRAO, pt_config->misturas);
+    pt_config->raio_km = RAIO_PADRAO_KM;
+    pt_config->limiar_captura_db = LIMIAR_CAPTURA_PADRAO_DB;
+    pt_config->duracao_s = DURACAO_PADRAO_S;
+    pt_config->qtde_replicacoes = QTDE_REPLICACOES_PADRAO;
+    pt_config->qtde_threads = 1;
+    pt_config->semente = SEMENTE_PADRAO;
+    pt_config->perda_aceitavel = PERDA_ACEITAVEL_PADRAO;
+}
+
+/* Função: executa uma varredura de teste e resume a entrega total de cada ponto
+ * Parâmetros: - ponteiro para a configuração
+ *             - ponteiro para a entrega total de cada ponto (Monte Carlo)
+ *             - ponteiro para a entrega analítica média de cada ponto (ponderada pelos uplinks), ou NULL
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool varredura_teste(const TConfig_planejamento * pt_config, double * pt_entregas_totais, double * pt_entregas_analiticas)
+{
+    TResultado_simulacao * pt_resultados;
+    double entregas[QTDE_APLICACOES];
+    double entregas_analiticas[QTDE_APLICACOES];
+    double carga;
+    double peso;
+    double soma_pesos;
+    int qtdes_nos[QTDE_APLICACOES];
+    int qtde_pontos = pt_config->qtde_misturas * pt_config->qtde_tamanhos;
+    int aplicacao;
+    int i;
+
+    if ((pt_resultados = calloc((size_t)qtde_pontos * pt_config->qtde_replicacoes, sizeof(TResultado_simulacao))) == NULL)
+    {
+        return false;
+    }
+
+    estima_distribuicao_dr(pt_config);
+    if (executa_varredura(pt_config, pt_resultados) == false)
+    {
+        free(pt_resultados);
+        return false;
+    }
+
+    for (i = 0; i < qtde_pontos; i++)
+    {
+        resume_ponto(pt_config, pt_resultados, i, entregas, &pt_entregas_totais[i], &carga);
+
+        if (pt_entregas_analiticas != NULL)
+        {
+            divide_frota(pt_config->tamanhos[i % pt_config->qtde_tamanhos], pt_config->misturas[i / pt_config->qtde_tamanhos], qtdes_nos);
+            calcula_entrega_analitica(pt_config, qtdes_nos, entregas_analiticas);
+            pt_entregas_analiticas[i] = 0.0;
+            soma_pesos = 0.0;
+
+            for (aplicacao = 0; aplicacao < QTDE_APLICACOES; aplicacao++)
+            {
+                peso = qtdes_nos[aplicacao] / periodo_efetivo_s(aplicacao, DR_FIRMWARE, pt_config->com_fair_use);
+                pt_entregas_analiticas[i] += peso * entregas_analiticas[aplicacao];
+                soma_pesos += peso;
+            }
+            pt_entregas_analiticas[i] /= soma_pesos;
+        }
+    }
+
+    free(pt_resultados);
+    return true;
+}
+
+/* Função: executa os testes: Monte Carlo sem captura concorda com o modelo
+ *         analítico, captura e ADR melhoram a entrega, a entrega cai com o
+ *         tamanho da frota e o resultado não depende da quantidade de threads
+ * Parâmetros: nenhum
+ * Retorno: 0 se todos os testes passaram, 1 caso contrário
+ */
+static int executa_testes(void)
+{
+    TConfig_planejamento config;
+    double sem_captura[QTDE_MAX_TAMANHOS];
+    double analiticas[QTDE_MAX_TAMANHOS];
+    double com_captura[QTDE_MAX_TAMANHOS];
+    double com_adr[QTDE_MAX_TAMANHOS];
+    double com_threads[QTDE_MAX_TAMANHOS];
+    double diferenca_max = 0.0;
+    bool sucesso;
+    int falhas = 0;
+    int i;
+
+    configuracao_padrao(&config);
+    config.qtde_tamanhos = le_lista("2000,10000,30000,60000", config.tamanhos, QTDE_MAX_TAMANHOS);
+    config.qtde_misturas = le_misturas("1:1:1", config.misturas);
+    config.duracao_s = 1800.0;
+
+    /* Tamanhos da frota escolhidos para os períodos com o fair-use (sem ele, o cap6 satura a sub-banda já com 2000 nós) */
+    config.com_fair_use = true;
+
+    /* Sem captura e com todos no DR2, o Monte Carlo é o ALOHA puro do modelo analítico */
+    config.limiar_captura_db = INFINITY;
+    sucesso = varredura_teste(&config, sem_captura, analiticas);
+    for (i = 0; sucesso && (i < config.qtde_tamanhos); i++)
+    {
+        printf("%6d nos, sem captura: Monte Carlo %6.2f%%, analitico %6.2f%%\n", config.tamanhos[i], 100.0 * sem_captura[i], 100.0 * analiticas[i]);
+        diferenca_max = fmax(diferenca_max, fabs(sem_captura[i] - analiticas[i]));
+    }
+    sucesso = sucesso && (diferenca_max <= TOLERANCIA_ANALITICA);
+    printf("Monte Carlo sem captura x analitico: diferenca maxima %.2f pontos percentuais -> %s\n", 100.0 * diferenca_max, sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    sucesso = true;
+    for (i = 1; i < config.qtde_tamanhos; i++)
+    {
+        sucesso &= (sem_captura[i] < sem_captura[i - 1]);
+    }
+    printf("Entrega cai com o tamanho da frota -> %s\n", sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    /* Captura: um uplink forte sobrevive à colisão */
+    config.limiar_captura_db = LIMIAR_CAPTURA_PADRAO_DB;
+    sucesso = varredura_teste(&config, com_captura, NULL);
+    for (i = 0; sucesso && (i < config.qtde_tamanhos); i++)
+    {
+        sucesso = (com_captura[i] > sem_captura[i]);
+    }
+    printf("Captura melhora a entrega (%d nos: %.2f%% -> %.2f%%) -> %s\n", config.tamanhos[config.qtde_tamanhos - 1],
+           100.0 * sem_captura[config.qtde_tamanhos - 1], 100.0 * com_captura[config.qtde_tamanhos - 1], sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    /* ADR: uplinks mais curtos e SFs quase ortogonais */
+    config.adr = true;
+    sucesso = varredura_teste(&config, com_adr, NULL);
+    for (i = 0; sucesso && (i < config.qtde_tamanhos); i++)
+    {
+        sucesso = (com_adr[i] > com_captura[i]);
+    }
+    printf("ADR melhora a entrega (%d nos: %.2f%% -> %.2f%%) -> %s\n", config.tamanhos[config.qtde_tamanhos - 1],
+           100.0 * com_captura[config.qtde_tamanhos - 1], 100.0 * com_adr[config.qtde_tamanhos - 1], sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    /* Mesmo resultado com várias threads */
+    config.qtde_threads = 5;
+    sucesso = varredura_teste(&config, com_threads, NULL) && (memcmp(com_threads, com_adr, config.qtde_tamanhos * sizeof(double)) == 0);
+    printf("Mesmo resultado com 1 e %d threads -> %s\n", config.qtde_threads, sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    printf("%s\n", (falhas == 0) ? "Todos os testes passaram" : "Houve falhas");
+    return (falhas == 0) ? 0 : 1;
+}
+
+/* Função: ponto de entrada
+ * Parâmetros: ver o cabeçalho do arquivo
+ * Retorno: ver o cabeçalho do arquivo
+ */
+int main(int argc, char * argv[])
+{
+    TConfig_planejamento config;
+    int opcao;
+
+    configuracao_padrao(&config);
+    config.qtde_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opcao = getopt(argc, argv, "tn:m:r:R:c:lT:k:j:s:p:")) != -1)
+    {
+        switch (opcao)
+        {
+            case 't':
+                return executa_testes();
+
+            case 'n':
+                config.qtde_tamanhos = le_lista(optarg, config.tamanhos, QTDE_MAX_TAMANHOS);
+                break;
+
+            case 'm':
+                config.qtde_misturas = le_misturas(optarg, config.misturas);
+                break;
+
+            case 'r':
+                if ((strcmp(optarg, "fixo") != 0) && (strcmp(optarg, "adr") != 0))
+                {
+                    config.qtde_tamanhos = 0;
+                }
+                config.adr = (strcmp(optarg, "adr") == 0);
+                break;
+
+            case 'R':
+                config.raio_km = atof(optarg);
+                break;
+
+            case 'c':
+                config.limiar_captura_db = atof(optarg);
+                break;
+
+            case 'l':
+                config.com_fair_use = true;
+                break;
+
+            case 'T':
+                config.duracao_s = atof(optarg);
+                break;
+
+            case 'k':
+                config.qtde_replicacoes = atoi(optarg);
+                break;
+
+            case 'j':
+                config.qtde_threads = atoi(optarg);
+                break;
+
+            case 's':
+                config.semente = strtoull(optarg, NULL, 0);
+                break;
+
+            case 'p':
+                config.perda_aceitavel = atof(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Uso: %s [-n tamanhos] [-m misturas cap6:cap7:cap8] [-r fixo|adr] [-R raio (km)] [-c captura (dB)] [-l]\n"
+                                "       [-T duracao (s)] [-k replicacoes] [-j threads] [-s semente] [-p perda aceitavel (%%)] | -t\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if ( (config.qtde_tamanhos == 0) || (config.qtde_misturas == 0) || (config.raio_km <= DISTANCIA_MIN_KM) ||
+         (config.duracao_s <= 0.0) || (config.qtde_replicacoes <= 0) || (config.perda_aceitavel < 0.0) )
+    {
+        fprintf(stderr, "Parametros invalidos\n");
+        return 1;
+    }
+
+    config.qtde_threads = (config.qtde_threads < 1) ? 1 : ((config.qtde_threads > QTDE_MAX_THREADS) ? QTDE_MAX_THREADS : config.qtde_threads);
+    return planeja(&config);
+}
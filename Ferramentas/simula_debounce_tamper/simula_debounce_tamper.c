@@ -0,0 +1,276 @@
+/* Ferramenta: simulação do debounce do tamper (Cap7)
+ *
+ * Executa, em tempo virtual, o mesmo código de debounce usado no firmware
+ * (debounce_tamper.c) com sequências de bordas injetadas no GPIO de tamper:
+ * cada borda rearma o timer one-shot de debounce e cada expiração do timer
+ * lê o nível do GPIO. Para cada cenário, confere os eventos gerados com os
+ * esperados e compara as execuções do software de tamper (interrupções e
+ * expirações do timer) com as de uma task que lê o GPIO por polling.
+ *
+ * Uso: simula_debounce_tamper
+ * Retorno: 0 se todos os cenários geraram os eventos esperados, 1 caso contrário
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "debounce_tamper.h"
+
+/* Definição - tempo de debounce (mesmo valor de TEMPO_DEBOUNCE_TAMPER do firmware) */
+#define TEMPO_DEBOUNCE_MS             200
+
+/* Definição - período de leitura do GPIO na alternativa por polling */
+#define PERIODO_POLLING_MS            10
+
+/* Definições - limites dos cenários */
+#define QTDE_MAX_BORDAS               64
+#define QTDE_MAX_EVENTOS              8
+
+/* Cenário: nível inicial, instantes das bordas (cada borda inverte o nível)
+ * e eventos que o debounce deve gerar
+ */
+typedef struct
+{
+    const char * nome;
+    int nivel_inicial;
+    uint32_t duracao_ms;
+    int qtde_bordas;
+    uint32_t instantes_bordas_ms[QTDE_MAX_BORDAS];
+    int qtde_eventos_esperados;
+    int eventos_esperados[QTDE_MAX_EVENTOS];
+}TCenario_tamper;
+
+/* Resultado de uma simulação */
+typedef struct
+{
+    int qtde_eventos;
+    int eventos[QTDE_MAX_EVENTOS];
+    uint32_t instantes_eventos_ms[QTDE_MAX_EVENTOS];
+    uint32_t execucoes;
+}TResultado_simulacao;
+
+static const TCenario_tamper cenarios[] =
+{
+    {
+        "abertura limpa", 0, 1000,
+        1, { 100 },
+        1, { EVENTO_TAMPER_ACIONADO }
+    },
+    {
+        "abertura com trepidacao", 0, 1000,
+        7, { 100, 102, 105, 109, 114, 120, 127 },
+        1, { EVENTO_TAMPER_ACIONADO }
+    },
+    {
+        "abertura e fechamento com trepidacao", 0, 3000,
+        10, { 100, 103, 107, 112, 118, 1500, 1504, 1509, 1515, 1522 },
+        2, { EVENTO_TAMPER_ACIONADO, EVENTO_TAMPER_DESFEITO }
+    },
+    {
+        "pulso curto (ruido)", 0, 1000,
+        2, { 100, 150 },
+        0, { 0 }
+    },
+    {
+        "vibracao continua", 0, 2000,
+        20, { 100, 140, 180, 220, 260, 300, 340, 380, 420, 460,
+              500, 540, 580, 620, 660, 700, 740, 780, 820, 860 },
+        0, { 0 }
+    },
+    {
+        "fechamento apos wake-up (nivel anterior alto)", 1, 1000,
+        3, { 0, 4, 9 },
+        1, { EVENTO_TAMPER_DESFEITO }
+    },
+};
+
+/* Função: nível do GPIO de tamper num instante do cenário
+ * Parâmetros: - ponteiro para o cenário
+ *             - instante (ms)
+ * Retorno: nível (0 ou 1)
+ */
+static int nivel_no_instante(const TCenario_tamper * pt_cenario, uint32_t instante_ms)
+{
+    int nivel = pt_cenario->nivel_inicial;
+    int i;
+
+    for (i = 0; i < pt_cenario->qtde_bordas; i++)
+    {
+        if (pt_cenario->instantes_bordas_ms[i] <= instante_ms)
+        {
+            nivel = !nivel;
+        }
+    }
+
+    return nivel;
+}
+
+/* Função: registra um evento no resultado
+ * Parâmetros: - ponteiro para o resultado
+ *             - evento
+ *             - instante (ms)
+ * Retorno: nenhum
+ */
+static void registra_evento(TResultado_simulacao * pt_resultado, int evento, uint32_t instante_ms)
+{
+    if ((evento == EVENTO_TAMPER_NENHUM) || (pt_resultado->qtde_eventos >= QTDE_MAX_EVENTOS))
+    {
+        return;
+    }
+
+    pt_resultado->eventos[pt_resultado->qtde_eventos] = evento;
+    pt_resultado->instantes_eventos_ms[pt_resultado->qtde_eventos] = instante_ms;
+    pt_resultado->qtde_eventos++;
+}
+
+/* Função: simula o debounce por interrupção e timer (código do firmware)
+ * Parâmetros: - ponteiro para o cenário
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void simula_por_interrupcao(const TCenario_tamper * pt_cenario, TResultado_simulacao * pt_resultado)
+{
+    TDebounce_tamper debounce;
+    uint32_t expiracao_timer_ms = 0;
+    uint32_t instante_borda_ms;
+    int i;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_simulacao));
+    debounce_tamper_inicializa(&debounce, pt_cenario->nivel_inicial);
+
+    for (i = 0; i < pt_cenario->qtde_bordas; i++)
+    {
+        instante_borda_ms = pt_cenario->instantes_bordas_ms[i];
+
+        /* Timer expira antes da próxima borda */
+        if ((debounce.timer_armado == true) && (expiracao_timer_ms <= instante_borda_ms))
+        {
+            registra_evento(pt_resultado,
+                            debounce_tamper_expiracao_timer(&debounce, nivel_no_instante(pt_cenario, expiracao_timer_ms)),
+                            expiracao_timer_ms);
+        }
+
+        /* Interrupção da borda: rearma o timer */
+        debounce_tamper_registra_borda(&debounce);
+        expiracao_timer_ms = instante_borda_ms + TEMPO_DEBOUNCE_MS;
+    }
+
+    if ((debounce.timer_armado == true) && (expiracao_timer_ms <= pt_cenario->duracao_ms))
+    {
+        registra_evento(pt_resultado,
+                        debounce_tamper_expiracao_timer(&debounce, nivel_no_instante(pt_cenario, expiracao_timer_ms)),
+                        expiracao_timer_ms);
+    }
+
+    pt_resultado->execucoes = debounce.qtde_bordas + debounce.qtde_expiracoes_timer;
+}
+
+/* Função: simula o debounce por polling (task lê o GPIO periodicamente e
+ *         aceita o nível após TEMPO_DEBOUNCE_MS de leituras iguais)
+ * Parâmetros: - ponteiro para o cenário
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void simula_por_polling(const TCenario_tamper * pt_cenario, TResultado_simulacao * pt_resultado)
+{
+    int nivel_estavel = pt_cenario->nivel_inicial;
+    int nivel_anterior = pt_cenario->nivel_inicial;
+    uint32_t leituras_iguais = 0;
+    uint32_t instante_ms;
+    int nivel;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_simulacao));
+
+    for (instante_ms = 0; instante_ms <= pt_cenario->duracao_ms; instante_ms += PERIODO_POLLING_MS)
+    {
+        pt_resultado->execucoes++;
+        nivel = nivel_no_instante(pt_cenario, instante_ms);
+        leituras_iguais = (nivel == nivel_anterior) ? (leituras_iguais + 1) : 0;
+        nivel_anterior = nivel;
+
+        if ((nivel != nivel_estavel) && (leituras_iguais * PERIODO_POLLING_MS >= TEMPO_DEBOUNCE_MS))
+        {
+            nivel_estavel = nivel;
+            registra_evento(pt_resultado, (nivel == 1) ? EVENTO_TAMPER_ACIONADO : EVENTO_TAMPER_DESFEITO, instante_ms);
+        }
+    }
+}
+
+/* Função: compara os eventos gerados com os esperados
+ * Parâmetros: - ponteiro para o cenário
+ *             - ponteiro para o resultado
+ * Retorno: 1 se iguais, 0 caso contrário
+ */
+static int confere_eventos(const TCenario_tamper * pt_cenario, const TResultado_simulacao * pt_resultado)
+{
+    if (pt_resultado->qtde_eventos != pt_cenario->qtde_eventos_esperados)
+    {
+        return 0;
+    }
+
+    return memcmp(pt_resultado->eventos, pt_cenario->eventos_esperados,
+                  pt_resultado->qtde_eventos * sizeof(int)) == 0;
+}
+
+/* Função: nome de um evento
+ * Parâmetros: evento
+ * Retorno: nome
+ */
+static const char * nome_evento(int evento)
+{
+    return (evento == EVENTO_TAMPER_ACIONADO) ? "acionado" : "desfeito";
+}
+
+int main(void)
+{
+    TResultado_simulacao interrupcao;
+    TResultado_simulacao polling;
+    uint32_t total_interrupcao = 0;
+    uint32_t total_polling = 0;
+    int falhas = 0;
+    size_t c;
+    int i;
+
+    printf("Debounce de %d ms; polling a cada %d ms\n\n", TEMPO_DEBOUNCE_MS, PERIODO_POLLING_MS);
+    printf("%-46s %-6s %-30s %12s %9s\n", "cenario", "result", "eventos (ms)", "interrupcao", "polling");
+
+    for (c = 0; c < sizeof(cenarios) / sizeof(cenarios[0]); c++)
+    {
+        char texto_eventos[64] = "-";
+        int pos = 0;
+
+        simula_por_interrupcao(&cenarios[c], &interrupcao);
+        simula_por_polling(&cenarios[c], &polling);
+
+        for (i = 0; i < interrupcao.qtde_eventos; i++)
+        {
+            pos += snprintf(&texto_eventos[pos], sizeof(texto_eventos) - pos, "%s%s@%u",
+                            (i == 0) ? "" : " ", nome_evento(interrupcao.eventos[i]),
+                            (unsigned)interrupcao.instantes_eventos_ms[i]);
+        }
+
+        if (confere_eventos(&cenarios[c], &interrupcao) == 0)
+        {
+            falhas++;
+        }
+
+        printf("%-46s %-6s %-30s %12u %9u\n", cenarios[c].nome,
+               confere_eventos(&cenarios[c], &interrupcao) ? "OK" : "FALHA",
+               texto_eventos, (unsigned)interrupcao.execucoes, (unsigned)polling.execucoes);
+
+        total_interrupcao += interrupcao.execucoes;
+        total_polling += polling.execucoes;
+    }
+
+    printf("\nExecucoes do software de tamper: %u por interrupcao x %u por polling\n",
+           (unsigned)total_interrupcao, (unsigned)total_polling);
+
+    if (falhas > 0)
+    {
+        printf("%d cenario(s) com eventos diferentes dos esperados\n", falhas);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,251 @@
+/* Ferramenta: simulação da fila de uplinks pendentes (store-and-forward)
+ *
+ * Executa, em tempo virtual, o mesmo código da fila usado no firmware
+ * (fila_uplinks.c) contra um módulo LoRaWAN simulado que recusa envios
+ * segundo um modelo de Gilbert-Elliott (períodos de boa e má cobertura).
+ * Para cada cenário, compara o comportamento sem fila (leitura recusada
+ * é perdida, como antes) com o comportamento com fila.
+ *
+ * Uso: simula_fila_uplinks [semente]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "fila_uplinks.h"
+
+/* Definição - duração da simulação de cada cenário */
+#define TEMPO_SIMULADO_S              (30 * 24 * 3600)  // 30 dias
+
+/* Definição - tamanho máximo do quadro (DR2 em LA915, com dwell time de 400ms) */
+#define TAM_MAX_QUADRO                11
+
+/* Perfil de uma aplicação (o que ela envia e com que frequência) */
+typedef struct
+{
+    const char * nome;
+    uint32_t periodo_leituras_s;
+    int tam_leitura;
+    int max_quadros_por_ciclo;
+}TPerfil_aplicacao;
+
+/* Cenário de cobertura (modelo de Gilbert-Elliott por tentativa de envio) */
+typedef struct
+{
+    const char * nome;
+    double prob_recusa_bom;
+    double prob_recusa_ruim;
+    double prob_bom_para_ruim;
+    double prob_ruim_para_bom;
+}TCenario_cobertura;
+
+/* Resultado de uma simulação */
+typedef struct
+{
+    uint32_t leituras_geradas;
+    uint32_t leituras_entregues;
+    uint32_t leituras_perdidas;
+    uint32_t quadros_enviados;
+    uint32_t tentativas_de_envio;
+    uint64_t bytes_enviados;
+    uint64_t soma_atrasos_s;
+}TResultado_simulacao;
+
+static const TPerfil_aplicacao perfis[] =
+{
+    { "Cap6 (contadores)", 15,   8, 3 },
+    { "Cap7 (lixeira)",    1800, 2, 3 },
+    { "Cap8 (temperatura)", 900, 4, 3 },
+};
+
+static const TCenario_cobertura cenarios[] =
+{
+    { "boa cobertura",        0.01, 0.50, 0.001, 0.20 },
+    { "cobertura marginal",   0.10, 0.90, 0.010, 0.05 },
+    { "quedas longas",        0.02, 1.00, 0.002, 0.01 },
+};
+
+/* Estado do módulo simulado */
+static int modulo_em_estado_ruim = 0;
+
+/* Função: gera número aleatório uniforme em [0, 1)
+ * Parâmetros: nenhum
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+/* Função: simula uma tentativa de envio no módulo LoRaWAN
+ * Parâmetros: cenário de cobertura
+ * Retorno: 1: envio aceito
+ *          0: envio recusado
+ */
+static int modulo_simulado_envia(const TCenario_cobertura * pt_cenario)
+{
+    double prob_recusa;
+
+    if (modulo_em_estado_ruim)
+    {
+        if (aleatorio_uniforme() < pt_cenario->prob_ruim_para_bom)
+        {
+            modulo_em_estado_ruim = 0;
+        }
+    }
+    else
+    {
+        if (aleatorio_uniforme() < pt_cenario->prob_bom_para_ruim)
+        {
+            modulo_em_estado_ruim = 1;
+        }
+    }
+
+    prob_recusa = modulo_em_estado_ruim ? pt_cenario->prob_recusa_ruim : pt_cenario->prob_recusa_bom;
+    return (aleatorio_uniforme() >= prob_recusa);
+}
+
+/* Função: simula uma aplicação sem fila (leitura recusada é perdida)
+ * Parâmetros: perfil da aplicação, cenário de cobertura e ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void simula_sem_fila(const TPerfil_aplicacao * pt_perfil, const TCenario_cobertura * pt_cenario, TResultado_simulacao * pt_resultado)
+{
+    uint32_t instante_s;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_simulacao));
+    modulo_em_estado_ruim = 0;
+
+    for (instante_s = 0; instante_s < TEMPO_SIMULADO_S; instante_s += pt_perfil->periodo_leituras_s)
+    {
+        pt_resultado->leituras_geradas++;
+        pt_resultado->tentativas_de_envio++;
+
+        if (modulo_simulado_envia(pt_cenario))
+        {
+            pt_resultado->leituras_entregues++;
+            pt_resultado->quadros_enviados++;
+            pt_resultado->bytes_enviados += pt_perfil->tam_leitura;
+        }
+        else
+        {
+            pt_resultado->leituras_perdidas++;
+        }
+    }
+}
+
+/* Função: simula uma aplicação com a fila de uplinks pendentes
+ * Parâmetros: perfil da aplicação, cenário de cobertura e ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void simula_com_fila(const TPerfil_aplicacao * pt_perfil, const TCenario_cobertura * pt_cenario, TResultado_simulacao * pt_resultado)
+{
+    static TFila_uplinks fila;
+    uint8_t leitura[FILA_UPLINKS_TAM_MAX_DADOS] = {0};
+    uint8_t quadro[TAM_MAX_QUADRO];
+    uint32_t instantes_leituras[FILA_UPLINKS_QTDE_MAX_REGISTROS];
+    uint32_t instante_s;
+    int tam_quadro;
+    int qtde_registros;
+    int qtde_quadros;
+    int i;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_simulacao));
+    memset(&fila, 0xA5, sizeof(fila));
+    fila_uplinks_inicializa(&fila);
+    modulo_em_estado_ruim = 0;
+
+    for (instante_s = 0; instante_s < TEMPO_SIMULADO_S; instante_s += pt_perfil->periodo_leituras_s)
+    {
+        pt_resultado->leituras_geradas++;
+        memcpy(leitura, &instante_s, sizeof(instante_s));
+        fila_uplinks_insere(&fila, leitura, pt_perfil->tam_leitura, instante_s);
+
+        for (qtde_quadros = 0; qtde_quadros < pt_perfil->max_quadros_por_ciclo; qtde_quadros++)
+        {
+            tam_quadro = fila_uplinks_monta_quadro(&fila, instante_s, quadro, sizeof(quadro), &qtde_registros);
+
+            if (tam_quadro == 0)
+            {
+                break;
+            }
+
+            pt_resultado->tentativas_de_envio++;
+
+            if (!modulo_simulado_envia(pt_cenario))
+            {
+                break;
+            }
+
+            /* Contabiliza atraso de cada leitura entregue (instante da leitura guardado no registro) */
+            for (i = 0; i < qtde_registros; i++)
+            {
+                instantes_leituras[i] = fila.registros[(fila.idx_inicio + i) % FILA_UPLINKS_QTDE_MAX_REGISTROS].instante_s;
+                pt_resultado->soma_atrasos_s += instante_s - instantes_leituras[i];
+            }
+
+            fila_uplinks_confirma_envio(&fila, qtde_registros);
+            pt_resultado->quadros_enviados++;
+            pt_resultado->bytes_enviados += tam_quadro;
+        }
+    }
+
+    pt_resultado->leituras_entregues = fila.total_enviados;
+    pt_resultado->leituras_perdidas = fila.total_descartados;
+}
+
+/* Função: imprime uma linha de resultado
+ * Parâmetros: rótulo e resultado
+ * Retorno: nenhum
+ */
+static void imprime_resultado(const char * pt_rotulo, TResultado_simulacao * pt_resultado)
+{
+    double atraso_medio_min = 0.0;
+
+    if (pt_resultado->leituras_entregues > 0)
+    {
+        atraso_medio_min = (double)pt_resultado->soma_atrasos_s / pt_resultado->leituras_entregues / 60.0;
+    }
+
+    printf("    %-9s entregues: %7.3f%%  perdidas: %7.3f%%  quadros/leitura: %.3f  bytes/leitura entregue: %5.2f  atraso medio: %7.1f min\n",
+           pt_rotulo,
+           100.0 * pt_resultado->leituras_entregues / pt_resultado->leituras_geradas,
+           100.0 * pt_resultado->leituras_perdidas / pt_resultado->leituras_geradas,
+           (double)pt_resultado->quadros_enviados / pt_resultado->leituras_geradas,
+           pt_resultado->leituras_entregues ? (double)pt_resultado->bytes_enviados / pt_resultado->leituras_entregues : 0.0,
+           atraso_medio_min);
+}
+
+int main(int argc, char *argv[])
+{
+    TResultado_simulacao resultado;
+    unsigned int semente = 1;
+    int p, c;
+
+    if (argc > 1)
+    {
+        semente = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    printf("Fila de uplinks: %d registros, quadro maximo de %d bytes, %d dias simulados\n",
+           FILA_UPLINKS_QTDE_MAX_REGISTROS, TAM_MAX_QUADRO, TEMPO_SIMULADO_S / (24 * 3600));
+
+    for (p = 0; p < (int)(sizeof(perfis) / sizeof(perfis[0])); p++)
+    {
+        for (c = 0; c < (int)(sizeof(cenarios) / sizeof(cenarios[0])); c++)
+        {
+            printf("%s - %s\n", perfis[p].nome, cenarios[c].nome);
+
+            srand(semente);
+            simula_sem_fila(&perfis[p], &cenarios[c], &resultado);
+            imprime_resultado("sem fila", &resultado);
+
+            srand(semente);
+            simula_com_fila(&perfis[p], &cenarios[c], &resultado);
+            imprime_resultado("com fila", &resultado);
+        }
+    }
+
+    return 0;
+}
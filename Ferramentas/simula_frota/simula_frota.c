@@ -0,0 +1,1845 @@
+/* Ferramenta: frota virtual de dispositivos dos capítulos 6, 7 e 8
+ *
+ * Executa, em tempo virtual, milhares de instâncias independentes da lógica
+ * de aplicação dos firmwares, com o código dos próprios firmwares onde ele
+ * não depende do ESP-IDF, para gerar tráfego realista para o servidor de
+ * rede (ou o seu substituto) antes de uma implantação:
+ * - cap6 (contador de pulsos): modelo da ISR dos contadores (pulsos com
+ *   debounce de 200 ms), histórico minuto a minuto dos contadores, tarefa
+ *   de envio na grade de fase dos uplinks (a cada 15 s, ou no período que
+ *   o orçamento diário de tempo no ar permite, com -l; o primeiro envio
+ *   leva os contadores absolutos, os seguintes o histórico), agendador de
+ *   uplinks e fila de uplinks pendentes;
+ * - cap7 (lixeira): ciclo de deep sleep de 30 min (mais jitter; o primeiro
+ *   sleep após o boot dura a fase do dispositivo) com a decisão do wake
+ *   stub, rajada de leituras do HC-SR04, sleep adaptativo, lotes de
+ *   leituras e agendador de uplinks;
+ * - cap8 (temperatura): burn-in de 5 min estendido pela fase, uma amostra
+ *   a cada 10 s, janela de 15 min enviada na grade de fase dos uplinks
+ *   como série (se couber no payload do DR) ou resumo, fila de uplinks
+ *   pendentes e agendador de uplinks.
+ * Com -f, os envios seguem o comportamento anterior à fase dos uplinks
+ * (primeiro envio logo após o boot, períodos fixos; no cap6, contadores
+ * absolutos a cada envio), para comparação. Com -l, os agendadores de
+ * uplinks usam o orçamento de fair-use de 30 s/dia (opcional nos
+ * firmwares, que por padrão não têm orçamento).
+ * Cada instância tem o seu DevAddr e o seu gerador de estímulos (pulsos,
+ * enchimento da lixeira, temperatura), semeado pelo DevAddr: a saída é a
+ * mesma com qualquer quantidade de threads.
+ *
+ * Os uplinks emitidos passam por um modelo ALOHA do gateway (todos em DR2,
+ * canal sorteado entre os 8 da sub-banda): um uplink colide se o tempo no
+ * ar dele se sobrepõe ao de outro no mesmo canal. A taxa de colisões é
+ * informada no total, na primeira hora e na pior hora depois dela (o
+ * efeito de um boot simultâneo da frota, -b 0, aparece nessas duas).
+ *
+ * Os dispositivos são divididos entre as threads em partes iguais. O tempo
+ * virtual avança em épocas: em cada época, cada thread executa os eventos
+ * dos seus dispositivos (em ordem de tempo, por um heap) e ordena os
+ * uplinks gerados; a thread principal intercala as saídas das threads e
+ * emite, em ordem de tempo, os uplinks anteriores ao fim da época (um
+ * envio pode terminar depois do fim da época em que começou).
+ *
+ * Cada uplink emitido é uma linha de texto:
+ *   <instante (ms)>,<cap6|cap7|cap8>,<DevAddr em hexadecimal>,<porta>,<payload em hexadecimal>
+ * gravada em arquivo (-o) ou enviada como um datagrama UDP (-u).
+ *
+ * Uso: simula_frota [-d dispositivos por aplicação] [-n dias] [-j threads] [-s semente]
+ *                   [-b janela de boot (s)] [-f] [-l] [-o arquivo | -u host:porta [-x fator de tempo]]
+ *      simula_frota -t
+ * Sem -o e sem -u, os uplinks são só contados (vazão do simulador).
+ * Com -x, a emissão acompanha o tempo virtual acelerado pelo fator.
+ * Retorno: 0 em caso de sucesso (-t: todos os testes passaram), 1 caso contrário
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "Cap7/Software/lixo_lorawan/main/agendador_uplinks/agendador_uplinks.h"
+#include "Cap7/Software/lixo_lorawan/main/fila_uplinks/fila_uplinks.h"
+#include "Cap7/Software/lixo_lorawan/main/lote_leituras/lote_leituras.h"
+#include "Cap7/Software/lixo_lorawan/main/sleep_adaptativo/sleep_adaptativo.h"
+#include "Cap7/Software/lixo_lorawan/main/wake_stub/decisao_wake_stub.h"
+#include "Cap7/Software/lixo_lorawan/main/sensor_ultrassonico/rajada_medicoes.h"
+#include "Cap6/contador_pulsos_lorawan/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/payloads/payloads.h"
+#include "Cap8/Software/medicao_temp/main/serie_temperaturas/serie_temperaturas.h"
+#include "Cap7/Software/lixo_lorawan/main/fase_uplinks/fase_uplinks.h"
+#include "Cap6/contador_pulsos_lorawan/main/historico_pulsos/historico_pulsos.h"
+
+/* Definições - rádio (LoRaWAN.h / lorawan.h dos três projetos) */
+#define PLANO_FREQUENCIAS_LORAWAN           PLANO_LA915
+#define DR_LORAWAN                          2
+#define TAM_MAX_PAYLOAD_LORAWAN             11      //bytes
+#define TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS   5000    //ms
+
+/* Definições - cap6 (envios_lorawan.c e contadores_de_pulsos.c) */
+#define TEMPO_MIN_ENTRE_ENVIOS_CAP6_MS      15000   //ms
+#define TEMPO_DEBOUNCE_PULSOS_MS            200     //ms
+#define QTDE_MAX_QUADROS_POR_CICLO          3
+#define TEMPO_BOOT_CAP6_MS                  6000    // boot e configuração do módulo LoRaWAN
+#define JITTER_MAX_ENVIOS_CAP6_MS           10000   //ms
+#define TEMPO_INTERVALO_HISTORICO_PULSOS_MS 60000   //ms
+#define PORTA_HISTORICO_PULSOS              13
+
+/* Definições - cap7 (lixo_lorawan.c, Kconfig.projbuild e sensor_ultrassonico.c) */
+#define PERIODO_SLEEP_MIN_S                 1800
+#define PERIODO_SLEEP_MAX_S                 21600
+#define DISTANCIA_LIXEIRA_QUASE_CHEIA_CM    30
+#define MAX_DISTANCE_CM                     500
+#define TEMPO_MIN_ENTRE_PULSOS_MS           60
+#define TEMPO_BOOT_CAP7_MS                  1200    // boot completo até o envio do lote
+#define TICKS_WAKE_STUB                     15      // ticks do clock lento gastos no wake stub (~0,46 ms)
+#define PROFUNDIDADE_LIXEIRA_CM             150.0
+#define JITTER_MAX_SLEEP_CAP7_MS            30000   //ms
+
+/* Definições - cap8 (main.c, medicao_temperatura.h e LoRaWAN.h) */
+#define TEMPO_BURN_IN_SENSOR_TEMP_MS        300000  //ms
+#define TEMPO_ENTRE_LEITURAS_TEMPERATURA_MS 10000   //ms
+#define TEMPO_ENTRE_TRANSMISSOES_MS         900000  //ms
+#define QTDE_AMOSTRAS_TEMPERATURA           (TEMPO_ENTRE_TRANSMISSOES_MS / TEMPO_ENTRE_LEITURAS_TEMPERATURA_MS)
+#define PORTA_SERIE_TEMPERATURAS            13
+#define TEMPO_BOOT_CAP8_MS                  8000    // boot e configuração do módulo LoRaWAN
+#define JITTER_MAX_TRANSMISSOES_MS          30000   //ms
+#define PERIODO_TRANSMISSOES_MS             (TEMPO_ENTRE_TRANSMISSOES_MS + JITTER_MAX_TRANSMISSOES_MS)
+
+/* Definições - frota */
+#define QTDE_APLICACOES                     3
+#define APLICACAO_CAP6                      0
+#define APLICACAO_CAP7                      1
+#define APLICACAO_CAP8                      2
+#define DEV_ADDR_BASE                       0x26000000U
+#define BITS_INDICE_DEV_ADDR                20      // DevAddr = base + (aplicação << 20) + índice
+#define QTDE_MAX_DISPOSITIVOS_APLICACAO     ((1 << BITS_INDICE_DEV_ADDR) - 1)
+#define QTDE_DISPOSITIVOS_PADRAO            34000   // por aplicação (102 mil no total)
+#define QTDE_DIAS_PADRAO                    1
+#define JANELA_BOOT_PADRAO_S                3600
+#define SEMENTE_PADRAO                      1
+
+/* Definições - modelo ALOHA do gateway (sub-banda de 8 canais do LA915) */
+#define QTDE_CANAIS_GATEWAY                 8
+#define DURACAO_HORA_MS                     3600000
+
+/* Definições - simulação */
+#define DURACAO_EPOCA_MS                    (15 * 60 * 1000)
+#define QTDE_MAX_THREADS                    64
+#define TAM_MAX_LINHA                       96
+
+/* Definições - testes */
+#define QTDE_DISPOSITIVOS_TESTE             1000
+#define QTDE_DIAS_TESTE                     2
+#define JANELA_BOOT_SIMULTANEO_TESTE_S      0       // queda de energia: frota inteira liga junto
+#define FATOR_MAX_COLISOES_COM_FASE         1.5     // pior hora após o boot simultâneo / regime (com fase)
+#define FATOR_MIN_COLISOES_SEM_FASE         3.0     // pior hora após o boot simultâneo / regime (sem fase)
+
+/* Uplink gerado por um dispositivo virtual */
+typedef struct
+{
+    int64_t instante_ms;
+    uint32_t dev_addr;
+    uint32_t ordem;             // uplinks anteriores do dispositivo (desempate, mesma ordem com qualquer quantidade de threads)
+    uint8_t aplicacao;
+    uint8_t porta;
+    uint8_t tam;
+    uint8_t bytes[TAM_MAX_PAYLOAD_LORAWAN];
+}TUplink_virtual;
+
+/* Estado do cap6: contadores (ISR) e estímulo. Com fase, os pulsos de cada
+ * minuto do histórico vêm de um gerador próprio, guardado no início do
+ * histórico: o histórico (que não cabe na memória de cada dispositivo
+ * virtual) é refeito a cada envio, igual ao que o firmware acumulou.
+ */
+typedef struct
+{
+    uint32_t contadores[2];     // na última leitura (com fase: no início do histórico)
+    double taxas_hz[2];         // pulsos por segundo, em média
+    int64_t instante_contagem_ms;
+    uint64_t estado_pulsos;     // gerador dos pulsos a partir do início do histórico
+    bool envia_contadores_absolutos;
+    TFase_uplinks fase;
+}TEstado_cap6;
+
+/* Estado do cap7: memória RTC do firmware e a lixeira real */
+typedef struct
+{
+    THistorico_distancias historico;
+    TEstado_wake_stub estado_stub;
+    double distancia_cm;        // lixeira real
+    double taxa_cm_h;
+    double distancia_coleta_cm;
+    bool horario_comercial;
+    int64_t instante_nivel_ms;
+    uint32_t qtde_wakes_no_stub;
+    uint32_t periodo_stub_ms;   // período com que o wake stub rearma o timer
+    bool apos_reset;            // próximo boot completo é o do power-on
+}TEstado_cap7;
+
+/* Estado do cap8: estímulo (temperatura ambiente) */
+typedef struct
+{
+    double media_c;
+    double amplitude_c;
+    double fase_rad;
+    double deriva_c;
+    TFase_uplinks fase;
+}TEstado_cap8;
+
+/* Dispositivo virtual */
+typedef struct
+{
+    uint32_t dev_addr;
+    uint8_t aplicacao;
+    uint32_t qtde_uplinks;
+    uint64_t estado_aleatorio;
+    int64_t proximo_evento_ms;
+    TAgendador_uplinks agendador;
+    TFila_uplinks fila;
+    union
+    {
+        TEstado_cap6 cap6;
+        TEstado_cap7 cap7;
+        TEstado_cap8 cap8;
+    }app;
+}TDispositivo_virtual;
+
+/* Uplinks gerados (por thread, por época) */
+typedef struct
+{
+    int qtde;
+    int capacidade;
+    TUplink_virtual * pt_uplinks;
+}TLista_uplinks;
+
+/* Configuração de uma simulação */
+typedef struct
+{
+    int qtde_dispositivos;      // por aplicação
+    int qtde_dias;
+    int qtde_threads;
+    uint64_t semente;
+    int janela_boot_s;
+    bool sem_fase;              // comportamento anterior à fase dos uplinks
+    uint32_t orcamento_diario_ms;   // orçamento de tempo no ar dos agendadores (0: sem orçamento)
+}TConfig_simulacao;
+
+/* Parte da frota executada por uma thread */
+typedef struct
+{
+    const TConfig_simulacao * pt_config;
+    TDispositivo_virtual * pt_dispositivos;
+    int qtde_dispositivos;
+    int * pt_heap;              // índices dos dispositivos, heap pelo próximo evento
+    int64_t fim_epoca_ms;
+    TLista_uplinks uplinks;
+    uint64_t qtde_eventos;
+    bool sem_memoria;
+    THistorico_pulsos historico_cap6;   // histórico refeito no envio do cap6
+}TParte_frota;
+
+/* Uplink no ar num canal do gateway (modelo ALOHA) */
+typedef struct
+{
+    int64_t fim_ms;
+    uint32_t hora;
+    bool colidiu;
+}TUplink_no_ar;
+
+/* Uplinks no ar num canal do gateway */
+typedef struct
+{
+    int qtde;
+    int capacidade;
+    TUplink_no_ar * pt_uplinks;
+}TCanal_gateway;
+
+/* Destino dos uplinks emitidos */
+typedef struct
+{
+    FILE * pt_arquivo;
+    int socket_udp;
+    struct addrinfo * pt_endereco;
+    double fator_tempo;         // > 0: emissão acompanha o tempo virtual
+    double instante_inicio_s;
+
+    /* Contagem e verificação */
+    uint64_t qtde_uplinks[QTDE_APLICACOES];
+    uint64_t qtde_bytes;
+    uint64_t hash;
+    int64_t ultimo_instante_ms;
+    uint64_t qtde_fora_de_ordem;
+    bool verifica;
+    uint32_t * pt_ultimos_contadores;     // cap6: último contador 1 de cada dispositivo
+    uint64_t qtde_invalidos;
+    uint64_t qtde_series;
+    uint64_t qtde_historicos;
+    uint64_t qtde_agrupados;
+
+    /* Colisões (modelo ALOHA do gateway), por hora */
+    TCanal_gateway canais[QTDE_CANAIS_GATEWAY];
+    uint32_t tempos_no_ar_ms[TAM_MAX_PAYLOAD_LORAWAN + 1];
+    uint32_t qtde_horas;
+    uint32_t capacidade_horas;
+    uint64_t * pt_uplinks_hora;
+    uint64_t * pt_colisoes_hora;
+    uint64_t qtde_colisoes;
+}TDestino_uplinks;
+
+/* Resultado de uma simulação */
+typedef struct
+{
+    uint64_t qtde_eventos;
+    uint64_t qtde_adiamentos;
+    uint64_t qtde_descartados;
+    uint64_t qtde_wakes_no_stub;
+    double tempo_simulacao_s;
+    double tempo_emissao_s;
+}TResultado_simulacao;
+
+static const char * nomes_aplicacoes[QTDE_APLICACOES] = { "cap6", "cap7", "cap8" };
+
+/* Função: lê o relógio monotônico
+ * Parâmetros: nenhum
+ * Retorno: instante em segundos
+ */
+static double instante_s(void)
+{
+    struct timespec agora;
+
+    clock_gettime(CLOCK_MONOTONIC, &agora);
+    return agora.tv_sec + (agora.tv_nsec / 1e9);
+}
+
+/* Função: embaralha um valor de 64 bits (splitmix64), para semear os geradores
+ * Parâmetros: valor
+ * Retorno: valor embaralhado
+ */
+static uint64_t embaralha(uint64_t valor)
+{
+    valor += 0x9E3779B97F4A7C15ULL;
+    valor = (valor ^ (valor >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    valor = (valor ^ (valor >> 27)) * 0x94D049BB133111EBULL;
+    return valor ^ (valor >> 31);
+}
+
+/* Função: gera número aleatório uniforme em [0, 1) (xorshift64* do dispositivo)
+ * Parâmetros: ponteiro para o estado do gerador
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(uint64_t * pt_estado)
+{
+    *pt_estado ^= *pt_estado >> 12;
+    *pt_estado ^= *pt_estado << 25;
+    *pt_estado ^= *pt_estado >> 27;
+    return ((*pt_estado * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Função: gera número aleatório uniforme em [min, max)
+ * Parâmetros: - ponteiro para o estado do gerador
+ *             - valores mínimo e máximo
+ * Retorno: número gerado
+ */
+static double aleatorio_faixa(uint64_t * pt_estado, double min, double max)
+{
+    return min + (aleatorio_uniforme(pt_estado) * (max - min));
+}
+
+/* Função: gera número aleatório com distribuição normal padrão (Box-Muller)
+ * Parâmetros: ponteiro para o estado do gerador
+ * Retorno: número gerado
+ */
+static double aleatorio_normal(uint64_t * pt_estado)
+{
+    double u1 = aleatorio_uniforme(pt_estado);
+    double u2 = aleatorio_uniforme(pt_estado);
+
+    return sqrt(-2.0 * log(1.0 - u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* Função: gera número aleatório com distribuição de Poisson (Knuth para
+ *         médias pequenas, aproximação normal para as demais)
+ * Parâmetros: - ponteiro para o estado do gerador
+ *             - média
+ * Retorno: número gerado
+ */
+static uint32_t aleatorio_poisson(uint64_t * pt_estado, double media)
+{
+    double limite;
+    double produto;
+    double valor;
+    uint32_t qtde = 0;
+
+    if (media <= 0.0)
+    {
+        return 0;
+    }
+
+    if (media > 30.0)
+    {
+        valor = floor(media + (sqrt(media) * aleatorio_normal(pt_estado)) + 0.5);
+        return (valor > 0.0) ? (uint32_t)valor : 0;
+    }
+
+    limite = exp(-media);
+    produto = aleatorio_uniforme(pt_estado);
+    while (produto > limite)
+    {
+        qtde++;
+        produto *= aleatorio_uniforme(pt_estado);
+    }
+
+    return qtde;
+}
+
+/* Função: acrescenta um uplink à lista da thread
+ * Parâmetros: - ponteiro para a parte da frota
+ *             - ponteiro para o dispositivo
+ *             - instante (ms), porta, quadro e tamanho
+ * Retorno: nenhum (sem memória, a parte é marcada e o uplink é perdido)
+ */
+static void emite_uplink(TParte_frota * pt_parte, TDispositivo_virtual * pt_dispositivo, int64_t instante_ms, int porta,
+                         const uint8_t * pt_quadro, int tam_quadro)
+{
+    TLista_uplinks * pt_lista = &pt_parte->uplinks;
+    TUplink_virtual * pt_uplink;
+    void * pt_novo;
+
+    if (pt_lista->qtde == pt_lista->capacidade)
+    {
+        pt_novo = realloc(pt_lista->pt_uplinks, ((pt_lista->capacidade > 0) ? (2 * pt_lista->capacidade) : 4096) * sizeof(TUplink_virtual));
+        if (pt_novo == NULL)
+        {
+            pt_parte->sem_memoria = true;
+            return;
+        }
+        pt_lista->pt_uplinks = pt_novo;
+        pt_lista->capacidade = (pt_lista->capacidade > 0) ? (2 * pt_lista->capacidade) : 4096;
+    }
+
+    pt_uplink = &pt_lista->pt_uplinks[pt_lista->qtde++];
+    pt_uplink->instante_ms = instante_ms;
+    pt_uplink->dev_addr = pt_dispositivo->dev_addr;
+    pt_uplink->ordem = pt_dispositivo->qtde_uplinks++;
+    pt_uplink->aplicacao = pt_dispositivo->aplicacao;
+    pt_uplink->porta = (uint8_t)porta;
+    pt_uplink->tam = (uint8_t)tam_quadro;
+    memcpy(pt_uplink->bytes, pt_quadro, tam_quadro);
+}
+
+/* Função: envia um quadro pelo módulo LoRaWAN virtual, como
+ *         envia_mensagem_binaria_lorawan_ABP(): espera curta do agendador é
+ *         aguardada, espera longa (orçamento ou duty cycle) adia o envio
+ * Parâmetros: - ponteiro para a parte da frota
+ *             - ponteiro para o dispositivo
+ *             - ponteiro para o instante (ms; avança com a espera)
+ *             - porta, quadro e tamanho
+ * Retorno: true: uplink feito; false: envio adiado (ou payload inválido no DR)
+ */
+static bool envia_quadro(TParte_frota * pt_parte, TDispositivo_virtual * pt_dispositivo, int64_t * pt_instante_ms, int porta,
+                         const uint8_t * pt_quadro, int tam_quadro)
+{
+    int64_t espera_ms = agendador_uplinks_tempo_ate_liberar_ms(&pt_dispositivo->agendador, *pt_instante_ms, DR_LORAWAN, tam_quadro);
+
+    if (espera_ms < 0)
+    {
+        return false;
+    }
+
+    if (espera_ms > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+    {
+        agendador_uplinks_registra_adiamento(&pt_dispositivo->agendador);
+        return false;
+    }
+
+    *pt_instante_ms += espera_ms;
+    emite_uplink(pt_parte, pt_dispositivo, *pt_instante_ms, porta, pt_quadro, tam_quadro);
+    agendador_uplinks_registra_envio(&pt_dispositivo->agendador, *pt_instante_ms, DR_LORAWAN, tam_quadro);
+    return true;
+}
+
+/* Função: envia os uplinks pendentes na fila (até QTDE_MAX_QUADROS_POR_CICLO quadros),
+ *         como envia_uplinks_pendentes() dos firmwares
+ * Parâmetros: - ponteiro para a parte da frota
+ *             - ponteiro para o dispositivo
+ *             - ponteiro para o instante (ms)
+ *             - porta
+ *             - true: quadros de lote de leituras (cap7); false: quadros da fila
+ * Retorno: nenhum
+ */
+static void envia_uplinks_pendentes(TParte_frota * pt_parte, TDispositivo_virtual * pt_dispositivo, int64_t * pt_instante_ms, int porta,
+                                    bool lote_leituras)
+{
+    uint8_t quadro[TAM_MAX_PAYLOAD_LORAWAN];
+    uint32_t instante_s;
+    int tam_quadro;
+    int qtde_registros;
+    int qtde_quadros;
+
+    for (qtde_quadros = 0; qtde_quadros < QTDE_MAX_QUADROS_POR_CICLO; qtde_quadros++)
+    {
+        instante_s = (uint32_t)(*pt_instante_ms / 1000);
+        tam_quadro = lote_leituras ? lote_leituras_monta_quadro(&pt_dispositivo->fila, instante_s, quadro, sizeof(quadro), &qtde_registros) :
+                                     fila_uplinks_monta_quadro(&pt_dispositivo->fila, instante_s, quadro, sizeof(quadro), &qtde_registros);
+
+        if ((tam_quadro == 0) || (envia_quadro(pt_parte, pt_dispositivo, pt_instante_ms, porta, quadro, tam_quadro) == false))
+        {
+            break;
+        }
+
+        fila_uplinks_confirma_envio(&pt_dispositivo->fila, qtde_registros);
+    }
+}
+
+/* Função: calcula o período da grade de envios do cap6, como calcula_periodo_envios_ms()
+ *         de envios_lorawan.c (tempo mínimo entre envios ou o que o orçamento permite)
+ * Parâmetros: orçamento diário de tempo no ar (ms; 0: sem orçamento)
+ * Retorno: período (ms)
+ */
+static uint32_t periodo_envios_cap6_ms(uint32_t orcamento_diario_ms)
+{
+    uint64_t tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS_LORAWAN, DR_LORAWAN, TAM_MAX_PAYLOAD_LORAWAN);
+    uint64_t periodo_orcamento_ms;
+
+    if (orcamento_diario_ms == AGENDADOR_UPLINKS_SEM_ORCAMENTO)
+    {
+        return TEMPO_MIN_ENTRE_ENVIOS_CAP6_MS;
+    }
+
+    periodo_orcamento_ms = ((tempo_no_ar_us * 86400ULL) / orcamento_diario_ms) + JITTER_MAX_ENVIOS_CAP6_MS;
+
+    return (periodo_orcamento_ms < TEMPO_MIN_ENTRE_ENVIOS_CAP6_MS) ? TEMPO_MIN_ENTRE_ENVIOS_CAP6_MS : (uint32_t)periodo_orcamento_ms;
+}
+
+/* Função: liga um dispositivo (boot): estado inicial do firmware e do estímulo
+ * Parâmetros: - ponteiro para o dispositivo
+ *             - aplicação e índice do dispositivo na aplicação
+ *             - configuração da simulação
+ * Retorno: nenhum
+ */
+static void liga_dispositivo(TDispositivo_virtual * pt_dispositivo, int aplicacao, int indice, const TConfig_simulacao * pt_config)
+{
+    uint64_t * pt_aleatorio = &pt_dispositivo->estado_aleatorio;
+    int64_t instante_boot_ms;
+
+    memset(pt_dispositivo, 0x00, sizeof(TDispositivo_virtual));
+    pt_dispositivo->dev_addr = DEV_ADDR_BASE + ((uint32_t)aplicacao << BITS_INDICE_DEV_ADDR) + (uint32_t)indice;
+    pt_dispositivo->aplicacao = (uint8_t)aplicacao;
+    pt_dispositivo->estado_aleatorio = embaralha(pt_config->semente ^ embaralha(pt_dispositivo->dev_addr)) | 1;
+    instante_boot_ms = (int64_t)(aleatorio_uniforme(pt_aleatorio) * pt_config->janela_boot_s * 1000.0);
+
+    agendador_uplinks_inicializa(&pt_dispositivo->agendador, PLANO_FREQUENCIAS_LORAWAN, pt_config->orcamento_diario_ms, instante_boot_ms);
+    fila_uplinks_inicializa(&pt_dispositivo->fila);
+
+    switch (aplicacao)
+    {
+        case APLICACAO_CAP6:
+            /* Contadores lidos da NVS; medidores de vazão com 0,01 a 0,5 pulso/s em média */
+            pt_dispositivo->app.cap6.contadores[0] = (uint32_t)aleatorio_faixa(pt_aleatorio, 0.0, 1e6);
+            pt_dispositivo->app.cap6.contadores[1] = (uint32_t)aleatorio_faixa(pt_aleatorio, 0.0, 1e5);
+            pt_dispositivo->app.cap6.taxas_hz[0] = aleatorio_faixa(pt_aleatorio, 0.01, 0.5);
+            pt_dispositivo->app.cap6.taxas_hz[1] = pt_dispositivo->app.cap6.taxas_hz[0] * aleatorio_faixa(pt_aleatorio, 0.05, 0.2);
+            pt_dispositivo->app.cap6.instante_contagem_ms = instante_boot_ms;
+            pt_dispositivo->app.cap6.estado_pulsos = embaralha(pt_dispositivo->estado_aleatorio) | 1;
+            pt_dispositivo->app.cap6.envia_contadores_absolutos = true;
+            pt_dispositivo->proximo_evento_ms = instante_boot_ms + TEMPO_BOOT_CAP6_MS;
+
+            /* Tarefa de envio: primeiro envio na fase do dispositivo */
+            if (pt_config->sem_fase == false)
+            {
+                fase_uplinks_inicializa(&pt_dispositivo->app.cap6.fase, pt_dispositivo->dev_addr, periodo_envios_cap6_ms(pt_config->orcamento_diario_ms), JITTER_MAX_ENVIOS_CAP6_MS,
+                                        (uint32_t)embaralha(*pt_aleatorio), pt_dispositivo->proximo_evento_ms);
+                pt_dispositivo->proximo_evento_ms = pt_dispositivo->app.cap6.fase.instante_envio_ms;
+            }
+            break;
+
+        case APLICACAO_CAP7:
+            sleep_adaptativo_inicializa(&pt_dispositivo->app.cap7.historico);
+            decisao_wake_stub_inicializa(&pt_dispositivo->app.cap7.estado_stub, DISTANCIA_LIXEIRA_QUASE_CHEIA_CM);
+            pt_dispositivo->app.cap7.distancia_cm = aleatorio_faixa(pt_aleatorio, 40.0, PROFUNDIDADE_LIXEIRA_CM);
+            pt_dispositivo->app.cap7.taxa_cm_h = aleatorio_faixa(pt_aleatorio, 0.3, 4.0);
+            pt_dispositivo->app.cap7.distancia_coleta_cm = aleatorio_faixa(pt_aleatorio, 10.0, 25.0);
+            pt_dispositivo->app.cap7.horario_comercial = (aleatorio_uniforme(pt_aleatorio) < 0.5);
+            pt_dispositivo->app.cap7.instante_nivel_ms = instante_boot_ms;
+            pt_dispositivo->app.cap7.periodo_stub_ms = PERIODO_SLEEP_MIN_S * 1000;
+            pt_dispositivo->app.cap7.apos_reset = true;
+            pt_dispositivo->proximo_evento_ms = instante_boot_ms;
+            break;
+
+        default:
+            pt_dispositivo->app.cap8.media_c = aleatorio_faixa(pt_aleatorio, -5.0, 30.0);
+            pt_dispositivo->app.cap8.amplitude_c = aleatorio_faixa(pt_aleatorio, 1.0, 8.0);
+            pt_dispositivo->app.cap8.fase_rad = aleatorio_faixa(pt_aleatorio, 0.0, 2.0 * M_PI);
+            pt_dispositivo->proximo_evento_ms = instante_boot_ms + TEMPO_BOOT_CAP8_MS + TEMPO_BURN_IN_SENSOR_TEMP_MS + TEMPO_ENTRE_TRANSMISSOES_MS;
+
+            /* Burn-in estendido pela fase: primeiro envio na fase do dispositivo */
+            if (pt_config->sem_fase == false)
+            {
+                fase_uplinks_inicializa(&pt_dispositivo->app.cap8.fase, pt_dispositivo->dev_addr, PERIODO_TRANSMISSOES_MS, JITTER_MAX_TRANSMISSOES_MS,
+                                        (uint32_t)embaralha(*pt_aleatorio), pt_dispositivo->proximo_evento_ms);
+                pt_dispositivo->proximo_evento_ms = pt_dispositivo->app.cap8.fase.instante_envio_ms;
+            }
+            break;
+    }
+}
+
+/* Função: pulsos contados pela ISR do cap6 num intervalo (consumo com ciclo
+ *         diário; o debounce aceita no máximo um pulso a cada 200 ms)
+ * Parâmetros: - ponteiro para o estado do cap6
+ *             - ponteiro para o gerador aleatório
+ *             - início e duração do intervalo (ms)
+ *             - ponteiro para os contadores (somados aos pulsos do intervalo)
+ * Retorno: nenhum
+ */
+static void conta_pulsos_cap6(const TEstado_cap6 * pt_estado, uint64_t * pt_aleatorio, int64_t inicio_ms, int64_t intervalo_ms,
+                              uint32_t * pt_contadores)
+{
+    double perfil = 1.0 + (0.8 * sin((2.0 * M_PI * (inicio_ms + (intervalo_ms / 2))) / 86400000.0));
+    uint32_t pulsos;
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        pulsos = aleatorio_poisson(pt_aleatorio, pt_estado->taxas_hz[i] * perfil * (intervalo_ms / 1000.0));
+        if (pulsos > (uint64_t)(intervalo_ms / TEMPO_DEBOUNCE_PULSOS_MS))
+        {
+            pulsos = (uint32_t)(intervalo_ms / TEMPO_DEBOUNCE_PULSOS_MS);
+        }
+        pt_contadores[i] += pulsos;
+    }
+}
+
+/* Função: envio do cap6 na grade de fase, como envios_lorawan_task(): refaz
+ *         o histórico minuto a minuto desde o último envio aceito e o envia;
+ *         no primeiro envio (ou com o histórico cheio ou grande demais para
+ *         um quadro), envia os contadores absolutos pela fila de uplinks
+ * Parâmetros: - ponteiro para a parte da frota
+ *             - ponteiro para o dispositivo
+ *             - instante do envio (ms)
+ * Retorno: nenhum
+ */
+static void envia_historico_cap6(TParte_frota * pt_parte, TDispositivo_virtual * pt_dispositivo, int64_t instante_ms)
+{
+    TEstado_cap6 * pt_estado = &pt_dispositivo->app.cap6;
+    THistorico_pulsos * pt_historico = &pt_parte->historico_cap6;
+    TPayload_contadores payload;
+    uint8_t bytes[PAYLOAD_CONTADORES_TAM];
+    uint8_t quadro[TAM_MAX_PAYLOAD_LORAWAN];
+    uint32_t contadores[2] = { pt_estado->contadores[0], pt_estado->contadores[1] };
+    uint64_t estado_pulsos = pt_estado->estado_pulsos;
+    int64_t fim_minuto_ms;
+    int qtde_minutos = 0;
+    int tam_quadro;
+    int passo;
+    bool historico_cheio = false;
+
+    /* Minutos registrados desde o início do histórico */
+    historico_pulsos_inicializa(pt_historico, contadores[0], contadores[1]);
+    for (fim_minuto_ms = pt_estado->instante_contagem_ms + TEMPO_INTERVALO_HISTORICO_PULSOS_MS; fim_minuto_ms <= instante_ms;
+         fim_minuto_ms += TEMPO_INTERVALO_HISTORICO_PULSOS_MS)
+    {
+        conta_pulsos_cap6(pt_estado, &estado_pulsos, fim_minuto_ms - TEMPO_INTERVALO_HISTORICO_PULSOS_MS, TEMPO_INTERVALO_HISTORICO_PULSOS_MS, contadores);
+        historico_cheio |= !historico_pulsos_registra_minuto(pt_historico, contadores[0], contadores[1]);
+        qtde_minutos++;
+    }
+
+    if ((pt_estado->envia_contadores_absolutos == false) && (historico_cheio == false))
+    {
+        tam_quadro = historico_pulsos_codifica(pt_historico, quadro, sizeof(quadro), &passo);
+
+        if (tam_quadro > 0)
+        {
+            /* Adiado: o histórico continua acumulando */
+            if (envia_quadro(pt_parte, pt_dispositivo, &instante_ms, PORTA_HISTORICO_PULSOS, quadro, tam_quadro) == false)
+            {
+                return;
+            }
+
+            /* Aceito: o próximo histórico começa no fim do último minuto registrado */
+            memcpy(pt_estado->contadores, contadores, sizeof(contadores));
+            pt_estado->instante_contagem_ms += (int64_t)qtde_minutos * TEMPO_INTERVALO_HISTORICO_PULSOS_MS;
+            pt_estado->estado_pulsos = estado_pulsos;
+            envia_uplinks_pendentes(pt_parte, pt_dispositivo, &instante_ms, PAYLOAD_CONTADORES_PORTA, false);
+            return;
+        }
+
+        if (qtde_minutos == 0)
+        {
+            return;
+        }
+    }
+
+    /* Contadores absolutos, lidos no instante do envio */
+    conta_pulsos_cap6(pt_estado, &estado_pulsos, pt_estado->instante_contagem_ms + ((int64_t)qtde_minutos * TEMPO_INTERVALO_HISTORICO_PULSOS_MS),
+                      instante_ms - pt_estado->instante_contagem_ms - ((int64_t)qtde_minutos * TEMPO_INTERVALO_HISTORICO_PULSOS_MS), contadores);
+
+    if (agendador_uplinks_tempo_ate_liberar_ms(&pt_dispositivo->agendador, instante_ms, DR_LORAWAN, PAYLOAD_CONTADORES_TAM) > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+    {
+        return;
+    }
+
+    payload.contador_1 = contadores[0];
+    payload.contador_2 = contadores[1];
+    payload_contadores_empacota(&payload, bytes);
+    fila_uplinks_insere(&pt_dispositivo->fila, bytes, sizeof(bytes), (uint32_t)(instante_ms / 1000));
+
+    /* O histórico recomeça nesta leitura */
+    memcpy(pt_estado->contadores, contadores, sizeof(contadores));
+    pt_estado->instante_contagem_ms = instante_ms;
+    pt_estado->estado_pulsos = estado_pulsos;
+    pt_estado->envia_contadores_absolutos = false;
+    envia_uplinks_pendentes(pt_parte, pt_dispositivo, &instante_ms, PAYLOAD_CONTADORES_PORTA, false);
+}
+
+/* Função: evento do cap6: iteração da tarefa de envio (grade de fase dos uplinks; com -f, a cada 15 s)
+ * Parâmetros: - ponteiro para a parte da frota
+ *             - ponteiro para o dispositivo
+ * Retorno: nenhum
+ */
+static void evento_cap6(TParte_frota * pt_parte, TDispositivo_virtual * pt_dispositivo)
+{
+    TEstado_cap6 * pt_estado = &pt_dispositivo->app.cap6;
+    TPayload_contadores payload;
+    uint8_t bytes[PAYLOAD_CONTADORES_TAM];
+    int64_t instante_ms = pt_dispositivo->proximo_evento_ms;
+    int64_t espera_ms;
+
+    if (pt_parte->pt_config->sem_fase == false)
+    {
+        fase_uplinks_avanca(&pt_estado->fase, instante_ms);
+        pt_dispositivo->proximo_evento_ms = pt_estado->fase.instante_envio_ms;
+        envia_historico_cap6(pt_parte, pt_dispositivo, instante_ms);
+        return;
+    }
+
+    /* Sem fase: contadores absolutos a cada 15 s */
+    conta_pulsos_cap6(pt_estado, &pt_dispositivo->estado_aleatorio, pt_estado->instante_contagem_ms, instante_ms - pt_estado->instante_contagem_ms,
+                      pt_estado->contadores);
+    pt_estado->instante_contagem_ms = instante_ms;
+
+    /* Agendador não libera o envio: a leitura não é enfileirada (contadores
+     * cumulativos). As iterações seguintes também não seriam liberadas até a
+     * espera cair para o limite, e o próximo evento já é a primeira liberada.
+     */
+    espera_ms = agendador_uplinks_tempo_ate_liberar_ms(&pt_dispositivo->agendador, instante_ms, DR_LORAWAN, PAYLOAD_CONTADORES_TAM);
+    pt_dispositivo->proximo_evento_ms += TEMPO_MIN_ENTRE_ENVIOS_CAP6_MS;
+    if (espera_ms > TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS)
+    {
+        pt_dispositivo->proximo_evento_ms += TEMPO_MIN_ENTRE_ENVIOS_CAP6_MS *
+                                             ((espera_ms - TEMPO_MAX_ESPERA_ENVIO_LORAWAN_MS - 1) / TEMPO_MIN_ENTRE_ENVIOS_CAP6_MS);
+        return;
+    }
+
+    payload.contador_1 = pt_estado->contadores[0];
+    payload.contador_2 = pt_estado->contadores[1];
+    payload_contadores_empacota(&payload, bytes);
+    fila_uplinks_insere(&pt_dispositivo->fila, bytes, sizeof(bytes), (uint32_t)(instante_ms / 1000));
+    envia_uplinks_pendentes(pt_parte, pt_dispositivo, &instante_ms, PAYLOAD_CONTADORES_PORTA, false);
+
+    if (pt_dispositivo->proximo_evento_ms < instante_ms)
+    {
+        pt_dispositivo->proximo_evento_ms = instante_ms;
+    }
+}
+
+/* Função: rajada de leituras do HC-SR04 do cap7 (eco ausente, eco espúrio e ruído)
+ * Parâmetros: - ponteiro para o dispositivo
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void le_sensor_cap7(TDispositivo_virtual * pt_dispositivo, TResultado_rajada * pt_resultado)
+{
+    uint64_t * pt_aleatorio = &pt_dispositivo->estado_aleatorio;
+    TRajada_medicoes rajada;
+    double sorteio;
+    float distancia_cm;
+    bool leitura_ok;
+    uint32_t tempo_ms = 0;
+
+    rajada_medicoes_inicia(&rajada);
+
+    do
+    {
+        sorteio = aleatorio_uniforme(pt_aleatorio);
+        leitura_ok = (sorteio >= 0.04);
+        distancia_cm = (sorteio < 0.07) ? (float)aleatorio_faixa(pt_aleatorio, 5.0, MAX_DISTANCE_CM) :
+                                          (float)(pt_dispositivo->app.cap7.distancia_cm + (0.4 * aleatorio_normal(pt_aleatorio)));
+        tempo_ms += TEMPO_MIN_ENTRE_PULSOS_MS;
+    } while (rajada_medicoes_registra(&rajada, leitura_ok, distancia_cm, MAX_DISTANCE_CM, tempo_ms) != RAJADA_CONCLUIDA);
+
+    *pt_resultado = *rajada_medicoes_resultado(&rajada);
+}
+
+/* Função: evento do cap7: wake-up pelo timer (wake stub e, se ele decidir, boot completo)
+ * Parâmetros: - ponteiro para a parte da frota
+ *             - ponteiro para o dispositivo
+ * Retorno: nenhum
+ */
+static void evento_cap7(TParte_frota * pt_parte, TDispositivo_virtual * pt_dispositivo)
+{
+    TEstado_cap7 * pt_estado = &pt_dispositivo->app.cap7;
+    TResultado_rajada medicao;
+    uint8_t leitura[LOTE_LEITURAS_TAM_LEITURA];
+    int64_t instante_ms = pt_dispositivo->proximo_evento_ms;
+    uint32_t instante_s = (uint32_t)(instante_ms / 1000);
+    uint32_t periodo_leituras_s;
+    uint32_t wakes_a_pular;
+    uint32_t hora = (uint32_t)((instante_ms / 3600000) % 24);
+    uint32_t dia = (uint32_t)((instante_ms / 86400000) % 7);
+    float distancia_filtrada = 0.0f;
+    bool leitura_feita;
+    bool forca_envio;
+    bool envio_incompleto = false;
+    uint32_t tempo_em_sleep_ms;
+
+    /* Wake-up no stub: o timer é rearmado com o período do último boot completo */
+    pt_dispositivo->proximo_evento_ms += pt_estado->periodo_stub_ms;
+
+    /* Lixeira real: enche no horário de uso e é esvaziada ao chegar à distância de coleta */
+    if ((pt_estado->horario_comercial == false) || ((dia < 5) && (hora >= 8) && (hora < 18)))
+    {
+        pt_estado->distancia_cm -= pt_estado->taxa_cm_h * 2.0 * aleatorio_uniforme(&pt_dispositivo->estado_aleatorio) *
+                                   ((instante_ms - pt_estado->instante_nivel_ms) / 3600000.0);
+    }
+    if (pt_estado->distancia_cm <= pt_estado->distancia_coleta_cm)
+    {
+        pt_estado->distancia_cm = aleatorio_faixa(&pt_dispositivo->estado_aleatorio, PROFUNDIDADE_LIXEIRA_CM - 10.0, PROFUNDIDADE_LIXEIRA_CM);
+    }
+    pt_estado->instante_nivel_ms = instante_ms;
+
+    /* Wake stub: volta a dormir sem boot completo */
+    if (decisao_wake_stub_decide(&pt_estado->estado_stub, true) == DECISAO_WAKE_STUB_VOLTA_A_DORMIR)
+    {
+        decisao_wake_stub_registra_pulo(&pt_estado->estado_stub, TICKS_WAKE_STUB);
+        pt_estado->qtde_wakes_no_stub++;
+        return;
+    }
+
+    /* Boot completo: leitura do sensor entra no lote (fila e histórico na memória RTC) */
+    le_sensor_cap7(pt_dispositivo, &medicao);
+    leitura_feita = (medicao.qualidade != RAJADA_QUALIDADE_FALHA);
+    instante_ms += TEMPO_BOOT_CAP7_MS;
+
+    lote_leituras_monta_registro(leitura_feita ? (int32_t)lroundf(medicao.distancia_cm) : LOTE_LEITURAS_DISTANCIA_NAO_MEDIDA,
+                                 LOTE_LEITURAS_MOTIVO_TIMER, leitura);
+    fila_uplinks_insere(&pt_dispositivo->fila, leitura, sizeof(leitura), instante_s);
+
+    if (leitura_feita == true)
+    {
+        distancia_filtrada = sleep_adaptativo_registra_leitura(&pt_estado->historico, instante_s, medicao.distancia_cm);
+    }
+
+    /* Lixeira quase cheia antecipa o envio do lote */
+    forca_envio = (leitura_feita == true) && (distancia_filtrada <= DISTANCIA_LIXEIRA_QUASE_CHEIA_CM);
+    if (lote_leituras_deve_enviar(&pt_dispositivo->fila, instante_s, forca_envio) == true)
+    {
+        envia_uplinks_pendentes(pt_parte, pt_dispositivo, &instante_ms, LOTE_LEITURAS_PORTA, true);
+        envio_incompleto = (fila_uplinks_quantidade(&pt_dispositivo->fila) > 0);
+    }
+
+    /* Próxima leitura pela taxa de enchimento prevista: o wake stub pula os wake-ups intermediários */
+    periodo_leituras_s = sleep_adaptativo_proximo_periodo_s(&pt_estado->historico, DISTANCIA_LIXEIRA_QUASE_CHEIA_CM,
+                                                            PERIODO_SLEEP_MIN_S, PERIODO_SLEEP_MAX_S);
+    wakes_a_pular = ((periodo_leituras_s + (PERIODO_SLEEP_MIN_S / 2)) / PERIODO_SLEEP_MIN_S) - 1;
+    if (wakes_a_pular > UINT8_MAX)
+    {
+        wakes_a_pular = UINT8_MAX;
+    }
+
+    /* Sleep: a fase do dispositivo depois do power-on; senão, o período mínimo mais o jitter */
+    tempo_em_sleep_ms = PERIODO_SLEEP_MIN_S * 1000;
+    if (pt_parte->pt_config->sem_fase == false)
+    {
+        if (pt_estado->apos_reset == true)
+        {
+            pt_estado->periodo_stub_ms = tempo_em_sleep_ms;
+            tempo_em_sleep_ms = fase_uplinks_deslocamento_ms(pt_dispositivo->dev_addr, tempo_em_sleep_ms);
+        }
+        else
+        {
+            tempo_em_sleep_ms += (uint32_t)(aleatorio_uniforme(&pt_dispositivo->estado_aleatorio) * JITTER_MAX_SLEEP_CAP7_MS);
+            pt_estado->periodo_stub_ms = tempo_em_sleep_ms;
+        }
+    }
+    pt_estado->apos_reset = false;
+    pt_dispositivo->proximo_evento_ms = pt_estado->instante_nivel_ms + tempo_em_sleep_ms;
+
+    decisao_wake_stub_registra_boot_completo(&pt_estado->estado_stub,
+                                             leitura_feita ? decisao_wake_stub_converte_distancia(distancia_filtrada) : DECISAO_WAKE_STUB_DISTANCIA_NAO_MEDIDA,
+                                             envio_incompleto || lote_leituras_deve_enviar(&pt_dispositivo->fila, instante_s, false),
+                                             (uint8_t)wakes_a_pular, (uint64_t)PERIODO_SLEEP_MIN_S * 150000);
+}
+
+/* Função: evento do cap8: fim de uma janela de 15 min (amostras a cada 10 s), na grade de fase dos uplinks
+ * Parâmetros: - ponteiro para a parte da frota
+ *             - ponteiro para o dispositivo
+ * Retorno: nenhum
+ */
+static void evento_cap8(TParte_frota * pt_parte, TDispositivo_virtual * pt_dispositivo)
+{
+    TEstado_cap8 * pt_estado = &pt_dispositivo->app.cap8;
+    TPayload_resumo_temperaturas resumo;
+    int16_t amostras_x10[QTDE_AMOSTRAS_TEMPERATURA];
+    uint8_t resumo_envio[PAYLOAD_RESUMO_TEMPERATURAS_TAM];
+    uint8_t quadro[TAM_MAX_PAYLOAD_LORAWAN];
+    int64_t instante_ms = pt_dispositivo->proximo_evento_ms;
+    int64_t instante_amostra_ms;
+    float media_x10;
+    float variancia_x10 = 0.0f;
+    int tam_max_quadro;
+    int tam_quadro;
+    int passo;
+    int soma = 0;
+    int i;
+
+    /* Amostras da janela: ciclo diário, deriva lenta (um passo por janela, voltando à média) e ruído
+     * do DS18B20 (triangular, ±0,1 °C: 90 normais por janela dominariam o tempo de simulação)
+     */
+    pt_estado->deriva_c = (0.98 * pt_estado->deriva_c) + (0.1 * aleatorio_normal(&pt_dispositivo->estado_aleatorio));
+    for (i = 0; i < QTDE_AMOSTRAS_TEMPERATURA; i++)
+    {
+        instante_amostra_ms = instante_ms - TEMPO_ENTRE_TRANSMISSOES_MS + ((int64_t)(i + 1) * TEMPO_ENTRE_LEITURAS_TEMPERATURA_MS);
+        amostras_x10[i] = (int16_t)lround(10.0 * (pt_estado->media_c + pt_estado->deriva_c +
+                                                  (0.1 * (aleatorio_uniforme(&pt_dispositivo->estado_aleatorio) - aleatorio_uniforme(&pt_dispositivo->estado_aleatorio))) +
+                                                  (pt_estado->amplitude_c * sin(((2.0 * M_PI * instante_amostra_ms) / 86400000.0) + pt_estado->fase_rad))));
+        soma += amostras_x10[i];
+    }
+
+    /* Resumo como medicao_temperatura.c (amostras em 0,1 °C) */
+    resumo.media = (float)soma / (QTDE_AMOSTRAS_TEMPERATURA * 10);
+    resumo.minima = resumo.maxima = amostras_x10[0] / 10.0f;
+    media_x10 = (float)soma / QTDE_AMOSTRAS_TEMPERATURA;
+    for (i = 0; i < QTDE_AMOSTRAS_TEMPERATURA; i++)
+    {
+        resumo.minima = fminf(resumo.minima, amostras_x10[i] / 10.0f);
+        resumo.maxima = fmaxf(resumo.maxima, amostras_x10[i] / 10.0f);
+        variancia_x10 += (amostras_x10[i] - media_x10) * (amostras_x10[i] - media_x10);
+    }
+    resumo.desvio_padrao = sqrtf(variancia_x10 / QTDE_AMOSTRAS_TEMPERATURA) / 10.0f;
+    payload_resumo_temperaturas_empacota(&resumo, resumo_envio);
+
+    /* Série da janela, se couber no payload do DR; senão (ou se o envio for adiado), resumo na fila */
+    tam_max_quadro = agendador_uplinks_payload_maximo(PLANO_FREQUENCIAS_LORAWAN, DR_LORAWAN);
+    if (tam_max_quadro > TAM_MAX_PAYLOAD_LORAWAN)
+    {
+        tam_max_quadro = TAM_MAX_PAYLOAD_LORAWAN;
+    }
+
+    tam_quadro = serie_temperaturas_codifica(amostras_x10, QTDE_AMOSTRAS_TEMPERATURA, quadro, tam_max_quadro, &passo);
+    if ((tam_quadro == 0) || (envia_quadro(pt_parte, pt_dispositivo, &instante_ms, PORTA_SERIE_TEMPERATURAS, quadro, tam_quadro) == false))
+    {
+        fila_uplinks_insere(&pt_dispositivo->fila, resumo_envio, sizeof(resumo_envio), (uint32_t)(instante_ms / 1000));
+    }
+
+    envia_uplinks_pendentes(pt_parte, pt_dispositivo, &instante_ms, PAYLOAD_RESUMO_TEMPERATURAS_PORTA, false);
+
+    /* A próxima janela conta a partir do fim dos envios: o envio seguinte é no
+     * próximo ciclo da grade, desde que o buffer de amostras já esteja cheio
+     */
+    pt_dispositivo->proximo_evento_ms = instante_ms + TEMPO_ENTRE_TRANSMISSOES_MS;
+    if (pt_parte->pt_config->sem_fase == false)
+    {
+        fase_uplinks_avanca(&pt_estado->fase, instante_ms);
+        if (pt_estado->fase.instante_envio_ms > pt_dispositivo->proximo_evento_ms)
+        {
+            pt_dispositivo->proximo_evento_ms = pt_estado->fase.instante_envio_ms;
+        }
+    }
+}
+
+/* Função: compara os próximos eventos de dois dispositivos (desempate pelo DevAddr)
+ * Parâmetros: ponteiros para os dispositivos
+ * Retorno: true: o primeiro vem antes
+ */
+static bool evento_antes(const TDispositivo_virtual * pt_a, const TDispositivo_virtual * pt_b)
+{
+    return (pt_a->proximo_evento_ms < pt_b->proximo_evento_ms) ||
+           ((pt_a->proximo_evento_ms == pt_b->proximo_evento_ms) && (pt_a->dev_addr < pt_b->dev_addr));
+}
+
+/* Função: desce um elemento do heap de eventos até a posição dele
+ * Parâmetros: - ponteiro para a parte da frota
+ *             - posição
+ * Retorno: nenhum
+ */
+static void desce_heap(TParte_frota * pt_parte, int posicao)
+{
+    int * pt_heap = pt_parte->pt_heap;
+    int filho;
+    int troca;
+
+    while ((filho = (2 * posicao) + 1) < pt_parte->qtde_dispositivos)
+    {
+        if ( ((filho + 1) < pt_parte->qtde_dispositivos) &&
+             evento_antes(&pt_parte->pt_dispositivos[pt_heap[filho + 1]], &pt_parte->pt_dispositivos[pt_heap[filho]]) )
+        {
+            filho++;
+        }
+
+        if (!evento_antes(&pt_parte->pt_dispositivos[pt_heap[filho]], &pt_parte->pt_dispositivos[pt_heap[posicao]]))
+        {
+            break;
+        }
+
+        troca = pt_heap[filho];
+        pt_heap[filho] = pt_heap[posicao];
+        pt_heap[posicao] = troca;
+        posicao = filho;
+    }
+}
+
+/* Função: compara dois uplinks pelo instante (desempate por DevAddr e ordem no dispositivo) (qsort)
+ * Parâmetros: ponteiros para os uplinks
+ * Retorno: <0, 0 ou >0
+ */
+static int compara_uplinks(const void * pt_a, const void * pt_b)
+{
+    const TUplink_virtual * pt_uplink_a = (const TUplink_virtual *)pt_a;
+    const TUplink_virtual * pt_uplink_b = (const TUplink_virtual *)pt_b;
+
+    if (pt_uplink_a->instante_ms != pt_uplink_b->instante_ms)
+    {
+        return (pt_uplink_a->instante_ms < pt_uplink_b->instante_ms) ? -1 : 1;
+    }
+
+    if (pt_uplink_a->dev_addr != pt_uplink_b->dev_addr)
+    {
+        return (pt_uplink_a->dev_addr < pt_uplink_b->dev_addr) ? -1 : 1;
+    }
+
+    return (pt_uplink_a->ordem > pt_uplink_b->ordem) - (pt_uplink_a->ordem < pt_uplink_b->ordem);
+}
+
+/* Função: executa uma época da parte da frota de uma thread (eventos anteriores
+ *         ao fim da época, em ordem de tempo) e ordena os uplinks gerados
+ * Parâmetros: ponteiro para a parte da frota
+ * Retorno: NULL
+ */
+static void * executa_parte(void * pt_argumento)
+{
+    TParte_frota * pt_parte = (TParte_frota *)pt_argumento;
+    TDispositivo_virtual * pt_dispositivo;
+
+    pt_parte->uplinks.qtde = 0;
+
+    while ((pt_parte->qtde_dispositivos > 0) && (pt_parte->sem_memoria == false))
+    {
+        pt_dispositivo = &pt_parte->pt_dispositivos[pt_parte->pt_heap[0]];
+
+        if (pt_dispositivo->proximo_evento_ms >= pt_parte->fim_epoca_ms)
+        {
+            break;
+        }
+
+        switch (pt_dispositivo->aplicacao)
+        {
+            case APLICACAO_CAP6:
+                evento_cap6(pt_parte, pt_dispositivo);
+                break;
+
+            case APLICACAO_CAP7:
+                evento_cap7(pt_parte, pt_dispositivo);
+                break;
+
+            default:
+                evento_cap8(pt_parte, pt_dispositivo);
+                break;
+        }
+
+        pt_parte->qtde_eventos++;
+        desce_heap(pt_parte, 0);
+    }
+
+    qsort(pt_parte->uplinks.pt_uplinks, pt_parte->uplinks.qtde, sizeof(TUplink_virtual), compara_uplinks);
+    return NULL;
+}
+
+/* Função: registra um uplink no modelo ALOHA do gateway: ele colide com os uplinks
+ *         do mesmo canal ainda no ar (os uplinks chegam em ordem de tempo)
+ * Parâmetros: - ponteiro para o destino
+ *             - ponteiro para o uplink
+ * Retorno: true: sucesso; false: falta de memória
+ */
+static bool registra_colisoes(TDestino_uplinks * pt_destino, const TUplink_virtual * pt_uplink)
+{
+    TCanal_gateway * pt_canal = &pt_destino->canais[embaralha(((uint64_t)pt_uplink->dev_addr << 32) ^ pt_uplink->ordem) % QTDE_CANAIS_GATEWAY];
+    TUplink_no_ar * pt_no_ar;
+    uint32_t hora = (uint32_t)(pt_uplink->instante_ms / DURACAO_HORA_MS);
+    uint32_t capacidade;
+    bool colidiu = false;
+    void * pt_novo;
+    int i;
+    int j;
+
+    if (pt_destino->tempos_no_ar_ms[pt_uplink->tam] == 0)
+    {
+        pt_destino->tempos_no_ar_ms[pt_uplink->tam] = (agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS_LORAWAN, DR_LORAWAN, pt_uplink->tam) + 999) / 1000;
+    }
+
+    /* Contagem por hora */
+    if (hora >= pt_destino->capacidade_horas)
+    {
+        capacidade = (pt_destino->capacidade_horas > 0) ? (2 * pt_destino->capacidade_horas) : 64;
+        capacidade = (capacidade > hora) ? capacidade : (hora + 1);
+
+        if ((pt_novo = realloc(pt_destino->pt_uplinks_hora, capacidade * sizeof(uint64_t))) == NULL)
+        {
+            return false;
+        }
+        pt_destino->pt_uplinks_hora = pt_novo;
+
+        if ((pt_novo = realloc(pt_destino->pt_colisoes_hora, capacidade * sizeof(uint64_t))) == NULL)
+        {
+            return false;
+        }
+        pt_destino->pt_colisoes_hora = pt_novo;
+
+        memset(&pt_destino->pt_uplinks_hora[pt_destino->capacidade_horas], 0x00, (capacidade - pt_destino->capacidade_horas) * sizeof(uint64_t));
+        memset(&pt_destino->pt_colisoes_hora[pt_destino->capacidade_horas], 0x00, (capacidade - pt_destino->capacidade_horas) * sizeof(uint64_t));
+        pt_destino->capacidade_horas = capacidade;
+    }
+
+    if (hora >= pt_destino->qtde_horas)
+    {
+        pt_destino->qtde_horas = hora + 1;
+    }
+    pt_destino->pt_uplinks_hora[hora]++;
+
+    /* Uplinks que já terminaram saem do canal; os que ainda estão no ar colidem com este */
+    for (i = 0, j = 0; i < pt_canal->qtde; i++)
+    {
+        pt_no_ar = &pt_canal->pt_uplinks[i];
+
+        if (pt_no_ar->fim_ms <= pt_uplink->instante_ms)
+        {
+            continue;
+        }
+
+        if (pt_no_ar->colidiu == false)
+        {
+            pt_no_ar->colidiu = true;
+            pt_destino->pt_colisoes_hora[pt_no_ar->hora]++;
+            pt_destino->qtde_colisoes++;
+        }
+
+        colidiu = true;
+        pt_canal->pt_uplinks[j++] = *pt_no_ar;
+    }
+    pt_canal->qtde = j;
+
+    if (colidiu == true)
+    {
+        pt_destino->pt_colisoes_hora[hora]++;
+        pt_destino->qtde_colisoes++;
+    }
+
+    if (pt_canal->qtde == pt_canal->capacidade)
+    {
+        capacidade = (pt_canal->capacidade > 0) ? (2 * pt_canal->capacidade) : 16;
+        if ((pt_novo = realloc(pt_canal->pt_uplinks, capacidade * sizeof(TUplink_no_ar))) == NULL)
+        {
+            return false;
+        }
+        pt_canal->pt_uplinks = pt_novo;
+        pt_canal->capacidade = (int)capacidade;
+    }
+
+    pt_no_ar = &pt_canal->pt_uplinks[pt_canal->qtde++];
+    pt_no_ar->fim_ms = pt_uplink->instante_ms + pt_destino->tempos_no_ar_ms[pt_uplink->tam];
+    pt_no_ar->hora = hora;
+    pt_no_ar->colidiu = colidiu;
+    return true;
+}
+
+/* Função: registra um uplink no destino: verificação, contagem, hash, colisões e emissão
+ * Parâmetros: - ponteiro para o destino
+ *             - ponteiro para o uplink
+ * Retorno: true: sucesso; false: falha de escrita/envio
+ */
+static bool registra_uplink(TDestino_uplinks * pt_destino, const TUplink_virtual * pt_uplink)
+{
+    static const char digitos_hex[] = "0123456789ABCDEF";
+    TPayload_contadores contadores;
+    TLeitura_lote leituras[FILA_UPLINKS_QTDE_MAX_REGISTROS];
+    int16_t amostras_x10[SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS];
+    THistorico_pulsos_quadro historico;
+    char linha[TAM_MAX_LINHA];
+    struct timespec espera;
+    double adiantamento_s;
+    uint32_t indice;
+    int tam_linha;
+    int passo;
+    int i;
+
+    if (pt_uplink->instante_ms < pt_destino->ultimo_instante_ms)
+    {
+        pt_destino->qtde_fora_de_ordem++;
+    }
+    pt_destino->ultimo_instante_ms = pt_uplink->instante_ms;
+    pt_destino->qtde_uplinks[pt_uplink->aplicacao]++;
+    pt_destino->qtde_bytes += pt_uplink->tam;
+
+    /* FNV-1a dos campos do uplink (comparação entre simulações) */
+    pt_destino->hash = (pt_destino->hash ^ (uint64_t)pt_uplink->instante_ms) * 0x100000001B3ULL;
+    pt_destino->hash = (pt_destino->hash ^ pt_uplink->dev_addr) * 0x100000001B3ULL;
+    pt_destino->hash = (pt_destino->hash ^ pt_uplink->porta) * 0x100000001B3ULL;
+    for (i = 0; i < pt_uplink->tam; i++)
+    {
+        pt_destino->hash = (pt_destino->hash ^ pt_uplink->bytes[i]) * 0x100000001B3ULL;
+    }
+
+    if (registra_colisoes(pt_destino, pt_uplink) == false)
+    {
+        return false;
+    }
+
+    /* Verificação: o payload tem um dos formatos da aplicação */
+    if (pt_destino->verifica)
+    {
+        indice = pt_uplink->dev_addr & ((1U << BITS_INDICE_DEV_ADDR) - 1);
+
+        switch (pt_uplink->aplicacao)
+        {
+            case APLICACAO_CAP6:
+                if ((pt_uplink->porta == PAYLOAD_CONTADORES_PORTA) && (pt_uplink->tam == PAYLOAD_CONTADORES_TAM))
+                {
+                    payload_contadores_desempacota(pt_uplink->bytes, &contadores);
+                    pt_destino->qtde_invalidos += (contadores.contador_1 < pt_destino->pt_ultimos_contadores[indice]);
+                    pt_destino->pt_ultimos_contadores[indice] = contadores.contador_1;
+                }
+                else if (pt_uplink->porta == PORTA_HISTORICO_PULSOS)
+                {
+                    /* O histórico começa onde a leitura anterior (absoluta ou histórico) terminou */
+                    if ( (historico_pulsos_decodifica(pt_uplink->bytes, pt_uplink->tam, &historico) <= 0) ||
+                         (historico.bases[0] != (uint16_t)pt_destino->pt_ultimos_contadores[indice]) )
+                    {
+                        pt_destino->qtde_invalidos++;
+                    }
+                    else
+                    {
+                        for (i = 0; i < historico.qtde_blocos; i++)
+                        {
+                            pt_destino->pt_ultimos_contadores[indice] += historico.somas[0][i];
+                        }
+                    }
+                    pt_destino->qtde_historicos++;
+                }
+                else
+                {
+                    pt_destino->qtde_invalidos += (pt_uplink->porta != PAYLOAD_CONTADORES_PORTA) ||
+                                                  (((pt_uplink->tam - FILA_UPLINKS_TAM_CABECALHO_QUADRO) % (FILA_UPLINKS_TAM_IDADE_REGISTRO + PAYLOAD_CONTADORES_TAM)) != 0);
+                    pt_destino->qtde_agrupados++;
+                }
+                break;
+
+            case APLICACAO_CAP7:
+                pt_destino->qtde_invalidos += (pt_uplink->porta != LOTE_LEITURAS_PORTA) ||
+                                              (lote_leituras_decodifica(pt_uplink->bytes, pt_uplink->tam, leituras, FILA_UPLINKS_QTDE_MAX_REGISTROS) <= 0);
+                break;
+
+            default:
+                if (pt_uplink->porta == PORTA_SERIE_TEMPERATURAS)
+                {
+                    pt_destino->qtde_invalidos += (serie_temperaturas_decodifica(pt_uplink->bytes, pt_uplink->tam, amostras_x10,
+                                                                                 SERIE_TEMPERATURAS_QTDE_MAX_AMOSTRAS, &passo) <= 0);
+                    pt_destino->qtde_series++;
+                }
+                else if (pt_uplink->tam != PAYLOAD_RESUMO_TEMPERATURAS_TAM)
+                {
+                    pt_destino->qtde_invalidos += (pt_uplink->porta != PAYLOAD_RESUMO_TEMPERATURAS_PORTA) ||
+                                                  (((pt_uplink->tam - FILA_UPLINKS_TAM_CABECALHO_QUADRO) % (FILA_UPLINKS_TAM_IDADE_REGISTRO + PAYLOAD_RESUMO_TEMPERATURAS_TAM)) != 0);
+                    pt_destino->qtde_agrupados++;
+                }
+                break;
+        }
+    }
+
+    if ((pt_destino->pt_arquivo == NULL) && (pt_destino->pt_endereco == NULL))
+    {
+        return true;
+    }
+
+    tam_linha = snprintf(linha, sizeof(linha), "%lld,%s,%08X,%u,", (long long)pt_uplink->instante_ms, nomes_aplicacoes[pt_uplink->aplicacao],
+                         pt_uplink->dev_addr, pt_uplink->porta);
+    for (i = 0; i < pt_uplink->tam; i++)
+    {
+        linha[tam_linha++] = digitos_hex[pt_uplink->bytes[i] >> 4];
+        linha[tam_linha++] = digitos_hex[pt_uplink->bytes[i] & 0x0F];
+    }
+
+    if (pt_destino->pt_arquivo != NULL)
+    {
+        linha[tam_linha++] = '\n';
+        return (fwrite(linha, 1, tam_linha, pt_destino->pt_arquivo) == (size_t)tam_linha);
+    }
+
+    /* UDP: com fator de tempo, aguarda o instante virtual do uplink */
+    if (pt_destino->fator_tempo > 0.0)
+    {
+        adiantamento_s = pt_destino->instante_inicio_s + ((pt_uplink->instante_ms / 1000.0) / pt_destino->fator_tempo) - instante_s();
+        if (adiantamento_s > 0.001)
+        {
+            espera.tv_sec = (time_t)adiantamento_s;
+            espera.tv_nsec = (long)((adiantamento_s - espera.tv_sec) * 1e9);
+            nanosleep(&espera, NULL);
+        }
+    }
+
+    return (sendto(pt_destino->socket_udp, linha, tam_linha, 0, pt_destino->pt_endereco->ai_addr, pt_destino->pt_endereco->ai_addrlen) == tam_linha);
+}
+
+/* Função: executa uma simulação da frota
+ * Parâmetros: - ponteiro para a configuração
+ *             - ponteiro para o destino dos uplinks
+ *             - ponteiro para o resultado
+ * Retorno: true: sucesso; false: falta de memória ou falha de emissão
+ */
+static bool simula(const TConfig_simulacao * pt_config, TDestino_uplinks * pt_destino, TResultado_simulacao * pt_resultado)
+{
+    TParte_frota partes[QTDE_MAX_THREADS];
+    pthread_t threads[QTDE_MAX_THREADS];
+    TDispositivo_virtual * pt_dispositivos;
+    TLista_uplinks pendentes = { 0, 0, NULL };
+    TLista_uplinks restantes = { 0, 0, NULL };
+    TLista_uplinks auxiliar;
+    const TUplink_virtual * pt_menor;
+    const int qtde_total = QTDE_APLICACOES * pt_config->qtde_dispositivos;
+    const int64_t fim_ms = (int64_t)pt_config->qtde_dias * 86400000;
+    int posicoes[QTDE_MAX_THREADS + 1];
+    int64_t fim_epoca_ms;
+    int qtde_threads = pt_config->qtde_threads;
+    int origem_menor;
+    int inicio;
+    int fim;
+    bool sucesso = true;
+    double inicio_s;
+    int i;
+    int j;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_simulacao));
+    memset(partes, 0x00, sizeof(partes));
+
+    if ((pt_dispositivos = malloc((size_t)qtde_total * sizeof(TDispositivo_virtual))) == NULL)
+    {
+        return false;
+    }
+
+    /* Dispositivos intercalados entre as aplicações (partes com a mesma mistura) */
+    for (i = 0; i < qtde_total; i++)
+    {
+        liga_dispositivo(&pt_dispositivos[i], i % QTDE_APLICACOES, i / QTDE_APLICACOES, pt_config);
+    }
+
+    /* Partes iguais, cada uma com o heap dos seus eventos */
+    for (i = 0; i < qtde_threads; i++)
+    {
+        inicio = (int)(((int64_t)qtde_total * i) / qtde_threads);
+        fim = (int)(((int64_t)qtde_total * (i + 1)) / qtde_threads);
+        partes[i].pt_config = pt_config;
+        partes[i].pt_dispositivos = &pt_dispositivos[inicio];
+        partes[i].qtde_dispositivos = fim - inicio;
+
+        if ((partes[i].pt_heap = malloc(((size_t)partes[i].qtde_dispositivos + 1) * sizeof(int))) == NULL)
+        {
+            sucesso = false;
+            break;
+        }
+
+        for (j = 0; j < partes[i].qtde_dispositivos; j++)
+        {
+            partes[i].pt_heap[j] = j;
+        }
+
+        for (j = (partes[i].qtde_dispositivos / 2) - 1; j >= 0; j--)
+        {
+            desce_heap(&partes[i], j);
+        }
+    }
+
+    /* Épocas: threads executam os eventos; a principal intercala e emite em ordem */
+    for (fim_epoca_ms = DURACAO_EPOCA_MS; sucesso && ((fim_epoca_ms - DURACAO_EPOCA_MS) < fim_ms); fim_epoca_ms += DURACAO_EPOCA_MS)
+    {
+        if (fim_epoca_ms > fim_ms)
+        {
+            fim_epoca_ms = fim_ms;
+        }
+
+        inicio_s = instante_s();
+        for (i = 0; i < qtde_threads; i++)
+        {
+            partes[i].fim_epoca_ms = fim_epoca_ms;
+        }
+
+        for (i = 1; i < qtde_threads; i++)
+        {
+            if (pthread_create(&threads[i], NULL, executa_parte, &partes[i]) != 0)
+            {
+                executa_parte(&partes[i]);
+                threads[i] = 0;
+            }
+        }
+        executa_parte(&partes[0]);
+        for (i = 1; i < qtde_threads; i++)
+        {
+            if (threads[i] != 0)
+            {
+                pthread_join(threads[i], NULL);
+            }
+        }
+        pt_resultado->tempo_simulacao_s += instante_s() - inicio_s;
+
+        /* Intercalação das saídas das threads e dos pendentes da época anterior */
+        inicio_s = instante_s();
+        memset(posicoes, 0x00, sizeof(posicoes));
+        restantes.qtde = 0;
+
+        while (sucesso)
+        {
+            pt_menor = NULL;
+            origem_menor = -1;
+
+            for (i = 0; i <= qtde_threads; i++)
+            {
+                const TLista_uplinks * pt_lista = (i < qtde_threads) ? &partes[i].uplinks : &pendentes;
+
+                if ( (posicoes[i] < pt_lista->qtde) &&
+                     ((pt_menor == NULL) || (compara_uplinks(&pt_lista->pt_uplinks[posicoes[i]], pt_menor) < 0)) )
+                {
+                    pt_menor = &pt_lista->pt_uplinks[posicoes[i]];
+                    origem_menor = i;
+                }
+            }
+
+            if (pt_menor == NULL)
+            {
+                break;
+            }
+
+            posicoes[origem_menor]++;
+
+            /* Envio que termina depois do fim da época: fica para a próxima intercalação */
+            if ((pt_menor->instante_ms >= fim_epoca_ms) && (fim_epoca_ms < fim_ms))
+            {
+                if (restantes.qtde == restantes.capacidade)
+                {
+                    restantes.capacidade = (restantes.capacidade > 0) ? (2 * restantes.capacidade) : 1024;
+                    auxiliar.pt_uplinks = realloc(restantes.pt_uplinks, restantes.capacidade * sizeof(TUplink_virtual));
+                    if (auxiliar.pt_uplinks == NULL)
+                    {
+                        sucesso = false;
+                        break;
+                    }
+                    restantes.pt_uplinks = auxiliar.pt_uplinks;
+                }
+                restantes.pt_uplinks[restantes.qtde++] = *pt_menor;
+                continue;
+            }
+
+            sucesso = registra_uplink(pt_destino, pt_menor);
+        }
+
+        auxiliar = pendentes;
+        pendentes = restantes;
+        restantes = auxiliar;
+        pt_resultado->tempo_emissao_s += instante_s() - inicio_s;
+
+        for (i = 0; i < qtde_threads; i++)
+        {
+            sucesso &= !partes[i].sem_memoria;
+        }
+    }
+
+    for (i = 0; i < qtde_total; i++)
+    {
+        pt_resultado->qtde_adiamentos += pt_dispositivos[i].agendador.total_adiamentos;
+        pt_resultado->qtde_descartados += pt_dispositivos[i].fila.total_descartados;
+        if (pt_dispositivos[i].aplicacao == APLICACAO_CAP7)
+        {
+            pt_resultado->qtde_wakes_no_stub += pt_dispositivos[i].app.cap7.qtde_wakes_no_stub;
+        }
+    }
+
+    for (i = 0; i < qtde_threads; i++)
+    {
+        pt_resultado->qtde_eventos += partes[i].qtde_eventos;
+        free(partes[i].pt_heap);
+        free(partes[i].uplinks.pt_uplinks);
+    }
+
+    free(pendentes.pt_uplinks);
+    free(restantes.pt_uplinks);
+    free(pt_dispositivos);
+    return sucesso;
+}
+
+/* Função: prepara um destino de uplinks (só contagem, se não houver arquivo nem endereço UDP)
+ * Parâmetros: - ponteiro para o destino
+ *             - nome do arquivo (NULL: nenhum; "-": saída padrão)
+ *             - endereço UDP host:porta (NULL: nenhum)
+ *             - fator de tempo (0: emissão tão rápida quanto possível)
+ *             - quantidade de dispositivos por aplicação (verificação) ou 0 (sem verificação)
+ * Retorno: true: sucesso; false: falha
+ */
+static bool prepara_destino(TDestino_uplinks * pt_destino, const char * pt_nome_arquivo, const char * pt_endereco_udp, double fator_tempo,
+                            int qtde_dispositivos_verificacao)
+{
+    struct addrinfo dicas;
+    char host[256];
+    const char * pt_porta;
+
+    memset(pt_destino, 0x00, sizeof(TDestino_uplinks));
+    pt_destino->hash = 0xCBF29CE484222325ULL;
+    pt_destino->ultimo_instante_ms = INT64_MIN;
+    pt_destino->socket_udp = -1;
+    pt_destino->fator_tempo = fator_tempo;
+    pt_destino->instante_inicio_s = instante_s();
+
+    if (qtde_dispositivos_verificacao > 0)
+    {
+        pt_destino->verifica = true;
+        if ((pt_destino->pt_ultimos_contadores = calloc(qtde_dispositivos_verificacao, sizeof(uint32_t))) == NULL)
+        {
+            return false;
+        }
+    }
+
+    if (pt_nome_arquivo != NULL)
+    {
+        pt_destino->pt_arquivo = (strcmp(pt_nome_arquivo, "-") == 0) ? stdout : fopen(pt_nome_arquivo, "w");
+        return (pt_destino->pt_arquivo != NULL);
+    }
+
+    if (pt_endereco_udp != NULL)
+    {
+        if ( ((pt_porta = strrchr(pt_endereco_udp, ':')) == NULL) || ((size_t)(pt_porta - pt_endereco_udp) >= sizeof(host)) )
+        {
+            return false;
+        }
+
+        memcpy(host, pt_endereco_udp, pt_porta - pt_endereco_udp);
+        host[pt_porta - pt_endereco_udp] = '\0';
+        memset(&dicas, 0x00, sizeof(dicas));
+        dicas.ai_family = AF_UNSPEC;
+        dicas.ai_socktype = SOCK_DGRAM;
+
+        if (getaddrinfo(host, pt_porta + 1, &dicas, &pt_destino->pt_endereco) != 0)
+        {
+            pt_destino->pt_endereco = NULL;
+            return false;
+        }
+
+        pt_destino->socket_udp = socket(pt_destino->pt_endereco->ai_family, pt_destino->pt_endereco->ai_socktype, pt_destino->pt_endereco->ai_protocol);
+        return (pt_destino->socket_udp >= 0);
+    }
+
+    return true;
+}
+
+/* Função: libera um destino de uplinks
+ * Parâmetros: ponteiro para o destino
+ * Retorno: true: sucesso; false: falha ao fechar o arquivo
+ */
+static bool libera_destino(TDestino_uplinks * pt_destino)
+{
+    bool sucesso = true;
+    int i;
+
+    if ((pt_destino->pt_arquivo != NULL) && (pt_destino->pt_arquivo != stdout))
+    {
+        sucesso = (fclose(pt_destino->pt_arquivo) == 0);
+    }
+    else if (pt_destino->pt_arquivo == stdout)
+    {
+        sucesso = (fflush(stdout) == 0);
+    }
+
+    if (pt_destino->socket_udp >= 0)
+    {
+        close(pt_destino->socket_udp);
+    }
+
+    if (pt_destino->pt_endereco != NULL)
+    {
+        freeaddrinfo(pt_destino->pt_endereco);
+    }
+
+    for (i = 0; i < QTDE_CANAIS_GATEWAY; i++)
+    {
+        free(pt_destino->canais[i].pt_uplinks);
+    }
+
+    free(pt_destino->pt_ultimos_contadores);
+    free(pt_destino->pt_uplinks_hora);
+    free(pt_destino->pt_colisoes_hora);
+    return sucesso;
+}
+
+/* Função: calcula a taxa de colisões de um intervalo de horas
+ * Parâmetros: - ponteiro para o destino
+ *             - primeira hora e hora seguinte à última
+ * Retorno: fração dos uplinks do intervalo que colidiram (0 sem uplinks)
+ */
+static double taxa_colisoes(const TDestino_uplinks * pt_destino, uint32_t hora_inicio, uint32_t hora_fim)
+{
+    uint64_t qtde_uplinks = 0;
+    uint64_t qtde_colisoes = 0;
+    uint32_t hora;
+
+    for (hora = hora_inicio; (hora < hora_fim) && (hora < pt_destino->qtde_horas); hora++)
+    {
+        qtde_uplinks += pt_destino->pt_uplinks_hora[hora];
+        qtde_colisoes += pt_destino->pt_colisoes_hora[hora];
+    }
+
+    return (qtde_uplinks > 0) ? ((double)qtde_colisoes / qtde_uplinks) : 0.0;
+}
+
+/* Função: encontra a hora com a maior taxa de colisões depois da primeira hora
+ *         (horas completas da simulação)
+ * Parâmetros: - ponteiro para o destino
+ *             - quantidade de dias simulados
+ *             - ponteiro para a taxa de colisões da hora encontrada
+ * Retorno: hora encontrada
+ */
+static uint32_t pior_hora_colisoes(const TDestino_uplinks * pt_destino, int qtde_dias, double * pt_taxa)
+{
+    uint32_t pior_hora = 1;
+    uint32_t hora;
+    double taxa;
+
+    *pt_taxa = 0.0;
+    for (hora = 1; hora < (uint32_t)(qtde_dias * 24); hora++)
+    {
+        taxa = taxa_colisoes(pt_destino, hora, hora + 1);
+        if (taxa > *pt_taxa)
+        {
+            *pt_taxa = taxa;
+            pior_hora = hora;
+        }
+    }
+
+    return pior_hora;
+}
+
+/* Função: mostra o resumo de uma simulação
+ * Parâmetros: - saída (stdout, ou stderr se os uplinks vão para stdout)
+ *             - ponteiros para a configuração, o destino e o resultado
+ * Retorno: nenhum
+ */
+static void mostra_resultado(FILE * pt_saida, const TConfig_simulacao * pt_config, const TDestino_uplinks * pt_destino, const TResultado_simulacao * pt_resultado)
+{
+    uint64_t qtde_uplinks = pt_destino->qtde_uplinks[APLICACAO_CAP6] + pt_destino->qtde_uplinks[APLICACAO_CAP7] + pt_destino->qtde_uplinks[APLICACAO_CAP8];
+    double tempo_total_s = pt_resultado->tempo_simulacao_s + pt_resultado->tempo_emissao_s;
+    double taxa_pior_hora;
+    uint32_t pior_hora;
+    int i;
+
+    fprintf(pt_saida, "Frota: %d dispositivos (%d por aplicacao), %d dia(s) virtuais, %d thread(s), %s, %s\n",
+            QTDE_APLICACOES * pt_config->qtde_dispositivos, pt_config->qtde_dispositivos, pt_config->qtde_dias, pt_config->qtde_threads,
+            pt_config->sem_fase ? "sem fase dos uplinks" : "com fase dos uplinks",
+            (pt_config->orcamento_diario_ms == AGENDADOR_UPLINKS_SEM_ORCAMENTO) ? "sem orcamento diario" : "com o fair-use de 30 s/dia");
+    for (i = 0; i < QTDE_APLICACOES; i++)
+    {
+        fprintf(pt_saida, "  %s: %10llu uplinks (%.1f por dispositivo por dia)\n", nomes_aplicacoes[i], (unsigned long long)pt_destino->qtde_uplinks[i],
+                (double)pt_destino->qtde_uplinks[i] / pt_config->qtde_dispositivos / pt_config->qtde_dias);
+    }
+    fprintf(pt_saida, "  total: %llu uplinks, %llu bytes de payload, %llu eventos\n", (unsigned long long)qtde_uplinks,
+            (unsigned long long)pt_destino->qtde_bytes, (unsigned long long)pt_resultado->qtde_eventos);
+    fprintf(pt_saida, "  envios adiados pelo agendador: %llu; registros descartados (fila cheia): %llu; wake-ups do cap7 so no wake stub: %llu\n",
+            (unsigned long long)pt_resultado->qtde_adiamentos, (unsigned long long)pt_resultado->qtde_descartados,
+            (unsigned long long)pt_resultado->qtde_wakes_no_stub);
+    pior_hora = pior_hora_colisoes(pt_destino, pt_config->qtde_dias, &taxa_pior_hora);
+    fprintf(pt_saida, "Colisoes (ALOHA, %d canais): %llu (%.2f%%); 1a hora: %.2f%%; pior hora depois dela: %.2f%% (hora %u); regime: %.2f%%\n",
+            QTDE_CANAIS_GATEWAY, (unsigned long long)pt_destino->qtde_colisoes, (qtde_uplinks > 0) ? ((100.0 * pt_destino->qtde_colisoes) / qtde_uplinks) : 0.0,
+            100.0 * taxa_colisoes(pt_destino, 0, 1), 100.0 * taxa_pior_hora, pior_hora,
+            100.0 * taxa_colisoes(pt_destino, 1, (uint32_t)(pt_config->qtde_dias * 24)));
+    fprintf(pt_saida, "Tempo: simulacao %.3f s, intercalacao e emissao %.3f s\n", pt_resultado->tempo_simulacao_s, pt_resultado->tempo_emissao_s);
+    fprintf(pt_saida, "Vazao: %.0f uplinks/s gerados (%.0f na simulacao), %.0f dispositivos-dia/s\n", qtde_uplinks / tempo_total_s,
+            qtde_uplinks / pt_resultado->tempo_simulacao_s, ((double)QTDE_APLICACOES * pt_config->qtde_dispositivos * pt_config->qtde_dias) / tempo_total_s);
+}
+
+/* Função: executa os testes: mesma saída com 1 e com várias threads,
+ *         uplinks em ordem de tempo, payloads nos formatos das aplicações e
+ *         colisões depois de um boot simultâneo da frota no nível do regime
+ *         (boot espalhado) com a fase dos uplinks, e bem acima dele sem ela
+ *         (agendadores com o orçamento de fair-use)
+ * Parâmetros: nenhum
+ * Retorno: 0 se todos os testes passaram, 1 caso contrário
+ */
+static int executa_testes(void)
+{
+    static const int qtdes_threads[] = { 1, 5 };
+    /* Com o fair-use: sem ele, os envios do cap6 a cada 15 s saturam a sub-banda já com a frota de teste */
+    TConfig_simulacao config = { QTDE_DISPOSITIVOS_TESTE, QTDE_DIAS_TESTE, 1, SEMENTE_PADRAO, JANELA_BOOT_PADRAO_S, false, ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS };
+    TDestino_uplinks destinos[2];
+    TResultado_simulacao resultados[2];
+    TDestino_uplinks destino_boot;
+    TResultado_simulacao resultado_boot;
+    double taxa_regime;
+    double taxa_pior_hora;
+    bool sucesso;
+    int falhas = 0;
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        config.qtde_threads = qtdes_threads[i];
+        sucesso = prepara_destino(&destinos[i], NULL, NULL, 0.0, config.qtde_dispositivos) && simula(&config, &destinos[i], &resultados[i]);
+        sucesso = sucesso && (destinos[i].qtde_fora_de_ordem == 0) && (destinos[i].qtde_invalidos == 0);
+
+        printf("%d thread(s): %llu/%llu/%llu uplinks (cap6/cap7/cap8), %llu historicos, %llu series, %llu agrupados, %llu fora de ordem, %llu invalido(s) -> %s\n",
+               qtdes_threads[i], (unsigned long long)destinos[i].qtde_uplinks[APLICACAO_CAP6], (unsigned long long)destinos[i].qtde_uplinks[APLICACAO_CAP7],
+               (unsigned long long)destinos[i].qtde_uplinks[APLICACAO_CAP8], (unsigned long long)destinos[i].qtde_historicos, (unsigned long long)destinos[i].qtde_series,
+               (unsigned long long)destinos[i].qtde_agrupados, (unsigned long long)destinos[i].qtde_fora_de_ordem,
+               (unsigned long long)destinos[i].qtde_invalidos, sucesso ? "OK" : "FALHA");
+        falhas += !sucesso;
+    }
+
+    /* Todas as aplicações geram tráfego, o wake stub pula wake-ups e o agendador adia envios */
+    sucesso = (destinos[0].qtde_uplinks[APLICACAO_CAP6] > 0) && (destinos[0].qtde_uplinks[APLICACAO_CAP7] > 0) &&
+              (destinos[0].qtde_uplinks[APLICACAO_CAP8] > 0) && (resultados[0].qtde_wakes_no_stub > 0) && (resultados[0].qtde_adiamentos > 0);
+    printf("Trafego das tres aplicacoes, wake-ups no stub (%llu) e adiamentos do agendador (%llu) -> %s\n",
+           (unsigned long long)resultados[0].qtde_wakes_no_stub, (unsigned long long)resultados[0].qtde_adiamentos, sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    sucesso = (destinos[0].hash == destinos[1].hash) &&
+              (memcmp(destinos[0].qtde_uplinks, destinos[1].qtde_uplinks, sizeof(destinos[0].qtde_uplinks)) == 0);
+    printf("Mesma saida com %d e %d threads (hash %016llX) -> %s\n", qtdes_threads[0], qtdes_threads[1],
+           (unsigned long long)destinos[0].hash, sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    /* Boot simultâneo (queda de energia): pior hora depois da primeira comparada ao regime do boot espalhado */
+    taxa_regime = taxa_colisoes(&destinos[0], 1, (uint32_t)(config.qtde_dias * 24));
+    config.qtde_threads = 1;
+    config.janela_boot_s = JANELA_BOOT_SIMULTANEO_TESTE_S;
+
+    for (i = 0; i < 2; i++)
+    {
+        config.sem_fase = (i == 1);
+        sucesso = prepara_destino(&destino_boot, NULL, NULL, 0.0, 0) && simula(&config, &destino_boot, &resultado_boot);
+        pior_hora_colisoes(&destino_boot, config.qtde_dias, &taxa_pior_hora);
+        sucesso = sucesso && ((config.sem_fase == false) ? (taxa_pior_hora <= (FATOR_MAX_COLISOES_COM_FASE * taxa_regime)) :
+                                                           (taxa_pior_hora >= (FATOR_MIN_COLISOES_SEM_FASE * taxa_regime)));
+        printf("Boot simultaneo %s fase: colisoes na 1a hora %.2f%%, pior hora depois dela %.2f%% (regime do boot espalhado: %.2f%%) -> %s\n",
+               config.sem_fase ? "sem" : "com", 100.0 * taxa_colisoes(&destino_boot, 0, 1), 100.0 * taxa_pior_hora, 100.0 * taxa_regime,
+               sucesso ? "OK" : "FALHA");
+        falhas += !sucesso;
+        libera_destino(&destino_boot);
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        libera_destino(&destinos[i]);
+    }
+
+    printf("%s\n", (falhas == 0) ? "Todos os testes passaram" : "Houve falhas");
+    return (falhas == 0) ? 0 : 1;
+}
+
+/* Função: ponto de entrada
+ * Parâmetros: ver o cabeçalho do arquivo
+ * Retorno: ver o cabeçalho do arquivo
+ */
+int main(int argc, char * argv[])
+{
+    TConfig_simulacao config = { QTDE_DISPOSITIVOS_PADRAO, QTDE_DIAS_PADRAO, 1, SEMENTE_PADRAO, JANELA_BOOT_PADRAO_S, false, AGENDADOR_UPLINKS_SEM_ORCAMENTO };
+    TDestino_uplinks destino;
+    TResultado_simulacao resultado;
+    const char * pt_nome_arquivo = NULL;
+    const char * pt_endereco_udp = NULL;
+    double fator_tempo = 0.0;
+    bool sucesso;
+    int opcao;
+
+    config.qtde_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opcao = getopt(argc, argv, "td:n:j:s:b:flo:u:x:")) != -1)
+    {
+        switch (opcao)
+        {
+            case 't':
+                return executa_testes();
+
+            case 'd':
+                config.qtde_dispositivos = atoi(optarg);
+                break;
+
+            case 'n':
+                config.qtde_dias = atoi(optarg);
+                break;
+
+            case 'j':
+                config.qtde_threads = atoi(optarg);
+                break;
+
+            case 's':
+                config.semente = strtoull(optarg, NULL, 0);
+                break;
+
+            case 'b':
+                config.janela_boot_s = atoi(optarg);
+                break;
+
+            case 'f':
+                config.sem_fase = true;
+                break;
+
+            case 'l':
+                config.orcamento_diario_ms = ORCAMENTO_FAIR_USE_TEMPO_NO_AR_MS;
+                break;
+
+            case 'o':
+                pt_nome_arquivo = optarg;
+                break;
+
+            case 'u':
+                pt_endereco_udp = optarg;
+                break;
+
+            case 'x':
+                fator_tempo = atof(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Uso: %s [-d dispositivos por aplicacao] [-n dias] [-j threads] [-s semente] [-b janela de boot (s)] [-f] [-l]\n"
+                                "       [-o arquivo | -u host:porta [-x fator de tempo]] | -t\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if ( (config.qtde_dispositivos <= 0) || (config.qtde_dispositivos > QTDE_MAX_DISPOSITIVOS_APLICACAO) || (config.qtde_dias <= 0) ||
+         (config.janela_boot_s < 0) || (fator_tempo < 0.0) || ((pt_nome_arquivo != NULL) && (pt_endereco_udp != NULL)) )
+    {
+        fprintf(stderr, "Parametros invalidos (1 a %d dispositivos por aplicacao; -o ou -u, nao ambos)\n", QTDE_MAX_DISPOSITIVOS_APLICACAO);
+        return 1;
+    }
+
+    config.qtde_threads = (config.qtde_threads < 1) ? 1 : ((config.qtde_threads > QTDE_MAX_THREADS) ? QTDE_MAX_THREADS : config.qtde_threads);
+
+    if (prepara_destino(&destino, pt_nome_arquivo, pt_endereco_udp, fator_tempo, 0) == false)
+    {
+        fprintf(stderr, "Nao foi possivel abrir o destino dos uplinks\n");
+        libera_destino(&destino);
+        return 1;
+    }
+
+    sucesso = simula(&config, &destino, &resultado);
+    mostra_resultado(((pt_nome_arquivo != NULL) && (strcmp(pt_nome_arquivo, "-") == 0)) ? stderr : stdout, &config, &destino, &resultado);
+    sucesso &= libera_destino(&destino);
+
+    if (sucesso == false)
+    {
+        fprintf(stderr, "Falha na simulacao (memoria ou emissao dos uplinks)\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,960 @@
+/* Ferramenta: join OTAA da frota com um módulo LoRaWAN simulado
+ *
+ * Mede o tempo no ar dos join-requests e o tempo até o primeiro uplink de
+ * uma frota que é reiniciada inteira ao mesmo tempo (queda de energia),
+ * com o código de join e de sessão dos firmwares (sessao_lorawan.c), em
+ * quatro estratégias:
+ * - "rejoin a cada boot": sem sessão persistida, join a cada boot, sempre
+ *   no DR2, com novas tentativas a cada 10 s (auto-join do módulo);
+ * - "backoff, DR fixo": sem sessão persistida (primeira instalação ou
+ *   sessão perdida), primeira tentativa sorteada, backoff exponencial com
+ *   jitter e limites de tempo no ar do RP002, sempre no DR2;
+ * - "backoff e degraus de DR": idem, começando no DR5 e descendo até o DR2
+ *   (firmwares);
+ * - "sessão persistida": sessão retomada da memória RTC ou da flash, sem
+ *   join (reboot ou wake-up de deep sleep dos firmwares).
+ *
+ * Módulo e gateway simulados:
+ * - cada dispositivo tem uma SNR média no gateway (sorteada) e cada
+ *   join-request um desvanecimento (normal); o join-request é demodulado
+ *   se a SNR alcançar o limite do SF do DR;
+ * - 8 canais (máscara 00FF:...); join-requests sobrepostos no mesmo canal
+ *   e no mesmo SF colidem (sem captura), e join-requests durante uma
+ *   transmissão do gateway são perdidos (rádio half-duplex);
+ * - o gateway envia o join-accept na RX1 (5 s depois do fim do
+ *   join-request, no mesmo DR) ou, se já estiver transmitindo, na RX2
+ *   (6 s, DR2; o tempo no ar é o do DR2 de uplink, uma aproximação); se
+ *   também estiver ocupado, o join-accept não é enviado e o módulo informa
+ *   a falha (+EVT:JOIN_FAILED_RX_TIMEOUT) 7 s depois do fim do join-request;
+ * - depois do join, o driver lê a sessão (3 comandos AT) e o primeiro
+ *   uplink pode ser feito; com a sessão persistida, o driver a restaura
+ *   no módulo (6 comandos AT).
+ * O tráfego dos uplinks dos dispositivos que já têm sessão não é simulado.
+ *
+ * Uso: simula_join_lorawan [-d dispositivos (lista separada por vírgula)] [-T duração (s)] [-s semente]
+ *      simula_join_lorawan -t
+ * Retorno: 0 em caso de sucesso (-t: todos os testes passaram), 1 caso contrário
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "Cap6/contador_pulsos_lorawan/main/agendador_uplinks/agendador_uplinks.h"
+#include "Cap6/contador_pulsos_lorawan/main/sessao_lorawan/sessao_lorawan.h"
+
+/* Definições - sub-banda dos firmwares (máscara 00FF:0000:..., canais 0 a 7) e DRs do join */
+#define PLANO_FREQUENCIAS                   PLANO_LA915
+#define QTDE_CANAIS                         8
+#define DR_JOIN_INICIAL                     5
+#define DR_JOIN_MINIMO                      2       // LA915: DR0 e DR1 não permitidos (dwell time de 400 ms)
+#define DR_RX2                              2
+
+/* Definições - join-accept (MHDR + AppNonce + NetID + DevAddr + DLSettings + RxDelay + MIC) e janelas de recepção */
+#define TAM_JOIN_ACCEPT                     17      //bytes
+#define ATRASO_RX1_JOIN_MS                  5000    //ms
+#define ATRASO_RX2_JOIN_MS                  6000    //ms
+#define ATRASO_RESULTADO_JOIN_MS            7000    //ms
+
+/* Definições - comportamento do módulo e do driver */
+#define JANELA_BOOT_MS                      2000    //ms, espalhamento natural do boot da frota
+#define TEMPO_CONFIGURACAO_MODULO_MS        6500    //ms, ATZ (5 s) e comandos de configuração
+#define TEMPO_POR_COMANDO_AT_MS             100     //ms
+#define COMANDOS_LEITURA_SESSAO             3       // DADDR, APPSKEY e NWKSKEY
+#define COMANDOS_RESTAURA_SESSAO            6       // NJM, DADDR, APPSKEY, NWKSKEY, FCU e FCD
+#define INTERVALO_AUTO_JOIN_MS              10000   //ms
+
+/* Definições - enlace: SNR média por dispositivo, desvanecimento e limite de demodulação por SF */
+#define SNR_MEDIA_MIN_DB                    -14.0
+#define SNR_MEDIA_MAX_DB                    6.0
+#define DESVIO_DESVANECIMENTO_DB            3.0
+
+/* Definições - testes */
+#define PASSOS_TESTE_RESERVA                200000
+#define DURACAO_TESTE_LIMITES_MS            (35LL * 24LL * 3600LL * 1000LL)
+#define DISPOSITIVOS_TESTE_JOIN             500
+#define PRIMEIRO_UPLINK_MAX_PERSISTIDA_S    10.0
+
+/* Definições - simulação */
+#define QTDE_MAX_DISPOSITIVOS               100000
+#define QTDE_MAX_TAMANHOS                   16
+#define TAM_HISTORICO_CANAL                 8192
+#define TAM_HISTORICO_GATEWAY               8192
+#define DURACAO_PADRAO_S                    3600
+#define SEMENTE_PADRAO                      1
+
+/* Definições - estratégias */
+#define ESTRATEGIA_REJOIN_A_CADA_BOOT       0
+#define ESTRATEGIA_BACKOFF_DR_FIXO          1
+#define ESTRATEGIA_BACKOFF_DEGRAUS_DR       2
+#define ESTRATEGIA_SESSAO_PERSISTIDA        3
+#define QTDE_ESTRATEGIAS                    4
+
+/* Definições - eventos */
+#define EVENTO_TENTATIVA                    0
+#define EVENTO_RESULTADO                    1
+
+/* Estrutura de um evento (heap ordenado pelo instante) */
+typedef struct
+{
+    int64_t instante_ms;
+    int dispositivo;
+    int tipo;
+}TEvento;
+
+/* Estrutura de uma transmissão (join-request ou join-accept) */
+typedef struct
+{
+    int64_t inicio_ms;
+    int64_t fim_ms;
+    int sf;
+}TTransmissao;
+
+/* Estrutura de um histórico circular de transmissões, em ordem de registro */
+typedef struct
+{
+    TTransmissao * pt_transmissoes;
+    int capacidade;
+    int64_t qtde;
+}THistorico_transmissoes;
+
+/* Estrutura de um dispositivo simulado */
+typedef struct
+{
+    double snr_media_db;
+    TJoin_lorawan join;
+    int dr;
+    int canal;
+    int64_t inicio_tx_ms;
+    int64_t fim_tx_ms;
+    int64_t indice_tx;                  // registro do join-request no histórico do canal
+    uint32_t tentativas;
+    uint64_t tempo_no_ar_us;
+    bool com_sessao;
+    int64_t instante_primeiro_uplink_ms;
+}TDispositivo;
+
+/* Estrutura do resultado de uma estratégia */
+typedef struct
+{
+    int qtde_dispositivos;
+    int qtde_com_sessao;
+    double tentativas_por_dispositivo;
+    double tempo_no_ar_total_s;
+    double tempo_no_ar_por_dispositivo_ms;
+    double primeiro_uplink_mediana_s;
+    double primeiro_uplink_p95_s;
+    double primeiro_uplink_max_s;
+}TResultado_join;
+
+static const char * nomes_estrategias[QTDE_ESTRATEGIAS] =
+{
+    "rejoin a cada boot",
+    "backoff, DR fixo",
+    "backoff e degraus de DR",
+    "sessao persistida",
+};
+
+/* Funções locais */
+static uint64_t embaralha(uint64_t valor);
+static double aleatorio_uniforme(uint64_t * pt_estado);
+static double aleatorio_normal(uint64_t * pt_estado);
+static int sf_do_dr(int dr);
+static double limite_snr_db(int sf);
+static void insere_evento(TEvento * pt_heap, int * pt_qtde, TEvento evento);
+static TEvento remove_evento(TEvento * pt_heap, int * pt_qtde);
+static void registra_transmissao(THistorico_transmissoes * pt_historico, int64_t inicio_ms, int64_t fim_ms, int sf);
+static bool ha_sobreposicao(const THistorico_transmissoes * pt_historico, int64_t inicio_ms, int64_t fim_ms, int sf, int64_t janela_ms,
+                            int64_t ignora_indice);
+static int compara_double(const void * pt_a, const void * pt_b);
+static void simula_estrategia(int estrategia, int qtde_dispositivos, int64_t duracao_ms, uint64_t semente, TResultado_join * pt_resultado);
+static void mostra_resultado(int estrategia, const TResultado_join * pt_resultado);
+static int le_lista(const char * pt_texto, int * pt_numeros, int qtde_max);
+static bool testa_formato_hex(void);
+static bool testa_reserva_fcnt(void);
+static bool testa_limites_join(void);
+static int executa_testes(void);
+
+/* Função: embaralha um valor de 64 bits (splitmix64), para semear os geradores
+ * Parâmetros: valor
+ * Retorno: valor embaralhado
+ */
+static uint64_t embaralha(uint64_t valor)
+{
+    valor += 0x9E3779B97F4A7C15ULL;
+    valor = (valor ^ (valor >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    valor = (valor ^ (valor >> 27)) * 0x94D049BB133111EBULL;
+    return valor ^ (valor >> 31);
+}
+
+/* Função: gera número aleatório uniforme em [0, 1) (xorshift64*)
+ * Parâmetros: ponteiro para o estado do gerador
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(uint64_t * pt_estado)
+{
+    *pt_estado ^= *pt_estado >> 12;
+    *pt_estado ^= *pt_estado << 25;
+    *pt_estado ^= *pt_estado >> 27;
+    return ((*pt_estado * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Função: gera número aleatório com distribuição normal padrão (Box-Muller)
+ * Parâmetros: ponteiro para o estado do gerador
+ * Retorno: número gerado
+ */
+static double aleatorio_normal(uint64_t * pt_estado)
+{
+    double u1 = aleatorio_uniforme(pt_estado);
+    double u2 = aleatorio_uniforme(pt_estado);
+
+    return sqrt(-2.0 * log(1.0 - u1)) * cos(2.0 * M_PI * u2);
+}
+
+/* Função: obtém o spreading factor de um DR de uplink (LA915, 125 kHz)
+ * Parâmetros: DR
+ * Retorno: SF
+ */
+static int sf_do_dr(int dr)
+{
+    return 12 - dr;
+}
+
+/* Função: obtém a menor SNR demodulável de um SF
+ * Parâmetros: SF
+ * Retorno: SNR (dB)
+ */
+static double limite_snr_db(int sf)
+{
+    return -7.5 - (2.5 * (sf - 7));
+}
+
+/* Função: insere um evento no heap
+ * Parâmetros: - heap e quantidade de eventos nele
+ *             - evento
+ * Retorno: nenhum
+ */
+static void insere_evento(TEvento * pt_heap, int * pt_qtde, TEvento evento)
+{
+    int i = (*pt_qtde)++;
+    int pai;
+
+    while (i > 0)
+    {
+        pai = (i - 1) / 2;
+
+        if (pt_heap[pai].instante_ms <= evento.instante_ms)
+        {
+            break;
+        }
+
+        pt_heap[i] = pt_heap[pai];
+        i = pai;
+    }
+
+    pt_heap[i] = evento;
+}
+
+/* Função: remove o evento mais antigo do heap
+ * Parâmetros: heap e quantidade de eventos nele (maior que zero)
+ * Retorno: evento removido
+ */
+static TEvento remove_evento(TEvento * pt_heap, int * pt_qtde)
+{
+    TEvento primeiro = pt_heap[0];
+    TEvento ultimo = pt_heap[--(*pt_qtde)];
+    int i = 0;
+    int filho;
+
+    while ((filho = (2 * i) + 1) < *pt_qtde)
+    {
+        if (((filho + 1) < *pt_qtde) && (pt_heap[filho + 1].instante_ms < pt_heap[filho].instante_ms))
+        {
+            filho++;
+        }
+
+        if (ultimo.instante_ms <= pt_heap[filho].instante_ms)
+        {
+            break;
+        }
+
+        pt_heap[i] = pt_heap[filho];
+        i = filho;
+    }
+
+    pt_heap[i] = ultimo;
+    return primeiro;
+}
+
+/* Função: registra uma transmissão no histórico (descarta a mais antiga se cheio)
+ * Parâmetros: - ponteiro para o histórico
+ *             - início, fim e SF da transmissão (SF 0 = gateway)
+ * Retorno: nenhum
+ */
+static void registra_transmissao(THistorico_transmissoes * pt_historico, int64_t inicio_ms, int64_t fim_ms, int sf)
+{
+    TTransmissao * pt_transmissao = &pt_historico->pt_transmissoes[pt_historico->qtde % pt_historico->capacidade];
+
+    pt_transmissao->inicio_ms = inicio_ms;
+    pt_transmissao->fim_ms = fim_ms;
+    pt_transmissao->sf = sf;
+    pt_historico->qtde++;
+}
+
+/* Função: verifica se alguma transmissão do histórico se sobrepõe a um intervalo.
+ *         O histórico é percorrido do registro mais novo para o mais antigo,
+ *         até um registro que começou mais de "janela" antes do intervalo.
+ * Parâmetros: - ponteiro para o histórico
+ *             - início e fim do intervalo
+ *             - SF (0 = qualquer SF)
+ *             - janela (ms): maior diferença entre a ordem de registro e a de início
+ *             - índice de registro a ignorar (a própria transmissão; -1 = nenhum)
+ * Retorno: true: há sobreposição
+ */
+static bool ha_sobreposicao(const THistorico_transmissoes * pt_historico, int64_t inicio_ms, int64_t fim_ms, int sf, int64_t janela_ms,
+                            int64_t ignora_indice)
+{
+    const TTransmissao * pt_transmissao;
+    int64_t i;
+
+    for (i = pt_historico->qtde - 1; (i >= 0) && (i >= (pt_historico->qtde - pt_historico->capacidade)); i--)
+    {
+        pt_transmissao = &pt_historico->pt_transmissoes[i % pt_historico->capacidade];
+
+        if (pt_transmissao->inicio_ms < (inicio_ms - janela_ms))
+        {
+            break;
+        }
+
+        if ( (i != ignora_indice) &&
+             ((sf == 0) || (pt_transmissao->sf == sf)) &&
+             (pt_transmissao->inicio_ms < fim_ms) && (pt_transmissao->fim_ms > inicio_ms) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Função: compara dois doubles (qsort)
+ * Parâmetros: ponteiros para os valores
+ * Retorno: <0, 0 ou >0
+ */
+static int compara_double(const void * pt_a, const void * pt_b)
+{
+    double a = *(const double *)pt_a;
+    double b = *(const double *)pt_b;
+
+    return (a > b) - (a < b);
+}
+
+/* Função: simula o boot simultâneo da frota com uma estratégia de join
+ * Parâmetros: - estratégia (ESTRATEGIA_...)
+ *             - quantidade de dispositivos
+ *             - duração simulada (ms)
+ *             - semente
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void simula_estrategia(int estrategia, int qtde_dispositivos, int64_t duracao_ms, uint64_t semente, TResultado_join * pt_resultado)
+{
+    TDispositivo * pt_dispositivos = calloc(qtde_dispositivos, sizeof(TDispositivo));
+    TEvento * pt_heap = calloc(qtde_dispositivos, sizeof(TEvento));
+    double * pt_tempos_s = calloc(qtde_dispositivos, sizeof(double));
+    THistorico_transmissoes canais[QTDE_CANAIS];
+    THistorico_transmissoes gateway;
+    int64_t janela_join_ms = (sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, DR_JOIN_MINIMO) / 1000) + 1;
+    uint64_t aleatorio = embaralha(semente);
+    uint64_t tentativas_total = 0;
+    uint64_t tempo_no_ar_total_us = 0;
+    int64_t instante_configurado_ms;
+    int64_t inicio_accept_ms;
+    uint32_t tempo_no_ar_us;
+    int qtde_eventos = 0;
+    int qtde_tempos = 0;
+    TDispositivo * pt_dispositivo;
+    TEvento evento;
+    bool recebido;
+    int i;
+
+    for (i = 0; i < QTDE_CANAIS; i++)
+    {
+        canais[i].pt_transmissoes = calloc(TAM_HISTORICO_CANAL, sizeof(TTransmissao));
+        canais[i].capacidade = TAM_HISTORICO_CANAL;
+        canais[i].qtde = 0;
+    }
+
+    gateway.pt_transmissoes = calloc(TAM_HISTORICO_GATEWAY, sizeof(TTransmissao));
+    gateway.capacidade = TAM_HISTORICO_GATEWAY;
+    gateway.qtde = 0;
+
+    /* Boot simultâneo (queda de energia): cada dispositivo termina de configurar o
+     * módulo em instantes próximos e segue a estratégia
+     */
+    for (i = 0; i < qtde_dispositivos; i++)
+    {
+        pt_dispositivo = &pt_dispositivos[i];
+        pt_dispositivo->snr_media_db = SNR_MEDIA_MIN_DB + (aleatorio_uniforme(&aleatorio) * (SNR_MEDIA_MAX_DB - SNR_MEDIA_MIN_DB));
+        instante_configurado_ms = (int64_t)(aleatorio_uniforme(&aleatorio) * JANELA_BOOT_MS) + TEMPO_CONFIGURACAO_MODULO_MS;
+
+        switch (estrategia)
+        {
+            case ESTRATEGIA_REJOIN_A_CADA_BOOT:
+                pt_dispositivo->dr = DR_JOIN_MINIMO;
+                evento.instante_ms = instante_configurado_ms;
+                break;
+
+            case ESTRATEGIA_BACKOFF_DR_FIXO:
+            case ESTRATEGIA_BACKOFF_DEGRAUS_DR:
+                sessao_lorawan_join_inicializa(&pt_dispositivo->join, PLANO_FREQUENCIAS,
+                                               (estrategia == ESTRATEGIA_BACKOFF_DEGRAUS_DR) ? DR_JOIN_INICIAL : DR_JOIN_MINIMO,
+                                               DR_JOIN_MINIMO, (uint32_t)embaralha(semente + i), instante_configurado_ms);
+                evento.instante_ms = instante_configurado_ms + sessao_lorawan_join_tempo_ate_tentativa_ms(&pt_dispositivo->join, instante_configurado_ms);
+                break;
+
+            default:
+                pt_dispositivo->com_sessao = true;
+                pt_dispositivo->instante_primeiro_uplink_ms = instante_configurado_ms + (COMANDOS_RESTAURA_SESSAO * TEMPO_POR_COMANDO_AT_MS);
+                continue;
+        }
+
+        evento.dispositivo = i;
+        evento.tipo = EVENTO_TENTATIVA;
+        insere_evento(pt_heap, &qtde_eventos, evento);
+    }
+
+    while (qtde_eventos > 0)
+    {
+        evento = remove_evento(pt_heap, &qtde_eventos);
+        pt_dispositivo = &pt_dispositivos[evento.dispositivo];
+
+        if (evento.instante_ms > duracao_ms)
+        {
+            continue;
+        }
+
+        if (evento.tipo == EVENTO_TENTATIVA)
+        {
+            /* Join-request: canal sorteado, DR da estratégia */
+            if (estrategia != ESTRATEGIA_REJOIN_A_CADA_BOOT)
+            {
+                pt_dispositivo->dr = sessao_lorawan_join_dr(&pt_dispositivo->join);
+            }
+
+            tempo_no_ar_us = sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, pt_dispositivo->dr);
+            pt_dispositivo->canal = (int)(aleatorio_uniforme(&aleatorio) * QTDE_CANAIS);
+            pt_dispositivo->inicio_tx_ms = evento.instante_ms;
+            pt_dispositivo->fim_tx_ms = evento.instante_ms + ((tempo_no_ar_us + 999) / 1000);
+            pt_dispositivo->tentativas++;
+            pt_dispositivo->tempo_no_ar_us += tempo_no_ar_us;
+            pt_dispositivo->indice_tx = canais[pt_dispositivo->canal].qtde;
+            registra_transmissao(&canais[pt_dispositivo->canal], pt_dispositivo->inicio_tx_ms, pt_dispositivo->fim_tx_ms, sf_do_dr(pt_dispositivo->dr));
+
+            /* O resultado sai depois das duas janelas de recepção: todas as transmissões que
+             * podem interferir no join-request ou no join-accept já foram decididas
+             */
+            evento.instante_ms = pt_dispositivo->fim_tx_ms + ATRASO_RESULTADO_JOIN_MS;
+            evento.tipo = EVENTO_RESULTADO;
+            insere_evento(pt_heap, &qtde_eventos, evento);
+            continue;
+        }
+
+        /* Resultado: demodulação, colisão no canal, gateway transmitindo e join-accept */
+        recebido = ((pt_dispositivo->snr_media_db + (DESVIO_DESVANECIMENTO_DB * aleatorio_normal(&aleatorio))) >= limite_snr_db(sf_do_dr(pt_dispositivo->dr))) &&
+                   (ha_sobreposicao(&canais[pt_dispositivo->canal], pt_dispositivo->inicio_tx_ms, pt_dispositivo->fim_tx_ms,
+                                    sf_do_dr(pt_dispositivo->dr), janela_join_ms, pt_dispositivo->indice_tx) == false) &&
+                   (ha_sobreposicao(&gateway, pt_dispositivo->inicio_tx_ms, pt_dispositivo->fim_tx_ms, 0,
+                                    ATRASO_RESULTADO_JOIN_MS, -1) == false);
+
+        if (recebido == true)
+        {
+            inicio_accept_ms = pt_dispositivo->fim_tx_ms + ATRASO_RX1_JOIN_MS;
+            tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS, pt_dispositivo->dr, TAM_JOIN_ACCEPT - OVERHEAD_PAYLOAD_LORAWAN);
+
+            if (ha_sobreposicao(&gateway, inicio_accept_ms, inicio_accept_ms + (tempo_no_ar_us / 1000) + 1, 0, ATRASO_RESULTADO_JOIN_MS, -1) == true)
+            {
+                inicio_accept_ms = pt_dispositivo->fim_tx_ms + ATRASO_RX2_JOIN_MS;
+                tempo_no_ar_us = agendador_uplinks_tempo_no_ar_us(PLANO_FREQUENCIAS, DR_RX2, TAM_JOIN_ACCEPT - OVERHEAD_PAYLOAD_LORAWAN);
+
+                if (ha_sobreposicao(&gateway, inicio_accept_ms, inicio_accept_ms + (tempo_no_ar_us / 1000) + 1, 0, ATRASO_RESULTADO_JOIN_MS, -1) == true)
+                {
+                    recebido = false;
+                }
+            }
+        }
+
+        if (recebido == true)
+        {
+            registra_transmissao(&gateway, inicio_accept_ms, inicio_accept_ms + (tempo_no_ar_us / 1000) + 1, 0);
+            pt_dispositivo->com_sessao = true;
+            pt_dispositivo->instante_primeiro_uplink_ms = inicio_accept_ms + (tempo_no_ar_us / 1000) + 1 + (COMANDOS_LEITURA_SESSAO * TEMPO_POR_COMANDO_AT_MS);
+
+            if (estrategia != ESTRATEGIA_REJOIN_A_CADA_BOOT)
+            {
+                sessao_lorawan_join_registra_sucesso(&pt_dispositivo->join, evento.instante_ms);
+            }
+
+            continue;
+        }
+
+        /* Falha: próxima tentativa pela estratégia */
+        if (estrategia == ESTRATEGIA_REJOIN_A_CADA_BOOT)
+        {
+            evento.instante_ms += INTERVALO_AUTO_JOIN_MS;
+        }
+        else
+        {
+            sessao_lorawan_join_registra_falha(&pt_dispositivo->join, evento.instante_ms);
+            evento.instante_ms += sessao_lorawan_join_tempo_ate_tentativa_ms(&pt_dispositivo->join, evento.instante_ms);
+        }
+
+        evento.tipo = EVENTO_TENTATIVA;
+        insere_evento(pt_heap, &qtde_eventos, evento);
+    }
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_join));
+    pt_resultado->qtde_dispositivos = qtde_dispositivos;
+
+    for (i = 0; i < qtde_dispositivos; i++)
+    {
+        pt_dispositivo = &pt_dispositivos[i];
+        tentativas_total += pt_dispositivo->tentativas;
+        tempo_no_ar_total_us += pt_dispositivo->tempo_no_ar_us;
+
+        if (pt_dispositivo->com_sessao == true)
+        {
+            pt_resultado->qtde_com_sessao++;
+            pt_tempos_s[qtde_tempos++] = pt_dispositivo->instante_primeiro_uplink_ms / 1000.0;
+        }
+    }
+
+    pt_resultado->tentativas_por_dispositivo = (double)tentativas_total / qtde_dispositivos;
+    pt_resultado->tempo_no_ar_total_s = tempo_no_ar_total_us / 1e6;
+    pt_resultado->tempo_no_ar_por_dispositivo_ms = (tempo_no_ar_total_us / 1e3) / qtde_dispositivos;
+
+    if (qtde_tempos > 0)
+    {
+        qsort(pt_tempos_s, qtde_tempos, sizeof(double), compara_double);
+        pt_resultado->primeiro_uplink_mediana_s = pt_tempos_s[qtde_tempos / 2];
+        pt_resultado->primeiro_uplink_p95_s = pt_tempos_s[(qtde_tempos * 95) / 100];
+        pt_resultado->primeiro_uplink_max_s = pt_tempos_s[qtde_tempos - 1];
+    }
+
+    for (i = 0; i < QTDE_CANAIS; i++)
+    {
+        free(canais[i].pt_transmissoes);
+    }
+
+    free(gateway.pt_transmissoes);
+    free(pt_tempos_s);
+    free(pt_heap);
+    free(pt_dispositivos);
+}
+
+/* Função: mostra o resultado de uma estratégia (uma linha da tabela)
+ * Parâmetros: - estratégia (ESTRATEGIA_...)
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void mostra_resultado(int estrategia, const TResultado_join * pt_resultado)
+{
+    printf("%7d  %-24s %7.1f%% %10.2f %12.1f %14.1f %9.1f %9.1f %9.1f\n", pt_resultado->qtde_dispositivos, nomes_estrategias[estrategia],
+           (100.0 * pt_resultado->qtde_com_sessao) / pt_resultado->qtde_dispositivos, pt_resultado->tentativas_por_dispositivo,
+           pt_resultado->tempo_no_ar_total_s, pt_resultado->tempo_no_ar_por_dispositivo_ms, pt_resultado->primeiro_uplink_mediana_s,
+           pt_resultado->primeiro_uplink_p95_s, pt_resultado->primeiro_uplink_max_s);
+}
+
+/* Função: lê uma lista de números separados por vírgula
+ * Parâmetros: - texto
+ *             - ponteiro para os números
+ *             - quantidade máxima
+ * Retorno: quantidade de números lidos (0 se o texto for inválido)
+ */
+static int le_lista(const char * pt_texto, int * pt_numeros, int qtde_max)
+{
+    char * pt_fim;
+    long numero;
+    int qtde = 0;
+
+    while (qtde < qtde_max)
+    {
+        numero = strtol(pt_texto, &pt_fim, 10);
+        if ((pt_fim == pt_texto) || (numero <= 0) || (numero > QTDE_MAX_DISPOSITIVOS))
+        {
+            return 0;
+        }
+
+        pt_numeros[qtde++] = (int)numero;
+        if (*pt_fim == '\0')
+        {
+            return qtde;
+        }
+        if (*pt_fim != ',')
+        {
+            return 0;
+        }
+        pt_texto = pt_fim + 1;
+    }
+
+    return 0;
+}
+
+/* Função: testa a leitura e a formatação dos campos em hexadecimal dos comandos AT
+ * Parâmetros: nenhum
+ * Retorno: true: teste passou
+ */
+static bool testa_formato_hex(void)
+{
+    const uint8_t dev_addr[SESSAO_LORAWAN_TAM_DEV_ADDR] = { 0x26, 0x0B, 0x12, 0x34 };
+    uint8_t chave[SESSAO_LORAWAN_TAM_CHAVE];
+    uint8_t chave_lida[SESSAO_LORAWAN_TAM_CHAVE];
+    uint8_t lido[SESSAO_LORAWAN_TAM_DEV_ADDR];
+    char texto[SESSAO_LORAWAN_TAM_TEXTO(SESSAO_LORAWAN_TAM_CHAVE)];
+    bool sucesso = true;
+    int i;
+
+    for (i = 0; i < SESSAO_LORAWAN_TAM_CHAVE; i++)
+    {
+        chave[i] = (uint8_t)((i * 37) + 5);
+    }
+
+    sessao_lorawan_formata_hex(chave, SESSAO_LORAWAN_TAM_CHAVE, texto);
+    sucesso &= (strlen(texto) == (sizeof(texto) - 1));
+    sucesso &= sessao_lorawan_le_hex(texto, chave_lida, SESSAO_LORAWAN_TAM_CHAVE) && (memcmp(chave, chave_lida, sizeof(chave)) == 0);
+
+    sessao_lorawan_formata_hex(dev_addr, SESSAO_LORAWAN_TAM_DEV_ADDR, texto);
+    sucesso &= (strcmp(texto, "26:0B:12:34") == 0);
+
+    /* Formatos aceitos: com ou sem separadores, com o comando, com o eco do comando antes e com minúsculas */
+    memset(lido, 0x00, sizeof(lido));
+    sucesso &= sessao_lorawan_le_hex("AT+DADDR=26:0B:12:34", lido, SESSAO_LORAWAN_TAM_DEV_ADDR) && (memcmp(lido, dev_addr, sizeof(lido)) == 0);
+    memset(lido, 0x00, sizeof(lido));
+    sucesso &= sessao_lorawan_le_hex("260B1234\r\n", lido, SESSAO_LORAWAN_TAM_DEV_ADDR) && (memcmp(lido, dev_addr, sizeof(lido)) == 0);
+    memset(lido, 0x00, sizeof(lido));
+    sucesso &= sessao_lorawan_le_hex("AT+DADDR=?\r\n26:0b:12:34\r\n", lido, SESSAO_LORAWAN_TAM_DEV_ADDR) && (memcmp(lido, dev_addr, sizeof(lido)) == 0);
+
+    /* Formatos rejeitados: bytes a menos ou a mais, dígito inválido e resposta vazia */
+    sucesso &= (sessao_lorawan_le_hex("26:0B:12", lido, SESSAO_LORAWAN_TAM_DEV_ADDR) == false);
+    sucesso &= (sessao_lorawan_le_hex("26:0B:12:34:56", lido, SESSAO_LORAWAN_TAM_DEV_ADDR) == false);
+    sucesso &= (sessao_lorawan_le_hex("26:0B:1G:34", lido, SESSAO_LORAWAN_TAM_DEV_ADDR) == false);
+    sucesso &= (sessao_lorawan_le_hex("AT+DADDR=?\r\n", lido, SESSAO_LORAWAN_TAM_DEV_ADDR) == false);
+    sucesso &= (sessao_lorawan_le_hex("", lido, SESSAO_LORAWAN_TAM_DEV_ADDR) == false);
+
+    printf("Campos hexadecimais dos comandos AT (formatacao, leitura, eco e rejeicoes) -> %s\n", sucesso ? "OK" : "FALHA");
+    return sucesso;
+}
+
+/* Função: testa a sessão persistida: integridade (CRC) e contadores de uplink
+ *         nunca repetidos em reboots (memória RTC mantida) e quedas de energia
+ *         (sessão retomada da flash), com poucas gravações na flash
+ * Parâmetros: nenhum
+ * Retorno: true: teste passou
+ */
+static bool testa_reserva_fcnt(void)
+{
+    const uint8_t dev_addr[SESSAO_LORAWAN_TAM_DEV_ADDR] = { 0x26, 0x0B, 0x12, 0x34 };
+    uint8_t chave[SESSAO_LORAWAN_TAM_CHAVE];
+    TSessao_lorawan sessao_rtc;
+    TSessao_lorawan sessao_flash;
+    TSessao_lorawan corrompida;
+    uint64_t aleatorio = embaralha(SEMENTE_PADRAO);
+    uint32_t ultimo_fcnt = 0;
+    uint32_t uplinks = 0;
+    uint32_t quedas = 0;
+    uint32_t reboots = 0;
+    uint32_t gravacoes = 0;
+    uint32_t pulados = 0;
+    bool primeiro_uplink = true;
+    bool sucesso = true;
+    double sorteio;
+    int i;
+
+    memset(chave, 0xA5, sizeof(chave));
+    sessao_lorawan_invalida(&sessao_rtc);
+    sucesso &= (sessao_lorawan_valida(&sessao_rtc) == false);
+
+    sessao_lorawan_inicia(&sessao_rtc, dev_addr, chave, chave);
+    sessao_flash = sessao_rtc;
+    gravacoes++;
+    sucesso &= sessao_lorawan_valida(&sessao_rtc);
+
+    /* Qualquer bit trocado invalida a sessão */
+    for (i = 0; sucesso && (i < (int)(sizeof(TSessao_lorawan) * 8)); i++)
+    {
+        corrompida = sessao_rtc;
+        ((uint8_t *)&corrompida)[i / 8] ^= (uint8_t)(1 << (i % 8));
+        sucesso = (sessao_lorawan_valida(&corrompida) == false);
+    }
+
+    for (i = 0; sucesso && (i < PASSOS_TESTE_RESERVA); i++)
+    {
+        sorteio = aleatorio_uniforme(&aleatorio);
+
+        if (sorteio < 0.01)
+        {
+            /* Queda de energia: memória RTC perdida, sessão retomada da flash e regravada */
+            quedas++;
+            sessao_rtc = sessao_flash;
+            sucesso = sessao_lorawan_valida(&sessao_rtc);
+            sessao_lorawan_retoma_da_flash(&sessao_rtc);
+            pulados += sessao_rtc.fcnt_up - (primeiro_uplink ? 0 : (ultimo_fcnt + 1));
+            sessao_flash = sessao_rtc;
+            gravacoes++;
+        }
+        else if (sorteio < 0.05)
+        {
+            /* Reboot ou wake-up de deep sleep: a memória RTC é mantida */
+            reboots++;
+            sucesso = sessao_lorawan_valida(&sessao_rtc);
+        }
+        else
+        {
+            /* Uplink com o contador atual */
+            sucesso = (primeiro_uplink || (sessao_rtc.fcnt_up > ultimo_fcnt));
+            ultimo_fcnt = sessao_rtc.fcnt_up;
+            primeiro_uplink = false;
+            uplinks++;
+
+            if (sessao_lorawan_registra_uplink(&sessao_rtc) == true)
+            {
+                sessao_flash = sessao_rtc;
+                gravacoes++;
+            }
+        }
+    }
+
+    sucesso &= (gravacoes <= (1 + quedas + (uplinks / SESSAO_LORAWAN_RESERVA_FCNT) + 1));
+    sucesso &= (pulados <= (quedas * SESSAO_LORAWAN_RESERVA_FCNT));
+
+    sessao_rtc.fcnt_up = SESSAO_LORAWAN_FCNT_MAX - 1;
+    sucesso &= (sessao_lorawan_expirou(&sessao_rtc) == false);
+    sessao_lorawan_registra_uplink(&sessao_rtc);
+    sucesso &= sessao_lorawan_expirou(&sessao_rtc);
+
+    printf("Sessao persistida: %u uplinks, %u reboots, %u quedas de energia, %u gravacoes na flash, %u contadores pulados,\n"
+           "  nenhum contador repetido, CRC detecta qualquer bit trocado -> %s\n",
+           uplinks, reboots, quedas, gravacoes, pulados, sucesso ? "OK" : "FALHA");
+    return sucesso;
+}
+
+/* Função: testa o join sem resposta por várias semanas: atraso inicial, degraus
+ *         de DR, backoff e limites de tempo no ar do RP002 por período; e a
+ *         continuidade do estado do join (reboots) e o recomeço depois do sucesso
+ * Parâmetros: nenhum
+ * Retorno: true: teste passou
+ */
+static bool testa_limites_join(void)
+{
+    static const int drs_esperados[] = { 5, 5, 4, 4, 3, 3, 2, 2, 2, 2 };
+    TJoin_lorawan join;
+    TJoin_lorawan copia;
+    uint64_t tempo_no_ar_periodo_us[64];
+    uint64_t limite_us;
+    int64_t instante_ms = 5000;
+    int64_t tentativa_ms;
+    int64_t anterior_ms = 0;
+    int64_t decorrido_ms;
+    uint32_t tentativas = 0;
+    uint32_t tentativas_primeira_hora = 0;
+    int periodo;
+    int periodo_max = 0;
+    bool sucesso = true;
+
+    memset(tempo_no_ar_periodo_us, 0x00, sizeof(tempo_no_ar_periodo_us));
+    memset(&join, 0x00, sizeof(join));
+    sessao_lorawan_join_inicializa(&join, PLANO_FREQUENCIAS, DR_JOIN_INICIAL, DR_JOIN_MINIMO, 1234, instante_ms);
+    sucesso &= (sessao_lorawan_join_tempo_ate_tentativa_ms(&join, instante_ms) <= SESSAO_LORAWAN_JOIN_ATRASO_INICIAL_MAX_MS);
+
+    while (sucesso)
+    {
+        tentativa_ms = instante_ms + sessao_lorawan_join_tempo_ate_tentativa_ms(&join, instante_ms);
+        decorrido_ms = tentativa_ms - 5000;
+
+        if (decorrido_ms >= DURACAO_TESTE_LIMITES_MS)
+        {
+            break;
+        }
+
+        if (tentativas < (sizeof(drs_esperados) / sizeof(drs_esperados[0])))
+        {
+            sucesso &= (sessao_lorawan_join_dr(&join) == drs_esperados[tentativas]);
+        }
+
+        /* Intervalo mínimo entre tentativas: a espera base (metade fixa) */
+        sucesso &= ((tentativas == 0) || ((tentativa_ms - anterior_ms) >= (SESSAO_LORAWAN_JOIN_ESPERA_BASE_MS / 2)));
+
+        periodo = (decorrido_ms < 3600000LL) ? 0 : ((decorrido_ms < 39600000LL) ? 1 : (2 + (int)((decorrido_ms - 39600000LL) / 86400000LL)));
+        tempo_no_ar_periodo_us[periodo] += sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, sessao_lorawan_join_dr(&join));
+        periodo_max = periodo;
+        tentativas_primeira_hora += (periodo == 0);
+        tentativas++;
+        anterior_ms = tentativa_ms;
+
+        /* Reboot durante o backoff: o estado (em memória RTC) é mantido */
+        if ((tentativas % 7) == 0)
+        {
+            copia = join;
+            sessao_lorawan_join_inicializa(&join, PLANO_FREQUENCIAS, DR_JOIN_INICIAL, DR_JOIN_MINIMO, 99, tentativa_ms);
+            sucesso &= (memcmp(&copia, &join, sizeof(join)) == 0);
+        }
+
+        /* Sem join-accept: falha informada 7 s depois */
+        instante_ms = tentativa_ms + ATRASO_RESULTADO_JOIN_MS;
+        sessao_lorawan_join_registra_falha(&join, instante_ms);
+    }
+
+    for (periodo = 0; periodo <= periodo_max; periodo++)
+    {
+        limite_us = (periodo < 2) ? 36000000ULL : 8700000ULL;
+        sucesso &= (tempo_no_ar_periodo_us[periodo] <= limite_us);
+    }
+
+    sucesso &= (join.total_tentativas == tentativas);
+    sucesso &= (periodo_max >= 30);
+
+    printf("Join sem resposta por %lld dias: %u tentativas (%u na primeira hora), DRs 5,5,4,4,3,3,2..., tempo no ar %.1f s na\n"
+           "  primeira hora, %.1f s nas 10 h seguintes e ate %.2f s por dia depois (limites 36/36/8,7 s) -> %s\n",
+           DURACAO_TESTE_LIMITES_MS / 86400000LL, tentativas, tentativas_primeira_hora, tempo_no_ar_periodo_us[0] / 1e6,
+           tempo_no_ar_periodo_us[1] / 1e6, tempo_no_ar_periodo_us[2] / 1e6, sucesso ? "OK" : "FALHA");
+
+    /* Sucesso encerra o join; o próximo recomeça no DR inicial, com novo atraso sorteado */
+    sessao_lorawan_join_registra_sucesso(&join, instante_ms);
+    sucesso &= (join.em_andamento == false) && (join.total_tentativas == (tentativas + 1));
+    sessao_lorawan_join_inicializa(&join, PLANO_FREQUENCIAS, DR_JOIN_INICIAL, DR_JOIN_MINIMO, 99, instante_ms);
+    sucesso &= (join.em_andamento == true) && (join.total_tentativas == 0) && (sessao_lorawan_join_dr(&join) == DR_JOIN_INICIAL);
+    sucesso &= (sessao_lorawan_join_tempo_ate_tentativa_ms(&join, instante_ms) <= SESSAO_LORAWAN_JOIN_ATRASO_INICIAL_MAX_MS);
+
+    /* Outra configuração de DR também recomeça o join */
+    copia = join;
+    sessao_lorawan_join_inicializa(&join, PLANO_FREQUENCIAS, DR_JOIN_MINIMO, DR_JOIN_MINIMO, 99, instante_ms);
+    sucesso &= (join.dr_inicial == DR_JOIN_MINIMO) && (copia.dr_inicial == DR_JOIN_INICIAL);
+
+    printf("Estado do join mantido em reboots, recomecado depois do sucesso e com outra configuracao -> %s\n", sucesso ? "OK" : "FALHA");
+    return sucesso;
+}
+
+/* Função: executa os testes do módulo de sessão e das estratégias de join
+ * Parâmetros: nenhum
+ * Retorno: 0 se todos os testes passaram, 1 caso contrário
+ */
+static int executa_testes(void)
+{
+    TResultado_join resultados[QTDE_ESTRATEGIAS];
+    bool sucesso;
+    int falhas = 0;
+    int estrategia;
+
+    falhas += !testa_formato_hex();
+    falhas += !testa_reserva_fcnt();
+    falhas += !testa_limites_join();
+
+    for (estrategia = 0; estrategia < QTDE_ESTRATEGIAS; estrategia++)
+    {
+        simula_estrategia(estrategia, DISPOSITIVOS_TESTE_JOIN, DURACAO_PADRAO_S * 1000LL, SEMENTE_PADRAO, &resultados[estrategia]);
+    }
+
+    /* Tempo no ar do join-request: 23 bytes no DR2 (SF10) e no DR5 (SF7) */
+    sucesso = (sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, 2) == 370688) && (sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, 5) == 61696);
+    printf("Tempo no ar do join-request: %.1f ms no DR2, %.1f ms no DR5 -> %s\n", sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, 2) / 1e3,
+           sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, 5) / 1e3, sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    /* Tempestade de joins: o backoff conecta quase toda a frota com menos tempo no ar que o rejoin a cada 10 s */
+    sucesso = (resultados[ESTRATEGIA_BACKOFF_DEGRAUS_DR].qtde_com_sessao >= ((DISPOSITIVOS_TESTE_JOIN * 99) / 100)) &&
+              (resultados[ESTRATEGIA_BACKOFF_DEGRAUS_DR].tempo_no_ar_por_dispositivo_ms < resultados[ESTRATEGIA_REJOIN_A_CADA_BOOT].tempo_no_ar_por_dispositivo_ms) &&
+              (resultados[ESTRATEGIA_BACKOFF_DR_FIXO].tempo_no_ar_por_dispositivo_ms < resultados[ESTRATEGIA_REJOIN_A_CADA_BOOT].tempo_no_ar_por_dispositivo_ms);
+    printf("%d dispositivos: com sessao %.1f%% (backoff e degraus de DR) x %.1f%% (rejoin a cada boot); tempo no ar por dispositivo\n"
+           "  %.1f ms x %.1f ms -> %s\n", DISPOSITIVOS_TESTE_JOIN,
+           (100.0 * resultados[ESTRATEGIA_BACKOFF_DEGRAUS_DR].qtde_com_sessao) / DISPOSITIVOS_TESTE_JOIN,
+           (100.0 * resultados[ESTRATEGIA_REJOIN_A_CADA_BOOT].qtde_com_sessao) / DISPOSITIVOS_TESTE_JOIN,
+           resultados[ESTRATEGIA_BACKOFF_DEGRAUS_DR].tempo_no_ar_por_dispositivo_ms, resultados[ESTRATEGIA_REJOIN_A_CADA_BOOT].tempo_no_ar_por_dispositivo_ms,
+           sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    /* Degraus de DR: join-requests mais curtos que no DR fixo */
+    sucesso = (resultados[ESTRATEGIA_BACKOFF_DEGRAUS_DR].tempo_no_ar_por_dispositivo_ms < resultados[ESTRATEGIA_BACKOFF_DR_FIXO].tempo_no_ar_por_dispositivo_ms);
+    printf("Degraus de DR: tempo no ar por dispositivo %.1f ms x %.1f ms (DR fixo) -> %s\n",
+           resultados[ESTRATEGIA_BACKOFF_DEGRAUS_DR].tempo_no_ar_por_dispositivo_ms, resultados[ESTRATEGIA_BACKOFF_DR_FIXO].tempo_no_ar_por_dispositivo_ms,
+           sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    /* Sessão persistida: nenhum join e primeiro uplink logo depois do boot */
+    sucesso = (resultados[ESTRATEGIA_SESSAO_PERSISTIDA].qtde_com_sessao == DISPOSITIVOS_TESTE_JOIN) &&
+              (resultados[ESTRATEGIA_SESSAO_PERSISTIDA].tentativas_por_dispositivo == 0.0) &&
+              (resultados[ESTRATEGIA_SESSAO_PERSISTIDA].primeiro_uplink_max_s <= PRIMEIRO_UPLINK_MAX_PERSISTIDA_S) &&
+              (resultados[ESTRATEGIA_SESSAO_PERSISTIDA].primeiro_uplink_p95_s < resultados[ESTRATEGIA_BACKOFF_DEGRAUS_DR].primeiro_uplink_p95_s);
+    printf("Sessao persistida: nenhum join, primeiro uplink em ate %.1f s (p95 %.1f s x %.1f s com join) -> %s\n",
+           resultados[ESTRATEGIA_SESSAO_PERSISTIDA].primeiro_uplink_max_s, resultados[ESTRATEGIA_SESSAO_PERSISTIDA].primeiro_uplink_p95_s,
+           resultados[ESTRATEGIA_BACKOFF_DEGRAUS_DR].primeiro_uplink_p95_s, sucesso ? "OK" : "FALHA");
+    falhas += !sucesso;
+
+    printf("%s\n", (falhas == 0) ? "Todos os testes passaram" : "Houve falhas");
+    return (falhas == 0) ? 0 : 1;
+}
+
+/* Função: ponto de entrada
+ * Parâmetros: ver o cabeçalho do arquivo
+ * Retorno: ver o cabeçalho do arquivo
+ */
+int main(int argc, char * argv[])
+{
+    TResultado_join resultado;
+    int tamanhos[QTDE_MAX_TAMANHOS] = { 100, 500, 2000 };
+    int qtde_tamanhos = 3;
+    double duracao_s = DURACAO_PADRAO_S;
+    uint64_t semente = SEMENTE_PADRAO;
+    int estrategia;
+    int opcao;
+    int i;
+
+    while ((opcao = getopt(argc, argv, "td:T:s:")) != -1)
+    {
+        switch (opcao)
+        {
+            case 't':
+                return executa_testes();
+
+            case 'd':
+                qtde_tamanhos = le_lista(optarg, tamanhos, QTDE_MAX_TAMANHOS);
+                break;
+
+            case 'T':
+                duracao_s = atof(optarg);
+                break;
+
+            case 's':
+                semente = strtoull(optarg, NULL, 0);
+                break;
+
+            default:
+                fprintf(stderr, "Uso: %s [-d dispositivos] [-T duracao (s)] [-s semente] | -t\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if ((qtde_tamanhos == 0) || (duracao_s <= 0.0))
+    {
+        fprintf(stderr, "Parametros invalidos\n");
+        return 1;
+    }
+
+    printf("Boot simultaneo da frota, %.0f s simulados (join-request: %.1f ms no DR2, %.1f ms no DR5)\n", duracao_s,
+           sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, 2) / 1e3, sessao_lorawan_join_tempo_no_ar_us(PLANO_FREQUENCIAS, 5) / 1e3);
+    printf("   disp  estrategia               sessao  tentativas  no ar total  no ar por disp   1o uplink (s)\n");
+    printf("                                           por disp          (s)            (ms)   mediana       p95       max\n");
+
+    for (i = 0; i < qtde_tamanhos; i++)
+    {
+        for (estrategia = 0; estrategia < QTDE_ESTRATEGIAS; estrategia++)
+        {
+            simula_estrategia(estrategia, tamanhos[i], (int64_t)(duracao_s * 1000.0), semente, &resultado);
+            mostra_resultado(estrategia, &resultado);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,265 @@
+/* Ferramenta: simulação da rajada de medições do sensor ultrassônico (Cap7)
+ *
+ * Executa, em tempo virtual, o mesmo código da rajada de medições usado no
+ * firmware (rajada_medicoes.c) contra modelos do HC-SR04 com ruído, falhas
+ * de eco, ecos espúrios e mudança de nível durante a rajada. Para cada
+ * cenário, mostra a distribuição de qualidade dos resultados, o erro em
+ * relação à distância real, as leituras por resultado e o tempo com o
+ * sensor ligado, comparando com a leitura anterior (buffer de média móvel
+ * de 100 leituras, preenchido a cada boot com uma leitura a cada 100 ms).
+ * Mostra também o tempo de CPU ocupada por leitura com cada forma de medir
+ * o eco: ultrasonic_measure() (espera ocupada do trigger ao fim do eco) e
+ * captura por hardware do MCPWM (apenas trigger e ISRs das bordas).
+ *
+ * Uso: simula_rajada_sensor
+ * Retorno: 0 se todos os cenários ficaram dentro do tempo máximo da rajada
+ *          e sem falhas onde o sensor responde; 1 caso contrário
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "rajada_medicoes.h"
+
+/* Definições - parâmetros do firmware (sensor_ultrassonico.c) */
+#define MAX_DISTANCE_CM               500
+#define TEMPO_MIN_ENTRE_PULSOS_MS     60
+
+/* Definições - leitura anterior (buffer de média móvel) */
+#define TAM_BUFFER_DISTANCIAS         100
+#define TEMPO_ENTRE_LEITURAS_MS       100
+
+/* Definições - modelo do HC-SR04 */
+#define VELOCIDADE_SOM_CM_MS          34.3
+#define TEMPO_ECO_SEM_OBSTACULO_MS    38.0    // eco em nível alto quando nenhum eco volta
+#define TEMPO_INICIO_ECO_US           450.0   // do trigger ao início do eco (burst de 40 kHz)
+
+/* Definições - tempo de CPU por leitura na captura por hardware (valores típicos) */
+#define TEMPO_CPU_DISPARO_US          12.0    // pulso de trigger de 10 us e GPIO
+#define TEMPO_CPU_ISR_CAPTURA_US      3.0     // por borda do eco
+#define TEMPO_CPU_RESULTADO_US        2.0     // fila e conversão da contagem
+
+/* Definição - instante da mudança de nível nos cenários com variação (após 2 pulsos) */
+#define INSTANTE_VARIACAO_NIVEL_MS    (2 * TEMPO_MIN_ENTRE_PULSOS_MS)
+
+/* Definição - rajadas simuladas por cenário */
+#define QTDE_RAJADAS                  10000
+
+/* Cenário: modelo do sensor e da lixeira */
+typedef struct
+{
+    const char * nome;
+    double distancia_cm;
+    double ruido_cm;              // desvio padrão do ruído
+    double prob_sem_eco;          // probabilidade de timeout (sem eco)
+    double prob_eco_espurio;      // probabilidade de eco de outro objeto (distância aleatória)
+    double variacao_nivel_cm;     // mudança de nível no meio da rajada (0: nenhuma)
+    bool espera_resultado;        // sensor responde: falha não é esperada
+}TCenario_sensor;
+
+/* Resultado acumulado de um cenário */
+typedef struct
+{
+    uint32_t qtde_qualidade[3];
+    double soma_erro_abs_cm;
+    double maior_erro_abs_cm;
+    uint32_t qtde_com_distancia;
+    uint64_t soma_leituras;
+    uint32_t max_leituras;
+    uint64_t soma_tempo_ms;
+    uint32_t max_tempo_ms;
+    double soma_cpu_biblioteca_us;
+    double soma_cpu_captura_us;
+}TResultado_cenario;
+
+static const TCenario_sensor cenarios[] =
+{
+    { "leituras limpas",          80.0, 0.3, 0.00, 0.00,   0.0, true  },
+    { "ruido de 1 cm",            80.0, 1.0, 0.00, 0.00,   0.0, true  },
+    { "ecos espurios (10%)",      80.0, 0.3, 0.00, 0.10,   0.0, true  },
+    { "sem eco (30%)",            80.0, 0.3, 0.30, 0.00,   0.0, true  },
+    { "ruido de 3 cm",            80.0, 3.0, 0.00, 0.00,   0.0, true  },
+    { "lixo jogado na rajada",    80.0, 0.3, 0.00, 0.00, -25.0, true  },
+    { "lixeira quase cheia",      25.0, 0.5, 0.05, 0.05,   0.0, true  },
+    { "sensor desconectado",      80.0, 0.0, 1.00, 0.00,   0.0, false },
+};
+
+/* Função: gera número aleatório uniforme em [0, 1)
+ * Parâmetros: nenhum
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+/* Função: gera número aleatório com distribuição normal padrão (Box-Muller)
+ * Parâmetros: nenhum
+ * Retorno: número gerado
+ */
+static double aleatorio_normal(void)
+{
+    return sqrt(-2.0 * log(1.0 - aleatorio_uniforme())) * cos(2.0 * M_PI * aleatorio_uniforme());
+}
+
+/* Função: simula um pulso do HC-SR04
+ * Parâmetros: - ponteiro para o cenário
+ *             - distância real no instante do pulso (cm)
+ *             - ponteiro para a distância lida (cm)
+ *             - ponteiro para a duração da medição (ms)
+ * Retorno: true: eco recebido; false: timeout
+ */
+static bool simula_pulso(const TCenario_sensor * pt_cenario, double distancia_real_cm, float * pt_distancia_cm, double * pt_duracao_ms)
+{
+    double distancia_cm;
+
+    if (aleatorio_uniforme() < pt_cenario->prob_sem_eco)
+    {
+        *pt_duracao_ms = TEMPO_ECO_SEM_OBSTACULO_MS;
+        return false;
+    }
+
+    distancia_cm = distancia_real_cm + pt_cenario->ruido_cm * aleatorio_normal();
+    if (aleatorio_uniforme() < pt_cenario->prob_eco_espurio)
+    {
+        distancia_cm = 5.0 + aleatorio_uniforme() * (MAX_DISTANCE_CM - 10.0);
+    }
+
+    *pt_distancia_cm = (float)distancia_cm;
+    *pt_duracao_ms = 2.0 * distancia_cm / VELOCIDADE_SOM_CM_MS;
+    return true;
+}
+
+/* Função: simula uma rajada, como le_sensor() do firmware
+ * Parâmetros: - ponteiro para o cenário
+ *             - ponteiro para o resultado da rajada
+ *             - ponteiro para o tempo de CPU ocupada com ultrasonic_measure() (us, acumulado)
+ *             - ponteiro para o tempo de CPU ocupada com a captura por hardware (us, acumulado)
+ * Retorno: nenhum
+ */
+static void simula_rajada(const TCenario_sensor * pt_cenario, TResultado_rajada * pt_resultado,
+                          double * pt_cpu_biblioteca_us, double * pt_cpu_captura_us)
+{
+    TRajada_medicoes rajada;
+    double instante_ms = 0.0;
+    double duracao_ms;
+    double distancia_real_cm;
+    float distancia_cm = 0.0f;
+    bool leitura_ok;
+    int estado;
+
+    rajada_medicoes_inicia(&rajada);
+
+    do
+    {
+        distancia_real_cm = pt_cenario->distancia_cm;
+        if (instante_ms >= INSTANTE_VARIACAO_NIVEL_MS)
+        {
+            distancia_real_cm += pt_cenario->variacao_nivel_cm;
+        }
+
+        leitura_ok = simula_pulso(pt_cenario, distancia_real_cm, &distancia_cm, &duracao_ms);
+        *pt_cpu_biblioteca_us += TEMPO_CPU_DISPARO_US + TEMPO_INICIO_ECO_US + duracao_ms * 1000.0;
+        *pt_cpu_captura_us += TEMPO_CPU_DISPARO_US + 2.0 * TEMPO_CPU_ISR_CAPTURA_US + TEMPO_CPU_RESULTADO_US;
+        estado = rajada_medicoes_registra(&rajada, leitura_ok, distancia_cm, MAX_DISTANCE_CM, (uint32_t)(instante_ms + duracao_ms));
+
+        /* Próximo pulso após o intervalo mínimo */
+        instante_ms += (duracao_ms > TEMPO_MIN_ENTRE_PULSOS_MS) ? duracao_ms : TEMPO_MIN_ENTRE_PULSOS_MS;
+    } while (estado == RAJADA_CONTINUA);
+
+    *pt_resultado = *rajada_medicoes_resultado(&rajada);
+}
+
+/* Função: simula e mostra um cenário
+ * Parâmetros: ponteiro para o cenário
+ * Retorno: true: resultado dentro do esperado
+ */
+static bool simula_cenario(const TCenario_sensor * pt_cenario)
+{
+    TResultado_cenario resultado;
+    TResultado_rajada rajada;
+    double distancia_final_cm = pt_cenario->distancia_cm + pt_cenario->variacao_nivel_cm;
+    double erro_abs_cm;
+    int i;
+
+    memset(&resultado, 0x00, sizeof(resultado));
+
+    for (i = 0; i < QTDE_RAJADAS; i++)
+    {
+        simula_rajada(pt_cenario, &rajada, &resultado.soma_cpu_biblioteca_us, &resultado.soma_cpu_captura_us);
+
+        resultado.qtde_qualidade[rajada.qualidade]++;
+        resultado.soma_leituras += rajada.qtde_leituras;
+        resultado.soma_tempo_ms += rajada.tempo_ligado_ms;
+        if (rajada.qtde_leituras > resultado.max_leituras)
+        {
+            resultado.max_leituras = rajada.qtde_leituras;
+        }
+        if (rajada.tempo_ligado_ms > resultado.max_tempo_ms)
+        {
+            resultado.max_tempo_ms = rajada.tempo_ligado_ms;
+        }
+
+        if (rajada.qualidade != RAJADA_QUALIDADE_FALHA)
+        {
+            /* Com mudança de nível, vale qualquer um dos dois níveis */
+            erro_abs_cm = fabs(rajada.distancia_cm - pt_cenario->distancia_cm);
+            if (fabs(rajada.distancia_cm - distancia_final_cm) < erro_abs_cm)
+            {
+                erro_abs_cm = fabs(rajada.distancia_cm - distancia_final_cm);
+            }
+
+            resultado.qtde_com_distancia++;
+            resultado.soma_erro_abs_cm += erro_abs_cm;
+            if (erro_abs_cm > resultado.maior_erro_abs_cm)
+            {
+                resultado.maior_erro_abs_cm = erro_abs_cm;
+            }
+        }
+    }
+
+    printf("%-24s %6.1f%% %6.1f%% %6.1f%% %8.2f %8.2f %7.1f %4u %8.0f %6u %8.0f %8.0f\n", pt_cenario->nome,
+           100.0 * resultado.qtde_qualidade[RAJADA_QUALIDADE_BOA] / QTDE_RAJADAS,
+           100.0 * resultado.qtde_qualidade[RAJADA_QUALIDADE_DEGRADADA] / QTDE_RAJADAS,
+           100.0 * resultado.qtde_qualidade[RAJADA_QUALIDADE_FALHA] / QTDE_RAJADAS,
+           (resultado.qtde_com_distancia > 0) ? resultado.soma_erro_abs_cm / resultado.qtde_com_distancia : 0.0,
+           resultado.maior_erro_abs_cm, (double)resultado.soma_leituras / QTDE_RAJADAS, resultado.max_leituras,
+           (double)resultado.soma_tempo_ms / QTDE_RAJADAS, resultado.max_tempo_ms,
+           resultado.soma_cpu_biblioteca_us / resultado.soma_leituras, resultado.soma_cpu_captura_us / resultado.soma_leituras);
+
+    if (resultado.max_tempo_ms > (RAJADA_TEMPO_MAX_MS + TEMPO_ECO_SEM_OBSTACULO_MS))
+    {
+        return false;
+    }
+
+    return (pt_cenario->espera_resultado == false) || (resultado.qtde_qualidade[RAJADA_QUALIDADE_FALHA] == 0);
+}
+
+int main(void)
+{
+    bool todos_ok = true;
+    int i;
+
+    srand(1);
+
+    printf("Rajada: %d leituras concordando em %.1f cm, outlier a %.1f cm da mediana, maximo de %d leituras ou %d ms\n\n",
+           RAJADA_QTDE_CONFIRMACAO, RAJADA_DISPERSAO_MAX_CM, RAJADA_LIMIAR_OUTLIER_CM, RAJADA_QTDE_MAX_LEITURAS, RAJADA_TEMPO_MAX_MS);
+    printf("%-24s %7s %7s %7s %8s %8s %7s %4s %8s %6s %8s %8s\n", "cenario", "boa", "degrad.", "falha",
+           "erro cm", "erro max", "leit.", "max", "ms medio", "ms max", "cpu lib", "cpu cap");
+
+    for (i = 0; i < (int)(sizeof(cenarios) / sizeof(cenarios[0])); i++)
+    {
+        if (simula_cenario(&cenarios[i]) == false)
+        {
+            todos_ok = false;
+        }
+    }
+
+    printf("\ncpu lib / cpu cap: us de CPU ocupada por leitura com ultrasonic_measure() / captura MCPWM\n");
+    printf("\nLeitura anterior (media movel): %d leituras, ~%d ms com o sensor em uso por boot\n",
+           TAM_BUFFER_DISTANCIAS, TAM_BUFFER_DISTANCIAS * TEMPO_ENTRE_LEITURAS_MS);
+
+    return (todos_ok == true) ? 0 : 1;
+}
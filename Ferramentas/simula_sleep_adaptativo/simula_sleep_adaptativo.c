@@ -0,0 +1,433 @@
+/* Ferramenta: simulação do sleep adaptativo do Cap7 (lixeira)
+ *
+ * Reproduz, em tempo virtual, séries de distâncias da lixeira (gravadas
+ * em campo ou sintéticas) contra o código do firmware: histórico e ajuste
+ * da taxa de enchimento (sleep_adaptativo.c), decisão do wake stub
+ * (decisao_wake_stub.c), fila de uplinks (fila_uplinks.c) e lotes de
+ * leituras (lote_leituras.c). Para cada série, compara:
+ * - o firmware original: leitura e envio a cada wake-up (30 min);
+ * - wake stub com política fixa (3 wake-ups pulados) e lotes;
+ * - sleep adaptativo (wake stub pula conforme a taxa prevista) e lotes;
+ * mostrando leituras, uplinks, carga por dia e o atraso para a lixeira
+ * quase cheia ser vista.
+ *
+ * Uso: simula_sleep_adaptativo [serie.csv ...]
+ *      Cada linha da série: instante_s,distancia_cm (linhas com # são
+ *      ignoradas). Sem argumentos, usa séries sintéticas.
+ *
+ * OBS: tempos e correntes de cada tipo de wake-up são valores típicos
+ *      (ver estimador_energia e simula_wake_stub). Para uma estimativa
+ *      fiel, substitua-os por medições da placa utilizada.
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "sleep_adaptativo.h"
+#include "decisao_wake_stub.h"
+#include "lote_leituras.h"
+
+/* Definições - parâmetros do firmware do Cap7 (lixo_lorawan.c e Kconfig.projbuild) */
+#define PERIODO_SLEEP_MIN_S                   1800
+#define PERIODO_SLEEP_MAX_S                   21600
+#define DISTANCIA_LIXEIRA_QUASE_CHEIA_CM      30
+#define MAX_WAKES_PULADOS_FIXO                3
+
+/* Definições - tempos (ms) e correntes (mA) de cada tipo de wake-up */
+#define TEMPO_BOOT_COM_ENVIO_MS               2500.0  // boot, sensor, módulo LoRaWAN e envio
+#define CORRENTE_BOOT_COM_ENVIO_MA            50.0
+#define TEMPO_BOOT_SEM_ENVIO_MS               900.0   // boot e sensor (leitura guardada no lote)
+#define CORRENTE_BOOT_SEM_ENVIO_MA            35.0
+#define TEMPO_WAKE_STUB_MS                    0.46
+#define CORRENTE_WAKE_STUB_MA                 20.0
+
+/* Definições - séries sintéticas */
+#define DIAS_SERIES_SINTETICAS                60
+#define PASSO_SERIES_SINTETICAS_S             600
+#define PROFUNDIDADE_LIXEIRA_CM               100.0
+#define QTDE_MAX_PONTOS_SERIE                 200000
+
+/* Definição - tamanho máximo do quadro (DR2 em LA915) */
+#define TAM_MAX_QUADRO                        11
+
+/* Definições - políticas */
+#define POLITICA_ORIGINAL                     0
+#define POLITICA_WAKE_STUB_FIXO               1
+#define POLITICA_ADAPTATIVA                   2
+#define QTDE_POLITICAS                        3
+
+/* Série de distâncias */
+typedef struct
+{
+    char nome[64];
+    int qtde;
+    uint32_t * instantes_s;
+    float * distancias_cm;
+}TSerie_distancias;
+
+/* Resultado de uma simulação */
+typedef struct
+{
+    uint32_t wakes_no_stub;
+    uint32_t leituras;
+    uint32_t uplinks;
+    uint32_t quase_cheias;
+    double soma_atrasos_s;
+    double maior_atraso_s;
+    double carga_mas;
+}TResultado_simulacao;
+
+static const char * nomes_politicas[QTDE_POLITICAS] = {
+    "original (30 min)", "wake stub fixo + lote", "adaptativo + lote"
+};
+
+/* Função: gera número aleatório uniforme em [0, 1)
+ * Parâmetros: nenhum
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+/* Função: aloca os pontos de uma série
+ * Parâmetros: - ponteiro para a série
+ *             - quantidade máxima de pontos
+ * Retorno: 0: sucesso; -1: falta de memória
+ */
+static int aloca_serie(TSerie_distancias * pt_serie, int qtde_max)
+{
+    pt_serie->qtde = 0;
+    pt_serie->instantes_s = malloc(qtde_max * sizeof(uint32_t));
+    pt_serie->distancias_cm = malloc(qtde_max * sizeof(float));
+
+    return ((pt_serie->instantes_s == NULL) || (pt_serie->distancias_cm == NULL)) ? -1 : 0;
+}
+
+/* Função: libera os pontos de uma série
+ * Parâmetros: ponteiro para a série
+ * Retorno: nenhum
+ */
+static void libera_serie(TSerie_distancias * pt_serie)
+{
+    free(pt_serie->instantes_s);
+    free(pt_serie->distancias_cm);
+}
+
+/* Função: lê uma série gravada (instante_s,distancia_cm por linha)
+ * Parâmetros: - nome do arquivo
+ *             - ponteiro para a série
+ * Retorno: 0: sucesso; -1: erro
+ */
+static int le_serie(const char * pt_arquivo, TSerie_distancias * pt_serie)
+{
+    FILE * arquivo = fopen(pt_arquivo, "r");
+    char linha[256];
+    unsigned long instante_s;
+    float distancia_cm;
+
+    if ((arquivo == NULL) || (aloca_serie(pt_serie, QTDE_MAX_PONTOS_SERIE) != 0))
+    {
+        fprintf(stderr, "Nao foi possivel ler %s\n", pt_arquivo);
+        if (arquivo != NULL)
+        {
+            fclose(arquivo);
+        }
+        return -1;
+    }
+
+    snprintf(pt_serie->nome, sizeof(pt_serie->nome), "%s", pt_arquivo);
+
+    while ((fgets(linha, sizeof(linha), arquivo) != NULL) && (pt_serie->qtde < QTDE_MAX_PONTOS_SERIE))
+    {
+        if ((linha[0] == '#') || (sscanf(linha, "%lu,%f", &instante_s, &distancia_cm) != 2))
+        {
+            continue;
+        }
+
+        pt_serie->instantes_s[pt_serie->qtde] = (uint32_t)instante_s;
+        pt_serie->distancias_cm[pt_serie->qtde] = distancia_cm;
+        pt_serie->qtde++;
+    }
+
+    fclose(arquivo);
+    return (pt_serie->qtde >= 2) ? 0 : -1;
+}
+
+/* Função: gera uma série sintética
+ * Parâmetros: - ponteiro para a série
+ *             - nome
+ *             - taxa de enchimento no horário de uso (cm/h)
+ *             - true: lixeira só é usada em dias úteis, das 8h às 18h
+ *             - ruído do sensor (cm) e probabilidade de eco espúrio por leitura
+ *             - distância em que a lixeira é esvaziada (cm)
+ * Retorno: 0: sucesso; -1: falta de memória
+ */
+static int gera_serie(TSerie_distancias * pt_serie, const char * pt_nome, double taxa_cm_h, int horario_comercial,
+                      double ruido_cm, double prob_eco_espurio, double distancia_coleta_cm)
+{
+    double distancia_cm = PROFUNDIDADE_LIXEIRA_CM;
+    double leitura_cm;
+    uint32_t instante_s;
+    uint32_t hora;
+    uint32_t dia;
+
+    if (aloca_serie(pt_serie, (DIAS_SERIES_SINTETICAS * 86400) / PASSO_SERIES_SINTETICAS_S + 1) != 0)
+    {
+        return -1;
+    }
+
+    snprintf(pt_serie->nome, sizeof(pt_serie->nome), "%s", pt_nome);
+
+    for (instante_s = 0; instante_s <= DIAS_SERIES_SINTETICAS * 86400; instante_s += PASSO_SERIES_SINTETICAS_S)
+    {
+        hora = (instante_s / 3600) % 24;
+        dia = (instante_s / 86400) % 7;
+
+        if ( (horario_comercial == 0) || ((dia < 5) && (hora >= 8) && (hora < 18)) )
+        {
+            distancia_cm -= taxa_cm_h * 2.0 * aleatorio_uniforme() * (PASSO_SERIES_SINTETICAS_S / 3600.0);
+        }
+
+        if (distancia_cm <= distancia_coleta_cm)
+        {
+            distancia_cm = PROFUNDIDADE_LIXEIRA_CM;
+        }
+
+        leitura_cm = distancia_cm + ruido_cm * (2.0 * aleatorio_uniforme() - 1.0);
+        if (aleatorio_uniforme() < prob_eco_espurio)
+        {
+            leitura_cm = 400.0;
+        }
+
+        pt_serie->instantes_s[pt_serie->qtde] = instante_s;
+        pt_serie->distancias_cm[pt_serie->qtde] = (float)leitura_cm;
+        pt_serie->qtde++;
+    }
+
+    return 0;
+}
+
+/* Função: distância da série num instante (ponto anterior mais próximo)
+ * Parâmetros: - ponteiro para a série
+ *             - ponteiro para o índice atual (avança conforme o tempo)
+ *             - instante (s)
+ * Retorno: distância (cm)
+ */
+static float distancia_no_instante(const TSerie_distancias * pt_serie, int * pt_indice, uint32_t instante_s)
+{
+    while ( ((*pt_indice + 1) < pt_serie->qtde) && (pt_serie->instantes_s[*pt_indice + 1] <= instante_s) )
+    {
+        (*pt_indice)++;
+    }
+
+    return pt_serie->distancias_cm[*pt_indice];
+}
+
+/* Função: simula uma série com uma política
+ * Parâmetros: - ponteiro para a série
+ *             - política (POLITICA_...)
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void simula_politica(const TSerie_distancias * pt_serie, int politica, TResultado_simulacao * pt_resultado)
+{
+    static TFila_uplinks fila;
+    static THistorico_distancias historico;
+    TEstado_wake_stub estado_stub;
+    uint8_t quadro[TAM_MAX_QUADRO];
+    uint8_t registro[LOTE_LEITURAS_TAM_LEITURA];
+    uint32_t instante_s;
+    uint32_t instante_fim_s = pt_serie->instantes_s[pt_serie->qtde - 1];
+    uint32_t periodo_s;
+    double instante_quase_cheia_s = -1.0;
+    double atraso_s;
+    float distancia_real;
+    float distancia_lida;
+    float distancia_filtrada;
+    bool com_envio;
+    bool quase_cheia_vista = false;
+    int indice_real = 0;
+    int qtde_leituras;
+    int wakes_a_pular = 0;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_simulacao));
+    memset(&fila, 0x00, sizeof(fila));
+    memset(&historico, 0x00, sizeof(historico));
+    memset(&estado_stub, 0x00, sizeof(estado_stub));
+    fila_uplinks_inicializa(&fila);
+    sleep_adaptativo_inicializa(&historico);
+    decisao_wake_stub_inicializa(&estado_stub, DISTANCIA_LIXEIRA_QUASE_CHEIA_CM);
+
+    for (instante_s = pt_serie->instantes_s[0]; instante_s <= instante_fim_s; instante_s += PERIODO_SLEEP_MIN_S)
+    {
+        /* Lixeira real (para medir o atraso): quase cheia até ser esvaziada */
+        distancia_real = distancia_no_instante(pt_serie, &indice_real, instante_s);
+        if ((distancia_real <= DISTANCIA_LIXEIRA_QUASE_CHEIA_CM) && (instante_quase_cheia_s < 0.0))
+        {
+            instante_quase_cheia_s = instante_s;
+            quase_cheia_vista = false;
+            pt_resultado->quase_cheias++;
+        }
+        else if (distancia_real > DISTANCIA_LIXEIRA_QUASE_CHEIA_CM + SLEEP_ADAPTATIVO_AUMENTO_ESVAZIADA_CM)
+        {
+            instante_quase_cheia_s = -1.0;
+        }
+
+        /* Wake-up por timer: wake stub decide */
+        if ( (politica != POLITICA_ORIGINAL) &&
+             (decisao_wake_stub_decide(&estado_stub, true) == DECISAO_WAKE_STUB_VOLTA_A_DORMIR) )
+        {
+            decisao_wake_stub_registra_pulo(&estado_stub, 0);
+            pt_resultado->wakes_no_stub++;
+            pt_resultado->carga_mas += TEMPO_WAKE_STUB_MS / 1000.0 * CORRENTE_WAKE_STUB_MA;
+            continue;
+        }
+
+        /* Boot completo: leitura do sensor */
+        distancia_lida = distancia_real;
+        pt_resultado->leituras++;
+        distancia_filtrada = sleep_adaptativo_registra_leitura(&historico, instante_s, distancia_lida);
+
+        if ( (distancia_filtrada <= DISTANCIA_LIXEIRA_QUASE_CHEIA_CM) && (instante_quase_cheia_s >= 0.0) &&
+             (quase_cheia_vista == false) )
+        {
+            atraso_s = instante_s - instante_quase_cheia_s;
+            pt_resultado->soma_atrasos_s += atraso_s;
+            if (atraso_s > pt_resultado->maior_atraso_s)
+            {
+                pt_resultado->maior_atraso_s = atraso_s;
+            }
+            quase_cheia_vista = true;  // não conta de novo até esvaziar
+        }
+
+        /* Envio: a cada leitura (original) ou em lotes */
+        if (politica == POLITICA_ORIGINAL)
+        {
+            com_envio = true;
+            pt_resultado->uplinks++;
+        }
+        else
+        {
+            lote_leituras_monta_registro((int32_t)lroundf(distancia_lida), LOTE_LEITURAS_MOTIVO_TIMER, registro);
+            fila_uplinks_insere(&fila, registro, sizeof(registro), instante_s);
+            com_envio = lote_leituras_deve_enviar(&fila, instante_s, (distancia_filtrada <= DISTANCIA_LIXEIRA_QUASE_CHEIA_CM));
+
+            while ((com_envio == true) && (lote_leituras_monta_quadro(&fila, instante_s, quadro, sizeof(quadro), &qtde_leituras) > 0))
+            {
+                fila_uplinks_confirma_envio(&fila, qtde_leituras);
+                pt_resultado->uplinks++;
+            }
+        }
+
+        pt_resultado->carga_mas += (com_envio == true) ? (TEMPO_BOOT_COM_ENVIO_MS / 1000.0 * CORRENTE_BOOT_COM_ENVIO_MA) :
+                                                         (TEMPO_BOOT_SEM_ENVIO_MS / 1000.0 * CORRENTE_BOOT_SEM_ENVIO_MA);
+
+        /* Próximo boot completo */
+        if (politica == POLITICA_WAKE_STUB_FIXO)
+        {
+            wakes_a_pular = MAX_WAKES_PULADOS_FIXO;
+        }
+        else if (politica == POLITICA_ADAPTATIVA)
+        {
+            periodo_s = sleep_adaptativo_proximo_periodo_s(&historico, DISTANCIA_LIXEIRA_QUASE_CHEIA_CM,
+                                                           PERIODO_SLEEP_MIN_S, PERIODO_SLEEP_MAX_S);
+            wakes_a_pular = ((periodo_s + (PERIODO_SLEEP_MIN_S / 2)) / PERIODO_SLEEP_MIN_S) - 1;
+        }
+
+        decisao_wake_stub_registra_boot_completo(&estado_stub, decisao_wake_stub_converte_distancia(distancia_filtrada),
+                                                 (fila_uplinks_quantidade(&fila) > 0) && lote_leituras_deve_enviar(&fila, instante_s, false),
+                                                 (uint8_t)wakes_a_pular, 1);
+    }
+}
+
+/* Função: simula e mostra uma série com todas as políticas
+ * Parâmetros: ponteiro para a série
+ * Retorno: nenhum
+ */
+static void simula_serie(const TSerie_distancias * pt_serie)
+{
+    TResultado_simulacao resultado;
+    double dias = (pt_serie->instantes_s[pt_serie->qtde - 1] - pt_serie->instantes_s[0]) / 86400.0;
+    double carga_original_mah_dia = 0.0;
+    double carga_mah_dia;
+    int politica;
+
+    printf("\n%s (%.0f dias)\n", pt_serie->nome, dias);
+    printf("  %-24s %9s %8s %8s %10s %9s %13s %13s\n", "politica", "leituras", "uplinks", "no stub",
+           "mAh/dia", "economia", "atraso medio", "atraso max");
+
+    for (politica = 0; politica < QTDE_POLITICAS; politica++)
+    {
+        simula_politica(pt_serie, politica, &resultado);
+        carga_mah_dia = resultado.carga_mas / 3600.0 / dias;
+
+        if (politica == POLITICA_ORIGINAL)
+        {
+            carga_original_mah_dia = carga_mah_dia;
+        }
+
+        printf("  %-24s %9u %8u %8u %10.4f %8.1f%% %9.0f min %9.0f min\n", nomes_politicas[politica],
+               resultado.leituras, resultado.uplinks, resultado.wakes_no_stub, carga_mah_dia,
+               100.0 * (1.0 - carga_mah_dia / carga_original_mah_dia),
+               (resultado.quase_cheias > 0) ? resultado.soma_atrasos_s / 60.0 / resultado.quase_cheias : 0.0,
+               resultado.maior_atraso_s / 60.0);
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    TSerie_distancias serie;
+    int i;
+
+    printf("Sleep adaptativo: periodo de %d a %d s, quase cheia a %d cm\n",
+           PERIODO_SLEEP_MIN_S, PERIODO_SLEEP_MAX_S, DISTANCIA_LIXEIRA_QUASE_CHEIA_CM);
+
+    if (argc > 1)
+    {
+        for (i = 1; i < argc; i++)
+        {
+            if (le_serie(argv[i], &serie) == 0)
+            {
+                simula_serie(&serie);
+            }
+            libera_serie(&serie);
+        }
+    }
+    else
+    {
+        srand(1);
+
+        if (gera_serie(&serie, "sintetica: enchimento constante (0,5 cm/h)", 0.5, 0, 0.5, 0.0, 20.0) == 0)
+        {
+            simula_serie(&serie);
+        }
+        libera_serie(&serie);
+
+        if (gera_serie(&serie, "sintetica: horario comercial (2 cm/h)", 2.0, 1, 0.5, 0.0, 20.0) == 0)
+        {
+            simula_serie(&serie);
+        }
+        libera_serie(&serie);
+
+        if (gera_serie(&serie, "sintetica: pouco uso (0,05 cm/h)", 0.05, 0, 0.5, 0.0, 20.0) == 0)
+        {
+            simula_serie(&serie);
+        }
+        libera_serie(&serie);
+
+        if (gera_serie(&serie, "sintetica: sensor ruidoso (2 cm, 2% de ecos espurios)", 0.5, 0, 2.0, 0.02, 20.0) == 0)
+        {
+            simula_serie(&serie);
+        }
+        libera_serie(&serie);
+    }
+
+    printf("\nmAh/dia: somente os wake-ups por timer (sem o deep sleep)\n");
+    printf("atraso: da lixeira ficar quase cheia ate uma leitura ve-la\n");
+
+    return 0;
+}
@@ -0,0 +1,272 @@
+/* Ferramenta: simulação do wake stub do Cap7 (lixeira)
+ *
+ * Executa, em tempo virtual, a mesma decisão do wake stub usada no
+ * firmware (decisao_wake_stub.c) a cada wake-up por timer, com uma lixeira
+ * simulada que enche a uma taxa aleatória e é esvaziada algumas horas
+ * depois de ser vista quase cheia. Para cada política (quantidade máxima de
+ * wake-ups seguidos sem boot completo), mostra quantos wake-ups precisaram
+ * de boot completo, a carga gasta por dia nos wake-ups e o atraso para a
+ * lixeira quase cheia ser lida (o custo de pular leituras).
+ *
+ * O tempo e a corrente de cada tipo de wake-up podem vir do log do firmware:
+ * linhas "Perfil (ms): ... total=..." (boot completo) e
+ * "Wake stub: pulados=... stub_medio_us=..." (tempo medido no wake stub).
+ *
+ * Uso: simula_wake_stub [log_cap7.txt | -]
+ *
+ * OBS: o tempo da ROM até o wake stub e as correntes são valores típicos.
+ *      Para uma estimativa fiel, substitua-os por medições da placa utilizada.
+ */
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "decisao_wake_stub.h"
+
+/* Definições - parâmetros do firmware do Cap7 (lixo_lorawan.c). No firmware, a
+ * quantidade de wake-ups pulados vem do período de sleep adaptativo; aqui, cada
+ * política usa uma quantidade fixa.
+ */
+#define TEMPO_EM_SLEEP_S                      1800
+#define DISTANCIA_LIXEIRA_QUASE_CHEIA_CM      30
+#define MAX_WAKES_PULADOS_WAKE_STUB           3
+
+/* Definições - tempos e correntes de cada tipo de wake-up */
+#define TEMPO_BOOT_COMPLETO_PADRAO_MS         2500.0  // boot, módulo LoRaWAN, sensor e envio
+#define CORRENTE_MEDIA_BOOT_COMPLETO_MA       50.0    // ESP32 ativo + módulo LoRaWAN + sensor (com TX)
+#define TEMPO_ROM_ATE_STUB_US                 400.0   // ROM do ESP32 até o wake stub
+#define TEMPO_NO_STUB_PADRAO_US               60.0    // decisão e rearme do timer RTC
+#define CORRENTE_WAKE_STUB_MA                 20.0    // CPU no clock do cristal, sem flash
+
+/* Definições - lixeira simulada */
+#define DIAS_SIMULADOS                        90
+#define PROFUNDIDADE_LIXEIRA_CM               100.0   // distância com a lixeira vazia
+#define TAXA_MEDIA_ENCHIMENTO_CM_H            0.6
+#define TEMPO_ATE_COLETA_H                    12.0    // após a lixeira ser vista quase cheia
+#define SEMENTE_PADRAO                        1
+
+/* Política simulada */
+typedef struct
+{
+    const char * nome;
+    bool usa_wake_stub;
+    uint8_t max_wakes_pulados;
+}TPolitica;
+
+/* Resultado de uma simulação */
+typedef struct
+{
+    uint32_t wakes;
+    uint32_t boots_completos;
+    uint32_t wakes_no_stub;
+    uint32_t lixeiras_cheias;
+    double soma_atrasos_s;
+    double maior_atraso_s;
+}TResultado_simulacao;
+
+static const TPolitica politicas[] =
+{
+    { "sem wake stub (atual)",  false, 0 },
+    { "wake stub, max 1",       true,  1 },
+    { "wake stub, max 3",       true,  MAX_WAKES_PULADOS_WAKE_STUB },
+    { "wake stub, max 7",       true,  7 },
+};
+
+/* Tempos de cada tipo de wake-up (padrão ou lidos do log) */
+static double tempo_boot_completo_ms = TEMPO_BOOT_COMPLETO_PADRAO_MS;
+static double tempo_no_stub_us = TEMPO_NO_STUB_PADRAO_US;
+
+/* Função: gera número aleatório uniforme em [0, 1)
+ * Parâmetros: nenhum
+ * Retorno: número gerado
+ */
+static double aleatorio_uniforme(void)
+{
+    return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+/* Função: lê do log do firmware o tempo médio do boot completo e do wake stub
+ * Parâmetros: arquivo de log
+ * Retorno: nenhum
+ */
+static void le_tempos_do_log(FILE * arquivo)
+{
+    char linha[512];
+    char * pt;
+    unsigned valor;
+    unsigned pulados;
+    double soma_total_ms = 0.0;
+    double soma_stub_us = 0.0;
+    unsigned qtde_total = 0;
+    unsigned qtde_stub = 0;
+
+    while (fgets(linha, sizeof(linha), arquivo) != NULL)
+    {
+        pt = strstr(linha, "Perfil (ms):");
+        if ((pt != NULL) && ((pt = strstr(pt, "total=")) != NULL) && (sscanf(pt, "total=%u", &valor) == 1))
+        {
+            soma_total_ms += valor;
+            qtde_total++;
+        }
+
+        pt = strstr(linha, "Wake stub:");
+        if ((pt != NULL) && (sscanf(pt, "Wake stub: pulados=%u stub_medio_us=%u", &pulados, &valor) == 2) && (pulados > 0))
+        {
+            soma_stub_us += (double)valor * pulados;
+            qtde_stub += pulados;
+        }
+    }
+
+    if (qtde_total > 0)
+    {
+        tempo_boot_completo_ms = soma_total_ms / qtde_total;
+    }
+
+    if (qtde_stub > 0)
+    {
+        tempo_no_stub_us = soma_stub_us / qtde_stub;
+    }
+
+    printf("Log: %u boot(s) completo(s), %u wake-up(s) no wake stub\n", qtde_total, qtde_stub);
+}
+
+/* Função: simula a lixeira e os wake-ups com uma política
+ * Parâmetros: - ponteiro para a política
+ *             - ponteiro para o resultado
+ * Retorno: nenhum
+ */
+static void simula_politica(const TPolitica * pt_politica, TResultado_simulacao * pt_resultado)
+{
+    TEstado_wake_stub estado;
+    double distancia_cm = PROFUNDIDADE_LIXEIRA_CM;
+    double instante_quase_cheia_s = -1.0;
+    double instante_coleta_s = -1.0;
+    double instante_s;
+    double atraso_s;
+    bool boot_completo;
+
+    memset(pt_resultado, 0x00, sizeof(TResultado_simulacao));
+    memset(&estado, 0x00, sizeof(estado));
+    decisao_wake_stub_inicializa(&estado, DISTANCIA_LIXEIRA_QUASE_CHEIA_CM);
+    srand(SEMENTE_PADRAO);
+
+    for (instante_s = 0.0; instante_s < DIAS_SIMULADOS * 24.0 * 3600.0; instante_s += TEMPO_EM_SLEEP_S)
+    {
+        /* Lixeira enche desde o último wake-up (ou é esvaziada pela coleta) */
+        distancia_cm -= TAXA_MEDIA_ENCHIMENTO_CM_H * 2.0 * aleatorio_uniforme() * (TEMPO_EM_SLEEP_S / 3600.0);
+        if (distancia_cm < 0.0)
+        {
+            distancia_cm = 0.0;
+        }
+
+        if ((instante_quase_cheia_s < 0.0) && (distancia_cm <= DISTANCIA_LIXEIRA_QUASE_CHEIA_CM))
+        {
+            instante_quase_cheia_s = instante_s;
+            pt_resultado->lixeiras_cheias++;
+        }
+
+        if ((instante_coleta_s >= 0.0) && (instante_s >= instante_coleta_s))
+        {
+            distancia_cm = PROFUNDIDADE_LIXEIRA_CM;
+            instante_quase_cheia_s = -1.0;
+            instante_coleta_s = -1.0;
+        }
+
+        /* Wake-up por timer: o wake stub decide */
+        pt_resultado->wakes++;
+        boot_completo = (pt_politica->usa_wake_stub == false) ||
+                        (decisao_wake_stub_decide(&estado, true) == DECISAO_WAKE_STUB_BOOT_COMPLETO);
+
+        if (boot_completo == false)
+        {
+            decisao_wake_stub_registra_pulo(&estado, 0);
+            pt_resultado->wakes_no_stub++;
+            continue;
+        }
+
+        pt_resultado->boots_completos++;
+        decisao_wake_stub_registra_boot_completo(&estado, (uint8_t)distancia_cm, false, pt_politica->max_wakes_pulados, 1);
+
+        /* Lixeira quase cheia lida: a coleta é programada */
+        if ((instante_quase_cheia_s >= 0.0) && (instante_coleta_s < 0.0))
+        {
+            atraso_s = instante_s - instante_quase_cheia_s;
+            pt_resultado->soma_atrasos_s += atraso_s;
+            if (atraso_s > pt_resultado->maior_atraso_s)
+            {
+                pt_resultado->maior_atraso_s = atraso_s;
+            }
+
+            instante_coleta_s = instante_s + TEMPO_ATE_COLETA_H * 3600.0;
+        }
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    TResultado_simulacao resultado;
+    FILE * arquivo;
+    double carga_boot_completo_mas;
+    double carga_wake_stub_mas;
+    double carga_por_dia_mah;
+    double carga_atual_por_dia_mah = 0.0;
+    size_t p;
+
+    if (argc > 1)
+    {
+        arquivo = (strcmp(argv[1], "-") == 0) ? stdin : fopen(argv[1], "r");
+        if (arquivo == NULL)
+        {
+            fprintf(stderr, "Nao foi possivel abrir %s\n", argv[1]);
+            return 1;
+        }
+
+        le_tempos_do_log(arquivo);
+
+        if (arquivo != stdin)
+        {
+            fclose(arquivo);
+        }
+    }
+
+    carga_boot_completo_mas = (tempo_boot_completo_ms / 1000.0) * CORRENTE_MEDIA_BOOT_COMPLETO_MA;
+    carga_wake_stub_mas = ((TEMPO_ROM_ATE_STUB_US + tempo_no_stub_us) / 1000000.0) * CORRENTE_WAKE_STUB_MA;
+
+    printf("Por wake-up:\n");
+    printf("  boot completo: %8.1f ms  %10.4f mAs\n", tempo_boot_completo_ms, carga_boot_completo_mas);
+    printf("  wake stub:     %8.3f ms  %10.4f mAs (ROM %.0f us + stub %.0f us)\n",
+           (TEMPO_ROM_ATE_STUB_US + tempo_no_stub_us) / 1000.0, carga_wake_stub_mas,
+           TEMPO_ROM_ATE_STUB_US, tempo_no_stub_us);
+    printf("  economia por wake-up pulado: %.4f mAs (%.0fx menos)\n\n",
+           carga_boot_completo_mas - carga_wake_stub_mas, carga_boot_completo_mas / carga_wake_stub_mas);
+
+    printf("%d dias, wake-up a cada %d s, quase cheia a %d cm:\n", DIAS_SIMULADOS, TEMPO_EM_SLEEP_S, DISTANCIA_LIXEIRA_QUASE_CHEIA_CM);
+    printf("%-24s %8s %8s %12s %9s %14s %14s\n", "politica", "boots", "no stub", "mAh/dia", "economia",
+           "atraso medio", "atraso max");
+
+    for (p = 0; p < sizeof(politicas) / sizeof(politicas[0]); p++)
+    {
+        simula_politica(&politicas[p], &resultado);
+
+        carga_por_dia_mah = ((resultado.boots_completos * carga_boot_completo_mas) +
+                             (resultado.wakes_no_stub * carga_wake_stub_mas)) / 3600.0 / DIAS_SIMULADOS;
+
+        if (p == 0)
+        {
+            carga_atual_por_dia_mah = carga_por_dia_mah;
+        }
+
+        printf("%-24s %8u %8u %12.4f %8.1f%% %10.1f min %10.1f min\n", politicas[p].nome,
+               resultado.boots_completos, resultado.wakes_no_stub, carga_por_dia_mah,
+               100.0 * (1.0 - carga_por_dia_mah / carga_atual_por_dia_mah),
+               (resultado.lixeiras_cheias > 0) ? resultado.soma_atrasos_s / 60.0 / resultado.lixeiras_cheias : 0.0,
+               resultado.maior_atraso_s / 60.0);
+    }
+
+    printf("\nmAh/dia: somente os wake-ups por timer (sem o deep sleep)\n");
+    printf("atraso: da lixeira ficar quase cheia ate um boot completo le-la\n");
+
+    return 0;
+}